@@ -163,6 +163,7 @@ MEX_FLAGS = $(MEX_FLAGS) -f $(MEXOPT) -I. -Itoolbox -L"$(bindir)" -lvl
 
 libsrc = \
   vl\aib.c \
+  vl\archive.c \
   vl\array.c \
   vl\covdet.c \
   vl\dsift.c \
@@ -172,17 +173,23 @@ libsrc = \
   vl\gmm.c \
   vl\hikmeans.c \
   vl\hog.c \
+  vl\hog_sse2.c \
   vl\homkermap.c \
   vl\host.c \
   vl\ikmeans.c \
+  vl\ikmeans_sse2.c \
   vl\imopv.c \
+  vl\imopv_avx.c \
   vl\imopv_sse2.c \
+  vl\ivfpq.c \
+  vl\ivfpq_avx2.c \
   vl\kdtree.c \
   vl\kmeans.c \
   vl\lbp.c \
   vl\liop.c \
   vl\mathop.c \
   vl\mathop_avx.c \
+  vl\mathop_fma.c \
   vl\mathop_sse2.c \
   vl\mser.c \
   vl\pgm.c \
@@ -192,31 +199,49 @@ libsrc = \
   vl\scalespace.c \
   vl\sift.c \
   vl\slic.c \
+  vl\slic_sse2.c \
   vl\stringop.c \
   vl\svm.c \
   vl\svmdataset.c \
+  vl\svmdataset_sse2.c \
   vl\vlad.c
 
 cmdsrc = \
   src\aib.c \
   src\mser.c \
   src\sift.c \
+  src\test_archive.c \
+  src\test_covdet.c \
+  src\test_distance_transform.c \
+  src\test_dsift.c \
+  src\test_fisher.c \
   src\test_gauss_elimination.c \
   src\test_getopt_long.c \
   src\test_gmm.c \
   src\test_heap-def.c \
+  src\test_hikmeans.c \
+  src\test_hog.c \
   src\test_host.c \
   src\test_imopv.c \
+  src\test_ivfpq.c \
+  src\test_kdtree.c \
   src\test_kmeans.c \
+  src\test_kmeans_mini_batch.c \
   src\test_liop.c \
   src\test_mathop.c \
   src\test_mathop_abs.c \
+  src\test_mser.c \
   src\test_nan.c \
+  src\test_parallel.c \
   src\test_qsort-def.c \
+  src\test_quickshift.c \
   src\test_rand.c \
+  src\test_sift.c \
+  src\test_slic.c \
   src\test_sqrti.c \
   src\test_stringop.c \
   src\test_svd2.c \
+  src\test_svm.c \
   src\test_threads.c \
   src\test_vec_comp.c
 
@@ -224,22 +249,38 @@ cmdsrc = \
   src\aib.c \
   src\mser.c \
   src\sift.c \
+  src\test_archive.c \
+  src\test_covdet.c \
+  src\test_distance_transform.c \
+  src\test_dsift.c \
+  src\test_fisher.c \
   src\test_gauss_elimination.c \
   src\test_getopt_long.c \
   src\test_gmm.c \
   src\test_heap-def.c \
+  src\test_hikmeans.c \
+  src\test_hog.c \
   src\test_host.c \
   src\test_imopv.c \
+  src\test_ivfpq.c \
+  src\test_kdtree.c \
   src\test_kmeans.c \
+  src\test_kmeans_mini_batch.c \
   src\test_liop.c \
   src\test_mathop.c \
   src\test_mathop_abs.c \
+  src\test_mser.c \
   src\test_nan.c \
+  src\test_parallel.c \
   src\test_qsort-def.c \
+  src\test_quickshift.c \
   src\test_rand.c \
+  src\test_sift.c \
+  src\test_slic.c \
   src\test_sqrti.c \
   src\test_stringop.c \
   src\test_svd2.c \
+  src\test_svm.c \
   src\test_threads.c \
   src\test_vec_comp.c
 
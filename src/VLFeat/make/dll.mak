@@ -41,6 +41,8 @@ $(STD_CFLAGS) \
 $(LINK_DLL_CFLAGS) \
 $(call if-like,%_sse2,$*, $(if $(DISABLE_SSE2),,-msse2)) \
 $(call if-like,%_avx,$*, $(if $(DISABLE_AVX),,-mavx)) \
+$(call if-like,%_avx2,$*, $(if $(DISABLE_AVX),,-mavx2)) \
+$(call if-like,%_fma,$*, $(if $(DISABLE_AVX),,-mavx -mfma)) \
 $(if $(DISABLE_THREADS),,-pthread) \
 $(if $(DISABLE_OPENMP),,-fopenmp)
 
@@ -278,7 +278,6 @@ main(int argc, char **argv)
     VlMserFilt      *filt = 0 ;
     VlMserFilt      *filtinv = 0 ;
     vl_uint8        *data = 0 ;
-    vl_uint8        *datainv = 0 ;
     VlPgmImage       pim ;
     vl_uint const   *regions ;
     vl_uint const   *regionsinv ;
@@ -391,12 +390,12 @@ main(int argc, char **argv)
       goto done ;
     }
 
-    if (delta         >= 0) vl_mser_set_delta          (filt, (vl_mser_pix) delta) ;
+    if (delta         >= 0) vl_mser_set_delta          (filt, (int) delta) ;
     if (max_area      >= 0) vl_mser_set_max_area       (filt, max_area) ;
     if (min_area      >= 0) vl_mser_set_min_area       (filt, min_area) ;
     if (max_variation >= 0) vl_mser_set_max_variation  (filt, max_variation) ;
     if (min_diversity >= 0) vl_mser_set_min_diversity  (filt, min_diversity) ;
-    if (delta         >= 0) vl_mser_set_delta          (filtinv, (vl_mser_pix) delta) ;
+    if (delta         >= 0) vl_mser_set_delta          (filtinv, (int) delta) ;
     if (max_area      >= 0) vl_mser_set_max_area       (filtinv, max_area) ;
     if (min_area      >= 0) vl_mser_set_min_area       (filtinv, min_area) ;
     if (max_variation >= 0) vl_mser_set_max_variation  (filtinv, max_variation) ;
@@ -412,10 +411,30 @@ main(int argc, char **argv)
       printf("mser:   min_diversity = %g\n", vl_mser_get_min_diversity (filt)) ;
     }
 
+    /* the second filter extracts bright regions */
+    vl_mser_set_bright_on_dark (filtinv, 1) ;
+
+    if (vl_pgm_get_bpp (&pim) == 2) {
+      vl_uint16 const *data16 = (vl_uint16 const*) data ;
+      if (dark_on_bright && bright_on_dark) {
+        vl_mser_process_pair_ui16 (filt, filtinv, data16) ;
+      } else if (dark_on_bright) {
+        vl_mser_process_ui16 (filt, data16) ;
+      } else if (bright_on_dark) {
+        vl_mser_process_ui16 (filtinv, data16) ;
+      }
+    } else {
+      if (dark_on_bright && bright_on_dark) {
+        vl_mser_process_pair (filt, filtinv, data) ;
+      } else if (dark_on_bright) {
+        vl_mser_process (filt, data) ;
+      } else if (bright_on_dark) {
+        vl_mser_process (filtinv, data) ;
+      }
+    }
+
     if (dark_on_bright)
     {
-      vl_mser_process (filt, (vl_mser_pix*) data) ;
-
       /* Save result  ----------------------------------------------- */
       nregions = vl_mser_get_regions_num (filt) ;
       regions  = vl_mser_get_regions     (filt) ;
@@ -442,22 +461,6 @@ main(int argc, char **argv)
     }
     if (bright_on_dark)
     {
-      /* allocate buffer */
-      datainv = malloc(vl_pgm_get_npixels (&pim) *
-                  vl_pgm_get_bpp       (&pim)) ;
-      for (i = 0; i < (signed)vl_pgm_get_npixels (&pim); i++) {
-        datainv[i] = ~data[i]; /* 255 - data[i] */
-      }
-
-      if (!datainv) {
-        err = VL_ERR_ALLOC ;
-        snprintf(err_msg, sizeof(err_msg),
-                 "Could not allocate enough memory.") ;
-        goto done ;
-      }
-
-      vl_mser_process (filtinv, (vl_mser_pix*) datainv) ;
-
       /* Save result  ----------------------------------------------- */
       nregionsinv = vl_mser_get_regions_num (filtinv) ;
       regionsinv  = vl_mser_get_regions     (filtinv) ;
@@ -512,10 +515,6 @@ main(int argc, char **argv)
       free (data) ;
       data = 0 ;
     }
-    if (datainv) {
-      free (datainv) ;
-      datainv = 0 ;
-    }
 
     /* close files */
     if (in) {
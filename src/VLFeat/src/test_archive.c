@@ -0,0 +1,188 @@
+/** @file   test_archive.c
+ ** @brief  Test writing and mapping a binary archive
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/archive.h>
+#include <vl/random.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define DIMENSION 16
+#define NUM_DATA 3000
+#define NUM_QUERIES 100
+#define NUM_CENTERS 12
+#define NUM_NEIGHBORS 5
+
+int
+main (int argc, char** argv)
+{
+  char const * fileName = "test_archive.vla" ;
+  static float data [DIMENSION * NUM_DATA] ;
+  static float queries [DIMENSION * NUM_QUERIES] ;
+  static vl_uint32 indexes [NUM_NEIGHBORS * NUM_QUERIES], indexes2 [NUM_NEIGHBORS * NUM_QUERIES] ;
+  static float distances [NUM_NEIGHBORS * NUM_QUERIES], distances2 [NUM_NEIGHBORS * NUM_QUERIES] ;
+  vl_size dimensions [2] = {DIMENSION, NUM_DATA} ;
+  VlKMeans * kmeans, * kmeans2 ;
+  VlGMM * gmm, * gmm2 ;
+  VlKDForest * forest, * forest2 ;
+  VlArchiveWriter * writer ;
+  VlArchive * archive ;
+  VlArchiveSection const * section ;
+  vl_bool same = VL_TRUE ;
+  VlRand rand ;
+  vl_uindex i ;
+  FILE * file ;
+
+  if (argc > 1) fileName = argv[1] ;
+
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (i = 0 ; i < DIMENSION * NUM_DATA ; ++i) data[i] = (float) vl_rand_real1 (&rand) ;
+  for (i = 0 ; i < DIMENSION * NUM_QUERIES ; ++i) queries[i] = (float) vl_rand_real1 (&rand) ;
+
+  kmeans = vl_kmeans_new (VL_TYPE_FLOAT, VlDistanceL2) ;
+  vl_kmeans_set_max_num_iterations (kmeans, 10) ;
+  vl_kmeans_cluster (kmeans, data, DIMENSION, NUM_DATA, NUM_CENTERS) ;
+
+  gmm = vl_gmm_new (VL_TYPE_FLOAT, DIMENSION, NUM_CENTERS) ;
+  vl_gmm_set_max_num_iterations (gmm, 5) ;
+  vl_gmm_cluster (gmm, data, NUM_DATA) ;
+
+  forest = vl_kdforest_new (VL_TYPE_FLOAT, DIMENSION, 3, VlDistanceL2) ;
+  vl_kdforest_build (forest, NUM_DATA, data) ;
+  vl_kdforest_set_max_num_comparisons (forest, 200) ;
+  vl_kdforest_query_with_array (forest, indexes, NUM_NEIGHBORS, NUM_QUERIES, distances, queries) ;
+
+  /* write */
+  writer = vl_archive_writer_open (fileName) ;
+  if (writer == NULL ||
+      vl_archive_writer_add (writer, "descriptors", VL_TYPE_FLOAT, 2, dimensions, data) ||
+      vl_archive_writer_add_kmeans (writer, "vocabulary", kmeans) ||
+      vl_archive_writer_add_gmm (writer, "gmm", gmm) ||
+      vl_archive_writer_add_kdforest (writer, "forest", forest) ||
+      vl_archive_writer_add (writer, "descriptors", VL_TYPE_FLOAT, 2, dimensions, data) == VL_ERR_OK ||
+      vl_archive_writer_close (writer)) {
+    VL_PRINTF("test_archive: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+
+  /* map and compare */
+  archive = vl_archive_open (fileName) ;
+  if (archive == NULL) {
+    VL_PRINTF("test_archive: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  section = vl_archive_find_section (archive, "descriptors") ;
+  same &= section && section->dataType == VL_TYPE_FLOAT && section->numDimensions == 2 ;
+  same &= section && ((vl_uintptr) vl_archive_get_section_data (archive, section)) % VL_ARCHIVE_ALIGNMENT == 0 ;
+  same &= section && memcmp (vl_archive_get_section_data (archive, section), data, sizeof(data)) == 0 ;
+
+  kmeans2 = vl_archive_new_kmeans (archive, "vocabulary") ;
+  gmm2 = vl_archive_new_gmm (archive, "gmm") ;
+  forest2 = vl_archive_new_kdforest (archive, "forest") ;
+  if (kmeans2 == NULL || gmm2 == NULL || forest2 == NULL) {
+    VL_PRINTF("test_archive: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  same &= vl_kmeans_get_num_centers (kmeans2) == NUM_CENTERS ;
+  same &= memcmp (vl_kmeans_get_centers (kmeans), vl_kmeans_get_centers (kmeans2),
+                  sizeof(float) * DIMENSION * NUM_CENTERS) == 0 ;
+  same &= memcmp (vl_gmm_get_means (gmm), vl_gmm_get_means (gmm2),
+                  sizeof(float) * DIMENSION * NUM_CENTERS) == 0 ;
+  same &= memcmp (vl_gmm_get_covariances (gmm), vl_gmm_get_covariances (gmm2),
+                  sizeof(float) * DIMENSION * NUM_CENTERS) == 0 ;
+  same &= memcmp (vl_gmm_get_priors (gmm), vl_gmm_get_priors (gmm2),
+                  sizeof(float) * NUM_CENTERS) == 0 ;
+  vl_kdforest_query_with_array (forest2, indexes2, NUM_NEIGHBORS, NUM_QUERIES, distances2, queries) ;
+  same &= memcmp (indexes, indexes2, sizeof(indexes)) == 0 ;
+  same &= memcmp (distances, distances2, sizeof(distances)) == 0 ;
+  same &= vl_kdforest_get_depth_of_tree (forest2, 0) == vl_kdforest_get_depth_of_tree (forest, 0) ;
+  same &= forest2->maxNumLeafData == forest->maxNumLeafData ;
+
+  vl_kdforest_delete (forest2) ;
+  vl_gmm_delete (gmm2) ;
+  vl_kmeans_delete (kmeans2) ;
+  vl_archive_close (archive) ;
+
+  /* a KD-forest with a corrupted node must be rejected */
+  {
+    VlKDTreeFlatNode * root = forest->trees[0]->flatNodes + VL_KDTREE_FLAT_ROOT ;
+    vl_int32 child = root->child ;
+    root->child = (vl_int32) forest->trees[0]->numFlatNodes ;
+    writer = vl_archive_writer_open (fileName) ;
+    if (writer == NULL ||
+        vl_archive_writer_add_kdforest (writer, "forest", forest) ||
+        vl_archive_writer_close (writer)) {
+      VL_PRINTF("test_archive: error: %s\n", vl_get_last_error_message()) ;
+      return -1 ;
+    }
+    root->child = child ;
+    archive = vl_archive_open (fileName) ;
+    if (archive == NULL) {
+      VL_PRINTF("test_archive: error: %s\n", vl_get_last_error_message()) ;
+      return -1 ;
+    }
+    forest2 = vl_archive_new_kdforest (archive, "forest") ;
+    vl_archive_close (archive) ;
+    if (forest2) {
+      VL_PRINTF("test_archive: error: corrupted KD-forest accepted\n") ;
+      return -1 ;
+    }
+  }
+
+  /* a KD-forest with a leaf bound larger than the data must be rejected */
+  {
+    vl_size maxNumLeafData = forest->maxNumLeafData ;
+    forest->maxNumLeafData = NUM_DATA + 1 ;
+    writer = vl_archive_writer_open (fileName) ;
+    if (writer == NULL ||
+        vl_archive_writer_add_kdforest (writer, "forest", forest) ||
+        vl_archive_writer_close (writer)) {
+      VL_PRINTF("test_archive: error: %s\n", vl_get_last_error_message()) ;
+      return -1 ;
+    }
+    forest->maxNumLeafData = maxNumLeafData ;
+    archive = vl_archive_open (fileName) ;
+    if (archive == NULL) {
+      VL_PRINTF("test_archive: error: %s\n", vl_get_last_error_message()) ;
+      return -1 ;
+    }
+    forest2 = vl_archive_new_kdforest (archive, "forest") ;
+    vl_archive_close (archive) ;
+    if (forest2) {
+      VL_PRINTF("test_archive: error: KD-forest with invalid leaf bound accepted\n") ;
+      return -1 ;
+    }
+  }
+
+  /* a file which is not an archive must be rejected */
+  file = fopen (fileName, "wb") ;
+  fwrite (data, 1, 4096, file) ;
+  fclose (file) ;
+  archive = vl_archive_open (fileName) ;
+  remove (fileName) ;
+
+  vl_kdforest_delete (forest) ;
+  vl_gmm_delete (gmm) ;
+  vl_kmeans_delete (kmeans) ;
+
+  if (! same) {
+    VL_PRINTF("test_archive: error: archive content differs\n") ;
+    return -1 ;
+  }
+  if (archive) {
+    VL_PRINTF("test_archive: error: invalid archive accepted\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_archive: passed\n") ;
+  return 0 ;
+}
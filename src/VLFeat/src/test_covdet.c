@@ -0,0 +1,127 @@
+/** @file   test_covdet.c
+ ** @brief  Test the covariant detector with threads
+ **/
+
+/*
+Copyright (C) 2013 Andrea Vedaldi.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/covdet.h>
+#include <vl/random.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 160
+#define HEIGHT 120
+#define RESOLUTION 7
+#define PATCH_SIZE ((2*RESOLUTION+1)*(2*RESOLUTION+1))
+#define MAX_NUM_FEATURES 4000
+
+/* detect and describe the features, storing frames and patches */
+static vl_size
+run (VlCovDetMethod method, float const * image,
+     VlCovDetFeature * features, float * patches)
+{
+  VlCovDet * covdet = vl_covdet_new (method) ;
+  vl_size numFeatures ;
+  vl_covdet_put_image (covdet, image, WIDTH, HEIGHT) ;
+  if (vl_covdet_detect (covdet)) {
+    VL_PRINTF("test_covdet: error: %s\n", vl_get_last_error_message()) ;
+    exit (1) ;
+  }
+  vl_covdet_drop_features_outside (covdet, 2) ;
+  if (vl_covdet_extract_affine_shape (covdet) ||
+      vl_covdet_extract_orientations (covdet)) {
+    VL_PRINTF("test_covdet: error: %s\n", vl_get_last_error_message()) ;
+    exit (1) ;
+  }
+  numFeatures = vl_covdet_get_num_features (covdet) ;
+  assert (numFeatures <= MAX_NUM_FEATURES) ;
+  memcpy (features, vl_covdet_get_features (covdet), sizeof(VlCovDetFeature) * numFeatures) ;
+  if (vl_covdet_extract_patches (covdet, patches, RESOLUTION, 6.0, 1.0)) {
+    VL_PRINTF("test_covdet: error: %s\n", vl_get_last_error_message()) ;
+    exit (1) ;
+  }
+  vl_covdet_delete (covdet) ;
+  return numFeatures ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static float image [WIDTH * HEIGHT] ;
+  static VlCovDetFeature reference [MAX_NUM_FEATURES], features [MAX_NUM_FEATURES] ;
+  static float referencePatches [MAX_NUM_FEATURES * PATCH_SIZE] ;
+  static float patches [MAX_NUM_FEATURES * PATCH_SIZE] ;
+  static float patch [PATCH_SIZE] ;
+  VlCovDetMethod methods [3] = {VL_COVDET_METHOD_DOG,
+                                VL_COVDET_METHOD_HESSIAN_LAPLACE,
+                                VL_COVDET_METHOD_HARRIS_LAPLACE} ;
+  vl_bool same = VL_TRUE ;
+  vl_size numReference, numFeatures, total = 0 ;
+  VlRand rand ;
+  vl_uindex i, j, m ;
+
+  /* blobs of various sizes and shapes on a noisy background */
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (j = 0 ; j < HEIGHT ; ++j) {
+    for (i = 0 ; i < WIDTH ; ++i) {
+      image[j * WIDTH + i] = (float) (0.05 * vl_rand_real1 (&rand)) ;
+    }
+  }
+  for (m = 0 ; m < 30 ; ++m) {
+    double cx = WIDTH * vl_rand_real1 (&rand) ;
+    double cy = HEIGHT * vl_rand_real1 (&rand) ;
+    double sx = 2 + 6 * vl_rand_real1 (&rand) ;
+    double sy = 2 + 6 * vl_rand_real1 (&rand) ;
+    for (j = 0 ; j < HEIGHT ; ++j) {
+      for (i = 0 ; i < WIDTH ; ++i) {
+        double dx = (i - cx) / sx, dy = (j - cy) / sy ;
+        image[j * WIDTH + i] += (float) exp (- 0.5 * (dx * dx + dy * dy)) ;
+      }
+    }
+  }
+
+  for (m = 0 ; m < 3 ; ++m) {
+    VlCovDet * covdet ;
+
+    /* the threads must not change the features nor the patches */
+    vl_set_num_threads (1) ;
+    numReference = run (methods[m], image, reference, referencePatches) ;
+    vl_set_num_threads (0) ;
+    numFeatures = run (methods[m], image, features, patches) ;
+    same &= (numReference == numFeatures) ;
+    same &= memcmp (reference, features, sizeof(VlCovDetFeature) * numFeatures) == 0 ;
+    same &= memcmp (referencePatches, patches, sizeof(float) * PATCH_SIZE * numFeatures) == 0 ;
+    total += numFeatures ;
+
+    /* the patches must match the ones extracted one by one */
+    covdet = vl_covdet_new (methods[m]) ;
+    vl_covdet_put_image (covdet, image, WIDTH, HEIGHT) ;
+    for (i = 0 ; i < numFeatures ; ++i) {
+      vl_covdet_extract_patch_for_frame (covdet, patch, RESOLUTION, 6.0, 1.0, features[i].frame) ;
+      same &= memcmp (patch, patches + i * PATCH_SIZE, sizeof(patch)) == 0 ;
+    }
+    vl_covdet_delete (covdet) ;
+  }
+
+  VL_PRINTF("test_covdet: %d features\n", (int)total) ;
+
+  if (total == 0) {
+    VL_PRINTF("test_covdet: error: no features detected\n") ;
+    return -1 ;
+  }
+  if (! same) {
+    VL_PRINTF("test_covdet: error: threads changed the result\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_covdet: passed\n") ;
+  return 0 ;
+}
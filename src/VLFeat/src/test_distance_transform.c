@@ -0,0 +1,103 @@
+/** @file   test_distance_transform.c
+ ** @brief  Test the 2D distance transform of a batch of images
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/imopv.h>
+#include <vl/mathop.h>
+#include <vl/random.h>
+
+#include <string.h>
+
+#define WIDTH 37
+#define HEIGHT 29
+#define NUM_IMAGES 5
+#define SIZE (WIDTH * HEIGHT)
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static double imaged [SIZE * NUM_IMAGES], dtd [SIZE * NUM_IMAGES] ;
+  static float imagef [SIZE * NUM_IMAGES], dtf [SIZE * NUM_IMAGES] ;
+  static float reference [SIZE * NUM_IMAGES] ;
+  static vl_uindex argmins [SIZE * NUM_IMAGES], indexes [SIZE * NUM_IMAGES] ;
+  double const coeffX = 1, offsetX = 2, coeffY = 3, offsetY = -1 ;
+  vl_bool exact = VL_TRUE ;
+  vl_bool same = VL_TRUE ;
+  int err = VL_ERR_OK ;
+  VlRand rand ;
+  vl_uindex i, k, u, v, u_, v_ ;
+
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (i = 0 ; i < SIZE * NUM_IMAGES ; ++i) {
+    imaged[i] = (double) (vl_rand_uint32 (&rand) % 1000) ;
+    imagef[i] = (float) (1000 * vl_rand_real1 (&rand)) ;
+  }
+
+  /* integer data and costs: compare to brute force */
+  err |= vl_image_distance_transform_2d_d (imaged, NUM_IMAGES, WIDTH, HEIGHT, dtd, argmins,
+                                           coeffX, offsetX, coeffY, offsetY) ;
+  for (k = 0 ; k < NUM_IMAGES ; ++k) {
+    double const * image = imaged + k * SIZE ;
+    for (v = 0 ; v < HEIGHT ; ++v) {
+      for (u = 0 ; u < WIDTH ; ++u) {
+        double best = VL_INFINITY_D, atArgmin ;
+        double du, dv ;
+        vl_uindex a = argmins[k * SIZE + u + v * WIDTH] ;
+        for (v_ = 0 ; v_ < HEIGHT ; ++v_) {
+          for (u_ = 0 ; u_ < WIDTH ; ++u_) {
+            du = (double) u - (double) u_ - offsetX ;
+            dv = (double) v - (double) v_ - offsetY ;
+            best = VL_MIN(best, image[u_ + v_ * WIDTH] + coeffX * du * du + coeffY * dv * dv) ;
+          }
+        }
+        du = (double) u - (double) (a % WIDTH) - offsetX ;
+        dv = (double) v - (double) (a / WIDTH) - offsetY ;
+        atArgmin = image[a] + coeffX * du * du + coeffY * dv * dv ;
+        exact &= (dtd[k * SIZE + u + v * WIDTH] == best) && (atArgmin == best) ;
+      }
+    }
+  }
+
+  /* float data: compare to two 1D transforms, with and without threads */
+  for (k = 0 ; k < NUM_IMAGES ; ++k) {
+    float * dt = reference + k * SIZE ;
+    vl_uindex * idx = indexes + k * SIZE ;
+    for (i = 0 ; i < SIZE ; ++i) idx[i] = i ;
+    err |= vl_image_distance_transform_f (imagef + k * SIZE, WIDTH, HEIGHT, 1, WIDTH,
+                                          dt, idx, (float)coeffX, (float)offsetX) ;
+    err |= vl_image_distance_transform_f (dt, HEIGHT, WIDTH, WIDTH, 1,
+                                          dt, idx, (float)coeffY, (float)offsetY) ;
+  }
+  for (i = 0 ; i < 2 ; ++i) {
+    vl_set_num_threads (i == 0 ? 1 : 0) ;
+    err |= vl_image_distance_transform_2d_f (imagef, NUM_IMAGES, WIDTH, HEIGHT, dtf, argmins,
+                                             (float)coeffX, (float)offsetX,
+                                             (float)coeffY, (float)offsetY) ;
+    same &= memcmp (reference, dtf, sizeof(dtf)) == 0 ;
+    same &= memcmp (indexes, argmins, sizeof(argmins)) == 0 ;
+  }
+
+  if (err) {
+    VL_PRINTF("test_distance_transform: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  if (! exact) {
+    VL_PRINTF("test_distance_transform: error: wrong distance transform\n") ;
+    return -1 ;
+  }
+  if (! same) {
+    VL_PRINTF("test_distance_transform: error: different from the 1D transforms\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_distance_transform: passed\n") ;
+  return 0 ;
+}
@@ -0,0 +1,101 @@
+/** @file   test_dsift.c
+ ** @brief  Test incremental dense SIFT updates
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/dsift.h>
+#include <vl/random.h>
+
+#include <math.h>
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  int width = 320 ;
+  int height = 240 ;
+  int x, y, i, flat ;
+  int numErrors = 0 ;
+  VlRand rand ;
+  float * image = vl_malloc (sizeof(float) * width * height) ;
+
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1000) ;
+  for (i = 0 ; i < width * height ; ++i) image[i] = (float) vl_rand_real1 (&rand) ;
+
+  for (flat = 0 ; flat < 2 ; ++flat) {
+    VlDsiftFilter * incremental = vl_dsift_new_basic (width, height, 4, 6) ;
+    VlDsiftFilter * full = vl_dsift_new_basic (width, height, 4, 6) ;
+    int descrSize = vl_dsift_get_descriptor_size (incremental) ;
+    int numFrames ;
+    double fullTime = 0, incrementalTime = 0 ;
+    float maxError = 0 ;
+    int step ;
+
+    vl_dsift_set_flat_window (incremental, flat) ;
+    vl_dsift_set_flat_window (full, flat) ;
+    vl_dsift_process (incremental, image) ;
+
+    /* move a small patch around, as in a video */
+    for (step = 0 ; step < 10 ; ++step) {
+      int minX = 20 + 25 * step ;
+      int minY = 10 + 20 * step ;
+      int maxX = minX + 15 ;
+      int maxY = minY + 10 ;
+      VlDsiftKeypoint const * frames1 ;
+      VlDsiftKeypoint const * frames2 ;
+      float const * descrs1 ;
+      float const * descrs2 ;
+
+      for (y = minY ; y <= maxY ; ++y) {
+        for (x = minX ; x <= maxX ; ++x) {
+          image[x + y * width] = (float) vl_rand_real1 (&rand) ;
+        }
+      }
+
+      vl_tic () ;
+      vl_dsift_update (incremental, image, minX, minY, maxX, maxY) ;
+      incrementalTime += vl_toc () ;
+      vl_tic () ;
+      vl_dsift_process (full, image) ;
+      fullTime += vl_toc () ;
+
+      numFrames = vl_dsift_get_keypoint_num (full) ;
+      frames1 = vl_dsift_get_keypoints (incremental) ;
+      frames2 = vl_dsift_get_keypoints (full) ;
+      descrs1 = vl_dsift_get_descriptors (incremental) ;
+      descrs2 = vl_dsift_get_descriptors (full) ;
+      for (i = 0 ; i < numFrames ; ++i) {
+        if (frames1[i].x != frames2[i].x || frames1[i].y != frames2[i].y ||
+            fabs (frames1[i].norm - frames2[i].norm) > 1e-5 * frames2[i].norm) {
+          ++ numErrors ;
+        }
+      }
+      for (i = 0 ; i < numFrames * descrSize ; ++i) {
+        maxError = VL_MAX(maxError, fabsf (descrs1[i] - descrs2[i])) ;
+      }
+    }
+
+    VL_PRINTF("test_dsift: flat window %d: full %.3f [s], incremental %.3f [s], max error %g\n",
+              flat, fullTime, incrementalTime, maxError) ;
+    if ((flat && maxError > 1e-5) || (! flat && maxError > 0)) ++ numErrors ;
+
+    vl_dsift_delete (incremental) ;
+    vl_dsift_delete (full) ;
+  }
+
+  vl_free (image) ;
+
+  if (numErrors) {
+    VL_PRINTF("test_dsift: error: incremental and full descriptors differ\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_dsift: passed\n") ;
+  return 0 ;
+}
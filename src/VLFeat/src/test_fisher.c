@@ -0,0 +1,166 @@
+/** @file   test_fisher.c
+ ** @brief  Test incremental Fisher vector and VLAD encoding
+ **/
+
+/*
+Copyright (C) 2013 David Novotny and Andrea Vedaldi.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/fisher.h>
+#include <vl/vlad.h>
+#include <vl/gmm.h>
+#include <vl/random.h>
+
+#include <math.h>
+#include <string.h>
+
+#define DIMENSION 24
+#define NUM_CLUSTERS 16
+#define NUM_DATA 1000
+
+/* Fisher vector computed from the GMM posteriors (ignoring small ones) */
+static void
+fisher_reference (double * enc,
+                  double const * means, double const * covariances,
+                  double const * priors, double const * data)
+{
+  static double posteriors [NUM_CLUSTERS * NUM_DATA] ;
+  vl_uindex k, i, d ;
+  double n = 0 ;
+  vl_get_gmm_data_posteriors_d (posteriors, NUM_CLUSTERS, NUM_DATA,
+                                priors, means, DIMENSION, covariances, data) ;
+  memset (enc, 0, sizeof(double) * 2 * DIMENSION * NUM_CLUSTERS) ;
+  for (k = 0 ; k < NUM_CLUSTERS ; ++k) {
+    for (i = 0 ; i < NUM_DATA ; ++i) {
+      double q = posteriors[k + i * NUM_CLUSTERS] ;
+      if (q < 1e-6) continue ;
+      for (d = 0 ; d < DIMENSION ; ++d) {
+        double z = (data[i * DIMENSION + d] - means[k * DIMENSION + d]) /
+          sqrt (covariances[k * DIMENSION + d]) ;
+        enc[k * DIMENSION + d] += q * z / (NUM_DATA * sqrt (priors[k])) ;
+        enc[(k + NUM_CLUSTERS) * DIMENSION + d] +=
+          q * (z * z - 1) / (NUM_DATA * sqrt (2 * priors[k])) ;
+      }
+    }
+  }
+  for (d = 0 ; d < 2 * DIMENSION * NUM_CLUSTERS ; ++d) n += enc[d] * enc[d] ;
+  for (d = 0 ; d < 2 * DIMENSION * NUM_CLUSTERS ; ++d) enc[d] /= sqrt (n) ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static double data [DIMENSION * NUM_DATA] ;
+  static double means [DIMENSION * NUM_CLUSTERS] ;
+  static double covariances [DIMENSION * NUM_CLUSTERS] ;
+  static double priors [NUM_CLUSTERS] ;
+  static double reference [2 * DIMENSION * NUM_CLUSTERS] ;
+  static double enc [2 * DIMENSION * NUM_CLUSTERS] ;
+  static double assignments [NUM_CLUSTERS * NUM_DATA] ;
+  vl_size chunks [4] = {1, 7, 300, 1000} ;
+  VlFisherEncoder * fisher ;
+  VlVladEncoder * vlad ;
+  VlRand rand ;
+  vl_uindex i, k, d, c ;
+  vl_size numTerms, streamNumTerms ;
+  double error = 0 ;
+  vl_bool same = VL_TRUE ;
+
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (k = 0 ; k < NUM_CLUSTERS ; ++k) {
+    priors[k] = 1.0 / NUM_CLUSTERS ;
+    for (d = 0 ; d < DIMENSION ; ++d) {
+      means[k * DIMENSION + d] = 4 * vl_rand_real1 (&rand) ;
+      covariances[k * DIMENSION + d] = 0.5 + vl_rand_real1 (&rand) ;
+    }
+  }
+  for (i = 0 ; i < NUM_DATA ; ++i) {
+    vl_uindex label = vl_rand_uint32 (&rand) % NUM_CLUSTERS ;
+    for (d = 0 ; d < DIMENSION ; ++d) {
+      data[i * DIMENSION + d] = means[label * DIMENSION + d] + vl_rand_real1 (&rand) - 0.5 ;
+    }
+  }
+
+  /* Fisher: batch against the posteriors, incremental against batch */
+  fisher_reference (reference, means, covariances, priors, data) ;
+  numTerms = vl_fisher_encode (enc, VL_TYPE_DOUBLE,
+                               means, DIMENSION, NUM_CLUSTERS,
+                               covariances, priors,
+                               data, NUM_DATA,
+                               VL_FISHER_FLAG_NORMALIZED) ;
+  for (d = 0 ; d < 2 * DIMENSION * NUM_CLUSTERS ; ++d) {
+    error = VL_MAX(error, fabs (enc[d] - reference[d])) ;
+  }
+  memcpy (reference, enc, sizeof(enc)) ;
+
+  fisher = vl_fisher_encoder_new (VL_TYPE_DOUBLE,
+                                  means, DIMENSION, NUM_CLUSTERS,
+                                  covariances, priors,
+                                  VL_FISHER_FLAG_NORMALIZED) ;
+  for (c = 0 ; c < 4 ; ++c) {
+    vl_fisher_encoder_begin (fisher) ;
+    for (i = 0 ; i < NUM_DATA ; i += chunks[c]) {
+      vl_fisher_encoder_push (fisher, data + i * DIMENSION,
+                              VL_MIN(chunks[c], NUM_DATA - i)) ;
+    }
+    streamNumTerms = vl_fisher_encoder_finalize (fisher, enc) ;
+    same &= (streamNumTerms == numTerms) ;
+    same &= (vl_fisher_encoder_get_num_data (fisher) == NUM_DATA) ;
+    same &= memcmp (reference, enc, sizeof(enc)) == 0 ;
+  }
+  vl_fisher_encoder_delete (fisher) ;
+
+  /* VLAD: nearest means against explicit hard assignments */
+  memset (assignments, 0, sizeof(assignments)) ;
+  for (i = 0 ; i < NUM_DATA ; ++i) {
+    vl_uindex best = 0 ;
+    double bestDistance = VL_INFINITY_D ;
+    for (k = 0 ; k < NUM_CLUSTERS ; ++k) {
+      double distance = 0 ;
+      for (d = 0 ; d < DIMENSION ; ++d) {
+        double z = data[i * DIMENSION + d] - means[k * DIMENSION + d] ;
+        distance += z * z ;
+      }
+      if (distance < bestDistance) {
+        bestDistance = distance ;
+        best = k ;
+      }
+    }
+    assignments[i * NUM_CLUSTERS + best] = 1 ;
+  }
+  vl_vlad_encode (reference, VL_TYPE_DOUBLE,
+                  means, DIMENSION, NUM_CLUSTERS,
+                  data, NUM_DATA, assignments,
+                  VL_VLAD_FLAG_SQUARE_ROOT) ;
+
+  vlad = vl_vlad_encoder_new (VL_TYPE_DOUBLE, means, DIMENSION, NUM_CLUSTERS,
+                              VL_VLAD_FLAG_SQUARE_ROOT) ;
+  for (c = 0 ; c < 4 ; ++c) {
+    vl_vlad_encoder_begin (vlad) ;
+    for (i = 0 ; i < NUM_DATA ; i += chunks[c]) {
+      vl_vlad_encoder_push (vlad, data + i * DIMENSION,
+                            VL_MIN(chunks[c], NUM_DATA - i), NULL) ;
+    }
+    vl_vlad_encoder_finalize (vlad, enc) ;
+    same &= memcmp (reference, enc, sizeof(double) * DIMENSION * NUM_CLUSTERS) == 0 ;
+  }
+  vl_vlad_encoder_delete (vlad) ;
+
+  VL_PRINTF("test_fisher: %d terms, error %g\n", (int)numTerms, error) ;
+
+  if (error > 1e-10) {
+    VL_PRINTF("test_fisher: error: wrong Fisher vector\n") ;
+    return -1 ;
+  }
+  if (! same) {
+    VL_PRINTF("test_fisher: error: incremental encoding differs\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_fisher: passed\n") ;
+  return 0 ;
+}
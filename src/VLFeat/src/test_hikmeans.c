@@ -0,0 +1,126 @@
+/** @file   test_hikmeans.c
+ ** @brief  Test integer K-means with threads and SIMD
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/hikmeans.h>
+#include <vl/random.h>
+
+#include <string.h>
+
+#define M 37
+#define N 3000
+#define K 8
+#define DEPTH 3
+
+/* train an IKM quantizer and store its centers and assignments */
+static void
+train (int method, vl_uint8 const * data,
+       vl_ikmacc_t * centers, vl_uint32 * asgn)
+{
+  VlIKMFilt * f = vl_ikm_new (method) ;
+  vl_rand_seed (vl_get_rand(), 0) ;
+  vl_ikm_init_rand_data (f, data, M, N, K) ;
+  vl_ikm_train (f, data, N) ;
+  vl_ikm_push (f, asgn, data, N) ;
+  memcpy (centers, vl_ikm_get_centers (f), sizeof(vl_ikmacc_t) * M * K) ;
+  vl_ikm_delete (f) ;
+}
+
+/* train a HIKM tree and store the assignments */
+static void
+train_tree (int method, vl_uint8 const * data, vl_uint32 * asgn)
+{
+  VlHIKMTree * tree = vl_hikm_new (method) ;
+  vl_rand_seed (vl_get_rand(), 0) ;
+  vl_hikm_init (tree, M, K, DEPTH) ;
+  vl_hikm_train (tree, data, N) ;
+  vl_hikm_push (tree, asgn, data, N) ;
+  vl_hikm_delete (tree) ;
+}
+
+/* the assignments must be to the nearest centers */
+static vl_bool
+nearest (VlIKMFilt * f, vl_uint8 const * data, vl_uint32 const * asgn)
+{
+  vl_uindex i ;
+  for (i = 0 ; i < N ; ++i) {
+    if (asgn[i] != vl_ikm_push_one (vl_ikm_get_centers (f), data + i * M, M, vl_ikm_get_K (f))) {
+      return VL_FALSE ;
+    }
+  }
+  return VL_TRUE ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static vl_uint8 data [M * N] ;
+  static vl_ikmacc_t reference [M * K], centers [M * K] ;
+  static vl_uint32 referenceAsgn [N * DEPTH], asgn [N * DEPTH] ;
+  int methods [2] = {VL_IKM_LLOYD, VL_IKM_ELKAN} ;
+  vl_bool same = VL_TRUE ;
+  vl_bool valid = VL_TRUE ;
+  VlIKMFilt * f ;
+  VlRand rand ;
+  vl_uindex i, d, m ;
+
+  /* noisy clusters */
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (i = 0 ; i < N ; ++i) {
+    vl_uindex label = vl_rand_uint32 (&rand) % (2 * K) ;
+    for (d = 0 ; d < M ; ++d) {
+      data[i * M + d] = (vl_uint8) ((label * 13 * (d + 1)) % 200 +
+                                    vl_rand_uint32 (&rand) % 50) ;
+    }
+  }
+
+  for (m = 0 ; m < 2 ; ++m) {
+    /* neither SIMD nor threads may change the result */
+    vl_set_simd_enabled (VL_FALSE) ;
+    vl_set_num_threads (1) ;
+    train (methods[m], data, reference, referenceAsgn) ;
+    vl_set_simd_enabled (VL_TRUE) ;
+    vl_set_num_threads (0) ;
+    train (methods[m], data, centers, asgn) ;
+    same &= memcmp (reference, centers, sizeof(centers)) == 0 ;
+    same &= memcmp (referenceAsgn, asgn, sizeof(vl_uint32) * N) == 0 ;
+
+    f = vl_ikm_new (methods[m]) ;
+    vl_ikm_init (f, centers, M, K) ;
+    valid &= nearest (f, data, asgn) ;
+
+    /* a center out of the SIMD range */
+    centers[0] = 40000 ;
+    vl_ikm_init (f, centers, M, K) ;
+    vl_ikm_push (f, asgn, data, N) ;
+    valid &= nearest (f, data, asgn) ;
+    vl_ikm_delete (f) ;
+
+    /* trees */
+    vl_set_num_threads (1) ;
+    train_tree (methods[m], data, referenceAsgn) ;
+    vl_set_num_threads (0) ;
+    train_tree (methods[m], data, asgn) ;
+    same &= memcmp (referenceAsgn, asgn, sizeof(asgn)) == 0 ;
+  }
+
+  if (! same) {
+    VL_PRINTF("test_hikmeans: error: threads or SIMD changed the result\n") ;
+    return -1 ;
+  }
+  if (! valid) {
+    VL_PRINTF("test_hikmeans: error: data not assigned to the nearest center\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_hikmeans: passed\n") ;
+  return 0 ;
+}
@@ -0,0 +1,121 @@
+/** @file   test_hog.c
+ ** @brief  Test HOG feature pyramid and vectorized gradients
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/hog.h>
+#include <vl/random.h>
+
+#include <math.h>
+#include <string.h>
+
+static float *
+extract (VlHog * hog, float const * image, vl_size width, vl_size height,
+         vl_size numChannels, vl_size cellSize)
+{
+  float * features ;
+  vl_hog_put_image (hog, image, width, height, numChannels, cellSize) ;
+  features = vl_malloc (sizeof(float) * vl_hog_get_width (hog) *
+                        vl_hog_get_height (hog) * vl_hog_get_dimension (hog)) ;
+  vl_hog_extract (hog, features) ;
+  return features ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  vl_size width = 317 ;
+  vl_size height = 241 ;
+  vl_size numChannels = 3 ;
+  vl_size cellSize = 8 ;
+  vl_size numLevelsPerOctave = 5 ;
+  VlRand rand ;
+  float * image ;
+  vl_uindex x, y, k, v, b ;
+  vl_size numErrors = 0 ;
+
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1000) ;
+  image = vl_malloc (sizeof(float) * width * height * numChannels) ;
+  for (k = 0 ; k < numChannels ; ++k) {
+    for (y = 0 ; y < height ; ++y) {
+      for (x = 0 ; x < width ; ++x) {
+        image [x + width * (y + height * k)] = (float)
+          (sin (0.1 * x * (k + 1)) * cos (0.07 * y) + 0.2 * vl_rand_real1 (&rand)) ;
+      }
+    }
+  }
+
+  for (v = 0 ; v < 2 ; ++v) {
+    for (b = 0 ; b < 2 ; ++b) {
+      VlHog * hog = vl_hog_new (v ? VlHogVariantDalalTriggs : VlHogVariantUoctti, 9, VL_FALSE) ;
+      VlHogPyramidLevel * levels ;
+      float * pyramid ;
+      float * simd ;
+      float * scalar ;
+      vl_size numLevels, numFeatures, l ;
+
+      vl_hog_set_use_bilinear_orientation_assignments (hog, b) ;
+      simd = extract (hog, image, width, height, numChannels, cellSize) ;
+      numFeatures = vl_hog_get_width (hog) * vl_hog_get_height (hog) * vl_hog_get_dimension (hog) ;
+      vl_set_simd_enabled (VL_FALSE) ;
+      scalar = extract (hog, image, width, height, numChannels, cellSize) ;
+      vl_set_simd_enabled (VL_TRUE) ;
+      if (memcmp (simd, scalar, sizeof(float) * numFeatures)) {
+        VL_PRINTF("test_hog: error: SIMD and scalar features differ\n") ;
+        ++ numErrors ;
+      }
+
+      vl_tic () ;
+      numLevels = vl_hog_process_pyramid (hog, &pyramid, &levels,
+                                          image, width, height, numChannels,
+                                          cellSize, numLevelsPerOctave) ;
+      VL_PRINTF("test_hog: variant %d, bilinear %d: %d levels in %.3f [s]\n",
+                (int)v, (int)b, (int)numLevels, vl_toc ()) ;
+
+      /* level zero is the input image */
+      if (levels[0].width != vl_hog_get_width (hog) ||
+          levels[0].height != vl_hog_get_height (hog) ||
+          memcmp (pyramid + levels[0].offset, simd, sizeof(float) * numFeatures)) {
+        VL_PRINTF("test_hog: error: first pyramid level differs\n") ;
+        ++ numErrors ;
+      }
+      for (l = 1 ; l < numLevels ; ++l) {
+        if (levels[l].offset != levels[l-1].offset +
+            levels[l-1].width * levels[l-1].height * vl_hog_get_dimension (hog) ||
+            levels[l].width > levels[l-1].width ||
+            levels[l].height > levels[l-1].height) {
+          VL_PRINTF("test_hog: error: bad geometry of level %d\n", (int)l) ;
+          ++ numErrors ;
+        }
+      }
+      if (numLevels <= numLevelsPerOctave ||
+          fabs (levels[numLevelsPerOctave].scale - 0.5) > 1e-12) {
+        VL_PRINTF("test_hog: error: bad number of levels or scales\n") ;
+        ++ numErrors ;
+      }
+
+      vl_free (simd) ;
+      vl_free (scalar) ;
+      vl_free (pyramid) ;
+      vl_free (levels) ;
+      vl_hog_delete (hog) ;
+    }
+  }
+
+  vl_free (image) ;
+
+  if (numErrors) {
+    VL_PRINTF("test_hog: %d errors\n", (int)numErrors) ;
+    return -1 ;
+  }
+  VL_PRINTF("test_hog: passed\n") ;
+  return 0 ;
+}
@@ -0,0 +1,168 @@
+/** @file   test_ivfpq.c
+ ** @brief  Test IVF-PQ search recall and save/load
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/ivfpq.h>
+#include <vl/mathop.h>
+#include <vl/random.h>
+
+#include <stdio.h>
+#include <string.h>
+
+int
+main (int argc, char** argv)
+{
+  char const * fileName = "test_ivfpq.bin" ;
+  vl_size numData = 20000 ;
+  vl_size dimension = 32 ;
+  vl_size numQueries = 200 ;
+  vl_size numNeighbors = 10 ;
+  vl_size numLists = 64 ;
+  vl_size numSubquantizers = 8 ;
+
+  VlRand rand ;
+  VlIVFPQ * index ;
+  VlIVFPQ * loaded ;
+  float * data ;
+  float * queries ;
+  float * distances ;
+  float * distances2 ;
+  vl_uint32 * indexes ;
+  vl_uint32 * indexes2 ;
+  vl_uint32 * truth ;
+  vl_size numHits = 0 ;
+  double recall ;
+  vl_uindex i, q, n ;
+
+  if (argc > 1) fileName = argv[1] ;
+
+  /* points near a low dimensional subspace, as real descriptors */
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1000) ;
+  data = vl_malloc (sizeof(float) * dimension * numData) ;
+  queries = vl_malloc (sizeof(float) * dimension * numQueries) ;
+  for (i = 0 ; i < numData + numQueries ; ++i) {
+    float * x = (i < numData) ? data + i * dimension : queries + (i - numData) * dimension ;
+    float a = (float) vl_rand_real1 (&rand) ;
+    float b = (float) vl_rand_real1 (&rand) ;
+    float c = (float) vl_rand_real1 (&rand) ;
+    for (n = 0 ; n < dimension ; ++n) {
+      x[n] = a * (n % 3) + b * (n % 5) + c * (n % 7) + 0.05f * (float) vl_rand_real1 (&rand) ;
+    }
+  }
+
+  /* exact nearest neighbors */
+  truth = vl_malloc (sizeof(vl_uint32) * numQueries) ;
+  vl_eval_l2_nearest_neighbors_f (truth, NULL, 1, dimension, queries, numQueries,
+                                  data, numData, NULL) ;
+
+  index = vl_ivfpq_new (dimension, numLists, numSubquantizers) ;
+  vl_ivfpq_set_num_probes (index, 8) ;
+  vl_ivfpq_set_max_num_iterations (index, 10) ;
+  vl_tic() ;
+  if (vl_ivfpq_build (index, data, numData)) {
+    VL_PRINTF("test_ivfpq: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  VL_PRINTF("test_ivfpq: build: %.3f [s]\n", vl_toc()) ;
+  vl_tic() ;
+  if (vl_ivfpq_add (index, data, numData / 2) ||
+      vl_ivfpq_add (index, data + dimension * (numData / 2), numData - numData / 2)) {
+    VL_PRINTF("test_ivfpq: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  VL_PRINTF("test_ivfpq: add: %.3f [s]\n", vl_toc()) ;
+
+  indexes = vl_malloc (sizeof(vl_uint32) * numNeighbors * numQueries) ;
+  indexes2 = vl_malloc (sizeof(vl_uint32) * numNeighbors * numQueries) ;
+  distances = vl_malloc (sizeof(float) * numNeighbors * numQueries) ;
+  distances2 = vl_malloc (sizeof(float) * numNeighbors * numQueries) ;
+
+  vl_tic() ;
+  if (vl_ivfpq_search (index, indexes, distances, numNeighbors, queries, numQueries)) {
+    VL_PRINTF("test_ivfpq: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  VL_PRINTF("test_ivfpq: search: %.3f [s]\n", vl_toc()) ;
+
+  for (q = 0 ; q < numQueries ; ++q) {
+    for (n = 0 ; n < numNeighbors ; ++n) {
+      if (indexes[q * numNeighbors + n] == truth[q]) { ++ numHits ; break ; }
+    }
+  }
+  recall = (double) numHits / numQueries ;
+  VL_PRINTF("test_ivfpq: recall@%d: %.3f\n", (int)numNeighbors, recall) ;
+
+  /* the scalar code must return the same result */
+  vl_set_simd_enabled (VL_FALSE) ;
+  vl_ivfpq_search (index, indexes2, distances2, numNeighbors, queries, numQueries) ;
+  vl_set_simd_enabled (VL_TRUE) ;
+  if (memcmp (indexes, indexes2, sizeof(vl_uint32) * numNeighbors * numQueries) ||
+      memcmp (distances, distances2, sizeof(float) * numNeighbors * numQueries)) {
+    VL_PRINTF("test_ivfpq: error: SIMD and scalar search differ\n") ;
+    return -1 ;
+  }
+
+  /* save and load */
+  if (vl_ivfpq_save (index, fileName)) {
+    VL_PRINTF("test_ivfpq: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  loaded = vl_ivfpq_load (fileName) ;
+  remove (fileName) ;
+  if (loaded == NULL) {
+    VL_PRINTF("test_ivfpq: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  memset (indexes2, 0, sizeof(vl_uint32) * numNeighbors * numQueries) ;
+  vl_ivfpq_search (loaded, indexes2, distances2, numNeighbors, queries, numQueries) ;
+  if (vl_ivfpq_get_num_data (loaded) != numData ||
+      memcmp (indexes, indexes2, sizeof(vl_uint32) * numNeighbors * numQueries) ||
+      memcmp (distances, distances2, sizeof(float) * numNeighbors * numQueries)) {
+    VL_PRINTF("test_ivfpq: error: loaded index differs\n") ;
+    return -1 ;
+  }
+
+  /* a header whose buffer sizes overflow must be rejected */
+  {
+    char const magic [8] = {'V','L','I','V','F','P','Q','1'} ;
+    vl_uint64 header [6] = {0, 1, 1, 0, 1, 1} ;
+    FILE * f = fopen (fileName, "wb") ;
+    VlIVFPQ * bad ;
+    header[0] = (vl_uint64)(vl_size)-1 / 4 + 1 ;
+    fwrite (magic, sizeof(magic), 1, f) ;
+    fwrite (header, sizeof(header), 1, f) ;
+    fclose (f) ;
+    bad = vl_ivfpq_load (fileName) ;
+    remove (fileName) ;
+    if (bad) {
+      VL_PRINTF("test_ivfpq: error: overflowing header accepted\n") ;
+      return -1 ;
+    }
+  }
+
+  vl_ivfpq_delete (index) ;
+  vl_ivfpq_delete (loaded) ;
+  vl_free (data) ;
+  vl_free (queries) ;
+  vl_free (truth) ;
+  vl_free (indexes) ;
+  vl_free (indexes2) ;
+  vl_free (distances) ;
+  vl_free (distances2) ;
+
+  if (recall < 0.8) {
+    VL_PRINTF("test_ivfpq: error: recall too low\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_ivfpq: passed\n") ;
+  return 0 ;
+}
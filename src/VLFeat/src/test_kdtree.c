@@ -0,0 +1,81 @@
+/** @file   test_kdtree.c
+ ** @brief  Test KD-forest exact search against brute force
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/kdtree.h>
+#include <vl/random.h>
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  vl_size numData = 5000 ;
+  vl_size dimension = 32 ;
+  vl_size numQueries = 100 ;
+  vl_size numNeighbors = 3 ;
+  vl_size leafSizes [] = {VL_KDTREE_DEFAULT_LEAF_SIZE, 8, 64} ;
+
+  VlRand * rand = vl_get_rand () ;
+  VlFloatVectorComparisonFunction distFn =
+    vl_get_vector_comparison_function_f (VlDistanceL2) ;
+  float * data = vl_malloc (sizeof(float) * dimension * numData) ;
+  float * queries = vl_malloc (sizeof(float) * dimension * numQueries) ;
+  float * distances = vl_malloc (sizeof(float) * numNeighbors * numQueries) ;
+  vl_uint32 * indexes = vl_malloc (sizeof(vl_uint32) * numNeighbors * numQueries) ;
+  float * best = vl_malloc (sizeof(float) * numQueries) ;
+  vl_uindex i, q, l ;
+  vl_size numErrors = 0 ;
+
+  for (i = 0 ; i < dimension * numData ; ++i) data[i] = (float) vl_rand_real1 (rand) ;
+  for (i = 0 ; i < dimension * numQueries ; ++i) queries[i] = (float) vl_rand_real1 (rand) ;
+
+  /* brute force */
+  for (q = 0 ; q < numQueries ; ++q) {
+    best[q] = (float) VL_INFINITY_D ;
+    for (i = 0 ; i < numData ; ++i) {
+      float d = distFn (dimension, queries + dimension * q, data + dimension * i) ;
+      if (d < best[q]) best[q] = d ;
+    }
+  }
+
+  for (l = 0 ; l < sizeof(leafSizes) / sizeof(leafSizes[0]) ; ++l) {
+    VlKDForest * forest = vl_kdforest_new (VL_TYPE_FLOAT, dimension, 4, VlDistanceL2) ;
+    vl_kdforest_set_leaf_size (forest, leafSizes[l]) ;
+    vl_kdforest_build (forest, numData, data) ;
+    vl_kdforest_query_with_array (forest, indexes, numNeighbors, numQueries,
+                                  distances, queries) ;
+    for (q = 0 ; q < numQueries ; ++q) {
+      float d = distFn (dimension, queries + dimension * q,
+                        data + dimension * indexes[numNeighbors * q]) ;
+      if (d != best[q] || distances[numNeighbors * q] != best[q] ||
+          distances[numNeighbors * q] > distances[numNeighbors * q + 1]) {
+        numErrors ++ ;
+      }
+    }
+    VL_PRINTF("test_kdtree: leaf size %d: %d nodes, %d errors\n",
+              (int)leafSizes[l],
+              (int)vl_kdforest_get_num_nodes_of_tree (forest, 0),
+              (int)numErrors) ;
+    vl_kdforest_delete (forest) ;
+  }
+
+  vl_free (data) ;
+  vl_free (queries) ;
+  vl_free (distances) ;
+  vl_free (indexes) ;
+  vl_free (best) ;
+
+  if (numErrors) {
+    VL_PRINTF("test_kdtree: error: exact search does not match brute force\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_kdtree: passed\n") ;
+  return 0 ;
+}
@@ -0,0 +1,139 @@
+/** @file   test_kmeans_mini_batch.c
+ ** @brief  Test mini-batch K-means on a memory mapped data file
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/kmeans.h>
+#include <vl/random.h>
+
+#include <stdio.h>
+#include <string.h>
+
+static double
+energy_of (VlKMeans * kmeans, float const * data, vl_size numData)
+{
+  vl_uint32 * assignments = vl_malloc (sizeof(vl_uint32) * numData) ;
+  float * distances = vl_malloc (sizeof(float) * numData) ;
+  double energy = 0 ;
+  vl_uindex i ;
+  vl_kmeans_quantize (kmeans, assignments, distances, data, numData) ;
+  for (i = 0 ; i < numData ; ++i) energy += distances[i] ;
+  vl_free (assignments) ;
+  vl_free (distances) ;
+  return energy ;
+}
+
+int
+main (int argc, char** argv)
+{
+  char const * fileName = "test_kmeans_mini_batch.bin" ;
+  vl_size numData = 50000 ;
+  vl_size dimension = 16 ;
+  vl_size numCenters = 20 ;
+  vl_size batchSize = 1000 ;
+  vl_size numEpochs = 3 ;
+
+  VlRand rand ;
+  VlKMeans * kmeans ;
+  VlKMeans * miniBatch ;
+  VlKMeansDataFile * file ;
+  float * data ;
+  float * blobs ;
+  double lloydEnergy, miniBatchEnergy ;
+  vl_uindex i, d, epoch ;
+  FILE * f ;
+
+  if (argc > 1) fileName = argv[1] ;
+
+  /* sample points around random blob centers */
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1000) ;
+  blobs = vl_malloc (sizeof(float) * dimension * numCenters) ;
+  data = vl_malloc (sizeof(float) * dimension * numData) ;
+  for (i = 0 ; i < dimension * numCenters ; ++i) {
+    blobs[i] = (float) (10 * vl_rand_real1 (&rand)) ;
+  }
+  for (i = 0 ; i < numData ; ++i) {
+    vl_uindex c = vl_rand_uindex (&rand, numCenters) ;
+    for (d = 0 ; d < dimension ; ++d) {
+      data[i * dimension + d] = blobs[c * dimension + d] + (float) vl_rand_real3 (&rand) ;
+    }
+  }
+
+  f = fopen (fileName, "wb") ;
+  if (f == NULL) {
+    VL_PRINTF("test_kmeans_mini_batch: error: could not write %s\n", fileName) ;
+    return -1 ;
+  }
+  fwrite (data, sizeof(float) * dimension, numData, f) ;
+  fclose (f) ;
+
+  /* the data file must return the points in order */
+  file = vl_kmeans_data_file_new (fileName, VL_TYPE_FLOAT, dimension) ;
+  if (file == NULL) {
+    VL_PRINTF("test_kmeans_mini_batch: error: %s\n", vl_get_last_error_message()) ;
+    return -1 ;
+  }
+  if (vl_kmeans_data_file_get_num_data (file) != numData) {
+    VL_PRINTF("test_kmeans_mini_batch: error: wrong number of points in the data file\n") ;
+    return -1 ;
+  }
+  {
+    void const * batch ;
+    vl_size n, numRead = 0 ;
+    while ((n = vl_kmeans_data_file_read (file, &batch, 777)) > 0) {
+      if (memcmp (batch, data + numRead * dimension, sizeof(float) * dimension * n)) {
+        VL_PRINTF("test_kmeans_mini_batch: error: data file content mismatch\n") ;
+        return -1 ;
+      }
+      numRead += n ;
+    }
+    if (numRead != numData) {
+      VL_PRINTF("test_kmeans_mini_batch: error: read %d points\n", (int)numRead) ;
+      return -1 ;
+    }
+  }
+
+  /* reference: Lloyd in memory, starting from the same centers */
+  kmeans = vl_kmeans_new (VL_TYPE_FLOAT, VlDistanceL2) ;
+  vl_kmeans_init_centers_plus_plus (kmeans, data, dimension, numData, numCenters) ;
+  miniBatch = vl_kmeans_new_copy (kmeans) ;
+  vl_kmeans_set_max_num_iterations (kmeans, 100) ;
+  vl_tic() ;
+  vl_kmeans_refine_centers (kmeans, data, numData) ;
+  lloydEnergy = energy_of (kmeans, data, numData) ;
+  VL_PRINTF("test_kmeans_mini_batch: Lloyd: energy %g in %.3f [s]\n",
+            lloydEnergy, vl_toc()) ;
+  vl_kmeans_delete (kmeans) ;
+
+  /* mini-batch from the file */
+  vl_tic() ;
+  for (epoch = 0 ; epoch < numEpochs ; ++epoch) {
+    vl_kmeans_data_file_rewind (file) ;
+    vl_kmeans_cluster_mini_batch (miniBatch, vl_kmeans_data_file_read, file,
+                                  dimension, numCenters, batchSize) ;
+  }
+  miniBatchEnergy = energy_of (miniBatch, data, numData) ;
+  VL_PRINTF("test_kmeans_mini_batch: mini-batch: energy %g in %.3f [s]\n",
+            miniBatchEnergy, vl_toc()) ;
+  vl_kmeans_delete (miniBatch) ;
+  vl_kmeans_data_file_delete (file) ;
+  remove (fileName) ;
+
+  vl_free (data) ;
+  vl_free (blobs) ;
+
+  if (miniBatchEnergy > 1.05 * lloydEnergy) {
+    VL_PRINTF("test_kmeans_mini_batch: error: mini-batch energy too large\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_kmeans_mini_batch: passed\n") ;
+  return 0 ;
+}
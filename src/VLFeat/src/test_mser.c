@@ -0,0 +1,153 @@
+/** @file   test_mser.c
+ ** @brief  Test MSER polarity, 16 bit images, and ellipsoids
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/mser.h>
+#include <vl/random.h>
+
+#include <math.h>
+#include <string.h>
+
+#define W 160
+#define H 120
+
+static vl_bool
+same_results (VlMserFilt * f, VlMserFilt * g)
+{
+  vl_size n = vl_mser_get_regions_num (f) ;
+  vl_size dof = vl_mser_get_ell_dof (f) ;
+  if (n != vl_mser_get_regions_num (g)) return VL_FALSE ;
+  if (memcmp (vl_mser_get_regions (f), vl_mser_get_regions (g),
+              sizeof(vl_uint) * n)) return VL_FALSE ;
+  vl_mser_ell_fit (f) ;
+  vl_mser_ell_fit (g) ;
+  return memcmp (vl_mser_get_ell (f), vl_mser_get_ell (g),
+                 sizeof(float) * dof * n) == 0 ;
+}
+
+/* fit the ellipse of the region of the seed by brute force */
+static double
+ell_error (vl_uint8 const * im, vl_uint seed, float const * ell)
+{
+  static vl_uint stack [W*H] ;
+  static vl_uint8 visited [W*H] ;
+  double m [5] = {0,0,0,0,0} ;
+  double area = 0, err = 0, mu [5] ;
+  vl_size top = 0 ;
+  int k ;
+
+  memset (visited, 0, sizeof(visited)) ;
+  stack [top++] = seed ;
+  visited [seed] = 1 ;
+  while (top) {
+    vl_uint p = stack [--top] ;
+    int x = p % W, y = p / W, dx, dy ;
+    area += 1 ;
+    m[0] += x ; m[1] += y ; m[2] += x*x ; m[3] += x*y ; m[4] += y*y ;
+    for (dy = -1 ; dy <= 1 ; ++dy) {
+      for (dx = -1 ; dx <= 1 ; ++dx) {
+        int q = (y + dy) * W + x + dx ;
+        if (x + dx < 0 || x + dx >= W || y + dy < 0 || y + dy >= H) continue ;
+        if (visited [q] || im [q] > im [seed]) continue ;
+        visited [q] = 1 ;
+        stack [top++] = q ;
+      }
+    }
+  }
+  for (k = 0 ; k < 5 ; ++k) m[k] /= area ;
+  mu[0] = m[0] ;
+  mu[1] = m[1] ;
+  mu[2] = m[2] - m[0] * m[0] ;
+  mu[3] = m[3] - m[0] * m[1] ;
+  mu[4] = m[4] - m[1] * m[1] ;
+  for (k = 0 ; k < 5 ; ++k) {
+    err = VL_MAX(err, fabs (mu[k] - ell[k]) / (fabs (mu[k]) + 1)) ;
+  }
+  return err ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static vl_uint8 im [W*H] ;
+  static vl_uint8 imInv [W*H] ;
+  static vl_uint16 im16 [W*H] ;
+  int dims [2] = {W, H} ;
+  VlMserFilt * f = vl_mser_new (2, dims) ;
+  VlMserFilt * g = vl_mser_new (2, dims) ;
+  VlMserFilt * h = vl_mser_new (2, dims) ;
+  VlMserFilt * k = vl_mser_new (2, dims) ;
+  VlRand rand ;
+  vl_size numRegions, numBright ;
+  double err = 0 ;
+  vl_uindex i ;
+
+  /* blobs over a noisy background */
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (i = 0 ; i < W*H ; ++i) {
+    double x = (double) (i % W), y = (double) (i / W) ;
+    double v = 128 + 80 * sin (x / 9.0) * cos (y / 7.0) + 20 * vl_rand_real1 (&rand) ;
+    im [i] = (vl_uint8) VL_MAX(0, VL_MIN(255, v)) ;
+    imInv [i] = (vl_uint8) (255 - im [i]) ;
+    im16 [i] = im [i] ;
+  }
+
+  /* polarity: bright regions are the dark regions of the inverse */
+  vl_mser_set_bright_on_dark (g, VL_TRUE) ;
+  vl_mser_process (g, im) ;
+  vl_mser_process (h, imInv) ;
+  numBright = vl_mser_get_regions_num (g) ;
+  if (! same_results (g, h)) {
+    VL_PRINTF("test_mser: error: bright on dark differs from inverted image\n") ;
+    return -1 ;
+  }
+
+  /* pair: same as processing the two filters separately */
+  vl_mser_process_pair (f, g, im) ;
+  vl_mser_process (k, im) ;
+  numRegions = vl_mser_get_regions_num (f) ;
+  if (! same_results (f, k) || ! same_results (g, h)) {
+    VL_PRINTF("test_mser: error: pair processing differs\n") ;
+    return -1 ;
+  }
+
+  /* 16 bit: same as 8 bit for the same values */
+  vl_mser_process_pair_ui16 (h, k, im16) ;
+  vl_mser_set_bright_on_dark (k, VL_TRUE) ;
+  vl_mser_process_ui16 (k, im16) ;
+  if (! same_results (f, h) || ! same_results (g, k)) {
+    VL_PRINTF("test_mser: error: 16 bit processing differs\n") ;
+    return -1 ;
+  }
+
+  /* ellipsoids: compare with brute force */
+  vl_mser_ell_fit (f) ;
+  for (i = 0 ; i < numRegions ; ++i) {
+    err = VL_MAX(err, ell_error (im, vl_mser_get_regions (f)[i],
+                                 vl_mser_get_ell (f) + 5 * i)) ;
+  }
+
+  VL_PRINTF("test_mser: %d dark and %d bright regions, ellipse error %g\n",
+            (int)numRegions, (int)numBright, err) ;
+
+  vl_mser_delete (f) ;
+  vl_mser_delete (g) ;
+  vl_mser_delete (h) ;
+  vl_mser_delete (k) ;
+
+  if (numRegions == 0 || numBright == 0 || err > 1e-5) {
+    VL_PRINTF("test_mser: error: wrong ellipsoids\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_mser: passed\n") ;
+  return 0 ;
+}
@@ -0,0 +1,255 @@
+/** @file   test_parallel.c
+ ** @brief  Test parallel loops and parallel backends
+ **/
+
+/*
+Copyright (C) 2013 Andrea Vedaldi.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/generic.h>
+#include <vl/kmeans.h>
+#include <vl/mathop.h>
+#include <vl/gmm.h>
+#include <vl/random.h>
+
+#include <string.h>
+
+#define N 100000
+#define NUM_TASKS 37
+#define DIMENSION 16
+#define NUM_DATA 2000
+#define NUM_CENTERS 10
+
+/* mark the iterations of a task and check the ranges */
+typedef struct _Marks
+{
+  vl_uint32 * marks ;
+  vl_uindex begins [NUM_TASKS] ;
+  vl_uindex ends [NUM_TASKS] ;
+  vl_size calls [NUM_TASKS] ;
+} Marks ;
+
+static void
+mark (void * data, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  Marks * m = data ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) m->marks[i] += (vl_uint32)task + 1 ;
+  m->begins[task] = begin ;
+  m->ends[task] = end ;
+  m->calls[task] ++ ;
+}
+
+static vl_bool
+check_marks (Marks * m, vl_size numTasks)
+{
+  vl_uindex t, i ;
+  for (t = 0 ; t < numTasks ; ++t) {
+    if (m->calls[t] != 1) return VL_FALSE ;
+    if (t > 0 && m->begins[t] != m->ends[t-1]) return VL_FALSE ;
+    for (i = m->begins[t] ; i < m->ends[t] ; ++i) {
+      if (m->marks[i] != t + 1) return VL_FALSE ;
+    }
+  }
+  return m->begins[0] == 0 && m->ends[numTasks-1] == N ;
+}
+
+/* a nested loop must run sequentially and completely */
+static void
+nested (void * data, vl_uindex task, vl_uindex begin VL_UNUSED, vl_uindex end VL_UNUSED)
+{
+  Marks * m = (Marks*)data + task ;
+  memset (m->calls, 0, sizeof(m->calls)) ;
+  memset (m->marks, 0, sizeof(vl_uint32) * N) ;
+  vl_parallel_for (N, NUM_TASKS, mark, m) ;
+}
+
+/* a backend that runs the jobs only when they are waited for */
+typedef struct _Deferred
+{
+  vl_size numSubmitted ;
+  vl_size numRun ;
+} Deferred ;
+
+typedef struct _DeferredJob
+{
+  VlParallelJobFunction function ;
+  void * data ;
+} DeferredJob ;
+
+static void *
+deferred_submit (void * context, VlParallelJobFunction function, void * data)
+{
+  Deferred * deferred = context ;
+  DeferredJob * job = vl_malloc (sizeof(DeferredJob)) ;
+  job->function = function ;
+  job->data = data ;
+  deferred->numSubmitted ++ ;
+  return job ;
+}
+
+static void
+deferred_wait (void * context, void * job_)
+{
+  Deferred * deferred = context ;
+  DeferredJob * job = job_ ;
+  job->function (job->data) ;
+  deferred->numRun ++ ;
+  vl_free (job) ;
+}
+
+/* train K-means and a GMM and store the results */
+static double
+train (float const * data, float * centers, float * means)
+{
+  VlKMeans * kmeans = vl_kmeans_new (VL_TYPE_FLOAT, VlDistanceL2) ;
+  VlGMM * gmm = vl_gmm_new (VL_TYPE_FLOAT, DIMENSION, NUM_CENTERS) ;
+  double LL ;
+
+  vl_rand_seed (vl_get_rand(), 0) ;
+  vl_kmeans_set_algorithm (kmeans, VlKMeansElkan) ;
+  vl_kmeans_set_max_num_iterations (kmeans, 20) ;
+  vl_kmeans_init_centers_plus_plus (kmeans, data, DIMENSION, NUM_DATA, NUM_CENTERS) ;
+  vl_kmeans_refine_centers (kmeans, data, NUM_DATA) ;
+  memcpy (centers, vl_kmeans_get_centers (kmeans), sizeof(float) * DIMENSION * NUM_CENTERS) ;
+
+  vl_gmm_set_max_num_iterations (gmm, 20) ;
+  vl_gmm_set_initialization (gmm, VlGMMCustom) ;
+  vl_gmm_set_means (gmm, centers) ;
+  {
+    float covariances [DIMENSION * NUM_CENTERS] ;
+    float priors [NUM_CENTERS] ;
+    vl_uindex i ;
+    for (i = 0 ; i < DIMENSION * NUM_CENTERS ; ++i) covariances[i] = 1 ;
+    for (i = 0 ; i < NUM_CENTERS ; ++i) priors[i] = 1.0f / NUM_CENTERS ;
+    vl_gmm_set_covariances (gmm, covariances) ;
+    vl_gmm_set_priors (gmm, priors) ;
+  }
+  vl_gmm_cluster (gmm, data, NUM_DATA) ;
+  memcpy (means, vl_gmm_get_means (gmm), sizeof(float) * DIMENSION * NUM_CENTERS) ;
+  LL = vl_gmm_get_loglikelihood (gmm) ;
+
+  vl_gmm_delete (gmm) ;
+  vl_kmeans_delete (kmeans) ;
+  return LL ;
+}
+
+/* cluster with an L2 K-means algorithm and store the centers */
+static void
+cluster (float const * data, VlKMeansAlgorithm algorithm, float * centers)
+{
+  VlKMeans * kmeans = vl_kmeans_new (VL_TYPE_FLOAT, VlDistanceL2) ;
+  vl_rand_seed (vl_get_rand(), 0) ;
+  vl_kmeans_set_algorithm (kmeans, algorithm) ;
+  vl_kmeans_set_max_num_iterations (kmeans, 20) ;
+  vl_kmeans_init_centers_plus_plus (kmeans, data, DIMENSION, NUM_DATA, NUM_CENTERS) ;
+  vl_kmeans_refine_centers (kmeans, data, NUM_DATA) ;
+  memcpy (centers, vl_kmeans_get_centers (kmeans), sizeof(float) * DIMENSION * NUM_CENTERS) ;
+  vl_kmeans_delete (kmeans) ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static vl_uint32 marks [4][N] ;
+  static Marks m [4] ;
+  static float data [DIMENSION * NUM_DATA] ;
+  static float centers [DIMENSION * NUM_CENTERS], refCenters [DIMENSION * NUM_CENTERS] ;
+  static float means [DIMENSION * NUM_CENTERS], refMeans [DIMENSION * NUM_CENTERS] ;
+  Deferred deferred = {0, 0} ;
+  vl_bool loops = VL_TRUE ;
+  vl_bool same = VL_TRUE ;
+  double LL, refLL ;
+  VlRand rand ;
+  vl_uindex i, t ;
+
+  for (t = 0 ; t < 4 ; ++t) m[t].marks = marks[t] ;
+
+  /* built-in pool, more tasks than threads */
+  vl_set_num_threads (4) ;
+  vl_parallel_for (N, NUM_TASKS, mark, &m[0]) ;
+  loops &= check_marks (&m[0], NUM_TASKS) ;
+
+  /* nested loops */
+  vl_parallel_for (4, 4, nested, m) ;
+  for (t = 0 ; t < 4 ; ++t) loops &= check_marks (&m[t], NUM_TASKS) ;
+
+  /* custom backend: the calling thread does all the work */
+  vl_set_parallel_backend (deferred_submit, deferred_wait, &deferred) ;
+  memset (marks[0], 0, sizeof(marks[0])) ;
+  memset (m[0].calls, 0, sizeof(m[0].calls)) ;
+  vl_parallel_for (N, NUM_TASKS, mark, &m[0]) ;
+  loops &= check_marks (&m[0], NUM_TASKS) ;
+  loops &= (deferred.numSubmitted == 3 && deferred.numRun == 3) ;
+  vl_set_parallel_backend (NULL, NULL, NULL) ;
+
+  /* the number of threads may change the rounding of the GMM sums
+     but not K-means; the backend may change neither */
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (i = 0 ; i < NUM_DATA ; ++i) {
+    vl_uindex label = vl_rand_uint32 (&rand) % NUM_CENTERS ;
+    vl_uindex d ;
+    for (d = 0 ; d < DIMENSION ; ++d) {
+      data[i * DIMENSION + d] = (float) (4 * ((label * 7 + d) % 5) + vl_rand_real1 (&rand)) ;
+    }
+  }
+  vl_set_num_threads (1) ;
+  train (data, refCenters, means) ;
+  vl_set_num_threads (4) ;
+  refLL = train (data, centers, refMeans) ;
+  same &= memcmp (refCenters, centers, sizeof(centers)) == 0 ;
+  vl_set_parallel_backend (deferred_submit, deferred_wait, &deferred) ;
+  LL = train (data, centers, means) ;
+  same &= memcmp (refCenters, centers, sizeof(centers)) == 0 ;
+  same &= memcmp (refMeans, means, sizeof(means)) == 0 ;
+  same &= (refLL == LL) ;
+  vl_set_parallel_backend (NULL, NULL, NULL) ;
+
+  /* Lloyd (l2 nearest neighbors) and ANN K-means through the backend */
+  for (t = 0 ; t < 2 ; ++t) {
+    VlKMeansAlgorithm algorithm = (t == 0) ? VlKMeansLloyd : VlKMeansANN ;
+    vl_size numSubmitted = deferred.numSubmitted ;
+    vl_set_num_threads (1) ;
+    cluster (data, algorithm, refCenters) ;
+    vl_set_num_threads (4) ;
+    vl_set_parallel_backend (deferred_submit, deferred_wait, &deferred) ;
+    cluster (data, algorithm, centers) ;
+    vl_set_parallel_backend (NULL, NULL, NULL) ;
+    same &= memcmp (refCenters, centers, sizeof(centers)) == 0 ;
+    loops &= (deferred.numSubmitted > numSubmitted &&
+              deferred.numRun == deferred.numSubmitted) ;
+  }
+
+  /* l2 nearest neighbors alone */
+  {
+    static vl_uint32 indexes [NUM_DATA], refIndexes [NUM_DATA] ;
+    vl_size numSubmitted = deferred.numSubmitted ;
+    vl_set_num_threads (1) ;
+    vl_eval_l2_nearest_neighbors_f (refIndexes, NULL, 1, DIMENSION,
+                                    data, NUM_DATA, refCenters, NUM_CENTERS, NULL) ;
+    vl_set_num_threads (4) ;
+    vl_set_parallel_backend (deferred_submit, deferred_wait, &deferred) ;
+    vl_eval_l2_nearest_neighbors_f (indexes, NULL, 1, DIMENSION,
+                                    data, NUM_DATA, refCenters, NUM_CENTERS, NULL) ;
+    vl_set_parallel_backend (NULL, NULL, NULL) ;
+    same &= memcmp (refIndexes, indexes, sizeof(indexes)) == 0 ;
+    loops &= (deferred.numSubmitted == numSubmitted + 3 &&
+              deferred.numRun == deferred.numSubmitted) ;
+  }
+
+  if (! loops) {
+    VL_PRINTF("test_parallel: error: wrong parallel loop\n") ;
+    return -1 ;
+  }
+  if (! same) {
+    VL_PRINTF("test_parallel: error: threads or backend changed the result\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_parallel: passed\n") ;
+  return 0 ;
+}
@@ -0,0 +1,134 @@
+/** @file   test_quickshift.c
+ ** @brief  Test quick shift with threads, float data, and truncation
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/quickshift.h>
+#include <vl/random.h>
+
+#include <math.h>
+#include <string.h>
+
+#define N1 101
+#define N2 87
+#define K 3
+
+/* run quick shift and return the object */
+static VlQS *
+run (double const * image, float const * imagef,
+     VlQSDensityApproximation approximation, vl_bool medoid)
+{
+  VlQS * q = image ?
+    vl_quickshift_new (image, N1, N2, K) :
+    vl_quickshift_new_f (imagef, N1, N2, K) ;
+  vl_quickshift_set_kernel_size (q, 2) ;
+  vl_quickshift_set_max_dist (q, 6) ;
+  vl_quickshift_set_medoid (q, medoid) ;
+  vl_quickshift_set_density_approximation (q, approximation) ;
+  if (vl_quickshift_process (q)) {
+    VL_PRINTF("test_quickshift: error: %s\n", vl_get_last_error_message ()) ;
+    exit (1) ;
+  }
+  return q ;
+}
+
+static vl_bool
+same_results (VlQS * q, VlQS * r)
+{
+  return
+    memcmp (vl_quickshift_get_parents (q), vl_quickshift_get_parents (r),
+            sizeof(int) * N1 * N2) == 0 &&
+    memcmp (vl_quickshift_get_dists (q), vl_quickshift_get_dists (r),
+            sizeof(vl_qs_type) * N1 * N2) == 0 &&
+    memcmp (vl_quickshift_get_density (q), vl_quickshift_get_density (r),
+            sizeof(vl_qs_type) * N1 * N2) == 0 ;
+}
+
+/* each parent must be a root or increase the density within tau */
+static vl_bool
+valid_tree (VlQS * q)
+{
+  int const * parents = vl_quickshift_get_parents (q) ;
+  vl_qs_type const * dists = vl_quickshift_get_dists (q) ;
+  vl_qs_type const * E = vl_quickshift_get_density (q) ;
+  int i ;
+  for (i = 0 ; i < N1 * N2 ; ++i) {
+    if (parents [i] == i) {
+      if (dists [i] != VL_QS_INF) return VL_FALSE ;
+    } else {
+      if (parents [i] < 0 || parents [i] >= N1 * N2) return VL_FALSE ;
+      if (E [parents [i]] <= E [i]) return VL_FALSE ;
+      if (dists [i] > vl_quickshift_get_max_dist (q)) return VL_FALSE ;
+    }
+  }
+  return VL_TRUE ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static double image [N1*N2*K] ;
+  static float imagef [N1*N2*K] ;
+  VlQS *q, *r, *t, *f ;
+  VlRand rand ;
+  double truncErr = 0, floatErr = 0 ;
+  vl_bool same = VL_TRUE ;
+  vl_bool valid = VL_TRUE ;
+  int i ;
+
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (i = 0 ; i < N1*N2*K ; ++i) {
+    double x = (double) (i % N1), y = (double) ((i / N1) % N2) ;
+    int k = i / (N1*N2) ;
+    image [i] = 20 * sin (x / (5.0 + k)) * cos (y / 7.0) + 5 * vl_rand_real1 (&rand) ;
+    imagef [i] = (float) image [i] ;
+  }
+
+  /* threads must not change the result */
+  vl_set_num_threads (1) ;
+  q = run (image, NULL, VlQSDensityExact, VL_FALSE) ;
+  r = run (image, NULL, VlQSDensityExact, VL_TRUE) ;
+  vl_set_num_threads (0) ;
+  t = run (image, NULL, VlQSDensityExact, VL_FALSE) ;
+  same &= same_results (q, t) ;
+  vl_quickshift_delete (t) ;
+  t = run (image, NULL, VlQSDensityExact, VL_TRUE) ;
+  same &= same_results (r, t) ;
+  vl_quickshift_delete (t) ;
+  vl_quickshift_delete (r) ;
+
+  /* float and truncated densities: close to the exact one */
+  f = run (NULL, imagef, VlQSDensityExact, VL_FALSE) ;
+  t = run (image, NULL, VlQSDensityTruncated, VL_FALSE) ;
+  valid &= valid_tree (q) && valid_tree (f) && valid_tree (t) ;
+  for (i = 0 ; i < N1*N2 ; ++i) {
+    double e = vl_quickshift_get_density (q) [i] ;
+    floatErr = VL_MAX(floatErr, fabs (vl_quickshift_get_density (f) [i] - e) / e) ;
+    truncErr = VL_MAX(truncErr, (vl_quickshift_get_density (t) [i] - e) / e) ;
+  }
+  vl_quickshift_delete (f) ;
+  vl_quickshift_delete (t) ;
+  vl_quickshift_delete (q) ;
+
+  VL_PRINTF("test_quickshift: float error %g, truncation excess %g\n",
+            floatErr, truncErr) ;
+
+  if (! same) {
+    VL_PRINTF("test_quickshift: error: threads changed the result\n") ;
+    return -1 ;
+  }
+  if (! valid || floatErr > 1e-4 || truncErr > 1e-5) {
+    VL_PRINTF("test_quickshift: error: wrong trees or densities\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_quickshift: passed\n") ;
+  return 0 ;
+}
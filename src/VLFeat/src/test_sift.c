@@ -0,0 +1,117 @@
+/** @file   test_sift.c
+ ** @brief  Test vl_sift_extract_all against the incremental SIFT API
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/generic.h>
+#include <vl/pgm.h>
+#include <vl/sift.h>
+
+#include <math.h>
+#include <string.h>
+
+int
+main (int argc, char** argv)
+{
+  int width = 320 ;
+  int height = 240 ;
+
+  vl_sift_pix * image ;
+  VlSiftFilt * filt ;
+  double * frames ;
+  vl_sift_pix * descrs ;
+  vl_size numFeatures, numSerial = 0, numErrors = 0 ;
+  int x, y, err ;
+
+  if (argc < 2) {
+    image = vl_malloc (sizeof(vl_sift_pix) * width * height) ;
+    for (y = 0 ; y < height ; ++y) {
+      for (x = 0  ; x < width ; ++x) {
+        double dx = (x % 40) - 20 ;
+        double dy = (y % 40) - 20 ;
+        image [x + width * y] = (vl_sift_pix)
+          (128.0 * exp (- (dx*dx + dy*dy) / (2.0 * (3 + (x / 40)) * (3 + (y / 40))))
+           + 32.0 * ((x * 7 + y * 13) % 5)) ;
+      }
+    }
+  } else {
+    VlPgmImage im ;
+    err = vl_pgm_read_new_f (argv[1], &im, &image) ;
+    if (err) {
+      VL_PRINTF("test_sift: error: %s (%d)\n",
+                vl_get_last_error_message(),
+                vl_get_last_error()) ;
+      return -1 ;
+    }
+    width = im.width ;
+    height = im.height ;
+  }
+
+  VL_PRINTF("test_sift: width: %d, height: %d, threads: %d\n",
+            width, height, (int)vl_get_max_threads()) ;
+
+  filt = vl_sift_new (width, height, -1, 3, -1) ;
+
+  vl_tic() ;
+  numFeatures = vl_sift_extract_all (filt, image, &frames, &descrs) ;
+  VL_PRINTF("test_sift: vl_sift_extract_all: %d features in %.3f [s]\n",
+            (int)numFeatures, vl_toc()) ;
+
+  /* run the incremental API serially and compare */
+  {
+    vl_size numThreads = vl_get_max_threads() ;
+    vl_set_num_threads (1) ;
+    vl_tic() ;
+    err = vl_sift_process_first_octave (filt, image) ;
+    while (err != VL_ERR_EOF) {
+      VlSiftKeypoint const * keys ;
+      int i, nkeys ;
+      vl_sift_detect (filt) ;
+      keys = vl_sift_get_keypoints (filt) ;
+      nkeys = vl_sift_get_nkeypoints (filt) ;
+      for (i = 0 ; i < nkeys ; ++i) {
+        double angles [4] ;
+        int q, nangles ;
+        nangles = vl_sift_calc_keypoint_orientations (filt, angles, keys + i) ;
+        for (q = 0 ; q < nangles ; ++q) {
+          vl_sift_pix descr [128] ;
+          vl_sift_calc_keypoint_descriptor (filt, descr, keys + i, angles [q]) ;
+          if (numSerial < numFeatures) {
+            double const * frame = frames + 4 * numSerial ;
+            if (frame [0] != keys [i].x ||
+                frame [1] != keys [i].y ||
+                frame [2] != keys [i].sigma ||
+                frame [3] != angles [q] ||
+                memcmp (descrs + 128 * numSerial, descr, sizeof(descr))) {
+              ++ numErrors ;
+            }
+          }
+          ++ numSerial ;
+        }
+      }
+      err = vl_sift_process_next_octave (filt) ;
+    }
+    VL_PRINTF("test_sift: serial loop: %d features in %.3f [s]\n",
+              (int)numSerial, vl_toc()) ;
+    vl_set_num_threads (numThreads) ;
+  }
+
+  if (numSerial != numFeatures || numErrors) {
+    VL_PRINTF("test_sift: error: %d features differ\n", (int)numErrors) ;
+    return -1 ;
+  }
+  VL_PRINTF("test_sift: features match\n") ;
+
+  vl_free (frames) ;
+  vl_free (descrs) ;
+  vl_free (image) ;
+  vl_sift_delete (filt) ;
+  return 0 ;
+}
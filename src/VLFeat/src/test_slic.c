@@ -0,0 +1,82 @@
+/** @file   test_slic.c
+ ** @brief  Test SLIC with and without SIMD and threads
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/slic.h>
+#include <vl/random.h>
+
+#include <math.h>
+#include <string.h>
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  vl_size const width = 203 ;
+  vl_size const height = 157 ;
+  vl_size const numChannels = 3 ;
+  vl_size const regionSize = 13 ;
+  vl_size const numRegions = 16 * 13 ;
+  vl_size const numPixels = width * height ;
+  float * image = vl_malloc (sizeof(float) * numPixels * numChannels) ;
+  vl_uint32 * reference = vl_malloc (sizeof(vl_uint32) * numPixels) ;
+  vl_uint32 * segmentation = vl_malloc (sizeof(vl_uint32) * numPixels) ;
+  VlRand rand ;
+  vl_uindex i, k ;
+  vl_bool same = VL_TRUE ;
+  vl_bool valid = VL_TRUE ;
+
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (k = 0 ; k < numChannels ; ++k) {
+    for (i = 0 ; i < numPixels ; ++i) {
+      double x = (double) (i % width), y = (double) (i / width) ;
+      image[i + k * numPixels] = (float)
+        (50 * sin (x / (7.0 + k)) * cos (y / 11.0) + 10 * vl_rand_real1 (&rand)) ;
+    }
+  }
+
+  /* reference: no SIMD, one thread */
+  vl_set_simd_enabled (VL_FALSE) ;
+  vl_set_num_threads (1) ;
+  vl_slic_segment (reference, image, width, height, numChannels,
+                   regionSize, 0.5f, 10) ;
+  for (i = 0 ; i < numPixels ; ++i) {
+    valid &= (reference[i] < numRegions) ;
+  }
+
+  /* SIMD and threads must not change the result */
+  vl_set_simd_enabled (VL_TRUE) ;
+  vl_set_num_threads (0) ;
+  vl_slic_segment (segmentation, image, width, height, numChannels,
+                   regionSize, 0.5f, 10) ;
+  same &= memcmp (reference, segmentation, sizeof(vl_uint32) * numPixels) == 0 ;
+
+  vl_set_simd_enabled (VL_FALSE) ;
+  vl_slic_segment (segmentation, image, width, height, numChannels,
+                   regionSize, 0.5f, 10) ;
+  vl_set_simd_enabled (VL_TRUE) ;
+  same &= memcmp (reference, segmentation, sizeof(vl_uint32) * numPixels) == 0 ;
+
+  vl_free (image) ;
+  vl_free (reference) ;
+  vl_free (segmentation) ;
+
+  if (! valid) {
+    VL_PRINTF("test_slic: error: invalid labels\n") ;
+    return -1 ;
+  }
+  if (! same) {
+    VL_PRINTF("test_slic: error: SIMD or threads changed the segmentation\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_slic: passed\n") ;
+  return 0 ;
+}
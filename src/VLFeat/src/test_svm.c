@@ -0,0 +1,179 @@
+/** @file   test_svm.c
+ ** @brief  Test mini-batch and concurrent SVM training
+ **/
+
+/*
+Copyright (C) 2013 Andrea Vedaldi.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#include <vl/svm.h>
+#include <vl/random.h>
+
+#include <math.h>
+#include <string.h>
+
+#define DIMENSION 37
+#define NUM_DATA 500
+#define NUM_CLASSES 4
+
+/* train one SVM per class (one-vs-rest) and store the models */
+static int
+train (float const * data, double const * labels,
+       VlSvmSolverType solver, vl_size batchSize, vl_bool many,
+       double * models, double * biases)
+{
+  VlSvmDataset * dataset = vl_svmdataset_new (VL_TYPE_FLOAT, (void*)data, DIMENSION, NUM_DATA) ;
+  VlSvm * svms [NUM_CLASSES] ;
+  vl_uindex c ;
+  int error = VL_ERR_OK ;
+
+  vl_rand_seed (vl_get_rand(), 0) ;
+  for (c = 0 ; c < NUM_CLASSES ; ++c) {
+    svms[c] = vl_svm_new_with_dataset (solver, dataset, labels + c * NUM_DATA, 0.01) ;
+    vl_svm_set_batch_size (svms[c], batchSize) ;
+    vl_svm_set_max_num_iterations (svms[c], 20 * NUM_DATA) ;
+    vl_svm_set_epsilon (svms[c], 0) ;
+  }
+  if (many) {
+    error |= vl_svm_train_many (svms, NUM_CLASSES) ;
+  }
+  for (c = 0 ; c < NUM_CLASSES ; ++c) {
+    if (! many) error |= vl_svm_train (svms[c]) ;
+    memcpy (models + c * DIMENSION, vl_svm_get_model (svms[c]), sizeof(double) * DIMENSION) ;
+    biases[c] = vl_svm_get_bias (svms[c]) ;
+    vl_svm_delete (svms[c]) ;
+  }
+  vl_svmdataset_delete (dataset) ;
+  return error ;
+}
+
+/* compare the kernel map inner product with an explicit expansion;
+   the map is larger than the buffer of the dataset functions */
+static vl_bool
+check_kernel_map (float const * data)
+{
+  VlHomogeneousKernelMap * hom = vl_homogeneouskernelmap_new
+    (VlHomogeneousKernelChi2, 1.0, 40, -1, VlHomogeneousKernelMapWindowRectangular) ;
+  vl_size homDimension = vl_homogeneouskernelmap_get_dimension (hom) ;
+  VlSvmDataset * dataset = vl_svmdataset_new (VL_TYPE_FLOAT, (void*)data, DIMENSION, 1) ;
+  double * model = vl_calloc (DIMENSION * homDimension, sizeof(double)) ;
+  float * expanded = vl_malloc (sizeof(float) * DIMENSION * homDimension) ;
+  double inner, expected = 0 ;
+  vl_uindex d ;
+  vl_bool ok ;
+
+  vl_svmdataset_set_homogeneous_kernel_map (dataset, hom) ;
+  for (d = 0 ; d < DIMENSION ; ++d) {
+    vl_homogeneouskernelmap_evaluate_f (hom, expanded + d * homDimension, 1, data[d]) ;
+  }
+  vl_svmdataset_get_accumulate_function (dataset) (dataset, 0, model, 1.0) ;
+  ok = homDimension > 64 ;
+  for (d = 0 ; d < DIMENSION * homDimension ; ++d) {
+    ok &= (model[d] == expanded[d]) ;
+    expected += (double)expanded[d] * expanded[d] ;
+  }
+  inner = vl_svmdataset_get_inner_product_function (dataset) (dataset, 0, model) ;
+  ok &= fabs (inner - expected) <= 1e-9 * expected ;
+
+  vl_free (model) ;
+  vl_free (expanded) ;
+  vl_svmdataset_delete (dataset) ;
+  vl_homogeneouskernelmap_delete (hom) ;
+  return ok ;
+}
+
+/* fraction of correctly classified training samples */
+static double
+accuracy (float const * data, double const * labels,
+          double const * models, double const * biases)
+{
+  vl_uindex c, i, d ;
+  vl_size numCorrect = 0 ;
+  for (c = 0 ; c < NUM_CLASSES ; ++c) {
+    for (i = 0 ; i < NUM_DATA ; ++i) {
+      double score = biases[c] ;
+      for (d = 0 ; d < DIMENSION ; ++d) {
+        score += models[c * DIMENSION + d] * data[i * DIMENSION + d] ;
+      }
+      numCorrect += (score * labels[c * NUM_DATA + i] > 0) ;
+    }
+  }
+  return (double) numCorrect / (NUM_CLASSES * NUM_DATA) ;
+}
+
+int
+main (int argc VL_UNUSED, char** argv VL_UNUSED)
+{
+  static float data [DIMENSION * NUM_DATA] ;
+  static double labels [NUM_CLASSES * NUM_DATA] ;
+  static double reference [NUM_CLASSES * DIMENSION] ;
+  static double models [NUM_CLASSES * DIMENSION] ;
+  double referenceBiases [NUM_CLASSES], biases [NUM_CLASSES] ;
+  VlSvmSolverType solvers [2] = {VlSvmSolverSdca, VlSvmSolverSgd} ;
+  vl_bool same = VL_TRUE ;
+  vl_bool accurate = VL_TRUE ;
+  int error = VL_ERR_OK ;
+  VlRand rand ;
+  vl_uindex i, d, c, s ;
+
+  /* a noisy cluster per class */
+  vl_rand_init (&rand) ;
+  vl_rand_seed (&rand, 1) ;
+  for (i = 0 ; i < NUM_DATA ; ++i) {
+    vl_uindex label = i % NUM_CLASSES ;
+    for (d = 0 ; d < DIMENSION ; ++d) {
+      data[i * DIMENSION + d] = (float)
+        (2 * vl_rand_real1 (&rand) - 1 + 2.0 * (d % NUM_CLASSES == label)) ;
+    }
+    for (c = 0 ; c < NUM_CLASSES ; ++c) {
+      labels[c * NUM_DATA + i] = (c == label) ? 1 : -1 ;
+    }
+  }
+
+  for (s = 0 ; s < 2 ; ++s) {
+    /* mini-batches: the result must not depend on the threads */
+    vl_set_num_threads (1) ;
+    error |= train (data, labels, solvers[s], 64, VL_FALSE, reference, referenceBiases) ;
+    vl_set_num_threads (0) ;
+    error |= train (data, labels, solvers[s], 64, VL_FALSE, models, biases) ;
+    same &= memcmp (reference, models, sizeof(models)) == 0 ;
+    same &= memcmp (referenceBiases, biases, sizeof(biases)) == 0 ;
+    accurate &= accuracy (data, labels, models, biases) > 0.95 ;
+
+    /* concurrent SVMs: the result must not depend on the threads */
+    vl_set_num_threads (1) ;
+    error |= train (data, labels, solvers[s], 1, VL_TRUE, reference, referenceBiases) ;
+    vl_set_num_threads (0) ;
+    error |= train (data, labels, solvers[s], 1, VL_TRUE, models, biases) ;
+    same &= memcmp (reference, models, sizeof(models)) == 0 ;
+    same &= memcmp (referenceBiases, biases, sizeof(biases)) == 0 ;
+    accurate &= accuracy (data, labels, models, biases) > 0.95 ;
+
+    /* sequential solver */
+    error |= train (data, labels, solvers[s], 1, VL_FALSE, models, biases) ;
+    accurate &= accuracy (data, labels, models, biases) > 0.95 ;
+  }
+
+  if (error) {
+    VL_PRINTF("test_svm: error: %s\n", vl_get_last_error_message ()) ;
+    return -1 ;
+  }
+  if (! check_kernel_map (data)) {
+    VL_PRINTF("test_svm: error: wrong kernel map inner product\n") ;
+    return -1 ;
+  }
+  if (! same) {
+    VL_PRINTF("test_svm: error: threads changed the result\n") ;
+    return -1 ;
+  }
+  if (! accurate) {
+    VL_PRINTF("test_svm: error: low training accuracy\n") ;
+    return -1 ;
+  }
+  VL_PRINTF("test_svm: passed\n") ;
+  return 0 ;
+}
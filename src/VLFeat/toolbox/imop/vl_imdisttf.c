@@ -27,6 +27,7 @@ mexFunction(int nout, mxArray *out[],
   enum {OUT_DT = 0, OUT_INDEXES} ;
   vl_uindex * indexes = NULL ;
   mxClassID classId ;
+  int err = VL_ERR_OK ;
   double const defaultParam [] = {1.0, 0.0, 1.0, 0.0} ;
   double const * param = defaultParam ;
 
@@ -79,45 +80,52 @@ mexFunction(int nout, mxArray *out[],
 
   switch (classId) {
     case mxSINGLE_CLASS:
-      vl_image_distance_transform_f((float const*)mxGetData(IN(I)),
-                                    M, N,
-                                    1, M,
-                                    (float*)mxGetPr(OUT(DT)),
-                                    indexes,
-                                    param[2],
-                                    param[3]) ;
-
-      vl_image_distance_transform_f((float*)mxGetPr(OUT(DT)),
-                                    N, M,
-                                    M, 1,
-                                    (float*)mxGetPr(OUT(DT)),
-                                    indexes,
-                                    param[0],
-                                    param[1]) ;
+      err = vl_image_distance_transform_f((float const*)mxGetData(IN(I)),
+                                          M, N,
+                                          1, M,
+                                          (float*)mxGetPr(OUT(DT)),
+                                          indexes,
+                                          param[2],
+                                          param[3]) ;
+
+      if (err) break ;
+      err = vl_image_distance_transform_f((float*)mxGetPr(OUT(DT)),
+                                          N, M,
+                                          M, 1,
+                                          (float*)mxGetPr(OUT(DT)),
+                                          indexes,
+                                          param[0],
+                                          param[1]) ;
       break ;
 
     case mxDOUBLE_CLASS:
-      vl_image_distance_transform_d((double const*)mxGetData(IN(I)),
-                                    M, N,
-                                    1, M,
-                                    (double*)mxGetPr(OUT(DT)),
-                                    indexes,
-                                    param[2],
-                                    param[3]) ;
-
-      vl_image_distance_transform_d((double*)mxGetPr(OUT(DT)),
-                                    N, M,
-                                    M, 1,
-                                    (double*)mxGetPr(OUT(DT)),
-                                    indexes,
-                                    param[0],
-                                    param[1]) ;
+      err = vl_image_distance_transform_d((double const*)mxGetData(IN(I)),
+                                          M, N,
+                                          1, M,
+                                          (double*)mxGetPr(OUT(DT)),
+                                          indexes,
+                                          param[2],
+                                          param[3]) ;
+
+      if (err) break ;
+      err = vl_image_distance_transform_d((double*)mxGetPr(OUT(DT)),
+                                          N, M,
+                                          M, 1,
+                                          (double*)mxGetPr(OUT(DT)),
+                                          indexes,
+                                          param[0],
+                                          param[1]) ;
       break;
 
     default:
       abort() ;
   }
 
+  if (err) {
+    if (indexes) mxFree(indexes) ;
+    vlmxError(vlmxErrAlloc, NULL) ;
+  }
+
   if (indexes) {
     vl_uindex i ;
     double * pt = mxGetPr(OUT(INDEXES)) ;
@@ -203,7 +203,10 @@ void mexFunction (int nout, mxArray * out[], int nin, const mxArray * in[])
 
   vl_hikm_set_verbosity (tree, verb) ;
   vl_hikm_init (tree, M, K, depth) ;
-  vl_hikm_train (tree, data, N) ;
+  if (vl_hikm_train (tree, data, N)) {
+    vl_hikm_delete (tree) ;
+    mexErrMsgTxt("hikmeans: out of memory.") ;
+  }
 
   out[OUT_TREE] = hikm_to_matlab (tree) ;
 
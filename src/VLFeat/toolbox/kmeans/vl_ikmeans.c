@@ -140,6 +140,10 @@ void mexFunction (int nout, mxArray * out[], int nin, const mxArray * in[])
   vl_ikm_init_rand_data (ikmf, data, M, N, K) ;
 
   err = vl_ikm_train (ikmf, data, N) ;
+  if (err == VL_ERR_ALLOC) {
+    vl_ikm_delete (ikmf) ;
+    mexErrMsgTxt("vl_ikmeans: out of memory.") ;
+  }
   if (err) mexWarnMsgTxt("vl_ikmeans: possible overflow!") ;
 
   /* -----------------------------------------------------------------
@@ -208,6 +208,7 @@ mexFunction(int nout, mxArray *out[],
       /* recall that MATLAB images are transposed */
       VlHog * hog = vl_hog_new (variant, numOrientations, VL_TRUE) ;
       mwSize dimensions [3] ;
+      int error ;
 
       vl_hog_set_use_bilinear_orientation_assignments (hog, bilinearOrientations) ;
 
@@ -221,17 +222,21 @@ mexFunction(int nout, mxArray *out[],
 
       switch (inputType) {
       case Image:
-        vl_hog_put_image(hog, image, height, width, numChannels, cellSize) ;
+        error = vl_hog_put_image(hog, image, height, width, numChannels, cellSize) ;
         break ;
       case DirectedPolarField:
       case UndirectedPolarField:
-        vl_hog_put_polar_field(hog, image, image + height*width,
-                               inputType == DirectedPolarField,
-                               height, width, cellSize) ;
+        error = vl_hog_put_polar_field(hog, image, image + height*width,
+                                       inputType == DirectedPolarField,
+                                       height, width, cellSize) ;
           break ;
       default:
         abort() ;
       }
+      if (error) {
+        vl_hog_delete(hog) ;
+        vlmxError(vlmxErrAlloc, NULL) ;
+      }
 
       dimensions[0] = vl_hog_get_width(hog) ;
       dimensions[1] = vl_hog_get_height(hog) ;
@@ -608,7 +608,10 @@ vlmxError(vlmxErrInvalidArgument, VL_STRINGIFY(NAME) " is negative.") ; \
       }
     }
 
-    vl_svm_train(svm) ;
+    if (vl_svm_train(svm)) {
+      vl_svm_delete(svm) ;
+      vlmxError(vlmxErrAlloc, NULL) ;
+    }
 
     {
       mwSize dims[2] ;
@@ -63,12 +63,11 @@ mexFunction(int nout, mxArray *out[],
   int      bright_on_dark = 1 ;
   int      dark_on_bright = 1 ;
 
-  int nel ;
   int ndims ;
   mwSize const* dims ;
 
-  vl_mser_pix const *data ;
-  vl_mser_pix *datainv = 0;
+  void const *data ;
+  vl_bool is16 ;
 
   VlMserFilt        *filt, *filtinv ;
   vl_uint     const *regions = 0 ;
@@ -95,12 +94,13 @@ mexFunction(int nout, mxArray *out[],
     mexErrMsgTxt("Too many output arguments.");
   }
 
-  if(mxGetClassID(in[IN_I]) != mxUINT8_CLASS) {
-    mexErrMsgTxt("I must be of class UINT8") ;
+  if(mxGetClassID(in[IN_I]) != mxUINT8_CLASS &&
+     mxGetClassID(in[IN_I]) != mxUINT16_CLASS) {
+    mexErrMsgTxt("I must be of class UINT8 or UINT16") ;
   }
+  is16 = (mxGetClassID(in[IN_I]) == mxUINT16_CLASS) ;
 
   /* get dimensions */
-  nel   = mxGetNumberOfElements(in[IN_I]) ;
   ndims = mxGetNumberOfDimensions(in[IN_I]) ;
   dims  = mxGetDimensions(in[IN_I]) ;
   data  = mxGetData(in[IN_I]) ;
@@ -186,12 +186,12 @@ mexFunction(int nout, mxArray *out[],
     mexErrMsgTxt("Could not create an MSER filter.") ;
   }
 
-  if (delta         >= 0) vl_mser_set_delta          (filt, (vl_mser_pix) delta) ;
+  if (delta         >= 0) vl_mser_set_delta          (filt, (int) delta) ;
   if (max_area      >= 0) vl_mser_set_max_area       (filt, max_area) ;
   if (min_area      >= 0) vl_mser_set_min_area       (filt, min_area) ;
   if (max_variation >= 0) vl_mser_set_max_variation  (filt, max_variation) ;
   if (min_diversity >= 0) vl_mser_set_min_diversity  (filt, min_diversity) ;
-  if (delta         >= 0) vl_mser_set_delta          (filtinv, (vl_mser_pix) delta) ;
+  if (delta         >= 0) vl_mser_set_delta          (filtinv, (int) delta) ;
   if (max_area      >= 0) vl_mser_set_max_area       (filtinv, max_area) ;
   if (min_area      >= 0) vl_mser_set_min_area       (filtinv, min_area) ;
   if (max_variation >= 0) vl_mser_set_max_variation  (filtinv, max_variation) ;
@@ -207,11 +207,30 @@ mexFunction(int nout, mxArray *out[],
   }
 
 
+  /* the second filter extracts bright regions */
+  vl_mser_set_bright_on_dark (filtinv, 1) ;
+
+  /* process the image, both polarities concurrently if needed */
+  if (is16) {
+    if (dark_on_bright && bright_on_dark) {
+      vl_mser_process_pair_ui16 (filt, filtinv, data) ;
+    } else if (dark_on_bright) {
+      vl_mser_process_ui16 (filt, data) ;
+    } else if (bright_on_dark) {
+      vl_mser_process_ui16 (filtinv, data) ;
+    }
+  } else {
+    if (dark_on_bright && bright_on_dark) {
+      vl_mser_process_pair (filt, filtinv, data) ;
+    } else if (dark_on_bright) {
+      vl_mser_process (filt, data) ;
+    } else if (bright_on_dark) {
+      vl_mser_process (filtinv, data) ;
+    }
+  }
+
   if (dark_on_bright)
   {
-    /* process the image */
-    vl_mser_process (filt, data) ;
-
     /* save regions back to array */
     nregions         = vl_mser_get_regions_num (filt) ;
     regions          = vl_mser_get_regions     (filt) ;
@@ -227,12 +246,6 @@ mexFunction(int nout, mxArray *out[],
 
   if (bright_on_dark)
   {
-    datainv = mxMalloc(sizeof(vl_uint)*nel) ;
-    for(i=0; i<nel; i++) datainv[i] = ~data[i]; /* 255 - data */
-
-    /* process the image */
-    vl_mser_process (filtinv, datainv) ;
-
     /* save regions back to array */
     nregionsinv    = vl_mser_get_regions_num (filtinv) ;
     regionsinv     = vl_mser_get_regions     (filtinv) ;
@@ -300,7 +313,6 @@ mexFunction(int nout, mxArray *out[],
   }
 
   /* cleanup */
-  if (datainv) mxFree(datainv);
   vl_mser_delete (filt) ;
   vl_mser_delete (filtinv) ;
 }
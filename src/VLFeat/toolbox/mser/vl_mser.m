@@ -1,7 +1,7 @@
 % VL_MSER  Maximally Stable Extremal Regions
 %   R=VL_MSER(I) computes the Maximally Stable Extremal Regions (MSER)
 %   [1] of image I with stability threshold DELTA. I is any array of
-%   class UINT8. R is a vector of region seeds.
+%   class UINT8 or UINT16. R is a vector of region seeds.
 %
 %   A (maximally stable) extremal region is just a connected component
 %   of one of the level sets of the image I.  An extremal region can
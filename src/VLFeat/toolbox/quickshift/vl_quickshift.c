@@ -20,11 +20,13 @@ the terms of the BSD license (see the COPYING file).
 
 enum {
   opt_medoid,
+  opt_truncated,
   opt_verbose
 } ;
 
 vlmxOption options [] = {
   {"Medoid",              0,   opt_medoid         },
+  {"Truncated",           0,   opt_truncated      },
   {"Verbose",             0,   opt_verbose        },
   {0,                     0,   0                  }
 } ;
@@ -55,7 +57,8 @@ mexFunction(int nout, mxArray *out[],
   int             next = IN_END ;
   mxArray const  *optarg ;
 
-  double const *I ;
+  void const *I ;
+  mxClassID classID ;
   double *parents, *dists, *density ;
   int *parentsi;
   double sigma ;
@@ -64,6 +67,7 @@ mexFunction(int nout, mxArray *out[],
   int K,N1,N2;
 
   int medoid = 0 ;
+  VlQSDensityApproximation approximation = VlQSDensityExact ;
 
   mwSize const *dims ;
   int ndims ;
@@ -93,15 +97,16 @@ mexFunction(int nout, mxArray *out[],
     mexErrMsgTxt("I must have at most 3 dimensions.") ;
   }
 
-  if (mxGetClassID(in[IN_I]) != mxDOUBLE_CLASS) {
-    mexErrMsgTxt("I must be DOUBLE.")  ;
+  classID = mxGetClassID(in[IN_I]) ;
+  if (classID != mxDOUBLE_CLASS && classID != mxSINGLE_CLASS) {
+    mexErrMsgTxt("I must be DOUBLE or SINGLE.")  ;
   }
 
   N1 = dims [0] ;
   N2 = dims [1] ;
   K = (ndims == 3) ? dims [2] : 1 ;
 
-  I     =  mxGetPr (in[IN_I]) ;
+  I     =  mxGetData (in[IN_I]) ;
   sigma = *mxGetPr (in[IN_KERNEL_SIZE]) ;
   tau   = 3*sigma;
   if (nin > 2)
@@ -112,6 +117,9 @@ mexFunction(int nout, mxArray *out[],
     case opt_medoid: /* Do medoid shift instead of mean shift */
       medoid = 1 ;
       break ;
+    case opt_truncated: /* Truncate the Parzen window estimator */
+      approximation = VlQSDensityTruncated ;
+      break ;
     case opt_verbose :
       ++ verb ;
       break ;
@@ -133,16 +141,28 @@ mexFunction(int nout, mxArray *out[],
     mexPrintf("quickshift: type: %s\n", medoid ? "medoid" : "quick");
     mexPrintf("quickshift: kernel size:  %g\n", sigma) ;
     mexPrintf("quickshift: maximum gap:  %g\n", tau) ;
+    mexPrintf("quickshift: density: %s\n",
+              approximation == VlQSDensityTruncated ? "truncated" : "exact") ;
+    mexPrintf("quickshift: data type: %s\n",
+              classID == mxSINGLE_CLASS ? "single" : "double") ;
   }
 
   /* Do job */
-  q = vl_quickshift_new(I, N1, N2, K);
+  if (classID == mxSINGLE_CLASS) {
+    q = vl_quickshift_new_f((float const *) I, N1, N2, K);
+  } else {
+    q = vl_quickshift_new((double const *) I, N1, N2, K);
+  }
 
   vl_quickshift_set_kernel_size (q, sigma) ;
   vl_quickshift_set_max_dist     (q, tau) ;
   vl_quickshift_set_medoid      (q, medoid) ;
+  vl_quickshift_set_density_approximation (q, approximation) ;
 
-  vl_quickshift_process(q);
+  if (vl_quickshift_process(q)) {
+    vl_quickshift_delete(q) ;
+    mexErrMsgTxt("Out of memory.") ;
+  }
 
   parentsi = vl_quickshift_get_parents(q);
   /* Copy results */
@@ -27,6 +27,10 @@
 %     component should be weighted accordingly before calling this
 %     function.
 %
+%     I can be either DOUBLE or SINGLE. SINGLE images are processed
+%     in single precision, which is faster. The outputs are always
+%     DOUBLE.
+%
 %   Options:
 %
 %   Verbose::
@@ -35,6 +39,11 @@
 %   Medoid::
 %     Run medoid shift instead of quick shift.
 %
+%   Truncated::
+%     Ignore the pixels farther than 3 * KERNELSIZE (in the joint
+%     space of image coordinates and values) when estimating the
+%     density. This is faster and only slightly lowers the density.
+%
 %   See also: VL_HELP().
 
 % Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
@@ -533,7 +533,10 @@ mexFunction(int nout, mxArray *out[],
                   vl_covdet_get_edge_threshold(covdet)) ;
       }
 
-      vl_covdet_detect(covdet) ;
+      if (vl_covdet_detect(covdet)) {
+        vl_covdet_delete(covdet) ;
+        vlmxError(vlmxErrAlloc, NULL) ;
+      }
 
       if (verbose) {
         vl_index i ;
@@ -579,7 +582,10 @@ mexFunction(int nout, mxArray *out[],
         mexPrintf("vl_covdet: estimating affine shape for %d features\n", numFeaturesBefore) ;
       }
 
-      vl_covdet_extract_affine_shape(covdet) ;
+      if (vl_covdet_extract_affine_shape(covdet)) {
+        vl_covdet_delete(covdet) ;
+        vlmxError(vlmxErrAlloc, NULL) ;
+      }
 
       if (verbose) {
         vl_size numFeaturesAfter = vl_covdet_get_num_features(covdet) ;
@@ -592,7 +598,10 @@ mexFunction(int nout, mxArray *out[],
       vl_size numFeaturesBefore = vl_covdet_get_num_features(covdet) ;
       vl_size numFeaturesAfter ;
 
-      vl_covdet_extract_orientations(covdet) ;
+      if (vl_covdet_extract_orientations(covdet)) {
+        vl_covdet_delete(covdet) ;
+        vlmxError(vlmxErrAlloc, NULL) ;
+      }
 
       numFeaturesAfter = vl_covdet_get_num_features(covdet) ;
       if (verbose && numFeaturesAfter > numFeaturesBefore) {
@@ -0,0 +1,1156 @@
+/** @file archive.c
+ ** @brief Binary archive - Definition
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+/**
+
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@page archive Binary archive
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+@ref archive.h implements a simple binary container for the arrays
+and models used by a VLFeat pipeline: descriptor sets, ::VlKMeans
+centers, ::VlGMM parameters and the search layout of a ::VlKDForest.
+An archive is loaded by mapping the file in memory, so that opening
+it does not require reading nor parsing the data, and a kd-forest can
+be queried directly from the mapped pages.
+
+- @ref archive-overview
+- @ref archive-format
+
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@section archive-overview Overview
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+An archive is a list of named sections (::VlArchiveSection). To
+create one, open a ::VlArchiveWriter with ::vl_archive_writer_open,
+add the arrays with ::vl_archive_writer_add and the models with
+::vl_archive_writer_add_kmeans, ::vl_archive_writer_add_gmm and
+::vl_archive_writer_add_kdforest, and finally call
+::vl_archive_writer_close:
+
+@code
+VlArchiveWriter * writer = vl_archive_writer_open ("index.vla") ;
+vl_size dimensions [2] = {128, numData} ;
+vl_archive_writer_add (writer, "descriptors", VL_TYPE_FLOAT, 2, dimensions, data) ;
+vl_archive_writer_add_kmeans (writer, "vocabulary", kmeans) ;
+vl_archive_writer_add_kdforest (writer, "forest", forest) ;
+if (vl_archive_writer_close (writer)) {
+  // error, see vl_get_last_error_message()
+}
+@endcode
+
+Errors are sticky: if writing a section fails, the following calls
+return the same error code and ::vl_archive_writer_close does not
+complete the archive.
+
+Open the archive with ::vl_archive_open. The sections can be looked
+up with ::vl_archive_find_section and their data accessed with
+::vl_archive_get_section_data. Models are recreated by
+::vl_archive_new_kmeans, ::vl_archive_new_gmm and
+::vl_archive_new_kdforest. The first two copy the (small) model
+parameters. The kd-forest instead refers to the mapped data, so that
+it can answer queries immediately; the archive must not be closed
+before the forest is deleted.
+
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@section archive-format File format
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+The file starts with a 64 bytes header containing the magic string
+@c VLARCHIV, the format version ::VL_ARCHIVE_VERSION, a byte order
+mark, the number of sections, the offset of the table of contents and
+the file size. The header is followed by the section data, each
+section starting at a multiple of ::VL_ARCHIVE_ALIGNMENT bytes, and by
+the table of contents, an array of ::VlArchiveSection structures.
+Data is stored in the native byte order; files written on a machine
+with a different byte order are rejected, and so are kd-forests
+written by a build with a different layout of the tree nodes.
+
+When an archive is opened, the header and the table of contents are
+checked, as well as the shape of the sections used to recreate a
+model. The content of the sections is not checked.
+
+A model @c name is stored in sections whose name starts with @c
+name/:
+
+- ::VlKMeans: @c centers (@c dimension x @c numCenters) and @c params
+  (distance, algorithm, initialization, number of repetitions, maximum
+  number of iterations, maximum number of comparisons and number of
+  trees).
+- ::VlGMM: @c means and @c covariances (@c dimension x @c
+  numClusters) and @c priors (@c numClusters).
+- ::VlKDForest: @c params (data type, dimension, number of trees,
+  distance, number of data points, leaf size, maximum number of points
+  in a leaf, thresholding method and maximum number of comparisons),
+  @c trees (number of search nodes, number of tree nodes and depth of
+  each tree), and for each tree @c t the search nodes @c nodest, the
+  data index @c indext and the data in the order of the leaves @c
+  datat (see @ref kdtree-tech).
+**/
+
+#include "archive.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(VL_OS_WIN)
+#include <Windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static char const _vl_archive_magic [8] = {'V','L','A','R','C','H','I','V'} ;
+
+#define VL_ARCHIVE_BYTE_ORDER 0x01020304
+#define VL_KMEANS_NUM_PARAMS 7
+#define VL_KDFOREST_NUM_PARAMS 9
+
+/** @internal @brief Archive header */
+typedef struct _VlArchiveHeader
+{
+  char magic [8] ;
+  vl_uint32 version ;
+  vl_uint32 byteOrder ;
+  vl_uint64 numSections ;
+  vl_uint64 tableOffset ;
+  vl_uint64 fileSize ;
+  vl_uint64 reserved [3] ;
+} VlArchiveHeader ;
+
+struct _VlArchiveWriter
+{
+  FILE * file ;
+  char * fileName ;
+  vl_uint64 offset ;
+  VlArchiveSection * sections ;
+  vl_size numSections ;
+  vl_size numAllocatedSections ;
+  int error ;
+} ;
+
+struct _VlArchive
+{
+  char const * begin ;
+  vl_size size ;
+  VlArchiveSection const * sections ;
+  vl_size numSections ;
+#if defined(VL_OS_WIN)
+  HANDLE file ;
+  HANDLE mapping ;
+#endif
+} ;
+
+/* ---------------------------------------------------------------- */
+/*                                                Write an archive  */
+/* ---------------------------------------------------------------- */
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Write data to the archive
+ ** @param self archive writer.
+ ** @param data data.
+ ** @param size size of the data in bytes.
+ ** @return error code.
+ **/
+
+static int
+_vl_archive_writer_write (VlArchiveWriter * self, void const * data, vl_size size)
+{
+  if (size > 0 && fwrite (data, size, 1, self->file) != 1) {
+    self->error = vl_set_last_error (VL_ERR_IO, "Error writing '%s'.", self->fileName) ;
+    return self->error ;
+  }
+  self->offset += size ;
+  return VL_ERR_OK ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Pad the archive to the section alignment
+ ** @param self archive writer.
+ ** @return error code.
+ **/
+
+static int
+_vl_archive_writer_pad (VlArchiveWriter * self)
+{
+  static char const zeros [VL_ARCHIVE_ALIGNMENT] = {0} ;
+  vl_size numBytes = (vl_size)
+    ((VL_ARCHIVE_ALIGNMENT - self->offset % VL_ARCHIVE_ALIGNMENT) % VL_ARCHIVE_ALIGNMENT) ;
+  return _vl_archive_writer_write (self, zeros, numBytes) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Compose the name of a section of a model
+ ** @param buffer name (output).
+ ** @param name model name.
+ ** @param suffix section suffix.
+ ** @return error code.
+ **/
+
+static int
+_vl_archive_compose_name (char * buffer, char const * name, char const * suffix)
+{
+  vl_size nameLength = strlen (name) ;
+  vl_size suffixLength = strlen (suffix) ;
+  if (nameLength + suffixLength + 2 > VL_ARCHIVE_MAX_NAME_LENGTH) {
+    return vl_set_last_error (VL_ERR_BAD_ARG, "The section name '%s/%s' is too long.",
+                              name, suffix) ;
+  }
+  memcpy (buffer, name, nameLength) ;
+  buffer[nameLength] = '/' ;
+  memcpy (buffer + nameLength + 1, suffix, suffixLength + 1) ;
+  return VL_ERR_OK ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Add a section to the archive
+ ** @param self archive writer.
+ ** @param name section name.
+ ** @param dataType data type (or 0 for opaque records).
+ ** @param elementSize size of an element in bytes.
+ ** @param numDimensions number of dimensions.
+ ** @param dimensions dimensions.
+ ** @param data data.
+ ** @return error code.
+ **/
+
+static int
+_vl_archive_writer_add_section (VlArchiveWriter * self,
+                                char const * name,
+                                vl_type dataType,
+                                vl_size elementSize,
+                                vl_size numDimensions,
+                                vl_size const * dimensions,
+                                void const * data)
+{
+  VlArchiveSection * section ;
+  vl_size size = elementSize ;
+  vl_uindex i ;
+
+  if (self->error) return self->error ;
+
+  if (strlen (name) + 1 > VL_ARCHIVE_MAX_NAME_LENGTH) {
+    return vl_set_last_error (VL_ERR_BAD_ARG, "The section name '%s' is too long.", name) ;
+  }
+  if (numDimensions > VL_ARCHIVE_MAX_NUM_DIMENSIONS) {
+    return vl_set_last_error (VL_ERR_BAD_ARG, "The section '%s' has too many dimensions.", name) ;
+  }
+  for (i = 0 ; i < self->numSections ; ++i) {
+    if (strcmp (self->sections[i].name, name) == 0) {
+      return vl_set_last_error (VL_ERR_BAD_ARG, "The section '%s' already exists.", name) ;
+    }
+  }
+
+  if (self->numSections == self->numAllocatedSections) {
+    self->numAllocatedSections = VL_MAX(2 * self->numAllocatedSections, 16) ;
+    self->sections = vl_realloc (self->sections,
+                                 sizeof(VlArchiveSection) * self->numAllocatedSections) ;
+  }
+  section = self->sections + self->numSections ;
+  memset (section, 0, sizeof(VlArchiveSection)) ;
+  strcpy (section->name, name) ;
+  section->dataType = (vl_uint32) dataType ;
+  section->elementSize = (vl_uint32) elementSize ;
+  section->numDimensions = (vl_uint32) numDimensions ;
+  for (i = 0 ; i < numDimensions ; ++i) {
+    section->dimensions[i] = dimensions[i] ;
+    size *= dimensions[i] ;
+  }
+  section->offset = self->offset ;
+  section->size = size ;
+
+  if (_vl_archive_writer_write (self, data, size) ||
+      _vl_archive_writer_pad (self)) {
+    return self->error ;
+  }
+  self->numSections ++ ;
+  return VL_ERR_OK ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Create a new archive
+ ** @param fileName file name.
+ ** @return new archive writer or @c NULL on error.
+ **
+ ** On failure the function returns @c NULL and sets the last error
+ ** (see ::vl_get_last_error_message). The archive is complete only
+ ** after ::vl_archive_writer_close has been called.
+ **/
+
+VlArchiveWriter *
+vl_archive_writer_open (char const * fileName)
+{
+  VlArchiveWriter * self ;
+  VlArchiveHeader header ;
+  FILE * file = fopen (fileName, "wb") ;
+
+  if (file == NULL) {
+    vl_set_last_error (VL_ERR_IO, "Could not open '%s' for writing.", fileName) ;
+    return NULL ;
+  }
+
+  self = vl_calloc (sizeof(VlArchiveWriter), 1) ;
+  self->file = file ;
+  self->fileName = vl_malloc (strlen (fileName) + 1) ;
+  strcpy (self->fileName, fileName) ;
+
+  /* the header is written by vl_archive_writer_close */
+  memset (&header, 0, sizeof(header)) ;
+  _vl_archive_writer_write (self, &header, sizeof(header)) ;
+  return self ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Complete the archive and delete the writer
+ ** @param self archive writer.
+ ** @return error code.
+ **
+ ** The function writes the table of contents and the header and
+ ** closes the file. It returns ::VL_ERR_OK on success. If an error
+ ** occured while adding the sections, the archive is left incomplete
+ ** and the function returns the error code.
+ **/
+
+int
+vl_archive_writer_close (VlArchiveWriter * self)
+{
+  VlArchiveHeader header ;
+  int error ;
+
+  memset (&header, 0, sizeof(header)) ;
+  memcpy (header.magic, _vl_archive_magic, sizeof(_vl_archive_magic)) ;
+  header.version = VL_ARCHIVE_VERSION ;
+  header.byteOrder = VL_ARCHIVE_BYTE_ORDER ;
+  header.numSections = self->numSections ;
+  header.tableOffset = self->offset ;
+
+  if (! self->error) {
+    _vl_archive_writer_write (self, self->sections,
+                              sizeof(VlArchiveSection) * self->numSections) ;
+  }
+  header.fileSize = self->offset ;
+  if (! self->error &&
+      (fseek (self->file, 0, SEEK_SET) != 0 ||
+       fwrite (&header, sizeof(header), 1, self->file) != 1)) {
+    self->error = vl_set_last_error (VL_ERR_IO, "Error writing '%s'.", self->fileName) ;
+  }
+  if (fclose (self->file) != 0 && ! self->error) {
+    self->error = vl_set_last_error (VL_ERR_IO, "Error writing '%s'.", self->fileName) ;
+  }
+
+  error = self->error ;
+  if (self->sections) vl_free (self->sections) ;
+  vl_free (self->fileName) ;
+  vl_free (self) ;
+  return error ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Add an array to the archive
+ ** @param self archive writer.
+ ** @param name section name.
+ ** @param dataType data type (e.g. ::VL_TYPE_FLOAT).
+ ** @param numDimensions number of dimensions.
+ ** @param dimensions dimensions.
+ ** @param data array data.
+ ** @return error code.
+ **
+ ** The array is stored in column-major order, i.e. the first
+ ** dimension varies fastest. For example, @c numData descriptors of
+ ** dimension @c dimension have dimensions @c dimension x @c numData.
+ ** The name must be unique and shorter than
+ ** ::VL_ARCHIVE_MAX_NAME_LENGTH and the number of dimensions not
+ ** larger than ::VL_ARCHIVE_MAX_NUM_DIMENSIONS.
+ **/
+
+int
+vl_archive_writer_add (VlArchiveWriter * self,
+                       char const * name,
+                       vl_type dataType,
+                       vl_size numDimensions,
+                       vl_size const * dimensions,
+                       void const * data)
+{
+  return _vl_archive_writer_add_section (self, name, dataType,
+                                         vl_get_type_size (dataType),
+                                         numDimensions, dimensions, data) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Add an array of records to the archive
+ ** @param self archive writer.
+ ** @param name section name.
+ ** @param elementSize size of a record in bytes.
+ ** @param numElements number of records.
+ ** @param data records.
+ ** @return error code.
+ **
+ ** The records are stored as opaque data (the section data type is
+ ** zero).
+ **/
+
+int
+vl_archive_writer_add_records (VlArchiveWriter * self,
+                               char const * name,
+                               vl_size elementSize,
+                               vl_size numElements,
+                               void const * data)
+{
+  return _vl_archive_writer_add_section (self, name, 0, elementSize,
+                                         1, &numElements, data) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Add a K-means quantizer to the archive
+ ** @param self archive writer.
+ ** @param name model name.
+ ** @param kmeans K-means object.
+ ** @return error code.
+ **
+ ** The K-means centers must have been computed.
+ **
+ ** @sa @ref archive-format, ::vl_archive_new_kmeans
+ **/
+
+int
+vl_archive_writer_add_kmeans (VlArchiveWriter * self,
+                              char const * name,
+                              VlKMeans const * kmeans)
+{
+  char sectionName [VL_ARCHIVE_MAX_NAME_LENGTH] ;
+  vl_uint64 params [VL_KMEANS_NUM_PARAMS] ;
+  vl_size numParams = VL_KMEANS_NUM_PARAMS ;
+  vl_size dimensions [2] ;
+  int error ;
+
+  assert (kmeans->centers) ;
+
+  params[0] = kmeans->distance ;
+  params[1] = kmeans->algorithm ;
+  params[2] = kmeans->initialization ;
+  params[3] = kmeans->numRepetitions ;
+  params[4] = kmeans->maxNumIterations ;
+  params[5] = kmeans->maxNumComparisons ;
+  params[6] = kmeans->numTrees ;
+  dimensions[0] = kmeans->dimension ;
+  dimensions[1] = kmeans->numCenters ;
+
+  if ((error = _vl_archive_compose_name (sectionName, name, "centers")) ||
+      (error = vl_archive_writer_add (self, sectionName, kmeans->dataType,
+                                      2, dimensions, kmeans->centers)) ||
+      (error = _vl_archive_compose_name (sectionName, name, "params")) ||
+      (error = vl_archive_writer_add (self, sectionName, VL_TYPE_UINT64,
+                                      1, &numParams, params))) {
+    return error ;
+  }
+  return VL_ERR_OK ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Add a GMM to the archive
+ ** @param self archive writer.
+ ** @param name model name.
+ ** @param gmm GMM object.
+ ** @return error code.
+ **
+ ** @sa @ref archive-format, ::vl_archive_new_gmm
+ **/
+
+int
+vl_archive_writer_add_gmm (VlArchiveWriter * self,
+                           char const * name,
+                           VlGMM const * gmm)
+{
+  char sectionName [VL_ARCHIVE_MAX_NAME_LENGTH] ;
+  vl_type dataType = vl_gmm_get_data_type (gmm) ;
+  vl_size dimensions [2] ;
+  int error ;
+
+  dimensions[0] = vl_gmm_get_dimension (gmm) ;
+  dimensions[1] = vl_gmm_get_num_clusters (gmm) ;
+
+  if ((error = _vl_archive_compose_name (sectionName, name, "means")) ||
+      (error = vl_archive_writer_add (self, sectionName, dataType,
+                                      2, dimensions, vl_gmm_get_means (gmm))) ||
+      (error = _vl_archive_compose_name (sectionName, name, "covariances")) ||
+      (error = vl_archive_writer_add (self, sectionName, dataType,
+                                      2, dimensions, vl_gmm_get_covariances (gmm))) ||
+      (error = _vl_archive_compose_name (sectionName, name, "priors")) ||
+      (error = vl_archive_writer_add (self, sectionName, dataType,
+                                      1, dimensions + 1, vl_gmm_get_priors (gmm)))) {
+    return error ;
+  }
+  return VL_ERR_OK ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Add a KD-forest to the archive
+ ** @param self archive writer.
+ ** @param name model name.
+ ** @param forest KD-forest object.
+ ** @return error code.
+ **
+ ** The function stores the search layout of the trees (see @ref
+ ** kdtree-tech), which includes a copy of the indexed data for each
+ ** tree. The forest must have been built with ::vl_kdforest_build
+ ** (or loaded from an archive). The original tree nodes are not
+ ** stored, so that the leaf size of the loaded forest cannot be
+ ** changed.
+ **
+ ** @sa @ref archive-format, ::vl_archive_new_kdforest
+ **/
+
+int
+vl_archive_writer_add_kdforest (VlArchiveWriter * self,
+                                char const * name,
+                                VlKDForest const * forest)
+{
+  char sectionName [VL_ARCHIVE_MAX_NAME_LENGTH] ;
+  char suffix [32] ;
+  vl_uint64 params [VL_KDFOREST_NUM_PARAMS] ;
+  vl_uint64 * trees ;
+  vl_size numParams = VL_KDFOREST_NUM_PARAMS ;
+  vl_size dimensions [2] ;
+  vl_uindex ti ;
+  int error ;
+
+  assert (forest->flattened) ;
+
+  params[0] = forest->dataType ;
+  params[1] = forest->dimension ;
+  params[2] = forest->numTrees ;
+  params[3] = forest->distance ;
+  params[4] = forest->numData ;
+  params[5] = forest->leafSize ;
+  params[6] = forest->maxNumLeafData ;
+  params[7] = forest->thresholdingMethod ;
+  params[8] = forest->searchMaxNumComparisons ;
+
+  trees = vl_malloc (sizeof(vl_uint64) * 3 * forest->numTrees) ;
+  for (ti = 0 ; ti < forest->numTrees ; ++ti) {
+    trees[3*ti+0] = forest->trees[ti]->numFlatNodes ;
+    trees[3*ti+1] = forest->trees[ti]->numUsedNodes ;
+    trees[3*ti+2] = forest->trees[ti]->depth ;
+  }
+  dimensions[0] = 3 ;
+  dimensions[1] = forest->numTrees ;
+
+  if ((error = _vl_archive_compose_name (sectionName, name, "params")) ||
+      (error = vl_archive_writer_add (self, sectionName, VL_TYPE_UINT64,
+                                      1, &numParams, params)) ||
+      (error = _vl_archive_compose_name (sectionName, name, "trees")) ||
+      (error = vl_archive_writer_add (self, sectionName, VL_TYPE_UINT64,
+                                      2, dimensions, trees))) {
+    vl_free (trees) ;
+    return error ;
+  }
+  vl_free (trees) ;
+
+  dimensions[0] = forest->dimension ;
+  dimensions[1] = forest->numData ;
+  for (ti = 0 ; ti < forest->numTrees ; ++ti) {
+    VlKDTree const * tree = forest->trees[ti] ;
+    sprintf (suffix, "nodes%u", (unsigned) ti) ;
+    if ((error = _vl_archive_compose_name (sectionName, name, suffix)) ||
+        (error = vl_archive_writer_add_records (self, sectionName,
+                                                sizeof(VlKDTreeFlatNode),
+                                                tree->numFlatNodes,
+                                                tree->flatNodes))) {
+      return error ;
+    }
+    sprintf (suffix, "index%u", (unsigned) ti) ;
+    if ((error = _vl_archive_compose_name (sectionName, name, suffix)) ||
+        (error = vl_archive_writer_add_records (self, sectionName,
+                                                sizeof(VlKDTreeDataIndexEntry),
+                                                forest->numData,
+                                                tree->dataIndex))) {
+      return error ;
+    }
+    sprintf (suffix, "data%u", (unsigned) ti) ;
+    if ((error = _vl_archive_compose_name (sectionName, name, suffix)) ||
+        (error = vl_archive_writer_add (self, sectionName, forest->dataType,
+                                        2, dimensions, tree->flatData))) {
+      return error ;
+    }
+  }
+  return VL_ERR_OK ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                                 Read an archive  */
+/* ---------------------------------------------------------------- */
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Check the header and table of contents of an archive
+ ** @param self archive.
+ ** @return @c true if the archive is valid.
+ **
+ ** The function also sets VlArchive::sections and
+ ** VlArchive::numSections.
+ **/
+
+static vl_bool
+_vl_archive_check (VlArchive * self)
+{
+  VlArchiveHeader const * header = (VlArchiveHeader const*) self->begin ;
+  vl_uindex i, d ;
+
+  if (self->size < sizeof(VlArchiveHeader) ||
+      memcmp (header->magic, _vl_archive_magic, sizeof(_vl_archive_magic)) ||
+      header->version != VL_ARCHIVE_VERSION ||
+      header->byteOrder != VL_ARCHIVE_BYTE_ORDER ||
+      header->fileSize != self->size ||
+      header->tableOffset % VL_ARCHIVE_ALIGNMENT != 0 ||
+      header->tableOffset > self->size ||
+      header->numSections > (self->size - header->tableOffset) / sizeof(VlArchiveSection)) {
+    return VL_FALSE ;
+  }
+  self->sections = (VlArchiveSection const*) (self->begin + header->tableOffset) ;
+  self->numSections = (vl_size) header->numSections ;
+
+  for (i = 0 ; i < self->numSections ; ++i) {
+    VlArchiveSection const * section = self->sections + i ;
+    vl_uint64 size = section->elementSize ;
+    if (memchr (section->name, 0, VL_ARCHIVE_MAX_NAME_LENGTH) == NULL ||
+        section->numDimensions > VL_ARCHIVE_MAX_NUM_DIMENSIONS ||
+        section->offset % VL_ARCHIVE_ALIGNMENT != 0 ||
+        section->offset < sizeof(VlArchiveHeader) ||
+        section->offset > header->tableOffset ||
+        section->size > header->tableOffset - section->offset) {
+      return VL_FALSE ;
+    }
+    for (d = 0 ; d < section->numDimensions ; ++d) {
+      if (section->dimensions[d] != 0 && size > section->size / section->dimensions[d]) {
+        return VL_FALSE ;
+      }
+      size *= section->dimensions[d] ;
+    }
+    if (size != section->size) return VL_FALSE ;
+  }
+  return VL_TRUE ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Open an archive
+ ** @param fileName file name.
+ ** @return new archive or @c NULL on error.
+ **
+ ** The file is mapped in memory (read only) and its header and table
+ ** of contents are checked. On failure the function returns @c NULL
+ ** and sets the last error (see ::vl_get_last_error_message).
+ **/
+
+VlArchive *
+vl_archive_open (char const * fileName)
+{
+  VlArchive * self = vl_calloc (sizeof(VlArchive), 1) ;
+
+#if defined(VL_OS_WIN)
+  LARGE_INTEGER size ;
+  if (self == NULL) {
+    vl_set_last_error (VL_ERR_ALLOC, NULL) ;
+    return NULL ;
+  }
+  self->file = CreateFileA (fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) ;
+  if (self->file == INVALID_HANDLE_VALUE) {
+    vl_free (self) ;
+    vl_set_last_error (VL_ERR_IO, "Could not open '%s' for reading.", fileName) ;
+    return NULL ;
+  }
+  if (! GetFileSizeEx (self->file, &size) ||
+      (vl_uint64) size.QuadPart > (vl_uint64) ((size_t) -1) ||
+      size.QuadPart < (LONGLONG) sizeof(VlArchiveHeader) ||
+      (self->mapping = CreateFileMapping (self->file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL ||
+      (self->begin = MapViewOfFile (self->mapping, FILE_MAP_READ, 0, 0, 0)) == NULL) {
+    if (self->mapping) CloseHandle (self->mapping) ;
+    CloseHandle (self->file) ;
+    vl_free (self) ;
+    vl_set_last_error (VL_ERR_IO, "Could not map '%s' in memory.", fileName) ;
+    return NULL ;
+  }
+  self->size = (vl_size) size.QuadPart ;
+#else
+  struct stat status ;
+  void * begin ;
+  int file ;
+  if (self == NULL) {
+    vl_set_last_error (VL_ERR_ALLOC, NULL) ;
+    return NULL ;
+  }
+  file = open (fileName, O_RDONLY) ;
+  if (file < 0) {
+    vl_free (self) ;
+    vl_set_last_error (VL_ERR_IO, "Could not open '%s' for reading.", fileName) ;
+    return NULL ;
+  }
+  if (fstat (file, &status) != 0 ||
+      (vl_uint64) status.st_size > (vl_uint64) ((size_t) -1) ||
+      status.st_size < (off_t) sizeof(VlArchiveHeader) ||
+      (begin = mmap (NULL, (size_t) status.st_size, PROT_READ, MAP_SHARED, file, 0)) == MAP_FAILED) {
+    close (file) ;
+    vl_free (self) ;
+    vl_set_last_error (VL_ERR_IO, "Could not map '%s' in memory.", fileName) ;
+    return NULL ;
+  }
+  close (file) ;
+  self->begin = begin ;
+  self->size = (vl_size) status.st_size ;
+#endif
+
+  if (! _vl_archive_check (self)) {
+    vl_archive_close (self) ;
+    vl_set_last_error (VL_ERR_BAD_ARG, "'%s' is not a valid archive.", fileName) ;
+    return NULL ;
+  }
+  return self ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Close an archive
+ ** @param self archive.
+ **
+ ** The data of the archive, including the one referred to by the
+ ** KD-forests created by ::vl_archive_new_kdforest, becomes invalid.
+ **/
+
+void
+vl_archive_close (VlArchive * self)
+{
+#if defined(VL_OS_WIN)
+  UnmapViewOfFile (self->begin) ;
+  CloseHandle (self->mapping) ;
+  CloseHandle (self->file) ;
+#else
+  munmap ((void*) self->begin, self->size) ;
+#endif
+  vl_free (self) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Get the number of sections
+ ** @param self archive.
+ ** @return number of sections.
+ **/
+
+vl_size
+vl_archive_get_num_sections (VlArchive const * self)
+{
+  return self->numSections ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Get a section
+ ** @param self archive.
+ ** @param index section index.
+ ** @return section.
+ **/
+
+VlArchiveSection const *
+vl_archive_get_section (VlArchive const * self, vl_uindex index)
+{
+  assert (index < self->numSections) ;
+  return self->sections + index ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Find a section by name
+ ** @param self archive.
+ ** @param name section name.
+ ** @return section or @c NULL if not found.
+ **/
+
+VlArchiveSection const *
+vl_archive_find_section (VlArchive const * self, char const * name)
+{
+  vl_uindex i ;
+  for (i = 0 ; i < self->numSections ; ++i) {
+    if (strcmp (self->sections[i].name, name) == 0) return self->sections + i ;
+  }
+  return NULL ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Get the data of a section
+ ** @param self archive.
+ ** @param section section.
+ ** @return pointer to the section data.
+ **
+ ** The data is aligned to ::VL_ARCHIVE_ALIGNMENT bytes and remains
+ ** valid until the archive is closed.
+ **/
+
+void const *
+vl_archive_get_section_data (VlArchive const * self, VlArchiveSection const * section)
+{
+  return self->begin + section->offset ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Get a section of a model and check its shape
+ ** @param self archive.
+ ** @param name model name.
+ ** @param suffix section suffix.
+ ** @param dataType expected data type.
+ ** @param elementSize expected element size.
+ ** @param numDimensions expected number of dimensions.
+ ** @return section or @c NULL on error.
+ **/
+
+static VlArchiveSection const *
+_vl_archive_get_model_section (VlArchive const * self,
+                               char const * name,
+                               char const * suffix,
+                               vl_type dataType,
+                               vl_size elementSize,
+                               vl_size numDimensions)
+{
+  char sectionName [VL_ARCHIVE_MAX_NAME_LENGTH] ;
+  VlArchiveSection const * section ;
+  if (_vl_archive_compose_name (sectionName, name, suffix)) return NULL ;
+  section = vl_archive_find_section (self, sectionName) ;
+  if (section == NULL) {
+    vl_set_last_error (VL_ERR_BAD_ARG, "The archive has no section '%s'.", sectionName) ;
+    return NULL ;
+  }
+  if (section->dataType != dataType ||
+      section->elementSize != elementSize ||
+      section->numDimensions != numDimensions) {
+    vl_set_last_error (VL_ERR_BAD_ARG, "The archive section '%s' is invalid.", sectionName) ;
+    return NULL ;
+  }
+  return section ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Get the data type of a model section
+ ** @param self archive.
+ ** @param name model name.
+ ** @param suffix section suffix.
+ ** @return data type (::VL_TYPE_FLOAT or ::VL_TYPE_DOUBLE) or 0 on error.
+ **/
+
+static vl_type
+_vl_archive_get_model_data_type (VlArchive const * self,
+                                 char const * name,
+                                 char const * suffix)
+{
+  char sectionName [VL_ARCHIVE_MAX_NAME_LENGTH] ;
+  VlArchiveSection const * section ;
+  if (_vl_archive_compose_name (sectionName, name, suffix)) return 0 ;
+  section = vl_archive_find_section (self, sectionName) ;
+  if (section == NULL) {
+    vl_set_last_error (VL_ERR_BAD_ARG, "The archive has no section '%s'.", sectionName) ;
+    return 0 ;
+  }
+  if (section->dataType != VL_TYPE_FLOAT && section->dataType != VL_TYPE_DOUBLE) {
+    vl_set_last_error (VL_ERR_BAD_ARG, "The archive section '%s' is invalid.", sectionName) ;
+    return 0 ;
+  }
+  return section->dataType ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Create a K-means quantizer from an archive
+ ** @param self archive.
+ ** @param name model name.
+ ** @return new K-means object or @c NULL on error.
+ **
+ ** The centers and parameters are copied, so that the object remains
+ ** valid after the archive is closed.
+ **
+ ** @sa ::vl_archive_writer_add_kmeans
+ **/
+
+VlKMeans *
+vl_archive_new_kmeans (VlArchive const * self, char const * name)
+{
+  VlArchiveSection const * centers ;
+  VlArchiveSection const * paramsSection ;
+  vl_uint64 const * params ;
+  VlKMeans * kmeans ;
+  vl_type dataType ;
+
+  if ((dataType = _vl_archive_get_model_data_type (self, name, "centers")) == 0 ||
+      (centers = _vl_archive_get_model_section (self, name, "centers", dataType,
+                                                vl_get_type_size (dataType), 2)) == NULL ||
+      (paramsSection = _vl_archive_get_model_section (self, name, "params", VL_TYPE_UINT64,
+                                                      sizeof(vl_uint64), 1)) == NULL) {
+    return NULL ;
+  }
+  params = vl_archive_get_section_data (self, paramsSection) ;
+  if (paramsSection->dimensions[0] < VL_KMEANS_NUM_PARAMS ||
+      params[0] > VlKernelJS ||
+      params[1] > VlKMeansANN ||
+      params[2] > VlKMeansPlusPlus ||
+      centers->dimensions[0] == 0 || centers->dimensions[1] == 0) {
+    vl_set_last_error (VL_ERR_BAD_ARG, "The archive K-means '%s' is invalid.", name) ;
+    return NULL ;
+  }
+
+  kmeans = vl_kmeans_new (dataType, (VlVectorComparisonType) params[0]) ;
+  vl_kmeans_set_algorithm (kmeans, (VlKMeansAlgorithm) params[1]) ;
+  vl_kmeans_set_initialization (kmeans, (VlKMeansInitialization) params[2]) ;
+  vl_kmeans_set_num_repetitions (kmeans, (vl_size) VL_MAX(params[3], 1)) ;
+  vl_kmeans_set_max_num_iterations (kmeans, (vl_size) params[4]) ;
+  vl_kmeans_set_max_num_comparisons (kmeans, (vl_size) params[5]) ;
+  vl_kmeans_set_num_trees (kmeans, (vl_size) VL_MAX(params[6], 1)) ;
+  vl_kmeans_set_centers (kmeans, vl_archive_get_section_data (self, centers),
+                         (vl_size) centers->dimensions[0],
+                         (vl_size) centers->dimensions[1]) ;
+  return kmeans ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Create a GMM from an archive
+ ** @param self archive.
+ ** @param name model name.
+ ** @return new GMM object or @c NULL on error.
+ **
+ ** The parameters are copied, so that the object remains valid after
+ ** the archive is closed.
+ **
+ ** @sa ::vl_archive_writer_add_gmm
+ **/
+
+VlGMM *
+vl_archive_new_gmm (VlArchive const * self, char const * name)
+{
+  VlArchiveSection const * means ;
+  VlArchiveSection const * covariances ;
+  VlArchiveSection const * priors ;
+  VlGMM * gmm ;
+  vl_type dataType ;
+  vl_size typeSize ;
+
+  if ((dataType = _vl_archive_get_model_data_type (self, name, "means")) == 0) {
+    return NULL ;
+  }
+  typeSize = vl_get_type_size (dataType) ;
+  if ((means = _vl_archive_get_model_section (self, name, "means", dataType, typeSize, 2)) == NULL ||
+      (covariances = _vl_archive_get_model_section (self, name, "covariances", dataType, typeSize, 2)) == NULL ||
+      (priors = _vl_archive_get_model_section (self, name, "priors", dataType, typeSize, 1)) == NULL) {
+    return NULL ;
+  }
+  if (means->dimensions[0] == 0 || means->dimensions[1] == 0 ||
+      covariances->dimensions[0] != means->dimensions[0] ||
+      covariances->dimensions[1] != means->dimensions[1] ||
+      priors->dimensions[0] != means->dimensions[1]) {
+    vl_set_last_error (VL_ERR_BAD_ARG, "The archive GMM '%s' is invalid.", name) ;
+    return NULL ;
+  }
+
+  gmm = vl_gmm_new (dataType, (vl_size) means->dimensions[0], (vl_size) means->dimensions[1]) ;
+  vl_gmm_set_means (gmm, vl_archive_get_section_data (self, means)) ;
+  vl_gmm_set_covariances (gmm, vl_archive_get_section_data (self, covariances)) ;
+  vl_gmm_set_priors (gmm, vl_archive_get_section_data (self, priors)) ;
+  return gmm ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Check the search layout of a KD-tree read from an archive
+ ** @param nodes nodes of the breadth-first layout.
+ ** @param numNodes number of nodes (including the padding).
+ ** @param dataIndex data index of the tree.
+ ** @param numData number of data points.
+ ** @param dimension data dimension.
+ ** @param maxNumLeafData maximum number of points in a leaf.
+ ** @param numLeafData largest number of points in a leaf (out).
+ ** @return @c VL_TRUE if the layout can be searched safely.
+ **
+ ** The nodes must form a tree in the breadth-first order produced by
+ ** the KD-forest, so that every node is reached exactly once, split
+ ** dimensions must be smaller than @a dimension, leaves must cover a
+ ** range of at most @a maxNumLeafData points and the data index must
+ ** refer to existing points.
+ **/
+
+static vl_bool
+_vl_archive_check_kdtree (VlKDTreeFlatNode const * nodes, vl_size numNodes,
+                          VlKDTreeDataIndexEntry const * dataIndex, vl_size numData,
+                          vl_size dimension, vl_size maxNumLeafData,
+                          vl_size * numLeafData)
+{
+  vl_uindex nextChild = VL_KDTREE_FLAT_ROOT + 1 ;
+  vl_uindex ni, di ;
+
+  *numLeafData = 0 ;
+
+  for (ni = VL_KDTREE_FLAT_ROOT ; ni < numNodes ; ++ni) {
+    VlKDTreeFlatNode const * node = nodes + ni ;
+    /* the node must be the child of a previous one */
+    if (ni >= nextChild) return VL_FALSE ;
+    if (node->child >= 0) {
+      if ((vl_uindex) node->child != nextChild ||
+          nextChild + 1 >= numNodes ||
+          node->splitDimension >= dimension) {
+        return VL_FALSE ;
+      }
+      nextChild += 2 ;
+    } else {
+      vl_uindex begin = (vl_uindex) (- (vl_int64) node->child - 1) ;
+      vl_uindex end = node->splitDimension ;
+      if (begin > end || end > numData || end - begin > maxNumLeafData) {
+        return VL_FALSE ;
+      }
+      *numLeafData = VL_MAX(*numLeafData, end - begin) ;
+    }
+  }
+  if (nextChild != numNodes) return VL_FALSE ;
+
+  for (di = 0 ; di < numData ; ++di) {
+    if (dataIndex[di].index < 0 || (vl_size) dataIndex[di].index >= numData) {
+      return VL_FALSE ;
+    }
+  }
+  return VL_TRUE ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Create a KD-forest from an archive
+ ** @param self archive.
+ ** @param name model name.
+ ** @return new KD-forest object or @c NULL on error.
+ **
+ ** The forest uses the search layout stored in the archive without
+ ** copying it, so it can be queried immediately. The nodes and data
+ ** indexes are read once to validate them, while the pages of the
+ ** data are loaded on demand by the queries. The archive must not be
+ ** closed before the forest is deleted. The forest does not refer to
+ ** the original data and its leaf size cannot be changed.
+ **
+ ** The leaf size and the maximum number of points in a leaf stored in
+ ** the archive cannot exceed the number of points. The latter is
+ ** recomputed from the validated leaves, as the searchers size their
+ ** buffers after it.
+ **
+ ** @sa ::vl_archive_writer_add_kdforest
+ **/
+
+VlKDForest *
+vl_archive_new_kdforest (VlArchive const * self, char const * name)
+{
+  VlArchiveSection const * paramsSection ;
+  VlArchiveSection const * treesSection ;
+  vl_uint64 const * params ;
+  vl_uint64 const * trees ;
+  VlKDForest * forest ;
+  vl_size numTrees, numData, dimension ;
+  vl_size maxNumLeafData = 0 ;
+  vl_type dataType ;
+  char suffix [32] ;
+  vl_uindex ti ;
+
+  if ((paramsSection = _vl_archive_get_model_section (self, name, "params", VL_TYPE_UINT64,
+                                                      sizeof(vl_uint64), 1)) == NULL ||
+      (treesSection = _vl_archive_get_model_section (self, name, "trees", VL_TYPE_UINT64,
+                                                     sizeof(vl_uint64), 2)) == NULL) {
+    return NULL ;
+  }
+  params = vl_archive_get_section_data (self, paramsSection) ;
+  trees = vl_archive_get_section_data (self, treesSection) ;
+  if (paramsSection->dimensions[0] < VL_KDFOREST_NUM_PARAMS ||
+      (params[0] != VL_TYPE_FLOAT && params[0] != VL_TYPE_DOUBLE) ||
+      params[1] == 0 || params[2] == 0 || params[3] > VlKernelJS ||
+      params[4] == 0 || params[4] >= 0x7fffffff ||
+      params[5] == 0 || params[5] > params[4] || params[6] > params[4] ||
+      params[7] > VL_KDTREE_MEAN ||
+      treesSection->dimensions[0] != 3 || treesSection->dimensions[1] != params[2]) {
+    vl_set_last_error (VL_ERR_BAD_ARG, "The archive KD-forest '%s' is invalid.", name) ;
+    return NULL ;
+  }
+  dataType = (vl_type) params[0] ;
+  dimension = (vl_size) params[1] ;
+  numTrees = (vl_size) params[2] ;
+  numData = (vl_size) params[4] ;
+
+  /* check all the sections before creating the forest */
+  for (ti = 0 ; ti < numTrees ; ++ti) {
+    VlArchiveSection const * section ;
+    VlKDTreeFlatNode const * nodes ;
+    vl_size numLeafData ;
+    sprintf (suffix, "nodes%u", (unsigned) ti) ;
+    section = _vl_archive_get_model_section (self, name, suffix, 0, sizeof(VlKDTreeFlatNode), 1) ;
+    if (section == NULL) return NULL ;
+    if (section->dimensions[0] != trees[3*ti] || section->dimensions[0] < 2) goto invalid ;
+    nodes = vl_archive_get_section_data (self, section) ;
+    sprintf (suffix, "index%u", (unsigned) ti) ;
+    section = _vl_archive_get_model_section (self, name, suffix, 0, sizeof(VlKDTreeDataIndexEntry), 1) ;
+    if (section == NULL) return NULL ;
+    if (section->dimensions[0] != numData) goto invalid ;
+    if (! _vl_archive_check_kdtree (nodes, (vl_size) trees[3*ti],
+                                    vl_archive_get_section_data (self, section), numData,
+                                    dimension, (vl_size) params[6], &numLeafData)) {
+      goto invalid ;
+    }
+    maxNumLeafData = VL_MAX(maxNumLeafData, numLeafData) ;
+    sprintf (suffix, "data%u", (unsigned) ti) ;
+    section = _vl_archive_get_model_section (self, name, suffix, dataType, vl_get_type_size (dataType), 2) ;
+    if (section == NULL) return NULL ;
+    if (section->dimensions[0] != dimension || section->dimensions[1] != numData) goto invalid ;
+  }
+
+  forest = vl_kdforest_new (dataType, dimension, numTrees, (VlVectorComparisonType) params[3]) ;
+  forest->numData = numData ;
+  forest->leafSize = (vl_size) params[5] ;
+  forest->maxNumLeafData = maxNumLeafData ;
+  forest->thresholdingMethod = (VlKDTreeThresholdingMethod) params[7] ;
+  forest->searchMaxNumComparisons = (vl_size) params[8] ;
+  forest->sharedLayout = VL_TRUE ;
+  forest->trees = vl_calloc (sizeof(VlKDTree*), numTrees) ;
+  if (forest->trees == NULL) goto alloc_error ;
+  forest->maxNumNodes = 0 ;
+  for (ti = 0 ; ti < numTrees ; ++ti) {
+    VlKDTree * tree = vl_calloc (sizeof(VlKDTree), 1) ;
+    char sectionName [VL_ARCHIVE_MAX_NAME_LENGTH] ;
+    if (tree == NULL) goto alloc_error ;
+    tree->numFlatNodes = (vl_size) trees[3*ti+0] ;
+    tree->numUsedNodes = (vl_size) trees[3*ti+1] ;
+    tree->depth = (unsigned int) trees[3*ti+2] ;
+    sprintf (suffix, "nodes%u", (unsigned) ti) ;
+    _vl_archive_compose_name (sectionName, name, suffix) ;
+    tree->flatNodes = (VlKDTreeFlatNode*)
+      vl_archive_get_section_data (self, vl_archive_find_section (self, sectionName)) ;
+    sprintf (suffix, "index%u", (unsigned) ti) ;
+    _vl_archive_compose_name (sectionName, name, suffix) ;
+    tree->dataIndex = (VlKDTreeDataIndexEntry*)
+      vl_archive_get_section_data (self, vl_archive_find_section (self, sectionName)) ;
+    sprintf (suffix, "data%u", (unsigned) ti) ;
+    _vl_archive_compose_name (sectionName, name, suffix) ;
+    tree->flatData = (void*)
+      vl_archive_get_section_data (self, vl_archive_find_section (self, sectionName)) ;
+    forest->trees[ti] = tree ;
+    forest->maxNumNodes += tree->numFlatNodes ;
+  }
+  forest->flattened = VL_TRUE ;
+  return forest ;
+
+alloc_error:
+  vl_kdforest_delete (forest) ;
+  vl_set_last_error (VL_ERR_ALLOC, NULL) ;
+  return NULL ;
+
+invalid:
+  vl_set_last_error (VL_ERR_BAD_ARG, "The archive KD-forest '%s' is invalid.", name) ;
+  return NULL ;
+}
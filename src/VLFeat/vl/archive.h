@@ -0,0 +1,118 @@
+/** @file archive.h
+ ** @brief Binary archive of arrays and models (@ref archive)
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_ARCHIVE_H
+#define VL_ARCHIVE_H
+
+#include "generic.h"
+#include "kmeans.h"
+#include "gmm.h"
+#include "kdtree.h"
+
+/** @brief Version of the archive format */
+#define VL_ARCHIVE_VERSION 1
+
+/** @brief Alignment (in bytes) of the archive sections */
+#define VL_ARCHIVE_ALIGNMENT 64
+
+/** @brief Maximum length of a section name (including the terminating zero) */
+#define VL_ARCHIVE_MAX_NAME_LENGTH 64
+
+/** @brief Maximum number of dimensions of a section */
+#define VL_ARCHIVE_MAX_NUM_DIMENSIONS 4
+
+/** @brief Archive section
+ **
+ ** A section is an array of @c numDimensions dimensions, stored in
+ ** column-major order. Elements are either numbers of type @c
+ ** dataType or, if @c dataType is zero, opaque records of @c
+ ** elementSize bytes. The structure is stored as is in the archive
+ ** table of contents.
+ **/
+
+typedef struct _VlArchiveSection
+{
+  char name [VL_ARCHIVE_MAX_NAME_LENGTH] ;  /**< section name. */
+  vl_uint32 dataType ;                      /**< data type (or 0). */
+  vl_uint32 elementSize ;                   /**< size of an element in bytes. */
+  vl_uint32 numDimensions ;                 /**< number of dimensions. */
+  vl_uint32 reserved ;                      /**< reserved (zero). */
+  vl_uint64 dimensions [VL_ARCHIVE_MAX_NUM_DIMENSIONS] ; /**< dimensions. */
+  vl_uint64 offset ;                        /**< offset of the data in the file. */
+  vl_uint64 size ;                          /**< size of the data in bytes. */
+} VlArchiveSection ;
+
+#ifndef __DOXYGEN__
+struct _VlArchive ;
+struct _VlArchiveWriter ;
+typedef struct _VlArchive VlArchive ;
+typedef struct _VlArchiveWriter VlArchiveWriter ;
+#else
+/** @brief Archive opened for reading */
+typedef OPAQUE VlArchive ;
+/** @brief Archive opened for writing */
+typedef OPAQUE VlArchiveWriter ;
+#endif
+
+/** @name Write an archive
+ ** @{
+ **/
+VL_EXPORT VlArchiveWriter * vl_archive_writer_open (char const * fileName) ;
+VL_EXPORT int vl_archive_writer_close (VlArchiveWriter * self) ;
+
+VL_EXPORT int vl_archive_writer_add (VlArchiveWriter * self,
+                                     char const * name,
+                                     vl_type dataType,
+                                     vl_size numDimensions,
+                                     vl_size const * dimensions,
+                                     void const * data) ;
+
+VL_EXPORT int vl_archive_writer_add_records (VlArchiveWriter * self,
+                                             char const * name,
+                                             vl_size elementSize,
+                                             vl_size numElements,
+                                             void const * data) ;
+
+VL_EXPORT int vl_archive_writer_add_kmeans (VlArchiveWriter * self,
+                                            char const * name,
+                                            VlKMeans const * kmeans) ;
+
+VL_EXPORT int vl_archive_writer_add_gmm (VlArchiveWriter * self,
+                                         char const * name,
+                                         VlGMM const * gmm) ;
+
+VL_EXPORT int vl_archive_writer_add_kdforest (VlArchiveWriter * self,
+                                              char const * name,
+                                              VlKDForest const * forest) ;
+/** @} */
+
+/** @name Read an archive
+ ** @{
+ **/
+VL_EXPORT VlArchive * vl_archive_open (char const * fileName) ;
+VL_EXPORT void vl_archive_close (VlArchive * self) ;
+
+VL_EXPORT vl_size vl_archive_get_num_sections (VlArchive const * self) ;
+VL_EXPORT VlArchiveSection const * vl_archive_get_section (VlArchive const * self,
+                                                           vl_uindex index) ;
+VL_EXPORT VlArchiveSection const * vl_archive_find_section (VlArchive const * self,
+                                                            char const * name) ;
+VL_EXPORT void const * vl_archive_get_section_data (VlArchive const * self,
+                                                    VlArchiveSection const * section) ;
+
+VL_EXPORT VlKMeans * vl_archive_new_kmeans (VlArchive const * self, char const * name) ;
+VL_EXPORT VlGMM * vl_archive_new_gmm (VlArchive const * self, char const * name) ;
+VL_EXPORT VlKDForest * vl_archive_new_kdforest (VlArchive const * self, char const * name) ;
+/** @} */
+
+/* VL_ARCHIVE_H */
+#endif
@@ -105,7 +105,15 @@ This example code:
   orientation in patches.
 - Optionally calls ::vl_covdet_extract_patch_for_frame to extract a
   normalized feature patch, for example to compute an invariant
-  feature descriptor.
+  feature descriptor. ::vl_covdet_extract_patches does the same for
+  all the features at once.
+
+The cornerness measure is computed for all the scale space levels in
+parallel (see ::vl_set_num_threads). Likewise, the affine shape,
+orientations, Laplacian scales, and patches are computed for all the
+features in parallel, using separate buffers in each thread. The
+features are stored in the same order and have the same values
+regardless of the number of threads.
 
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ -->
 @page covdet-fundamentals Covariant detectors fundamentals
@@ -1451,6 +1459,29 @@ vl_refine_local_extreum_2 (VlCovDetExtremum2 * refined,
 #define VL_COVDET_HESSIAN_DEF_PEAK_THRESHOLD 0.003
 #define VL_COVDET_HESSIAN_DEF_EDGE_THRESHOLD 10.0
 
+/** @internal
+ ** @brief Buffers used to process one feature
+ **
+ ** The functions processing all the features at once use one of
+ ** these for each task. The patch and smoothing buffers are managed
+ ** with @c malloc rather than ::vl_malloc as they are grown from
+ ** worker threads.
+ **/
+
+typedef struct _VlCovDetWorkspace
+{
+  float * patch ;            /**< padded copy of the image (if needed). */
+  vl_size patchBufferSize ;  /**< size of @c patch in bytes. */
+  float * smoothBuffer ;     /**< filters and intermediate image for smoothing. */
+  vl_size smoothBufferSize ; /**< size of @c smoothBuffer in bytes. */
+  VlCovDetFeatureOrientation orientations [VL_COVDET_MAX_NUM_ORIENTATIONS] ;
+  VlCovDetFeatureLaplacianScale scales [VL_COVDET_MAX_NUM_LAPLACIAN_SCALES] ;
+  float aaPatch [(2*VL_COVDET_AA_PATCH_RESOLUTION+1)*(2*VL_COVDET_AA_PATCH_RESOLUTION+1)] ;
+  float aaPatchX [(2*VL_COVDET_AA_PATCH_RESOLUTION+1)*(2*VL_COVDET_AA_PATCH_RESOLUTION+1)] ;
+  float aaPatchY [(2*VL_COVDET_AA_PATCH_RESOLUTION+1)*(2*VL_COVDET_AA_PATCH_RESOLUTION+1)] ;
+  float lapPatch [(2*VL_COVDET_LAP_PATCH_RESOLUTION+1)*(2*VL_COVDET_LAP_PATCH_RESOLUTION+1)] ;
+} VlCovDetWorkspace ;
+
 /** @brief Covariant feature detector */
 struct _VlCovDet
 {
@@ -1470,20 +1501,13 @@ struct _VlCovDet
   vl_size numFeatures ;
   vl_size numFeatureBufferSize ;
 
-  float * patch ;
-  vl_size patchBufferSize ;
+  VlCovDetWorkspace workspace ; /**< buffers for the @c _for_frame functions. */
 
   vl_bool transposed ;
-  VlCovDetFeatureOrientation orientations [VL_COVDET_MAX_NUM_ORIENTATIONS] ;
-  VlCovDetFeatureLaplacianScale scales [VL_COVDET_MAX_NUM_LAPLACIAN_SCALES] ;
 
   vl_bool aaAccurateSmoothing ;
-  float aaPatch [(2*VL_COVDET_AA_PATCH_RESOLUTION+1)*(2*VL_COVDET_AA_PATCH_RESOLUTION+1)] ;
-  float aaPatchX [(2*VL_COVDET_AA_PATCH_RESOLUTION+1)*(2*VL_COVDET_AA_PATCH_RESOLUTION+1)] ;
-  float aaPatchY [(2*VL_COVDET_AA_PATCH_RESOLUTION+1)*(2*VL_COVDET_AA_PATCH_RESOLUTION+1)] ;
   float aaMask [(2*VL_COVDET_AA_PATCH_RESOLUTION+1)*(2*VL_COVDET_AA_PATCH_RESOLUTION+1)] ;
 
-  float lapPatch [(2*VL_COVDET_LAP_PATCH_RESOLUTION+1)*(2*VL_COVDET_LAP_PATCH_RESOLUTION+1)] ;
   float laplacians [(2*VL_COVDET_LAP_PATCH_RESOLUTION+1)*(2*VL_COVDET_LAP_PATCH_RESOLUTION+1)*VL_COVDET_LAP_NUM_LEVELS] ;
   vl_size numFeaturesWithNumScales [VL_COVDET_MAX_NUM_LAPLACIAN_SCALES + 1] ;
 }  ;
@@ -1537,8 +1561,10 @@ vl_covdet_new (VlCovDetMethod method)
   self->features = NULL ;
   self->numFeatures = 0 ;
   self->numFeatureBufferSize = 0 ;
-  self->patch = NULL ;
-  self->patchBufferSize = 0 ;
+  self->workspace.patch = NULL ;
+  self->workspace.patchBufferSize = 0 ;
+  self->workspace.smoothBuffer = NULL ;
+  self->workspace.smoothBufferSize = 0 ;
   self->transposed = VL_FALSE ;
   self->aaAccurateSmoothing = VL_COVDET_AA_ACCURATE_SMOOTHING ;
 
@@ -1631,10 +1657,190 @@ void
 vl_covdet_delete (VlCovDet * self)
 {
   vl_covdet_reset(self) ;
-  if (self->patch) vl_free (self->patch) ;
+  if (self->workspace.patch) free (self->workspace.patch) ;
+  if (self->workspace.smoothBuffer) free (self->workspace.smoothBuffer) ;
   vl_free(self) ;
 }
 
+/** @internal
+ ** @brief Create the workspaces for processing features in parallel
+ ** @param numWorkspaces number of workspaces (one for each task).
+ ** @return new workspaces (or @c NULL if memory is insufficient).
+ **
+ ** The function must be called from the thread that processes the
+ ** features, before starting the parallel loop.
+ **/
+
+static VlCovDetWorkspace *
+_vl_covdet_new_workspaces (vl_size numWorkspaces)
+{
+  return vl_calloc(sizeof(VlCovDetWorkspace), numWorkspaces) ;
+}
+
+/** @internal
+ ** @brief Delete the workspaces
+ ** @param workspaces workspaces (may be @c NULL).
+ ** @param numWorkspaces number of workspaces.
+ **/
+
+static void
+_vl_covdet_delete_workspaces (VlCovDetWorkspace * workspaces, vl_size numWorkspaces)
+{
+  vl_uindex t ;
+  if (workspaces) {
+    for (t = 0 ; t < numWorkspaces ; ++t) {
+      if (workspaces[t].patch) free (workspaces[t].patch) ;
+      if (workspaces[t].smoothBuffer) free (workspaces[t].smoothBuffer) ;
+    }
+    vl_free (workspaces) ;
+  }
+}
+
+/** @internal
+ ** @brief Make room in the patch buffer of a workspace
+ ** @param workspace workspace.
+ ** @param size required size in bytes.
+ ** @return error code.
+ **
+ ** The function does not set the last error as it may run in a
+ ** worker thread.
+ **/
+
+static int
+_vl_covdet_workspace_reserve_patch (VlCovDetWorkspace * workspace, vl_size size)
+{
+  float * patch ;
+  if (size <= workspace->patchBufferSize) return VL_ERR_OK ;
+  patch = realloc (workspace->patch, size) ;
+  if (patch == NULL) return VL_ERR_ALLOC ;
+  workspace->patch = patch ;
+  workspace->patchBufferSize = size ;
+  return VL_ERR_OK ;
+}
+
+/** @internal
+ ** @brief Smooth an image with a Gaussian filter
+ ** @param workspace workspace.
+ ** @param image image (smoothed in place).
+ ** @param width image width.
+ ** @param height image height.
+ ** @param sigmax standard deviation along the first axis.
+ ** @param sigmay standard deviation along the second axis.
+ ** @return error code.
+ **
+ ** The function computes the same result as ::vl_imsmooth_f, but it
+ ** stores the filters and the intermediate image in @a workspace, so
+ ** that it can run in a worker thread.
+ **/
+
+static int
+_vl_covdet_workspace_smooth (VlCovDetWorkspace * workspace,
+                             float * image, vl_size width, vl_size height,
+                             double sigmax, double sigmay)
+{
+  vl_size widths [2] = {vl_ceil_d(sigmax * 3.0), vl_ceil_d(sigmay * 3.0)} ;
+  double sigmas [2] = {sigmax, sigmay} ;
+  vl_size size = (2*widths[0]+1 + 2*widths[1]+1 + width*height) * sizeof(float) ;
+  float * filters [2] ;
+  float * buffer ;
+  vl_index i, j ;
+
+  if (size > workspace->smoothBufferSize) {
+    float * smoothBuffer = realloc (workspace->smoothBuffer, size) ;
+    if (smoothBuffer == NULL) return VL_ERR_ALLOC ;
+    workspace->smoothBuffer = smoothBuffer ;
+    workspace->smoothBufferSize = size ;
+  }
+  filters[0] = workspace->smoothBuffer ;
+  filters[1] = filters[0] + 2*widths[0]+1 ;
+  buffer = filters[1] + 2*widths[1]+1 ;
+
+  for (j = 0 ; j < 2 ; ++j) {
+    float * filter = filters[j] ;
+    vl_index width = (signed)widths[j] ;
+    float mass = 1.0f ;
+    filter[width] = 1.0f ;
+    for (i = 1 ; i <= width ; ++i) {
+      double x = (double)i / sigmas[j] ;
+      double g = exp(-0.5 * x * x) ;
+      mass += g + g ;
+      filter[width-i] = g ;
+      filter[width+i] = g ;
+    }
+    for (i = 0 ; i < 2*width+1 ; ++i) {filter[i] /= mass ;}
+  }
+
+  vl_imconvcol_vf (buffer, height,
+                   image, width, height, width,
+                   filters[1], -(signed)widths[1], widths[1],
+                   1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+
+  vl_imconvcol_vf (image, width,
+                   buffer, height, width, height,
+                   filters[0], -(signed)widths[0], widths[0],
+                   1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+  return VL_ERR_OK ;
+}
+
+/** @internal @brief Data of the loops processing the stored features */
+typedef struct _VlCovDetLoop
+{
+  VlCovDet * self ;                   /**< object. */
+  VlCovDetWorkspace * workspaces ;    /**< one workspace for each task. */
+  int * errors ;                      /**< one error code for each task (out). */
+  VlFrameOrientedEllipse * adapted ;  /**< adapted frames (out). */
+  int * status ;                      /**< affine adaptation status (out). */
+  VlCovDetFeatureOrientation * orientations ; /**< orientations (out). */
+  VlCovDetFeatureLaplacianScale * scales ;    /**< Laplacian scales (out). */
+  vl_size * numDetected ;             /**< number of orientations or scales (out). */
+  float * patches ;                   /**< patches (out). */
+  vl_size resolution ;                /**< patch resolution. */
+  double extent ;                     /**< patch extent. */
+  double sigma ;                      /**< patch smoothing. */
+  VlScaleSpaceGeometry geometry ;     /**< cornerness scale space geometry. */
+} VlCovDetLoop ;
+
+/** @internal
+ ** @brief Run a loop over the stored features or the scale space levels
+ ** @param self object.
+ ** @param loop loop data (the @c self, @c workspaces and @c errors fields are set).
+ ** @param numIterations number of iterations.
+ ** @param fn range function.
+ ** @return error code.
+ **
+ ** The workspaces are allocated by the calling thread, one for
+ ** each task, so that @a fn does not need to call ::vl_malloc.
+ **/
+
+static int
+_vl_covdet_parallel_for (VlCovDet * self, VlCovDetLoop * loop,
+                         vl_size numIterations, VlParallelForFunction fn)
+{
+  vl_size numTasks = VL_MIN(vl_get_max_threads(), VL_MAX(numIterations, 1)) ;
+  vl_uindex t ;
+  int err = VL_ERR_OK ;
+
+  loop->self = self ;
+  loop->workspaces = _vl_covdet_new_workspaces (numTasks) ;
+  loop->errors = vl_calloc (sizeof(int), numTasks) ;
+  if (loop->workspaces == NULL || loop->errors == NULL) {
+    err = VL_ERR_ALLOC ;
+    goto done ;
+  }
+  vl_parallel_for (numIterations, numTasks, fn, loop) ;
+  for (t = 0 ; t < numTasks ; ++t) {
+    if (loop->errors[t]) err = loop->errors[t] ;
+  }
+
+done:
+  _vl_covdet_delete_workspaces (loop->workspaces, numTasks) ;
+  if (loop->errors) vl_free (loop->errors) ;
+  loop->workspaces = NULL ;
+  loop->errors = NULL ;
+  if (err) return vl_set_last_error(err, NULL) ;
+  return VL_ERR_OK ;
+}
+
 /** @brief Append a feature to the internal buffer.
  ** @param self object.
  ** @param feature a pointer to the feature to append.
@@ -1725,8 +1931,7 @@ vl_covdet_put_image (VlCovDet * self,
     self->gss = vl_scalespace_new_with_geometry(geom) ;
     if (self->gss == NULL) return VL_ERR_ALLOC ;
   }
-  vl_scalespace_put_image(self->gss, image) ;
-  return VL_ERR_OK ;
+  return vl_scalespace_put_image(self->gss, image) ;
 }
 
 /* ---------------------------------------------------------------- */
@@ -1823,6 +2028,7 @@ _vl_det_hessian_response (float * hessian,
 }
 
 /** @brief Scale-normalised Harris response
+ ** @param workspace buffers.
  ** @param harris output image.
  ** @param image input image.
  ** @param width image width.
@@ -1831,10 +2037,15 @@ _vl_det_hessian_response (float * hessian,
  ** @param sigma Gaussian smoothing of the input image.
  ** @param sigmaI integration scale.
  ** @param alpha factor in the definition of the Harris score.
+ ** @return error code.
+ **
+ ** The second moment images are stored in the patch buffer of
+ ** @a workspace.
  **/
 
-static void
-_vl_harris_response (float * harris,
+static int
+_vl_harris_response (VlCovDetWorkspace * workspace,
+                     float * harris,
                      float const * image,
                      vl_size width, vl_size height,
                      double step, double sigma,
@@ -1842,14 +2053,17 @@ _vl_harris_response (float * harris,
 {
   float factor = (float) pow(sigma/step, 4.0) ;
   vl_index k ;
+  int err ;
 
   float * LxLx ;
   float * LyLy ;
   float * LxLy ;
 
-  LxLx = vl_malloc(sizeof(float) * width * height) ;
-  LyLy = vl_malloc(sizeof(float) * width * height) ;
-  LxLy = vl_malloc(sizeof(float) * width * height) ;
+  err = _vl_covdet_workspace_reserve_patch(workspace, 3 * sizeof(float) * width * height) ;
+  if (err) return err ;
+  LxLx = workspace->patch ;
+  LyLy = LxLx + width * height ;
+  LxLy = LyLy + width * height ;
 
   vl_imgradient_f (LxLx, LyLy, 1, width, image, width, height, width) ;
 
@@ -1861,14 +2075,17 @@ _vl_harris_response (float * harris,
     LxLy[k] = dx*dy ;
   }
 
-  vl_imsmooth_f(LxLx, width, LxLx, width, height, width,
-                sigmaI / step, sigmaI / step) ;
+  err = _vl_covdet_workspace_smooth(workspace, LxLx, width, height,
+                                    sigmaI / step, sigmaI / step) ;
+  if (err) return err ;
 
-  vl_imsmooth_f(LyLy, width, LyLy, width, height, width,
-                sigmaI / step, sigmaI / step) ;
+  err = _vl_covdet_workspace_smooth(workspace, LyLy, width, height,
+                                    sigmaI / step, sigmaI / step) ;
+  if (err) return err ;
 
-  vl_imsmooth_f(LxLy, width, LxLy, width, height, width,
-                sigmaI / step, sigmaI / step) ;
+  err = _vl_covdet_workspace_smooth(workspace, LxLy, width, height,
+                                    sigmaI / step, sigmaI / step) ;
+  if (err) return err ;
 
   for (k = 0 ; k < (signed)(width * height) ; ++k) {
     float a = LxLx[k] ;
@@ -1880,10 +2097,7 @@ _vl_harris_response (float * harris,
 
     harris[k] = factor * (determinant - alpha * (trace * trace)) ;
   }
-
-  vl_free(LxLy) ;
-  vl_free(LyLy) ;
-  vl_free(LxLx) ;
+  return VL_ERR_OK ;
 }
 
 /** @brief Difference of Gaussian
@@ -1910,22 +2124,78 @@ _vl_dog_response (float * dog,
 /*                                                  Detect features */
 /* ---------------------------------------------------------------- */
 
+/** @internal
+ ** @brief Compute the cornerness for a range of scale space levels
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first level.
+ ** @param end last level plus one.
+ **/
+
+static void
+_vl_covdet_detect_range (void * loop_, vl_uindex task,
+                         vl_uindex begin, vl_uindex end)
+{
+  VlCovDetLoop * loop = loop_ ;
+  VlCovDet * self = loop->self ;
+  VlScaleSpaceGeometry cgeom = loop->geometry ;
+  vl_index numSubdivisions = cgeom.octaveLastSubdivision - cgeom.octaveFirstSubdivision + 1 ;
+  vl_uindex l ;
+  for (l = begin ; l < end ; ++l) {
+    vl_index o = cgeom.firstOctave + (signed)l / numSubdivisions ;
+    vl_index s = cgeom.octaveFirstSubdivision + (signed)l % numSubdivisions ;
+    VlScaleSpaceOctaveGeometry oct = vl_scalespace_get_octave_geometry(self->css, o) ;
+    float * level = vl_scalespace_get_level(self->gss, o, s) ;
+    float * clevel = vl_scalespace_get_level(self->css, o, s) ;
+    double sigma = vl_scalespace_get_level_sigma(self->css, o, s) ;
+    switch (self->method) {
+      case VL_COVDET_METHOD_DOG:
+        _vl_dog_response(clevel,
+                         vl_scalespace_get_level(self->gss, o, s + 1),
+                         level,
+                         oct.width, oct.height) ;
+        break ;
+
+      case VL_COVDET_METHOD_HARRIS_LAPLACE:
+      case VL_COVDET_METHOD_MULTISCALE_HARRIS:
+        if (_vl_harris_response(loop->workspaces + task, clevel,
+                                level, oct.width, oct.height, oct.step,
+                                sigma, 1.4 * sigma, 0.05)) {
+          loop->errors[task] = VL_ERR_ALLOC ;
+          return ;
+        }
+        break ;
+
+      case VL_COVDET_METHOD_HESSIAN:
+      case VL_COVDET_METHOD_HESSIAN_LAPLACE:
+      case VL_COVDET_METHOD_MULTISCALE_HESSIAN:
+        _vl_det_hessian_response(clevel, level, oct.width, oct.height, oct.step, sigma) ;
+        break ;
+
+      default:
+        assert(0) ;
+    }
+  }
+}
+
 /** @brief Detect scale-space features
  ** @param self object.
+ ** @return error code.
  **
  ** This function runs the configured feature detector on the image
  ** that was passed by using ::vl_covdet_put_image.
+ **
+ ** The function may fail with ::VL_ERR_ALLOC if memory is
+ ** insufficient.
  **/
 
-void
+int
 vl_covdet_detect (VlCovDet * self)
 {
   VlScaleSpaceGeometry geom = vl_scalespace_get_geometry(self->gss) ;
   VlScaleSpaceGeometry cgeom ;
-  float * levelxx = NULL ;
-  float * levelyy = NULL ;
-  float * levelxy = NULL ;
   vl_index o, s ;
+  int err ;
 
   assert (self) ;
   assert (self->gss) ;
@@ -1945,47 +2215,17 @@ vl_covdet_detect (VlCovDet * self)
     if (self->css) vl_scalespace_delete(self->css) ;
     self->css = vl_scalespace_new_with_geometry(cgeom) ;
   }
-  if (self->method == VL_COVDET_METHOD_HARRIS_LAPLACE ||
-      self->method == VL_COVDET_METHOD_MULTISCALE_HARRIS) {
-    VlScaleSpaceOctaveGeometry oct = vl_scalespace_get_octave_geometry(self->gss, geom.firstOctave) ;
-    levelxx = vl_malloc(oct.width * oct.height * sizeof(float)) ;
-    levelyy = vl_malloc(oct.width * oct.height * sizeof(float)) ;
-    levelxy = vl_malloc(oct.width * oct.height * sizeof(float)) ;
-  }
 
   /* compute cornerness ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-  for (o = cgeom.firstOctave ; o <= cgeom.lastOctave ; ++o) {
-    VlScaleSpaceOctaveGeometry oct = vl_scalespace_get_octave_geometry(self->css, o) ;
-
-    for (s = cgeom.octaveFirstSubdivision ; s <= cgeom.octaveLastSubdivision ; ++s) {
-      float * level = vl_scalespace_get_level(self->gss, o, s) ;
-      float * clevel = vl_scalespace_get_level(self->css, o, s) ;
-      double sigma = vl_scalespace_get_level_sigma(self->css, o, s) ;
-      switch (self->method) {
-        case VL_COVDET_METHOD_DOG:
-          _vl_dog_response(clevel,
-                           vl_scalespace_get_level(self->gss, o, s + 1),
-                           level,
-                           oct.width, oct.height) ;
-          break ;
-
-        case VL_COVDET_METHOD_HARRIS_LAPLACE:
-        case VL_COVDET_METHOD_MULTISCALE_HARRIS:
-          _vl_harris_response(clevel,
-                              level, oct.width, oct.height, oct.step,
-                              sigma, 1.4 * sigma, 0.05) ;
-          break ;
-
-        case VL_COVDET_METHOD_HESSIAN:
-        case VL_COVDET_METHOD_HESSIAN_LAPLACE:
-        case VL_COVDET_METHOD_MULTISCALE_HESSIAN:
-          _vl_det_hessian_response(clevel, level, oct.width, oct.height, oct.step, sigma) ;
-          break ;
-
-        default:
-          assert(0) ;
-      }
-    }
+  {
+    /* all the levels are independent and are computed in parallel */
+    vl_size numSubdivisions = cgeom.octaveLastSubdivision - cgeom.octaveFirstSubdivision + 1 ;
+    vl_size numLevels = (cgeom.lastOctave - cgeom.firstOctave + 1) * numSubdivisions ;
+    VlCovDetLoop loop ;
+    memset(&loop, 0, sizeof(loop)) ;
+    loop.geometry = cgeom ;
+    err = _vl_covdet_parallel_for (self, &loop, numLevels, _vl_covdet_detect_range) ;
+    if (err) return err ;
   }
 
   /* find and refine local maxima ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -2088,7 +2328,8 @@ vl_covdet_detect (VlCovDet * self)
   switch (self->method) {
     case VL_COVDET_METHOD_HARRIS_LAPLACE :
     case VL_COVDET_METHOD_HESSIAN_LAPLACE :
-      vl_covdet_extract_laplacian_scales (self) ;
+      err = vl_covdet_extract_laplacian_scales (self) ;
+      if (err) return err ;
       break ;
     default:
       break ;
@@ -2129,10 +2370,7 @@ vl_covdet_detect (VlCovDet * self)
     }
     self->numFeatures = j ;
   }
-
-  if (levelxx) vl_free(levelxx) ;
-  if (levelyy) vl_free(levelyy) ;
-  if (levelxy) vl_free(levelxy) ;
+  return VL_ERR_OK ;
 }
 
 /* ---------------------------------------------------------------- */
@@ -2142,6 +2380,7 @@ vl_covdet_detect (VlCovDet * self)
 /** @internal
  ** @brief Helper for extracting patches
  ** @param self object.
+ ** @param workspace buffers.
  ** @param[out] sigma1 actual patch smoothing along the first axis.
  ** @param[out] sigma2 actual patch smoothing along the second axis.
  ** @param patch buffer.
@@ -2152,10 +2391,16 @@ vl_covdet_detect (VlCovDet * self)
  ** @param T_ translation from patch to image.
  ** @param d1 first singular value @a A.
  ** @param d2 second singular value of @a A.
+ ** @return error code.
+ **
+ ** The function may fail with ::VL_ERR_ALLOC if memory is
+ ** insufficient. It does not set the last error, so that it can run
+ ** in a worker thread.
  **/
 
 vl_bool
 vl_covdet_extract_patch_helper (VlCovDet * self,
+                                VlCovDetWorkspace * workspace,
                                 double * sigma1,
                                 double * sigma2,
                                 float * patch,
@@ -2306,15 +2551,14 @@ vl_covdet_extract_patch_helper (VlCovDet * self,
       vl_index patchWidth = x1i - x0i + 1 ;
       vl_index patchHeight = y1i - y0i + 1 ;
       vl_size patchBufferSize = patchWidth * patchHeight * sizeof(float) ;
-      if (patchBufferSize > self->patchBufferSize) {
-        int err = _vl_resize_buffer((void**)&self->patch, &self->patchBufferSize, patchBufferSize) ;
-        if (err) return vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+      if (_vl_covdet_workspace_reserve_patch(workspace, patchBufferSize)) {
+        return VL_ERR_ALLOC ;
       }
 
       if (pady0 < patchHeight - pady1) {
         /* start by filling the central horizontal band */
         for (yi = y0i + pady0 ; yi < y0i + patchHeight - pady1 ; ++ yi) {
-          float *dst = self->patch + (yi - y0i) * patchWidth ;
+          float *dst = workspace->patch + (yi - y0i) * patchWidth ;
           float const *src = level + yi * width + VL_MIN(VL_MAX(0, x0i),(signed)width-1) ;
           for (xi = x0i ; xi < x0i + padx0 ; ++xi) *dst++ = *src ;
           for ( ; xi < x0i + patchWidth - padx1 - 2 ; ++xi) *dst++ = *src++ ;
@@ -2322,18 +2566,18 @@ vl_covdet_extract_patch_helper (VlCovDet * self,
         }
         /* now extend the central band up and down */
         for (yi = 0 ; yi < pady0 ; ++yi) {
-          memcpy(self->patch + yi * patchWidth,
-                 self->patch + pady0 * patchWidth,
+          memcpy(workspace->patch + yi * patchWidth,
+                 workspace->patch + pady0 * patchWidth,
                  patchWidth * sizeof(float)) ;
         }
         for (yi = patchHeight - pady1 ; yi < patchHeight ; ++yi) {
-          memcpy(self->patch + yi * patchWidth,
-                 self->patch + (patchHeight - pady1 - 1) * patchWidth,
+          memcpy(workspace->patch + yi * patchWidth,
+                 workspace->patch + (patchHeight - pady1 - 1) * patchWidth,
                  patchWidth * sizeof(float)) ;
         }
       } else {
         /* should be handled better! */
-        memset(self->patch, 0, self->patchBufferSize) ;
+        memset(workspace->patch, 0, workspace->patchBufferSize) ;
       }
 #if 0
       {
@@ -2343,7 +2587,7 @@ vl_covdet_extract_patch_helper (VlCovDet * self,
       }
 #endif
 
-      level = self->patch ;
+      level = workspace->patch ;
       width = patchWidth ;
       height = patchHeight ;
       T[0] -= x0i ;
@@ -2433,28 +2677,97 @@ vl_covdet_extract_patch_for_frame (VlCovDet * self,
 
   vl_svd2(D, U, V, A) ;
 
-  return vl_covdet_extract_patch_helper
-  (self, NULL, NULL, patch, resolution, extent, sigma, A, T, D[0], D[3]) ;
+  if (vl_covdet_extract_patch_helper
+      (self, &self->workspace, NULL, NULL, patch, resolution, extent, sigma, A, T, D[0], D[3])) {
+    return vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+  }
+  return VL_ERR_OK ;
+}
+
+/** @internal
+ ** @brief Extract the patches for a range of features
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first feature.
+ ** @param end last feature plus one.
+ **/
+
+static void
+_vl_covdet_extract_patches_range (void * loop_, vl_uindex task,
+                                  vl_uindex begin, vl_uindex end)
+{
+  VlCovDetLoop * loop = loop_ ;
+  VlCovDet * self = loop->self ;
+  vl_size patchSize = (2*loop->resolution+1)*(2*loop->resolution+1) ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    VlFrameOrientedEllipse frame = self->features[i].frame ;
+    double A[2*2] = {frame.a11, frame.a21, frame.a12, frame.a22} ;
+    double T[2] = {frame.x, frame.y} ;
+    double D[4], U[4], V[4] ;
+    vl_svd2(D, U, V, A) ;
+    if (vl_covdet_extract_patch_helper
+        (self, loop->workspaces + task, NULL, NULL, loop->patches + i * patchSize,
+         loop->resolution, loop->extent, loop->sigma, A, T, D[0], D[3])) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+      return ;
+    }
+  }
+}
+
+/** @brief Extract the patches for the stored features
+ ** @param self object.
+ ** @param patches buffer.
+ ** @param resolution patch resolution.
+ ** @param extent patch extent.
+ ** @param sigma desired smoothing in the patch frame.
+ ** @return error code.
+ **
+ ** The function is equivalent to calling
+ ** ::vl_covdet_extract_patch_for_frame for each stored feature, but
+ ** processes the features in parallel. @a patches must have room
+ ** for <code>(2*resolution+1)^2</code> samples for each feature,
+ ** stored one patch after the other in the feature order.
+ **
+ ** The function may fail with ::VL_ERR_ALLOC if memory is
+ ** insufficient.
+ **/
+
+int
+vl_covdet_extract_patches (VlCovDet * self,
+                           float * patches,
+                           vl_size resolution,
+                           double extent,
+                           double sigma)
+{
+  VlCovDetLoop loop ;
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.patches = patches ;
+  loop.resolution = resolution ;
+  loop.extent = extent ;
+  loop.sigma = sigma ;
+  return _vl_covdet_parallel_for (self, &loop, self->numFeatures,
+                                  _vl_covdet_extract_patches_range) ;
 }
 
 /* ---------------------------------------------------------------- */
 /*                                                     Affine shape */
 /* ---------------------------------------------------------------- */
 
-/** @brief Extract the affine shape for a feature frame
+/** @internal
+ ** @brief Extract the affine shape for a feature frame
  ** @param self object.
+ ** @param workspace buffers.
  ** @param adapted the shape-adapted frame.
  ** @param frame the input frame.
  ** @return ::VL_ERR_OK if affine adaptation is successful.
- **
- ** This function may fail if adaptation is unsuccessful or if
- ** memory is insufficient.
  **/
 
-int
-vl_covdet_extract_affine_shape_for_frame (VlCovDet * self,
-                                          VlFrameOrientedEllipse * adapted,
-                                          VlFrameOrientedEllipse frame)
+static int
+_vl_covdet_extract_affine_shape_for_frame (VlCovDet * self,
+                                           VlCovDetWorkspace * workspace,
+                                           VlFrameOrientedEllipse * adapted,
+                                           VlFrameOrientedEllipse frame)
 {
   vl_index iter = 0 ;
 
@@ -2519,9 +2832,9 @@ vl_covdet_extract_affine_shape_for_frame (VlCovDet * self,
 
     if (++iter >= VL_COVDET_AA_MAX_NUM_ITERATIONS) break ;
 
-    err = vl_covdet_extract_patch_helper(self,
+    err = vl_covdet_extract_patch_helper(self, workspace,
                                          &sigma1, &sigma2,
-                                         self->aaPatch,
+                                         workspace->aaPatch,
                                          resolution,
                                          extent,
                                          sigmaD,
@@ -2532,18 +2845,18 @@ vl_covdet_extract_affine_shape_for_frame (VlCovDet * self,
       double deltaSigma1 = sqrt(VL_MAX(sigmaD*sigmaD - sigma1*sigma1,0)) ;
       double deltaSigma2 = sqrt(VL_MAX(sigmaD*sigmaD - sigma2*sigma2,0)) ;
       double stephat = extent / resolution ;
-      vl_imsmooth_f(self->aaPatch, side,
-                    self->aaPatch, side, side, side,
-                    deltaSigma1 / stephat, deltaSigma2 / stephat) ;
+      err = _vl_covdet_workspace_smooth(workspace, workspace->aaPatch, side, side,
+                                        deltaSigma1 / stephat, deltaSigma2 / stephat) ;
+      if (err) return err ;
     }
 
     /* compute second moment matrix */
-    vl_imgradient_f (self->aaPatchX, self->aaPatchY, 1, side,
-                     self->aaPatch, side, side, side) ;
+    vl_imgradient_f (workspace->aaPatchX, workspace->aaPatchY, 1, side,
+                     workspace->aaPatch, side, side, side) ;
 
     for (k = 0 ; k < (signed)(side*side) ; ++k) {
-      double lx = self->aaPatchX[k] ;
-      double ly = self->aaPatchY[k] ;
+      double lx = workspace->aaPatchX[k] ;
+      double ly = workspace->aaPatchY[k] ;
       lxx += lx * lx * self->aaMask[k] ;
       lyy += ly * ly * self->aaMask[k] ;
       lxy += lx * ly * self->aaMask[k] ;
@@ -2633,30 +2946,99 @@ vl_covdet_extract_affine_shape_for_frame (VlCovDet * self,
   return VL_ERR_OK ;
 }
 
+/** @brief Extract the affine shape for a feature frame
+ ** @param self object.
+ ** @param adapted the shape-adapted frame.
+ ** @param frame the input frame.
+ ** @return ::VL_ERR_OK if affine adaptation is successful.
+ **
+ ** This function may fail if adaptation is unsuccessful or if
+ ** memory is insufficient.
+ **/
+
+int
+vl_covdet_extract_affine_shape_for_frame (VlCovDet * self,
+                                          VlFrameOrientedEllipse * adapted,
+                                          VlFrameOrientedEllipse frame)
+{
+  int err = _vl_covdet_extract_affine_shape_for_frame
+  (self, &self->workspace, adapted, frame) ;
+  if (err) return vl_set_last_error(err, NULL) ;
+  return VL_ERR_OK ;
+}
+
+/** @internal
+ ** @brief Extract the affine shape for a range of features
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first feature.
+ ** @param end last feature plus one.
+ **/
+
+static void
+_vl_covdet_extract_affine_shape_range (void * loop_, vl_uindex task,
+                                       vl_uindex begin, vl_uindex end)
+{
+  VlCovDetLoop * loop = loop_ ;
+  VlCovDet * self = loop->self ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    loop->status[i] = _vl_covdet_extract_affine_shape_for_frame
+    (self, loop->workspaces + task, &loop->adapted[i], self->features[i].frame) ;
+    if (loop->status[i] == VL_ERR_ALLOC) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+      return ;
+    }
+  }
+}
+
 /** @brief Extract the affine shape for the stored features
  ** @param self object.
+ ** @return error code.
  **
  ** This function may discard features for which no affine
  ** shape can reliably be detected.
+ **
+ ** The function may fail with ::VL_ERR_ALLOC if memory is
+ ** insufficient, in which case the features are left unchanged.
  **/
 
-void
+int
 vl_covdet_extract_affine_shape (VlCovDet * self)
 {
   vl_index i, j = 0 ;
   vl_size numFeatures = vl_covdet_get_num_features(self) ;
   VlCovDetFeature * feature = vl_covdet_get_features(self);
+  VlCovDetLoop loop ;
+  int err ;
+
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.adapted = vl_malloc(sizeof(VlFrameOrientedEllipse) * VL_MAX(numFeatures, 1)) ;
+  loop.status = vl_malloc(sizeof(int) * VL_MAX(numFeatures, 1)) ;
+  if (loop.adapted == NULL || loop.status == NULL) {
+    err = vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+    goto done ;
+  }
+
+  /* adapt the features in parallel */
+  err = _vl_covdet_parallel_for (self, &loop, self->numFeatures,
+                                 _vl_covdet_extract_affine_shape_range) ;
+  if (err) goto done ;
+
+  /* keep the successful ones in order */
   for (i = 0 ; i < (signed)numFeatures ; ++i) {
-    int status ;
-    VlFrameOrientedEllipse adapted ;
-    status = vl_covdet_extract_affine_shape_for_frame(self, &adapted, feature[i].frame) ;
-    if (status == VL_ERR_OK) {
+    if (loop.status[i] == VL_ERR_OK) {
       feature[j] = feature[i] ;
-      feature[j].frame = adapted ;
+      feature[j].frame = loop.adapted[i] ;
       ++ j ;
     }
   }
   self->numFeatures = j ;
+
+done:
+  if (loop.status) vl_free(loop.status) ;
+  if (loop.adapted) vl_free(loop.adapted) ;
+  return err ;
 }
 
 /* ---------------------------------------------------------------- */
@@ -2674,22 +3056,20 @@ _vl_covdet_compare_orientations_descending (void const * a_,
   return 0 ;
 }
 
-/** @brief Extract the orientation(s) for a feature
+/** @internal
+ ** @brief Extract the orientation(s) for a feature
  ** @param self object.
+ ** @param workspace buffers.
  ** @param numOrientations the number of detected orientations.
  ** @param frame pose of the feature.
- ** @return an array of detected orientations with their scores.
- **
- ** The returned array is a matrix of size @f$ 2 \times n @f$
- ** where <em>n</em> is the number of detected orientations.
- **
- ** The function returns @c NULL if memory is insufficient.
+ ** @return an array of detected orientations (stored in @a workspace).
  **/
 
-VlCovDetFeatureOrientation *
-vl_covdet_extract_orientations_for_frame (VlCovDet * self,
-                                          vl_size * numOrientations,
-                                          VlFrameOrientedEllipse frame)
+static VlCovDetFeatureOrientation *
+_vl_covdet_extract_orientations_for_frame (VlCovDet * self,
+                                           VlCovDetWorkspace * workspace,
+                                           vl_size * numOrientations,
+                                           VlFrameOrientedEllipse frame)
 {
   int err ;
   vl_index k, i ;
@@ -2743,9 +3123,9 @@ vl_covdet_extract_orientations_for_frame (VlCovDet * self,
 
   theta0 = atan2(V[1],V[0]) ;
 
-  err = vl_covdet_extract_patch_helper(self,
+  err = vl_covdet_extract_patch_helper(self, workspace,
                                        &sigma1, &sigma2,
-                                       self->aaPatch,
+                                       workspace->aaPatch,
                                        resolution,
                                        extent,
                                        sigmaD,
@@ -2760,20 +3140,23 @@ vl_covdet_extract_orientations_for_frame (VlCovDet * self,
     double deltaSigma1 = sqrt(VL_MAX(sigmaD*sigmaD - sigma1*sigma1,0)) ;
     double deltaSigma2 = sqrt(VL_MAX(sigmaD*sigmaD - sigma2*sigma2,0)) ;
     double stephat = extent / resolution ;
-    vl_imsmooth_f(self->aaPatch, side,
-                  self->aaPatch, side, side, side,
-                  deltaSigma1 / stephat, deltaSigma2 / stephat) ;
+    err = _vl_covdet_workspace_smooth(workspace, workspace->aaPatch, side, side,
+                                      deltaSigma1 / stephat, deltaSigma2 / stephat) ;
+    if (err) {
+      *numOrientations = 0 ;
+      return NULL ;
+    }
   }
 
   /* histogram of oriented gradients */
-  vl_imgradient_polar_f (self->aaPatchX, self->aaPatchY, 1, side,
-                         self->aaPatch, side, side, side) ;
+  vl_imgradient_polar_f (workspace->aaPatchX, workspace->aaPatchY, 1, side,
+                         workspace->aaPatch, side, side, side) ;
 
   memset (hist, 0, sizeof(double) * numBins) ;
 
   for (k = 0 ; k < (signed)(side*side) ; ++k) {
-    double modulus = self->aaPatchX[k] ;
-    double angle = self->aaPatchY[k] ;
+    double modulus = workspace->aaPatchX[k] ;
+    double angle = workspace->aaPatchY[k] ;
     double weight = self->aaMask[k] ;
 
     double x = angle / binExtent ;
@@ -2820,8 +3203,8 @@ vl_covdet_extract_orientations_for_frame (VlCovDet * self,
         /* the axis to the right is y, measure orientations from this */
         th = th - VL_PI/2 ;
       }
-      self->orientations[*numOrientations].angle = th ;
-      self->orientations[*numOrientations].score = h0 ;
+      workspace->orientations[*numOrientations].angle = th ;
+      workspace->orientations[*numOrientations].score = h0 ;
       *numOrientations += 1 ;
       //VL_PRINTF("%d %g\n", *numOrientations, th) ;
 
@@ -2830,32 +3213,108 @@ vl_covdet_extract_orientations_for_frame (VlCovDet * self,
   }
 
   /* sort the orientations by decreasing scores */
-  qsort(self->orientations,
+  qsort(workspace->orientations,
         *numOrientations,
         sizeof(VlCovDetFeatureOrientation),
         _vl_covdet_compare_orientations_descending) ;
 
-  return self->orientations ;
+  return workspace->orientations ;
+}
+
+/** @brief Extract the orientation(s) for a feature
+ ** @param self object.
+ ** @param numOrientations the number of detected orientations.
+ ** @param frame pose of the feature.
+ ** @return an array of detected orientations with their scores.
+ **
+ ** The returned array is a matrix of size @f$ 2 \times n @f$
+ ** where <em>n</em> is the number of detected orientations.
+ **
+ ** The function returns @c NULL if memory is insufficient.
+ **/
+
+VlCovDetFeatureOrientation *
+vl_covdet_extract_orientations_for_frame (VlCovDet * self,
+                                          vl_size * numOrientations,
+                                          VlFrameOrientedEllipse frame)
+{
+  VlCovDetFeatureOrientation * orientations = _vl_covdet_extract_orientations_for_frame
+  (self, &self->workspace, numOrientations, frame) ;
+  if (orientations == NULL) vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+  return orientations ;
+}
+
+/** @internal
+ ** @brief Extract the orientations for a range of features
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first feature.
+ ** @param end last feature plus one.
+ **/
+
+static void
+_vl_covdet_extract_orientations_range (void * loop_, vl_uindex task,
+                                       vl_uindex begin, vl_uindex end)
+{
+  VlCovDetLoop * loop = loop_ ;
+  VlCovDet * self = loop->self ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    VlCovDetFeatureOrientation * orientations = _vl_covdet_extract_orientations_for_frame
+    (self, loop->workspaces + task, &loop->numDetected[i], self->features[i].frame) ;
+    if (orientations == NULL) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+      return ;
+    }
+    memcpy(loop->orientations + i * VL_COVDET_MAX_NUM_ORIENTATIONS, orientations,
+           sizeof(VlCovDetFeatureOrientation) * loop->numDetected[i]) ;
+  }
 }
 
 /** @brief Extract the orientation(s) for the stored features.
  ** @param self object.
+ ** @return error code.
  **
  ** Note that, since more than one orientation can be detected
  ** for each feature, this function may create copies of them,
  ** one for each orientation.
+ **
+ ** The function may fail with ::VL_ERR_ALLOC if memory is
+ ** insufficient, in which case the features are left unchanged.
  **/
 
-void
+int
 vl_covdet_extract_orientations (VlCovDet * self)
 {
   vl_index i, j  ;
   vl_size numFeatures = vl_covdet_get_num_features(self) ;
+  VlCovDetFeatureOrientation * allOrientations ;
+  vl_size * allNumOrientations ;
+  VlCovDetLoop loop ;
+  int err ;
+
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.orientations =
+  vl_malloc(sizeof(VlCovDetFeatureOrientation) * VL_COVDET_MAX_NUM_ORIENTATIONS * VL_MAX(numFeatures, 1)) ;
+  loop.numDetected = vl_malloc(sizeof(vl_size) * VL_MAX(numFeatures, 1)) ;
+  if (loop.orientations == NULL || loop.numDetected == NULL) {
+    err = vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+    goto done ;
+  }
+
+  /* compute the orientations in parallel */
+  err = _vl_covdet_parallel_for (self, &loop, self->numFeatures,
+                                 _vl_covdet_extract_orientations_range) ;
+  if (err) goto done ;
+  allOrientations = loop.orientations ;
+  allNumOrientations = loop.numDetected ;
+
+  /* rotate the features, appending copies for additional orientations */
   for (i = 0 ; i < (signed)numFeatures ; ++i) {
-    vl_size numOrientations ;
+    vl_size numOrientations = allNumOrientations[i] ;
     VlCovDetFeature feature = self->features[i] ;
-    VlCovDetFeatureOrientation* orientations =
-    vl_covdet_extract_orientations_for_frame(self, &numOrientations, feature.frame) ;
+    VlCovDetFeatureOrientation const * orientations =
+    allOrientations + i * VL_COVDET_MAX_NUM_ORIENTATIONS ;
 
     for (j = 0 ; j < (signed)numOrientations ; ++j) {
       double A [2*2] = {
@@ -2881,25 +3340,31 @@ vl_covdet_extract_orientations (VlCovDet * self)
       oriented->frame.a22 = - A[1] * r2 + A[3] * r1 ;
     }
   }
+
+done:
+  if (loop.numDetected) vl_free(loop.numDetected) ;
+  if (loop.orientations) vl_free(loop.orientations) ;
+  return err ;
 }
 
 /* ---------------------------------------------------------------- */
 /*                                                 Laplacian scales */
 /* ---------------------------------------------------------------- */
 
-/** @brief Extract the Laplacian scale(s) for a feature frame.
+/** @internal
+ ** @brief Extract the Laplacian scale(s) for a feature frame.
  ** @param self object.
+ ** @param workspace buffers.
  ** @param numScales the number of detected scales.
  ** @param frame pose of the feature.
- ** @return an array of detected scales.
- **
- ** The function returns @c NULL if memory is insufficient.
+ ** @return an array of detected scales (stored in @a workspace).
  **/
 
-VlCovDetFeatureLaplacianScale *
-vl_covdet_extract_laplacian_scales_for_frame (VlCovDet * self,
-                                              vl_size * numScales,
-                                              VlFrameOrientedEllipse frame)
+static VlCovDetFeatureLaplacianScale *
+_vl_covdet_extract_laplacian_scales_for_frame (VlCovDet * self,
+                                               VlCovDetWorkspace * workspace,
+                                               vl_size * numScales,
+                                               VlFrameOrientedEllipse frame)
 {
   /*
    We try to explore one octave, with the nominal detection scale 1.0
@@ -2939,7 +3404,7 @@ vl_covdet_extract_laplacian_scales_for_frame (VlCovDet * self,
   vl_svd2(D, U, V, A) ;
 
   err = vl_covdet_extract_patch_helper
-  (self, &sigma1, &sigma2, self->lapPatch, resolution, extent, sigmaImage, A, T, D[0], D[3]) ;
+  (self, workspace, &sigma1, &sigma2, workspace->lapPatch, resolution, extent, sigmaImage, A, T, D[0], D[3]) ;
   if (err) return NULL ;
 
   /* the actual smoothing after warping is never the target one */
@@ -2963,7 +3428,7 @@ vl_covdet_extract_laplacian_scales_for_frame (VlCovDet * self,
                     + actualSigmaImage*actualSigmaImage) ;
 
     for (q = 0 ; q < (signed)(num * num) ; ++q) {
-      score += (*pt++) * self->lapPatch[q] ;
+      score += (*pt++) * workspace->lapPatch[q] ;
     }
     scores[k] = score * sigmaLap * sigmaLap ;
   }
@@ -2989,36 +3454,108 @@ vl_covdet_extract_laplacian_scales_for_frame (VlCovDet * self,
        k,s,sigmaLapFilter,sigmaLap,scale,a,b,c) ;
        */
       if (*numScales < VL_COVDET_MAX_NUM_LAPLACIAN_SCALES) {
-        self->scales[*numScales].scale = scale * factor ;
-        self->scales[*numScales].score = b + 0.5 * (c - a) * dk ;
+        workspace->scales[*numScales].scale = scale * factor ;
+        workspace->scales[*numScales].score = b + 0.5 * (c - a) * dk ;
         *numScales += 1 ;
       }
     }
   }
-  return self->scales ;
+  return workspace->scales ;
+}
+
+/** @brief Extract the Laplacian scale(s) for a feature frame.
+ ** @param self object.
+ ** @param numScales the number of detected scales.
+ ** @param frame pose of the feature.
+ ** @return an array of detected scales.
+ **
+ ** The function returns @c NULL if memory is insufficient.
+ **/
+
+VlCovDetFeatureLaplacianScale *
+vl_covdet_extract_laplacian_scales_for_frame (VlCovDet * self,
+                                              vl_size * numScales,
+                                              VlFrameOrientedEllipse frame)
+{
+  VlCovDetFeatureLaplacianScale * scales = _vl_covdet_extract_laplacian_scales_for_frame
+  (self, &self->workspace, numScales, frame) ;
+  if (scales == NULL) vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+  return scales ;
+}
+
+/** @internal
+ ** @brief Extract the Laplacian scales for a range of features
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first feature.
+ ** @param end last feature plus one.
+ **/
+
+static void
+_vl_covdet_extract_laplacian_scales_range (void * loop_, vl_uindex task,
+                                           vl_uindex begin, vl_uindex end)
+{
+  VlCovDetLoop * loop = loop_ ;
+  VlCovDet * self = loop->self ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    VlCovDetFeatureLaplacianScale * scales = _vl_covdet_extract_laplacian_scales_for_frame
+    (self, loop->workspaces + task, &loop->numDetected[i], self->features[i].frame) ;
+    if (scales == NULL) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+      return ;
+    }
+    memcpy(loop->scales + i * VL_COVDET_MAX_NUM_LAPLACIAN_SCALES, scales,
+           sizeof(VlCovDetFeatureLaplacianScale) * loop->numDetected[i]) ;
+  }
 }
 
 /** @brief Extract the Laplacian scales for the stored features
  ** @param self object.
+ ** @return error code.
  **
  ** Note that, since more than one orientation can be detected
  ** for each feature, this function may create copies of them,
  ** one for each orientation.
+ **
+ ** The function may fail with ::VL_ERR_ALLOC if memory is
+ ** insufficient, in which case the features are left unchanged.
  **/
-void
+int
 vl_covdet_extract_laplacian_scales (VlCovDet * self)
 {
   vl_index i, j  ;
   vl_bool dropFeaturesWithoutScale = VL_TRUE ;
   vl_size numFeatures = vl_covdet_get_num_features(self) ;
+  VlCovDetFeatureLaplacianScale * allScales ;
+  vl_size * allNumScales ;
+  VlCovDetLoop loop ;
+  int err ;
+
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.scales =
+  vl_malloc(sizeof(VlCovDetFeatureLaplacianScale) * VL_COVDET_MAX_NUM_LAPLACIAN_SCALES * VL_MAX(numFeatures, 1)) ;
+  loop.numDetected = vl_malloc(sizeof(vl_size) * VL_MAX(numFeatures, 1)) ;
+  if (loop.scales == NULL || loop.numDetected == NULL) {
+    err = vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+    goto done ;
+  }
+
+  /* compute the scales in parallel */
+  err = _vl_covdet_parallel_for (self, &loop, self->numFeatures,
+                                 _vl_covdet_extract_laplacian_scales_range) ;
+  if (err) goto done ;
+  allScales = loop.scales ;
+  allNumScales = loop.numDetected ;
   memset(self->numFeaturesWithNumScales, 0,
          sizeof(self->numFeaturesWithNumScales)) ;
 
+  /* rescale the features, appending copies for additional scales */
   for (i = 0 ; i < (signed)numFeatures ; ++i) {
-    vl_size numScales ;
+    vl_size numScales = allNumScales[i] ;
     VlCovDetFeature feature = self->features[i] ;
     VlCovDetFeatureLaplacianScale const * scales =
-    vl_covdet_extract_laplacian_scales_for_frame(self, &numScales, feature.frame) ;
+    allScales + i * VL_COVDET_MAX_NUM_LAPLACIAN_SCALES ;
 
     self->numFeaturesWithNumScales[numScales] ++ ;
 
@@ -3054,6 +3591,10 @@ vl_covdet_extract_laplacian_scales (VlCovDet * self)
     self->numFeatures = j ;
   }
 
+done:
+  if (loop.numDetected) vl_free(loop.numDetected) ;
+  if (loop.scales) vl_free(loop.scales) ;
+  return err ;
 }
 
 /* ---------------------------------------------------------------- */
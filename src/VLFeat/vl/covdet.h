@@ -195,11 +195,11 @@ VL_EXPORT int vl_covdet_put_image (VlCovDet * self,
                                     float const * image,
                                     vl_size width, vl_size height) ;
 
-VL_EXPORT void vl_covdet_detect (VlCovDet * self) ;
+VL_EXPORT int vl_covdet_detect (VlCovDet * self) ;
 VL_EXPORT int vl_covdet_append_feature (VlCovDet * self, VlCovDetFeature const * feature) ;
-VL_EXPORT void vl_covdet_extract_orientations (VlCovDet * self) ;
-VL_EXPORT void vl_covdet_extract_laplacian_scales (VlCovDet * self) ;
-VL_EXPORT void vl_covdet_extract_affine_shape (VlCovDet * self) ;
+VL_EXPORT int vl_covdet_extract_orientations (VlCovDet * self) ;
+VL_EXPORT int vl_covdet_extract_laplacian_scales (VlCovDet * self) ;
+VL_EXPORT int vl_covdet_extract_affine_shape (VlCovDet * self) ;
 
 VL_EXPORT VlCovDetFeatureOrientation *
 vl_covdet_extract_orientations_for_frame (VlCovDet * self,
@@ -222,6 +222,12 @@ vl_covdet_extract_patch_for_frame (VlCovDet * self, float * patch,
                                    double sigma,
                                    VlFrameOrientedEllipse frame) ;
 
+VL_EXPORT int
+vl_covdet_extract_patches (VlCovDet * self, float * patches,
+                           vl_size resolution,
+                           double extent,
+                           double sigma) ;
+
 VL_EXPORT void
 vl_covdet_drop_features_outside (VlCovDet * self, double margin) ;
 /** @} */
@@ -49,6 +49,12 @@ sampling steps (::vl_dsift_set_steps) and the sampling bounds
 the spatial bins and number of orientation bins) can be customized
 (::vl_dsift_set_geometry, ::VlDsiftDescriptorGeometry).
 
+The filter can process several images of the same size, reusing its
+buffers. For sequences of images that change only locally (for
+instance the frames of a video taken by a static camera),
+::vl_dsift_update recomputes only the descriptors whose support
+intersects a given rectangle.
+
 @image html dsift-geom.png "Dense SIFT descriptor geometry"
 
 By default, SIFT uses a Gaussian windowing function that discounts
@@ -333,6 +339,14 @@ _vl_dsift_free_buffers (VlDsiftFilter* self)
     vl_free(self->grads) ;
     self->grads = NULL ;
   }
+  if (self->convTmp1) {
+    vl_free(self->convTmp1) ;
+    self->convTmp1 = NULL ;
+  }
+  if (self->convTmp2) {
+    vl_free(self->convTmp2) ;
+    self->convTmp2 = NULL ;
+  }
   self->numFrameAlloc = 0 ;
   self->numBinAlloc = 0 ;
   self->numGradAlloc = 0 ;
@@ -360,6 +374,7 @@ _vl_dsift_update_buffers (VlDsiftFilter * self)
   self->descrSize = self->geom.numBinT *
                     self->geom.numBinX *
                     self->geom.numBinY ;
+  self->hasResults = VL_FALSE ;
 }
 
 /** ------------------------------------------------------------------
@@ -395,6 +410,9 @@ _vl_dsift_alloc_buffers (VlDsiftFilter* self)
         self->grads[t] =
           vl_malloc(sizeof(float) * self->imWidth * self->imHeight) ;
       }
+      /* one pair of convolution buffers for each orientation */
+      self->convTmp1 = vl_malloc(sizeof(float) * self->imWidth * self->imHeight * numGradAlloc) ;
+      self->convTmp2 = vl_malloc(sizeof(float) * self->imWidth * self->imHeight * numGradAlloc) ;
       self->numBinAlloc = numBinAlloc ;
       self->numGradAlloc = numGradAlloc ;
       self->numFrameAlloc = numFrameAlloc ;
@@ -435,8 +453,8 @@ vl_dsift_new (int imWidth, int imHeight)
   self->useFlatWindow = VL_FALSE ;
   self->windowSize = 2.0 ;
 
-  self->convTmp1 = vl_malloc(sizeof(float) * self->imWidth * self->imHeight) ;
-  self->convTmp2 = vl_malloc(sizeof(float) * self->imWidth * self->imHeight) ;
+  self->convTmp1 = NULL ;
+  self->convTmp2 = NULL ;
 
   self->numBinAlloc = 0 ;
   self->numFrameAlloc = 0 ;
@@ -484,111 +502,338 @@ VL_EXPORT void
 vl_dsift_delete (VlDsiftFilter * self)
 {
   _vl_dsift_free_buffers (self) ;
-  if (self->convTmp2) vl_free (self->convTmp2) ;
-  if (self->convTmp1) vl_free (self->convTmp1) ;
   vl_free (self) ;
 }
 
 
 /** ------------------------------------------------------------------
- ** @internal @brief Process with Gaussian window
+ ** @internal @brief Region of the image to process
+ **
+ ** The gradients are convolved in the image window
+ ** <code>[minX,maxX] x [minY,maxY]</code> and the descriptors are
+ ** computed for the frames <code>[frameMinX,frameMaxX] x
+ ** [frameMinY,frameMaxY]</code> of the sampling grid. The window
+ ** must contain the support of the bins of these descriptors, unless
+ ** it extends to the image boundary.
+ **/
+
+typedef struct VlDsiftRegion_
+{
+  int minX ;
+  int minY ;
+  int maxX ;
+  int maxY ;
+  int frameMinX ;
+  int frameMinY ;
+  int frameMaxX ;
+  int frameMaxY ;
+} VlDsiftRegion ;
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Data of the parallel loops
+ **/
+
+typedef struct VlDsiftLoop_
+{
+  VlDsiftFilter * self ;         /**< DSIFT filter. */
+  VlDsiftRegion const * region ; /**< region to process. */
+  float const * image ;          /**< image data. */
+  int minX ;                     /**< gradient window minimum X coordinate. */
+  int minY ;                     /**< gradient window minimum Y coordinate. */
+  int maxX ;                     /**< gradient window maximum X coordinate. */
+  float ** xkers ;               /**< X bin kernels (Gaussian window). */
+  float ** ykers ;               /**< Y bin kernels (Gaussian window). */
+} VlDsiftLoop ;
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Get the number of frames along X
  ** @param self DSIFT filter.
+ ** @return number of columns of the sampling grid.
  **/
 
-VL_INLINE void
-_vl_dsift_with_gaussian_window (VlDsiftFilter * self)
+static int
+_vl_dsift_get_num_frames_x (VlDsiftFilter const * self)
 {
-  int binx, biny, bint ;
+  int rangeX = self->boundMaxX - self->boundMinX -
+    (self->geom.numBinX - 1) * self->geom.binSizeX ;
+  return (rangeX >= 0) ? rangeX / self->stepX + 1 : 0 ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Get the number of frames along Y
+ ** @param self DSIFT filter.
+ ** @return number of rows of the sampling grid.
+ **/
+
+static int
+_vl_dsift_get_num_frames_y (VlDsiftFilter const * self)
+{
+  int rangeY = self->boundMaxY - self->boundMinY -
+    (self->geom.numBinY - 1) * self->geom.binSizeY ;
+  return (rangeY >= 0) ? rangeY / self->stepY + 1 : 0 ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Compute the gradients for a range of window rows
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row (relative to the window).
+ ** @param end last row plus one.
+ **/
+
+static void
+_vl_dsift_compute_gradients_range (void * loop_, vl_uindex task VL_UNUSED,
+                                   vl_uindex begin, vl_uindex end)
+{
+  VlDsiftLoop * loop = loop_ ;
+  VlDsiftFilter * self = loop->self ;
+  float const * im = loop->image ;
+  int y ;
+
+#undef at
+#define at(x,y) (im[(y)*self->imWidth+(x)])
+
+  for (y = loop->minY + (int)begin ; y < loop->minY + (int)end ; ++ y) {
+    int x, t ;
+    for (x = loop->minX ; x <= loop->maxX ; ++ x) {
+      float gx, gy ;
+      float angle, mod, nt, rbint ;
+      int bint ;
+
+      /* y derivative */
+      if (y == 0) {
+        gy = at(x,y+1) - at(x,y) ;
+      } else if (y == self->imHeight - 1) {
+        gy = at(x,y) - at(x,y-1) ;
+      } else {
+        gy = 0.5F * (at(x,y+1) - at(x,y-1)) ;
+      }
+
+      /* x derivative */
+      if (x == 0) {
+        gx = at(x+1,y) - at(x,y) ;
+      } else if (x == self->imWidth - 1) {
+        gx = at(x,y) - at(x-1,y) ;
+      } else {
+        gx = 0.5F * (at(x+1,y) - at(x-1,y)) ;
+      }
+
+      /* angle and modulus */
+      angle = vl_fast_atan2_f (gy,gx) ;
+      mod = vl_fast_sqrt_f (gx*gx + gy*gy) ;
+
+      /* quantize angle */
+      nt = vl_mod_2pi_f (angle) * (self->geom.numBinT / (2*VL_PI)) ;
+      bint = (int) vl_floor_f (nt) ;
+      rbint = nt - bint ;
+
+      /* write it back */
+      for (t = 0 ; t < self->geom.numBinT ; ++t) {
+        self->grads [t][x + y * self->imWidth] = 0 ;
+      }
+      self->grads [(bint    ) % self->geom.numBinT][x + y * self->imWidth] = (1 - rbint) * mod ;
+      self->grads [(bint + 1) % self->geom.numBinT][x + y * self->imWidth] = (    rbint) * mod ;
+    }
+  }
+#undef at
+}
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Compute the gradients in an image window
+ ** @param self DSIFT filter.
+ ** @param im image data.
+ ** @param minX window minimum X coordinate.
+ ** @param minY window minimum Y coordinate.
+ ** @param maxX window maximum X coordinate.
+ ** @param maxY window maximum Y coordinate.
+ **
+ ** The function writes the gradient modulus of each pixel of the
+ ** window to the two orientation planes closest to the gradient angle,
+ ** and clears the other planes. Rows are processed in parallel.
+ **/
+
+static void
+_vl_dsift_compute_gradients (VlDsiftFilter * self, float const * im,
+                             int minX, int minY, int maxX, int maxY)
+{
+  vl_size numRows = maxY - minY + 1 ;
+  VlDsiftLoop loop ;
+  memset (&loop, 0, sizeof(loop)) ;
+  loop.self = self ;
+  loop.image = im ;
+  loop.minX = minX ;
+  loop.minY = minY ;
+  loop.maxX = maxX ;
+  vl_parallel_for (numRows, VL_MIN(vl_get_max_threads(), numRows),
+                   _vl_dsift_compute_gradients_range, &loop) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Copy a smoothed orientation plane to the descriptors
+ ** @param self DSIFT filter.
+ ** @param region region to process.
+ ** @param src smoothed orientation plane (restricted to the region window).
+ ** @param binx spatial bin X index.
+ ** @param biny spatial bin Y index.
+ ** @param bint orientation bin index.
+ ** @param w weight of the bin.
+ **/
+
+static void
+_vl_dsift_sample_bin (VlDsiftFilter * self, VlDsiftRegion const * region,
+                      float const * src, int binx, int biny, int bint, float w)
+{
+  int width = region->maxX - region->minX + 1 ;
+  int numFramesX = _vl_dsift_get_num_frames_x (self) ;
+  int descrSize = vl_dsift_get_descriptor_size (self) ;
   int framex, framey ;
-  float *xker, *yker ;
 
-  int Wx = self->geom.binSizeX - 1 ;
-  int Wy = self->geom.binSizeY - 1 ;
+  for (framey = region->frameMinY ; framey <= region->frameMaxY ; ++framey) {
+    int y = self->boundMinY + framey * self->stepY + biny * self->geom.binSizeY ;
+    float const * srcRow = src + (y - region->minY) * width - region->minX
+      + self->boundMinX + binx * self->geom.binSizeX ;
+    float *dst = self->descrs
+      + (framey * numFramesX + region->frameMinX) * descrSize
+      + bint
+      + binx * self->geom.numBinT
+      + biny * (self->geom.numBinX * self->geom.numBinT) ;
+    for (framex = region->frameMinX ; framex <= region->frameMaxX ; ++framex) {
+      *dst = w * srcRow [framex * self->stepX] ;
+      dst += descrSize ;
+    } /* framex */
+  } /* framey */
+}
 
-  for (biny = 0 ; biny < self->geom.numBinY ; ++biny) {
+/** ------------------------------------------------------------------
+ ** @internal @brief Process a range of orientation planes with Gaussian window
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first orientation bin.
+ ** @param end last orientation bin plus one.
+ **/
 
-    yker = _vl_dsift_new_kernel (self->geom.binSizeY,
-                                 self->geom.numBinY,
-                                 biny,
-                                 self->windowSize) ;
+static void
+_vl_dsift_with_gaussian_window_range (void * loop_, vl_uindex task VL_UNUSED,
+                                      vl_uindex begin, vl_uindex end)
+{
+  VlDsiftLoop * loop = loop_ ;
+  VlDsiftFilter * self = loop->self ;
+  VlDsiftRegion const * region = loop->region ;
+  float ** xkers = loop->xkers ;
+  float ** ykers = loop->ykers ;
+  int binx, biny, bint ;
+  int width = region->maxX - region->minX + 1 ;
+  int height = region->maxY - region->minY + 1 ;
+  int Wx = self->geom.binSizeX - 1 ;
+  int Wy = self->geom.binSizeY - 1 ;
 
-    for (binx = 0 ; binx < self->geom.numBinX ; ++binx) {
+  for (bint = (int)begin ; bint < (int)end ; ++bint) {
+    float * convTmp1 = self->convTmp1 + bint * self->imWidth * self->imHeight ;
+    float * convTmp2 = self->convTmp2 + bint * self->imWidth * self->imHeight ;
+    float const * grad = self->grads[bint] + region->minX + region->minY * self->imWidth ;
 
-      xker = _vl_dsift_new_kernel(self->geom.binSizeX,
-                                  self->geom.numBinX,
-                                  binx,
-                                  self->windowSize) ;
+    for (biny = 0 ; biny < self->geom.numBinY ; ++biny) {
 
-      for (bint = 0 ; bint < self->geom.numBinT ; ++bint) {
+      vl_imconvcol_vf (convTmp1, height,
+                       grad, width, height,
+                       self->imWidth,
+                       ykers[biny], -Wy, +Wy, 1,
+                       VL_PAD_BY_CONTINUITY|VL_TRANSPOSE) ;
 
-        vl_imconvcol_vf (self->convTmp1, self->imHeight,
-                         self->grads[bint], self->imWidth, self->imHeight,
-                         self->imWidth,
-                         yker, -Wy, +Wy, 1,
-                         VL_PAD_BY_CONTINUITY|VL_TRANSPOSE) ;
+      for (binx = 0 ; binx < self->geom.numBinX ; ++binx) {
 
-        vl_imconvcol_vf (self->convTmp2, self->imWidth,
-                         self->convTmp1, self->imHeight, self->imWidth,
-                         self->imHeight,
-                         xker, -Wx, +Wx, 1,
+        vl_imconvcol_vf (convTmp2, width,
+                         convTmp1, height, width,
+                         height,
+                         xkers[binx], -Wx, +Wx, 1,
                          VL_PAD_BY_CONTINUITY|VL_TRANSPOSE) ;
 
-        {
-          float *dst = self->descrs
-            + bint
-            + binx * self->geom.numBinT
-            + biny * (self->geom.numBinX * self->geom.numBinT)  ;
-
-          float *src = self->convTmp2 ;
-
-          int frameSizeX = self->geom.binSizeX * (self->geom.numBinX - 1) + 1 ;
-          int frameSizeY = self->geom.binSizeY * (self->geom.numBinY - 1) + 1 ;
-          int descrSize = vl_dsift_get_descriptor_size (self) ;
-
-          for (framey  = self->boundMinY ;
-               framey <= self->boundMaxY - frameSizeY + 1 ;
-               framey += self->stepY) {
-            for (framex  = self->boundMinX ;
-                 framex <= self->boundMaxX - frameSizeX + 1 ;
-                 framex += self->stepX) {
-              *dst = src [(framex + binx * self->geom.binSizeX) * 1 +
-                          (framey + biny * self->geom.binSizeY) * self->imWidth]  ;
-              dst += descrSize ;
-            } /* framex */
-          } /* framey */
-        }
-
-      } /* for bint */
-      vl_free (xker) ;
-    } /* for binx */
-    vl_free (yker) ;
-  } /* for biny */
+        _vl_dsift_sample_bin (self, region, convTmp2, binx, biny, bint, 1.0F) ;
+      } /* for binx */
+    } /* for biny */
+  } /* for bint */
 }
 
 /** ------------------------------------------------------------------
- ** @internal @brief Process with flat window.
- ** @param self DSIFT filter object.
+ ** @internal @brief Process with Gaussian window
+ ** @param self DSIFT filter.
+ ** @param region region to process.
+ **
+ ** Orientation planes are processed in parallel, each with its own
+ ** pair of convolution buffers.
  **/
 
 VL_INLINE void
-_vl_dsift_with_flat_window (VlDsiftFilter* self)
+_vl_dsift_with_gaussian_window (VlDsiftFilter * self, VlDsiftRegion const * region)
 {
+  int binx, biny ;
+  vl_size numBinT = self->geom.numBinT ;
+  float ** xkers = vl_malloc (sizeof(float*) * self->geom.numBinX) ;
+  float ** ykers = vl_malloc (sizeof(float*) * self->geom.numBinY) ;
+  VlDsiftLoop loop ;
+
+  for (binx = 0 ; binx < self->geom.numBinX ; ++binx) {
+    xkers[binx] = _vl_dsift_new_kernel (self->geom.binSizeX,
+                                        self->geom.numBinX,
+                                        binx,
+                                        self->windowSize) ;
+  }
+  for (biny = 0 ; biny < self->geom.numBinY ; ++biny) {
+    ykers[biny] = _vl_dsift_new_kernel (self->geom.binSizeY,
+                                        self->geom.numBinY,
+                                        biny,
+                                        self->windowSize) ;
+  }
+
+  memset (&loop, 0, sizeof(loop)) ;
+  loop.self = self ;
+  loop.region = region ;
+  loop.xkers = xkers ;
+  loop.ykers = ykers ;
+  vl_parallel_for (numBinT, VL_MIN(vl_get_max_threads(), numBinT),
+                   _vl_dsift_with_gaussian_window_range, &loop) ;
+
+  for (binx = 0 ; binx < self->geom.numBinX ; ++binx) vl_free (xkers[binx]) ;
+  for (biny = 0 ; biny < self->geom.numBinY ; ++biny) vl_free (ykers[biny]) ;
+  vl_free (xkers) ;
+  vl_free (ykers) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Process a range of orientation planes with flat window
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first orientation bin.
+ ** @param end last orientation bin plus one.
+ **/
+
+static void
+_vl_dsift_with_flat_window_range (void * loop_, vl_uindex task VL_UNUSED,
+                                  vl_uindex begin, vl_uindex end)
+{
+  VlDsiftLoop * loop = loop_ ;
+  VlDsiftFilter * self = loop->self ;
+  VlDsiftRegion const * region = loop->region ;
   int binx, biny, bint ;
-  int framex, framey ;
+  int width = region->maxX - region->minX + 1 ;
+  int height = region->maxY - region->minY + 1 ;
 
   /* for each orientation bin */
-  for (bint = 0 ; bint < self->geom.numBinT ; ++bint) {
+  for (bint = (int)begin ; bint < (int)end ; ++bint) {
+    float * convTmp1 = self->convTmp1 + bint * self->imWidth * self->imHeight ;
+    float * convTmp2 = self->convTmp2 + bint * self->imWidth * self->imHeight ;
+    float const * grad = self->grads[bint] + region->minX + region->minY * self->imWidth ;
 
-    vl_imconvcoltri_f (self->convTmp1, self->imHeight,
-                       self->grads [bint], self->imWidth, self->imHeight,
+    vl_imconvcoltri_f (convTmp1, height,
+                       grad, width, height,
                        self->imWidth,
                        self->geom.binSizeY, /* filt size */
                        1, /* subsampling step */
                        VL_PAD_BY_CONTINUITY|VL_TRANSPOSE) ;
 
-    vl_imconvcoltri_f (self->convTmp2, self->imWidth,
-                       self->convTmp1, self->imHeight, self->imWidth,
-                       self->imHeight,
+    vl_imconvcoltri_f (convTmp2, width,
+                       convTmp1, height, width,
+                       height,
                        self->geom.binSizeX,
                        1,
                        VL_PAD_BY_CONTINUITY|VL_TRANSPOSE) ;
@@ -623,153 +868,243 @@ _vl_dsift_with_flat_window (VlDsiftFilter* self)
                                                   self->geom.numBinX,
                                                   binx,
                                                   self->windowSize) ;
-
-        float *dst = self->descrs
-          + bint
-          + binx * self->geom.numBinT
-          + biny * (self->geom.numBinX * self->geom.numBinT)  ;
-
-        float *src = self->convTmp2 ;
-
-        int frameSizeX = self->geom.binSizeX * (self->geom.numBinX - 1) + 1 ;
-        int frameSizeY = self->geom.binSizeY * (self->geom.numBinY - 1) + 1 ;
-        int descrSize = vl_dsift_get_descriptor_size (self) ;
-
         wx *= self->geom.binSizeX ;
         w = wx * wy ;
 
-        for (framey  = self->boundMinY ;
-             framey <= self->boundMaxY - frameSizeY + 1 ;
-             framey += self->stepY) {
-          for (framex  = self->boundMinX ;
-               framex <= self->boundMaxX - frameSizeX + 1 ;
-               framex += self->stepX) {
-            *dst = w * src [(framex + binx * self->geom.binSizeX) * 1 +
-                            (framey + biny * self->geom.binSizeY) * self->imWidth]  ;
-            dst += descrSize ;
-          } /* framex */
-        } /* framey */
+        _vl_dsift_sample_bin (self, region, convTmp2, binx, biny, bint, w) ;
       } /* binx */
     } /* biny */
   } /* bint */
 }
 
 /** ------------------------------------------------------------------
- ** @brief Compute keypoints and descriptors
+ ** @internal @brief Process with flat window.
+ ** @param self DSIFT filter object.
+ ** @param region region to process.
  **
- ** @param self DSIFT filter.
- ** @param im   image data.
+ ** Orientation planes are processed in parallel, each with its own
+ ** pair of convolution buffers.
  **/
 
-void vl_dsift_process (VlDsiftFilter* self, float const* im)
+VL_INLINE void
+_vl_dsift_with_flat_window (VlDsiftFilter* self, VlDsiftRegion const * region)
 {
-  int t, x, y ;
-
-  /* update buffers */
-  _vl_dsift_alloc_buffers (self) ;
-
-  /* clear integral images */
-  for (t = 0 ; t < self->geom.numBinT ; ++t)
-    memset (self->grads[t], 0,
-            sizeof(float) * self->imWidth * self->imHeight) ;
+  vl_size numBinT = self->geom.numBinT ;
+  VlDsiftLoop loop ;
+  memset (&loop, 0, sizeof(loop)) ;
+  loop.self = self ;
+  loop.region = region ;
+  vl_parallel_for (numBinT, VL_MIN(vl_get_max_threads(), numBinT),
+                   _vl_dsift_with_flat_window_range, &loop) ;
+}
 
-#undef at
-#define at(x,y) (im[(y)*self->imWidth+(x)])
+/** ------------------------------------------------------------------
+ ** @internal @brief Normalize a range of descriptor rows
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row (relative to the region).
+ ** @param end last row plus one.
+ **/
 
-  /* Compute gradients, their norm, and their angle */
+static void
+_vl_dsift_normalize_range (void * loop_, vl_uindex task VL_UNUSED,
+                           vl_uindex begin, vl_uindex end)
+{
+  VlDsiftLoop * loop = loop_ ;
+  VlDsiftFilter * self = loop->self ;
+  VlDsiftRegion const * region = loop->region ;
+  int framey ;
+  int numFramesX = _vl_dsift_get_num_frames_x (self) ;
+  int frameSizeX = self->geom.binSizeX * (self->geom.numBinX - 1) + 1 ;
+  int frameSizeY = self->geom.binSizeY * (self->geom.numBinY - 1) + 1 ;
+  int descrSize = vl_dsift_get_descriptor_size (self) ;
+
+  float deltaCenterX = 0.5F * self->geom.binSizeX * (self->geom.numBinX - 1) ;
+  float deltaCenterY = 0.5F * self->geom.binSizeY * (self->geom.numBinY - 1) ;
+
+  float normConstant = frameSizeX * frameSizeY ;
+
+  for (framey = region->frameMinY + (int)begin ;
+       framey < region->frameMinY + (int)end ; ++framey) {
+    int framex, bint ;
+    for (framex = region->frameMinX ; framex <= region->frameMaxX ; ++framex) {
+      VlDsiftKeypoint* frameIter = self->frames + framey * numFramesX + framex ;
+      float * descrIter = self->descrs + (framey * numFramesX + framex) * descrSize ;
+
+      frameIter->x    = self->boundMinX + framex * self->stepX + deltaCenterX ;
+      frameIter->y    = self->boundMinY + framey * self->stepY + deltaCenterY ;
+
+      /* mass */
+      {
+        float mass = 0 ;
+        for (bint = 0 ; bint < descrSize ; ++ bint)
+          mass += descrIter[bint] ;
+        mass /= normConstant ;
+        frameIter->norm = mass ;
+      }
 
-  for (y = 0 ; y < self->imHeight ; ++ y) {
-    for (x = 0 ; x < self->imWidth ; ++ x) {
-      float gx, gy ;
-      float angle, mod, nt, rbint ;
-      int bint ;
+      /* L2 normalize */
+      _vl_dsift_normalize_histogram (descrIter, descrIter + descrSize) ;
 
-      /* y derivative */
-      if (y == 0) {
-        gy = at(x,y+1) - at(x,y) ;
-      } else if (y == self->imHeight - 1) {
-        gy = at(x,y) - at(x,y-1) ;
-      } else {
-        gy = 0.5F * (at(x,y+1) - at(x,y-1)) ;
-      }
+      /* clamp */
+      for(bint = 0 ; bint < descrSize ; ++ bint)
+        if (descrIter[bint] > 0.2F) descrIter[bint] = 0.2F ;
 
-      /* x derivative */
-      if (x == 0) {
-        gx = at(x+1,y) - at(x,y) ;
-      } else if (x == self->imWidth - 1) {
-        gx = at(x,y) - at(x-1,y) ;
-      } else {
-        gx = 0.5F * (at(x+1,y) - at(x-1,y)) ;
-      }
+      /* L2 normalize */
+      _vl_dsift_normalize_histogram (descrIter, descrIter + descrSize) ;
+    } /* for framex */
+  } /* for framey */
+}
 
-      /* angle and modulus */
-      angle = vl_fast_atan2_f (gy,gx) ;
-      mod = vl_fast_sqrt_f (gx*gx + gy*gy) ;
+/** ------------------------------------------------------------------
+ ** @internal @brief Compute the keypoints and descriptors of a region
+ ** @param self DSIFT filter.
+ ** @param region region to process.
+ **
+ ** The gradients must be up to date. Descriptor rows are normalized
+ ** in parallel.
+ **/
 
-      /* quantize angle */
-      nt = vl_mod_2pi_f (angle) * (self->geom.numBinT / (2*VL_PI)) ;
-      bint = (int) vl_floor_f (nt) ;
-      rbint = nt - bint ;
+static void
+_vl_dsift_process_region (VlDsiftFilter * self, VlDsiftRegion const * region)
+{
+  vl_size numRows ;
+  VlDsiftLoop loop ;
 
-      /* write it back */
-      self->grads [(bint    ) % self->geom.numBinT][x + y * self->imWidth] = (1 - rbint) * mod ;
-      self->grads [(bint + 1) % self->geom.numBinT][x + y * self->imWidth] = (    rbint) * mod ;
-    }
-  }
+  if (region->frameMinX > region->frameMaxX ||
+      region->frameMinY > region->frameMaxY) return ;
 
   if (self->useFlatWindow) {
-    _vl_dsift_with_flat_window(self) ;
+    _vl_dsift_with_flat_window(self, region) ;
   } else {
-    _vl_dsift_with_gaussian_window(self) ;
+    _vl_dsift_with_gaussian_window(self, region) ;
   }
 
-  {
-    VlDsiftKeypoint* frameIter = self->frames ;
-    float * descrIter = self->descrs ;
-    int framex, framey, bint ;
+  numRows = region->frameMaxY - region->frameMinY + 1 ;
+  memset (&loop, 0, sizeof(loop)) ;
+  loop.self = self ;
+  loop.region = region ;
+  vl_parallel_for (numRows, VL_MIN(vl_get_max_threads(), numRows),
+                   _vl_dsift_normalize_range, &loop) ;
+}
 
-    int frameSizeX = self->geom.binSizeX * (self->geom.numBinX - 1) + 1 ;
-    int frameSizeY = self->geom.binSizeY * (self->geom.numBinY - 1) + 1 ;
-    int descrSize = vl_dsift_get_descriptor_size (self) ;
+/** ------------------------------------------------------------------
+ ** @brief Compute keypoints and descriptors
+ **
+ ** @param self DSIFT filter.
+ ** @param im   image data.
+ **
+ ** Orientation planes and descriptor rows are processed in parallel
+ ** (see @ref threads). The internal buffers are reused across calls
+ ** as long as the geometry does not change.
+ **/
 
-    float deltaCenterX = 0.5F * self->geom.binSizeX * (self->geom.numBinX - 1) ;
-    float deltaCenterY = 0.5F * self->geom.binSizeY * (self->geom.numBinY - 1) ;
+void vl_dsift_process (VlDsiftFilter* self, float const* im)
+{
+  VlDsiftRegion region ;
 
-    float normConstant = frameSizeX * frameSizeY ;
+  /* update buffers */
+  _vl_dsift_alloc_buffers (self) ;
 
-    for (framey  = self->boundMinY ;
-         framey <= self->boundMaxY - frameSizeY + 1 ;
-         framey += self->stepY) {
+  region.minX = 0 ;
+  region.minY = 0 ;
+  region.maxX = self->imWidth - 1 ;
+  region.maxY = self->imHeight - 1 ;
+  region.frameMinX = 0 ;
+  region.frameMinY = 0 ;
+  region.frameMaxX = _vl_dsift_get_num_frames_x (self) - 1 ;
+  region.frameMaxY = _vl_dsift_get_num_frames_y (self) - 1 ;
+
+  _vl_dsift_compute_gradients (self, im, 0, 0, self->imWidth - 1, self->imHeight - 1) ;
+  _vl_dsift_process_region (self, &region) ;
+  self->hasResults = VL_TRUE ;
+}
 
-      for (framex  = self->boundMinX ;
-           framex <= self->boundMaxX - frameSizeX + 1 ;
-           framex += self->stepX) {
+/** ------------------------------------------------------------------
+ ** @internal @brief Integer division rounding towards minus infinity
+ **/
 
-        frameIter->x    = framex + deltaCenterX ;
-        frameIter->y    = framey + deltaCenterY ;
+static int
+_vl_dsift_floor_div (int a, int b)
+{
+  return (a >= 0) ? a / b : - ((- a + b - 1) / b) ;
+}
 
-        /* mass */
-        {
-          float mass = 0 ;
-          for (bint = 0 ; bint < descrSize ; ++ bint)
-            mass += descrIter[bint] ;
-          mass /= normConstant ;
-          frameIter->norm = mass ;
-        }
+/** ------------------------------------------------------------------
+ ** @brief Update keypoints and descriptors after a local image change
+ **
+ ** @param self DSIFT filter.
+ ** @param im   image data.
+ ** @param minX changed rectangle minimum X coordinate.
+ ** @param minY changed rectangle minimum Y coordinate.
+ ** @param maxX changed rectangle maximum X coordinate.
+ ** @param maxY changed rectangle maximum Y coordinate.
+ **
+ ** The function assumes that @a im differs from the image passed to
+ ** the last call of ::vl_dsift_process or ::vl_dsift_update only in
+ ** the rectangle <code>[minX,maxX] x [minY,maxY]</code> (inclusive).
+ ** It recomputes only the descriptors whose support
+ ** intersects the rectangle, which is much faster than
+ ** ::vl_dsift_process for small changes (e.g. in consecutive frames
+ ** of a video taken with a static camera). An empty rectangle leaves
+ ** the descriptors unchanged.
+ **
+ ** If no image was processed yet, or if a parameter was changed since
+ ** then, the function calls ::vl_dsift_process instead. The updated
+ ** descriptors are the same as the ones computed by
+ ** ::vl_dsift_process, except for the rounding of the integral
+ ** signals used with the flat window.
+ **/
 
-        /* L2 normalize */
-        _vl_dsift_normalize_histogram (descrIter, descrIter + descrSize) ;
+void
+vl_dsift_update (VlDsiftFilter* self, float const* im,
+                 int minX, int minY, int maxX, int maxY)
+{
+  VlDsiftRegion region ;
+  int numFramesX = _vl_dsift_get_num_frames_x (self) ;
+  int numFramesY = _vl_dsift_get_num_frames_y (self) ;
+  int frameSizeX = self->geom.binSizeX * (self->geom.numBinX - 1) + 1 ;
+  int frameSizeY = self->geom.binSizeY * (self->geom.numBinY - 1) + 1 ;
+  int marginX = self->geom.binSizeX - 1 ;
+  int marginY = self->geom.binSizeY - 1 ;
+
+  if (! self->hasResults) {
+    vl_dsift_process (self, im) ;
+    return ;
+  }
 
-        /* clamp */
-        for(bint = 0 ; bint < descrSize ; ++ bint)
-          if (descrIter[bint] > 0.2F) descrIter[bint] = 0.2F ;
+  /* the gradients depend on the neighbouring pixels */
+  minX = VL_MAX(minX - 1, 0) ;
+  minY = VL_MAX(minY - 1, 0) ;
+  maxX = VL_MIN(maxX + 1, self->imWidth - 1) ;
+  maxY = VL_MIN(maxY + 1, self->imHeight - 1) ;
+  if (minX > maxX || minY > maxY) return ;
 
-        /* L2 normalize */
-        _vl_dsift_normalize_histogram (descrIter, descrIter + descrSize) ;
+  _vl_dsift_compute_gradients (self, im, minX, minY, maxX, maxY) ;
 
-        frameIter ++ ;
-        descrIter += descrSize ;
-      } /* for framex */
-    } /* for framey */
-  }
+  /*
+   The smoothed orientation planes change up to the bin filter
+   support away from the gradients. The descriptors to recompute are
+   the ones whose extent overlaps this area.
+   */
+  region.frameMinX = - _vl_dsift_floor_div
+    (- (minX - marginX - frameSizeX + 1 - self->boundMinX), self->stepX) ;
+  region.frameMinY = - _vl_dsift_floor_div
+    (- (minY - marginY - frameSizeY + 1 - self->boundMinY), self->stepY) ;
+  region.frameMaxX = _vl_dsift_floor_div (maxX + marginX - self->boundMinX, self->stepX) ;
+  region.frameMaxY = _vl_dsift_floor_div (maxY + marginY - self->boundMinY, self->stepY) ;
+  region.frameMinX = VL_MAX(region.frameMinX, 0) ;
+  region.frameMinY = VL_MAX(region.frameMinY, 0) ;
+  region.frameMaxX = VL_MIN(region.frameMaxX, numFramesX - 1) ;
+  region.frameMaxY = VL_MIN(region.frameMaxY, numFramesY - 1) ;
+
+  /* convolve just the support of these descriptors */
+  region.minX = VL_MAX(self->boundMinX + region.frameMinX * self->stepX - marginX, 0) ;
+  region.minY = VL_MAX(self->boundMinY + region.frameMinY * self->stepY - marginY, 0) ;
+  region.maxX = VL_MIN(self->boundMinX + region.frameMaxX * self->stepX
+                       + frameSizeX - 1 + marginX, self->imWidth - 1) ;
+  region.maxY = VL_MIN(self->boundMinY + region.frameMaxY * self->stepY
+                       + frameSizeY - 1 + marginY, self->imHeight - 1) ;
+
+  _vl_dsift_process_region (self, &region) ;
 }
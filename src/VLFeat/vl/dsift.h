@@ -66,14 +66,18 @@ typedef struct VlDsiftFilter_
   int numGradAlloc ;       /**< buffer allocated: number of orientations */
 
   float **grads ;          /**< gradient buffer */
-  float *convTmp1 ;        /**< temporary buffer */
-  float *convTmp2 ;        /**< temporary buffer */
+  float *convTmp1 ;        /**< temporary buffer (one image per orientation) */
+  float *convTmp2 ;        /**< temporary buffer (one image per orientation) */
+
+  vl_bool hasResults ;     /**< @internal @brief buffers hold the results for the last image */
 }  VlDsiftFilter ;
 
 VL_EXPORT VlDsiftFilter *vl_dsift_new (int width, int height) ;
 VL_EXPORT VlDsiftFilter *vl_dsift_new_basic (int width, int height, int step, int binSize) ;
 VL_EXPORT void vl_dsift_delete (VlDsiftFilter *self) ;
 VL_EXPORT void vl_dsift_process (VlDsiftFilter *self, float const* im) ;
+VL_EXPORT void vl_dsift_update (VlDsiftFilter *self, float const* im,
+                                int minX, int minY, int maxX, int maxY) ;
 VL_INLINE void vl_dsift_transpose_descriptor (float* dst,
                                              float const* src,
                                              int numBinT,
@@ -286,6 +290,7 @@ vl_dsift_set_flat_window (VlDsiftFilter* self,
                          vl_bool useFlatWindow)
 {
   self->useFlatWindow = useFlatWindow ;
+  self->hasResults = VL_FALSE ;
 }
 
 /** ------------------------------------------------------------------
@@ -336,6 +341,7 @@ vl_dsift_set_window_size(VlDsiftFilter * self, double windowSize)
 {
   assert(windowSize >= 0.0) ;
   self->windowSize = windowSize ;
+  self->hasResults = VL_FALSE ;
 }
 
 /** ------------------------------------------------------------------
@@ -72,6 +72,38 @@ improved @cite{perronnin10improving} by using appropriate @ref
 fisher-normalization normalizations. These are controlled by the @c
 flag parameter of ::vl_fisher_encode.
 
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@section fisher-streaming Incremental encoding
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+The FV is an average of terms computed independently for each
+feature. Hence it can be computed incrementally, as features become
+available (for example as they are extracted by @ref sift), without
+storing all of them in memory. This is done by a ::VlFisherEncoder
+object, which precomputes the quantities required to evaluate the GMM
+posteriors (e.g. the inverse covariances) once, and can then be used
+to encode any number of images:
+
+@code
+VlFisherEncoder * encoder = vl_fisher_encoder_new
+  (VL_TYPE_FLOAT,
+   vl_gmm_get_means(gmm), dimension, numClusters,
+   vl_gmm_get_covariances(gmm),
+   vl_gmm_get_priors(gmm),
+   VL_FISHER_FLAG_IMPROVED) ;
+
+vl_fisher_encoder_begin (encoder) ;
+while (... more features ...) {
+  vl_fisher_encoder_push (encoder, features, numFeatures) ;
+}
+vl_fisher_encoder_finalize (encoder, enc) ;
+vl_fisher_encoder_delete (encoder) ;
+@endcode
+
+The result is the same as calling ::vl_fisher_encode on all the
+features at once (in fact, the latter is implemented in this
+manner).
+
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 @page fisher-fundamentals Fisher vector fundamentals
 @tableofcontents
@@ -154,6 +186,11 @@ In practice, several data to cluster assignments $q_{ik}$ are likely
 to be very small or even negligible. The *fast* version of the FV sets
 to zero all but the largest assignment for each input feature $\bx_i$.
 
+Even without this option, posteriors smaller than $10^{-6}$ are
+ignored. Since posteriors vary exponentially with the log-likelihoods,
+most of them are negligible and are set to zero directly by comparing
+the log-likelihoods, without evaluating the exponential function.
+
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 @page fisher-derivation Fisher vector derivation
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
@@ -358,109 +395,274 @@ kernel*:
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef VL_FISHER_INSTANTIATING
+#ifndef VL_FISHER_INSTANTIATING
 
-static vl_size
-VL_XCAT(_vl_fisher_encode_, SFX)
-(TYPE * enc,
- TYPE const * means, vl_size dimension, vl_size numClusters,
- TYPE const * covariances,
- TYPE const * priors,
- TYPE const * data, vl_size numData,
- int flags)
-{
-  vl_size dim;
-  vl_index i_cl, i_d;
-  vl_size numTerms = 0 ;
-  TYPE * posteriors ;
-  TYPE * sqrtInvSigma;
+/** @internal @brief Number of data points whose posteriors are computed at once */
+#define VL_FISHER_BLOCK_SIZE 256
 
-  assert(numClusters >= 1) ;
-  assert(dimension >= 1) ;
+/** @internal @brief Log-posterior (relative to the largest one) below which the posterior is set to zero */
+#define VL_FISHER_MIN_LOG_POSTERIOR (-30)
 
-  posteriors = vl_malloc(sizeof(TYPE) * numClusters * numData);
-  sqrtInvSigma = vl_malloc(sizeof(TYPE) * dimension * numClusters);
+/** @internal @brief Smallest prior or posterior used in the encoding */
+#define VL_FISHER_MIN_POSTERIOR 1e-6
 
-  memset(enc, 0, sizeof(TYPE) * 2 * dimension * numClusters) ;
+/** @internal @brief Smallest prior of a GMM component (as in @ref gmm) */
+#define VL_FISHER_MIN_PRIOR 1e-6
 
-  for (i_cl = 0 ; i_cl < (signed)numClusters ; ++i_cl) {
-    for(dim = 0; dim < dimension; dim++) {
-      sqrtInvSigma[i_cl*dimension + dim] = sqrt(1.0 / covariances[i_cl*dimension + dim]);
+struct _VlFisherEncoder
+{
+  vl_type dataType ;          /**< Data type. */
+  vl_size dimension ;         /**< Data dimensionality. */
+  vl_size numClusters ;       /**< Number of GMM components. */
+  int flags ;                 /**< Encoding options. */
+
+  void * means ;              /**< GMM means. */
+  void * priors ;             /**< GMM priors. */
+  void * invCovariances ;     /**< Inverse of the GMM covariances. */
+  void * sqrtInvSigma ;       /**< Inverse of the GMM standard deviations. */
+  void * logCovariances ;     /**< Log-determinant of the GMM covariances. */
+  void * logWeights ;         /**< Log of the GMM priors. */
+
+  void * enc ;                /**< Accumulated statistics. */
+  void * posteriors ;         /**< Posteriors of a block of data. */
+  vl_size * blockNumTerms ;   /**< Averaging operations of each component in a block. */
+  vl_size numData ;           /**< Number of data encoded so far. */
+  vl_size numTerms ;          /**< Number of averaging operations so far. */
+} ;
+
+/** @internal @brief Block of data processed by the parallel loops */
+typedef struct _VlFisherBlock
+{
+  VlFisherEncoder * self ;    /**< Encoder. */
+  void const * data ;         /**< Data. */
+  vl_size numData ;           /**< Number of data. */
+} VlFisherBlock ;
+
+/* not VL_FISHER_INSTANTIATING */
+#endif
+
+/* ================================================================ */
+#ifdef VL_FISHER_INSTANTIATING
+
+static void
+VL_XCAT(_vl_fisher_encoder_init_, SFX)
+(VlFisherEncoder * self,
+ TYPE const * means,
+ TYPE const * covariances,
+ TYPE const * priors)
+{
+  TYPE * invCovariances = self->invCovariances ;
+  TYPE * sqrtInvSigma = self->sqrtInvSigma ;
+  TYPE * logCovariances = self->logCovariances ;
+  TYPE * logWeights = self->logWeights ;
+  vl_size dimension = self->dimension ;
+  vl_uindex i_cl, dim ;
+
+  memcpy(self->means, means, sizeof(TYPE) * dimension * self->numClusters) ;
+  memcpy(self->priors, priors, sizeof(TYPE) * self->numClusters) ;
+
+  for (i_cl = 0 ; i_cl < self->numClusters ; ++i_cl) {
+    TYPE logSigma = 0 ;
+    if (priors[i_cl] < VL_FISHER_MIN_PRIOR) {
+      logWeights[i_cl] = - (TYPE) VL_INFINITY_D ;
+    } else {
+      logWeights[i_cl] = log(priors[i_cl]) ;
+    }
+    for (dim = 0 ; dim < dimension ; ++dim) {
+      logSigma += log(covariances[i_cl*dimension + dim]) ;
+      invCovariances[i_cl*dimension + dim] = (TYPE) 1.0 / covariances[i_cl*dimension + dim] ;
+      sqrtInvSigma[i_cl*dimension + dim] = sqrt(1.0 / covariances[i_cl*dimension + dim]) ;
     }
+    logCovariances[i_cl] = logSigma ;
   }
+}
 
-  VL_XCAT(vl_get_gmm_data_posteriors_, SFX)(posteriors, numClusters, numData,
-                                            priors,
-                                            means, dimension,
-                                            covariances,
-                                            data) ;
-
-  /* sparsify posterior assignments with the FAST option */
-  if (flags & VL_FISHER_FLAG_FAST) {
-    for(i_d = 0; i_d < (signed)numData; i_d++) {
-      /* find largest posterior assignment for datum i_d */
-      vl_index best = 0 ;
-      TYPE bestValue = posteriors[i_d * numClusters] ;
-      for (i_cl = 1 ; i_cl < (signed)numClusters; ++ i_cl) {
-        TYPE p = posteriors[i_cl + i_d * numClusters] ;
-        if (p > bestValue) {
-          bestValue = p ;
-          best = i_cl ;
-        }
+/*
+ The posteriors of a block of data are computed by evaluating the
+ log-likelihood of each GMM component with the (SIMD) Mahalanobis
+ distance and the precomputed inverse covariances. Posteriors much
+ smaller than the largest one are set to zero without evaluating the
+ exponential. With the FAST option, only the largest one is kept and
+ no exponential is evaluated at all.
+ */
+
+static void
+VL_XCAT(_vl_fisher_encoder_get_posteriors_, SFX)
+(void * block_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlFisherBlock const * block = block_ ;
+  VlFisherEncoder const * self = block->self ;
+  TYPE const * data = block->data ;
+  TYPE * posteriors = self->posteriors ;
+  TYPE const * means = self->means ;
+  TYPE const * invCovariances = self->invCovariances ;
+  TYPE const * logCovariances = self->logCovariances ;
+  TYPE const * logWeights = self->logWeights ;
+  vl_size dimension = self->dimension ;
+  vl_size numClusters = self->numClusters ;
+  TYPE halfDimLog2Pi = (dimension / 2.0) * log(2.0*VL_PI) ;
+  vl_uindex i_d ;
+
+#if (FLT == VL_TYPE_FLOAT)
+  VlFloatVector3ComparisonFunction distFn = vl_get_vector_3_comparison_function_f(VlDistanceMahalanobis) ;
+#else
+  VlDoubleVector3ComparisonFunction distFn = vl_get_vector_3_comparison_function_d(VlDistanceMahalanobis) ;
+#endif
+
+  for (i_d = begin ; i_d < end ; ++i_d) {
+    TYPE * q = posteriors + i_d * numClusters ;
+    TYPE maxPosterior = (TYPE)(-VL_INFINITY_D) ;
+    TYPE clusterPosteriorsSum = 0 ;
+    vl_uindex i_cl, best = 0 ;
+
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
+      TYPE p =
+      logWeights[i_cl]
+      - halfDimLog2Pi
+      - 0.5 * logCovariances[i_cl]
+      - 0.5 * distFn (dimension,
+                      data + i_d * dimension,
+                      means + i_cl * dimension,
+                      invCovariances + i_cl * dimension) ;
+      q[i_cl] = p ;
+      if (p > maxPosterior) { maxPosterior = p ; best = i_cl ; }
+    }
+
+    if (self->flags & VL_FISHER_FLAG_FAST) {
+      for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
+        q[i_cl] = (TYPE)(i_cl == best) ;
       }
-      /* make all posterior assignments zero but the best one */
-      for (i_cl = 0 ; i_cl < (signed)numClusters; ++ i_cl) {
-        posteriors[i_cl + i_d * numClusters] =
-        (TYPE)(i_cl == best) ;
+      continue ;
+    }
+
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
+      TYPE p = q[i_cl] - maxPosterior ;
+      if (p < VL_FISHER_MIN_LOG_POSTERIOR) {
+        q[i_cl] = 0 ;
+      } else {
+        p = exp(p) ;
+        q[i_cl] = p ;
+        clusterPosteriorsSum += p ;
       }
     }
-  }
 
-#if defined(_OPENMP)
-#pragma omp parallel for default(shared) private(i_cl, i_d, dim) num_threads(vl_get_max_threads()) reduction(+:numTerms)
-#endif
-  for(i_cl = 0; i_cl < (signed)numClusters; ++ i_cl) {
-    TYPE uprefix;
-    TYPE vprefix;
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
+      q[i_cl] /= clusterPosteriorsSum ;
+    }
+  }
+}
 
+/*
+ The statistics of the components are independent and are updated in
+ parallel; each component counts its own averaging operations, so
+ that the total does not depend on the number of threads.
+ */
+
+static void
+VL_XCAT(_vl_fisher_encoder_accumulate_, SFX)
+(void * block_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlFisherBlock const * block = block_ ;
+  VlFisherEncoder const * self = block->self ;
+  TYPE const * data = block->data ;
+  TYPE const * means = self->means ;
+  TYPE const * priors = self->priors ;
+  TYPE const * sqrtInvSigma = self->sqrtInvSigma ;
+  TYPE const * posteriors = self->posteriors ;
+  TYPE * enc = self->enc ;
+  vl_size dimension = self->dimension ;
+  vl_size numClusters = self->numClusters ;
+  vl_size blockSize = block->numData ;
+  vl_uindex i_cl, i_d, dim ;
+
+  for (i_cl = begin ; i_cl < end ; ++i_cl) {
+    vl_size numTerms = 0 ;
     TYPE * uk = enc + i_cl*dimension ;
     TYPE * vk = enc + i_cl*dimension + numClusters * dimension ;
+    self->blockNumTerms[i_cl] = 0 ;
 
     /*
-    If the GMM component is degenerate and has a null prior, then it
-    must have null posterior as well. Hence it is safe to skip it.  In
-    practice, we skip over it even if the prior is very small; if by
-    any chance a feature is assigned to such a mode, then its weight
-    would be very high due to the division by priors[i_cl] below.
-    */
-    if (priors[i_cl] < 1e-6) { continue ; }
-
-    for(i_d = 0; i_d < (signed)numData; i_d++) {
+     If the GMM component is degenerate and has a null prior, then it
+     must have null posterior as well. Hence it is safe to skip it.  In
+     practice, we skip over it even if the prior is very small; if by
+     any chance a feature is assigned to such a mode, then its weight
+     would be very high due to the division by priors[i_cl] below.
+     */
+    if (priors[i_cl] < VL_FISHER_MIN_PRIOR) { continue ; }
+
+    for (i_d = 0 ; i_d < blockSize ; ++i_d) {
       TYPE p = posteriors[i_cl + i_d * numClusters] ;
-      if (p < 1e-6) continue ;
-      numTerms += 1;
-      for(dim = 0; dim < dimension; dim++) {
+      if (p < VL_FISHER_MIN_POSTERIOR) continue ;
+      numTerms += 1 ;
+      for (dim = 0 ; dim < dimension ; ++dim) {
         TYPE diff = data[i_d*dimension + dim] - means[i_cl*dimension + dim] ;
         diff *= sqrtInvSigma[i_cl*dimension + dim] ;
         *(uk + dim) += p * diff ;
-        *(vk + dim) += p * (diff * diff - 1);
+        *(vk + dim) += p * (diff * diff - 1) ;
       }
     }
+    self->blockNumTerms[i_cl] = numTerms ;
+  }
+}
+
+static void
+VL_XCAT(_vl_fisher_encoder_push_, SFX)
+(VlFisherEncoder * self, TYPE const * data, vl_size numData)
+{
+  vl_size dimension = self->dimension ;
+  vl_size numClusters = self->numClusters ;
+  vl_uindex begin ;
+
+  for (begin = 0 ; begin < numData ; begin += VL_FISHER_BLOCK_SIZE) {
+    vl_size blockSize = VL_MIN(numData - begin, VL_FISHER_BLOCK_SIZE) ;
+    vl_uindex i_cl ;
+    VlFisherBlock block ;
+    block.self = self ;
+    block.data = data + begin * dimension ;
+    block.numData = blockSize ;
+
+    vl_parallel_for (blockSize, 0,
+                     VL_XCAT(_vl_fisher_encoder_get_posteriors_, SFX),
+                     &block) ;
+    vl_parallel_for (numClusters, 0,
+                     VL_XCAT(_vl_fisher_encoder_accumulate_, SFX),
+                     &block) ;
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
+      self->numTerms += self->blockNumTerms[i_cl] ;
+    }
+  }
+  self->numData += numData ;
+}
 
-    if (numData > 0) {
-      uprefix = 1/(numData*sqrt(priors[i_cl]));
-      vprefix = 1/(numData*sqrt(2*priors[i_cl]));
-      for(dim = 0; dim < dimension; dim++) {
-        *(uk + dim) = *(uk + dim) * uprefix;
-        *(vk + dim) = *(vk + dim) * vprefix;
+static void
+VL_XCAT(_vl_fisher_encoder_finalize_, SFX)
+(VlFisherEncoder const * self, TYPE * enc)
+{
+  TYPE const * priors = self->priors ;
+  vl_size dimension = self->dimension ;
+  vl_size numClusters = self->numClusters ;
+  vl_size numData = self->numData ;
+  vl_uindex i_cl, dim ;
+
+  memcpy(enc, self->enc, sizeof(TYPE) * 2 * dimension * numClusters) ;
+
+  if (numData > 0) {
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
+      TYPE * uk = enc + i_cl*dimension ;
+      TYPE * vk = enc + i_cl*dimension + numClusters * dimension ;
+      TYPE uprefix ;
+      TYPE vprefix ;
+      if (priors[i_cl] < VL_FISHER_MIN_PRIOR) { continue ; }
+      uprefix = 1/(numData*sqrt(priors[i_cl])) ;
+      vprefix = 1/(numData*sqrt(2*priors[i_cl])) ;
+      for (dim = 0 ; dim < dimension ; ++dim) {
+        *(uk + dim) = *(uk + dim) * uprefix ;
+        *(vk + dim) = *(vk + dim) * vprefix ;
       }
     }
   }
 
-  vl_free(posteriors);
-  vl_free(sqrtInvSigma) ;
-
-  if (flags & VL_FISHER_FLAG_SQUARE_ROOT) {
+  if (self->flags & VL_FISHER_FLAG_SQUARE_ROOT) {
     for(dim = 0; dim < 2 * dimension * numClusters ; dim++) {
       TYPE z = enc [dim] ;
       if (z >= 0) {
@@ -471,7 +673,7 @@ VL_XCAT(_vl_fisher_encode_, SFX)
     }
   }
 
-  if (flags & VL_FISHER_FLAG_NORMALIZED) {
+  if (self->flags & VL_FISHER_FLAG_NORMALIZED) {
     TYPE n = 0 ;
     for(dim = 0 ; dim < 2 * dimension * numClusters ; dim++) {
       TYPE z = enc [dim] ;
@@ -483,8 +685,6 @@ VL_XCAT(_vl_fisher_encode_, SFX)
       enc[dim] /= n ;
     }
   }
-
-  return numTerms ;
 }
 
 #else
@@ -510,6 +710,170 @@ VL_XCAT(_vl_fisher_encode_, SFX)
 /* ================================================================ */
 #ifndef VL_FISHER_INSTANTIATING
 
+/** @brief Create a new Fisher vector encoder
+ ** @param dataType the type of the data (::VL_TYPE_DOUBLE or ::VL_TYPE_FLOAT).
+ ** @param means Gaussian mixture means.
+ ** @param dimension dimension of the data.
+ ** @param numClusters number of Gaussians mixture components.
+ ** @param covariances Gaussian mixture diagonal covariances.
+ ** @param priors Gaussian mixture prior probabilities.
+ ** @param flags options.
+ ** @return new encoder.
+ **
+ ** The GMM parameters have the same format as in ::vl_fisher_encode
+ ** and are copied in the object, together with the inverse
+ ** covariances and the other quantities required to compute the
+ ** posteriors. The object can encode several sets of vectors in turn
+ ** (@ref fisher-streaming).
+ **
+ ** @sa ::vl_fisher_encoder_delete
+ **/
+
+VlFisherEncoder *
+vl_fisher_encoder_new
+(vl_type dataType,
+ void const * means, vl_size dimension, vl_size numClusters,
+ void const * covariances,
+ void const * priors,
+ int flags)
+{
+  VlFisherEncoder * self = vl_calloc(1, sizeof(VlFisherEncoder)) ;
+  vl_size size = vl_get_type_size(dataType) ;
+
+  assert(numClusters >= 1) ;
+  assert(dimension >= 1) ;
+
+  self->dataType = dataType ;
+  self->dimension = dimension ;
+  self->numClusters = numClusters ;
+  self->flags = flags ;
+
+  self->means = vl_malloc(size * dimension * numClusters) ;
+  self->priors = vl_malloc(size * numClusters) ;
+  self->invCovariances = vl_malloc(size * dimension * numClusters) ;
+  self->sqrtInvSigma = vl_malloc(size * dimension * numClusters) ;
+  self->logCovariances = vl_malloc(size * numClusters) ;
+  self->logWeights = vl_malloc(size * numClusters) ;
+  self->enc = vl_malloc(size * 2 * dimension * numClusters) ;
+  self->posteriors = vl_malloc(size * numClusters * VL_FISHER_BLOCK_SIZE) ;
+  self->blockNumTerms = vl_malloc(sizeof(vl_size) * numClusters) ;
+
+  switch (dataType) {
+    case VL_TYPE_FLOAT:
+      _vl_fisher_encoder_init_f (self, means, covariances, priors) ;
+      break ;
+    case VL_TYPE_DOUBLE:
+      _vl_fisher_encoder_init_d (self, means, covariances, priors) ;
+      break ;
+    default:
+      abort() ;
+  }
+
+  vl_fisher_encoder_begin (self) ;
+  return self ;
+}
+
+/** @brief Delete a Fisher vector encoder
+ ** @param self object.
+ ** @sa ::vl_fisher_encoder_new
+ **/
+
+void
+vl_fisher_encoder_delete (VlFisherEncoder * self)
+{
+  vl_free(self->means) ;
+  vl_free(self->priors) ;
+  vl_free(self->invCovariances) ;
+  vl_free(self->sqrtInvSigma) ;
+  vl_free(self->logCovariances) ;
+  vl_free(self->logWeights) ;
+  vl_free(self->enc) ;
+  vl_free(self->posteriors) ;
+  vl_free(self->blockNumTerms) ;
+  vl_free(self) ;
+}
+
+/** @brief Start encoding a new set of vectors
+ ** @param self object.
+ **
+ ** The function clears the statistics accumulated by
+ ** ::vl_fisher_encoder_push.
+ **/
+
+void
+vl_fisher_encoder_begin (VlFisherEncoder * self)
+{
+  memset(self->enc, 0, vl_get_type_size(self->dataType) *
+         2 * self->dimension * self->numClusters) ;
+  self->numData = 0 ;
+  self->numTerms = 0 ;
+}
+
+/** @brief Add vectors to the encoding
+ ** @param self object.
+ ** @param data vectors to encode.
+ ** @param numData number of vectors.
+ **
+ ** @a data has @a dimension rows and @a numData columns and the same
+ ** type as the encoder. The vectors are used to update the
+ ** statistics and are not needed after the function returns.
+ **/
+
+void
+vl_fisher_encoder_push (VlFisherEncoder * self, void const * data, vl_size numData)
+{
+  switch (self->dataType) {
+    case VL_TYPE_FLOAT:
+      _vl_fisher_encoder_push_f (self, (float const *) data, numData) ;
+      break ;
+    case VL_TYPE_DOUBLE:
+      _vl_fisher_encoder_push_d (self, (double const *) data, numData) ;
+      break ;
+    default:
+      abort() ;
+  }
+}
+
+/** @brief Compute the Fisher vector of the vectors added so far
+ ** @param self object.
+ ** @param enc Fisher vector (output).
+ ** @return number of averaging operations.
+ **
+ ** @a enc is a vector of size equal to twice the product of the data
+ ** dimension and the number of GMM components. The function
+ ** normalizes the accumulated statistics as specified by the encoder
+ ** flags, as ::vl_fisher_encode would do for all the vectors added
+ ** since the last call to ::vl_fisher_encoder_begin. The statistics
+ ** are not modified, so that more vectors can be added afterwards.
+ **/
+
+vl_size
+vl_fisher_encoder_finalize (VlFisherEncoder const * self, void * enc)
+{
+  switch (self->dataType) {
+    case VL_TYPE_FLOAT:
+      _vl_fisher_encoder_finalize_f (self, (float *) enc) ;
+      break ;
+    case VL_TYPE_DOUBLE:
+      _vl_fisher_encoder_finalize_d (self, (double *) enc) ;
+      break ;
+    default:
+      abort() ;
+  }
+  return self->numTerms ;
+}
+
+/** @brief Get the number of vectors added so far
+ ** @param self object.
+ ** @return number of vectors.
+ **/
+
+vl_size
+vl_fisher_encoder_get_num_data (VlFisherEncoder const * self)
+{
+  return self->numData ;
+}
+
 /** @brief Fisher vector encoding of a set of vectors.
  ** @param dataType the type of the input data (::VL_TYPE_DOUBLE or ::VL_TYPE_FLOAT).
  ** @param enc Fisher vector (output).
@@ -542,6 +906,9 @@ VL_XCAT(_vl_fisher_encode_, SFX)
  ** the ::VL_FISHER_FLAG_FAST, is equal to the number of input
  ** features. This information can be used for diagnostic purposes.
  **
+ ** To encode several images with the same GMM, or vectors that
+ ** become available incrementally, use a ::VlFisherEncoder instead.
+ **
  ** @sa @ref fisher
  **/
 
@@ -555,27 +922,13 @@ vl_fisher_encode
  int flags
 )
 {
-  switch(dataType) {
-    case VL_TYPE_FLOAT:
-      return _vl_fisher_encode_f
-      ((float *) enc,
-       (float const *) means, dimension, numClusters,
-       (float const *) covariances,
-       (float const *) priors,
-       (float const *) data, numData,
-       flags);
-    case VL_TYPE_DOUBLE:
-      return _vl_fisher_encode_d
-      ((double *) enc,
-       (double const *) means, dimension, numClusters,
-       (double const *) covariances,
-       (double const *) priors,
-       (double const *) data, numData,
-       flags);
-      break;
-    default:
-      abort();
-  }
+  vl_size numTerms ;
+  VlFisherEncoder * encoder = vl_fisher_encoder_new
+  (dataType, means, dimension, numClusters, covariances, priors, flags) ;
+  vl_fisher_encoder_push (encoder, data, numData) ;
+  numTerms = vl_fisher_encoder_finalize (encoder, enc) ;
+  vl_fisher_encoder_delete (encoder) ;
+  return numTerms ;
 }
 /* not VL_FISHER_INSTANTIATING */
 #endif
@@ -53,5 +53,28 @@ VL_EXPORT vl_size vl_fisher_encode
  void const * data, vl_size numData,
  int flags) ;
 
+#ifndef __DOXYGEN__
+struct _VlFisherEncoder ;
+typedef struct _VlFisherEncoder VlFisherEncoder ;
+#else
+/** @brief Fisher vector encoder */
+typedef OPAQUE VlFisherEncoder ;
+#endif
+
+/** @name Incremental encoding
+ ** @{ */
+VL_EXPORT VlFisherEncoder * vl_fisher_encoder_new
+(vl_type dataType,
+ void const * means, vl_size dimension, vl_size numClusters,
+ void const * covariances,
+ void const * priors,
+ int flags) ;
+VL_EXPORT void vl_fisher_encoder_delete (VlFisherEncoder * self) ;
+VL_EXPORT void vl_fisher_encoder_begin (VlFisherEncoder * self) ;
+VL_EXPORT void vl_fisher_encoder_push (VlFisherEncoder * self, void const * data, vl_size numData) ;
+VL_EXPORT vl_size vl_fisher_encoder_finalize (VlFisherEncoder const * self, void * enc) ;
+VL_EXPORT vl_size vl_fisher_encoder_get_num_data (VlFisherEncoder const * self) ;
+/** @} */
+
 /* VL_FISHER_H */
 #endif
@@ -719,11 +719,12 @@ rules are followed.
 @section threads-parallel Parallel computations
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 
-VLFeat uses OpenMP to implement parallel computations. Generally, this
-means that multiple cores are uses appropriately and transparently,
-provided that other multi-threaded parts of the application use OpenMP
-and that VLFeat and the application link to the same OpenMP library.
-If finer control is required, read on.
+VLFeat implements all its parallel computations with its own parallel
+loops (::vl_parallel_for), which run on a pool of threads or on a
+backend provided by the application (@ref threads-backend). OpenMP, if
+available, is only used to determine the default number of threads.
+Generally, this means that multiple cores are used appropriately and
+transparently. If finer control is required, read on.
 
 VLFeat functions avoids affecting OpenMP global state, including the
 desired number of computational threads, in order to minimize side
@@ -758,8 +759,41 @@ calling @c omp_set_num_threads() in the application. Note that:
 - @c vl_set_num_threads(vl_get_thread_limit()) causes VLFeat use all
   the available threads, regardless on the number of threads set
   within the application by calls to @c omp_set_num_threads().
-- OpenMP may still dynamically decide to use a smaller number of
-  threads in any specific parallel computation.
+- VLFeat may use a smaller number of threads in a specific parallel
+  computation, for example if this has fewer tasks than threads.
+
+If VLFeat is compiled without OpenMP, ::vl_get_max_threads defaults
+to the number of CPU cores.
+
+@subsection threads-backend Parallel backends
+
+::vl_parallel_for splits a loop in tasks and runs them on a
+backend. All the multi-threaded modules use it, so the backend and
+::vl_set_num_threads apply to all of them. By default, the backend is
+a pool of threads created the first time it is needed and kept until
+the library is unloaded. Idle workers
+block rather than spinning, and the thread calling ::vl_parallel_for
+takes part in the computation.
+
+An application with its own executor can make VLFeat share its
+threads by calling ::vl_set_parallel_backend with two functions, one
+submitting a job to the executor and one waiting for its completion:
+
+@code
+void * submit (void * context, VlParallelJobFunction function, void * data)
+{
+  return my_executor_post ((MyExecutor*)context, function, data) ;
+}
+void wait (void * context, void * job)
+{
+  my_executor_join ((MyExecutor*)context, job) ;
+}
+vl_set_parallel_backend (submit, wait, executor) ;
+@endcode
+
+::vl_parallel_for submits at most ::vl_get_max_threads - 1 jobs per
+loop; each of them runs the loop tasks that are not claimed yet, so
+that jobs which start late simply find no work left.
 
 @sa http://software.intel.com/sites/products/documentation/doclib/mkl_sa/11/mkl_userguide_win/GUID-C2295BC8-DD22-466B-94C9-5FAA79D4F56D.htm
  http://software.intel.com/sites/products/documentation/doclib/mkl_sa/11/mkl_userguide_win/index.htm#GUID-DEEF0363-2B34-4BAB-87FA-A75DBE842040.htm
@@ -812,8 +846,47 @@ typedef struct _VlThreadState
 #else
   clock_t ticMark ;
 #endif
+
+  /* parallel computations */
+  vl_bool inParallelLoop ;
 } VlThreadState ;
 
+#if ! defined(VL_DISABLE_THREADS)
+/* Maximum number of threads of the built-in pool */
+#define VL_THREAD_POOL_MAX_NUM_THREADS 256
+
+/* Job of the built-in thread pool */
+typedef struct _VlThreadPoolJob
+{
+  VlParallelJobFunction function ;
+  void * data ;
+  enum {VL_JOB_QUEUED, VL_JOB_RUNNING, VL_JOB_DONE} state ;
+  struct _VlThreadPoolJob * next ;
+#if defined(VL_THREADS_WIN)
+  HANDLE done ;
+#endif
+} VlThreadPoolJob ;
+
+/* Built-in thread pool */
+typedef struct _VlThreadPool
+{
+#if defined(VL_THREADS_POSIX)
+  pthread_mutex_t mutex ;
+  pthread_cond_t workCondition ;
+  pthread_cond_t doneCondition ;
+  pthread_t threads [VL_THREAD_POOL_MAX_NUM_THREADS] ;
+#elif defined(VL_THREADS_WIN)
+  CRITICAL_SECTION mutex ;
+  HANDLE workSemaphore ;
+  HANDLE threads [VL_THREAD_POOL_MAX_NUM_THREADS] ;
+#endif
+  vl_size numThreads ;
+  VlThreadPoolJob * first ;
+  VlThreadPoolJob * last ;
+  vl_bool shutdown ;
+} VlThreadPool ;
+#endif /* VL_DISABLE_THREADS */
+
 /* Gobal state */
 typedef struct _VlState
 {
@@ -847,6 +920,14 @@ typedef struct _VlState
   vl_size numCPUs ;
   vl_bool simdEnabled ;
   vl_size numThreads ;
+
+  /* Parallel backend */
+  VlParallelSubmitFunction parallelSubmit ;
+  VlParallelWaitFunction parallelWait ;
+  void * parallelContext ;
+#if ! defined(VL_DISABLE_THREADS)
+  VlThreadPool threadPool ;
+#endif
 } VlState ;
 
 /* Global state instance */
@@ -1084,6 +1165,34 @@ vl_get_simd_enabled (void)
   return vl_get_state()->simdEnabled ;
 }
 
+/** @brief Check for FMA instruction set
+ ** @return @c true if the fused multiply-add (FMA3) instructions are present.
+ **/
+
+vl_bool
+vl_cpu_has_fma (void)
+{
+#if defined(VL_ARCH_IX86) || defined(VL_ARCH_X64) || defined(VL_ARCH_IA64)
+  return vl_get_state()->cpuInfo.hasFMA ;
+#else
+  return VL_FALSE ;
+#endif
+}
+
+/** @brief Check for AVX2 instruction set
+ ** @return @c true if AVX2 is present.
+ **/
+
+vl_bool
+vl_cpu_has_avx2 (void)
+{
+#if defined(VL_ARCH_IX86) || defined(VL_ARCH_X64) || defined(VL_ARCH_IA64)
+  return vl_get_state()->cpuInfo.hasAVX2 ;
+#else
+  return VL_FALSE ;
+#endif
+}
+
 /** @brief Check for AVX instruction set
  ** @return @c true if AVX is present.
  **/
@@ -1165,8 +1274,8 @@ vl_get_thread_limit (void)
  ** however, it reads a parameter private to VLFeat which is
  ** independent of the value used by the OpenMP library.
  **
- ** If VLFeat was compiled without OpenMP support, this function
- ** returns 1.
+ ** If VLFeat was compiled without threading support
+ ** (::VL_DISABLE_THREADS), this function returns 1.
  **
  ** @sa vl_set_num_threads(), @ref threads-parallel
  **/
@@ -1174,11 +1283,7 @@ vl_get_thread_limit (void)
 vl_size
 vl_get_max_threads (void)
 {
-#if defined(_OPENMP)
   return vl_get_state()->numThreads ;
-#else
-  return 1 ;
-#endif
 }
 
 /** @brief Set the maximum number of threads used by VLFeat.
@@ -1192,31 +1297,508 @@ vl_get_max_threads (void)
  **
  ** If @c numThreads is set to 0, then VLFeat sets the number of
  ** threads to the OpenMP current maximum, obtained by calling @c
- ** omp_get_max_threads().
+ ** omp_get_max_threads(), or to the number of CPU cores if VLFeat
+ ** was compiled without OpenMP support.
  **
  ** This function is similar to @c omp_set_num_threads() but changes a
  ** parameter internal to VLFeat rather than affecting OpenMP global
  ** state.
  **
- ** If VLFeat was compiled without, this function does nothing.
+ ** If VLFeat was compiled without threading support, this function
+ ** does nothing.
  **
  ** @sa vl_get_max_threads(), @ref threads-parallel
  **/
 
-#if defined(_OPENMP)
 void
 vl_set_num_threads (vl_size numThreads)
 {
+#if defined(VL_DISABLE_THREADS)
+  numThreads = 1 ;
+#else
   if (numThreads == 0) {
+#if defined(_OPENMP)
     numThreads = omp_get_max_threads() ;
+#else
+    numThreads = vl_get_num_cpus() ;
+#endif
   }
+#endif
   vl_get_state()->numThreads = numThreads ;
 }
+
+/* ---------------------------------------------------------------- */
+/*                                              Built-in thread pool */
+/* ---------------------------------------------------------------- */
+
+#if ! defined(VL_DISABLE_THREADS)
+
+/** @internal @brief Run the jobs of the built-in thread pool
+ ** @param data pool.
+ **
+ ** The thread waits for jobs to be queued and runs them in FIFO
+ ** order until the pool is shut down.
+ **/
+
+#if defined(VL_THREADS_POSIX)
+static void *
+_vl_thread_pool_main (void * data)
+{
+  VlThreadPool * pool = data ;
+  pthread_mutex_lock (&pool->mutex) ;
+  while (1) {
+    VlThreadPoolJob * job ;
+    while (pool->first == NULL && ! pool->shutdown) {
+      pthread_cond_wait (&pool->workCondition, &pool->mutex) ;
+    }
+    if (pool->first == NULL) break ;
+    job = pool->first ;
+    pool->first = job->next ;
+    if (pool->first == NULL) pool->last = NULL ;
+    job->state = VL_JOB_RUNNING ;
+    pthread_mutex_unlock (&pool->mutex) ;
+    job->function (job->data) ;
+    pthread_mutex_lock (&pool->mutex) ;
+    job->state = VL_JOB_DONE ;
+    pthread_cond_broadcast (&pool->doneCondition) ;
+  }
+  pthread_mutex_unlock (&pool->mutex) ;
+  return NULL ;
+}
+#elif defined(VL_THREADS_WIN)
+static DWORD WINAPI
+_vl_thread_pool_main (LPVOID data)
+{
+  VlThreadPool * pool = data ;
+  while (1) {
+    VlThreadPoolJob * job ;
+    /* the semaphore counts the queued jobs, but a job may be claimed
+       by the thread waiting for it before any worker picks it up */
+    WaitForSingleObject (pool->workSemaphore, INFINITE) ;
+    EnterCriticalSection (&pool->mutex) ;
+    job = pool->first ;
+    if (job == NULL) {
+      vl_bool shutdown = pool->shutdown ;
+      LeaveCriticalSection (&pool->mutex) ;
+      if (shutdown) break ;
+      continue ;
+    }
+    pool->first = job->next ;
+    if (pool->first == NULL) pool->last = NULL ;
+    job->state = VL_JOB_RUNNING ;
+    LeaveCriticalSection (&pool->mutex) ;
+    job->function (job->data) ;
+    EnterCriticalSection (&pool->mutex) ;
+    job->state = VL_JOB_DONE ;
+    LeaveCriticalSection (&pool->mutex) ;
+    SetEvent (job->done) ;
+  }
+  return 0 ;
+}
+#endif
+
+/** @internal @brief Lock the built-in thread pool
+ ** @param pool pool.
+ **/
+
+static void
+_vl_thread_pool_lock (VlThreadPool * pool)
+{
+#if defined(VL_THREADS_POSIX)
+  pthread_mutex_lock (&pool->mutex) ;
+#elif defined(VL_THREADS_WIN)
+  EnterCriticalSection (&pool->mutex) ;
+#endif
+}
+
+/** @internal @brief Unlock the built-in thread pool
+ ** @param pool pool.
+ **/
+
+static void
+_vl_thread_pool_unlock (VlThreadPool * pool)
+{
+#if defined(VL_THREADS_POSIX)
+  pthread_mutex_unlock (&pool->mutex) ;
+#elif defined(VL_THREADS_WIN)
+  LeaveCriticalSection (&pool->mutex) ;
+#endif
+}
+
+/** @internal @brief Initialize the built-in thread pool
+ ** @param pool pool.
+ **
+ ** The pool starts without threads; these are created on demand by
+ ** ::_vl_thread_pool_reserve.
+ **/
+
+static void
+_vl_thread_pool_init (VlThreadPool * pool)
+{
+#if defined(VL_THREADS_POSIX)
+  pthread_mutex_init (&pool->mutex, NULL) ;
+  pthread_cond_init (&pool->workCondition, NULL) ;
+  pthread_cond_init (&pool->doneCondition, NULL) ;
+#elif defined(VL_THREADS_WIN)
+  InitializeCriticalSection (&pool->mutex) ;
+  pool->workSemaphore = CreateSemaphore (NULL, 0, MAXLONG, NULL) ;
+#endif
+  pool->numThreads = 0 ;
+  pool->first = NULL ;
+  pool->last = NULL ;
+  pool->shutdown = VL_FALSE ;
+}
+
+/** @internal @brief Shut down the built-in thread pool
+ ** @param pool pool.
+ **
+ ** The function waits for the queued jobs to complete and for the
+ ** threads to terminate. On Windows, the function is called when the
+ ** DLL is detached and cannot wait for the threads; these are only
+ ** signaled to terminate and the pool is not disposed of.
+ **/
+
+static void
+_vl_thread_pool_shutdown (VlThreadPool * pool)
+{
+  vl_uindex t ;
+  _vl_thread_pool_lock (pool) ;
+  pool->shutdown = VL_TRUE ;
+#if defined(VL_THREADS_POSIX)
+  pthread_cond_broadcast (&pool->workCondition) ;
+  _vl_thread_pool_unlock (pool) ;
+  for (t = 0 ; t < pool->numThreads ; ++t) {
+    pthread_join (pool->threads[t], NULL) ;
+  }
+  pthread_cond_destroy (&pool->doneCondition) ;
+  pthread_cond_destroy (&pool->workCondition) ;
+  pthread_mutex_destroy (&pool->mutex) ;
+#elif defined(VL_THREADS_WIN)
+  ReleaseSemaphore (pool->workSemaphore, (LONG)pool->numThreads, NULL) ;
+  _vl_thread_pool_unlock (pool) ;
+  for (t = 0 ; t < pool->numThreads ; ++t) {
+    CloseHandle (pool->threads[t]) ;
+  }
+#endif
+  pool->numThreads = 0 ;
+}
+
+/** @internal @brief Make sure that the pool has enough threads
+ ** @param pool pool.
+ ** @param numThreads number of threads.
+ **
+ ** The pool grows to @a numThreads threads (up to
+ ** ::VL_THREAD_POOL_MAX_NUM_THREADS) and never shrinks.
+ **/
+
+static void
+_vl_thread_pool_reserve (VlThreadPool * pool, vl_size numThreads)
+{
+  numThreads = VL_MIN(numThreads, VL_THREAD_POOL_MAX_NUM_THREADS) ;
+  if (pool->numThreads >= numThreads) return ;
+  _vl_thread_pool_lock (pool) ;
+  while (pool->numThreads < numThreads && ! pool->shutdown) {
+#if defined(VL_THREADS_POSIX)
+    if (pthread_create (&pool->threads[pool->numThreads], NULL,
+                        _vl_thread_pool_main, pool)) break ;
+#elif defined(VL_THREADS_WIN)
+    pool->threads[pool->numThreads] =
+      CreateThread (NULL, 0, _vl_thread_pool_main, pool, 0, NULL) ;
+    if (pool->threads[pool->numThreads] == NULL) break ;
+#endif
+    pool->numThreads ++ ;
+  }
+  _vl_thread_pool_unlock (pool) ;
+}
+
+/** @internal @brief Submit a job to the built-in thread pool
+ ** @param context pool.
+ ** @param function job function.
+ ** @param data job data.
+ ** @return job handle or @c NULL.
+ **/
+
+static void *
+_vl_thread_pool_submit (void * context, VlParallelJobFunction function, void * data)
+{
+  VlThreadPool * pool = context ;
+  VlThreadPoolJob * job ;
+  if (pool->numThreads == 0) return NULL ;
+  job = malloc (sizeof(VlThreadPoolJob)) ;
+  if (job == NULL) return NULL ;
+  job->function = function ;
+  job->data = data ;
+  job->state = VL_JOB_QUEUED ;
+  job->next = NULL ;
+#if defined(VL_THREADS_WIN)
+  job->done = CreateEvent (NULL, TRUE, FALSE, NULL) ;
+#endif
+  _vl_thread_pool_lock (pool) ;
+  if (pool->last) {
+    pool->last->next = job ;
+  } else {
+    pool->first = job ;
+  }
+  pool->last = job ;
+#if defined(VL_THREADS_POSIX)
+  pthread_cond_signal (&pool->workCondition) ;
+#elif defined(VL_THREADS_WIN)
+  ReleaseSemaphore (pool->workSemaphore, 1, NULL) ;
+#endif
+  _vl_thread_pool_unlock (pool) ;
+  return job ;
+}
+
+/** @internal @brief Wait for a job of the built-in thread pool
+ ** @param context pool.
+ ** @param job_ job handle.
+ **
+ ** If no thread has picked up the job yet, the job is removed from
+ ** the queue and run by the calling thread instead.
+ **/
+
+static void
+_vl_thread_pool_wait (void * context, void * job_)
+{
+  VlThreadPool * pool = context ;
+  VlThreadPoolJob * job = job_ ;
+  _vl_thread_pool_lock (pool) ;
+  if (job->state == VL_JOB_QUEUED) {
+    VlThreadPoolJob * previous = NULL ;
+    VlThreadPoolJob * iter = pool->first ;
+    while (iter != job) {
+      previous = iter ;
+      iter = iter->next ;
+    }
+    if (previous) {
+      previous->next = job->next ;
+    } else {
+      pool->first = job->next ;
+    }
+    if (pool->last == job) pool->last = previous ;
+    job->state = VL_JOB_RUNNING ;
+    _vl_thread_pool_unlock (pool) ;
+    job->function (job->data) ;
+  } else {
+#if defined(VL_THREADS_POSIX)
+    while (job->state != VL_JOB_DONE) {
+      pthread_cond_wait (&pool->doneCondition, &pool->mutex) ;
+    }
+    _vl_thread_pool_unlock (pool) ;
+#elif defined(VL_THREADS_WIN)
+    _vl_thread_pool_unlock (pool) ;
+    WaitForSingleObject (job->done, INFINITE) ;
+#endif
+  }
+#if defined(VL_THREADS_WIN)
+  CloseHandle (job->done) ;
+#endif
+  free (job) ;
+}
+
+#endif /* VL_DISABLE_THREADS */
+
+/* ---------------------------------------------------------------- */
+/*                                            Parallel computations */
+/* ---------------------------------------------------------------- */
+
+/** @brief Set the backend used for parallel computations
+ ** @param submit function submitting a job.
+ ** @param wait function waiting for a job.
+ ** @param context backend context.
+ **
+ ** The function makes ::vl_parallel_for run its jobs on an external
+ ** executor instead of the built-in thread pool. @a submit schedules
+ ** a job and returns an handle to it (or @c NULL if the job cannot be
+ ** scheduled, in which case the job must not run). @a wait blocks
+ ** until the job identified by the handle has completed, and
+ ** releases the handle. Both receive @a context as first argument.
+ **
+ ** The thread calling ::vl_parallel_for always contributes to the
+ ** computation, so that this completes even if the executor runs
+ ** the submitted jobs late or sequentially. Setting @a submit
+ ** or @a wait to @c NULL restores the built-in thread pool.
+ **
+ ** This function is not thread safe and should be called before
+ ** VLFeat is used from multiple threads.
+ **
+ ** @sa @ref threads-parallel
+ **/
+
+void
+vl_set_parallel_backend (VlParallelSubmitFunction submit,
+                         VlParallelWaitFunction wait,
+                         void * context)
+{
+  VlState * state = vl_get_state() ;
+  if (submit && wait) {
+    state->parallelSubmit = submit ;
+    state->parallelWait = wait ;
+    state->parallelContext = context ;
+  } else {
+    state->parallelSubmit = NULL ;
+    state->parallelWait = NULL ;
+    state->parallelContext = NULL ;
+  }
+}
+
+/** @internal @brief State of a parallel loop */
+typedef struct _VlParallelLoop
+{
+  VlParallelForFunction function ;
+  void * data ;
+  vl_size numIterations ;
+  vl_size numTasks ;
+  vl_uindex nextTask ;
+#if ! defined(VL_DISABLE_THREADS)
+#if defined(VL_THREADS_POSIX)
+  pthread_mutex_t mutex ;
+#elif defined(VL_THREADS_WIN)
+  CRITICAL_SECTION mutex ;
+#endif
+#endif
+} VlParallelLoop ;
+
+/** @internal @brief Run the tasks of a parallel loop
+ ** @param data loop.
+ **
+ ** The function keeps claiming the next task of the loop until none
+ ** is left. Nested calls of ::vl_parallel_for run sequentially.
+ **/
+
+static void
+_vl_parallel_loop_run (void * data)
+{
+  VlParallelLoop * loop = data ;
+  VlThreadState * threadState = vl_get_thread_specific_state() ;
+  vl_bool inParallelLoop = threadState->inParallelLoop ;
+  threadState->inParallelLoop = VL_TRUE ;
+  while (1) {
+    vl_uindex task ;
+#if ! defined(VL_DISABLE_THREADS)
+#if defined(VL_THREADS_POSIX)
+    pthread_mutex_lock (&loop->mutex) ;
+    task = loop->nextTask ++ ;
+    pthread_mutex_unlock (&loop->mutex) ;
+#elif defined(VL_THREADS_WIN)
+    EnterCriticalSection (&loop->mutex) ;
+    task = loop->nextTask ++ ;
+    LeaveCriticalSection (&loop->mutex) ;
+#endif
 #else
+    task = loop->nextTask ++ ;
+#endif
+    if (task >= loop->numTasks) break ;
+    loop->function (loop->data, task,
+                    task * loop->numIterations / loop->numTasks,
+                    (task + 1) * loop->numIterations / loop->numTasks) ;
+  }
+  threadState->inParallelLoop = inParallelLoop ;
+}
+
+/** @brief Run a loop in parallel
+ ** @param numIterations number of iterations.
+ ** @param numTasks number of tasks.
+ ** @param function loop body.
+ ** @param data data passed to @a function.
+ **
+ ** The function splits the iterations <code>0, ...,
+ ** numIterations-1</code> in @a numTasks consecutive blocks of
+ ** approximately equal size and calls @a function once for each of
+ ** them, passing the task index and the range of iterations. If @a
+ ** numTasks is zero, it is set to the number of threads
+ ** (::vl_get_max_threads); it never exceeds @a numIterations.
+ **
+ ** Tasks run concurrently on up to ::vl_get_max_threads threads,
+ ** which claim them in order as they become free: using more tasks
+ ** than threads balances uneven workloads. The calling thread is
+ ** one of them and the function returns when all tasks have been
+ ** completed. Reductions can be implemented by accumulating partial
+ ** results in a slot per task and combining them afterwards; since
+ ** blocks depend only on @a numIterations and @a numTasks, the
+ ** result does not depend on the thread executing each task.
+ **
+ ** The jobs are run by the backend set by ::vl_set_parallel_backend
+ ** or, by default, by a built-in pool of threads. A call from
+ ** within a task runs sequentially in the calling thread.
+ **
+ ** @sa @ref threads-parallel
+ **/
+
 void
-vl_set_num_threads (vl_size numThreads VL_UNUSED) { }
+vl_parallel_for (vl_size numIterations, vl_size numTasks,
+                 VlParallelForFunction function, void * data)
+{
+  VlState * state = vl_get_state() ;
+  VlParallelLoop loop ;
+  vl_size numWorkers ;
+
+  if (numTasks == 0) numTasks = vl_get_max_threads() ;
+  numTasks = VL_MIN(numTasks, numIterations) ;
+  numWorkers = VL_MIN(numTasks, vl_get_max_threads()) ;
+
+  if (numTasks == 0) return ;
+  if (numWorkers > 1 && vl_get_thread_specific_state()->inParallelLoop) {
+    numWorkers = 1 ;
+  }
+
+  loop.function = function ;
+  loop.data = data ;
+  loop.numIterations = numIterations ;
+  loop.numTasks = numTasks ;
+  loop.nextTask = 0 ;
+
+#if ! defined(VL_DISABLE_THREADS)
+  if (numWorkers > 1) {
+    VlParallelSubmitFunction submit = state->parallelSubmit ;
+    VlParallelWaitFunction wait = state->parallelWait ;
+    void * context = state->parallelContext ;
+    void ** jobs = malloc (sizeof(void*) * (numWorkers - 1)) ;
+    vl_uindex j ;
+
+    if (jobs) {
+      if (submit == NULL) {
+        submit = _vl_thread_pool_submit ;
+        wait = _vl_thread_pool_wait ;
+        context = &state->threadPool ;
+        _vl_thread_pool_reserve (&state->threadPool, numWorkers - 1) ;
+      }
+#if defined(VL_THREADS_POSIX)
+      pthread_mutex_init (&loop.mutex, NULL) ;
+#elif defined(VL_THREADS_WIN)
+      InitializeCriticalSection (&loop.mutex) ;
+#endif
+      for (j = 0 ; j < numWorkers - 1 ; ++j) {
+        jobs[j] = submit (context, _vl_parallel_loop_run, &loop) ;
+      }
+      _vl_parallel_loop_run (&loop) ;
+      for (j = 0 ; j < numWorkers - 1 ; ++j) {
+        if (jobs[j]) wait (context, jobs[j]) ;
+      }
+#if defined(VL_THREADS_POSIX)
+      pthread_mutex_destroy (&loop.mutex) ;
+#elif defined(VL_THREADS_WIN)
+      DeleteCriticalSection (&loop.mutex) ;
+#endif
+      free (jobs) ;
+      return ;
+    }
+  }
+#else
+  (void) state ;
 #endif
 
+  /* sequential */
+  {
+    vl_uindex task ;
+    for (task = 0 ; task < numTasks ; ++task) {
+      function (data, task,
+                task * numIterations / numTasks,
+                (task + 1) * numIterations / numTasks) ;
+    }
+  }
+}
+
 /* ---------------------------------------------------------------- */
 /** @brief Set last VLFeat error
  ** @param error error code.
@@ -1488,6 +2070,7 @@ vl_thread_specific_state_new (void)
   self->ticMark = 0 ;
 #endif
   vl_rand_init (&self->rand) ;
+  self->inParallelLoop = VL_FALSE ;
 
   return self ;
 }
@@ -1624,11 +2207,15 @@ vl_constructor (void)
 #endif
   state->simdEnabled = VL_TRUE ;
 
-  /* get the number of (OpenMP) threads used by the library */
-#if defined(_OPENMP)
-  state->numThreads = omp_get_max_threads() ;
-#else
-  state->numThreads = 1 ;
+  /* get the number of threads used by the library */
+  vl_set_num_threads (0) ;
+
+  /* use the built-in thread pool for parallel computations */
+  state->parallelSubmit = NULL ;
+  state->parallelWait = NULL ;
+  state->parallelContext = NULL ;
+#if ! defined(VL_DISABLE_THREADS)
+  _vl_thread_pool_init (&state->threadPool) ;
 #endif
 
 #if defined(DEBUG)
@@ -1648,6 +2235,11 @@ vl_destructor ()
   state = vl_get_state() ;
 
 #if ! defined(VL_DISABLE_THREADS)
+#if defined(DEBUG)
+  printf("VLFeat DEBUG: stopping the thread pool.\n") ;
+#endif
+  _vl_thread_pool_shutdown (&state->threadPool) ;
+
 #if defined(DEBUG)
   printf("VLFeat DEBUG: destroying a thread specific state instance.\n") ;
 #endif
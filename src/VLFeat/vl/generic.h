@@ -103,6 +103,8 @@ VL_EXPORT char const * vl_get_version_string (void) ;
 VL_EXPORT char * vl_configuration_to_string_copy (void) ;
 VL_EXPORT void vl_set_simd_enabled (vl_bool x) ;
 VL_EXPORT vl_bool vl_get_simd_enabled (void) ;
+VL_EXPORT vl_bool vl_cpu_has_fma (void) ;
+VL_EXPORT vl_bool vl_cpu_has_avx2 (void) ;
 VL_EXPORT vl_bool vl_cpu_has_avx (void) ;
 VL_EXPORT vl_bool vl_cpu_has_sse3 (void) ;
 VL_EXPORT vl_bool vl_cpu_has_sse2 (void) ;
@@ -114,6 +116,42 @@ VL_EXPORT VlRand * vl_get_rand (void) ;
 VL_EXPORT vl_size vl_get_max_threads (void) ;
 VL_EXPORT void vl_set_num_threads (vl_size n) ;
 VL_EXPORT vl_size vl_get_thread_limit (void) ;
+
+/** @brief Job executed by a parallel backend
+ ** @param data job data.
+ **/
+typedef void (*VlParallelJobFunction) (void * data) ;
+
+/** @brief Submit a job to a parallel backend
+ ** @param context backend context.
+ ** @param function job function.
+ ** @param data job data.
+ ** @return job handle or @c NULL if the job could not be scheduled.
+ **/
+typedef void * (*VlParallelSubmitFunction) (void * context,
+                                             VlParallelJobFunction function,
+                                             void * data) ;
+
+/** @brief Wait for the completion of a job
+ ** @param context backend context.
+ ** @param job handle returned by the submit function.
+ **/
+typedef void (*VlParallelWaitFunction) (void * context, void * job) ;
+
+/** @brief Body of a parallel loop
+ ** @param data loop data.
+ ** @param task index of the task.
+ ** @param begin first iteration of the task.
+ ** @param end iteration following the last one of the task.
+ **/
+typedef void (*VlParallelForFunction) (void * data, vl_uindex task,
+                                       vl_uindex begin, vl_uindex end) ;
+
+VL_EXPORT void vl_set_parallel_backend (VlParallelSubmitFunction submit,
+                                        VlParallelWaitFunction wait,
+                                        void * context) ;
+VL_EXPORT void vl_parallel_for (vl_size numIterations, vl_size numTasks,
+                                VlParallelForFunction function, void * data) ;
 /** @} (*/
 
 /** ------------------------------------------------------------------
@@ -289,10 +289,6 @@ Alternatively, one can manually specify a starting point
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
 #ifndef VL_DISABLE_SSE2
 #include "mathop_sse2.h"
 #endif
@@ -329,6 +325,34 @@ struct _VlGMM
   vl_bool kmeansInitIsOwner; /**< Indicates whether a user provided the kmeans initialization object */
 } ;
 
+/** @internal @brief Data of the parallel loops computing the posteriors */
+typedef struct _VlGMMPosteriorsLoop
+{
+  void * posteriors ;                 /**< Posteriors. */
+  vl_size numClusters ;               /**< Number of clusters. */
+  vl_size dimension ;                 /**< Data dimensionality. */
+  void const * priors ;               /**< Priors. */
+  void const * means ;                /**< Means. */
+  void const * covariances ;          /**< Covariances. */
+  void const * data ;                 /**< Data. */
+  void * logCovariances ;             /**< Log-determinant of the covariances. */
+  void * logWeights ;                 /**< Log of the priors. */
+  void * invCovariances ;             /**< Inverse of the covariances. */
+  double * LL ;                       /**< Log-likelihood of the data of each task. */
+} VlGMMPosteriorsLoop ;
+
+/** @internal @brief Data of the parallel loop of the maximization step */
+typedef struct _VlGMMMaximizationLoop
+{
+  VlGMM const * self ;                /**< GMM. */
+  void const * posteriors ;           /**< Posteriors. */
+  void const * data ;                 /**< Data. */
+  void const * oldMeans ;             /**< Means before the update. */
+  void ** clusterPosteriorSums ;      /**< Mass of each cluster (per task). */
+  void ** means ;                     /**< Weighted data sums (per task). */
+  void ** covariances ;               /**< Weighted squared differences (per task). */
+} VlGMMMaximizationLoop ;
+
 /* ---------------------------------------------------------------- */
 /*                                                       Life-cycle */
 /* ---------------------------------------------------------------- */
@@ -692,56 +716,20 @@ void vl_gmm_set_covariance_lower_bound (VlGMM * self, double bound)
 /*                                            Posterior assignments */
 /* ---------------------------------------------------------------- */
 
-/** @fn vl_get_gmm_data_posterior_f(float*,vl_size,vl_size,float const*,float const*,vl_size,float const*,float const*)
- ** @brief Get Gaussian modes posterior probabilities
- ** @param posteriors posterior probabilities (output)/
- ** @param numClusters number of modes in the GMM model.
- ** @param numData number of data elements.
- ** @param priors prior mode probabilities of the GMM model.
- ** @param means means of the GMM model.
- ** @param dimension data dimension.
- ** @param covariances diagonal covariances of the GMM model.
- ** @param data data.
- ** @return data log-likelihood.
- **
- ** This is a helper function that does not require a ::VlGMM object
- ** instance to operate.
- **/
-
-double
-VL_XCAT(vl_get_gmm_data_posteriors_, SFX)
-(TYPE * posteriors,
- vl_size numClusters,
- vl_size numData,
- TYPE const * priors,
- TYPE const * means,
- vl_size dimension,
- TYPE const * covariances,
- TYPE const * data)
+static void
+VL_XCAT(_vl_gmm_prepare_clusters_, SFX)
+(void * loop_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
 {
-  vl_index i_d, i_cl;
-  vl_size dim;
-  double LL = 0;
-
-  TYPE halfDimLog2Pi = (dimension / 2.0) * log(2.0*VL_PI);
-  TYPE * logCovariances ;
-  TYPE * logWeights ;
-  TYPE * invCovariances ;
-
-#if (FLT == VL_TYPE_FLOAT)
-  VlFloatVector3ComparisonFunction distFn = vl_get_vector_3_comparison_function_f(VlDistanceMahalanobis) ;
-#else
-  VlDoubleVector3ComparisonFunction distFn = vl_get_vector_3_comparison_function_d(VlDistanceMahalanobis) ;
-#endif
-
-  logCovariances = vl_malloc(sizeof(TYPE) * numClusters) ;
-  invCovariances = vl_malloc(sizeof(TYPE) * numClusters * dimension) ;
-  logWeights = vl_malloc(sizeof(TYPE) * numClusters) ;
-
-#if defined(_OPENMP)
-#pragma omp parallel for private(i_cl,dim) num_threads(vl_get_max_threads())
-#endif
-  for (i_cl = 0 ; i_cl < (signed)numClusters ; ++ i_cl) {
+  VlGMMPosteriorsLoop const * loop = loop_ ;
+  TYPE const * priors = loop->priors ;
+  TYPE const * covariances = loop->covariances ;
+  TYPE * logCovariances = loop->logCovariances ;
+  TYPE * logWeights = loop->logWeights ;
+  TYPE * invCovariances = loop->invCovariances ;
+  vl_size dimension = loop->dimension ;
+  vl_uindex i_cl, dim ;
+
+  for (i_cl = begin ; i_cl < end ; ++ i_cl) {
     TYPE logSigma = 0 ;
     if (priors[i_cl] < VL_GMM_MIN_PRIOR) {
       logWeights[i_cl] = - (TYPE) VL_INFINITY_D ;
@@ -753,17 +741,37 @@ VL_XCAT(vl_get_gmm_data_posteriors_, SFX)
       invCovariances [i_cl*dimension + dim] = (TYPE) 1.0 / covariances[i_cl*dimension + dim];
     }
     logCovariances[i_cl] = logSigma;
-  } /* end of parallel region */
+  }
+}
+
+static void
+VL_XCAT(_vl_gmm_get_posteriors_, SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlGMMPosteriorsLoop const * loop = loop_ ;
+  TYPE * posteriors = loop->posteriors ;
+  TYPE const * means = loop->means ;
+  TYPE const * data = loop->data ;
+  TYPE const * logCovariances = loop->logCovariances ;
+  TYPE const * logWeights = loop->logWeights ;
+  TYPE const * invCovariances = loop->invCovariances ;
+  vl_size numClusters = loop->numClusters ;
+  vl_size dimension = loop->dimension ;
+  TYPE halfDimLog2Pi = (dimension / 2.0) * log(2.0*VL_PI);
+  vl_uindex i_d, i_cl ;
+  double LL = 0 ;
 
-#if defined(_OPENMP)
-#pragma omp parallel for private(i_cl,i_d) reduction(+:LL) \
-num_threads(vl_get_max_threads())
+#if (FLT == VL_TYPE_FLOAT)
+  VlFloatVector3ComparisonFunction distFn = vl_get_vector_3_comparison_function_f(VlDistanceMahalanobis) ;
+#else
+  VlDoubleVector3ComparisonFunction distFn = vl_get_vector_3_comparison_function_d(VlDistanceMahalanobis) ;
 #endif
-  for (i_d = 0 ; i_d < (signed)numData ; ++ i_d) {
+
+  for (i_d = begin ; i_d < end ; ++ i_d) {
     TYPE clusterPosteriorsSum = 0;
     TYPE maxPosterior = (TYPE)(-VL_INFINITY_D) ;
 
-    for (i_cl = 0 ; i_cl < (signed)numClusters ; ++ i_cl) {
+    for (i_cl = 0 ; i_cl < numClusters ; ++ i_cl) {
       TYPE p =
       logWeights[i_cl]
       - halfDimLog2Pi
@@ -776,7 +784,7 @@ num_threads(vl_get_max_threads())
       if (p > maxPosterior) { maxPosterior = p ; }
     }
 
-    for (i_cl = 0 ; i_cl < (signed)numClusters ; ++i_cl) {
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
       TYPE p = posteriors[i_cl + i_d * numClusters] ;
       p =  exp(p - maxPosterior) ;
       posteriors[i_cl + i_d * numClusters] = p ;
@@ -785,14 +793,71 @@ num_threads(vl_get_max_threads())
 
     LL +=  log(clusterPosteriorsSum) + (double) maxPosterior ;
 
-    for (i_cl = 0 ; i_cl < (signed)numClusters ; ++i_cl) {
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
       posteriors[i_cl + i_d * numClusters] /= clusterPosteriorsSum ;
     }
-  } /* end of parallel region */
+  }
+  loop->LL[task] = LL ;
+}
 
-  vl_free(logCovariances);
-  vl_free(logWeights);
-  vl_free(invCovariances);
+/** @fn vl_get_gmm_data_posterior_f(float*,vl_size,vl_size,float const*,float const*,vl_size,float const*,float const*)
+ ** @brief Get Gaussian modes posterior probabilities
+ ** @param posteriors posterior probabilities (output)/
+ ** @param numClusters number of modes in the GMM model.
+ ** @param numData number of data elements.
+ ** @param priors prior mode probabilities of the GMM model.
+ ** @param means means of the GMM model.
+ ** @param dimension data dimension.
+ ** @param covariances diagonal covariances of the GMM model.
+ ** @param data data.
+ ** @return data log-likelihood.
+ **
+ ** This is a helper function that does not require a ::VlGMM object
+ ** instance to operate.
+ **/
+
+double
+VL_XCAT(vl_get_gmm_data_posteriors_, SFX)
+(TYPE * posteriors,
+ vl_size numClusters,
+ vl_size numData,
+ TYPE const * priors,
+ TYPE const * means,
+ vl_size dimension,
+ TYPE const * covariances,
+ TYPE const * data)
+{
+  vl_size numTasks = vl_get_max_threads() ;
+  vl_uindex task ;
+  double LL = 0;
+  VlGMMPosteriorsLoop loop ;
+
+  loop.posteriors = posteriors ;
+  loop.numClusters = numClusters ;
+  loop.dimension = dimension ;
+  loop.priors = priors ;
+  loop.means = means ;
+  loop.covariances = covariances ;
+  loop.data = data ;
+  loop.logCovariances = vl_malloc(sizeof(TYPE) * numClusters) ;
+  loop.invCovariances = vl_malloc(sizeof(TYPE) * numClusters * dimension) ;
+  loop.logWeights = vl_malloc(sizeof(TYPE) * numClusters) ;
+  loop.LL = vl_calloc(numTasks, sizeof(double)) ;
+
+  vl_parallel_for (numClusters, 0,
+                   VL_XCAT(_vl_gmm_prepare_clusters_, SFX), &loop) ;
+
+  /* one partial log-likelihood per task, summed in order */
+  vl_parallel_for (numData, numTasks,
+                   VL_XCAT(_vl_gmm_get_posteriors_, SFX), &loop) ;
+  for (task = 0 ; task < numTasks ; ++task) {
+    LL += loop.LL[task] ;
+  }
+
+  vl_free(loop.logCovariances);
+  vl_free(loop.logWeights);
+  vl_free(loop.invCovariances);
+  vl_free(loop.LL);
 
   return LL;
 }
@@ -1033,6 +1098,90 @@ VL_XCAT(_vl_gmm_apply_bounds_, SFX)(VlGMM * self)
 /*                                           EM - Maximization step */
 /* ---------------------------------------------------------------- */
 
+static void
+VL_XCAT(_vl_gmm_accumulate_, SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlGMMMaximizationLoop const * loop = loop_ ;
+  VlGMM const * self = loop->self ;
+  TYPE const * posteriors = loop->posteriors ;
+  TYPE const * data = loop->data ;
+  TYPE const * oldMeans = loop->oldMeans ;
+  TYPE * clusterPosteriorSum_ = loop->clusterPosteriorSums[task] ;
+  TYPE * means_ = loop->means[task] ;
+  TYPE * covariances_ = loop->covariances[task] ;
+  vl_size numClusters = self->numClusters ;
+  vl_uindex i_d, i_cl, dim ;
+
+  /*
+    Accumulate weighted sums and sum of square differences. Once normalized,
+    these become the means and covariances of each Gaussian mode.
+
+    The squared differences will be taken w.r.t. the old means however. In this manner,
+    one avoids doing two passes across the data. Eventually, these are corrected to account
+    for the new means properly. In principle, one could set the old means to zero, but
+    this may cause numerical instabilities (by accumulating large squares).
+  */
+
+  for (i_d = begin ; i_d < end ; ++i_d) {
+    for (i_cl = 0 ; i_cl < numClusters ; ++i_cl) {
+      TYPE p = posteriors[i_cl + i_d * self->numClusters] ;
+      vl_bool calculated = VL_FALSE ;
+
+      /* skip very small associations for speed */
+      if (p < VL_GMM_MIN_POSTERIOR / numClusters) { continue ; }
+
+      clusterPosteriorSum_ [i_cl] += p ;
+
+      #ifndef VL_DISABLE_AVX
+      if (vl_get_simd_enabled() && vl_cpu_has_avx()) {
+        VL_XCAT(_vl_weighted_mean_sse2_, SFX)
+        (self->dimension,
+         means_+ i_cl * self->dimension,
+         data + i_d * self->dimension,
+         p) ;
+
+        VL_XCAT(_vl_weighted_sigma_sse2_, SFX)
+        (self->dimension,
+         covariances_ + i_cl * self->dimension,
+         data + i_d * self->dimension,
+         oldMeans + i_cl * self->dimension,
+         p) ;
+
+        calculated = VL_TRUE;
+      }
+      #endif
+      #ifndef VL_DISABLE_SSE2
+      if (vl_get_simd_enabled() && vl_cpu_has_sse2() && !calculated) {
+        VL_XCAT(_vl_weighted_mean_sse2_, SFX)
+        (self->dimension,
+         means_+ i_cl * self->dimension,
+         data + i_d * self->dimension,
+         p) ;
+
+         VL_XCAT(_vl_weighted_sigma_sse2_, SFX)
+        (self->dimension,
+         covariances_ + i_cl * self->dimension,
+         data + i_d * self->dimension,
+         oldMeans + i_cl * self->dimension,
+         p) ;
+
+        calculated = VL_TRUE;
+      }
+      #endif
+      if(!calculated) {
+        for (dim = 0 ; dim < self->dimension ; ++dim) {
+          TYPE x = data[i_d * self->dimension + dim] ;
+          TYPE mu = oldMeans[i_cl * self->dimension + dim] ;
+          TYPE diff = x - mu ;
+          means_ [i_cl * self->dimension + dim] += p * x ;
+          covariances_ [i_cl * self->dimension + dim] += p * (diff*diff) ;
+        }
+      }
+    }
+  }
+}
+
 static void
 VL_XCAT(_vl_gmm_maximization_, SFX)
 (VlGMM * self,
@@ -1044,10 +1193,13 @@ VL_XCAT(_vl_gmm_maximization_, SFX)
  vl_size numData)
 {
   vl_size numClusters = self->numClusters;
-  vl_index i_d, i_cl;
+  vl_index i_cl;
   vl_size dim ;
   TYPE * oldMeans ;
   double time = 0 ;
+  vl_size numTasks ;
+  vl_uindex task ;
+  VlGMMMaximizationLoop loop ;
 
   if (self->verbosity > 1) {
     VL_PRINTF("gmm: em: entering maximization step\n") ;
@@ -1061,110 +1213,41 @@ VL_XCAT(_vl_gmm_maximization_, SFX)
   memset(means, 0, sizeof(TYPE) * self->dimension * numClusters) ;
   memset(covariances, 0, sizeof(TYPE) * self->dimension * numClusters) ;
 
-#if defined(_OPENMP)
-#pragma omp parallel default(shared) private(i_d, i_cl, dim) \
-                     num_threads(vl_get_max_threads())
-#endif
-  {
-    TYPE * clusterPosteriorSum_, * means_, * covariances_ ;
-
-#if defined(_OPENMP)
-#pragma omp critical
-#endif
-    {
-      clusterPosteriorSum_ = vl_calloc(sizeof(TYPE), numClusters) ;
-      means_ = vl_calloc(sizeof(TYPE), self->dimension * numClusters) ;
-      covariances_ = vl_calloc(sizeof(TYPE), self->dimension * numClusters) ;
-    }
-
-    /*
-      Accumulate weighted sums and sum of square differences. Once normalized,
-      these become the means and covariances of each Gaussian mode.
-
-      The squared differences will be taken w.r.t. the old means however. In this manner,
-      one avoids doing two passes across the data. Eventually, these are corrected to account
-      for the new means properly. In principle, one could set the old means to zero, but
-      this may cause numerical instabilities (by accumulating large squares).
-    */
+  /* one set of accumulators per task, combined in order */
+  numTasks = VL_MIN(vl_get_max_threads(), numData) ;
+  loop.self = self ;
+  loop.posteriors = posteriors ;
+  loop.data = data ;
+  loop.oldMeans = oldMeans ;
+  loop.clusterPosteriorSums = vl_malloc(sizeof(void*) * numTasks) ;
+  loop.means = vl_malloc(sizeof(void*) * numTasks) ;
+  loop.covariances = vl_malloc(sizeof(void*) * numTasks) ;
+  for (task = 0 ; task < numTasks ; ++task) {
+    loop.clusterPosteriorSums[task] = vl_calloc(sizeof(TYPE), numClusters) ;
+    loop.means[task] = vl_calloc(sizeof(TYPE), self->dimension * numClusters) ;
+    loop.covariances[task] = vl_calloc(sizeof(TYPE), self->dimension * numClusters) ;
+  }
 
-#if defined(_OPENMP)
-#pragma omp for
-#endif
-    for (i_d = 0 ; i_d < (signed)numData ; ++i_d) {
-      for (i_cl = 0 ; i_cl < (signed)numClusters ; ++i_cl) {
-        TYPE p = posteriors[i_cl + i_d * self->numClusters] ;
-        vl_bool calculated = VL_FALSE ;
-
-        /* skip very small associations for speed */
-        if (p < VL_GMM_MIN_POSTERIOR / numClusters) { continue ; }
-
-        clusterPosteriorSum_ [i_cl] += p ;
-
-        #ifndef VL_DISABLE_AVX
-        if (vl_get_simd_enabled() && vl_cpu_has_avx()) {
-          VL_XCAT(_vl_weighted_mean_sse2_, SFX)
-          (self->dimension,
-           means_+ i_cl * self->dimension,
-           data + i_d * self->dimension,
-           p) ;
-
-          VL_XCAT(_vl_weighted_sigma_sse2_, SFX)
-          (self->dimension,
-           covariances_ + i_cl * self->dimension,
-           data + i_d * self->dimension,
-           oldMeans + i_cl * self->dimension,
-           p) ;
-
-          calculated = VL_TRUE;
-        }
-        #endif
-        #ifndef VL_DISABLE_SSE2
-        if (vl_get_simd_enabled() && vl_cpu_has_sse2() && !calculated) {
-          VL_XCAT(_vl_weighted_mean_sse2_, SFX)
-          (self->dimension,
-           means_+ i_cl * self->dimension,
-           data + i_d * self->dimension,
-           p) ;
-
-           VL_XCAT(_vl_weighted_sigma_sse2_, SFX)
-          (self->dimension,
-           covariances_ + i_cl * self->dimension,
-           data + i_d * self->dimension,
-           oldMeans + i_cl * self->dimension,
-           p) ;
-
-          calculated = VL_TRUE;
-        }
-        #endif
-        if(!calculated) {
-          for (dim = 0 ; dim < self->dimension ; ++dim) {
-            TYPE x = data[i_d * self->dimension + dim] ;
-            TYPE mu = oldMeans[i_cl * self->dimension + dim] ;
-            TYPE diff = x - mu ;
-            means_ [i_cl * self->dimension + dim] += p * x ;
-            covariances_ [i_cl * self->dimension + dim] += p * (diff*diff) ;
-          }
-        }
-      }
-    }
+  vl_parallel_for (numData, numTasks, VL_XCAT(_vl_gmm_accumulate_, SFX), &loop) ;
 
-    /* accumulate */
-#if defined(_OPENMP)
-#pragma omp critical
-#endif
-    {
-      for (i_cl = 0 ; i_cl < (signed)numClusters ; ++i_cl) {
-        priors [i_cl] += clusterPosteriorSum_ [i_cl];
-        for (dim = 0 ; dim < self->dimension ; ++dim) {
-          means [i_cl * self->dimension + dim] += means_ [i_cl * self->dimension + dim] ;
-          covariances [i_cl * self->dimension + dim] += covariances_ [i_cl * self->dimension + dim] ;
-        }
+  for (task = 0 ; task < numTasks ; ++task) {
+    TYPE * clusterPosteriorSum_ = loop.clusterPosteriorSums[task] ;
+    TYPE * means_ = loop.means[task] ;
+    TYPE * covariances_ = loop.covariances[task] ;
+    for (i_cl = 0 ; i_cl < (signed)numClusters ; ++i_cl) {
+      priors [i_cl] += clusterPosteriorSum_ [i_cl];
+      for (dim = 0 ; dim < self->dimension ; ++dim) {
+        means [i_cl * self->dimension + dim] += means_ [i_cl * self->dimension + dim] ;
+        covariances [i_cl * self->dimension + dim] += covariances_ [i_cl * self->dimension + dim] ;
       }
-      vl_free(means_);
-      vl_free(covariances_);
-      vl_free(clusterPosteriorSum_);
     }
-  } /* parallel section */
+    vl_free(means_);
+    vl_free(covariances_);
+    vl_free(clusterPosteriorSum_);
+  }
+  vl_free(loop.clusterPosteriorSums) ;
+  vl_free(loop.means) ;
+  vl_free(loop.covariances) ;
 
   /* at this stage priors[] contains the total mass of each cluster */
   for (i_cl = 0 ; i_cl < (signed)numClusters ; ++ i_cl) {
@@ -31,6 +31,18 @@ the terms of the BSD license (see the COPYING file).
  ** contains a tree composed of ::VlHIKMNode. Each node is an
  ** integer K-means filter which partitions the data into @c K
  ** clusters.
+ **
+ ** @section hikm-parallel Parallel computations
+ **
+ ** ::vl_hikm_train() builds the tree a level at a time and trains the
+ ** nodes of a level in parallel (see ::vl_set_num_threads). The nodes
+ ** are created, their data copied, and their centers initialized
+ ** (using the random number generator of the calling thread, see
+ ** ::vl_get_rand) by the calling thread, so the result does not
+ ** depend on the number of threads. The worker threads only run the
+ ** IKM iterations, which neither call ::vl_malloc nor print, as
+ ** required by MATLAB. ::vl_hikm_push() projects the data in
+ ** parallel as well.
  **/
 
 #include <stdio.h>
@@ -49,7 +61,8 @@ the terms of the BSD license (see the COPYING file).
  ** @param M Data dimensionality
  ** @param id Label of data to copy
  ** @param N2 Number of data copied (out)
- ** @return a new buffer with a copy of the selected data.
+ ** @return a new buffer with a copy of the selected data, or @c NULL
+ ** if out of memory.
  **/
 
 vl_uint8*
@@ -72,6 +85,7 @@ vl_hikm_copy_subset (vl_uint8 const * data,
   /* copy each datum to the buffer */
   {
     vl_uint8 *new_data = vl_malloc (sizeof(*new_data) * M * count);
+    if (new_data == NULL) return NULL ;
     count = 0;
     for (i = 0 ; i < N ; i ++) {
       if (ids[i] == id) {
@@ -86,67 +100,156 @@ vl_hikm_copy_subset (vl_uint8 const * data,
   }
 }
 
+/** @internal @brief A node of the HIKM tree level being trained */
+typedef struct _VlHIKMTrainItem
+{
+  VlHIKMNode * node ; /**< node. */
+  vl_uint8 * data ;   /**< data of the node (owned, except at the root). */
+  vl_size numData ;   /**< number of data. */
+  vl_uint32 * ids ;   /**< assignments of the data to the children. */
+  int error ;         /**< training error code (out). */
+} VlHIKMTrainItem ;
+
+/** @internal @brief Data of the loop projecting data down the HIKM tree */
+typedef struct _VlHIKMPushLoop
+{
+  VlHIKMTree const * tree ; /**< HIKM tree. */
+  vl_uint32 * asgn ;        /**< paths down the tree (out). */
+  vl_uint8 const * data ;   /**< data to project. */
+} VlHIKMPushLoop ;
+
 /** ------------------------------------------------------------------
- ** @brief Compute HIKM clustering.
- **
- ** @param tree   HIKM tree to initialize.
- ** @param data   Data to cluster.
- ** @param N      Number of data points.
- ** @param K      Number of clusters for this node.
- ** @param height Tree height.
- **
- ** @remark height cannot be smaller than 1.
- **
- ** @return a new HIKM node representing a sub-clustering.
+ ** @internal
+ ** @brief Train a range of the nodes of a HIKM tree level
+ ** @param items_ nodes being trained.
+ ** @param task task index.
+ ** @param begin first node.
+ ** @param end last node plus one.
  **/
 
-static VlHIKMNode *
-xmeans (VlHIKMTree *tree,
-        vl_uint8 const *data,
-        vl_size N, vl_size K, vl_size height)
+static void
+_vl_hikm_train_range (void * items_, vl_uindex task VL_UNUSED,
+                      vl_uindex begin, vl_uindex end)
 {
-  VlHIKMNode *node = vl_malloc (sizeof(*node)) ;
-  vl_uint32 *ids = vl_malloc (sizeof(*ids) * N) ;
-
-  node->filter = vl_ikm_new (tree -> method) ;
-  node->children = (height == 1) ? 0 : vl_malloc (sizeof(*node->children) * K) ;
-
-  vl_ikm_set_max_niters (node->filter, tree->max_niters) ;
-  vl_ikm_set_verbosity  (node->filter, tree->verb - 1  ) ;
-  vl_ikm_init_rand_data (node->filter, data, tree->M, N, K) ;
-  vl_ikm_train (node->filter, data, N) ;
-  vl_ikm_push (node->filter, ids, data, N) ;
+  VlHIKMTrainItem * items = items_ ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    VlHIKMTrainItem *item = items + i ;
+    if (item->numData == 0) continue ;
+    item->error = vl_ikm_train (item->node->filter, item->data, item->numData) ;
+    if (item->error) continue ;
+    vl_ikm_push (item->node->filter, item->ids, item->data, item->numData) ;
+  }
+}
 
-  /* recursively process each child */
-  if (height > 1) {
-    vl_uindex k ;
-    for (k = 0 ; k < K ; ++k) {
-      vl_size partition_N ;
-      vl_size partition_K ;
-      vl_uint8 *partition ;
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Project a range of data down the HIKM tree
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first datum.
+ ** @param end last datum plus one.
+ **/
 
-      partition = vl_hikm_copy_subset
-        (data, ids, N, tree->M, (vl_uint32)k, &partition_N) ;
+static void
+_vl_hikm_push_range (void * loop_, vl_uindex task VL_UNUSED,
+                     vl_uindex begin, vl_uindex end)
+{
+  VlHIKMPushLoop * loop = loop_ ;
+  vl_size M = vl_hikm_get_ndims (loop->tree) ;
+  vl_size depth = vl_hikm_get_depth (loop->tree) ;
+  vl_uindex i, d ;
 
-      partition_K = VL_MIN (K, partition_N) ;
+  for (i = begin ; i < end ; ++i) {
+    VlHIKMNode *node = loop->tree->root ;
+    d = 0 ;
+    while (node) {
+      vl_uint32 best ;
+      vl_ikm_push (node->filter,
+                   &best,
+                   loop->data + i * M, 1) ;
+      loop->asgn[i * depth + d] = best ;
+      ++ d ;
+      if (!node->children) break ;
+      node = node->children [best] ;
+    }
+  }
+}
 
-      node->children [k] = xmeans
-        (tree, partition, partition_N, partition_K, height - 1) ;
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Create a HIKM node
+ **
+ ** @param tree      HIKM tree.
+ ** @param data      Data of the node.
+ ** @param N         Number of data points.
+ ** @param K         Number of clusters for this node.
+ ** @param height    Height of the node (1 for a leaf).
+ ** @param verbosity Verbosity of the node IKM filter.
+ **
+ ** The function allocates the node and its children array, and
+ ** initializes the centers from random data.
+ **
+ ** @return the new node, or @c NULL if out of memory.
+ **/
 
-      vl_free (partition) ;
+static VlHIKMNode *
+_vl_hikm_new_node (VlHIKMTree const *tree,
+                   vl_uint8 const *data, vl_size N, vl_size K,
+                   vl_size height, int verbosity)
+{
+  VlHIKMNode *node = vl_calloc (1, sizeof(*node)) ;
+  if (node == NULL) return NULL ;
 
-      if (tree->verb > (signed)tree->depth - (signed)height) {
-        VL_PRINTF("hikmeans: branch at depth %d: %6.1f %% completed\n",
-                  tree->depth - height,
-                  (double) (k+1) / K * 100) ;
-      }
+  node->filter = vl_ikm_new (tree->method) ;
+  if (node->filter == NULL) {
+    vl_free (node) ;
+    return NULL ;
+  }
+  if (height > 1) {
+    node->children = vl_calloc (VL_MAX(K, 1), sizeof(*node->children)) ;
+    if (node->children == NULL) {
+      vl_ikm_delete (node->filter) ;
+      vl_free (node) ;
+      return NULL ;
     }
   }
 
-  vl_free (ids) ;
+  vl_ikm_set_max_niters (node->filter, tree->max_niters) ;
+  vl_ikm_set_verbosity  (node->filter, verbosity) ;
+  if (vl_ikm_init_rand_data (node->filter, data, tree->M, N, K)) {
+    vl_free (node->children) ;
+    vl_ikm_delete (node->filter) ;
+    vl_free (node) ;
+    return NULL ;
+  }
   return node ;
 }
 
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Release the buffers of the nodes being trained
+ **
+ ** @param items  Nodes being trained.
+ ** @param numItems Number of nodes.
+ ** @param data   Training data of the tree (not released).
+ **
+ ** The function releases @a items as well, but not the nodes.
+ **/
+
+static void
+_vl_hikm_delete_items (VlHIKMTrainItem *items, vl_size numItems,
+                       vl_uint8 const *data)
+{
+  vl_uindex i ;
+  if (items == NULL) return ;
+  for (i = 0 ; i < numItems ; ++i) {
+    if (items[i].data && items[i].data != data) vl_free (items[i].data) ;
+    if (items[i].ids) vl_free (items[i].ids) ;
+  }
+  vl_free (items) ;
+}
+
 /** ------------------------------------------------------------------
  ** @internal
  ** @brief Delete node
@@ -232,12 +335,100 @@ vl_hikm_init (VlHIKMTree *f, vl_size M, vl_size K, vl_size depth)
  ** @param f       HIKM tree.
  ** @param data    Data to cluster.
  ** @param N       Number of data.
+ ** @return error code.
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory. In this case the tree is left empty.
+ **
+ ** @sa @ref hikm-parallel
  **/
 
-void
+int
 vl_hikm_train (VlHIKMTree *f, vl_uint8 const *data, vl_size N)
 {
-  f->root= xmeans (f, data, N, VL_MIN(f->K, N), f->depth) ;
+  VlHIKMTrainItem *items ;
+  VlHIKMTrainItem *nextItems = NULL ;
+  vl_size numItems = 1 ;
+  vl_size numNextItems = 0 ;
+  vl_size height ;
+  vl_index i ;
+
+  xdelete (f->root) ;
+  f->root = NULL ;
+
+  items = vl_calloc (1, sizeof(*items)) ;
+  if (items == NULL) goto alloc_error ;
+  items[0].data = (vl_uint8*) data ;
+  items[0].numData = N ;
+  items[0].node = f->root = _vl_hikm_new_node
+    (f, data, N, VL_MIN(f->K, N), f->depth, f->verb - 1) ;
+  if (f->root == NULL) goto alloc_error ;
+
+  for (height = f->depth ; 1 ; -- height) {
+    vl_uindex j, k ;
+
+    for (i = 0 ; i < (signed)numItems ; ++i) {
+      items[i].ids = vl_malloc (sizeof(vl_uint32) * VL_MAX(items[i].numData, 1)) ;
+      if (items[i].ids == NULL) goto alloc_error ;
+    }
+
+    /* train the nodes of this level (one task per node, as the nodes
+       have different sizes) */
+    vl_parallel_for (numItems, numItems, _vl_hikm_train_range, items) ;
+    for (i = 0 ; i < (signed)numItems ; ++i) {
+      if (items[i].error) goto alloc_error ;
+    }
+
+    if (f->verb > (signed)f->depth - (signed)height) {
+      VL_PRINTF("hikmeans: depth %d: %d nodes trained\n",
+                f->depth - height, numItems) ;
+    }
+
+    if (height == 1) break ;
+
+    /* create the nodes of the next level */
+    numNextItems = 0 ;
+    for (i = 0 ; i < (signed)numItems ; ++i) {
+      numNextItems += vl_ikm_get_K (items[i].node->filter) ;
+    }
+    nextItems = vl_calloc (VL_MAX(numNextItems, 1), sizeof(*nextItems)) ;
+    if (nextItems == NULL) goto alloc_error ;
+
+    for (i = 0, j = 0 ; i < (signed)numItems ; ++i) {
+      VlHIKMTrainItem *item = items + i ;
+      vl_size K = vl_ikm_get_K (item->node->filter) ;
+      for (k = 0 ; k < K ; ++k, ++j) {
+        VlHIKMTrainItem *child = nextItems + j ;
+        child->data = vl_hikm_copy_subset
+          (item->data, item->ids, item->numData, f->M, (vl_uint32)k, &child->numData) ;
+        if (child->data == NULL && child->numData > 0) goto alloc_error ;
+        child->node = item->node->children[k] = _vl_hikm_new_node
+          (f, child->data, child->numData, VL_MIN(K, child->numData), height - 1,
+           numNextItems > 1 ? 0 : f->verb - 1) ;
+        if (child->node == NULL) goto alloc_error ;
+      }
+      /* the data of the node is no longer needed */
+      if (item->data != data) vl_free (item->data) ;
+      vl_free (item->ids) ;
+      item->data = NULL ;
+      item->ids = NULL ;
+    }
+
+    _vl_hikm_delete_items (items, numItems, data) ;
+    items = nextItems ;
+    numItems = numNextItems ;
+    nextItems = NULL ;
+  }
+
+  _vl_hikm_delete_items (items, numItems, data) ;
+  return VL_ERR_OK ;
+
+alloc_error:
+  _vl_hikm_delete_items (items, numItems, data) ;
+  _vl_hikm_delete_items (nextItems, numNextItems, data) ;
+  xdelete (f->root) ;
+  f->root = NULL ;
+  return vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the HIKM tree.") ;
 }
 
 /** ------------------------------------------------------------------
@@ -256,25 +447,11 @@ vl_hikm_train (VlHIKMTree *f, vl_uint8 const *data, vl_size N)
 void
 vl_hikm_push (VlHIKMTree *f, vl_uint32 *asgn, vl_uint8 const *data, vl_size N)
 {
-  vl_uindex i, d ;
-  vl_size M = vl_hikm_get_ndims (f) ;
-  vl_size depth = vl_hikm_get_depth (f) ;
-
-  /* for each datum */
-  for(i = 0 ; i < N ; i++) {
-    VlHIKMNode *node = f->root ;
-    d = 0 ;
-    while (node) {
-      vl_uint32 best ;
-      vl_ikm_push (node->filter,
-                   &best,
-                   data + i * M, 1) ;
-      asgn[i * depth + d] = best ;
-      ++ d ;
-      if (!node->children) break ;
-      node = node->children [best] ;
-    }
-  }
+  VlHIKMPushLoop loop ;
+  loop.tree = f ;
+  loop.asgn = asgn ;
+  loop.data = data ;
+  vl_parallel_for (N, VL_MIN(vl_get_max_threads(), N), _vl_hikm_push_range, &loop) ;
 }
 
 /* ---------------------------------------------------------------- */
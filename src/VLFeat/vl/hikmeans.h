@@ -71,7 +71,7 @@ VL_EXPORT void vl_hikm_set_max_niters (VlHIKMTree *f, int max_niters) ;
  ** @{
  **/
 VL_EXPORT void vl_hikm_init (VlHIKMTree *f, vl_size M, vl_size K, vl_size depth) ;
-VL_EXPORT void vl_hikm_train (VlHIKMTree *f, vl_uint8 const *data, vl_size N) ;
+VL_EXPORT int  vl_hikm_train (VlHIKMTree *f, vl_uint8 const *data, vl_size N) ;
 VL_EXPORT void vl_hikm_push (VlHIKMTree *f, vl_uint32 *asgn, vl_uint8 const *data, vl_size N) ;
 /** @} */
 
@@ -12,7 +12,9 @@
 */
 
 #include "hog.h"
+#include "hog_sse2.h"
 #include "mathop.h"
+#include <stdlib.h>
 #include <string.h>
 
 /**
@@ -85,6 +87,25 @@ the permutation obtaiend by ::vl_hog_get_permutation.
 Furthermore, @ref hog.h suppots computing HOG features not from
 images but from vector fields.
 
+Sliding window detectors need HOG features at several scales.
+::vl_hog_process_pyramid rescales the image, computes the HOG features
+of all the pyramid levels in parallel, and returns them in a single
+buffer together with the size and offset of each level:
+
+@code
+VlHogPyramidLevel * levels ;
+float * features ;
+vl_size numLevels = vl_hog_process_pyramid(hog, &features, &levels,
+                                           image, width, height, numChannels,
+                                           cellSize, numLevelsPerOctave) ;
+for (l = 0 ; l < numLevels ; ++l) {
+  float const * levelFeatures = features + levels[l].offset ;
+  ...
+}
+vl_free(features) ;
+vl_free(levels) ;
+@endcode
+
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 @section hog-tech Technical details
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
@@ -534,9 +555,10 @@ vl_hog_get_height (VlHog * self)
  ** @param width image width.
  ** @param height image height.
  ** @param cellSize size of a HOG cell.
+ ** @return error code.
  **/
 
-static void
+static int
 vl_hog_prepare_buffers (VlHog * self, vl_size width, vl_size height, vl_size cellSize)
 {
   vl_size hogWidth = (width + cellSize/2) / cellSize ;
@@ -553,7 +575,7 @@ vl_hog_prepare_buffers (VlHog * self, vl_size width, vl_size height, vl_size cel
     /* a suitable buffer is already allocated */
     memset(self->hog, 0, sizeof(float) * hogWidth * hogHeight * self->numOrientations * 2) ;
     memset(self->hogNorm, 0, sizeof(float) * hogWidth * hogHeight) ;
-    return ;
+    return VL_ERR_OK ;
   }
 
   if (self->hog) {
@@ -568,106 +590,202 @@ vl_hog_prepare_buffers (VlHog * self, vl_size width, vl_size height, vl_size cel
 
   self->hog = vl_calloc(hogWidth * hogHeight * self->numOrientations * 2, sizeof(float)) ;
   self->hogNorm = vl_calloc(hogWidth * hogHeight, sizeof(float)) ;
+  if (self->hog == NULL || self->hogNorm == NULL) {
+    if (self->hog) vl_free(self->hog) ;
+    if (self->hogNorm) vl_free(self->hogNorm) ;
+    self->hog = NULL ;
+    self->hogNorm = NULL ;
+    self->hogWidth = 0 ;
+    self->hogHeight = 0 ;
+    return vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the HOG cells.") ;
+  }
   self->hogWidth = hogWidth ;
   self->hogHeight = hogHeight ;
+  return VL_ERR_OK ;
 }
 
 /* ---------------------------------------------------------------- */
-/** @brief Process features starting from an image
+/** @internal @brief Compute gradients and orientation bins of a row
+ ** @param gradNorm gradient modulus (output).
+ ** @param weights0 score of the best orientation bin (output).
+ ** @param weights1 score of the second best orientation bin (output).
+ ** @param bins0 best orientation bin (output).
+ ** @param bins1 second best orientation bin (output).
+ ** @param image first pixel of the row.
+ ** @param stride image width.
+ ** @param channelStride distance between image channels.
+ ** @param numChannels number of image channels.
+ ** @param numPixels number of pixels to process.
+ ** @param orientationX orientation vectors (X component).
+ ** @param orientationY orientation vectors (Y component).
+ ** @param numOrientations number of undirected orientations.
+ **
+ ** For each pixel, the gradient is computed by central differences
+ ** in the image channel where it is largest. Then the two
+ ** directed orientation bins with the largest projection of the
+ ** gradient are selected.
+ **/
+
+static void
+_vl_hog_bin_gradients (float * gradNorm,
+                       float * weights0, float * weights1,
+                       vl_int32 * bins0, vl_int32 * bins1,
+                       float const * image,
+                       vl_size stride, vl_size channelStride,
+                       vl_size numChannels, vl_size numPixels,
+                       float const * orientationX,
+                       float const * orientationY,
+                       vl_size numOrientations)
+{
+  vl_uindex i, k ;
+  for (i = 0 ; i < numPixels ; ++i) {
+    float gradx = 0 ;
+    float grady = 0 ;
+    float gradNorm2 = 0 ;
+    float orientationWeights [2] = {-1, -1} ;
+    vl_int32 orientationBins [2] = {-1, -1} ;
+    float const * iter = image + i ;
+
+    for (k = 0 ; k < numChannels ; ++k) {
+      float gradx_ = *(iter + 1) - *(iter - 1) ;
+      float grady_ = *(iter + stride)  - *(iter - stride) ;
+      float gradNorm2_ = gradx_ * gradx_ + grady_ * grady_ ;
+      if (gradNorm2_ > gradNorm2) {
+        gradx = gradx_ ;
+        grady = grady_ ;
+        gradNorm2 = gradNorm2_ ;
+      }
+      iter += channelStride ;
+    }
+    gradNorm[i] = sqrtf(gradNorm2) ;
+
+    /*
+     Map the gradient to the closest and second closets orientation bins.
+     There are numOrientations orientation in the interval [0,pi).
+     The next numOriantations are the symmetric ones, for a total
+     of 2*numOrientation directed orientations.
+     */
+    for (k = 0 ; k < numOrientations ; ++k) {
+      float orientationScore_ = gradx * orientationX[k] +  grady * orientationY[k] ;
+      vl_int32 orientationBin_ = (vl_int32) k ;
+      if (orientationScore_ < 0) {
+        orientationScore_ = - orientationScore_ ;
+        orientationBin_ += (vl_int32) numOrientations ;
+      }
+      if (orientationScore_ > orientationWeights[0]) {
+        orientationBins[1] = orientationBins[0] ;
+        orientationWeights[1] = orientationWeights[0] ;
+        orientationBins[0] = orientationBin_ ;
+        orientationWeights[0] = orientationScore_ ;
+      } else if (orientationScore_ > orientationWeights[1]) {
+        orientationBins[1] = orientationBin_ ;
+        orientationWeights[1] = orientationScore_ ;
+      }
+    }
+    weights0[i] = orientationWeights[0] ;
+    weights1[i] = orientationWeights[1] ;
+    bins0[i] = orientationBins[0] ;
+    bins1[i] = orientationBins[1] ;
+  }
+}
+
+/** @internal @brief Accumulate the gradients of an image into HOG cells
  ** @param self HOG object.
+ ** @param hog cell histograms (output, cleared by the caller).
+ ** @param hogWidth number of cells in the horizontal direction.
+ ** @param hogHeight number of cells in the vertical direction.
  ** @param image image to process.
  ** @param width image width.
  ** @param height image height.
  ** @param numChannels number of image channles.
  ** @param cellSize size of a HOG cell.
  **
- ** The buffer @c hog must be a three-dimensional array.
- ** The first two dimensions are @c (width + cellSize/2)/cellSize and
- ** @c (height + cellSize/2)/cellSize, where divisions are integer.
- ** This is approximately @c width/cellSize and @c height/cellSize,
- ** adjusted so that the last cell is at least half contained in the
- ** image.
- **
- ** The image @c width and @c height must be not smaller than three
- ** pixels and not smaller than @c cellSize.
+ ** The function does not modify the HOG object and can be used
+ ** concurrently on different buffers. Gradients and orientation
+ ** bins are computed a row at a time by ::_vl_hog_bin_gradients
+ ** (vectorized if possible). The function returns ::VL_ERR_ALLOC
+ ** if its row buffers could not be allocated. It does not set the
+ ** last error, so it can run in a worker thread.
  **/
 
-void
-vl_hog_put_image (VlHog * self,
-                  float const * image,
-                  vl_size width, vl_size height, vl_size numChannels,
-                  vl_size cellSize)
+static int
+_vl_hog_put_image (VlHog const * self,
+                   float * hog, vl_size hogWidth, vl_size hogHeight,
+                   float const * image,
+                   vl_size width, vl_size height, vl_size numChannels,
+                   vl_size cellSize)
 {
-  vl_size hogStride ;
+  vl_size hogStride = hogWidth * hogHeight ;
   vl_size channelStride = width * height ;
+  vl_size numPixels = width - 2 ;
   vl_index x, y ;
-  vl_uindex k ;
 
-  assert(self) ;
-  assert(image) ;
+  /* per-row buffers and per-column bilinear weights */
+  float * gradNorms = malloc(sizeof(float) * 5 * numPixels) ;
+  float * weights0 = gradNorms + numPixels ;
+  float * weights1 = weights0 + numPixels ;
+  float * columnWeights1 = weights1 + numPixels ;
+  float * columnWeights2 = columnWeights1 + numPixels ;
+  vl_int32 * bins0 = malloc(sizeof(vl_int32) * 3 * numPixels) ;
+  vl_int32 * bins1 = bins0 + numPixels ;
+  vl_int32 * columnBins = bins1 + numPixels ;
+
+  if (gradNorms == NULL || bins0 == NULL) {
+    if (gradNorms) free(gradNorms) ;
+    if (bins0) free(bins0) ;
+    return VL_ERR_ALLOC ;
+  }
 
-  /* clear features */
-  vl_hog_prepare_buffers(self, width, height, cellSize) ;
-  hogStride = self->hogWidth * self->hogHeight ;
+#define at(x,y,k) (hog[(x) + (y) * hogWidth + (k) * hogStride])
 
-#define at(x,y,k) (self->hog[(x) + (y) * self->hogWidth + (k) * hogStride])
+  for (x = 1 ; x < (signed)width - 1 ; ++x) {
+    /*  (x - (w-1)/2) / w = (x + 0.5)/w - 0.5 */
+    float hx = (x + 0.5) / cellSize - 0.5 ;
+    vl_index binx = vl_floor_f(hx) ;
+    float wx2 = hx - binx ;
+    columnBins[x - 1] = (vl_int32) binx ;
+    columnWeights2[x - 1] = wx2 ;
+    columnWeights1[x - 1] = 1.0 - wx2 ;
+  }
 
   /* compute gradients and map the to HOG cells by bilinear interpolation */
   for (y = 1 ; y < (signed)height - 1 ; ++y) {
-    for (x = 1 ; x < (signed)width - 1 ; ++x) {
-      float gradx = 0 ;
-      float grady = 0 ;
-      float gradNorm ;
-      float orientationWeights [2] = {-1, -1} ;
-      vl_index orientationBins [2] = {-1, -1} ;
-      vl_index orientation = 0 ;
-      float hx, hy, wx1, wx2, wy1, wy2 ;
-      vl_index binx, biny, o ;
-
-      /*
-       Compute the gradient at (x,y). The image channel with
-       the maximum gradient at each location is selected.
-       */
-      {
-        float const * iter = image + y * width + x ;
-        float gradNorm2 = 0 ;
-        for (k = 0 ; k < numChannels ; ++k) {
-          float gradx_ = *(iter + 1) - *(iter - 1) ;
-          float grady_ = *(iter + width)  - *(iter - width) ;
-          float gradNorm2_ = gradx_ * gradx_ + grady_ * grady_ ;
-          if (gradNorm2_ > gradNorm2) {
-            gradx = gradx_ ;
-            grady = grady_ ;
-            gradNorm2 = gradNorm2_ ;
-          }
-          iter += channelStride ;
-        }
-        gradNorm = sqrtf(gradNorm2) ;
-      }
+    float hy, wy1, wy2 ;
+    vl_index biny ;
+    vl_size numDone = 0 ;
+
+#ifndef VL_DISABLE_SSE2
+    if (vl_cpu_has_sse2() && vl_get_simd_enabled()) {
+      numDone = _vl_hog_bin_gradients_sse2
+      (gradNorms, weights0, weights1, bins0, bins1,
+       image + y * width + 1, width, channelStride, numChannels, numPixels,
+       self->orientationX, self->orientationY, self->numOrientations) ;
+    }
+#endif
+    _vl_hog_bin_gradients
+    (gradNorms + numDone, weights0 + numDone, weights1 + numDone,
+     bins0 + numDone, bins1 + numDone,
+     image + y * width + 1 + numDone, width, channelStride, numChannels,
+     numPixels - numDone,
+     self->orientationX, self->orientationY, self->numOrientations) ;
+
+    hy = (y + 0.5) / cellSize - 0.5 ;
+    biny = vl_floor_f(hy) ;
+    wy2 = hy - biny ;
+    wy1 = 1.0 - wy2 ;
 
-      /*
-       Map the gradient to the closest and second closets orientation bins.
-       There are numOrientations orientation in the interval [0,pi).
-       The next numOriantations are the symmetric ones, for a total
-       of 2*numOrientation directed orientations.
-       */
-      for (k = 0 ; k < self->numOrientations ; ++k) {
-        float orientationScore_ = gradx * self->orientationX[k] +  grady * self->orientationY[k] ;
-        vl_index orientationBin_ = k ;
-        if (orientationScore_ < 0) {
-          orientationScore_ = - orientationScore_ ;
-          orientationBin_ += self->numOrientations ;
-        }
-        if (orientationScore_ > orientationWeights[0]) {
-          orientationBins[1] = orientationBins[0] ;
-          orientationWeights[1] = orientationWeights[0] ;
-          orientationBins[0] = orientationBin_ ; ;
-          orientationWeights[0] = orientationScore_ ;
-        } else if (orientationScore_ > orientationWeights[1]) {
-          orientationBins[1] = orientationBin_ ;
-          orientationWeights[1] = orientationScore_ ;
-        }
-      }
+    for (x = 1 ; x < (signed)width - 1 ; ++x) {
+      float gradNorm = gradNorms[x - 1] ;
+      float orientationWeights [2] ;
+      vl_index orientationBins [2] ;
+      vl_index binx = columnBins[x - 1] ;
+      float wx1 = columnWeights1[x - 1] ;
+      float wx2 = columnWeights2[x - 1] ;
+      vl_index o ;
+
+      orientationWeights[0] = weights0[x - 1] ;
+      orientationBins[0] = bins0[x - 1] ;
+      orientationBins[1] = bins1[x - 1] ;
 
       if (self->useBilinearOrientationAssigment) {
         /* min(1.0,...) guards against small overflows causing NaNs */
@@ -680,7 +798,6 @@ vl_hog_put_image (VlHog * self,
       }
 
       for (o = 0 ; o < 2 ; ++o) {
-        float ow ;
         /*
          Accumulate the gradient. hx is the distance of the
          pixel x to the cell center at its left, in units of cellSize.
@@ -688,39 +805,74 @@ vl_hog_put_image (VlHog * self,
          has hx = 0, which gradually increases to 1 moving to the next
          center.
          */
-
-        orientation = orientationBins[o] ;
+        vl_index orientation = orientationBins[o] ;
+        float ow = orientationWeights[o] ;
         if (orientation < 0) continue ;
 
-        /*  (x - (w-1)/2) / w = (x + 0.5)/w - 0.5 */
-        hx = (x + 0.5) / cellSize - 0.5 ;
-        hy = (y + 0.5) / cellSize - 0.5 ;
-        binx = vl_floor_f(hx) ;
-        biny = vl_floor_f(hy) ;
-        wx2 = hx - binx ;
-        wy2 = hy - biny ;
-        wx1 = 1.0 - wx2 ;
-        wy1 = 1.0 - wy2 ;
-
-        ow = orientationWeights[o] ;
-
-        /*VL_PRINTF("%d %d - %d %d %f %f - %f %f %f %f - %d \n ",x,y,binx,biny,hx,hy,wx1,wx2,wy1,wy2,o);*/
-
         if (binx >= 0 && biny >=0) {
           at(binx,biny,orientation) += gradNorm * ow * wx1 * wy1 ;
         }
-        if (binx < (signed)self->hogWidth - 1 && biny >=0) {
+        if (binx < (signed)hogWidth - 1 && biny >=0) {
           at(binx+1,biny,orientation) += gradNorm * ow * wx2 * wy1 ;
         }
-        if (binx < (signed)self->hogWidth - 1 && biny < (signed)self->hogHeight - 1) {
+        if (binx < (signed)hogWidth - 1 && biny < (signed)hogHeight - 1) {
           at(binx+1,biny+1,orientation) += gradNorm * ow * wx2 * wy2 ;
         }
-        if (binx >= 0 && biny < (signed)self->hogHeight - 1) {
+        if (binx >= 0 && biny < (signed)hogHeight - 1) {
           at(binx,biny+1,orientation) += gradNorm * ow * wx1 * wy2 ;
         }
       } /* next o */
     } /* next x */
   } /* next y */
+
+#undef at
+
+  free(gradNorms) ;
+  free(bins0) ;
+  return VL_ERR_OK ;
+}
+
+/* ---------------------------------------------------------------- */
+/** @brief Process features starting from an image
+ ** @param self HOG object.
+ ** @param image image to process.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param numChannels number of image channles.
+ ** @param cellSize size of a HOG cell.
+ **
+ ** The buffer @c hog must be a three-dimensional array.
+ ** The first two dimensions are @c (width + cellSize/2)/cellSize and
+ ** @c (height + cellSize/2)/cellSize, where divisions are integer.
+ ** This is approximately @c width/cellSize and @c height/cellSize,
+ ** adjusted so that the last cell is at least half contained in the
+ ** image.
+ **
+ ** The image @c width and @c height must be not smaller than three
+ ** pixels and not smaller than @c cellSize.
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory and ::VL_ERR_OK otherwise.
+ **/
+
+int
+vl_hog_put_image (VlHog * self,
+                  float const * image,
+                  vl_size width, vl_size height, vl_size numChannels,
+                  vl_size cellSize)
+{
+  assert(self) ;
+  assert(image) ;
+
+  /* clear features */
+  if (vl_hog_prepare_buffers(self, width, height, cellSize)) {
+    return VL_ERR_ALLOC ;
+  }
+  if (_vl_hog_put_image(self, self->hog, self->hogWidth, self->hogHeight,
+                        image, width, height, numChannels, cellSize)) {
+    return vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the HOG gradient buffers.") ;
+  }
+  return VL_ERR_OK ;
 }
 
 /* ---------------------------------------------------------------- */
@@ -737,9 +889,12 @@ vl_hog_put_image (VlHog * self,
  ** computation of the gradient field, allowing the user to specify
  ** their own. Angles are measure clockwise, the y axis pointing downwards,
  ** starting from the x axis (pointing to the right).
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory and ::VL_ERR_OK otherwise.
  **/
 
-void vl_hog_put_polar_field (VlHog * self,
+int vl_hog_put_polar_field (VlHog * self,
                              float const * modulus,
                              float const * angle,
                              vl_bool directed,
@@ -756,7 +911,9 @@ void vl_hog_put_polar_field (VlHog * self,
   assert(angle) ;
 
   /* clear features */
-  vl_hog_prepare_buffers(self, width, height, cellSize) ;
+  if (vl_hog_prepare_buffers(self, width, height, cellSize)) {
+    return VL_ERR_ALLOC ;
+  }
   hogStride = self->hogWidth * self->hogHeight ;
 
 #define at(x,y,k) (self->hog[(x) + (y) * self->hogWidth + (k) * hogStride])
@@ -838,29 +995,32 @@ void vl_hog_put_polar_field (VlHog * self,
       } /* next o */
     } /* next x */
   } /* next y */
+
+#undef at
+#undef atNorm
+  return VL_ERR_OK ;
 }
 
 /* ---------------------------------------------------------------- */
-/** @brief Extract HOG features
+/** @internal @brief Normalize HOG cells into features
  ** @param self HOG object.
  ** @param features HOG features (output).
- **
- ** This method is called after ::vl_hog_put_image or ::vl_hog_put_polar_field
- ** in order to retrieve the computed HOG features. The buffer @c features must have the dimensions returned by
- ** ::vl_hog_get_width, ::vl_hog_get_height, and ::vl_hog_get_dimension.
+ ** @param hog cell histograms.
+ ** @param hogNorm cell norms (must be cleared, overwritten).
+ ** @param hogWidth number of cells in the horizontal direction.
+ ** @param hogHeight number of cells in the vertical direction.
  **/
 
-void
-vl_hog_extract (VlHog * self, float * features)
+static void
+_vl_hog_extract (VlHog const * self, float * features,
+                 float const * hog, float * hogNorm,
+                 vl_size hogWidth, vl_size hogHeight)
 {
   vl_index x, y ;
   vl_uindex k ;
-  vl_size hogStride = self->hogWidth * self->hogHeight ;
+  vl_size hogStride = hogWidth * hogHeight ;
 
-  assert(features) ;
-
-#define at(x,y,k) (self->hog[(x) + (y) * self->hogWidth + (k) * hogStride])
-#define atNorm(x,y) (self->hogNorm[(x) + (y) * self->hogWidth])
+#define atNorm(x,y) (hogNorm[(x) + (y) * hogWidth])
 
   /*
    Compute the squared L2 norm of the unoriented version of each HOG
@@ -868,11 +1028,11 @@ vl_hog_extract (VlHog * self, float * features)
    the 2*numOrientations compotnent into numOrientations only.
    */
   {
-    float const * iter = self->hog ;
+    float const * iter = hog ;
     for (k = 0 ; k < self->numOrientations ; ++k) {
-      float * niter = self->hogNorm ;
-      float * niterEnd = self->hogNorm + self->hogWidth * self->hogHeight ;
-      vl_size stride = self->hogWidth*self->hogHeight*self->numOrientations ;
+      float * niter = hogNorm ;
+      float * niterEnd = hogNorm + hogWidth * hogHeight ;
+      vl_size stride = hogWidth*hogHeight*self->numOrientations ;
       while (niter != niterEnd) {
         float h1 = *iter ;
         float h2 = *(iter + stride) ;
@@ -931,15 +1091,15 @@ vl_hog_extract (VlHog * self, float * features)
    applied.
    */
   {
-    float const * iter = self->hog ;
-    for (y = 0 ; y < (signed)self->hogHeight ; ++y) {
-      for (x = 0 ; x < (signed)self->hogWidth ; ++x) {
+    float const * iter = hog ;
+    for (y = 0 ; y < (signed)hogHeight ; ++y) {
+      for (x = 0 ; x < (signed)hogWidth ; ++x) {
 
         /* norm of upper-left, upper-right, ... cells */
         vl_index xm = VL_MAX(x - 1, 0) ;
-        vl_index xp = VL_MIN(x + 1, (signed)self->hogWidth - 1) ;
+        vl_index xp = VL_MIN(x + 1, (signed)hogWidth - 1) ;
         vl_index ym = VL_MAX(y - 1, 0) ;
-        vl_index yp = VL_MIN(y + 1, (signed)self->hogHeight - 1) ;
+        vl_index yp = VL_MIN(y + 1, (signed)hogHeight - 1) ;
 
         double norm1 = atNorm(xm,ym) ;
         double norm2 = atNorm(x,ym) ;
@@ -958,7 +1118,7 @@ vl_hog_extract (VlHog * self, float * features)
         double t3 = 0 ;
         double t4 = 0 ;
 
-        float * oiter = features + x + self->hogWidth * y ;
+        float * oiter = features + x + hogWidth * y ;
 
         /* each factor is the inverse of the l2 norm of one of the 2x2 blocks surrounding
            cell x,y */
@@ -1068,5 +1228,369 @@ vl_hog_extract (VlHog * self, float * features)
       } /* next x */
     } /* next y */
   } /* block normalization */
+
+#undef atNorm
+}
+
+/* ---------------------------------------------------------------- */
+/** @brief Extract HOG features
+ ** @param self HOG object.
+ ** @param features HOG features (output).
+ **
+ ** This method is called after ::vl_hog_put_image or ::vl_hog_put_polar_field
+ ** in order to retrieve the computed HOG features. The buffer @c features must have the dimensions returned by
+ ** ::vl_hog_get_width, ::vl_hog_get_height, and ::vl_hog_get_dimension.
+ **/
+
+void
+vl_hog_extract (VlHog * self, float * features)
+{
+  assert(features) ;
+  _vl_hog_extract(self, features, self->hog, self->hogNorm,
+                  self->hogWidth, self->hogHeight) ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                                  Feature pyramid */
+/* ---------------------------------------------------------------- */
+
+/** @internal @brief Resample an image by bilinear interpolation
+ ** @param dst resampled image (output).
+ ** @param dstWidth width of the resampled image.
+ ** @param dstHeight height of the resampled image.
+ ** @param src image to resample.
+ ** @param srcWidth image width.
+ ** @param srcHeight image height.
+ ** @param numChannels number of image channels.
+ ** @return error code (::VL_ERR_ALLOC if out of memory).
+ **/
+
+static int
+_vl_hog_resize_image (float * dst, vl_size dstWidth, vl_size dstHeight,
+                      float const * src, vl_size srcWidth, vl_size srcHeight,
+                      vl_size numChannels)
+{
+  double sx = (double) srcWidth / dstWidth ;
+  double sy = (double) srcHeight / dstHeight ;
+  vl_index * columns = malloc(sizeof(vl_index) * dstWidth) ;
+  float * columnWeights = malloc(sizeof(float) * dstWidth) ;
+  vl_uindex x, y, k ;
+
+  if (columns == NULL || columnWeights == NULL) {
+    if (columns) free(columns) ;
+    if (columnWeights) free(columnWeights) ;
+    return VL_ERR_ALLOC ;
+  }
+
+  for (x = 0 ; x < dstWidth ; ++x) {
+    double u = VL_MIN(VL_MAX((x + 0.5) * sx - 0.5, 0.0), (double)(srcWidth - 1)) ;
+    columns[x] = (vl_index) u ;
+    columnWeights[x] = (float) (u - columns[x]) ;
+  }
+
+  for (k = 0 ; k < numChannels ; ++k) {
+    float const * channel = src + k * srcWidth * srcHeight ;
+    for (y = 0 ; y < dstHeight ; ++y) {
+      double v = VL_MIN(VL_MAX((y + 0.5) * sy - 0.5, 0.0), (double)(srcHeight - 1)) ;
+      vl_index y1 = (vl_index) v ;
+      vl_index y2 = VL_MIN(y1 + 1, (signed)srcHeight - 1) ;
+      float wy = (float) (v - y1) ;
+      float const * row1 = channel + y1 * srcWidth ;
+      float const * row2 = channel + y2 * srcWidth ;
+      for (x = 0 ; x < dstWidth ; ++x) {
+        vl_index x1 = columns[x] ;
+        vl_index x2 = VL_MIN(x1 + 1, (signed)srcWidth - 1) ;
+        float wx = columnWeights[x] ;
+        float a = (1 - wx) * row1[x1] + wx * row1[x2] ;
+        float b = (1 - wx) * row2[x1] + wx * row2[x2] ;
+        *dst++ = (1 - wy) * a + wy * b ;
+      }
+    }
+  }
+  free(columns) ;
+  free(columnWeights) ;
+  return VL_ERR_OK ;
+}
+
+/** @internal @brief Halve an image by averaging 2x2 pixel blocks
+ ** @param dst halved image (output).
+ ** @param src image to halve.
+ ** @param srcWidth image width.
+ ** @param srcHeight image height.
+ ** @param numChannels number of image channels.
+ **/
+
+static void
+_vl_hog_halve_image (float * dst,
+                     float const * src, vl_size srcWidth, vl_size srcHeight,
+                     vl_size numChannels)
+{
+  vl_size dstWidth = srcWidth / 2 ;
+  vl_size dstHeight = srcHeight / 2 ;
+  vl_uindex x, y, k ;
+  for (k = 0 ; k < numChannels ; ++k) {
+    float const * channel = src + k * srcWidth * srcHeight ;
+    for (y = 0 ; y < dstHeight ; ++y) {
+      float const * row1 = channel + 2 * y * srcWidth ;
+      float const * row2 = row1 + srcWidth ;
+      for (x = 0 ; x < dstWidth ; ++x) {
+        *dst++ = 0.25f * (row1[2*x] + row1[2*x+1] + row2[2*x] + row2[2*x+1]) ;
+      }
+    }
+  }
+}
+
+/** @internal @brief Data of the HOG pyramid parallel loops */
+typedef struct _VlHogPyramidLoop
+{
+  VlHog const * self ;              /**< HOG object. */
+  float * features ;                /**< HOG features of all levels (out). */
+  VlHogPyramidLevel const * levels ; /**< pyramid levels. */
+  float ** images ;                 /**< images of the levels. */
+  vl_size const * imageWidths ;     /**< image widths. */
+  vl_size const * imageHeights ;    /**< image heights. */
+  vl_size numChannels ;             /**< number of image channels. */
+  vl_size cellSize ;                /**< size of a HOG cell. */
+  vl_size numLevelsPerOctave ;      /**< number of levels per octave. */
+  vl_index firstLevel ;             /**< first level of the loop. */
+  int * errors ;                    /**< one error code for each task (out). */
+} VlHogPyramidLoop ;
+
+/** @internal @brief Resample the input image for a range of levels
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first level (relative to @c firstLevel).
+ ** @param end last level plus one.
+ **/
+
+static void
+_vl_hog_resize_range (void * loop_, vl_uindex task,
+                      vl_uindex begin, vl_uindex end)
+{
+  VlHogPyramidLoop * loop = loop_ ;
+  vl_index l ;
+  for (l = loop->firstLevel + begin ; l < loop->firstLevel + (signed)end ; ++l) {
+    if (_vl_hog_resize_image(loop->images[l], loop->imageWidths[l], loop->imageHeights[l],
+                             loop->images[0], loop->imageWidths[0], loop->imageHeights[0],
+                             loop->numChannels)) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+      return ;
+    }
+  }
+}
+
+/** @internal @brief Halve the level one octave above for a range of levels
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first level (relative to @c firstLevel).
+ ** @param end last level plus one.
+ **/
+
+static void
+_vl_hog_halve_range (void * loop_, vl_uindex task VL_UNUSED,
+                     vl_uindex begin, vl_uindex end)
+{
+  VlHogPyramidLoop * loop = loop_ ;
+  vl_index l ;
+  for (l = loop->firstLevel + begin ; l < loop->firstLevel + (signed)end ; ++l) {
+    vl_index above = l - loop->numLevelsPerOctave ;
+    _vl_hog_halve_image(loop->images[l], loop->images[above],
+                        loop->imageWidths[above], loop->imageHeights[above],
+                        loop->numChannels) ;
+  }
+}
+
+/** @internal @brief Compute the HOG features of a range of levels
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first level.
+ ** @param end last level plus one.
+ **/
+
+static void
+_vl_hog_extract_range (void * loop_, vl_uindex task,
+                       vl_uindex begin, vl_uindex end)
+{
+  VlHogPyramidLoop * loop = loop_ ;
+  VlHog const * self = loop->self ;
+  vl_uindex l ;
+  for (l = begin ; l < end ; ++l) {
+    VlHogPyramidLevel const * level = loop->levels + l ;
+    float * hog = calloc(level->width * level->height * self->numOrientations * 2, sizeof(float)) ;
+    float * hogNorm = calloc(level->width * level->height, sizeof(float)) ;
+    if (hog == NULL || hogNorm == NULL ||
+        _vl_hog_put_image(self, hog, level->width, level->height,
+                          loop->images[l], loop->imageWidths[l], loop->imageHeights[l],
+                          loop->numChannels, loop->cellSize)) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+    } else {
+      _vl_hog_extract(self, loop->features + level->offset, hog, hogNorm,
+                      level->width, level->height) ;
+    }
+    if (hog) free(hog) ;
+    if (hogNorm) free(hogNorm) ;
+  }
 }
 
+/** @brief Compute HOG features on an image pyramid
+ ** @param self HOG object.
+ ** @param features HOG features of all levels (output).
+ ** @param levels pyramid levels (output).
+ ** @param image image to process.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param numChannels number of image channles.
+ ** @param cellSize size of a HOG cell.
+ ** @param numLevelsPerOctave number of levels per octave.
+ ** @return number of pyramid levels.
+ **
+ ** The function rescales the image by the factors
+ ** @f$ 2^{-l/\mathrm{numLevelsPerOctave}} @f$, @f$ l = 0,1,\dots @f$,
+ ** until the image becomes smaller than @a cellSize (or than four
+ ** pixels), and computes the HOG features of each level as
+ ** ::vl_hog_put_image followed by ::vl_hog_extract would.
+ ** The levels of the first octave are obtained by bilinear
+ ** interpolation of @a image and the following ones by halving the
+ ** level one octave above.
+ **
+ ** The features of all the levels are stored in a single buffer,
+ ** allocated by the function and returned in @a features, that
+ ** the caller must release by ::vl_free. Level @c l starts at
+ ** <code>(*levels)[l].offset</code> and has the layout of
+ ** ::vl_hog_extract, with <code>(*levels)[l].width</code> by
+ ** <code>(*levels)[l].height</code> cells. The array @a levels is
+ ** allocated by the function as well and must be released by
+ ** ::vl_free.
+ **
+ ** The levels are processed in parallel (see @ref threads). The
+ ** HOG object is not modified, so it can be shared by different
+ ** threads.
+ **
+ ** If the function runs out of memory, it sets the last error to
+ ** ::VL_ERR_ALLOC, sets @a features and @a levels to @c NULL and
+ ** returns zero.
+ **/
+
+vl_size
+vl_hog_process_pyramid (VlHog const * self,
+                        float ** features,
+                        VlHogPyramidLevel ** levels,
+                        float const * image,
+                        vl_size width, vl_size height, vl_size numChannels,
+                        vl_size cellSize,
+                        vl_size numLevelsPerOctave)
+{
+  vl_size minSize = VL_MAX(cellSize, 4) ;
+  vl_size numLevels = 0 ;
+  vl_size numFeatures = 0 ;
+  vl_size * imageWidths ;
+  vl_size * imageHeights ;
+  float ** images ;
+  vl_index l, o ;
+  vl_size numTasks ;
+  VlHogPyramidLoop loop ;
+
+  assert(self) ;
+  assert(features) ;
+  assert(levels) ;
+  assert(image) ;
+  assert(numLevelsPerOctave >= 1) ;
+  assert(width >= minSize && height >= minSize) ;
+
+  /* count the levels: the sizes of an octave are half the ones above */
+  while (1) {
+    vl_size octave = numLevelsPerOctave ;
+    double scale = pow(2.0, - (double)(numLevels % octave) / octave) ;
+    vl_size levelWidth = (vl_size) vl_floor_d(width * scale + 0.5) >> (numLevels / octave) ;
+    vl_size levelHeight = (vl_size) vl_floor_d(height * scale + 0.5) >> (numLevels / octave) ;
+    if (levelWidth < minSize || levelHeight < minSize) break ;
+    ++ numLevels ;
+  }
+
+  *features = NULL ;
+  /* the levels have different sizes, so each level is a task */
+  numTasks = VL_MAX(numLevels, 1) ;
+  memset(&loop, 0, sizeof(loop)) ;
+  *levels = vl_malloc(sizeof(VlHogPyramidLevel) * numLevels) ;
+  imageWidths = vl_malloc(sizeof(vl_size) * numLevels) ;
+  imageHeights = vl_malloc(sizeof(vl_size) * numLevels) ;
+  images = vl_calloc(numLevels, sizeof(float*)) ;
+  loop.errors = vl_calloc(numTasks, sizeof(int)) ;
+  if (*levels == NULL || imageWidths == NULL ||
+      imageHeights == NULL || images == NULL || loop.errors == NULL) {
+    goto alloc_error ;
+  }
+
+  for (l = 0 ; l < (signed)numLevels ; ++l) {
+    VlHogPyramidLevel * level = *levels + l ;
+    double scale = pow(2.0, - (double)(l % numLevelsPerOctave) / numLevelsPerOctave) ;
+    imageWidths[l] = (vl_size) vl_floor_d(width * scale + 0.5) >> (l / numLevelsPerOctave) ;
+    imageHeights[l] = (vl_size) vl_floor_d(height * scale + 0.5) >> (l / numLevelsPerOctave) ;
+    level->scale = pow(2.0, - (double)l / numLevelsPerOctave) ;
+    level->width = (imageWidths[l] + cellSize/2) / cellSize ;
+    level->height = (imageHeights[l] + cellSize/2) / cellSize ;
+    level->offset = numFeatures ;
+    numFeatures += level->width * level->height * self->dimension ;
+    images[l] = (l == 0) ? (float*) image :
+      vl_malloc(sizeof(float) * imageWidths[l] * imageHeights[l] * numChannels) ;
+    if (images[l] == NULL) goto alloc_error ;
+  }
+  *features = vl_malloc(sizeof(float) * numFeatures) ;
+  if (*features == NULL) goto alloc_error ;
+
+  loop.self = self ;
+  loop.features = *features ;
+  loop.levels = *levels ;
+  loop.images = images ;
+  loop.imageWidths = imageWidths ;
+  loop.imageHeights = imageHeights ;
+  loop.numChannels = numChannels ;
+  loop.cellSize = cellSize ;
+  loop.numLevelsPerOctave = numLevelsPerOctave ;
+
+  /* first octave: resample the input image */
+  loop.firstLevel = 1 ;
+  vl_parallel_for (VL_MIN(numLevelsPerOctave, numLevels) - 1, numTasks,
+                   _vl_hog_resize_range, &loop) ;
+  for (l = 0 ; l < (signed)numTasks ; ++l) {
+    if (loop.errors[l]) goto alloc_error ;
+  }
+
+  /* other octaves: halve the level one octave above */
+  for (o = 1 ; o * numLevelsPerOctave < numLevels ; ++o) {
+    vl_index begin = o * numLevelsPerOctave ;
+    vl_index end = VL_MIN(begin + numLevelsPerOctave, numLevels) ;
+    loop.firstLevel = begin ;
+    vl_parallel_for (end - begin, numTasks, _vl_hog_halve_range, &loop) ;
+  }
+
+  /* HOG features of each level */
+  vl_parallel_for (numLevels, numTasks, _vl_hog_extract_range, &loop) ;
+  for (l = 0 ; l < (signed)numTasks ; ++l) {
+    if (loop.errors[l]) goto alloc_error ;
+  }
+
+  for (l = 1 ; l < (signed)numLevels ; ++l) vl_free(images[l]) ;
+  vl_free(images) ;
+  vl_free(imageWidths) ;
+  vl_free(imageHeights) ;
+  vl_free(loop.errors) ;
+  return numLevels ;
+
+alloc_error:
+  if (loop.errors) vl_free(loop.errors) ;
+  if (images) {
+    for (l = 1 ; l < (signed)numLevels ; ++l) {
+      if (images[l]) vl_free(images[l]) ;
+    }
+    vl_free(images) ;
+  }
+  if (imageWidths) vl_free(imageWidths) ;
+  if (imageHeights) vl_free(imageHeights) ;
+  if (*levels) vl_free(*levels) ;
+  if (*features) vl_free(*features) ;
+  *levels = NULL ;
+  *features = NULL ;
+  vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the HOG pyramid.") ;
+  return 0 ;
+}
@@ -48,6 +48,15 @@ struct VlHog_
 
 typedef struct VlHog_ VlHog ;
 
+/** @brief HOG feature pyramid level */
+typedef struct VlHogPyramidLevel_
+{
+  double scale ;     /**< scale of the level image relative to the input image. */
+  vl_size width ;    /**< number of HOG cells in the horizontal direction. */
+  vl_size height ;   /**< number of HOG cells in the vertical direction. */
+  vl_size offset ;   /**< offset of the level features in the feature buffer. */
+} VlHogPyramidLevel ;
+
 VL_EXPORT VlHog * vl_hog_new (VlHogVariant variant, vl_size numOrientations, vl_bool transposed) ;
 VL_EXPORT void vl_hog_delete (VlHog * self) ;
 VL_EXPORT void vl_hog_process (VlHog * self,
@@ -56,18 +65,25 @@ VL_EXPORT void vl_hog_process (VlHog * self,
                                vl_size width, vl_size height, vl_size numChannels,
                                vl_size cellSize) ;
 
-VL_EXPORT void vl_hog_put_image (VlHog * self,
-                                 float const * image,
-                                 vl_size width, vl_size height, vl_size numChannels,
-                                 vl_size cellSize) ;
+VL_EXPORT int vl_hog_put_image (VlHog * self,
+                                float const * image,
+                                vl_size width, vl_size height, vl_size numChannels,
+                                vl_size cellSize) ;
 
-VL_EXPORT void vl_hog_put_polar_field (VlHog * self,
-                                       float const * modulus,
-                                       float const * angle,
-                                       vl_bool directed,
-                                       vl_size width, vl_size height, vl_size cellSize) ;
+VL_EXPORT int vl_hog_put_polar_field (VlHog * self,
+                                      float const * modulus,
+                                      float const * angle,
+                                      vl_bool directed,
+                                      vl_size width, vl_size height, vl_size cellSize) ;
 
 VL_EXPORT void vl_hog_extract (VlHog * self, float * features) ;
+VL_EXPORT vl_size vl_hog_process_pyramid (VlHog const * self,
+                                          float ** features,
+                                          VlHogPyramidLevel ** levels,
+                                          float const * image,
+                                          vl_size width, vl_size height, vl_size numChannels,
+                                          vl_size cellSize,
+                                          vl_size numLevelsPerOctave) ;
 VL_EXPORT vl_size vl_hog_get_height (VlHog * self) ;
 VL_EXPORT vl_size vl_hog_get_width (VlHog * self) ;
 
@@ -0,0 +1,102 @@
+/** @file hog_sse2.c
+ ** @brief HOG - SSE2 - Definition
+ **/
+
+/*
+ Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+ All rights reserved.
+
+ This file is part of the VLFeat library and is made available under
+ the terms of the BSD license (see the COPYING file).
+*/
+
+#if ! defined(VL_DISABLE_SSE2) & ! defined(__SSE2__)
+#error "Compiling with SSE2 enabled, but no __SSE2__ defined"
+#endif
+
+#if ! defined(VL_DISABLE_SSE2)
+
+#include <emmintrin.h>
+
+#include "hog.h"
+#include "hog_sse2.h"
+
+/* select a where mask is set and b otherwise */
+#define VSEL(mask,a,b) _mm_or_ps(_mm_and_ps(mask,a), _mm_andnot_ps(mask,b))
+
+/* ---------------------------------------------------------------- */
+/*
+ * Same algorithm as _vl_hog_bin_gradients in hog.c, processing four
+ * pixels at a time. Each lane performs the same floating point
+ * operations in the same order as the scalar code, so the results
+ * are identical. The function processes the largest multiple of four
+ * pixels not greater than numPixels and returns their number; the
+ * caller completes the row.
+ */
+
+vl_size
+_vl_hog_bin_gradients_sse2 (float * gradNorm,
+                            float * weights0, float * weights1,
+                            vl_int32 * bins0, vl_int32 * bins1,
+                            float const * image,
+                            vl_size stride, vl_size channelStride,
+                            vl_size numChannels, vl_size numPixels,
+                            float const * orientationX,
+                            float const * orientationY,
+                            vl_size numOrientations)
+{
+  __m128 const zero = _mm_setzero_ps() ;
+  __m128 const minusOne = _mm_set1_ps(-1.0f) ;
+  __m128 const signMask = _mm_set1_ps(-0.0f) ;
+  vl_uindex i, c, k ;
+
+  for (i = 0 ; i + 4 <= numPixels ; i += 4) {
+    __m128 gradx = zero ;
+    __m128 grady = zero ;
+    __m128 gradNorm2 = zero ;
+    __m128 w0 = minusOne ;
+    __m128 w1 = minusOne ;
+    __m128 b0 = minusOne ;
+    __m128 b1 = minusOne ;
+    float const * iter = image + i ;
+
+    /* the channel with the largest gradient */
+    for (c = 0 ; c < numChannels ; ++c) {
+      __m128 gradx_ = _mm_sub_ps(_mm_loadu_ps(iter + 1), _mm_loadu_ps(iter - 1)) ;
+      __m128 grady_ = _mm_sub_ps(_mm_loadu_ps(iter + stride), _mm_loadu_ps(iter - stride)) ;
+      __m128 gradNorm2_ = _mm_add_ps(_mm_mul_ps(gradx_, gradx_), _mm_mul_ps(grady_, grady_)) ;
+      __m128 better = _mm_cmpgt_ps(gradNorm2_, gradNorm2) ;
+      gradx = VSEL(better, gradx_, gradx) ;
+      grady = VSEL(better, grady_, grady) ;
+      gradNorm2 = VSEL(better, gradNorm2_, gradNorm2) ;
+      iter += channelStride ;
+    }
+    _mm_storeu_ps(gradNorm + i, _mm_sqrt_ps(gradNorm2)) ;
+
+    /* the two best orientation bins */
+    for (k = 0 ; k < numOrientations ; ++k) {
+      __m128 score = _mm_add_ps(_mm_mul_ps(gradx, _mm_set1_ps(orientationX[k])),
+                                _mm_mul_ps(grady, _mm_set1_ps(orientationY[k]))) ;
+      __m128 negative = _mm_cmplt_ps(score, zero) ;
+      __m128 bin = VSEL(negative,
+                        _mm_set1_ps((float)(k + numOrientations)),
+                        _mm_set1_ps((float)k)) ;
+      __m128 first, second ;
+      score = _mm_xor_ps(score, _mm_and_ps(negative, signMask)) ;
+      first = _mm_cmpgt_ps(score, w0) ;
+      second = _mm_andnot_ps(first, _mm_cmpgt_ps(score, w1)) ;
+      w1 = VSEL(first, w0, VSEL(second, score, w1)) ;
+      b1 = VSEL(first, b0, VSEL(second, bin, b1)) ;
+      w0 = VSEL(first, score, w0) ;
+      b0 = VSEL(first, bin, b0) ;
+    }
+    _mm_storeu_ps(weights0 + i, w0) ;
+    _mm_storeu_ps(weights1 + i, w1) ;
+    _mm_storeu_si128((__m128i*)(bins0 + i), _mm_cvtps_epi32(b0)) ;
+    _mm_storeu_si128((__m128i*)(bins1 + i), _mm_cvtps_epi32(b1)) ;
+  }
+  return i ;
+}
+
+/* ! VL_DISABLE_SSE2 */
+#endif
@@ -0,0 +1,34 @@
+/** @file hog_sse2.h
+ ** @brief HOG - SSE2
+ **/
+
+/*
+ Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+ All rights reserved.
+
+ This file is part of the VLFeat library and is made available under
+ the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_HOG_SSE2_H
+#define VL_HOG_SSE2_H
+
+#include "generic.h"
+
+#ifndef VL_DISABLE_SSE2
+
+VL_EXPORT
+vl_size _vl_hog_bin_gradients_sse2 (float * gradNorm,
+                                    float * weights0, float * weights1,
+                                    vl_int32 * bins0, vl_int32 * bins1,
+                                    float const * image,
+                                    vl_size stride, vl_size channelStride,
+                                    vl_size numChannels, vl_size numPixels,
+                                    float const * orientationX,
+                                    float const * orientationY,
+                                    vl_size numOrientations) ;
+
+#endif
+
+/* VL_HOG_SSE2_H */
+#endif
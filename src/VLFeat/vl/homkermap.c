@@ -511,6 +511,28 @@ vl_homogeneouskernelmap_get_window_type (VlHomogeneousKernelMap const * self)
  ** @copydetails ::vl_homogeneouskernelmap_evaluate_d(VlHomogeneousKernelMap const*,double*,vl_size,double)
  **/
 
+/** @internal
+ ** @fn ::_vl_homogeneouskernelmap_evaluate_range_d(VlHomogeneousKernelMap const*,double*,vl_size,double,vl_size,vl_size)
+ ** @brief Evaluate some components of the map
+ ** @param self map object.
+ ** @param destination output buffer.
+ ** @param stride stride of the output buffer.
+ ** @param x value to expand.
+ ** @param first first component.
+ ** @param count number of components.
+ **
+ ** The function is the same as
+ ** ::vl_homogeneouskernelmap_evaluate_d, but it stores only the
+ ** components @a first, ..., @a first + @a count - 1 of the
+ ** feature map. This allows evaluating the map in a fixed size
+ ** buffer, a block of components at a time.
+ **/
+
+/** @internal
+ ** @fn ::_vl_homogeneouskernelmap_evaluate_range_f(VlHomogeneousKernelMap const*,float*,vl_size,double,vl_size,vl_size)
+ ** @copydetails ::_vl_homogeneouskernelmap_evaluate_range_d(VlHomogeneousKernelMap const*,double*,vl_size,double,vl_size,vl_size)
+ **/
+
 #define FLT VL_TYPE_FLOAT
 #define VL_HOMKERMAP_INSTANTIATING
 #include "homkermap.c"
@@ -529,24 +551,28 @@ vl_homogeneouskernelmap_get_window_type (VlHomogeneousKernelMap const * self)
 #include "float.th"
 
 void
-VL_XCAT(vl_homogeneouskernelmap_evaluate_,SFX)
+VL_XCAT(_vl_homogeneouskernelmap_evaluate_range_,SFX)
 (VlHomogeneousKernelMap const * self,
  T * destination,
  vl_size stride,
- double x)
+ double x,
+ vl_size first,
+ vl_size count)
 {
   /* break value into exponent and mantissa */
   int exponent ;
-  int unsigned j ;
+  vl_uindex j ;
   double mantissa = frexp(x, &exponent) ;
   double sign = (mantissa >= 0.0) ? +1.0 : -1.0 ;
   mantissa *= 2*sign ;
   exponent -- ;
 
+  assert(first + count <= 2*self->order+1) ;
+
   if (mantissa == 0 ||
       exponent <= self->minExponent ||
       exponent >= self->maxExponent) {
-    for (j = 0 ; j < 2*self->order+1 ; ++j) {
+    for (j = 0 ; j < count ; ++j) {
       *destination = (T) 0.0 ;
       destination += stride ;
     }
@@ -564,8 +590,9 @@ VL_XCAT(vl_homogeneouskernelmap_evaluate_,SFX)
       mantissa -= self->subdivision ;
       v1 += featureDimension ;
     }
+    v1 += first ;
     v2 = v1 + featureDimension ;
-    for (j = 0 ; j < featureDimension ; ++j) {
+    for (j = 0 ; j < count ; ++j) {
       f1 = *v1++ ;
       f2 = *v2++ ;
       *destination = (T) sign * ((f2 - f1) * (self->numSubdivisions * mantissa) + f1) ;
@@ -574,6 +601,17 @@ VL_XCAT(vl_homogeneouskernelmap_evaluate_,SFX)
   }
 }
 
+void
+VL_XCAT(vl_homogeneouskernelmap_evaluate_,SFX)
+(VlHomogeneousKernelMap const * self,
+ T * destination,
+ vl_size stride,
+ double x)
+{
+  VL_XCAT(_vl_homogeneouskernelmap_evaluate_range_,SFX)
+  (self, destination, stride, x, 0, 2*self->order+1) ;
+}
+
 #undef FLT
 #undef VL_HOMKERMAP_INSTANTIATING
 /* VL_HOMKERMAP_INSTANTIATING */
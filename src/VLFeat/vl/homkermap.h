@@ -64,6 +64,22 @@ vl_homogeneouskernelmap_evaluate_f (VlHomogeneousKernelMap const * self,
                                     float * destination,
                                     vl_size stride,
                                     double x) ;
+
+VL_EXPORT void
+_vl_homogeneouskernelmap_evaluate_range_d (VlHomogeneousKernelMap const * self,
+                                           double * destination,
+                                           vl_size stride,
+                                           double x,
+                                           vl_size first,
+                                           vl_size count) ;
+
+VL_EXPORT void
+_vl_homogeneouskernelmap_evaluate_range_f (VlHomogeneousKernelMap const * self,
+                                           float * destination,
+                                           vl_size stride,
+                                           double x,
+                                           vl_size first,
+                                           vl_size count) ;
 /** @} */
 
 
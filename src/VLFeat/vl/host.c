@@ -408,7 +408,7 @@ it supports POSIX threads.
 VL_INLINE void
 _vl_cpuid (vl_int32* info, int function)
 {
-  __cpuid(info, function) ;
+  __cpuidex(info, function, 0) ;
 }
 #endif
 
@@ -428,13 +428,13 @@ _vl_cpuid (vl_int32* info, int function)
    "movl %%ebx, %1   \n" /* save what cpuid just put in %ebx */
    "popl %%ebx       \n" /* restore the old %ebx */
    : "=a"(info[0]), "=r"(info[1]), "=c"(info[2]), "=d"(info[3])
-   : "a"(function)
+   : "a"(function), "c"(0)
    : "cc") ; /* clobbered (cc=condition codes) */
 #else /* no -fPIC or -fPIC with a 64-bit target */
   __asm__ __volatile__
   ("cpuid"
    : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3])
-   : "a"(function)
+   : "a"(function), "c"(0)
    : "cc") ;
 #endif
 }
@@ -461,6 +461,12 @@ _vl_x86cpu_info_init (VlX86CpuInfo *self)
     self->hasSSE41 = info[2] & (1 << 19) ;
     self->hasSSE42 = info[2] & (1 << 20) ;
     self->hasAVX   = info[2] & (1 << 28) ;
+    self->hasFMA   = self->hasAVX && (info[2] & (1 << 12)) ;
+  }
+
+  if (max_func >= 7) {
+    _vl_cpuid(info, 7) ;
+    self->hasAVX2  = self->hasAVX && (info[1] & (1 << 5)) ;
   }
 }
 
@@ -474,7 +480,7 @@ _vl_x86cpu_info_to_string_copy (VlX86CpuInfo const *self)
       string = vl_malloc(sizeof(char) * length) ;
       if (string == NULL) break ;
     }
-    length = snprintf(string, length, "%s%s%s%s%s%s%s%s",
+    length = snprintf(string, length, "%s%s%s%s%s%s%s%s%s%s",
                       self->vendor.string,
                       self->hasMMX   ? " MMX" : "",
                       self->hasSSE   ? " SSE" : "",
@@ -482,7 +488,9 @@ _vl_x86cpu_info_to_string_copy (VlX86CpuInfo const *self)
                       self->hasSSE3  ? " SSE3" : "",
                       self->hasSSE41 ? " SSE41" : "",
                       self->hasSSE42 ? " SSE42" : "",
-                      self->hasAVX   ? " AVX" : "") ;
+                      self->hasAVX   ? " AVX" : "",
+                      self->hasAVX2  ? " AVX2" : "",
+                      self->hasFMA   ? " FMA" : "") ;
     length += 1 ;
   }
   return string ;
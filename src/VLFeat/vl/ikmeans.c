@@ -74,25 +74,121 @@ the terms of the BSD license (see the COPYING file).
  ** Usually 4-5 times less comparisons than Lloyd are preformed,
  ** providing a dramatic speedup in the execution time.
  **
+ ** @section ikmeans-parallel Parallel and SIMD computations
+ **
+ ** Both algorithms assign the data to the centers in parallel
+ ** (see ::vl_set_num_threads), and compare data and centers by SSE2
+ ** instructions if enabled (see ::vl_set_simd_enabled). The results
+ ** are the same in all cases.
  **/
 
 #include "ikmeans.h"
+#include "ikmeans_sse2.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h> /* memset */
 #include "assert.h"
 
-static void vl_ikm_init_lloyd (VlIKMFilt*) ;
-static void vl_ikm_init_elkan (VlIKMFilt*) ;
+static int vl_ikm_init_lloyd (VlIKMFilt*) ;
+static int vl_ikm_init_elkan (VlIKMFilt*) ;
 static int vl_ikm_train_lloyd (VlIKMFilt*, vl_uint8 const*, vl_size) ;
 static int vl_ikm_train_elkan (VlIKMFilt*, vl_uint8 const*, vl_size) ;
 static void vl_ikm_push_lloyd (VlIKMFilt*, vl_uint32*, vl_uint8 const*, vl_size) ;
 static void  vl_ikm_push_elkan  (VlIKMFilt*, vl_uint32*, vl_uint8 const*, vl_size) ;
 
+/** @internal @brief Squared distance of a datum to a center */
+typedef vl_ikmacc_t (*VlIKMDistanceFunction) (vl_uint8 const *, vl_ikmacc_t const *, vl_size) ;
+
+/** @internal
+ ** @brief Squared distance of a datum to a center
+ ** @param data datum.
+ ** @param center center.
+ ** @param M dimensionality.
+ ** @return squared l2 distance.
+ **/
+
+static vl_ikmacc_t
+vl_ikm_calc_dist2 (vl_uint8 const *data, vl_ikmacc_t const *center, vl_size M)
+{
+  vl_ikmacc_t dist = 0 ;
+  vl_uindex i ;
+  for (i = 0 ; i < M ; ++i) {
+    vl_ikmacc_t delta = (vl_ikmacc_t)data[i] - center[i] ;
+    dist += delta * delta ;
+  }
+  return dist ;
+}
+
+/** @internal
+ ** @brief Get the fastest distance function for the quantizer
+ ** @param f IKM quantizer.
+ ** @return distance function.
+ **/
+
+static VlIKMDistanceFunction
+vl_ikm_get_distance_function (VlIKMFilt const *f)
+{
+#ifndef VL_DISABLE_SSE2
+  if (f->narrow_centers && vl_cpu_has_sse2() && vl_get_simd_enabled()) {
+    return _vl_ikm_calc_dist2_sse2 ;
+  }
+#endif
+  return vl_ikm_calc_dist2 ;
+}
+
+/** @internal
+ ** @brief Check whether the centers fit the SIMD distance
+ ** @param f IKM quantizer.
+ **
+ ** This must be called whenever the centers change.
+ **/
+
+static void
+vl_ikm_update_narrow_centers (VlIKMFilt *f)
+{
+  vl_uindex i ;
+  f->narrow_centers = VL_TRUE ;
+  for (i = 0 ; i < f->M * f->K ; ++i) {
+    if (f->centers[i] < VL_IKM_SSE2_MIN_CENTER ||
+        f->centers[i] > VL_IKM_SSE2_MAX_CENTER) {
+      f->narrow_centers = VL_FALSE ;
+      break ;
+    }
+  }
+}
+
+/** @internal
+ ** @brief Find the center nearest to a datum
+ ** @param distFn distance function.
+ ** @param centers centers.
+ ** @param data datum.
+ ** @param M dimensionality.
+ ** @param K number of centers.
+ ** @return index of the nearest center (the first one in case of ties).
+ **/
+
+static vl_uint32
+vl_ikm_nearest (VlIKMDistanceFunction distFn,
+                vl_ikmacc_t const *centers,
+                vl_uint8 const *data,
+                vl_size M, vl_size K)
+{
+  vl_uindex k, best = 0 ;
+  vl_ikmacc_t bestDist = distFn (data, centers, M) ;
+  for (k = 1 ; k < K ; ++k) {
+    vl_ikmacc_t dist = distFn (data, centers + k * M, M) ;
+    if (dist < bestDist) {
+      best = k ;
+      bestDist = dist ;
+    }
+  }
+  return (vl_uint32)best ;
+}
+
 /** @brief Create a new IKM quantizer
  ** @param method Clustering algorithm.
- ** @return new IKM quantizer.
+ ** @return new IKM quantizer, or @c NULL if out of memory.
  **
  ** The function allocates initializes a new IKM quantizer to
  ** operate based algorithm @a method.
@@ -104,6 +200,7 @@ VlIKMFilt *
 vl_ikm_new (int method)
 {
   VlIKMFilt *f = vl_calloc (sizeof(VlIKMFilt), 1) ;
+  if (f == NULL) return NULL ;
   f -> method = method ;
   f -> max_niters = 200 ;
   return f ;
@@ -127,7 +224,14 @@ vl_ikm_delete (VlIKMFilt* f)
  ** @param f IKM quantizer.
  ** @param data data.
  ** @param N number of data (@a N @c >= 1).
- ** @return -1 if an overflow may have occurred.
+ ** @return 1 if an overflow may have occurred, ::VL_ERR_ALLOC if
+ ** the function ran out of memory, and 0 otherwise.
+ **
+ ** The function allocates its temporary buffers with @c malloc
+ ** rather than ::vl_malloc and does not set the last error. If the
+ ** verbosity is zero, it does not print either, so that several
+ ** quantizers can be trained concurrently from worker threads (as
+ ** ::vl_hikm_train does), also in MATLAB.
  **/
 
 int
@@ -146,6 +250,7 @@ vl_ikm_train (VlIKMFilt *f, vl_uint8 const *data, vl_size N)
   default :
     abort() ;
   }
+  vl_ikm_update_narrow_centers (f) ;
   return err ;
 }
 
@@ -50,6 +50,7 @@ typedef struct _VlIKMFilt
   int verb ; /**< verbosity level */
   vl_ikmacc_t *centers ; /**< centers */
   vl_ikmacc_t *inter_dist ; /**< centers inter-distances */
+  vl_bool narrow_centers ; /**< centers fit the SIMD distance */
 } VlIKMFilt ;
 
 /** @name Create and destroy
@@ -60,9 +61,9 @@ VL_EXPORT void vl_ikm_delete (VlIKMFilt *f) ;
 
 /** @name Process data
  ** @{ */
-VL_EXPORT void vl_ikm_init (VlIKMFilt *f, vl_ikmacc_t const *centers, vl_size M, vl_size K) ;
-VL_EXPORT void vl_ikm_init_rand (VlIKMFilt *f, vl_size M, vl_size K) ;
-VL_EXPORT void vl_ikm_init_rand_data (VlIKMFilt *f, vl_uint8 const *data, vl_size M, vl_size N, vl_size K) ;
+VL_EXPORT int  vl_ikm_init (VlIKMFilt *f, vl_ikmacc_t const *centers, vl_size M, vl_size K) ;
+VL_EXPORT int  vl_ikm_init_rand (VlIKMFilt *f, vl_size M, vl_size K) ;
+VL_EXPORT int  vl_ikm_init_rand_data (VlIKMFilt *f, vl_uint8 const *data, vl_size M, vl_size N, vl_size K) ;
 VL_EXPORT int  vl_ikm_train (VlIKMFilt *f, vl_uint8 const *data, vl_size N) ;
 VL_EXPORT void vl_ikm_push (VlIKMFilt *f, vl_uint32 *asgn, vl_uint8 const *data, vl_size N) ;
 VL_EXPORT vl_uint vl_ikm_push_one (vl_ikmacc_t const *centers, vl_uint8 const *data, vl_size M, vl_size K) ;
@@ -0,0 +1,66 @@
+/** @file ikmeans_sse2.c
+ ** @brief Integer K-Means clustering - SSE2 - Definition
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#if ! defined(VL_DISABLE_SSE2) & ! defined(__SSE2__)
+#error "Compiling with SSE2 enabled, but no __SSE2__ defined"
+#endif
+
+#if ! defined(VL_DISABLE_SSE2)
+
+#include <emmintrin.h>
+
+#include "ikmeans_sse2.h"
+
+/** @internal
+ ** @brief Squared distance of a datum to a center (SSE2)
+ ** @param data datum.
+ ** @param center center.
+ ** @param M dimensionality.
+ ** @return squared l2 distance.
+ **
+ ** The center components must be in the range
+ ** [::VL_IKM_SSE2_MIN_CENTER, ::VL_IKM_SSE2_MAX_CENTER], so that they
+ ** and their differences from the data fit 16 bits. Eight
+ ** differences are then squared and summed in pairs by a single
+ ** @c pmaddwd instruction. The result is the same as the one of
+ ** the scalar code.
+ **/
+
+VL_EXPORT vl_ikmacc_t
+_vl_ikm_calc_dist2_sse2 (vl_uint8 const * data,
+                         vl_ikmacc_t const * center,
+                         vl_size M)
+{
+  __m128i zero = _mm_setzero_si128() ;
+  __m128i acc = _mm_setzero_si128() ;
+  vl_ikmacc_t sums [4] ;
+  vl_ikmacc_t dist ;
+  vl_uindex i ;
+
+  for (i = 0 ; i + 8 <= M ; i += 8) {
+    __m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const*)(data + i)), zero) ;
+    __m128i c = _mm_packs_epi32(_mm_loadu_si128((__m128i const*)(center + i)),
+                                _mm_loadu_si128((__m128i const*)(center + i + 4))) ;
+    __m128i delta = _mm_sub_epi16(x, c) ;
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(delta, delta)) ;
+  }
+  _mm_storeu_si128((__m128i*)sums, acc) ;
+  dist = sums[0] + sums[1] + sums[2] + sums[3] ;
+  for ( ; i < M ; ++i) {
+    vl_ikmacc_t delta = (vl_ikmacc_t)data[i] - center[i] ;
+    dist += delta * delta ;
+  }
+  return dist ;
+}
+
+/* ! VL_DISABLE_SSE2 */
+#endif
@@ -0,0 +1,34 @@
+/** @file ikmeans_sse2.h
+ ** @brief Integer K-Means clustering - SSE2
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_IKMEANS_SSE2_H
+#define VL_IKMEANS_SSE2_H
+
+#include "ikmeans.h"
+
+/** @internal @brief Smallest center component supported by the SSE2 distance */
+#define VL_IKM_SSE2_MIN_CENTER (-32512)
+
+/** @internal @brief Largest center component supported by the SSE2 distance */
+#define VL_IKM_SSE2_MAX_CENTER 32767
+
+#ifndef VL_DISABLE_SSE2
+
+VL_EXPORT vl_ikmacc_t
+_vl_ikm_calc_dist2_sse2 (vl_uint8 const * data,
+                         vl_ikmacc_t const * center,
+                         vl_size M) ;
+
+#endif
+
+/* VL_IKMEANS_SSE2_H */
+#endif
@@ -24,20 +24,52 @@ the terms of the BSD license (see the COPYING file).
  **
  ** - <b>Distance transform.</b> ::vl_image_distance_transform_f() is
  **   a linear algorithm to compute the distance transform of an
- **   image.
+ **   image. ::vl_image_distance_transform_2d_f() computes it along
+ **   both dimensions for a batch of images.
  **
  ** @remark  Some operations are optimized to exploit possible SIMD
  ** instructions. This requires image data to be properly aligned (typically
  ** to 16 bytes). Similalry, the image stride (the number of bytes to skip to move
- ** to the next image row), must be aligned.
+ ** to the next image row), must be aligned. The AVX version of
+ ** ::vl_imconvcol_vf() does not have this requirement.
   **/
 
 #ifndef VL_IMOPV_INSTANTIATING
 
 #include "imopv.h"
 #include "imopv_sse2.h"
+#include "imopv_avx.h"
 #include "mathop.h"
 
+#include <string.h>
+
+/** @internal @brief Data of the parallel loops of the distance transforms */
+typedef struct _VlDistanceTransformLoop
+{
+  void const * image ;        /**< input image(s). */
+  void * distanceTransform ;  /**< distance transform(s) (out). */
+  vl_uindex * indexes ;       /**< nearest neighbor indexes (in/out). */
+  vl_size numColumns ;        /**< number of columns (or image width). */
+  vl_size numRows ;           /**< number of rows (or image height). */
+  vl_size columnStride ;      /**< offset from one column to the next. */
+  vl_size rowStride ;         /**< offset from one row to the next. */
+  double coeff ;              /**< quadratic cost coefficient. */
+  double offset ;             /**< quadratic cost offset. */
+
+  /* batched 2D transform */
+  void * transposed ;         /**< transform along the columns. */
+  vl_uindex * transposedArgmins ; /**< minimizers along the columns. */
+  double coeffY ;             /**< quadratic cost coefficient along the rows. */
+  double offsetY ;            /**< quadratic cost offset along the rows. */
+
+  /* per task buffers */
+  vl_size lineLength ;        /**< maximum line length. */
+  void * from ;               /**< envelope intervals. */
+  void * base ;               /**< envelope values. */
+  vl_uindex * which ;         /**< envelope parabolas. */
+  vl_uindex * argmins ;       /**< minimizers of a line. */
+} VlDistanceTransformLoop ;
+
 #define FLT VL_TYPE_FLOAT
 #define VL_IMOPV_INSTANTIATING
 #include "imopv.c"
@@ -131,6 +163,16 @@ VL_XCAT(vl_imconvcol_v, SFX)
   vl_bool zeropad = (flags & VL_PAD_MASK) == VL_PAD_BY_ZERO ;
 
   /* dispatch to accelerated version */
+#ifndef VL_DISABLE_AVX
+  if (vl_cpu_has_avx() && vl_get_simd_enabled()) {
+    VL_XCAT3(_vl_imconvcol_v,SFX,_avx)
+    (dst,dst_stride,
+     src,src_width,src_height,src_stride,
+     filt,filt_begin,filt_end,
+     step,flags) ;
+    return ;
+  }
+#endif
 #ifndef VL_DISABLE_SSE2
   if (vl_cpu_has_sse2() && vl_get_simd_enabled()) {
     VL_XCAT3(_vl_imconvcol_v,SFX,_sse2)
@@ -231,13 +273,14 @@ VL_XCAT(vl_imconvcol_v, SFX)
  ** @param indexes nearest neighbor indexes (in/out).
  ** @param coeff quadratic cost coefficient (non-negative).
  ** @param offset quadratic cost offset.
+ ** @return error code.
  **
  ** The function computes the distance transform along the first
  ** dimension of the image @a image. Let @f$ I(u,v) @f$ be @a image.
  ** Its distance transfrom @f$ D(u,v) @f$ is given by:
  **
  ** @f[
- **   u^*(u,v) = \min_{u'} I(u',v) + \mathtt{coeff} (u' - u - \mathtt{offset})^2,
+ **   u^*(u,v) = \min_{u'} I(u',v) + \mathtt{coeff} (u - u' - \mathtt{offset})^2,
  **   \quad D(u,v) = I(u^*(u,v),v).
  ** @f]
  **
@@ -319,23 +362,46 @@ VL_XCAT(vl_imconvcol_v, SFX)
  ** parabolas. Since there are @f$ N @f$ iterations and at most @f$ N
  ** @f$ parabolas to delete overall, the complexity is linear,
  ** i.e. @f$ O(N) @f$.
+ **
+ ** @par Parallelism and errors
+ **
+ ** The rows are processed in parallel (see ::vl_set_num_threads).
+ ** @a distanceTransform may coincide with @a image. The function
+ ** returns ::VL_ERR_ALLOC (and sets the last error) if it runs out
+ ** of memory, in which case the output is not written.
  **/
 
 /** @fn ::vl_image_distance_transform_f(float const*,vl_size,vl_size,vl_size,vl_size,float*,vl_uindex*,float,float)
  ** @see ::vl_image_distance_transform_d
  **/
 
-VL_EXPORT void
-VL_XCAT(vl_image_distance_transform_,SFX)
-(T const * image,
- vl_size numColumns,
- vl_size numRows,
- vl_size columnStride,
- vl_size rowStride,
- T * distanceTransform,
- vl_uindex * indexes,
- T coeff,
- T offset)
+/** @internal
+ ** @brief Distance transform of an image line
+ ** @param out distance transform (out).
+ ** @param outStride offset from one sample of @a out to the next.
+ ** @param argmins position of the minimizer of each sample (out).
+ ** @param argminStride offset from one sample of @a argmins to the next.
+ ** @param line line.
+ ** @param lineStride offset from one sample of @a line to the next.
+ ** @param num number of samples.
+ ** @param coeff quadratic cost coefficient (non-negative).
+ ** @param offset quadratic cost offset.
+ ** @param from buffer of @a num + 1 elements.
+ ** @param base buffer of @a num elements.
+ ** @param which buffer of @a num elements.
+ **
+ ** @a argmins may be @c NULL. @a out may coincide with @a line.
+ ** @sa ::vl_image_distance_transform_d
+ **/
+
+static void
+VL_XCAT(_vl_distance_transform_line_,SFX)
+(T * out, vl_size outStride,
+ vl_uindex * argmins, vl_size argminStride,
+ T const * line, vl_size lineStride,
+ vl_size num,
+ T coeff, T offset,
+ T * from, T * base, vl_uindex * which)
 {
   /* Each image pixel corresponds to a parabola. The algorithm scans
    such parabolas from left to right, keeping track of which
@@ -345,103 +411,395 @@ VL_XCAT(vl_image_distance_transform_,SFX)
    the index of the parabola (that is, the pixel x from which the parabola
    originated).
    */
-  vl_uindex x, y ;
-  T * from = vl_malloc (sizeof(T) * (numColumns + 1)) ;
-  T * base = vl_malloc (sizeof(T) * numColumns) ;
-  vl_uindex * baseIndexes = vl_malloc (sizeof(vl_uindex) * numColumns) ;
-  vl_uindex * which = vl_malloc (sizeof(vl_uindex) * numColumns) ;
-  vl_uindex num = 0 ;
-
-  for (y = 0 ; y < numRows ; ++y) {
-    num = 0 ;
-    for (x = 0 ; x < numColumns ; ++x) {
-      T r = image[x  * columnStride + y * rowStride] ;
-      T x2 = x * x ;
+  vl_uindex x ;
+  vl_uindex numActive = 0 ;
+
+  for (x = 0 ; x < num ; ++x) {
+    T r = line[x * lineStride] ;
+    T x2 = x * x ;
 #if (FLT == VL_TYPE_FLOAT)
-      T from_ = - VL_INFINITY_F ;
+    T from_ = - VL_INFINITY_F ;
 #else
-      T from_ = - VL_INFINITY_D ;
+    T from_ = - VL_INFINITY_D ;
 #endif
 
-      /*
-       Add next parabola (there are NUM so far). The algorithm finds
-       intersection INTERS with the previously added parabola. If
-       the intersection is on the right of the "starting point" of
-       this parabola, then the previous parabola is kept, and the
-       new one is added to its right. Otherwise the new parabola
-       "eats" the old one, which gets deleted and the check is
-       repeated with the parabola added before the deleted one.
-       */
-
-      while (num >= 1) {
-        vl_uindex x_ = which[num - 1] ;
-        T x2_ = x_ * x_ ;
-        T r_ = image[x_ * columnStride + y * rowStride] ;
-        T inters ;
-        if (r == r_) {
-          /* handles the case r = r_ = \pm inf */
-          inters = (x + x_) / 2.0 + offset ;
-        }
+    /*
+     Add next parabola (there are NUM so far). The algorithm finds
+     intersection INTERS with the previously added parabola. If
+     the intersection is on the right of the "starting point" of
+     this parabola, then the previous parabola is kept, and the
+     new one is added to its right. Otherwise the new parabola
+     "eats" the old one, which gets deleted and the check is
+     repeated with the parabola added before the deleted one.
+     */
+
+    while (numActive >= 1) {
+      vl_uindex x_ = which[numActive - 1] ;
+      T x2_ = x_ * x_ ;
+      T r_ = base[numActive - 1] ;
+      T inters ;
+      if (r == r_) {
+        /* handles the case r = r_ = \pm inf */
+        inters = (x + x_) / 2.0 + offset ;
+      }
 #if (FLT == VL_TYPE_FLOAT)
-        else if (coeff > VL_EPSILON_F)
+      else if (coeff > VL_EPSILON_F)
 #else
-        else if (coeff > VL_EPSILON_D)
+      else if (coeff > VL_EPSILON_D)
 #endif
-        {
-          inters = ((r - r_) + coeff * (x2 - x2_)) / (x - x_) / (2*coeff) + offset ;
-        } else {
-          /* If coeff is very small, the parabolas are flat (= lines).
-           In this case the previous parabola should be deleted if the current
-           pixel has lower score */
+      {
+        inters = ((r - r_) + coeff * (x2 - x2_)) / (x - x_) / (2*coeff) + offset ;
+      } else {
+        /* If coeff is very small, the parabolas are flat (= lines).
+         In this case the previous parabola should be deleted if the current
+         pixel has lower score */
 #if (FLT == VL_TYPE_FLOAT)
-          inters = (r < r_) ? - VL_INFINITY_F : VL_INFINITY_F ;
+        inters = (r < r_) ? - VL_INFINITY_F : VL_INFINITY_F ;
 #else
-          inters = (r < r_) ? - VL_INFINITY_D : VL_INFINITY_D ;
+        inters = (r < r_) ? - VL_INFINITY_D : VL_INFINITY_D ;
 #endif
-        }
-        if (inters <= from [num - 1]) {
-          /* delete a previous parabola */
-          -- num ;
-        } else {
-          /* accept intersection */
-          from_ = inters ;
-          break ;
-        }
       }
+      if (inters <= from [numActive - 1]) {
+        /* delete a previous parabola */
+        -- numActive ;
+      } else {
+        /* accept intersection */
+        from_ = inters ;
+        break ;
+      }
+    }
 
-      /* add a new parabola */
-      which[num] = x ;
-      from[num] = from_ ;
-      base[num] = r ;
-      if (indexes) baseIndexes[num] = indexes[x  * columnStride + y * rowStride] ;
-      num ++ ;
-    } /* next column */
+    /* add a new parabola */
+    which[numActive] = x ;
+    from[numActive] = from_ ;
+    base[numActive] = r ;
+    numActive ++ ;
+  } /* next sample */
 
 #if (FLT == VL_TYPE_FLOAT)
-    from[num] = VL_INFINITY_F ;
+  from[numActive] = VL_INFINITY_F ;
 #else
-    from[num] = VL_INFINITY_D ;
+  from[numActive] = VL_INFINITY_D ;
 #endif
 
-    /* fill in */
-    num = 0 ;
-    for (x = 0 ; x < numColumns ; ++x) {
-      double delta ;
-      while (x >= from[num + 1]) ++ num ;
-      delta = (double) x - (double) which[num] - offset ;
-      distanceTransform[x  * columnStride + y * rowStride]
-      = base[num] + coeff * delta * delta ;
-      if (indexes) {
-        indexes[x  * columnStride + y * rowStride]
-        = baseIndexes[num] ;
+  /* fill in */
+  numActive = 0 ;
+  for (x = 0 ; x < num ; ++x) {
+    double delta ;
+    while (x >= from[numActive + 1]) ++ numActive ;
+    delta = (double) x - (double) which[numActive] - offset ;
+    out[x * outStride] = base[numActive] + coeff * delta * delta ;
+    if (argmins) argmins[x * argminStride] = which[numActive] ;
+  }
+}
+
+/** @internal
+ ** @brief Allocate the per task buffers of a distance transform loop
+ ** @param loop loop data (@c lineLength is set).
+ ** @param numTasks number of tasks.
+ ** @return error code.
+ **/
+
+static int
+VL_XCAT(_vl_distance_transform_new_buffers_,SFX)
+(VlDistanceTransformLoop * loop, vl_size numTasks)
+{
+  vl_size n = loop->lineLength ;
+  loop->from = vl_malloc (sizeof(T) * (n + 1) * numTasks) ;
+  loop->base = vl_malloc (sizeof(T) * n * numTasks) ;
+  loop->which = vl_malloc (sizeof(vl_uindex) * n * numTasks) ;
+  loop->argmins = vl_malloc (sizeof(vl_uindex) * n * numTasks) ;
+  if (loop->from == NULL || loop->base == NULL ||
+      loop->which == NULL || loop->argmins == NULL) {
+    return vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+  }
+  return VL_ERR_OK ;
+}
+
+/** @internal
+ ** @brief Delete the per task buffers of a distance transform loop
+ ** @param loop loop data.
+ **/
+
+static void
+VL_XCAT(_vl_distance_transform_delete_buffers_,SFX)
+(VlDistanceTransformLoop * loop)
+{
+  if (loop->from) vl_free (loop->from) ;
+  if (loop->base) vl_free (loop->base) ;
+  if (loop->which) vl_free (loop->which) ;
+  if (loop->argmins) vl_free (loop->argmins) ;
+}
+
+/** @internal
+ ** @brief Distance transform of a range of image rows
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row.
+ ** @param end last row plus one.
+ **/
+
+static void
+VL_XCAT(_vl_distance_transform_range_,SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlDistanceTransformLoop const * loop = loop_ ;
+  vl_size numColumns = loop->numColumns ;
+  vl_size columnStride = loop->columnStride ;
+  vl_size rowStride = loop->rowStride ;
+  T const * image = loop->image ;
+  T * distanceTransform = loop->distanceTransform ;
+  vl_uindex * indexes = loop->indexes ;
+  T * from = (T*)loop->from + task * (loop->lineLength + 1) ;
+  T * base = (T*)loop->base + task * loop->lineLength ;
+  vl_uindex * which = loop->which + task * loop->lineLength ;
+  vl_uindex * argmins = indexes ? loop->argmins + task * loop->lineLength : NULL ;
+  vl_uindex x, y ;
+
+  for (y = begin ; y < end ; ++y) {
+    VL_XCAT(_vl_distance_transform_line_,SFX)
+    (distanceTransform + y * rowStride, columnStride,
+     argmins, 1,
+     image + y * rowStride, columnStride,
+     numColumns, (T)loop->coeff, (T)loop->offset,
+     from, base, which) ;
+
+    if (indexes) {
+      /* gather the indexes before overwriting them */
+      for (x = 0 ; x < numColumns ; ++x) {
+        argmins[x] = indexes[argmins[x] * columnStride + y * rowStride] ;
+      }
+      for (x = 0 ; x < numColumns ; ++x) {
+        indexes[x * columnStride + y * rowStride] = argmins[x] ;
       }
     }
   } /* next row */
+}
+
+VL_EXPORT int
+VL_XCAT(vl_image_distance_transform_,SFX)
+(T const * image,
+ vl_size numColumns,
+ vl_size numRows,
+ vl_size columnStride,
+ vl_size rowStride,
+ T * distanceTransform,
+ vl_uindex * indexes,
+ T coeff,
+ T offset)
+{
+  VlDistanceTransformLoop loop ;
+  vl_size numTasks ;
+  int err ;
+
+  if (numRows == 0 || numColumns == 0) return VL_ERR_OK ;
+
+  /* rows are independent and are processed in parallel */
+  memset (&loop, 0, sizeof(loop)) ;
+  numTasks = VL_MIN(vl_get_max_threads(), numRows) ;
+  loop.lineLength = numColumns ;
+  err = VL_XCAT(_vl_distance_transform_new_buffers_,SFX)(&loop, numTasks) ;
+  if (err == VL_ERR_OK) {
+    loop.image = image ;
+    loop.distanceTransform = distanceTransform ;
+    loop.indexes = indexes ;
+    loop.numColumns = numColumns ;
+    loop.columnStride = columnStride ;
+    loop.rowStride = rowStride ;
+    loop.coeff = coeff ;
+    loop.offset = offset ;
+    vl_parallel_for (numRows, numTasks,
+                     VL_XCAT(_vl_distance_transform_range_,SFX), &loop) ;
+  }
+  VL_XCAT(_vl_distance_transform_delete_buffers_,SFX)(&loop) ;
+  return err ;
+}
+
+/** @fn ::vl_image_distance_transform_2d_d(double const*,vl_size,vl_size,vl_size,double*,vl_uindex*,double,double,double,double)
+ ** @brief Compute the 2D distance transform of a batch of images
+ ** @param images images.
+ ** @param numImages number of images.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param distanceTransforms distance transforms (out).
+ ** @param argmins nearest neighbor indexes (out).
+ ** @param coeffX quadratic cost coefficient along the columns (non-negative).
+ ** @param offsetX quadratic cost offset along the columns.
+ ** @param coeffY quadratic cost coefficient along the rows (non-negative).
+ ** @param offsetY quadratic cost offset along the rows.
+ ** @return error code.
+ **
+ ** The function computes the distance transform along both
+ ** dimensions of each of the @a numImages images @a images, stored
+ ** one after the other, each of size @a width by @a height. Let
+ ** @f$ I(u,v) @f$ be one image. Its distance transform is
+ **
+ ** @f[
+ **   D(u,v) = \min_{u',v'} I(u',v')
+ **   + \mathtt{coeffX} (u - u' - \mathtt{offsetX})^2
+ **   + \mathtt{coeffY} (v - v' - \mathtt{offsetY})^2.
+ ** @f]
+ **
+ ** The result is the same as the one obtained by calling
+ ** ::vl_image_distance_transform_d twice for each image, first along
+ ** the columns and then along the rows, as in the example given
+ ** there. If @a argmins is not @c NULL, it is filled with the
+ ** index @f$ u^* + v^* \mathtt{width} @f$ of the minimizer of each
+ ** pixel.
+ **
+ ** Both passes operate on contiguous memory, as the first one
+ ** stores its result transposed. The images and the image lines are
+ ** processed in parallel (see ::vl_set_num_threads).
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory, in which case the output is not written.
+ **/
+
+/** @fn ::vl_image_distance_transform_2d_f(float const*,vl_size,vl_size,vl_size,float*,vl_uindex*,float,float,float,float)
+ ** @see ::vl_image_distance_transform_2d_d
+ **/
+
+/** @internal
+ ** @brief 2D distance transform along the columns of a range of image rows
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row (counting the rows of all the images).
+ ** @param end last row plus one.
+ **
+ ** The result is stored transposed.
+ **/
+
+static void
+VL_XCAT(_vl_distance_transform_2d_columns_range_,SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlDistanceTransformLoop const * loop = loop_ ;
+  vl_size width = loop->numColumns ;
+  vl_size height = loop->numRows ;
+  vl_size imageSize = width * height ;
+  T const * images = loop->image ;
+  T * transposed = loop->transposed ;
+  vl_uindex * transposedArgmins = loop->transposedArgmins ;
+  T * from = (T*)loop->from + task * (loop->lineLength + 1) ;
+  T * base = (T*)loop->base + task * loop->lineLength ;
+  vl_uindex * which = loop->which + task * loop->lineLength ;
+  vl_uindex l ;
+
+  for (l = begin ; l < end ; ++l) {
+    vl_uindex k = l / height ;
+    vl_uindex y = l % height ;
+    VL_XCAT(_vl_distance_transform_line_,SFX)
+    (transposed + k * imageSize + y, height,
+     transposedArgmins ? transposedArgmins + k * imageSize + y : NULL, height,
+     images + k * imageSize + y * width, 1,
+     width, (T)loop->coeff, (T)loop->offset,
+     from, base, which) ;
+  }
+}
+
+/** @internal
+ ** @brief 2D distance transform along the rows of a range of image columns
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first column (counting the columns of all the images).
+ ** @param end last column plus one.
+ **
+ ** The input is the transposed result of the pass along the columns.
+ **/
+
+static void
+VL_XCAT(_vl_distance_transform_2d_rows_range_,SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlDistanceTransformLoop const * loop = loop_ ;
+  vl_size width = loop->numColumns ;
+  vl_size height = loop->numRows ;
+  vl_size imageSize = width * height ;
+  T * distanceTransforms = loop->distanceTransform ;
+  T const * transposed = loop->transposed ;
+  vl_uindex const * transposedArgmins = loop->transposedArgmins ;
+  vl_uindex * argmins = loop->indexes ;
+  T * from = (T*)loop->from + task * (loop->lineLength + 1) ;
+  T * base = (T*)loop->base + task * loop->lineLength ;
+  vl_uindex * which = loop->which + task * loop->lineLength ;
+  vl_uindex * lineArgmins = loop->argmins + task * loop->lineLength ;
+  vl_uindex l ;
+
+  for (l = begin ; l < end ; ++l) {
+    vl_uindex k = l / width ;
+    vl_uindex x = l % width ;
+    vl_uindex y ;
+    VL_XCAT(_vl_distance_transform_line_,SFX)
+    (distanceTransforms + k * imageSize + x, width,
+     lineArgmins, 1,
+     transposed + k * imageSize + x * height, 1,
+     height, (T)loop->coeffY, (T)loop->offsetY,
+     from, base, which) ;
+    if (argmins) {
+      for (y = 0 ; y < height ; ++y) {
+        vl_uindex y_ = lineArgmins[y] ;
+        argmins[k * imageSize + x + y * width] =
+        transposedArgmins[k * imageSize + x * height + y_] + y_ * width ;
+      }
+    }
+  }
+}
+
+VL_EXPORT int
+VL_XCAT(vl_image_distance_transform_2d_,SFX)
+(T const * images,
+ vl_size numImages,
+ vl_size width,
+ vl_size height,
+ T * distanceTransforms,
+ vl_uindex * argmins,
+ T coeffX, T offsetX,
+ T coeffY, T offsetY)
+{
+  vl_size imageSize = width * height ;
+  vl_size numTasks ;
+  VlDistanceTransformLoop loop ;
+  int err ;
+
+  if (numImages == 0 || imageSize == 0) return VL_ERR_OK ;
+
+  memset (&loop, 0, sizeof(loop)) ;
+  numTasks = VL_MIN(vl_get_max_threads(), numImages * VL_MIN(width, height)) ;
+  loop.lineLength = VL_MAX(width, height) ;
+  loop.transposed = vl_malloc (sizeof(T) * imageSize * numImages) ;
+  if (argmins) {
+    loop.transposedArgmins = vl_malloc (sizeof(vl_uindex) * imageSize * numImages) ;
+  }
+  err = VL_XCAT(_vl_distance_transform_new_buffers_,SFX)(&loop, numTasks) ;
+  if (err == VL_ERR_OK &&
+      (loop.transposed == NULL || (argmins && loop.transposedArgmins == NULL))) {
+    err = vl_set_last_error(VL_ERR_ALLOC, NULL) ;
+  }
+
+  if (err == VL_ERR_OK) {
+    loop.image = images ;
+    loop.distanceTransform = distanceTransforms ;
+    loop.indexes = argmins ;
+    loop.numColumns = width ;
+    loop.numRows = height ;
+    loop.coeff = coeffX ;
+    loop.offset = offsetX ;
+    loop.coeffY = coeffY ;
+    loop.offsetY = offsetY ;
+
+    /* along the columns: image rows to transposed columns */
+    vl_parallel_for (numImages * height, numTasks,
+                     VL_XCAT(_vl_distance_transform_2d_columns_range_,SFX), &loop) ;
+
+    /* along the rows: transposed rows back to image columns */
+    vl_parallel_for (numImages * width, numTasks,
+                     VL_XCAT(_vl_distance_transform_2d_rows_range_,SFX), &loop) ;
+  }
 
-  vl_free (from) ;
-  vl_free (which) ;
-  vl_free (base) ;
-  vl_free (baseIndexes) ;
+  VL_XCAT(_vl_distance_transform_delete_buffers_,SFX)(&loop) ;
+  if (loop.transposed) vl_free (loop.transposed) ;
+  if (loop.transposedArgmins) vl_free (loop.transposedArgmins) ;
+  return err ;
 }
 
 /* VL_TYPE_FLOAT, VL_TYPE_DOUBLE */
@@ -81,7 +81,7 @@ void vl_imintegral_ui32 (vl_uint32 * integral,  vl_size integralStride,
 /** @name Distance transform */
 /** @{ */
 
-VL_EXPORT void
+VL_EXPORT int
 vl_image_distance_transform_d (double const * image,
                                vl_size numColumns,
                                vl_size numRows,
@@ -92,7 +92,7 @@ vl_image_distance_transform_d (double const * image,
                                double coeff,
                                double offset) ;
 
-VL_EXPORT void
+VL_EXPORT int
 vl_image_distance_transform_f (float const * image,
                                vl_size numColumns,
                                vl_size numRows,
@@ -103,6 +103,26 @@ vl_image_distance_transform_f (float const * image,
                                float coeff,
                                float offset) ;
 
+VL_EXPORT int
+vl_image_distance_transform_2d_d (double const * images,
+                                  vl_size numImages,
+                                  vl_size width,
+                                  vl_size height,
+                                  double * distanceTransforms,
+                                  vl_uindex * argmins,
+                                  double coeffX, double offsetX,
+                                  double coeffY, double offsetY) ;
+
+VL_EXPORT int
+vl_image_distance_transform_2d_f (float const * images,
+                                  vl_size numImages,
+                                  vl_size width,
+                                  vl_size height,
+                                  float * distanceTransforms,
+                                  vl_uindex * argmins,
+                                  float coeffX, float offsetX,
+                                  float coeffY, float offsetY) ;
+
 /** @} */
 
 /* ---------------------------------------------------------------- */
@@ -0,0 +1,1078 @@
+/** @file ivfpq.c
+ ** @brief Inverted file with product quantization - Definition
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+/**
+
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@page ivfpq Inverted file with product quantization
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+@ref ivfpq.h implements an approximate nearest neighbor index based
+on an inverted file and product quantization (IVF-PQ)
+@cite{jegou11product}. Differently from ::VlKDForest, the index does
+not retain the data; each vector is stored as a compact code of one
+byte per subquantizer, so that very large collections (hundreds of
+millions of descriptors) fit in memory.
+
+- @ref ivfpq-overview
+- @ref ivfpq-tech
+
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@section ivfpq-overview Overview
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+Create a ::VlIVFPQ object with ::vl_ivfpq_new, specifying the data
+dimension, the number of inverted lists and the number of
+subquantizers (which must divide the dimension). Train the quantizers
+on a representative sample with ::vl_ivfpq_build and index the data
+with ::vl_ivfpq_add (possibly in several calls). Vectors are numbered
+in the order they are added. Then use ::vl_ivfpq_search to find the
+approximate nearest neighbors of a set of queries;
+::vl_ivfpq_set_num_probes sets how many lists are visited for each
+query, trading accuracy for speed.
+
+The index can be stored to disk with ::vl_ivfpq_save and loaded back
+with ::vl_ivfpq_load.
+
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@section ivfpq-tech Technical details
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+<b>Quantizers.</b> A coarse quantizer with @f$ L @f$ centers @f$
+c_1,\dots,c_L @f$ is learned by ::vl_kmeans. Each vector @f$ x @f$
+is assigned to the list of its nearest center @f$ c(x) @f$ and the
+residual @f$ r = x - c(x) @f$ is split into @f$ M @f$ subvectors of
+dimension @f$ d/M @f$. A codebook of
+::VL_IVFPQ_NUM_SUBCENTERS centers is learned for each subvector
+position by running ::vl_kmeans on the training residuals, so that the
+residual is encoded by @f$ M @f$ bytes.
+
+<b>Search.</b> For each query @f$ y @f$ the function visits the lists
+of the nearest coarse centers. For a list with center @f$ c @f$, it
+computes a table of the squared distances between each subvector of
+@f$ y - c @f$ and each codebook center (asymmetric distance
+computation). The approximate squared distance to a vector in the list
+is then the sum of @f$ M @f$ entries of the table selected by its
+code. When the CPU supports AVX2, both the tables and the sums are
+computed eight entries at a time, the latter by gathering table
+entries. The codes in a list are stored in blocks of eight vectors,
+interleaved so that the @f$ m @f$-th bytes of the eight codes are
+contiguous. The SIMD and scalar code paths perform the same
+floating point operations and return the same result.
+
+Queries are processed in parallel (see @ref threads).
+**/
+
+#include "ivfpq.h"
+#include "ivfpq_avx2.h"
+#include "kmeans.h"
+#include "mathop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @internal @brief Number of vectors in a block of codes */
+#define VL_IVFPQ_BLOCK_SIZE 8
+
+/** @internal @brief Inverted list */
+typedef struct _VlIVFPQList
+{
+  vl_size numData ;             /**< Number of vectors in the list. */
+  vl_size numAllocated ;        /**< Allocated vectors (a multiple of the block size). */
+  vl_uint32 * ids ;             /**< Indexes of the vectors. */
+  vl_uint8 * codes ;            /**< Interleaved codes of the vectors. */
+} VlIVFPQList ;
+
+/** @internal @brief IVF-PQ index */
+struct _VlIVFPQ
+{
+  vl_size dimension ;           /**< Data dimension. */
+  vl_size numLists ;            /**< Number of inverted lists. */
+  vl_size numSubquantizers ;    /**< Number of subquantizers. */
+  vl_size subdimension ;        /**< Dimension of a subvector. */
+  vl_size numData ;             /**< Number of indexed vectors. */
+  vl_size numProbes ;           /**< Number of lists visited by a query. */
+  vl_size maxNumIterations ;    /**< Maximum number of k-means iterations. */
+  int verbosity ;               /**< Verbosity level. */
+
+  float * coarseCenters ;       /**< Coarse centers (or @c NULL if not built). */
+  float * coarseNorms ;         /**< Squared norms of the coarse centers. */
+  float * codebooks ;           /**< Subquantizer centers, as [m][d][k]. */
+  VlIVFPQList * lists ;         /**< Inverted lists. */
+} ;
+
+/* ---------------------------------------------------------------- */
+/*                                                  Scalar kernels  */
+/* ---------------------------------------------------------------- */
+
+/** @internal
+ ** @brief Compute the distance table of a residual
+ ** @param table distances (output, ::VL_IVFPQ_NUM_SUBCENTERS by @a numSubquantizers).
+ ** @param residual residual vector.
+ ** @param codebooks subquantizer centers.
+ ** @param numSubquantizers number of subquantizers.
+ ** @param subdimension subvector dimension.
+ **/
+
+static void
+_vl_ivfpq_compute_table (float * table,
+                         float const * residual,
+                         float const * codebooks,
+                         vl_size numSubquantizers,
+                         vl_size subdimension)
+{
+  vl_uindex m, d, k ;
+  for (m = 0 ; m < numSubquantizers ; ++m) {
+    float * t = table + m * VL_IVFPQ_NUM_SUBCENTERS ;
+    float const * r = residual + m * subdimension ;
+    float const * c = codebooks + m * subdimension * VL_IVFPQ_NUM_SUBCENTERS ;
+    for (k = 0 ; k < VL_IVFPQ_NUM_SUBCENTERS ; ++k) t[k] = 0 ;
+    for (d = 0 ; d < subdimension ; ++d) {
+      for (k = 0 ; k < VL_IVFPQ_NUM_SUBCENTERS ; ++k) {
+        float delta = r[d] - c[d * VL_IVFPQ_NUM_SUBCENTERS + k] ;
+        t[k] += delta * delta ;
+      }
+    }
+  }
+}
+
+/** @internal
+ ** @brief Sum the distance table entries of blocks of codes
+ ** @param distances distances (output, @a numBlocks times ::VL_IVFPQ_BLOCK_SIZE).
+ ** @param codes interleaved codes.
+ ** @param numBlocks number of blocks of codes.
+ ** @param table distance table.
+ ** @param numSubquantizers number of subquantizers.
+ **/
+
+static void
+_vl_ivfpq_scan (float * distances,
+                vl_uint8 const * codes,
+                vl_size numBlocks,
+                float const * table,
+                vl_size numSubquantizers)
+{
+  vl_uindex b, m, v ;
+  for (b = 0 ; b < numBlocks ; ++b) {
+    float acc [VL_IVFPQ_BLOCK_SIZE] = {0} ;
+    for (m = 0 ; m < numSubquantizers ; ++m) {
+      float const * t = table + m * VL_IVFPQ_NUM_SUBCENTERS ;
+      for (v = 0 ; v < VL_IVFPQ_BLOCK_SIZE ; ++v) acc[v] += t[codes[v]] ;
+      codes += VL_IVFPQ_BLOCK_SIZE ;
+    }
+    for (v = 0 ; v < VL_IVFPQ_BLOCK_SIZE ; ++v) distances[v] = acc[v] ;
+    distances += VL_IVFPQ_BLOCK_SIZE ;
+  }
+}
+
+typedef void (*_VlIVFPQTableFunction) (float*, float const*, float const*, vl_size, vl_size) ;
+typedef void (*_VlIVFPQScanFunction) (float*, vl_uint8 const*, vl_size, float const*, vl_size) ;
+
+static _VlIVFPQTableFunction
+_vl_ivfpq_get_table_function (void)
+{
+#ifndef VL_DISABLE_AVX
+  if (vl_cpu_has_avx2() && vl_get_simd_enabled()) {
+    return _vl_ivfpq_compute_table_avx2 ;
+  }
+#endif
+  return _vl_ivfpq_compute_table ;
+}
+
+static _VlIVFPQScanFunction
+_vl_ivfpq_get_scan_function (void)
+{
+#ifndef VL_DISABLE_AVX
+  if (vl_cpu_has_avx2() && vl_get_simd_enabled()) {
+    return _vl_ivfpq_scan_avx2 ;
+  }
+#endif
+  return _vl_ivfpq_scan ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                          Create and destroy      */
+/* ---------------------------------------------------------------- */
+
+/** @brief Create a new IVF-PQ index
+ ** @param dimension data dimension.
+ ** @param numLists number of inverted lists (coarse centers).
+ ** @param numSubquantizers number of subquantizers (bytes per code).
+ ** @return new index or @c NULL if out of memory.
+ **
+ ** @a numSubquantizers must divide @a dimension. The index must be
+ ** trained with ::vl_ivfpq_build before adding data.
+ **/
+
+VlIVFPQ *
+vl_ivfpq_new (vl_size dimension,
+              vl_size numLists,
+              vl_size numSubquantizers)
+{
+  VlIVFPQ * self ;
+
+  assert (dimension >= 1) ;
+  assert (numLists >= 1) ;
+  assert (numSubquantizers >= 1) ;
+  assert (dimension % numSubquantizers == 0) ;
+  assert (numLists <= ((vl_size)1 << 31)) ;
+
+  self = vl_calloc (sizeof(VlIVFPQ), 1) ;
+  if (self == NULL) goto alloc_error ;
+  self->lists = vl_calloc (sizeof(VlIVFPQList), numLists) ;
+  if (self->lists == NULL) goto alloc_error ;
+  self->dimension = dimension ;
+  self->numLists = numLists ;
+  self->numSubquantizers = numSubquantizers ;
+  self->subdimension = dimension / numSubquantizers ;
+  self->numProbes = VL_MIN(numLists, 8) ;
+  self->maxNumIterations = 25 ;
+  return self ;
+
+alloc_error:
+  if (self) vl_free (self) ;
+  vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the IVF-PQ index.") ;
+  return NULL ;
+}
+
+/** @brief Delete an IVF-PQ index
+ ** @param self index.
+ **/
+
+void
+vl_ivfpq_delete (VlIVFPQ * self)
+{
+  vl_uindex l ;
+  if (self->lists) {
+    for (l = 0 ; l < self->numLists ; ++l) {
+      if (self->lists[l].ids) vl_free (self->lists[l].ids) ;
+      if (self->lists[l].codes) vl_free (self->lists[l].codes) ;
+    }
+    vl_free (self->lists) ;
+  }
+  if (self->coarseCenters) vl_free (self->coarseCenters) ;
+  if (self->coarseNorms) vl_free (self->coarseNorms) ;
+  if (self->codebooks) vl_free (self->codebooks) ;
+  vl_free (self) ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                               Build and search   */
+/* ---------------------------------------------------------------- */
+
+static void
+_vl_ivfpq_update_coarse_norms (VlIVFPQ * self)
+{
+  vl_uindex l, d ;
+  for (l = 0 ; l < self->numLists ; ++l) {
+    float const * c = self->coarseCenters + l * self->dimension ;
+    float acc = 0 ;
+    for (d = 0 ; d < self->dimension ; ++d) acc += c[d] * c[d] ;
+    self->coarseNorms[l] = acc ;
+  }
+}
+
+/** @internal @brief Discard the quantizers of an IVF-PQ index
+ ** @param self index.
+ **/
+
+static void
+_vl_ivfpq_reset_quantizers (VlIVFPQ * self)
+{
+  if (self->coarseCenters) vl_free (self->coarseCenters) ;
+  if (self->coarseNorms) vl_free (self->coarseNorms) ;
+  if (self->codebooks) vl_free (self->codebooks) ;
+  self->coarseCenters = NULL ;
+  self->coarseNorms = NULL ;
+  self->codebooks = NULL ;
+}
+
+/** @brief Train the quantizers of an IVF-PQ index
+ ** @param self index.
+ ** @param data training vectors.
+ ** @param numData number of training vectors.
+ ** @return error code.
+ **
+ ** The function learns the coarse quantizer and the subquantizer
+ ** codebooks by k-means. @a numData must be at least as large as the
+ ** number of lists and as ::VL_IVFPQ_NUM_SUBCENTERS. The training
+ ** data is not added to the index (use ::vl_ivfpq_add) and any data
+ ** previously added is discarded.
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory, in which case the index is left untrained.
+ **/
+
+int
+vl_ivfpq_build (VlIVFPQ * self,
+                float const * data,
+                vl_size numData)
+{
+  vl_size dimension = self->dimension ;
+  vl_size subdimension = self->subdimension ;
+  vl_uint32 * assignments = NULL ;
+  float * residuals = NULL ;
+  float * subdata = NULL ;
+  VlKMeans * kmeans = NULL ;
+  float const * centers ;
+  vl_uindex i, l, m, d, k ;
+
+  assert (numData >= self->numLists) ;
+  assert (numData >= VL_IVFPQ_NUM_SUBCENTERS) ;
+
+  for (l = 0 ; l < self->numLists ; ++l) {
+    VlIVFPQList * list = self->lists + l ;
+    if (list->ids) vl_free (list->ids) ;
+    if (list->codes) vl_free (list->codes) ;
+    memset (list, 0, sizeof(VlIVFPQList)) ;
+  }
+  self->numData = 0 ;
+
+  if (self->coarseCenters == NULL) {
+    self->coarseCenters = vl_malloc (sizeof(float) * dimension * self->numLists) ;
+  }
+  if (self->coarseNorms == NULL) {
+    self->coarseNorms = vl_malloc (sizeof(float) * self->numLists) ;
+  }
+  if (self->codebooks == NULL) {
+    self->codebooks = vl_malloc (sizeof(float) * dimension * VL_IVFPQ_NUM_SUBCENTERS) ;
+  }
+  assignments = vl_malloc (sizeof(vl_uint32) * numData) ;
+  residuals = vl_malloc (sizeof(float) * dimension * numData) ;
+  subdata = vl_malloc (sizeof(float) * subdimension * numData) ;
+  if (self->coarseCenters == NULL || self->coarseNorms == NULL ||
+      self->codebooks == NULL || assignments == NULL ||
+      residuals == NULL || subdata == NULL) {
+    goto alloc_error ;
+  }
+
+  /* coarse quantizer */
+  kmeans = vl_kmeans_new (VL_TYPE_FLOAT, VlDistanceL2) ;
+  if (kmeans == NULL) goto alloc_error ;
+  vl_kmeans_set_algorithm (kmeans, VlKMeansLloyd) ;
+  vl_kmeans_set_initialization (kmeans, VlKMeansRandomSelection) ;
+  vl_kmeans_set_max_num_iterations (kmeans, self->maxNumIterations) ;
+  vl_kmeans_set_verbosity (kmeans, self->verbosity > 1 ? self->verbosity - 1 : 0) ;
+  if (self->verbosity) {
+    VL_PRINTF("ivfpq: training %d coarse centers on %d vectors\n",
+              (int)self->numLists, (int)numData) ;
+  }
+  vl_kmeans_cluster (kmeans, data, dimension, numData, self->numLists) ;
+  centers = vl_kmeans_get_centers (kmeans) ;
+  if (centers == NULL) goto alloc_error ;
+  memcpy (self->coarseCenters, centers, sizeof(float) * dimension * self->numLists) ;
+  _vl_ivfpq_update_coarse_norms (self) ;
+  vl_kmeans_delete (kmeans) ;
+  kmeans = NULL ;
+
+  /* residuals */
+  if (vl_eval_l2_nearest_neighbors_f (assignments, NULL, 1, dimension,
+                                      data, numData,
+                                      self->coarseCenters, self->numLists,
+                                      self->coarseNorms) != VL_ERR_OK) {
+    goto alloc_error ;
+  }
+  for (i = 0 ; i < numData ; ++i) {
+    float const * c = self->coarseCenters + assignments[i] * dimension ;
+    for (d = 0 ; d < dimension ; ++d) {
+      residuals[i * dimension + d] = data[i * dimension + d] - c[d] ;
+    }
+  }
+
+  /* subquantizers */
+  for (m = 0 ; m < self->numSubquantizers ; ++m) {
+    float * codebook = self->codebooks + m * subdimension * VL_IVFPQ_NUM_SUBCENTERS ;
+    if (self->verbosity) {
+      VL_PRINTF("ivfpq: training subquantizer %d of %d\n",
+                (int)m + 1, (int)self->numSubquantizers) ;
+    }
+    for (i = 0 ; i < numData ; ++i) {
+      memcpy (subdata + i * subdimension,
+              residuals + i * dimension + m * subdimension,
+              sizeof(float) * subdimension) ;
+    }
+    kmeans = vl_kmeans_new (VL_TYPE_FLOAT, VlDistanceL2) ;
+    if (kmeans == NULL) goto alloc_error ;
+    vl_kmeans_set_algorithm (kmeans, VlKMeansLloyd) ;
+    vl_kmeans_set_initialization (kmeans, VlKMeansRandomSelection) ;
+    vl_kmeans_set_max_num_iterations (kmeans, self->maxNumIterations) ;
+    vl_kmeans_set_verbosity (kmeans, self->verbosity > 1 ? self->verbosity - 1 : 0) ;
+    vl_kmeans_cluster (kmeans, subdata, subdimension, numData, VL_IVFPQ_NUM_SUBCENTERS) ;
+    centers = vl_kmeans_get_centers (kmeans) ;
+    if (centers == NULL) goto alloc_error ;
+    /* transpose to [d][k] so that the tables vectorize across centers */
+    for (k = 0 ; k < VL_IVFPQ_NUM_SUBCENTERS ; ++k) {
+      for (d = 0 ; d < subdimension ; ++d) {
+        codebook[d * VL_IVFPQ_NUM_SUBCENTERS + k] = centers[k * subdimension + d] ;
+      }
+    }
+    vl_kmeans_delete (kmeans) ;
+    kmeans = NULL ;
+  }
+  vl_free (subdata) ;
+  vl_free (residuals) ;
+  vl_free (assignments) ;
+  return VL_ERR_OK ;
+
+alloc_error:
+  if (kmeans) vl_kmeans_delete (kmeans) ;
+  if (subdata) vl_free (subdata) ;
+  if (residuals) vl_free (residuals) ;
+  if (assignments) vl_free (assignments) ;
+  _vl_ivfpq_reset_quantizers (self) ;
+  return vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the IVF-PQ quantizers.") ;
+}
+
+/** @internal @brief Data of the parallel loops of ::vl_ivfpq_add and ::vl_ivfpq_search */
+typedef struct _VlIVFPQLoop
+{
+  VlIVFPQ const * self ;
+  _VlIVFPQTableFunction computeTable ;
+  _VlIVFPQScanFunction scan ;
+  float const * data ;          /**< Vectors to encode or queries. */
+  vl_uint32 const * assignments ; /**< Coarse centers of the vectors or lists probed by the queries. */
+  vl_uint8 * codes ;
+  vl_uint32 * indexes ;
+  float * distances ;
+  vl_size numNeighbors ;
+  vl_size numProbes ;
+  vl_size maxNumAllocated ;
+  float * residuals ;           /**< Residual of each task. */
+  float * tables ;              /**< Distance table of each task. */
+  float * scores ;              /**< Scores of a list for each task. */
+  float * bestDistances ;       /**< Candidate distances of each task. */
+} VlIVFPQLoop ;
+
+/** @internal
+ ** @brief Encode a range of vectors
+ ** @param loop_ loop data (::VlIVFPQLoop).
+ ** @param task task index.
+ ** @param begin first vector.
+ ** @param end vector following the last one.
+ **/
+
+static void
+_vl_ivfpq_encode_range (void * loop_, vl_uindex task,
+                        vl_uindex begin, vl_uindex end)
+{
+  VlIVFPQLoop const * loop = loop_ ;
+  VlIVFPQ const * self = loop->self ;
+  vl_size dimension = self->dimension ;
+  vl_size numSubquantizers = self->numSubquantizers ;
+  float * residual = loop->residuals + dimension * task ;
+  float * table = loop->tables + VL_IVFPQ_NUM_SUBCENTERS * numSubquantizers * task ;
+  vl_uindex i ;
+
+  for (i = begin ; i < end ; ++i) {
+    float const * c = self->coarseCenters + loop->assignments[i] * dimension ;
+    vl_uindex d, m, k ;
+    for (d = 0 ; d < dimension ; ++d) residual[d] = loop->data[i * dimension + d] - c[d] ;
+    loop->computeTable (table, residual, self->codebooks, numSubquantizers, self->subdimension) ;
+    for (m = 0 ; m < numSubquantizers ; ++m) {
+      float const * t = table + m * VL_IVFPQ_NUM_SUBCENTERS ;
+      vl_uindex best = 0 ;
+      for (k = 1 ; k < VL_IVFPQ_NUM_SUBCENTERS ; ++k) {
+        if (t[k] < t[best]) best = k ;
+      }
+      loop->codes[i * numSubquantizers + m] = (vl_uint8) best ;
+    }
+  }
+}
+
+/** @brief Add vectors to an IVF-PQ index
+ ** @param self index.
+ ** @param data vectors to add.
+ ** @param numData number of vectors.
+ ** @return error code.
+ **
+ ** The vectors are assigned the indexes ::vl_ivfpq_get_num_data,
+ ** ::vl_ivfpq_get_num_data + 1, and so on. The index must have been
+ ** trained by ::vl_ivfpq_build.
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory, in which case no vector is added.
+ **/
+
+int
+vl_ivfpq_add (VlIVFPQ * self,
+              float const * data,
+              vl_size numData)
+{
+  vl_size dimension = self->dimension ;
+  vl_size numSubquantizers = self->numSubquantizers ;
+  vl_size blockBytes = VL_IVFPQ_BLOCK_SIZE * numSubquantizers ;
+  VlIVFPQLoop loop ;
+  vl_size numTasks ;
+  vl_uint32 * assignments ;
+  vl_uint8 * codes ;
+  vl_uindex i ;
+
+  assert (self->coarseCenters) ;
+  assert (self->numData + numData <= ((vl_size)1 << 32)) ;
+
+  if (numData == 0) return VL_ERR_OK ;
+
+  numTasks = VL_MIN(vl_get_max_threads(), numData) ;
+  assignments = vl_malloc (sizeof(vl_uint32) * numData) ;
+  codes = vl_malloc (sizeof(vl_uint8) * numSubquantizers * numData) ;
+  loop.residuals = vl_malloc (sizeof(float) * dimension * numTasks) ;
+  loop.tables = vl_malloc (sizeof(float) * VL_IVFPQ_NUM_SUBCENTERS * numSubquantizers * numTasks) ;
+  if (assignments == NULL || codes == NULL ||
+      loop.residuals == NULL || loop.tables == NULL ||
+      vl_eval_l2_nearest_neighbors_f (assignments, NULL, 1, dimension,
+                                      data, numData,
+                                      self->coarseCenters, self->numLists,
+                                      self->coarseNorms) != VL_ERR_OK) {
+    i = 0 ;
+    goto alloc_error ;
+  }
+
+  /* encode the residuals */
+  loop.self = self ;
+  loop.computeTable = _vl_ivfpq_get_table_function () ;
+  loop.data = data ;
+  loop.assignments = assignments ;
+  loop.codes = codes ;
+  vl_parallel_for (numData, numTasks, _vl_ivfpq_encode_range, &loop) ;
+
+  /* append to the lists */
+  for (i = 0 ; i < numData ; ++i) {
+    VlIVFPQList * list = self->lists + assignments[i] ;
+    vl_uindex block, offset, m ;
+    if (list->numData == list->numAllocated) {
+      vl_size numAllocated = VL_MAX(VL_IVFPQ_BLOCK_SIZE, 2 * list->numAllocated) ;
+      vl_uint32 * ids = vl_realloc (list->ids, sizeof(vl_uint32) * numAllocated) ;
+      vl_uint8 * listCodes ;
+      if (ids == NULL) goto alloc_error ;
+      list->ids = ids ;
+      listCodes = vl_realloc (list->codes, blockBytes * (numAllocated / VL_IVFPQ_BLOCK_SIZE)) ;
+      if (listCodes == NULL) goto alloc_error ;
+      list->codes = listCodes ;
+      memset (list->codes + blockBytes * (list->numAllocated / VL_IVFPQ_BLOCK_SIZE), 0,
+              blockBytes * ((numAllocated - list->numAllocated) / VL_IVFPQ_BLOCK_SIZE)) ;
+      list->numAllocated = numAllocated ;
+    }
+    block = list->numData / VL_IVFPQ_BLOCK_SIZE ;
+    offset = list->numData % VL_IVFPQ_BLOCK_SIZE ;
+    for (m = 0 ; m < numSubquantizers ; ++m) {
+      list->codes[block * blockBytes + m * VL_IVFPQ_BLOCK_SIZE + offset] =
+        codes[i * numSubquantizers + m] ;
+    }
+    list->ids[list->numData++] = (vl_uint32) (self->numData + i) ;
+  }
+  self->numData += numData ;
+
+  vl_free (loop.residuals) ;
+  vl_free (loop.tables) ;
+  vl_free (assignments) ;
+  vl_free (codes) ;
+  return VL_ERR_OK ;
+
+alloc_error:
+  /* remove the i vectors appended so far */
+  while (i > 0) {
+    -- i ;
+    self->lists[assignments[i]].numData -- ;
+  }
+  if (loop.residuals) vl_free (loop.residuals) ;
+  if (loop.tables) vl_free (loop.tables) ;
+  if (assignments) vl_free (assignments) ;
+  if (codes) vl_free (codes) ;
+  return vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the IVF-PQ lists.") ;
+}
+
+/** @internal
+ ** @brief Search a range of queries
+ ** @param loop_ loop data (::VlIVFPQLoop).
+ ** @param task task index.
+ ** @param begin first query.
+ ** @param end query following the last one.
+ **/
+
+static void
+_vl_ivfpq_search_range (void * loop_, vl_uindex task,
+                        vl_uindex begin, vl_uindex end)
+{
+  VlIVFPQLoop const * loop = loop_ ;
+  VlIVFPQ const * self = loop->self ;
+  vl_size dimension = self->dimension ;
+  vl_size numSubquantizers = self->numSubquantizers ;
+  vl_size numNeighbors = loop->numNeighbors ;
+  vl_size numProbes = loop->numProbes ;
+  float * residual = loop->residuals + dimension * task ;
+  float * table = loop->tables + VL_IVFPQ_NUM_SUBCENTERS * numSubquantizers * task ;
+  float * scores = loop->scores + VL_MAX(loop->maxNumAllocated, 1) * task ;
+  float * bestDistances = loop->bestDistances + numNeighbors * task ;
+  vl_uindex q ;
+
+  for (q = begin ; q < end ; ++q) {
+    float const * query = loop->data + q * dimension ;
+    vl_uint32 * bestIndexes = loop->indexes + q * numNeighbors ;
+    vl_uindex p, d, i, j ;
+    vl_size numFound = 0 ;
+
+    for (p = 0 ; p < numProbes ; ++p) {
+      VlIVFPQList const * list = self->lists + loop->assignments[q * numProbes + p] ;
+      float const * c = self->coarseCenters + loop->assignments[q * numProbes + p] * dimension ;
+      if (list->numData == 0) continue ;
+      for (d = 0 ; d < dimension ; ++d) residual[d] = query[d] - c[d] ;
+      loop->computeTable (table, residual, self->codebooks, numSubquantizers, self->subdimension) ;
+      loop->scan (scores, list->codes,
+                  (list->numData + VL_IVFPQ_BLOCK_SIZE - 1) / VL_IVFPQ_BLOCK_SIZE,
+                  table, numSubquantizers) ;
+
+      /* keep the best candidates by sorted insertion */
+      for (i = 0 ; i < list->numData ; ++i) {
+        float score = scores[i] ;
+        if (numFound == numNeighbors && score >= bestDistances[numNeighbors - 1]) continue ;
+        j = (numFound < numNeighbors) ? numFound++ : numNeighbors - 1 ;
+        while (j > 0 && bestDistances[j - 1] > score) {
+          bestDistances[j] = bestDistances[j - 1] ;
+          bestIndexes[j] = bestIndexes[j - 1] ;
+          -- j ;
+        }
+        bestDistances[j] = score ;
+        bestIndexes[j] = list->ids[i] ;
+      }
+    }
+    for (i = numFound ; i < numNeighbors ; ++i) {
+      bestDistances[i] = VL_INFINITY_F ;
+      bestIndexes[i] = 0xffffffff ;
+    }
+    if (loop->distances) {
+      memcpy (loop->distances + q * numNeighbors, bestDistances, sizeof(float) * numNeighbors) ;
+    }
+  }
+}
+
+/** @brief Search an IVF-PQ index
+ ** @param self index.
+ ** @param indexes indexes of the neighbors (output).
+ ** @param distances approximate squared distances of the neighbors (output, may be @c NULL).
+ ** @param numNeighbors number of neighbors to find for each query.
+ ** @param queries query vectors.
+ ** @param numQueries number of queries.
+ **
+ ** For each query, the function visits ::vl_ivfpq_get_num_probes lists
+ ** and returns the @a numNeighbors vectors with the smallest
+ ** approximate distance, sorted by increasing distance, in the
+ ** corresponding column of the @a numNeighbors by @a numQueries
+ ** matrices @a indexes and @a distances. If fewer than
+ ** @a numNeighbors vectors are found, the remaining entries are set
+ ** to index @c 0xffffffff and distance ::VL_INFINITY_F.
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** its working memory could not be allocated, in which case the
+ ** content of @a indexes and @a distances is undefined, and
+ ** ::VL_ERR_OK otherwise.
+ **/
+
+int
+vl_ivfpq_search (VlIVFPQ const * self,
+                 vl_uint32 * indexes,
+                 float * distances,
+                 vl_size numNeighbors,
+                 float const * queries,
+                 vl_size numQueries)
+{
+  vl_size dimension = self->dimension ;
+  vl_size numSubquantizers = self->numSubquantizers ;
+  vl_size numProbes = VL_MIN(self->numProbes, self->numLists) ;
+  vl_size maxNumAllocated = 0 ;
+  VlIVFPQLoop loop ;
+  vl_size numTasks ;
+  vl_uint32 * probes ;
+  vl_uindex l ;
+  int error = VL_ERR_OK ;
+
+  assert (self->coarseCenters) ;
+  assert (numNeighbors >= 1) ;
+
+  if (numQueries == 0) return VL_ERR_OK ;
+
+  for (l = 0 ; l < self->numLists ; ++l) {
+    maxNumAllocated = VL_MAX(maxNumAllocated, self->lists[l].numAllocated) ;
+  }
+
+  numTasks = VL_MIN(vl_get_max_threads(), numQueries) ;
+  probes = vl_malloc (sizeof(vl_uint32) * numProbes * numQueries) ;
+  loop.residuals = vl_malloc (sizeof(float) * dimension * numTasks) ;
+  loop.tables = vl_malloc (sizeof(float) * VL_IVFPQ_NUM_SUBCENTERS * numSubquantizers * numTasks) ;
+  loop.scores = vl_malloc (sizeof(float) * VL_MAX(maxNumAllocated, 1) * numTasks) ;
+  loop.bestDistances = vl_malloc (sizeof(float) * numNeighbors * numTasks) ;
+  if (probes == NULL || loop.residuals == NULL || loop.tables == NULL ||
+      loop.scores == NULL || loop.bestDistances == NULL ||
+      vl_eval_l2_nearest_neighbors_f (probes, NULL, numProbes, dimension,
+                                      queries, numQueries,
+                                      self->coarseCenters, self->numLists,
+                                      self->coarseNorms) != VL_ERR_OK) {
+    error = vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the IVF-PQ search buffers.") ;
+  } else {
+    loop.self = self ;
+    loop.computeTable = _vl_ivfpq_get_table_function () ;
+    loop.scan = _vl_ivfpq_get_scan_function () ;
+    loop.data = queries ;
+    loop.assignments = probes ;
+    loop.indexes = indexes ;
+    loop.distances = distances ;
+    loop.numNeighbors = numNeighbors ;
+    loop.numProbes = numProbes ;
+    loop.maxNumAllocated = maxNumAllocated ;
+    vl_parallel_for (numQueries, numTasks, _vl_ivfpq_search_range, &loop) ;
+  }
+  if (loop.residuals) vl_free (loop.residuals) ;
+  if (loop.tables) vl_free (loop.tables) ;
+  if (loop.scores) vl_free (loop.scores) ;
+  if (loop.bestDistances) vl_free (loop.bestDistances) ;
+  if (probes) vl_free (probes) ;
+  return error ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                                  Save and load   */
+/* ---------------------------------------------------------------- */
+
+static char const _vl_ivfpq_magic [8] = {'V','L','I','V','F','P','Q','1'} ;
+
+/** @internal @brief Check an IVF-PQ file header
+ ** @param header header words read from the file.
+ ** @return @c VL_TRUE if the header describes a valid index.
+ **
+ ** Besides checking that the parameters are consistent, the function
+ ** rejects any header for which the buffers allocated by ::vl_ivfpq_load
+ ** would overflow ::vl_size.
+ **/
+
+static vl_bool
+_vl_ivfpq_check_header (vl_uint64 const * header)
+{
+  vl_uint64 const maxSize = (vl_size)-1 ;
+  vl_uint64 dimension = header[0] ;
+  vl_uint64 numLists = header[1] ;
+  vl_uint64 numSubquantizers = header[2] ;
+  vl_uint64 numData = header[3] ;
+  vl_uint64 maxNumAllocated ;
+
+  if (dimension == 0 || numLists == 0 || numSubquantizers == 0 ||
+      dimension % numSubquantizers != 0 ||
+      numLists > ((vl_uint64)1 << 31) ||
+      numData > ((vl_uint64)1 << 32) ||
+      header[4] == 0) {
+    return VL_FALSE ;
+  }
+
+  /* coarse centers, codebooks and list descriptors */
+  if (numLists > maxSize / sizeof(VlIVFPQList) ||
+      dimension > maxSize / sizeof(float) / VL_MAX(numLists, VL_IVFPQ_NUM_SUBCENTERS)) {
+    return VL_FALSE ;
+  }
+
+  /* list ids and codes (a list holds at most numData entries) */
+  maxNumAllocated = (numData + VL_IVFPQ_BLOCK_SIZE - 1) / VL_IVFPQ_BLOCK_SIZE * VL_IVFPQ_BLOCK_SIZE ;
+  if (maxNumAllocated > maxSize / sizeof(vl_uint32) ||
+      (maxNumAllocated > 0 && numSubquantizers > maxSize / maxNumAllocated)) {
+    return VL_FALSE ;
+  }
+  return VL_TRUE ;
+}
+
+/** @brief Save an IVF-PQ index to a file
+ ** @param self index.
+ ** @param fileName file name.
+ ** @return error code.
+ **
+ ** The index is stored in a binary file in the native byte order.
+ ** The function returns ::VL_ERR_OK on success and ::VL_ERR_IO
+ ** otherwise (see ::vl_get_last_error_message).
+ **/
+
+int
+vl_ivfpq_save (VlIVFPQ const * self, char const * fileName)
+{
+  vl_size blockBytes = VL_IVFPQ_BLOCK_SIZE * self->numSubquantizers ;
+  vl_uint64 header [6] ;
+  vl_bool ok ;
+  vl_uindex l ;
+  FILE * f ;
+
+  assert (self->coarseCenters) ;
+
+  f = fopen (fileName, "wb") ;
+  if (f == NULL) {
+    return vl_set_last_error (VL_ERR_IO, "Could not open '%s' for writing.", fileName) ;
+  }
+
+  header[0] = self->dimension ;
+  header[1] = self->numLists ;
+  header[2] = self->numSubquantizers ;
+  header[3] = self->numData ;
+  header[4] = self->numProbes ;
+  header[5] = self->maxNumIterations ;
+
+  ok =
+    fwrite (_vl_ivfpq_magic, sizeof(_vl_ivfpq_magic), 1, f) == 1 &&
+    fwrite (header, sizeof(header), 1, f) == 1 &&
+    fwrite (self->coarseCenters, sizeof(float) * self->dimension, self->numLists, f) == self->numLists &&
+    fwrite (self->codebooks, sizeof(float) * self->dimension, VL_IVFPQ_NUM_SUBCENTERS, f) == VL_IVFPQ_NUM_SUBCENTERS ;
+
+  for (l = 0 ; ok && l < self->numLists ; ++l) {
+    VlIVFPQList const * list = self->lists + l ;
+    vl_uint64 numData = list->numData ;
+    vl_size numBlocks = (list->numData + VL_IVFPQ_BLOCK_SIZE - 1) / VL_IVFPQ_BLOCK_SIZE ;
+    ok =
+      fwrite (&numData, sizeof(numData), 1, f) == 1 &&
+      fwrite (list->ids, sizeof(vl_uint32), list->numData, f) == list->numData &&
+      fwrite (list->codes, blockBytes, numBlocks, f) == numBlocks ;
+  }
+
+  if (fclose (f) != 0) ok = VL_FALSE ;
+  if (! ok) {
+    return vl_set_last_error (VL_ERR_IO, "Error writing '%s'.", fileName) ;
+  }
+  return VL_ERR_OK ;
+}
+
+/** @brief Load an IVF-PQ index from a file
+ ** @param fileName file name.
+ ** @return new index or @c NULL on error.
+ **
+ ** The file must have been written by ::vl_ivfpq_save. On failure
+ ** the function returns @c NULL and sets the last error
+ ** (see ::vl_get_last_error_message).
+ **/
+
+VlIVFPQ *
+vl_ivfpq_load (char const * fileName)
+{
+  VlIVFPQ * self ;
+  char magic [sizeof(_vl_ivfpq_magic)] ;
+  vl_uint64 header [6] ;
+  vl_size blockBytes ;
+  vl_uindex l ;
+  vl_size numData = 0 ;
+  vl_bool ok ;
+  FILE * f ;
+
+  f = fopen (fileName, "rb") ;
+  if (f == NULL) {
+    vl_set_last_error (VL_ERR_IO, "Could not open '%s' for reading.", fileName) ;
+    return NULL ;
+  }
+
+  if (fread (magic, sizeof(magic), 1, f) != 1 ||
+      memcmp (magic, _vl_ivfpq_magic, sizeof(magic)) ||
+      fread (header, sizeof(header), 1, f) != 1 ||
+      ! _vl_ivfpq_check_header (header)) {
+    fclose (f) ;
+    vl_set_last_error (VL_ERR_BAD_ARG, "'%s' is not an IVF-PQ index file.", fileName) ;
+    return NULL ;
+  }
+
+  self = vl_ivfpq_new ((vl_size)header[0], (vl_size)header[1], (vl_size)header[2]) ;
+  if (self == NULL) {
+    fclose (f) ;
+    return NULL ;
+  }
+  self->numProbes = (vl_size)header[4] ;
+  self->maxNumIterations = (vl_size)header[5] ;
+  self->coarseCenters = vl_malloc (sizeof(float) * self->dimension * self->numLists) ;
+  self->coarseNorms = vl_malloc (sizeof(float) * self->numLists) ;
+  self->codebooks = vl_malloc (sizeof(float) * self->dimension * VL_IVFPQ_NUM_SUBCENTERS) ;
+  blockBytes = VL_IVFPQ_BLOCK_SIZE * self->numSubquantizers ;
+
+  if (self->coarseCenters == NULL || self->coarseNorms == NULL ||
+      self->codebooks == NULL) {
+    fclose (f) ;
+    vl_ivfpq_delete (self) ;
+    vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the IVF-PQ index.") ;
+    return NULL ;
+  }
+
+  ok =
+    fread (self->coarseCenters, sizeof(float) * self->dimension, self->numLists, f) == self->numLists &&
+    fread (self->codebooks, sizeof(float) * self->dimension, VL_IVFPQ_NUM_SUBCENTERS, f) == VL_IVFPQ_NUM_SUBCENTERS ;
+
+  for (l = 0 ; ok && l < self->numLists ; ++l) {
+    VlIVFPQList * list = self->lists + l ;
+    vl_uint64 listSize ;
+    vl_size numBlocks ;
+    if (fread (&listSize, sizeof(listSize), 1, f) != 1 || listSize > header[3]) {
+      ok = VL_FALSE ;
+      break ;
+    }
+    if (listSize == 0) continue ;
+    numBlocks = ((vl_size)listSize + VL_IVFPQ_BLOCK_SIZE - 1) / VL_IVFPQ_BLOCK_SIZE ;
+    list->numData = (vl_size)listSize ;
+    list->numAllocated = numBlocks * VL_IVFPQ_BLOCK_SIZE ;
+    list->ids = vl_malloc (sizeof(vl_uint32) * list->numAllocated) ;
+    list->codes = vl_malloc (blockBytes * numBlocks) ;
+    if (list->ids == NULL || list->codes == NULL) {
+      fclose (f) ;
+      vl_ivfpq_delete (self) ;
+      vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the IVF-PQ index.") ;
+      return NULL ;
+    }
+    ok =
+      fread (list->ids, sizeof(vl_uint32), list->numData, f) == list->numData &&
+      fread (list->codes, blockBytes, numBlocks, f) == numBlocks ;
+    numData += list->numData ;
+  }
+  fclose (f) ;
+
+  if (! ok || numData != header[3]) {
+    vl_ivfpq_delete (self) ;
+    vl_set_last_error (VL_ERR_IO, "Error reading '%s'.", fileName) ;
+    return NULL ;
+  }
+  self->numData = numData ;
+  _vl_ivfpq_update_coarse_norms (self) ;
+  return self ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                  Retrieve data and parameters   */
+/* ---------------------------------------------------------------- */
+
+/** @brief Get the data dimension
+ ** @param self index.
+ ** @return data dimension.
+ **/
+
+vl_size
+vl_ivfpq_get_dimension (VlIVFPQ const * self)
+{
+  return self->dimension ;
+}
+
+/** @brief Get the number of inverted lists
+ ** @param self index.
+ ** @return number of lists.
+ **/
+
+vl_size
+vl_ivfpq_get_num_lists (VlIVFPQ const * self)
+{
+  return self->numLists ;
+}
+
+/** @brief Get the number of subquantizers
+ ** @param self index.
+ ** @return number of subquantizers (bytes per code).
+ **/
+
+vl_size
+vl_ivfpq_get_num_subquantizers (VlIVFPQ const * self)
+{
+  return self->numSubquantizers ;
+}
+
+/** @brief Get the number of indexed vectors
+ ** @param self index.
+ ** @return number of vectors.
+ **/
+
+vl_size
+vl_ivfpq_get_num_data (VlIVFPQ const * self)
+{
+  return self->numData ;
+}
+
+/** @brief Get the number of lists visited by a query
+ ** @param self index.
+ ** @return number of probes.
+ **/
+
+vl_size
+vl_ivfpq_get_num_probes (VlIVFPQ const * self)
+{
+  return self->numProbes ;
+}
+
+/** @brief Get the maximum number of k-means iterations
+ ** @param self index.
+ ** @return maximum number of iterations.
+ **/
+
+vl_size
+vl_ivfpq_get_max_num_iterations (VlIVFPQ const * self)
+{
+  return self->maxNumIterations ;
+}
+
+/** @brief Get the verbosity level
+ ** @param self index.
+ ** @return verbosity level.
+ **/
+
+int
+vl_ivfpq_get_verbosity (VlIVFPQ const * self)
+{
+  return self->verbosity ;
+}
+
+/** @brief Get the coarse centers
+ ** @param self index.
+ ** @return coarse centers (or @c NULL if the index is not trained).
+ **
+ ** The centers are stored as the columns of a dimension by number
+ ** of lists matrix.
+ **/
+
+float const *
+vl_ivfpq_get_coarse_centers (VlIVFPQ const * self)
+{
+  return self->coarseCenters ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                                Set parameters    */
+/* ---------------------------------------------------------------- */
+
+/** @brief Set the number of lists visited by a query
+ ** @param self index.
+ ** @param numProbes number of probes.
+ **
+ ** Values larger than the number of lists are clamped.
+ **/
+
+void
+vl_ivfpq_set_num_probes (VlIVFPQ * self, vl_size numProbes)
+{
+  assert (numProbes >= 1) ;
+  self->numProbes = numProbes ;
+}
+
+/** @brief Set the maximum number of k-means iterations
+ ** @param self index.
+ ** @param maxNumIterations maximum number of iterations.
+ **
+ ** The value is used by ::vl_ivfpq_build.
+ **/
+
+void
+vl_ivfpq_set_max_num_iterations (VlIVFPQ * self, vl_size maxNumIterations)
+{
+  assert (maxNumIterations >= 1) ;
+  self->maxNumIterations = maxNumIterations ;
+}
+
+/** @brief Set the verbosity level
+ ** @param self index.
+ ** @param verbosity verbosity level.
+ **/
+
+void
+vl_ivfpq_set_verbosity (VlIVFPQ * self, int verbosity)
+{
+  self->verbosity = verbosity ;
+}
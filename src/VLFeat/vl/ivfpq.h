@@ -0,0 +1,86 @@
+/** @file ivfpq.h
+ ** @brief Inverted file with product quantization (@ref ivfpq)
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_IVFPQ_H
+#define VL_IVFPQ_H
+
+#include "generic.h"
+
+/** @brief Number of centroids of each product quantizer subspace */
+#define VL_IVFPQ_NUM_SUBCENTERS 256
+
+#ifndef __DOXYGEN__
+struct _VlIVFPQ ;
+typedef struct _VlIVFPQ VlIVFPQ ;
+#else
+/** @brief IVF-PQ index */
+typedef OPAQUE VlIVFPQ ;
+#endif
+
+/** @name Create and destroy
+ ** @{
+ **/
+VL_EXPORT VlIVFPQ * vl_ivfpq_new (vl_size dimension,
+                                  vl_size numLists,
+                                  vl_size numSubquantizers) ;
+VL_EXPORT void vl_ivfpq_delete (VlIVFPQ * self) ;
+/** @} */
+
+/** @name Build and search
+ ** @{
+ **/
+VL_EXPORT int vl_ivfpq_build (VlIVFPQ * self,
+                              float const * data,
+                              vl_size numData) ;
+
+VL_EXPORT int vl_ivfpq_add (VlIVFPQ * self,
+                            float const * data,
+                            vl_size numData) ;
+
+VL_EXPORT int vl_ivfpq_search (VlIVFPQ const * self,
+                               vl_uint32 * indexes,
+                               float * distances,
+                               vl_size numNeighbors,
+                               float const * queries,
+                               vl_size numQueries) ;
+/** @} */
+
+/** @name Save and load
+ ** @{
+ **/
+VL_EXPORT int vl_ivfpq_save (VlIVFPQ const * self, char const * fileName) ;
+VL_EXPORT VlIVFPQ * vl_ivfpq_load (char const * fileName) ;
+/** @} */
+
+/** @name Retrieve data and parameters
+ ** @{
+ **/
+VL_EXPORT vl_size vl_ivfpq_get_dimension (VlIVFPQ const * self) ;
+VL_EXPORT vl_size vl_ivfpq_get_num_lists (VlIVFPQ const * self) ;
+VL_EXPORT vl_size vl_ivfpq_get_num_subquantizers (VlIVFPQ const * self) ;
+VL_EXPORT vl_size vl_ivfpq_get_num_data (VlIVFPQ const * self) ;
+VL_EXPORT vl_size vl_ivfpq_get_num_probes (VlIVFPQ const * self) ;
+VL_EXPORT vl_size vl_ivfpq_get_max_num_iterations (VlIVFPQ const * self) ;
+VL_EXPORT int vl_ivfpq_get_verbosity (VlIVFPQ const * self) ;
+VL_EXPORT float const * vl_ivfpq_get_coarse_centers (VlIVFPQ const * self) ;
+/** @} */
+
+/** @name Set parameters
+ ** @{
+ **/
+VL_EXPORT void vl_ivfpq_set_num_probes (VlIVFPQ * self, vl_size numProbes) ;
+VL_EXPORT void vl_ivfpq_set_max_num_iterations (VlIVFPQ * self, vl_size maxNumIterations) ;
+VL_EXPORT void vl_ivfpq_set_verbosity (VlIVFPQ * self, int verbosity) ;
+/** @} */
+
+/* VL_IVFPQ_H */
+#endif
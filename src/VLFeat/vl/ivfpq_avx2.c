@@ -0,0 +1,77 @@
+/** @file ivfpq_avx2.c
+ ** @brief IVF-PQ - AVX2 - Definition
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#if ! defined(VL_DISABLE_AVX) & ! defined(__AVX2__)
+#error "Compiling with AVX2 enabled, but no __AVX2__ defined"
+#endif
+
+#if ! defined(VL_DISABLE_AVX)
+
+#include <immintrin.h>
+
+#include "ivfpq.h"
+#include "ivfpq_avx2.h"
+
+/* ---------------------------------------------------------------- */
+/*
+ * Same algorithms as _vl_ivfpq_compute_table and _vl_ivfpq_scan in
+ * ivfpq.c, vectorized across eight centroids or codes. Each lane
+ * performs the same operations in the same order as the scalar code,
+ * so the results are identical.
+ */
+
+void
+_vl_ivfpq_compute_table_avx2 (float * table,
+                              float const * residual,
+                              float const * codebooks,
+                              vl_size numSubquantizers,
+                              vl_size subdimension)
+{
+  vl_uindex m, d, k ;
+  for (m = 0 ; m < numSubquantizers ; ++m) {
+    float * t = table + m * VL_IVFPQ_NUM_SUBCENTERS ;
+    float const * r = residual + m * subdimension ;
+    float const * c = codebooks + m * subdimension * VL_IVFPQ_NUM_SUBCENTERS ;
+    for (k = 0 ; k < VL_IVFPQ_NUM_SUBCENTERS ; k += 8) {
+      __m256 acc = _mm256_setzero_ps() ;
+      for (d = 0 ; d < subdimension ; ++d) {
+        __m256 delta = _mm256_sub_ps(_mm256_set1_ps(r[d]),
+                                     _mm256_loadu_ps(c + d * VL_IVFPQ_NUM_SUBCENTERS + k)) ;
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(delta, delta)) ;
+      }
+      _mm256_storeu_ps(t + k, acc) ;
+    }
+  }
+}
+
+void
+_vl_ivfpq_scan_avx2 (float * distances,
+                     vl_uint8 const * codes,
+                     vl_size numBlocks,
+                     float const * table,
+                     vl_size numSubquantizers)
+{
+  vl_uindex b, m ;
+  for (b = 0 ; b < numBlocks ; ++b) {
+    __m256 acc = _mm256_setzero_ps() ;
+    for (m = 0 ; m < numSubquantizers ; ++m) {
+      __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)codes)) ;
+      acc = _mm256_add_ps(acc, _mm256_i32gather_ps(table + m * VL_IVFPQ_NUM_SUBCENTERS, index, 4)) ;
+      codes += 8 ;
+    }
+    _mm256_storeu_ps(distances, acc) ;
+    distances += 8 ;
+  }
+}
+
+/* ! VL_DISABLE_AVX */
+#endif
@@ -0,0 +1,37 @@
+/** @file ivfpq_avx2.h
+ ** @brief IVF-PQ - AVX2
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_IVFPQ_AVX2_H
+#define VL_IVFPQ_AVX2_H
+
+#include "generic.h"
+
+#ifndef VL_DISABLE_AVX
+
+VL_EXPORT
+void _vl_ivfpq_compute_table_avx2 (float * table,
+                                   float const * residual,
+                                   float const * codebooks,
+                                   vl_size numSubquantizers,
+                                   vl_size subdimension) ;
+
+VL_EXPORT
+void _vl_ivfpq_scan_avx2 (float * distances,
+                          vl_uint8 const * codes,
+                          vl_size numBlocks,
+                          float const * table,
+                          vl_size numSubquantizers) ;
+
+#endif
+
+/* VL_IVFPQ_AVX2_H */
+#endif
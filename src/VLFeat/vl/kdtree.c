@@ -78,6 +78,23 @@ root) and it is weighed by the lower bound on the distance of any
 point in the partition and the query point. Such a lower bound is
 trivial to compute because partitions are hyper-rectangles.
 
+<b>Search layout.</b> Once built, each tree is converted to a compact
+representation used for search (::vl_kdforest_build does this
+automatically). The nodes are stored in breadth-first order in a
+cache-line aligned array, with the two children of a node next to each
+other. Subtrees containing at most ::vl_kdforest_set_leaf_size points
+are collapsed into a single leaf (bucket), and the data is copied in
+the order of the leaves, so that the points of a bucket are contiguous
+in memory. Buckets are scanned at once, using an AVX kernel for the
+::VlDistanceL2 distance if available. Note that this copy requires, for
+each tree, as much memory as the data itself. The default leaf size of
+one gives the same search as the original tree; larger buckets (e.g.
+eight points) make each comparison cheaper, but change the result of
+searches with a limited number of comparisons
+(::vl_kdforest_set_max_num_comparisons). The search layout can
+be stored in an archive and used directly from the mapped file (see
+::vl_archive_writer_add_kdforest and ::vl_archive_new_kdforest).
+
 <b>Querying usage.</b> As said before a user has to create an instance
 ::VlKDForestSearcher using ::vl_kdforest_new_searcher in order to be able
 to make queries. When a user wants to delete a KD-Tree all the searchers
@@ -90,11 +107,11 @@ using the vl_kdforest_delete_searcher method.
 #include "generic.h"
 #include "random.h"
 #include "mathop.h"
+#include "mathop_avx.h"
 #include <stdlib.h>
+#include <string.h>
 
-#if defined(_OPENMP)
-#include <omp.h>
-#endif
+#define VL_KDTREE_CACHE_LINE 64
 
 #define VL_HEAP_prefix     vl_kdforest_search_heap
 #define VL_HEAP_type       VlKDForestSearchState
@@ -316,6 +333,186 @@ vl_kdtree_build_recursively
   vl_kdtree_build_recursively (forest, tree, node->upperChild, splitIndex + 1, dataEnd, depth + 1) ;
 }
 
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Compute the range of data of each node recursively
+ ** @param tree tree.
+ ** @param nodeIndex node to process.
+ ** @param begins begin of the data of each node (output).
+ ** @param ends end of the data of each node (output).
+ **/
+
+static void
+vl_kdtree_calc_data_range_recursively (VlKDTree const * tree,
+                                       vl_uindex nodeIndex,
+                                       vl_uindex * begins,
+                                       vl_uindex * ends)
+{
+  VlKDTreeNode const * node = tree->nodes + nodeIndex ;
+  if (node->lowerChild < 0) {
+    begins[nodeIndex] = - node->lowerChild - 1 ;
+    ends[nodeIndex] = - node->upperChild - 1 ;
+  } else {
+    vl_kdtree_calc_data_range_recursively (tree, node->lowerChild, begins, ends) ;
+    vl_kdtree_calc_data_range_recursively (tree, node->upperChild, begins, ends) ;
+    begins[nodeIndex] = begins[node->lowerChild] ;
+    ends[nodeIndex] = ends[node->upperChild] ;
+  }
+}
+
+/** @internal @brief Data of the parallel loop copying the data of a tree */
+typedef struct _VlKDTreeCopyLoop
+{
+  VlKDTree const * tree ;
+  void const * data ;
+  vl_size dataSize ;
+} VlKDTreeCopyLoop ;
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Copy a range of data in the order of the tree index
+ ** @param loop_ loop data (::VlKDTreeCopyLoop).
+ ** @param task task index (unused).
+ ** @param begin first data point to copy.
+ ** @param end data point following the last one to copy.
+ **/
+
+static void
+vl_kdtree_copy_flat_data (void * loop_, vl_uindex task VL_UNUSED,
+                          vl_uindex begin, vl_uindex end)
+{
+  VlKDTreeCopyLoop const * loop = loop_ ;
+  VlKDTree const * tree = loop->tree ;
+  vl_size dataSize = loop->dataSize ;
+  vl_uindex di ;
+  for (di = begin ; di < end ; ++ di) {
+    memcpy ((char*)tree->flatData + dataSize * di,
+            (char const*)loop->data + dataSize * tree->dataIndex[di].index,
+            dataSize) ;
+  }
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Build the search layout of a tree
+ ** @param forest forest to which the tree belongs.
+ ** @param tree tree.
+ **
+ ** The nodes are visited breadth first, so that the two children of a
+ ** node are allocated next to each other. Subtrees with at most
+ ** VlKDForest::leafSize points become leaves. The data is copied in
+ ** the order of the tree index, so that each leaf is a contiguous
+ ** block of points.
+ **/
+
+static void
+vl_kdtree_flatten (VlKDForest * forest, VlKDTree * tree)
+{
+  vl_uindex * begins = vl_malloc (sizeof(vl_uindex) * tree->numUsedNodes) ;
+  vl_uindex * ends = vl_malloc (sizeof(vl_uindex) * tree->numUsedNodes) ;
+  vl_uindex * queue = vl_malloc (sizeof(vl_uindex) * tree->numUsedNodes) ;
+  vl_size dataSize = vl_get_type_size (forest->dataType) * forest->dimension ;
+  vl_size queueSize = 1 ;
+  vl_uindex qi ;
+
+  assert (forest->numData < 0x7fffffff) ;
+
+  vl_kdtree_calc_data_range_recursively (tree, 0, begins, ends) ;
+
+  tree->flatNodesMemory = vl_malloc (sizeof(VlKDTreeFlatNode) *
+                                     (tree->numUsedNodes + VL_KDTREE_FLAT_ROOT) +
+                                     VL_KDTREE_CACHE_LINE) ;
+  tree->flatNodes = (VlKDTreeFlatNode*)
+    (((vl_uintptr)tree->flatNodesMemory + VL_KDTREE_CACHE_LINE - 1) &
+     ~ (vl_uintptr)(VL_KDTREE_CACHE_LINE - 1)) ;
+  memset (tree->flatNodes, 0, sizeof(VlKDTreeFlatNode) * VL_KDTREE_FLAT_ROOT) ;
+
+  queue[0] = 0 ;
+  for (qi = 0 ; qi < queueSize ; ++ qi) {
+    VlKDTreeNode const * node = tree->nodes + queue[qi] ;
+    VlKDTreeFlatNode * flatNode = tree->flatNodes + VL_KDTREE_FLAT_ROOT + qi ;
+    vl_size numLeafData = ends[queue[qi]] - begins[queue[qi]] ;
+
+    flatNode->splitThreshold = node->splitThreshold ;
+    flatNode->lowerBound = node->lowerBound ;
+    flatNode->upperBound = node->upperBound ;
+
+    if (node->lowerChild < 0 || numLeafData <= forest->leafSize) {
+      flatNode->child = - (vl_int32) begins[queue[qi]] - 1 ;
+      flatNode->splitDimension = (vl_uint32) ends[queue[qi]] ;
+      forest->maxNumLeafData = VL_MAX(forest->maxNumLeafData, numLeafData) ;
+    } else {
+      flatNode->child = (vl_int32) (VL_KDTREE_FLAT_ROOT + queueSize) ;
+      flatNode->splitDimension = node->splitDimension ;
+      queue[queueSize++] = node->lowerChild ;
+      queue[queueSize++] = node->upperChild ;
+    }
+  }
+  tree->numFlatNodes = VL_KDTREE_FLAT_ROOT + queueSize ;
+
+  /* copy the data in the order of the leaves */
+  tree->flatDataMemory = vl_malloc (dataSize * forest->numData + VL_KDTREE_CACHE_LINE) ;
+  tree->flatData = (void*)
+    (((vl_uintptr)tree->flatDataMemory + VL_KDTREE_CACHE_LINE - 1) &
+     ~ (vl_uintptr)(VL_KDTREE_CACHE_LINE - 1)) ;
+
+  {
+    VlKDTreeCopyLoop loop ;
+    loop.tree = tree ;
+    loop.data = forest->data ;
+    loop.dataSize = dataSize ;
+    vl_parallel_for (forest->numData, 0, vl_kdtree_copy_flat_data, &loop) ;
+  }
+
+  vl_free (queue) ;
+  vl_free (ends) ;
+  vl_free (begins) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Build the search layout of the forest
+ ** @param self KDForest object.
+ **
+ ** The function also sets VlKDForest::maxNumNodes to the size of the
+ ** search heap needed by the flattened trees.
+ **/
+
+static void
+vl_kdforest_flatten (VlKDForest * self)
+{
+  vl_uindex ti ;
+  self->maxNumNodes = 0 ;
+  self->maxNumLeafData = 0 ;
+  for (ti = 0 ; ti < self->numTrees ; ++ ti) {
+    vl_kdtree_flatten (self, self->trees[ti]) ;
+    self->maxNumNodes += self->trees[ti]->numFlatNodes ;
+  }
+  self->flattened = VL_TRUE ;
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Dispose the search layout of the forest
+ ** @param self KDForest object.
+ **/
+
+static void
+vl_kdforest_unflatten (VlKDForest * self)
+{
+  vl_uindex ti ;
+  if (! self->flattened) return ;
+  /* a shared layout cannot be rebuilt as there are no tree nodes */
+  assert (! self->sharedLayout) ;
+  for (ti = 0 ; ti < self->numTrees ; ++ ti) {
+    vl_free (self->trees[ti]->flatNodesMemory) ;
+    vl_free (self->trees[ti]->flatDataMemory) ;
+    self->trees[ti]->flatNodes = NULL ;
+    self->trees[ti]->flatData = NULL ;
+  }
+  self->flattened = VL_FALSE ;
+}
+
 /** ------------------------------------------------------------------
  ** @brief Create new KDForest object
  ** @param dataType type of data (::VL_TYPE_FLOAT or ::VL_TYPE_DOUBLE)
@@ -352,6 +549,10 @@ vl_kdforest_new (vl_type dataType,
   self -> maxNumNodes = 0 ;
   self -> numSearchers = 0 ;
   self -> headSearcher = 0 ;
+  self -> leafSize = VL_KDTREE_DEFAULT_LEAF_SIZE ;
+  self -> maxNumLeafData = 0 ;
+  self -> flattened = VL_FALSE ;
+  self -> sharedLayout = VL_FALSE ;
 
   switch (self->dataType) {
     case VL_TYPE_FLOAT:
@@ -388,6 +589,10 @@ VlKDForestSearcher *
 vl_kdforest_new_searcher (VlKDForest * kdforest)
 {
   VlKDForestSearcher * self = vl_calloc(sizeof(VlKDForestSearcher), 1);
+
+  /* trees set up by other means than vl_kdforest_build */
+  if (! kdforest->flattened) vl_kdforest_flatten (kdforest) ;
+
   if(kdforest->numSearchers == 0) {
     kdforest->headSearcher = self;
     self->previous = NULL;
@@ -411,6 +616,7 @@ vl_kdforest_new_searcher (VlKDForest * kdforest)
   self->forest = kdforest;
   self->searchHeapArray = vl_malloc (sizeof(VlKDForestSearchState) * kdforest->maxNumNodes) ;
   self->searchIdBook = vl_calloc (sizeof(vl_uindex), kdforest->numData) ;
+  self->leafDistances = vl_malloc (sizeof(double) * kdforest->maxNumLeafData) ;
   return self ;
 }
 
@@ -436,6 +642,7 @@ vl_kdforestsearcher_delete (VlKDForestSearcher * self)
   self->forest->numSearchers -- ;
   vl_free(self->searchHeapArray) ;
   vl_free(self->searchIdBook) ;
+  vl_free(self->leafDistances) ;
   vl_free(self) ;
 }
 
@@ -467,11 +674,15 @@ vl_kdforest_delete (VlKDForest * self)
     vl_kdforestsearcher_delete(searcher) ;
   }
 
+  if (! self->sharedLayout) vl_kdforest_unflatten (self) ;
+
   if (self->trees) {
     for (ti = 0 ; ti < self->numTrees ; ++ ti) {
       if (self->trees[ti]) {
         if (self->trees[ti]->nodes) vl_free (self->trees[ti]->nodes) ;
-        if (self->trees[ti]->dataIndex) vl_free (self->trees[ti]->dataIndex) ;
+        if (self->trees[ti]->dataIndex && ! self->sharedLayout) {
+          vl_free (self->trees[ti]->dataIndex) ;
+        }
         vl_free (self->trees[ti]) ;
       }
     }
@@ -574,11 +785,151 @@ vl_kdforest_build (VlKDForest * self, vl_size numData, void const * data)
 
   vl_free(searchBounds);
   self -> maxNumNodes = maxNumNodes;
+
+  vl_kdforest_flatten (self) ;
 }
 
 
 /** ------------------------------------------------------------------
- ** @internal @brief
+ ** @internal @brief Compute the distances from the query to a leaf
+ ** @param searcher searcher.
+ ** @param tree tree.
+ ** @param begin first point of the leaf to process.
+ ** @param end end of the points to process.
+ ** @param query query point.
+ **
+ ** The distances are stored in VlKDForestSearcher::leafDistances.
+ **/
+
+static void
+vl_kdforest_eval_leaf_distances (VlKDForestSearcher * searcher,
+                                 VlKDTree const * tree,
+                                 vl_uindex begin,
+                                 vl_uindex end,
+                                 void const * query)
+{
+  VlKDForest const * forest = searcher->forest ;
+  switch (forest->dataType) {
+    case VL_TYPE_FLOAT: {
+      float const * points = (float const*)tree->flatData + begin * forest->dimension ;
+#ifndef VL_DISABLE_AVX
+      if (forest->distance == VlDistanceL2 && vl_cpu_has_avx() && vl_get_simd_enabled()) {
+        _vl_distance_l2_block_avx_f (searcher->leafDistances, forest->dimension,
+                                     query, points, end - begin) ;
+        break ;
+      }
+#endif
+      vl_eval_vector_comparison_on_all_pairs_f (searcher->leafDistances, forest->dimension,
+                                                query, 1, points, end - begin,
+                                                (VlFloatVectorComparisonFunction)forest->distanceFunction) ;
+      break ;
+    }
+    case VL_TYPE_DOUBLE: {
+      double const * points = (double const*)tree->flatData + begin * forest->dimension ;
+#ifndef VL_DISABLE_AVX
+      if (forest->distance == VlDistanceL2 && vl_cpu_has_avx() && vl_get_simd_enabled()) {
+        _vl_distance_l2_block_avx_d (searcher->leafDistances, forest->dimension,
+                                     query, points, end - begin) ;
+        break ;
+      }
+#endif
+      vl_eval_vector_comparison_on_all_pairs_d (searcher->leafDistances, forest->dimension,
+                                                query, 1, points, end - begin,
+                                                (VlDoubleVectorComparisonFunction)forest->distanceFunction) ;
+      break ;
+    }
+    default:
+      abort() ;
+  }
+}
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Compare the query to the points of a leaf
+ ** @param searcher searcher.
+ ** @param tree tree.
+ ** @param begin first point of the leaf.
+ ** @param end end of the leaf.
+ ** @param neighbors neighbor heap.
+ ** @param numNeighbors number of neighbors to find.
+ ** @param numAddedNeighbors number of neighbors in the heap.
+ ** @param query query point.
+ **/
+
+static void
+vl_kdforest_scan_leaf (VlKDForestSearcher * searcher,
+                       VlKDTree const * tree,
+                       vl_uindex begin,
+                       vl_uindex end,
+                       VlKDForestNeighbor * neighbors,
+                       vl_size numNeighbors,
+                       vl_size * numAddedNeighbors,
+                       void const * query)
+{
+  VlKDForest const * forest = searcher->forest ;
+  vl_size numNew = 0 ;
+  vl_uindex iter, stop ;
+
+  /* multiple KDTrees share the database points and we must avoid
+   * adding the same point twice; find the new points within the
+   * comparison budget */
+  for (stop = begin ; stop < end ; ++ stop) {
+    if (forest->searchMaxNumComparisons != 0 &&
+        searcher->searchNumComparisons + numNew >= forest->searchMaxNumComparisons) break ;
+    if (searcher->searchIdBook[tree->dataIndex[stop].index] != searcher->searchId) numNew ++ ;
+  }
+  if (numNew == 0) return ;
+
+  /* scan the leaf at once unless most points were seen already */
+  if (2 * numNew >= stop - begin) {
+    vl_kdforest_eval_leaf_distances (searcher, tree, begin, stop, query) ;
+  }
+
+  for (iter = begin ; iter < stop ; ++ iter) {
+    vl_index di = tree->dataIndex [iter].index ;
+    double dist ;
+
+    if (searcher->searchIdBook[di] == searcher->searchId) continue ;
+    searcher->searchIdBook[di] = searcher->searchId ;
+
+    if (2 * numNew < stop - begin) {
+      vl_kdforest_eval_leaf_distances (searcher, tree, iter, iter + 1, query) ;
+      switch (forest->dataType) {
+        case VL_TYPE_FLOAT: dist = ((float*)searcher->leafDistances)[0] ; break ;
+        case VL_TYPE_DOUBLE: dist = ((double*)searcher->leafDistances)[0] ; break ;
+        default: abort() ;
+      }
+    } else {
+      switch (forest->dataType) {
+        case VL_TYPE_FLOAT: dist = ((float*)searcher->leafDistances)[iter - begin] ; break ;
+        case VL_TYPE_DOUBLE: dist = ((double*)searcher->leafDistances)[iter - begin] ; break ;
+        default: abort() ;
+      }
+    }
+    searcher->searchNumComparisons += 1 ;
+
+    /* see if it should be added to the result set */
+    if (*numAddedNeighbors < numNeighbors) {
+      VlKDForestNeighbor * newNeighbor = neighbors + *numAddedNeighbors ;
+      newNeighbor->index = di ;
+      newNeighbor->distance = dist ;
+      vl_kdforest_neighbor_heap_push (neighbors, numAddedNeighbors) ;
+    } else {
+      VlKDForestNeighbor * largestNeighbor = neighbors + 0 ;
+      if (largestNeighbor->distance > dist) {
+        largestNeighbor->index = di ;
+        largestNeighbor->distance = dist ;
+        vl_kdforest_neighbor_heap_update (neighbors, *numAddedNeighbors, 0) ;
+      }
+    }
+  } /* next data point */
+}
+
+/** ------------------------------------------------------------------
+ ** @internal @brief Descend a tree to a leaf
+ **
+ ** The function descends from @a nodeIndex to the leaf containing
+ ** the query, pushing the alternative branches to the search heap,
+ ** and scans the leaf.
  **/
 
 vl_uindex
@@ -591,139 +942,78 @@ vl_kdforest_query_recursively (VlKDForestSearcher * searcher,
                                double dist,
                                void const * query)
 {
+  VlKDTreeFlatNode const * node = tree->flatNodes + nodeIndex ;
+
+  while (node->child >= 0) {
+    vl_uindex i = node->splitDimension ;
+    vl_index nextChild, saveChild ;
+    double delta, saveDist ;
+    double x ;
+    double x1 = node->lowerBound ;
+    double x2 = node->splitThreshold ;
+    double x3 = node->upperBound ;
+    VlKDForestSearchState * searchState ;
 
-  VlKDTreeNode const * node = tree->nodes + nodeIndex ;
-  vl_uindex i = node->splitDimension ;
-  vl_index nextChild, saveChild ;
-  double delta, saveDist ;
-  double x ;
-  double x1 = node->lowerBound ;
-  double x2 = node->splitThreshold ;
-  double x3 = node->upperBound ;
-  VlKDForestSearchState * searchState ;
-
-  searcher->searchNumRecursions ++ ;
+    searcher->searchNumRecursions ++ ;
 
-  switch (searcher->forest->dataType) {
-    case VL_TYPE_FLOAT :
-      x = ((float const*) query)[i] ;
-      break ;
-    case VL_TYPE_DOUBLE :
-      x = ((double const*) query)[i] ;
-      break ;
-    default :
-      abort() ;
-  }
-
-  /* base case: this is a leaf node */
-  if (node->lowerChild < 0) {
+    switch (searcher->forest->dataType) {
+      case VL_TYPE_FLOAT :
+        x = ((float const*) query)[i] ;
+        break ;
+      case VL_TYPE_DOUBLE :
+        x = ((double const*) query)[i] ;
+        break ;
+      default :
+        abort() ;
+    }
 
-    vl_index begin = - node->lowerChild - 1 ;
-    vl_index end   = - node->upperChild - 1 ;
-    vl_index iter ;
-
-    for (iter = begin ;
-         iter < end &&
-         (searcher->forest->searchMaxNumComparisons == 0 ||
-          searcher->searchNumComparisons < searcher->forest->searchMaxNumComparisons) ;
-         ++ iter) {
-
-      vl_index di = tree->dataIndex [iter].index ;
-
-      /* multiple KDTrees share the database points and we must avoid
-       * adding the same point twice */
-      if (searcher->searchIdBook[di] == searcher->searchId) continue ;
-      searcher->searchIdBook[di] = searcher->searchId ;
-
-      /* compare the query to this point */
-      switch (searcher->forest->dataType) {
-        case VL_TYPE_FLOAT:
-          dist = ((VlFloatVectorComparisonFunction)searcher->forest->distanceFunction)
-                 (searcher->forest->dimension,
-                  ((float const *)query),
-                  ((float const*)searcher->forest->data) + di * searcher->forest->dimension) ;
-          break ;
-        case VL_TYPE_DOUBLE:
-          dist = ((VlDoubleVectorComparisonFunction)searcher->forest->distanceFunction)
-                 (searcher->forest->dimension,
-                  ((double const *)query),
-                  ((double const*)searcher->forest->data) + di * searcher->forest->dimension) ;
-          break ;
-        default:
-          abort() ;
+    /*
+     *   x1  x2 x3
+     * x (---|---]
+     *   (--x|---]
+     *   (---|x--]
+     *   (---|---] x
+     */
+
+    delta = x - x2 ;
+    saveDist = dist + delta*delta ;
+
+    if (x <= x2) {
+      nextChild = node->child ;
+      saveChild = node->child + 1 ;
+      if (x <= x1) {
+        delta = x - x1 ;
+        saveDist -= delta*delta ;
       }
-      searcher->searchNumComparisons += 1 ;
-
-      /* see if it should be added to the result set */
-      if (*numAddedNeighbors < numNeighbors) {
-        VlKDForestNeighbor * newNeighbor = neighbors + *numAddedNeighbors ;
-        newNeighbor->index = di ;
-        newNeighbor->distance = dist ;
-        vl_kdforest_neighbor_heap_push (neighbors, numAddedNeighbors) ;
-      } else {
-        VlKDForestNeighbor * largestNeighbor = neighbors + 0 ;
-        if (largestNeighbor->distance > dist) {
-          largestNeighbor->index = di ;
-          largestNeighbor->distance = dist ;
-          vl_kdforest_neighbor_heap_update (neighbors, *numAddedNeighbors, 0) ;
-        }
+    } else {
+      nextChild = node->child + 1 ;
+      saveChild = node->child ;
+      if (x > x3) {
+        delta = x - x3 ;
+        saveDist -= delta*delta ;
       }
-    } /* next data point */
-
-
-    return nodeIndex ;
-  }
-
-#if 0
-  assert (x1 <= x2 && x2 <= x3) ;
-  assert (node->lowerChild >= 0) ;
-  assert (node->upperChild >= 0) ;
-#endif
-
-  /*
-   *   x1  x2 x3
-   * x (---|---]
-   *   (--x|---]
-   *   (---|x--]
-   *   (---|---] x
-   */
-
-  delta = x - x2 ;
-  saveDist = dist + delta*delta ;
-
-  if (x <= x2) {
-    nextChild = node->lowerChild ;
-    saveChild = node->upperChild ;
-    if (x <= x1) {
-      delta = x - x1 ;
-      saveDist -= delta*delta ;
     }
-  } else {
-    nextChild = node->upperChild ;
-    saveChild = node->lowerChild ;
-    if (x > x3) {
-      delta = x - x3 ;
-      saveDist -= delta*delta ;
+
+    if (*numAddedNeighbors < numNeighbors || neighbors[0].distance > saveDist) {
+      searchState = searcher->searchHeapArray + searcher->searchHeapNumNodes ;
+      searchState->tree = tree ;
+      searchState->nodeIndex = saveChild ;
+      searchState->distanceLowerBound = saveDist ;
+      vl_kdforest_search_heap_push (searcher->searchHeapArray ,
+                                    &searcher->searchHeapNumNodes) ;
     }
-  }
 
-  if (*numAddedNeighbors < numNeighbors || neighbors[0].distance > saveDist) {
-    searchState = searcher->searchHeapArray + searcher->searchHeapNumNodes ;
-    searchState->tree = tree ;
-    searchState->nodeIndex = saveChild ;
-    searchState->distanceLowerBound = saveDist ;
-    vl_kdforest_search_heap_push (searcher->searchHeapArray ,
-                                  &searcher->searchHeapNumNodes) ;
+    nodeIndex = nextChild ;
+    node = tree->flatNodes + nodeIndex ;
   }
 
-  return vl_kdforest_query_recursively (searcher,
-                                        tree,
-                                        nextChild,
-                                        neighbors,
-                                        numNeighbors,
-                                        numAddedNeighbors,
-                                        dist,
-                                        query) ;
+  /* this is a leaf node */
+  searcher->searchNumRecursions ++ ;
+  vl_kdforest_scan_leaf (searcher, tree,
+                         - node->child - 1, node->splitDimension,
+                         neighbors, numNeighbors, numAddedNeighbors,
+                         query) ;
+  return nodeIndex ;
 }
 
 /** ------------------------------------------------------------------
@@ -799,7 +1089,7 @@ vl_kdforestsearcher_query (VlKDForestSearcher * self,
   for (ti = 0 ; ti < self->forest->numTrees ; ++ ti) {
     searchState = self->searchHeapArray + self->searchHeapNumNodes ;
     searchState -> tree = self->forest->trees[ti] ;
-    searchState -> nodeIndex = 0 ;
+    searchState -> nodeIndex = VL_KDTREE_FLAT_ROOT ;
     searchState -> distanceLowerBound = 0 ;
 
     vl_kdforest_search_heap_push (self->searchHeapArray, &self->searchHeapNumNodes) ;
@@ -846,6 +1136,76 @@ vl_kdforestsearcher_query (VlKDForestSearcher * self,
   return self->searchNumComparisons ;
 }
 
+/** @internal @brief Data of the parallel loop of ::vl_kdforest_query_with_array */
+typedef struct _VlKDForestQueryLoop
+{
+  VlKDForestSearcher ** searchers ;     /**< Searcher of each task. */
+  VlKDForestNeighbor ** neighbors ;     /**< Neighbors buffer of each task. */
+  vl_size * numComparisons ;            /**< Comparisons of each task. */
+  vl_uint32 * indexes ;
+  vl_size numNeighbors ;
+  void * distances ;
+  void const * queries ;
+} VlKDForestQueryLoop ;
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Run a range of queries
+ ** @param loop_ loop data (::VlKDForestQueryLoop).
+ ** @param task task index.
+ ** @param begin first query.
+ ** @param end query following the last one.
+ **/
+
+static void
+vl_kdforest_query_range (void * loop_, vl_uindex task,
+                         vl_uindex begin, vl_uindex end)
+{
+  VlKDForestQueryLoop const * loop = loop_ ;
+  VlKDForestSearcher * searcher = loop->searchers[task] ;
+  VlKDForestNeighbor * neighbors = loop->neighbors[task] ;
+  vl_type dataType = vl_kdforest_get_data_type(searcher->forest) ;
+  vl_size dimension = vl_kdforest_get_data_dimension(searcher->forest) ;
+  vl_size numNeighbors = loop->numNeighbors ;
+  vl_uint32 * indexes = loop->indexes ;
+  void * distances = loop->distances ;
+  void const * queries = loop->queries ;
+  vl_size thisNumComparisons = 0 ;
+  vl_uindex qi ;
+
+  for(qi = begin ; qi < end ; ++ qi) {
+    switch (dataType) {
+      case VL_TYPE_FLOAT: {
+        vl_size ni;
+        thisNumComparisons += vl_kdforestsearcher_query (searcher, neighbors, numNeighbors,
+                                                         (float const *) (queries) + qi * dimension) ;
+        for (ni = 0 ; ni < numNeighbors ; ++ni) {
+          indexes [qi*numNeighbors + ni] = (vl_uint32) neighbors[ni].index ;
+          if (distances){
+            *((float*)distances + qi*numNeighbors + ni) = neighbors[ni].distance ;
+          }
+        }
+        break ;
+      }
+      case VL_TYPE_DOUBLE: {
+        vl_size ni;
+        thisNumComparisons += vl_kdforestsearcher_query (searcher, neighbors, numNeighbors,
+                                                         (double const *) (queries) + qi * dimension) ;
+        for (ni = 0 ; ni < numNeighbors ; ++ni) {
+          indexes [qi*numNeighbors + ni] = (vl_uint32) neighbors[ni].index ;
+          if (distances){
+            *((double*)distances + qi*numNeighbors + ni) = neighbors[ni].distance ;
+          }
+        }
+        break ;
+      }
+      default:
+        abort() ;
+    }
+  }
+  loop->numComparisons[task] = thisNumComparisons ;
+}
+
 /** ------------------------------------------------------------------
  ** @brief Run multiple queries
  ** @param self object.
@@ -875,69 +1235,37 @@ vl_kdforest_query_with_array (VlKDForest * self,
                               void const * queries)
 {
   vl_size numComparisons = 0;
-  vl_type dataType = vl_kdforest_get_data_type(self) ;
-  vl_size dimension = vl_kdforest_get_data_dimension(self) ;
+  vl_size numTasks ;
+  vl_uindex task ;
+  VlKDForestQueryLoop loop ;
+
+  if (! self->flattened) vl_kdforest_flatten (self) ;
+
+  /* searchers are created and deleted sequentially as they are
+     registered with the forest */
+  numTasks = VL_MIN(vl_get_max_threads(), numQueries) ;
+  loop.searchers = vl_malloc (sizeof(VlKDForestSearcher*) * numTasks) ;
+  loop.neighbors = vl_malloc (sizeof(VlKDForestNeighbor*) * numTasks) ;
+  loop.numComparisons = vl_calloc (numTasks, sizeof(vl_size)) ;
+  loop.indexes = indexes ;
+  loop.numNeighbors = numNeighbors ;
+  loop.distances = distances ;
+  loop.queries = queries ;
+  for (task = 0 ; task < numTasks ; ++ task) {
+    loop.searchers[task] = vl_kdforest_new_searcher(self) ;
+    loop.neighbors[task] = vl_calloc (sizeof(VlKDForestNeighbor), numNeighbors) ;
+  }
 
-#ifdef _OPENMP
-#pragma omp parallel default(shared) num_threads(vl_get_max_threads())
-#endif
-  {
-    vl_index qi ;
-    vl_size thisNumComparisons = 0 ;
-    VlKDForestSearcher * searcher ;
-    VlKDForestNeighbor * neighbors ;
+  vl_parallel_for (numQueries, numTasks, vl_kdforest_query_range, &loop) ;
 
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-    {
-      searcher = vl_kdforest_new_searcher(self) ;
-      neighbors = vl_calloc (sizeof(VlKDForestNeighbor), numNeighbors) ;
-    }
-
-#ifdef _OPENMP
-#pragma omp for
-#endif
-    for(qi = 0 ; qi < (signed)numQueries; ++ qi) {
-      switch (dataType) {
-        case VL_TYPE_FLOAT: {
-          vl_size ni;
-          thisNumComparisons += vl_kdforestsearcher_query (searcher, neighbors, numNeighbors,
-                                                           (float const *) (queries) + qi * dimension) ;
-          for (ni = 0 ; ni < numNeighbors ; ++ni) {
-            indexes [qi*numNeighbors + ni] = (vl_uint32) neighbors[ni].index ;
-            if (distances){
-              *((float*)distances + qi*numNeighbors + ni) = neighbors[ni].distance ;
-            }
-          }
-          break ;
-        }
-        case VL_TYPE_DOUBLE: {
-          vl_size ni;
-          thisNumComparisons += vl_kdforestsearcher_query (searcher, neighbors, numNeighbors,
-                                                           (double const *) (queries) + qi * dimension) ;
-          for (ni = 0 ; ni < numNeighbors ; ++ni) {
-            indexes [qi*numNeighbors + ni] = (vl_uint32) neighbors[ni].index ;
-            if (distances){
-              *((double*)distances + qi*numNeighbors + ni) = neighbors[ni].distance ;
-            }
-          }
-          break ;
-        }
-        default:
-          abort() ;
-      }
-    }
-
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-    {
-      numComparisons += thisNumComparisons ;
-      vl_kdforestsearcher_delete (searcher) ;
-      vl_free (neighbors) ;
-    }
+  for (task = 0 ; task < numTasks ; ++ task) {
+    numComparisons += loop.numComparisons[task] ;
+    vl_kdforestsearcher_delete (loop.searchers[task]) ;
+    vl_free (loop.neighbors[task]) ;
   }
+  vl_free (loop.searchers) ;
+  vl_free (loop.neighbors) ;
+  vl_free (loop.numComparisons) ;
   return numComparisons ;
 }
 
@@ -1045,6 +1373,44 @@ vl_kdforest_get_thresholding_method (VlKDForest const * self)
   return self->thresholdingMethod ;
 }
 
+/** ------------------------------------------------------------------
+ ** @brief Set the leaf size
+ ** @param self KDForest object.
+ ** @param leafSize maximum number of points in a leaf.
+ **
+ ** Subtrees with at most @a leafSize points are searched as a single
+ ** leaf (see @ref kdtree-tech). A value of one (the default) searches
+ ** the tree down to the individual points. The search layout is rebuilt the next
+ ** time a searcher is created, so the function cannot be called
+ ** while searchers exist, nor on a forest loaded from an archive
+ ** (::vl_archive_new_kdforest).
+ **
+ ** @sa ::vl_kdforest_get_leaf_size
+ **/
+
+void
+vl_kdforest_set_leaf_size (VlKDForest * self, vl_size leafSize)
+{
+  assert (leafSize >= 1) ;
+  assert (self->numSearchers == 0) ;
+  vl_kdforest_unflatten (self) ;
+  self->leafSize = leafSize ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Get the leaf size
+ ** @param self KDForest object.
+ ** @return maximum number of points in a leaf.
+ **
+ ** @sa ::vl_kdforest_set_leaf_size
+ **/
+
+vl_size
+vl_kdforest_get_leaf_size (VlKDForest const * self)
+{
+  return self->leafSize ;
+}
+
 /** ------------------------------------------------------------------
  ** @brief Get the dimension of the data
  ** @param self KDForest object.
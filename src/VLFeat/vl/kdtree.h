@@ -19,8 +19,10 @@ the terms of the BSD license (see the COPYING file).
 
 #define VL_KDTREE_SPLIT_HEAP_SIZE 5
 #define VL_KDTREE_VARIANCE_EST_NUM_SAMPLES 1024
+#define VL_KDTREE_DEFAULT_LEAF_SIZE 1
 
 typedef struct _VlKDTreeNode VlKDTreeNode ;
+typedef struct _VlKDTreeFlatNode VlKDTreeFlatNode ;
 typedef struct _VlKDTreeSplitDimension VlKDTreeSplitDimension ;
 typedef struct _VlKDTreeDataIndexEntry VlKDTreeDataIndexEntry ;
 typedef struct _VlKDForestSearchState VlKDForestSearchState ;
@@ -36,6 +38,23 @@ struct _VlKDTreeNode
   double upperBound ;
 } ;
 
+/* index of the root in the breadth-first layout; entry 0 is padding
+ * so that sibling nodes share a cache line */
+#define VL_KDTREE_FLAT_ROOT 1
+
+/* Node of the breadth-first layout used for search. The children of
+ * an inner node are stored next to each other at child and child + 1.
+ * For a leaf, child is - begin - 1 and splitDimension is the end of
+ * the leaf data in the tree order. */
+struct _VlKDTreeFlatNode
+{
+  double splitThreshold ;
+  double lowerBound ;
+  double upperBound ;
+  vl_int32 child ;
+  vl_uint32 splitDimension ;
+} ;
+
 struct _VlKDTreeSplitDimension
 {
   unsigned int dimension ;
@@ -69,6 +88,13 @@ typedef struct _VlKDTree
   vl_size numAllocatedNodes ;
   VlKDTreeDataIndexEntry * dataIndex ;
   unsigned int depth ;
+
+  /* search layout */
+  VlKDTreeFlatNode * flatNodes ;
+  vl_size numFlatNodes ;
+  void * flatData ;
+  void * flatNodesMemory ;
+  void * flatDataMemory ;
 } VlKDTree ;
 
 struct _VlKDForestSearchState
@@ -106,6 +132,12 @@ typedef struct _VlKDForest
   vl_size splitHeapSize ;
   vl_size maxNumNodes;
 
+  /* search layout */
+  vl_size leafSize ;
+  vl_size maxNumLeafData ;
+  vl_bool flattened ;
+  vl_bool sharedLayout ; /* search layout and index not owned (e.g. mapped archive) */
+
   /* query */
   vl_size searchMaxNumComparisons ;
   vl_size numSearchers;
@@ -122,6 +154,7 @@ typedef struct _VlKDForestSearcher
 
   vl_uindex * searchIdBook ;
   VlKDForestSearchState * searchHeapArray ;
+  void * leafDistances ;
   VlKDForest * forest;
 
   vl_size searchNumComparisons;
@@ -176,6 +209,8 @@ VL_EXPORT void vl_kdforest_set_max_num_comparisons (VlKDForest * self, vl_size n
 VL_EXPORT vl_size vl_kdforest_get_max_num_comparisons (VlKDForest * self) ;
 VL_EXPORT void vl_kdforest_set_thresholding_method (VlKDForest * self, VlKDTreeThresholdingMethod method) ;
 VL_EXPORT VlKDTreeThresholdingMethod vl_kdforest_get_thresholding_method (VlKDForest const * self) ;
+VL_EXPORT void vl_kdforest_set_leaf_size (VlKDForest * self, vl_size leafSize) ;
+VL_EXPORT vl_size vl_kdforest_get_leaf_size (VlKDForest const * self) ;
 VL_EXPORT VlKDForest * vl_kdforest_searcher_get_forest (VlKDForestSearcher const * self) ;
 VL_EXPORT VlKDForestSearcher * vl_kdforest_get_searcher (VlKDForest const * self, vl_uindex pos) ;
 /** @} */
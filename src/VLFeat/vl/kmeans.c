@@ -110,6 +110,24 @@ changes sufficiently slowly in one iteration (::vl_kmeans_set_min_energy_variati
 
 All the three algorithms support multithreaded computations. The number
 of threads used is usually controlled globally by ::vl_set_num_threads.
+
+When the data does not fit in memory, ::vl_kmeans_cluster_mini_batch
+runs the **mini-batch** algorithm (@ref kmeans-mini-batch) instead.
+This function pulls the data in batches from a ::VlKMeansReadFunction
+callback and processes each point once per call:
+
+@code
+VlKMeansDataFile * file = vl_kmeans_data_file_new ("descrs.bin", VL_TYPE_FLOAT, 128) ;
+for (epoch = 0 ; epoch < numEpochs ; ++epoch) {
+  vl_kmeans_data_file_rewind (file) ;
+  vl_kmeans_cluster_mini_batch (kmeans, vl_kmeans_data_file_read, file,
+                                128, numCenters, 10000) ;
+}
+vl_kmeans_data_file_delete (file) ;
+@endcode
+
+::VlKMeansDataFile reads a raw array of points from a file, which
+is memory mapped where the platform supports it.
 **/
 
 /**
@@ -358,6 +376,38 @@ Experiments with the quantization of 128-dimensional SIFT features
 show that the ANN algorithm may use one quarter of the comparisons of
 Elkan's while retaining a similar solution accuracy.
 
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@section kmeans-mini-batch Mini-batch algorithm
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+All the algorithms above visit every data point at each iteration,
+and so require the data to be in memory. The mini-batch algorithm
+@cite{sculley10web-scale} instead processes the data in small
+batches, each visited only once per pass:
+
+1. **Quantization.** The points $\bx_i$ of the batch are assigned to
+   the closest centers $\bc_{q_i}$, which are kept fixed for the
+   whole batch.
+2. **Center update.** The points of the batch are visited in order,
+   and each updates its center as
+   \[
+   n_{q_i} \leftarrow n_{q_i} + 1,
+   \quad
+   \bc_{q_i} \leftarrow \bc_{q_i} + \frac{1}{n_{q_i}} (\bx_i - \bc_{q_i}),
+   \]
+   where $n_{q}$ counts the points used to update center $\bc_q$ so
+   far. Hence each center is the running mean of the points
+   assigned to it, with a per-center learning rate $1/n_q$.
+
+The counts $n_q$ persist across calls to
+::vl_kmeans_cluster_mini_batch and ::vl_kmeans_update_mini_batch,
+so that several passes over the data (epochs) can be run by calling
+the function repeatedly; they are reset when the centers are
+reinitialized. Since centers are updated independently, the update
+step is multithreaded as well as the quantization step. The
+centers are running means, which is the optimal update for the $l^2$
+distance only.
+
 */
 
 #include "kmeans.h"
@@ -365,13 +415,47 @@ Elkan's while retaining a similar solution accuracy.
 #include "mathop.h"
 #include <string.h>
 
-#ifdef _OPENMP
-#include <omp.h>
+#if defined(VL_OS_WIN)
+#include <stdio.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 /* ================================================================ */
 #ifndef VL_KMEANS_INSTANTIATING
 
+/** @internal @brief Data of the parallel loops of the K-means algorithms */
+typedef struct _VlKMeansLoop
+{
+  VlKMeans * self ;
+  void const * data ;
+  vl_size numData ;
+  vl_uint32 * assignments ;
+  void * distances ;
+
+  /* ANN quantization */
+  VlKDForestSearcher ** searchers ;
+  vl_bool update ;
+
+  /* Elkan's algorithm */
+  void * pointToClosestCenterUB ;
+  vl_bool * pointToClosestCenterUBIsStrict ;
+  void * pointToCenterLB ;
+  void const * nextCenterDistances ;
+  void const * centerToNewCenterDistances ;
+  vl_size * numDistanceComputationsToRefreshUB ; /* per task */
+  vl_size * numDistanceComputationsToRefreshLB ; /* per task */
+  vl_bool * allDone ;                            /* per task */
+
+  /* mini-batch */
+  vl_uint32 const * order ;
+  vl_size const * ends ;
+} VlKMeansLoop ;
+
 
 /** ------------------------------------------------------------------
  ** @brief Reset state
@@ -390,9 +474,11 @@ vl_kmeans_reset (VlKMeans * self)
 
   if (self->centers) vl_free(self->centers) ;
   if (self->centerDistances) vl_free(self->centerDistances) ;
+  if (self->centerCounts) vl_free(self->centerCounts) ;
 
   self->centers = NULL ;
   self->centerDistances = NULL ;
+  self->centerCounts = NULL ;
 }
 
 /** ------------------------------------------------------------------
@@ -417,6 +503,7 @@ vl_kmeans_new (vl_type dataType,
   self->numRepetitions = 1 ;
   self->centers = NULL ;
   self->centerDistances = NULL ;
+  self->centerCounts = NULL ;
   self->numTrees = 3;
   self->maxNumComparisons = 100;
 
@@ -447,6 +534,7 @@ vl_kmeans_new_copy (VlKMeans const * kmeans)
   self->numCenters = kmeans->numCenters ;
   self->centers = NULL ;
   self->centerDistances = NULL ;
+  self->centerCounts = NULL ;
 
   self->numTrees = kmeans->numTrees;
   self->maxNumComparisons = kmeans->maxNumComparisons;
@@ -463,6 +551,12 @@ vl_kmeans_new_copy (VlKMeans const * kmeans)
     memcpy (self->centerDistances, kmeans->centerDistances, dataSize) ;
   }
 
+  if (kmeans->centerCounts) {
+    vl_size dataSize = sizeof(vl_size) * self->numCenters ;
+    self->centerCounts = vl_malloc(dataSize) ;
+    memcpy (self->centerCounts, kmeans->centerCounts, dataSize) ;
+  }
+
   return self ;
 }
 
@@ -652,6 +746,46 @@ VL_XCAT(_vl_kmeans_init_centers_plus_plus_, SFX)
 /*                                                     Quantization */
 /* ---------------------------------------------------------------- */
 
+static void
+VL_XCAT(_vl_kmeans_quantize_range_, SFX)
+(void * loop_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlKMeansLoop const * loop = loop_ ;
+  VlKMeans const * self = loop->self ;
+  TYPE const * data = loop->data ;
+  TYPE * distances = loop->distances ;
+  vl_uint32 * assignments = loop->assignments ;
+  vl_uindex i ;
+
+#if (FLT == VL_TYPE_FLOAT)
+  VlFloatVectorComparisonFunction distFn = vl_get_vector_comparison_function_f(self->distance) ;
+#else
+  VlDoubleVectorComparisonFunction distFn = vl_get_vector_comparison_function_d(self->distance) ;
+#endif
+
+  /* vl_malloc cannot be used here if mapped to MATLAB malloc */
+  TYPE * distanceToCenters = malloc(sizeof(TYPE) * self->numCenters) ;
+
+  for (i = begin ; i < end ; ++i) {
+    vl_uindex k ;
+    TYPE bestDistance = (TYPE) VL_INFINITY_D ;
+    VL_XCAT(vl_eval_vector_comparison_on_all_pairs_, SFX)(distanceToCenters,
+                                                          self->dimension,
+                                                          data + self->dimension * i, 1,
+                                                          (TYPE*)self->centers, self->numCenters,
+                                                          distFn) ;
+    for (k = 0 ; k < self->numCenters ; ++k) {
+      if (distanceToCenters[k] < bestDistance) {
+        bestDistance = distanceToCenters[k] ;
+        assignments[i] = (vl_uint32)k ;
+      }
+    }
+    if (distances) distances[i] = bestDistance ;
+  }
+
+  free(distanceToCenters) ;
+}
+
 static void
 VL_XCAT(_vl_kmeans_quantize_, SFX)
 (VlKMeans * self,
@@ -660,7 +794,43 @@ VL_XCAT(_vl_kmeans_quantize_, SFX)
  TYPE const * data,
  vl_size numData)
 {
-  vl_index i ;
+  VlKMeansLoop loop ;
+
+  /* for the l2 distance, use the blocked nearest neighbor search
+     (or the generic loop if it runs out of memory) */
+  if (self->distance == VlDistanceL2 &&
+      VL_XCAT(vl_eval_l2_nearest_neighbors_, SFX)(assignments, distances, 1,
+                                                  self->dimension,
+                                                  data, numData,
+                                                  (TYPE const*)self->centers,
+                                                  self->numCenters,
+                                                  NULL) == VL_ERR_OK) {
+    return ;
+  }
+
+  loop.self = self ;
+  loop.data = data ;
+  loop.assignments = assignments ;
+  loop.distances = distances ;
+  vl_parallel_for (numData, 0, VL_XCAT(_vl_kmeans_quantize_range_, SFX), &loop) ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                                 ANN quantization */
+/* ---------------------------------------------------------------- */
+
+static void
+VL_XCAT(_vl_kmeans_quantize_ann_range_, SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlKMeansLoop const * loop = loop_ ;
+  VlKMeans const * self = loop->self ;
+  VlKDForestSearcher * searcher = loop->searchers[task] ;
+  TYPE const * data = loop->data ;
+  TYPE * distances = loop->distances ;
+  vl_uint32 * assignments = loop->assignments ;
+  VlKDForestNeighbor neighbor ;
+  vl_uindex x ;
 
 #if (FLT == VL_TYPE_FLOAT)
   VlFloatVectorComparisonFunction distFn = vl_get_vector_comparison_function_f(self->distance) ;
@@ -668,43 +838,30 @@ VL_XCAT(_vl_kmeans_quantize_, SFX)
   VlDoubleVectorComparisonFunction distFn = vl_get_vector_comparison_function_d(self->distance) ;
 #endif
 
-#ifdef _OPENMP
-#pragma omp parallel default(none) \
-            shared(self, distances, assignments, numData, distFn, data) \
-            num_threads(vl_get_max_threads())
-#endif
-  {
-    /* vl_malloc cannot be used here if mapped to MATLAB malloc */
-    TYPE * distanceToCenters = malloc(sizeof(TYPE) * self->numCenters) ;
+  for(x = begin ; x < end ; ++x) {
+    vl_kdforestsearcher_query (searcher, &neighbor, 1, (TYPE const *) (data + x*self->dimension));
 
-#ifdef _OPENMP
-#pragma omp for
-#endif
-    for (i = 0 ; i < (signed)numData ; ++i) {
-      vl_uindex k ;
-      TYPE bestDistance = (TYPE) VL_INFINITY_D ;
-      VL_XCAT(vl_eval_vector_comparison_on_all_pairs_, SFX)(distanceToCenters,
-                                                            self->dimension,
-                                                            data + self->dimension * i, 1,
-                                                            (TYPE*)self->centers, self->numCenters,
-                                                            distFn) ;
-      for (k = 0 ; k < self->numCenters ; ++k) {
-        if (distanceToCenters[k] < bestDistance) {
-          bestDistance = distanceToCenters[k] ;
-          assignments[i] = (vl_uint32)k ;
+    if (distances) {
+      if(!loop->update) {
+        distances[x] = (TYPE) neighbor.distance;
+        assignments[x] = (vl_uint32) neighbor.index ;
+      } else {
+        TYPE prevDist = (TYPE) distFn(self->dimension,
+                                      data + self->dimension * x,
+                                      (TYPE*)self->centers + self->dimension *assignments[x]);
+        if (prevDist > (TYPE) neighbor.distance) {
+          distances[x] = (TYPE) neighbor.distance ;
+          assignments[x] = (vl_uint32) neighbor.index ;
+        } else {
+          distances[x] = prevDist ;
         }
       }
-      if (distances) distances[i] = bestDistance ;
+    } else {
+      assignments[x] = (vl_uint32) neighbor.index ;
     }
-
-    free(distanceToCenters) ;
   }
 }
 
-/* ---------------------------------------------------------------- */
-/*                                                 ANN quantization */
-/* ---------------------------------------------------------------- */
-
 static void
 VL_XCAT(_vl_kmeans_quantize_ann_, SFX)
 (VlKMeans * self,
@@ -714,58 +871,29 @@ VL_XCAT(_vl_kmeans_quantize_ann_, SFX)
  vl_size numData,
  vl_bool update)
 {
-#if (FLT == VL_TYPE_FLOAT)
-  VlFloatVectorComparisonFunction distFn = vl_get_vector_comparison_function_f(self->distance) ;
-#else
-  VlDoubleVectorComparisonFunction distFn = vl_get_vector_comparison_function_d(self->distance) ;
-#endif
-
+  VlKMeansLoop loop ;
+  vl_size numTasks ;
+  vl_uindex task ;
   VlKDForest * forest = vl_kdforest_new(self->dataType,self->dimension,self->numTrees, self->distance) ;
   vl_kdforest_set_max_num_comparisons(forest,self->maxNumComparisons);
   vl_kdforest_set_thresholding_method(forest,VL_KDTREE_MEDIAN);
   vl_kdforest_build(forest,self->numCenters,self->centers);
 
-#ifdef _OPENMP
-#pragma omp parallel default(none) \
-  num_threads(vl_get_max_threads()) \
-  shared(self, forest, update, assignments, distances, data, numData, distFn)
-#endif
-  {
-    VlKDForestNeighbor neighbor ;
-    VlKDForestSearcher * searcher ;
-    vl_index x;
+  /* the searchers are registered with the forest and deleted with it */
+  numTasks = VL_MIN(vl_get_max_threads(), numData) ;
+  loop.self = self ;
+  loop.data = data ;
+  loop.assignments = assignments ;
+  loop.distances = distances ;
+  loop.update = update ;
+  loop.searchers = vl_malloc(sizeof(VlKDForestSearcher*) * numTasks) ;
+  for (task = 0 ; task < numTasks ; ++task) {
+    loop.searchers[task] = vl_kdforest_new_searcher (forest) ;
+  }
 
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-    searcher = vl_kdforest_new_searcher (forest) ;
+  vl_parallel_for (numData, numTasks, VL_XCAT(_vl_kmeans_quantize_ann_range_, SFX), &loop) ;
 
-#ifdef _OPENMP
-#pragma omp for
-#endif
-    for(x = 0 ; x < (signed)numData ; ++x) {
-      vl_kdforestsearcher_query (searcher, &neighbor, 1, (TYPE const *) (data + x*self->dimension));
-
-      if (distances) {
-        if(!update) {
-          distances[x] = (TYPE) neighbor.distance;
-          assignments[x] = (vl_uint32) neighbor.index ;
-        } else {
-          TYPE prevDist = (TYPE) distFn(self->dimension,
-                                        data + self->dimension * x,
-                                        (TYPE*)self->centers + self->dimension *assignments[x]);
-          if (prevDist > (TYPE) neighbor.distance) {
-            distances[x] = (TYPE) neighbor.distance ;
-            assignments[x] = (vl_uint32) neighbor.index ;
-          } else {
-            distances[x] = prevDist ;
-          }
-        }
-      } else {
-        assignments[x] = (vl_uint32) neighbor.index ;
-      }
-    } /* end for */
-  } /* end of parallel region */
+  vl_free(loop.searchers) ;
 
   vl_kdforest_delete(forest);
 }
@@ -1159,6 +1287,154 @@ VL_XCAT(_vl_kmeans_refine_centers_ann_, SFX)
 /*                                                 Elkan refinement */
 /* ---------------------------------------------------------------- */
 
+/*
+ The bounds of the data points are independent and are updated in
+ parallel. The reassignment tasks count their distance computations
+ separately; the counts are then added up in order.
+ */
+
+static void
+VL_XCAT(_vl_kmeans_elkan_update_lower_bounds_, SFX)
+(void * loop_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlKMeansLoop const * loop = loop_ ;
+  VlKMeans const * self = loop->self ;
+  TYPE * pointToCenterLB = loop->pointToCenterLB ;
+  TYPE const * centerToNewCenterDistances = loop->centerToNewCenterDistances ;
+  vl_uindex x ;
+  vl_uint32 c ;
+
+  for (x = begin ; x < end ; ++x) {
+    for (c = 0 ; c < self->numCenters ; ++c) {
+      TYPE a = pointToCenterLB[c + x * self->numCenters] ;
+      TYPE b = centerToNewCenterDistances[c] ;
+      if (a < b) {
+        pointToCenterLB[c + x * self->numCenters] = 0 ;
+      } else {
+        if (self->distance == VlDistanceL1) {
+          pointToCenterLB[c + x * self->numCenters]  = a - b ;
+        } else {
+#if (FLT == VL_TYPE_FLOAT)
+          TYPE sqrtab =  sqrtf (a * b) ;
+#else
+          TYPE sqrtab =  sqrt (a * b) ;
+#endif
+          pointToCenterLB[c + x * self->numCenters]  = a + b - 2.0 * sqrtab ;
+        }
+      }
+    }
+  }
+}
+
+static void
+VL_XCAT(_vl_kmeans_elkan_assign_, SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlKMeansLoop const * loop = loop_ ;
+  VlKMeans const * self = loop->self ;
+  TYPE const * data = loop->data ;
+  vl_uint32 * assignments = loop->assignments ;
+  TYPE * pointToClosestCenterUB = loop->pointToClosestCenterUB ;
+  vl_bool * pointToClosestCenterUBIsStrict = loop->pointToClosestCenterUBIsStrict ;
+  TYPE * pointToCenterLB = loop->pointToCenterLB ;
+  TYPE const * nextCenterDistances = loop->nextCenterDistances ;
+  vl_size numDistanceComputationsToRefreshUB = 0 ;
+  vl_size numDistanceComputationsToRefreshLB = 0 ;
+  vl_bool allDone = VL_TRUE ;
+  vl_uindex x ;
+  vl_uint32 c ;
+
+#if (FLT == VL_TYPE_FLOAT)
+  VlFloatVectorComparisonFunction distFn = vl_get_vector_comparison_function_f(self->distance) ;
+#else
+  VlDoubleVectorComparisonFunction distFn = vl_get_vector_comparison_function_d(self->distance) ;
+#endif
+
+  for (x = begin ; x < end ; ++ x) {
+    /*
+     A point x sticks with its current center assignmets[x]
+     the UB to d(x, c[assigmnets[x]]) is not larger than half
+     the distance of c[assigments[x]] to any other center c.
+     */
+    if (((self->distance == VlDistanceL1) ? 2.0 : 4.0) *
+        pointToClosestCenterUB[x] <= nextCenterDistances[assignments[x]]) {
+      continue ;
+    }
+
+    for (c = 0 ; c < self->numCenters ; ++c) {
+      vl_uint32 cx = assignments[x] ;
+      TYPE distance ;
+
+      /* The point is not reassigned to a given center c
+       if either:
+
+       0 - c is already the assigned center
+       1 - The UB of d(x, c[assignments[x]]) is smaller than half
+       the distance of c[assigments[x]] to c, OR
+       2 - The UB of d(x, c[assignmets[x]]) is smaller than the
+       LB of the distance of x to c.
+       */
+      if (cx == c) {
+        continue ;
+      }
+      if (((self->distance == VlDistanceL1) ? 2.0 : 4.0) *
+          pointToClosestCenterUB[x] <= ((TYPE*)self->centerDistances)
+          [c + cx * self->numCenters]) {
+        continue ;
+      }
+      if (pointToClosestCenterUB[x] <= pointToCenterLB
+          [c + x * self->numCenters]) {
+        continue ;
+      }
+
+      /* If the UB is loose, try recomputing it and test again */
+      if (! pointToClosestCenterUBIsStrict[x]) {
+        distance = distFn(self->dimension,
+                          data + self->dimension * x,
+                          (TYPE*)self->centers + self->dimension * cx) ;
+        pointToClosestCenterUB[x] = distance ;
+        pointToClosestCenterUBIsStrict[x] = VL_TRUE ;
+        pointToCenterLB[cx + x * self->numCenters] = distance ;
+        numDistanceComputationsToRefreshUB += 1 ;
+
+        if (((self->distance == VlDistanceL1) ? 2.0 : 4.0) *
+            pointToClosestCenterUB[x] <= ((TYPE*)self->centerDistances)
+            [c + cx * self->numCenters]) {
+          continue ;
+        }
+        if (pointToClosestCenterUB[x] <= pointToCenterLB
+            [c + x * self->numCenters]) {
+          continue ;
+        }
+      }
+
+      /*
+       Now the UB is strict (equal to d(x, assignments[x])), but
+       we still could not exclude that x should be reassigned to
+       c. We therefore compute the distance, update the LB,
+       and check if a reassigmnet must be made
+       */
+      distance = distFn(self->dimension,
+                        data + x * self->dimension,
+                        (TYPE*)self->centers + c *  self->dimension) ;
+      numDistanceComputationsToRefreshLB += 1 ;
+      pointToCenterLB[c + x * self->numCenters] = distance ;
+
+      if (distance < pointToClosestCenterUB[x]) {
+        assignments[x] = c ;
+        pointToClosestCenterUB[x] = distance ;
+        allDone = VL_FALSE ;
+        /* the UB strict flag is already set here */
+      }
+
+    } /* assign center */
+  } /* next data point */
+
+  loop->numDistanceComputationsToRefreshUB[task] = numDistanceComputationsToRefreshUB ;
+  loop->numDistanceComputationsToRefreshLB[task] = numDistanceComputationsToRefreshLB ;
+  loop->allDone[task] = allDone ;
+}
+
 static double
 VL_XCAT(_vl_kmeans_refine_centers_elkan_, SFX)
 (VlKMeans * self,
@@ -1192,6 +1468,10 @@ VL_XCAT(_vl_kmeans_refine_centers_elkan_, SFX)
 
   double energy ;
 
+  VlKMeansLoop loop ;
+  vl_size numTasks = vl_get_max_threads() ;
+  vl_uindex task ;
+
   vl_size totDistanceComputationsToInit = 0 ;
   vl_size totDistanceComputationsToRefreshUB = 0 ;
   vl_size totDistanceComputationsToRefreshLB = 0 ;
@@ -1299,6 +1579,19 @@ VL_XCAT(_vl_kmeans_refine_centers_elkan_, SFX)
   /*                          Iterations                            */
   /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+  loop.self = self ;
+  loop.data = data ;
+  loop.assignments = assignments ;
+  loop.pointToClosestCenterUB = pointToClosestCenterUB ;
+  loop.pointToClosestCenterUBIsStrict = pointToClosestCenterUBIsStrict ;
+  loop.pointToCenterLB = pointToCenterLB ;
+  loop.nextCenterDistances = nextCenterDistances ;
+  loop.centerToNewCenterDistances = centerToNewCenterDistances ;
+  loop.numDistanceComputationsToRefreshUB = vl_calloc (numTasks, sizeof(vl_size)) ;
+  loop.numDistanceComputationsToRefreshLB = vl_calloc (numTasks, sizeof(vl_size)) ;
+  loop.allDone = vl_malloc (sizeof(vl_bool) * numTasks) ;
+  for (task = 0 ; task < numTasks ; ++task) loop.allDone[task] = VL_TRUE ;
+
   for (iteration = 1 ; 1; ++iteration) {
 
     vl_size numDistanceComputationsToRefreshUB = 0 ;
@@ -1433,29 +1726,8 @@ VL_XCAT(_vl_kmeans_refine_centers_elkan_, SFX)
      based on the center variation.
      */
 
-#if defined(_OPENMP)
-#pragma omp parallel for default(shared) private(x,c) num_threads(vl_get_max_threads())
-#endif
-    for (x = 0 ; x < (signed)numData ; ++x) {
-      for (c = 0 ; c < self->numCenters ; ++c) {
-        TYPE a = pointToCenterLB[c + x * self->numCenters] ;
-        TYPE b = centerToNewCenterDistances[c] ;
-        if (a < b) {
-          pointToCenterLB[c + x * self->numCenters] = 0 ;
-        } else {
-          if (self->distance == VlDistanceL1) {
-            pointToCenterLB[c + x * self->numCenters]  = a - b ;
-          } else {
-#if (FLT == VL_TYPE_FLOAT)
-            TYPE sqrtab =  sqrtf (a * b) ;
-#else
-            TYPE sqrtab =  sqrt (a * b) ;
-#endif
-            pointToCenterLB[c + x * self->numCenters]  = a + b - 2.0 * sqrtab ;
-          }
-        }
-      }
-    }
+    vl_parallel_for (numData, 0,
+                     VL_XCAT(_vl_kmeans_elkan_update_lower_bounds_, SFX), &loop) ;
 
 #ifdef SANITY
     {
@@ -1485,98 +1757,15 @@ VL_XCAT(_vl_kmeans_refine_centers_elkan_, SFX)
      Scan the data and do the reassignments. Use the bounds to
      skip as many point-to-center distance calculations as possible.
      */
-    allDone = VL_TRUE ;
-
-#if defined(_OPENMP)
-#pragma omp parallel for \
-            default(none) \
-            shared(self,numData, \
-              pointToClosestCenterUB,pointToCenterLB, \
-              nextCenterDistances,pointToClosestCenterUBIsStrict, \
-              assignments,data,distFn,allDone) \
-            private(c,x) \
-            reduction(+:numDistanceComputationsToRefreshUB,numDistanceComputationsToRefreshLB) \
-            num_threads(vl_get_max_threads())
-#endif
-    for (x = 0 ; x < (signed)numData ; ++ x) {
-      /*
-       A point x sticks with its current center assignmets[x]
-       the UB to d(x, c[assigmnets[x]]) is not larger than half
-       the distance of c[assigments[x]] to any other center c.
-       */
-      if (((self->distance == VlDistanceL1) ? 2.0 : 4.0) *
-          pointToClosestCenterUB[x] <= nextCenterDistances[assignments[x]]) {
-        continue ;
-      }
-
-      for (c = 0 ; c < self->numCenters ; ++c) {
-        vl_uint32 cx = assignments[x] ;
-        TYPE distance ;
-
-        /* The point is not reassigned to a given center c
-         if either:
-
-         0 - c is already the assigned center
-         1 - The UB of d(x, c[assignments[x]]) is smaller than half
-         the distance of c[assigments[x]] to c, OR
-         2 - The UB of d(x, c[assignmets[x]]) is smaller than the
-         LB of the distance of x to c.
-         */
-        if (cx == c) {
-          continue ;
-        }
-        if (((self->distance == VlDistanceL1) ? 2.0 : 4.0) *
-            pointToClosestCenterUB[x] <= ((TYPE*)self->centerDistances)
-            [c + cx * self->numCenters]) {
-          continue ;
-        }
-        if (pointToClosestCenterUB[x] <= pointToCenterLB
-            [c + x * self->numCenters]) {
-          continue ;
-        }
-
-        /* If the UB is loose, try recomputing it and test again */
-        if (! pointToClosestCenterUBIsStrict[x]) {
-          distance = distFn(self->dimension,
-                            data + self->dimension * x,
-                            (TYPE*)self->centers + self->dimension * cx) ;
-          pointToClosestCenterUB[x] = distance ;
-          pointToClosestCenterUBIsStrict[x] = VL_TRUE ;
-          pointToCenterLB[cx + x * self->numCenters] = distance ;
-          numDistanceComputationsToRefreshUB += 1 ;
-
-          if (((self->distance == VlDistanceL1) ? 2.0 : 4.0) *
-              pointToClosestCenterUB[x] <= ((TYPE*)self->centerDistances)
-              [c + cx * self->numCenters]) {
-            continue ;
-          }
-          if (pointToClosestCenterUB[x] <= pointToCenterLB
-              [c + x * self->numCenters]) {
-            continue ;
-          }
-        }
-
-        /*
-         Now the UB is strict (equal to d(x, assignments[x])), but
-         we still could not exclude that x should be reassigned to
-         c. We therefore compute the distance, update the LB,
-         and check if a reassigmnet must be made
-         */
-        distance = distFn(self->dimension,
-                          data + x * self->dimension,
-                          (TYPE*)self->centers + c *  self->dimension) ;
-        numDistanceComputationsToRefreshLB += 1 ;
-        pointToCenterLB[c + x * self->numCenters] = distance ;
-
-        if (distance < pointToClosestCenterUB[x]) {
-          assignments[x] = c ;
-          pointToClosestCenterUB[x] = distance ;
-          allDone = VL_FALSE ;
-          /* the UB strict flag is already set here */
-        }
+    vl_parallel_for (numData, numTasks,
+                     VL_XCAT(_vl_kmeans_elkan_assign_, SFX), &loop) ;
 
-      } /* assign center */
-    } /* next data point */
+    allDone = VL_TRUE ;
+    for (task = 0 ; task < numTasks ; ++task) {
+      numDistanceComputationsToRefreshUB += loop.numDistanceComputationsToRefreshUB[task] ;
+      numDistanceComputationsToRefreshLB += loop.numDistanceComputationsToRefreshLB[task] ;
+      allDone &= loop.allDone[task] ;
+    }
 
 
     totDistanceComputationsToRefreshUB
@@ -1742,6 +1931,9 @@ VL_XCAT(_vl_kmeans_refine_centers_elkan_, SFX)
   vl_free(pointToCenterLB) ;
   vl_free(newCenters) ;
   vl_free(centerToNewCenterDistances) ;
+  vl_free(loop.numDistanceComputationsToRefreshUB) ;
+  vl_free(loop.numDistanceComputationsToRefreshLB) ;
+  vl_free(loop.allDone) ;
 
   return energy ;
 }
@@ -1771,6 +1963,81 @@ VL_XCAT(_vl_kmeans_refine_centers_, SFX)
   }
 }
 
+/* ---------------------------------------------------------------- */
+/*                                                       Mini-batch */
+/* ---------------------------------------------------------------- */
+
+static void
+VL_XCAT(_vl_kmeans_update_centers_, SFX)
+(void * loop_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlKMeansLoop const * loop = loop_ ;
+  VlKMeans * self = loop->self ;
+  TYPE const * data = loop->data ;
+  vl_uindex c, x ;
+
+  for (c = begin ; c < end ; ++c) {
+    vl_uindex last = (c + 1 < self->numCenters) ? loop->ends[c+1] : loop->numData ;
+    TYPE * cpt = (TYPE*)self->centers + c * self->dimension ;
+    for (x = loop->ends[c] ; x < last ; ++x) {
+      TYPE const * xpt = data + loop->order[x] * self->dimension ;
+      TYPE eta = (TYPE) 1 / (TYPE) (++ self->centerCounts[c]) ;
+      vl_uindex d ;
+      for (d = 0 ; d < self->dimension ; ++d) {
+        cpt[d] += eta * (xpt[d] - cpt[d]) ;
+      }
+    }
+  }
+}
+
+static double
+VL_XCAT(_vl_kmeans_update_mini_batch_, SFX)
+(VlKMeans * self,
+ TYPE const * data,
+ vl_size numData)
+{
+  vl_index c ;
+  vl_uindex x ;
+  double energy = 0 ;
+  vl_uint32 * assignments = vl_malloc (sizeof(vl_uint32) * numData) ;
+  TYPE * distances = vl_malloc (sizeof(TYPE) * numData) ;
+  vl_uint32 * order = vl_malloc (sizeof(vl_uint32) * numData) ;
+  vl_size * ends = vl_calloc (self->numCenters, sizeof(vl_size)) ;
+  VlKMeansLoop loop ;
+
+  if (self->centerCounts == NULL) {
+    self->centerCounts = vl_calloc (self->numCenters, sizeof(vl_size)) ;
+  }
+
+  /* assign the batch to the current centers */
+  VL_XCAT(_vl_kmeans_quantize_, SFX)(self, assignments, distances, data, numData) ;
+  for (x = 0 ; x < numData ; ++x) energy += distances[x] ;
+
+  /* bucket the points by center, preserving their order in the batch */
+  for (x = 0 ; x < numData ; ++x) ends[assignments[x]] ++ ;
+  for (c = 1 ; c < (signed)self->numCenters ; ++c) ends[c] += ends[c-1] ;
+  for (x = numData ; x > 0 ; --x) {
+    order[-- ends[assignments[x-1]]] = (vl_uint32)(x-1) ;
+  }
+  /* now ends[c] is the beginning of bucket c */
+
+  /* each center is a running mean of the points assigned to it so far;
+   centers are independent, so they can be updated in parallel */
+  loop.self = self ;
+  loop.data = data ;
+  loop.numData = numData ;
+  loop.order = order ;
+  loop.ends = ends ;
+  vl_parallel_for (self->numCenters, 0,
+                   VL_XCAT(_vl_kmeans_update_centers_, SFX), &loop) ;
+
+  vl_free (ends) ;
+  vl_free (order) ;
+  vl_free (distances) ;
+  vl_free (assignments) ;
+  return energy ;
+}
+
 /* VL_KMEANS_INSTANTIATING */
 #else
 
@@ -1901,6 +2168,10 @@ vl_kmeans_init_centers_plus_plus
  ** @param distances data to closest center distance (output).
  ** @param data data to quantize.
  ** @param numData number of data points to quantize.
+ **
+ ** For the ::VlDistanceL2 distance, the closest centers are found by
+ ** ::vl_eval_l2_nearest_neighbors_f (or its double counterpart),
+ ** which computes the distances in blocks as matrix products.
  **/
 
 VL_EXPORT void
@@ -2092,6 +2363,332 @@ vl_kmeans_cluster (VlKMeans * self,
   return bestEnergy ;
 }
 
+/* ---------------------------------------------------------------- */
+/*                                                       Mini-batch */
+/* ---------------------------------------------------------------- */
+
+/** ------------------------------------------------------------------
+ ** @brief Update the centers with a mini-batch of data
+ ** @param self KMeans object.
+ ** @param data batch of data points.
+ ** @param numData number of data points in the batch.
+ ** @return energy of the batch before the update.
+ **
+ ** The function assigns the points in @a data to the current
+ ** centers and moves each center towards the points assigned to it
+ ** with a per-center learning rate (see @ref kmeans-mini-batch).
+ ** The centers must have been initialized before calling this
+ ** function.
+ **/
+
+VL_EXPORT double
+vl_kmeans_update_mini_batch
+(VlKMeans * self,
+ void const * data,
+ vl_size numData)
+{
+  assert (self->centers) ;
+
+  switch (self->dataType) {
+    case VL_TYPE_FLOAT :
+      return
+        _vl_kmeans_update_mini_batch_f
+        (self, (float const *)data, numData) ;
+    case VL_TYPE_DOUBLE :
+      return
+        _vl_kmeans_update_mini_batch_d
+        (self, (double const *)data, numData) ;
+    default:
+      abort() ;
+  }
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Cluster data by the mini-batch algorithm
+ ** @param self KMeans object.
+ ** @param read data source callback.
+ ** @param source data source state, passed to @a read.
+ ** @param dimension data dimension.
+ ** @param numCenters number of clusters.
+ ** @param batchSize number of data points in a batch.
+ ** @return sum of the batch energies (see below).
+ **
+ ** The function runs one pass of the mini-batch algorithm (@ref
+ ** kmeans-mini-batch) over the data returned by @a read, until the
+ ** latter returns zero points.
+ **
+ ** If the KMeans object does not contain @a numCenters centers of
+ ** dimension @a dimension already, the centers are initialized first,
+ ** by applying the method set by ::vl_kmeans_set_initialization to the
+ ** first <code>max(batchSize, numCenters)</code> points of the
+ ** source. Otherwise the function resumes from the current centers,
+ ** so that calling it again after rewinding the source runs another
+ ** pass.
+ **
+ ** Since each point is compared to the centers at the time it is
+ ** visited, the returned energy is only an estimate of the energy of
+ ** the final centers. ::vl_kmeans_set_num_repetitions and the
+ ** termination criteria of the other algorithms are ignored.
+ **/
+
+VL_EXPORT double
+vl_kmeans_cluster_mini_batch (VlKMeans * self,
+                              VlKMeansReadFunction read,
+                              void * source,
+                              vl_size dimension,
+                              vl_size numCenters,
+                              vl_size batchSize)
+{
+  vl_size dataSize = vl_get_type_size(self->dataType) * dimension ;
+  vl_size numData ;
+  vl_uindex batch = 0 ;
+  void const * data ;
+  double energy = 0 ;
+  double timeRef = vl_get_cpu_time() ;
+
+  assert (batchSize > 0) ;
+
+  if (self->centers == NULL ||
+      self->dimension != dimension ||
+      self->numCenters != numCenters) {
+    vl_size numSeedData = VL_MAX(batchSize, numCenters) ;
+    char * seedData = vl_malloc (dataSize * numSeedData) ;
+    vl_size n = 0 ;
+
+    while (n < numSeedData &&
+           (numData = read (source, &data, numSeedData - n)) > 0) {
+      memcpy (seedData + dataSize * n, data, dataSize * numData) ;
+      n += numData ;
+    }
+    assert (n >= numCenters) ;
+
+    switch (self->initialization) {
+      case VlKMeansRandomSelection :
+        vl_kmeans_init_centers_with_rand_data (self, seedData, dimension, n, numCenters) ;
+        break ;
+      case VlKMeansPlusPlus :
+        vl_kmeans_init_centers_plus_plus (self, seedData, dimension, n, numCenters) ;
+        break ;
+      default:
+        abort() ;
+    }
+
+    if (self->verbosity) {
+      VL_PRINTF("kmeans: mini-batch initialized in %.2f s\n",
+                vl_get_cpu_time() - timeRef) ;
+    }
+
+    energy += vl_kmeans_update_mini_batch (self, seedData, n) ;
+    batch ++ ;
+    vl_free (seedData) ;
+  }
+
+  while ((numData = read (source, &data, batchSize)) > 0) {
+    double batchEnergy = vl_kmeans_update_mini_batch (self, data, numData) ;
+    energy += batchEnergy ;
+    if (self->verbosity) {
+      VL_PRINTF("kmeans: mini-batch %d: energy per point = %g\n", batch,
+                batchEnergy / numData) ;
+    }
+    batch ++ ;
+  }
+
+  if (self->verbosity) {
+    VL_PRINTF("kmeans: mini-batch terminated in %.2f s with energy %g\n",
+              vl_get_cpu_time() - timeRef, energy) ;
+  }
+
+  self->energy = energy ;
+  return energy ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                                        Data file */
+/* ---------------------------------------------------------------- */
+
+struct _VlKMeansDataFile
+{
+  vl_size dataSize ;   /**< Size of a data point in bytes. */
+  vl_size numData ;    /**< Number of data points in the file. */
+  vl_uindex next ;     /**< Index of the next point to read. */
+#if defined(VL_OS_WIN)
+  FILE * file ;        /**< File. */
+  void * buffer ;      /**< Batch buffer. */
+  vl_size bufferSize ; /**< Batch buffer size (number of points). */
+#else
+  void * map ;         /**< Memory mapped file. */
+  vl_size mapSize ;    /**< Memory mapped file size. */
+#endif
+} ;
+
+/** ------------------------------------------------------------------
+ ** @brief Open a data file as a mini-batch data source
+ ** @param fileName file name.
+ ** @param dataType type of data (::VL_TYPE_FLOAT or ::VL_TYPE_DOUBLE).
+ ** @param dimension data dimension.
+ ** @return new data file instance, or @c NULL on error.
+ **
+ ** The file must contain a raw array of points of dimension
+ ** @a dimension in native byte order, with no header. The file is
+ ** memory mapped on POSIX systems and read in batches otherwise.
+ ** On error, the function returns @c NULL and sets the last error
+ ** (see ::vl_get_last_error).
+ **/
+
+VL_EXPORT VlKMeansDataFile *
+vl_kmeans_data_file_new (char const * fileName,
+                         vl_type dataType,
+                         vl_size dimension)
+{
+  VlKMeansDataFile * self ;
+  vl_size dataSize = vl_get_type_size(dataType) * dimension ;
+  vl_size fileSize ;
+
+#if defined(VL_OS_WIN)
+  FILE * file = fopen (fileName, "rb") ;
+  if (file == NULL) {
+    vl_set_last_error (VL_ERR_IO, "Could not open '%s'", fileName) ;
+    return NULL ;
+  }
+  _fseeki64 (file, 0, SEEK_END) ;
+  fileSize = (vl_size) _ftelli64 (file) ;
+  _fseeki64 (file, 0, SEEK_SET) ;
+#else
+  struct stat info ;
+  void * map = NULL ;
+  int fd = open (fileName, O_RDONLY) ;
+  if (fd < 0 || fstat (fd, &info) < 0) {
+    if (fd >= 0) close (fd) ;
+    vl_set_last_error (VL_ERR_IO, "Could not open '%s'", fileName) ;
+    return NULL ;
+  }
+  fileSize = (vl_size) info.st_size ;
+#endif
+
+  if (dataSize == 0 || fileSize % dataSize != 0) {
+#if defined(VL_OS_WIN)
+    fclose (file) ;
+#else
+    close (fd) ;
+#endif
+    vl_set_last_error (VL_ERR_BAD_ARG,
+                       "The size of '%s' is not a multiple of the data size", fileName) ;
+    return NULL ;
+  }
+
+#if !defined(VL_OS_WIN)
+  if (fileSize > 0) {
+    map = mmap (NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) ;
+    if (map == MAP_FAILED) {
+      close (fd) ;
+      vl_set_last_error (VL_ERR_IO, "Could not map '%s'", fileName) ;
+      return NULL ;
+    }
+#if defined(MADV_SEQUENTIAL)
+    madvise (map, fileSize, MADV_SEQUENTIAL) ;
+#endif
+  }
+  /* the mapping stays valid after closing the descriptor */
+  close (fd) ;
+#endif
+
+  self = vl_calloc (1, sizeof(VlKMeansDataFile)) ;
+  self->dataSize = dataSize ;
+  self->numData = fileSize / dataSize ;
+  self->next = 0 ;
+#if defined(VL_OS_WIN)
+  self->file = file ;
+  self->buffer = NULL ;
+  self->bufferSize = 0 ;
+#else
+  self->map = map ;
+  self->mapSize = fileSize ;
+#endif
+  return self ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Delete a data file
+ ** @param self data file.
+ **/
+
+VL_EXPORT void
+vl_kmeans_data_file_delete (VlKMeansDataFile * self)
+{
+#if defined(VL_OS_WIN)
+  fclose (self->file) ;
+  if (self->buffer) vl_free (self->buffer) ;
+#else
+  if (self->map) munmap (self->map, self->mapSize) ;
+#endif
+  vl_free (self) ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Rewind a data file
+ ** @param self data file.
+ **
+ ** The next call to ::vl_kmeans_data_file_read returns the first
+ ** points of the file again.
+ **/
+
+VL_EXPORT void
+vl_kmeans_data_file_rewind (VlKMeansDataFile * self)
+{
+  self->next = 0 ;
+#if defined(VL_OS_WIN)
+  _fseeki64 (self->file, 0, SEEK_SET) ;
+#endif
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Get the number of data points in a data file
+ ** @param self data file.
+ ** @return number of data points.
+ **/
+
+VL_EXPORT vl_size
+vl_kmeans_data_file_get_num_data (VlKMeansDataFile const * self)
+{
+  return self->numData ;
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Read the next batch from a data file
+ ** @param source data file (a ::VlKMeansDataFile).
+ ** @param data pointer to the batch (output).
+ ** @param maxNumData maximum number of points to read.
+ ** @return number of points read.
+ **
+ ** The function has the signature of a ::VlKMeansReadFunction, so
+ ** that a data file can be passed to ::vl_kmeans_cluster_mini_batch.
+ ** With memory mapping, @a data points directly into the file
+ ** and no data is copied.
+ **/
+
+VL_EXPORT vl_size
+vl_kmeans_data_file_read (void * source,
+                          void const ** data,
+                          vl_size maxNumData)
+{
+  VlKMeansDataFile * self = source ;
+  vl_size numData = VL_MIN(maxNumData, self->numData - self->next) ;
+
+#if defined(VL_OS_WIN)
+  if (numData > self->bufferSize) {
+    self->buffer = vl_realloc (self->buffer, self->dataSize * numData) ;
+    self->bufferSize = numData ;
+  }
+  numData = fread (self->buffer, self->dataSize, numData, self->file) ;
+  *data = self->buffer ;
+#else
+  *data = (char const *)self->map + self->dataSize * self->next ;
+#endif
+
+  self->next += numData ;
+  return numData ;
+}
+
 /* VL_KMEANS_INSTANTIATING */
 #endif
 
@@ -38,6 +38,24 @@ typedef enum _VlKMeansInitialization {
   VlKMeansPlusPlus          /**< Plus plus raondomized selection */
 } VlKMeansInitialization ;
 
+/** @brief K-means mini-batch data source
+ ** @param source data source state.
+ ** @param data pointer to the next batch of points (output).
+ ** @param maxNumData maximum number of points to return.
+ ** @return number of points returned, or 0 when the source is exhausted.
+ **
+ ** The function sets @a data to point to at most @a maxNumData
+ ** consecutive data points. The batch must remain valid until the
+ ** next call. See ::vl_kmeans_cluster_mini_batch.
+ **/
+
+typedef vl_size (*VlKMeansReadFunction) (void * source,
+                                         void const ** data,
+                                         vl_size maxNumData) ;
+
+/** @brief K-means data file (mini-batch data source) */
+typedef struct _VlKMeansDataFile VlKMeansDataFile ;
+
 /** ------------------------------------------------------------------
  ** @brief K-means quantizer
  **/
@@ -61,6 +79,7 @@ typedef struct _VlKMeans
 
   void * centers ;                        /**< Centers */
   void * centerDistances ;                /**< Centers inter-distances. */
+  vl_size * centerCounts ;                /**< Mini-batch per-center update counts. */
 
   double energy ;                         /**< Current solution energy. */
   VlFloatVectorComparisonFunction floatVectorComparisonFn ;
@@ -128,6 +147,31 @@ VL_EXPORT double vl_kmeans_refine_centers (VlKMeans * self,
 
 /** @} */
 
+/** @name Mini-batch data processing
+ ** @{
+ **/
+VL_EXPORT double vl_kmeans_cluster_mini_batch (VlKMeans * self,
+                                               VlKMeansReadFunction read,
+                                               void * source,
+                                               vl_size dimension,
+                                               vl_size numCenters,
+                                               vl_size batchSize) ;
+
+VL_EXPORT double vl_kmeans_update_mini_batch (VlKMeans * self,
+                                              void const * data,
+                                              vl_size numData) ;
+
+VL_EXPORT VlKMeansDataFile * vl_kmeans_data_file_new (char const * fileName,
+                                                      vl_type dataType,
+                                                      vl_size dimension) ;
+VL_EXPORT void vl_kmeans_data_file_delete (VlKMeansDataFile * self) ;
+VL_EXPORT void vl_kmeans_data_file_rewind (VlKMeansDataFile * self) ;
+VL_EXPORT vl_size vl_kmeans_data_file_get_num_data (VlKMeansDataFile const * self) ;
+VL_EXPORT vl_size vl_kmeans_data_file_read (void * source,
+                                            void const ** data,
+                                            vl_size maxNumData) ;
+/** @} */
+
 /** @name Retrieve data and parameters
  ** @{
  **/
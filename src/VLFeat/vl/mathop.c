@@ -41,6 +41,10 @@ naive implementation.  ::vl_eval_vector_comparison_on_all_pairs_f and
 ::vl_eval_vector_comparison_on_all_pairs_d can be used to evaluate
 the comparison function on all pairs of one or two sequences of
 vectors.
+::vl_eval_l2_nearest_neighbors_f and ::vl_eval_l2_nearest_neighbors_d
+find the nearest neighbors of a set of vectors in another in the
+l2 sense; they are much faster than evaluating ::VlDistanceL2 on
+all pairs.
 
 Let @f$ \mathbf{x} = (x_1,\dots,x_d) @f$ and @f$ \mathbf{y} =
 (y_1,\dots,y_d) @f$ be two vectors.  The following comparison
@@ -191,6 +195,52 @@ includes and implementations of:
  ** @sa vl_eval_vector_comparison_on_all_pairs_f
  **/
 
+/** @fn vl_eval_l2_nearest_neighbors_f(vl_uint32*,float*,vl_size,vl_size,
+ **     float const*,vl_size,float const*,vl_size,float const*)
+ ** @brief Find the nearest neighbors in the l2 sense
+ ** @param indexes indexes of the neighbors (output).
+ ** @param distances squared distances of the neighbors (output, may be @c NULL).
+ ** @param numNeighbors number of neighbors to find for each vector.
+ ** @param dimension number of vector components.
+ ** @param X query vectors.
+ ** @param numDataX number of vectors in @a X.
+ ** @param Y database vectors.
+ ** @param numDataY number of vectors in @a Y.
+ ** @param normsY squared norms of the vectors in @a Y (may be @c NULL).
+ ** @return error code.
+ **
+ ** For each column of @a X, the function finds the @a numNeighbors
+ ** columns of @a Y with the smallest squared l2 distance and stores
+ ** their indexes, sorted by increasing distance, in the
+ ** corresponding column of the @a numNeighbors by @a numDataX matrix
+ ** @a indexes (and the distances in @a distances).
+ **
+ ** This is the same as evaluating ::VlDistanceL2 on all pairs and
+ ** sorting, but much faster when @a X and @a Y have many vectors.
+ ** The function uses the identity
+ ** @f$ \|x - y\|^2 = \|x\|^2 + \|y\|^2 - 2 \langle x, y \rangle @f$
+ ** and evaluates the inner products in cache-sized tiles, selecting
+ ** the neighbors as each tile is completed. Pass the squared norms of
+ ** @a Y in @a normsY if they are available (e.g. when the same
+ ** database is queried repeatedly). The selection is subject to the
+ ** rounding of the expansion, but @a distances are recomputed
+ ** directly. @a numNeighbors must not be larger than @a numDataY.
+ **
+ ** On CPUs with AVX the inner products are vectorized, using fused
+ ** multiply-add instructions where available. The tiles are
+ ** distributed among threads by ::vl_parallel_for.
+ **
+ ** The function returns ::VL_ERR_ALLOC if its working memory could
+ ** not be allocated, in which case the content of @a indexes and
+ ** @a distances is undefined, and ::VL_ERR_OK otherwise.
+ **/
+
+/** @fn vl_eval_l2_nearest_neighbors_d(vl_uint32*,double*,vl_size,vl_size,
+ **     double const*,vl_size,double const*,vl_size,double const*)
+ ** @brief Find the nearest neighbors in the l2 sense
+ ** @sa vl_eval_l2_nearest_neighbors_f
+ **/
+
 /**
 @page mathop-sqrti Fast integer square root algorithm
 @tableofcontents
@@ -264,8 +314,27 @@ optimal because $2^k > r$. This yields the algorithm:
 #include "mathop.h"
 #include "mathop_sse2.h"
  #include "mathop_avx.h"
+#include "mathop_fma.h"
 #include <math.h>
 
+/** @internal @brief Data of the parallel loop of ::vl_eval_l2_nearest_neighbors_f */
+typedef struct _VlL2NearestNeighborsLoop
+{
+  vl_uint32 * indexes ;
+  void * distances ;
+  vl_size numNeighbors ;
+  vl_size dimension ;
+  void const * X ;
+  vl_size numDataX ;
+  void const * Y ;
+  vl_size numDataY ;
+  void const * normsY ;
+  void * dots ;                 /**< Tile of dot products of each task. */
+  void * bestScores ;           /**< Candidate scores of each task. */
+  vl_bool useAvx ;
+  vl_bool useFma ;
+} VlL2NearestNeighborsLoop ;
+
 #undef FLT
 #define FLT VL_TYPE_FLOAT
 #define VL_MATHOP_INSTANTIATING
@@ -595,6 +664,202 @@ VL_XCAT(vl_eval_vector_comparison_on_all_pairs_, SFX)
   }
 }
 
+/* ---------------------------------------------------------------- */
+
+/** @internal @brief Number of columns of @c X processed in a tile */
+#define VL_L2NN_BLOCK_X 32
+/** @internal @brief Number of columns of @c Y processed in a tile */
+#define VL_L2NN_BLOCK_Y 256
+
+static void
+VL_XCAT(_vl_dot_block_, SFX)
+(T * dots, vl_size dimension,
+ T const * X, vl_size numDataX,
+ T const * Y, vl_size numDataY,
+ COMPARISONFUNCTION_TYPE kernel)
+{
+  vl_uindex xi, yi ;
+  for (xi = 0 ; xi < numDataX ; ++ xi) {
+    for (yi = 0 ; yi < numDataY ; ++ yi) {
+      *dots++ = (*kernel)(dimension,
+                          X + dimension * xi,
+                          Y + dimension * yi) ;
+    }
+  }
+}
+
+/** @internal
+ ** @brief Find the nearest neighbors of a range of blocks of @c X
+ ** @param loop_ loop data (::VlL2NearestNeighborsLoop).
+ ** @param task task index.
+ ** @param begin first block.
+ ** @param end block following the last one.
+ **/
+
+static void
+VL_XCAT(_vl_eval_l2_nearest_neighbors_range_, SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlL2NearestNeighborsLoop const * loop = loop_ ;
+  COMPARISONFUNCTION_TYPE kernel =
+    VL_XCAT(vl_get_vector_comparison_function_, SFX)(VlKernelL2) ;
+  COMPARISONFUNCTION_TYPE distance =
+    VL_XCAT(vl_get_vector_comparison_function_, SFX)(VlDistanceL2) ;
+  vl_size numNeighbors = loop->numNeighbors ;
+  vl_size dimension = loop->dimension ;
+  vl_size numDataX = loop->numDataX ;
+  vl_size numDataY = loop->numDataY ;
+  T const * X = loop->X ;
+  T const * Y = loop->Y ;
+  T const * normsY = loop->normsY ;
+  T * distances = loop->distances ;
+  T * dots = (T*)loop->dots + VL_L2NN_BLOCK_X * VL_L2NN_BLOCK_Y * task ;
+  T * bestScores = (T*)loop->bestScores + VL_L2NN_BLOCK_X * numNeighbors * task ;
+  vl_uindex block ;
+
+  for (block = begin ; block < end ; ++ block) {
+    vl_uindex x0 = block * VL_L2NN_BLOCK_X ;
+    vl_size numBlockX = VL_MIN(VL_L2NN_BLOCK_X, numDataX - x0) ;
+    vl_uint32 * bestIndexes = loop->indexes + numNeighbors * x0 ;
+    vl_uindex y0, xi, yi, k ;
+
+    for (k = 0 ; k < numBlockX * numNeighbors ; ++ k) {
+      bestScores[k] = (T) VL_INFINITY_D ;
+      bestIndexes[k] = 0 ;
+    }
+
+    /* ||x - y||^2 = ||x||^2 + ||y||^2 - 2 <x,y>; since ||x||^2 does
+       not depend on y, rank the candidates by ||y||^2 - 2 <x,y> */
+    for (y0 = 0 ; y0 < numDataY ; y0 += VL_L2NN_BLOCK_Y) {
+      vl_size numBlockY = VL_MIN(VL_L2NN_BLOCK_Y, numDataY - y0) ;
+#ifndef VL_DISABLE_AVX
+      if (loop->useFma) {
+        VL_XCAT(_vl_dot_block_fma_, SFX)(dots, dimension,
+                                         X + dimension * x0, numBlockX,
+                                         Y + dimension * y0, numBlockY) ;
+      } else if (loop->useAvx) {
+        VL_XCAT(_vl_dot_block_avx_, SFX)(dots, dimension,
+                                         X + dimension * x0, numBlockX,
+                                         Y + dimension * y0, numBlockY) ;
+      } else
+#endif
+      {
+        VL_XCAT(_vl_dot_block_, SFX)(dots, dimension,
+                                     X + dimension * x0, numBlockX,
+                                     Y + dimension * y0, numBlockY,
+                                     kernel) ;
+      }
+      for (xi = 0 ; xi < numBlockX ; ++ xi) {
+        T const * dotsx = dots + numBlockY * xi ;
+        T * scores = bestScores + numNeighbors * xi ;
+        vl_uint32 * ids = bestIndexes + numNeighbors * xi ;
+        for (yi = 0 ; yi < numBlockY ; ++ yi) {
+          T score = normsY[y0 + yi] - 2 * dotsx[yi] ;
+          if (score < scores[numNeighbors - 1]) {
+            /* insert keeping the list sorted (ties favour the
+               lowest index, as in a linear scan) */
+            for (k = numNeighbors - 1 ; k > 0 && scores[k-1] > score ; -- k) {
+              scores[k] = scores[k-1] ;
+              ids[k] = ids[k-1] ;
+            }
+            scores[k] = score ;
+            ids[k] = (vl_uint32)(y0 + yi) ;
+          }
+        }
+      }
+    }
+
+    /* the expansion loses precision when the vectors are close, so
+       the distances to the selected neighbors are recomputed */
+    if (distances) {
+      for (xi = 0 ; xi < numBlockX ; ++ xi) {
+        T const * x = X + dimension * (x0 + xi) ;
+        T * dists = distances + numNeighbors * (x0 + xi) ;
+        vl_uint32 * ids = bestIndexes + numNeighbors * xi ;
+        for (k = 0 ; k < numNeighbors ; ++ k) {
+          vl_uindex j ;
+          T dist = (*distance)(dimension, x, Y + dimension * ids[k]) ;
+          vl_uint32 id = ids[k] ;
+          for (j = k ; j > 0 && dists[j-1] > dist ; -- j) {
+            dists[j] = dists[j-1] ;
+            ids[j] = ids[j-1] ;
+          }
+          dists[j] = dist ;
+          ids[j] = id ;
+        }
+      }
+    }
+  }
+}
+
+VL_EXPORT int
+VL_XCAT(vl_eval_l2_nearest_neighbors_, SFX)
+(vl_uint32 * indexes, T * distances, vl_size numNeighbors,
+ vl_size dimension,
+ T const * X, vl_size numDataX,
+ T const * Y, vl_size numDataY,
+ T const * normsY)
+{
+  COMPARISONFUNCTION_TYPE kernel =
+    VL_XCAT(vl_get_vector_comparison_function_, SFX)(VlKernelL2) ;
+  VlL2NearestNeighborsLoop loop ;
+  vl_size numBlocks = (numDataX + VL_L2NN_BLOCK_X - 1) / VL_L2NN_BLOCK_X ;
+  vl_size numTasks ;
+  T * norms = NULL ;
+  int error = VL_ERR_OK ;
+
+  if (numDataX == 0) return VL_ERR_OK ;
+  assert (numNeighbors >= 1) ;
+  assert (numNeighbors <= numDataY) ;
+  assert (X) ;
+  assert (Y) ;
+
+  if (normsY == NULL) {
+    vl_uindex yi ;
+    norms = vl_malloc (sizeof(T) * numDataY) ;
+    if (norms == NULL) return VL_ERR_ALLOC ;
+    for (yi = 0 ; yi < numDataY ; ++ yi) {
+      norms[yi] = (*kernel)(dimension,
+                            Y + dimension * yi,
+                            Y + dimension * yi) ;
+    }
+    normsY = norms ;
+  }
+
+  /* each task works on its own tile of scores */
+  numTasks = VL_MIN(vl_get_max_threads(), numBlocks) ;
+  loop.indexes = indexes ;
+  loop.distances = distances ;
+  loop.numNeighbors = numNeighbors ;
+  loop.dimension = dimension ;
+  loop.X = X ;
+  loop.numDataX = numDataX ;
+  loop.Y = Y ;
+  loop.numDataY = numDataY ;
+  loop.normsY = normsY ;
+  loop.dots = vl_malloc (sizeof(T) * VL_L2NN_BLOCK_X * VL_L2NN_BLOCK_Y * numTasks) ;
+  loop.bestScores = vl_malloc (sizeof(T) * VL_L2NN_BLOCK_X * numNeighbors * numTasks) ;
+#ifndef VL_DISABLE_AVX
+  loop.useAvx = vl_cpu_has_avx() && vl_get_simd_enabled() ;
+  loop.useFma = loop.useAvx && vl_cpu_has_fma() ;
+#else
+  loop.useAvx = VL_FALSE ;
+  loop.useFma = VL_FALSE ;
+#endif
+
+  if (loop.dots && loop.bestScores) {
+    vl_parallel_for (numBlocks, numTasks,
+                     VL_XCAT(_vl_eval_l2_nearest_neighbors_range_, SFX), &loop) ;
+  } else {
+    error = VL_ERR_ALLOC ;
+  }
+
+  if (loop.dots) vl_free (loop.dots) ;
+  if (loop.bestScores) vl_free (loop.bestScores) ;
+  if (norms) vl_free (norms) ;
+  return error ;
+}
+
 /* VL_MATHOP_INSTANTIATING */
 #endif
 
@@ -687,6 +687,20 @@ vl_eval_vector_comparison_on_all_pairs_d (double * result, vl_size dimension,
                                           double const * Y, vl_size numDataY,
                                           VlDoubleVectorComparisonFunction function) ;
 
+VL_EXPORT int
+vl_eval_l2_nearest_neighbors_f (vl_uint32 * indexes, float * distances,
+                                vl_size numNeighbors, vl_size dimension,
+                                float const * X, vl_size numDataX,
+                                float const * Y, vl_size numDataY,
+                                float const * normsY) ;
+
+VL_EXPORT int
+vl_eval_l2_nearest_neighbors_d (vl_uint32 * indexes, double * distances,
+                                vl_size numNeighbors, vl_size dimension,
+                                double const * X, vl_size numDataX,
+                                double const * Y, vl_size numDataY,
+                                double const * normsY) ;
+
 /* ---------------------------------------------------------------- */
 /*                                               Numerical analysis */
 /* ---------------------------------------------------------------- */
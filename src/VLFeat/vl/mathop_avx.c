@@ -110,6 +110,93 @@ VL_XCAT(_vl_distance_l2_avx_, SFX)
   return acc ;
 }
 
+VL_INLINE T
+VL_XCAT(_vl_distance_l2_tail_avx_, SFX)
+(T acc, T const * X, T const * Y, T const * X_end)
+{
+  while (X < X_end) {
+    T delta = *X++ - *Y++ ;
+    acc += delta * delta ;
+  }
+  return acc ;
+}
+
+VL_EXPORT void
+VL_XCAT(_vl_distance_l2_block_avx_, SFX)
+(T * distances, vl_size dimension,
+ T const * X,
+ T const * Y, vl_size numDataY)
+{
+  /* same operations as _vl_distance_l2_avx for each Y, but four Y
+   are processed together to reuse the loads of X */
+  T const * X_end = X + dimension ;
+  T const * X_vec_end = X_end - VSIZEavx + 1 ;
+  vl_uindex yi = 0 ;
+
+  for ( ; yi + 4 <= numDataY ; yi += 4) {
+    T const * y0 = Y + dimension * yi ;
+    T const * y1 = y0 + dimension ;
+    T const * y2 = y1 + dimension ;
+    T const * y3 = y2 + dimension ;
+    T const * x = X ;
+    VTYPEavx vacc0 = VSTZavx() ;
+    VTYPEavx vacc1 = VSTZavx() ;
+    VTYPEavx vacc2 = VSTZavx() ;
+    VTYPEavx vacc3 = VSTZavx() ;
+    vl_uindex d = 0 ;
+    while (x < X_vec_end) {
+      VTYPEavx a = VLDUavx(x) ;
+      VTYPEavx delta0 = VSUBavx(a, VLDUavx(y0 + d)) ;
+      VTYPEavx delta1 = VSUBavx(a, VLDUavx(y1 + d)) ;
+      VTYPEavx delta2 = VSUBavx(a, VLDUavx(y2 + d)) ;
+      VTYPEavx delta3 = VSUBavx(a, VLDUavx(y3 + d)) ;
+      vacc0 = VADDavx(vacc0, VMULavx(delta0, delta0)) ;
+      vacc1 = VADDavx(vacc1, VMULavx(delta1, delta1)) ;
+      vacc2 = VADDavx(vacc2, VMULavx(delta2, delta2)) ;
+      vacc3 = VADDavx(vacc3, VMULavx(delta3, delta3)) ;
+      x += VSIZEavx ;
+      d += VSIZEavx ;
+    }
+    distances[yi+0] = VL_XCAT(_vl_distance_l2_tail_avx_, SFX)
+      (VL_XCAT(_vl_vhsum_avx_, SFX)(vacc0), x, y0 + d, X_end) ;
+    distances[yi+1] = VL_XCAT(_vl_distance_l2_tail_avx_, SFX)
+      (VL_XCAT(_vl_vhsum_avx_, SFX)(vacc1), x, y1 + d, X_end) ;
+    distances[yi+2] = VL_XCAT(_vl_distance_l2_tail_avx_, SFX)
+      (VL_XCAT(_vl_vhsum_avx_, SFX)(vacc2), x, y2 + d, X_end) ;
+    distances[yi+3] = VL_XCAT(_vl_distance_l2_tail_avx_, SFX)
+      (VL_XCAT(_vl_vhsum_avx_, SFX)(vacc3), x, y3 + d, X_end) ;
+  }
+  for ( ; yi < numDataY ; ++yi) {
+    distances[yi] = VL_XCAT(_vl_distance_l2_avx_, SFX)(dimension, X, Y + dimension * yi) ;
+  }
+}
+
+VL_EXPORT T
+VL_XCAT(_vl_kernel_l2_avx_, SFX)
+(vl_size dimension, T const * X, T const * Y)
+{
+  T const * X_end = X + dimension ;
+  T const * X_vec_end = X_end - VSIZEavx + 1 ;
+  T acc ;
+  VTYPEavx vacc = VSTZavx() ;
+
+  while (X < X_vec_end) {
+    VTYPEavx a = VLDUavx(X) ;
+    VTYPEavx b = VLDUavx(Y) ;
+    vacc = VADDavx(vacc, VMULavx(a, b)) ;
+    X += VSIZEavx ;
+    Y += VSIZEavx ;
+  }
+
+  acc = VL_XCAT(_vl_vhsum_avx_, SFX)(vacc) ;
+
+  while (X < X_end) {
+    acc += *X++ * *Y++ ;
+  }
+
+  return acc ;
+}
+
 VL_EXPORT T
 VL_XCAT(_vl_distance_mahalanobis_sq_avx_, SFX)
 (vl_size dimension, T const * X, T const * MU, T const * S)
@@ -269,6 +356,66 @@ VL_XCAT(_vl_weighted_sigma_avx_, SFX)
   }
 }
 
+VL_EXPORT void
+VL_XCAT(_vl_dot_block_avx_, SFX)
+(T * dots, vl_size dimension,
+ T const * X, vl_size numDataX,
+ T const * Y, vl_size numDataY)
+{
+  /* inner products of two rows of X and four rows of Y at a time,
+     keeping the eight partial sums in registers */
+  vl_size const numVec = dimension / VSIZEavx ;
+  vl_uindex xi = 0, yi, d ;
+
+  for ( ; xi + 2 <= numDataX ; xi += 2) {
+    T const * x0 = X + dimension * xi ;
+    T const * x1 = x0 + dimension ;
+    T * dots0 = dots + numDataY * xi ;
+    T * dots1 = dots0 + numDataY ;
+    for (yi = 0 ; yi + 4 <= numDataY ; yi += 4) {
+      T const * y0 = Y + dimension * yi ;
+      T const * y1 = y0 + dimension ;
+      T const * y2 = y1 + dimension ;
+      T const * y3 = y2 + dimension ;
+      VTYPEavx a00 = VSTZavx(), a01 = VSTZavx(), a02 = VSTZavx(), a03 = VSTZavx() ;
+      VTYPEavx a10 = VSTZavx(), a11 = VSTZavx(), a12 = VSTZavx(), a13 = VSTZavx() ;
+      for (d = 0 ; d < numVec * VSIZEavx ; d += VSIZEavx) {
+        VTYPEavx u0 = VLDUavx(x0 + d) ;
+        VTYPEavx u1 = VLDUavx(x1 + d) ;
+        VTYPEavx v ;
+        v = VLDUavx(y0 + d) ; a00 = VADDavx(a00, VMULavx(u0, v)) ; a10 = VADDavx(a10, VMULavx(u1, v)) ;
+        v = VLDUavx(y1 + d) ; a01 = VADDavx(a01, VMULavx(u0, v)) ; a11 = VADDavx(a11, VMULavx(u1, v)) ;
+        v = VLDUavx(y2 + d) ; a02 = VADDavx(a02, VMULavx(u0, v)) ; a12 = VADDavx(a12, VMULavx(u1, v)) ;
+        v = VLDUavx(y3 + d) ; a03 = VADDavx(a03, VMULavx(u0, v)) ; a13 = VADDavx(a13, VMULavx(u1, v)) ;
+      }
+      dots0[yi+0] = VL_XCAT(_vl_vhsum_avx_, SFX)(a00) ;
+      dots0[yi+1] = VL_XCAT(_vl_vhsum_avx_, SFX)(a01) ;
+      dots0[yi+2] = VL_XCAT(_vl_vhsum_avx_, SFX)(a02) ;
+      dots0[yi+3] = VL_XCAT(_vl_vhsum_avx_, SFX)(a03) ;
+      dots1[yi+0] = VL_XCAT(_vl_vhsum_avx_, SFX)(a10) ;
+      dots1[yi+1] = VL_XCAT(_vl_vhsum_avx_, SFX)(a11) ;
+      dots1[yi+2] = VL_XCAT(_vl_vhsum_avx_, SFX)(a12) ;
+      dots1[yi+3] = VL_XCAT(_vl_vhsum_avx_, SFX)(a13) ;
+      for ( ; d < dimension ; ++d) {
+        dots0[yi+0] += x0[d] * y0[d] ; dots1[yi+0] += x1[d] * y0[d] ;
+        dots0[yi+1] += x0[d] * y1[d] ; dots1[yi+1] += x1[d] * y1[d] ;
+        dots0[yi+2] += x0[d] * y2[d] ; dots1[yi+2] += x1[d] * y2[d] ;
+        dots0[yi+3] += x0[d] * y3[d] ; dots1[yi+3] += x1[d] * y3[d] ;
+      }
+    }
+    for ( ; yi < numDataY ; ++yi) {
+      dots0[yi] = VL_XCAT(_vl_kernel_l2_avx_, SFX)(dimension, x0, Y + dimension * yi) ;
+      dots1[yi] = VL_XCAT(_vl_kernel_l2_avx_, SFX)(dimension, x1, Y + dimension * yi) ;
+    }
+  }
+  for ( ; xi < numDataX ; ++xi) {
+    for (yi = 0 ; yi < numDataY ; ++yi) {
+      dots[numDataY * xi + yi] =
+        VL_XCAT(_vl_kernel_l2_avx_, SFX)(dimension, X + dimension * xi, Y + dimension * yi) ;
+    }
+  }
+}
+
 /* VL_DISABLE_AVX */
 #endif
 #undef VL_MATHOP_AVX_INSTANTIATING
@@ -46,6 +46,22 @@ VL_EXPORT T
 VL_XCAT(_vl_distance_l2_avx_, SFX)
 (vl_size dimension, T const * X, T const * Y);
 
+VL_EXPORT T
+VL_XCAT(_vl_kernel_l2_avx_, SFX)
+(vl_size dimension, T const * X, T const * Y);
+
+VL_EXPORT void
+VL_XCAT(_vl_distance_l2_block_avx_, SFX)
+(T * distances, vl_size dimension,
+ T const * X,
+ T const * Y, vl_size numDataY);
+
+VL_EXPORT void
+VL_XCAT(_vl_dot_block_avx_, SFX)
+(T * dots, vl_size dimension,
+ T const * X, vl_size numDataX,
+ T const * Y, vl_size numDataY);
+
 VL_EXPORT void
 VL_XCAT(_vl_weighted_sigma_avx_, SFX)
 (vl_size dimension, T * S, T const * X, T const * Y, T const W);
@@ -0,0 +1,142 @@
+/** @file mathop_fma.c
+ ** @brief mathop for AVX with FMA - Definition
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+/* ---------------------------------------------------------------- */
+#if ! defined(VL_MATHOP_FMA_INSTANTIATING)
+
+#include "mathop_fma.h"
+
+#undef FLT
+#define FLT VL_TYPE_DOUBLE
+#define VL_MATHOP_FMA_INSTANTIATING
+#include "mathop_fma.c"
+
+#undef FLT
+#define FLT VL_TYPE_FLOAT
+#define VL_MATHOP_FMA_INSTANTIATING
+#include "mathop_fma.c"
+
+/* ---------------------------------------------------------------- */
+/* VL_MATHOP_FMA_INSTANTIATING */
+#else
+#ifndef VL_DISABLE_AVX
+
+#if ! defined(__AVX__) || ! defined(__FMA__)
+#error Compiling FMA functions but FMA does not seem to be supported by the compiler.
+#endif
+
+#include <immintrin.h>
+#include "generic.h"
+#include "mathop.h"
+#include "float.th"
+
+VL_INLINE T
+VL_XCAT(_vl_vhsum_fma_, SFX)(VTYPEavx x)
+{
+  T acc ;
+#if (VSIZEavx == 8)
+  VTYPEavx hsum = VHADD2avx(x, x) ;
+  hsum = VADDavx(hsum, VPERMavx(hsum, hsum, 0x1)) ;
+  VST1(&acc, VHADDavx(VCSTavx(hsum), VCSTavx(hsum))) ;
+#else
+  VTYPEavx hsum = VADDavx(x, VPERMavx(x, x, 0x1)) ;
+  VST1(&acc, VHADDavx(VCSTavx(hsum), VCSTavx(hsum))) ;
+#endif
+  return acc ;
+}
+
+VL_INLINE T
+VL_XCAT(_vl_dot_fma_, SFX)
+(vl_size dimension, T const * X, T const * Y)
+{
+  vl_size const numVec = dimension / VSIZEavx ;
+  VTYPEavx vacc = VSTZavx() ;
+  vl_uindex d ;
+  T acc ;
+  for (d = 0 ; d < numVec * VSIZEavx ; d += VSIZEavx) {
+    vacc = VFMAavx(VLDUavx(X + d), VLDUavx(Y + d), vacc) ;
+  }
+  acc = VL_XCAT(_vl_vhsum_fma_, SFX)(vacc) ;
+  for ( ; d < dimension ; ++d) acc += X[d] * Y[d] ;
+  return acc ;
+}
+
+/** @internal @brief Inner products of all pairs of vectors of two blocks
+ **
+ ** Same as ::_vl_dot_block_avx_f, but the products are accumulated
+ ** with fused multiply-add instructions.
+ **/
+
+VL_EXPORT void
+VL_XCAT(_vl_dot_block_fma_, SFX)
+(T * dots, vl_size dimension,
+ T const * X, vl_size numDataX,
+ T const * Y, vl_size numDataY)
+{
+  /* inner products of two rows of X and four rows of Y at a time,
+     keeping the eight partial sums in registers */
+  vl_size const numVec = dimension / VSIZEavx ;
+  vl_uindex xi = 0, yi, d ;
+
+  for ( ; xi + 2 <= numDataX ; xi += 2) {
+    T const * x0 = X + dimension * xi ;
+    T const * x1 = x0 + dimension ;
+    T * dots0 = dots + numDataY * xi ;
+    T * dots1 = dots0 + numDataY ;
+    for (yi = 0 ; yi + 4 <= numDataY ; yi += 4) {
+      T const * y0 = Y + dimension * yi ;
+      T const * y1 = y0 + dimension ;
+      T const * y2 = y1 + dimension ;
+      T const * y3 = y2 + dimension ;
+      VTYPEavx a00 = VSTZavx(), a01 = VSTZavx(), a02 = VSTZavx(), a03 = VSTZavx() ;
+      VTYPEavx a10 = VSTZavx(), a11 = VSTZavx(), a12 = VSTZavx(), a13 = VSTZavx() ;
+      for (d = 0 ; d < numVec * VSIZEavx ; d += VSIZEavx) {
+        VTYPEavx u0 = VLDUavx(x0 + d) ;
+        VTYPEavx u1 = VLDUavx(x1 + d) ;
+        VTYPEavx v ;
+        v = VLDUavx(y0 + d) ; a00 = VFMAavx(u0, v, a00) ; a10 = VFMAavx(u1, v, a10) ;
+        v = VLDUavx(y1 + d) ; a01 = VFMAavx(u0, v, a01) ; a11 = VFMAavx(u1, v, a11) ;
+        v = VLDUavx(y2 + d) ; a02 = VFMAavx(u0, v, a02) ; a12 = VFMAavx(u1, v, a12) ;
+        v = VLDUavx(y3 + d) ; a03 = VFMAavx(u0, v, a03) ; a13 = VFMAavx(u1, v, a13) ;
+      }
+      dots0[yi+0] = VL_XCAT(_vl_vhsum_fma_, SFX)(a00) ;
+      dots0[yi+1] = VL_XCAT(_vl_vhsum_fma_, SFX)(a01) ;
+      dots0[yi+2] = VL_XCAT(_vl_vhsum_fma_, SFX)(a02) ;
+      dots0[yi+3] = VL_XCAT(_vl_vhsum_fma_, SFX)(a03) ;
+      dots1[yi+0] = VL_XCAT(_vl_vhsum_fma_, SFX)(a10) ;
+      dots1[yi+1] = VL_XCAT(_vl_vhsum_fma_, SFX)(a11) ;
+      dots1[yi+2] = VL_XCAT(_vl_vhsum_fma_, SFX)(a12) ;
+      dots1[yi+3] = VL_XCAT(_vl_vhsum_fma_, SFX)(a13) ;
+      for ( ; d < dimension ; ++d) {
+        dots0[yi+0] += x0[d] * y0[d] ; dots1[yi+0] += x1[d] * y0[d] ;
+        dots0[yi+1] += x0[d] * y1[d] ; dots1[yi+1] += x1[d] * y1[d] ;
+        dots0[yi+2] += x0[d] * y2[d] ; dots1[yi+2] += x1[d] * y2[d] ;
+        dots0[yi+3] += x0[d] * y3[d] ; dots1[yi+3] += x1[d] * y3[d] ;
+      }
+    }
+    for ( ; yi < numDataY ; ++yi) {
+      dots0[yi] = VL_XCAT(_vl_dot_fma_, SFX)(dimension, x0, Y + dimension * yi) ;
+      dots1[yi] = VL_XCAT(_vl_dot_fma_, SFX)(dimension, x1, Y + dimension * yi) ;
+    }
+  }
+  for ( ; xi < numDataX ; ++xi) {
+    for (yi = 0 ; yi < numDataY ; ++yi) {
+      dots[numDataY * xi + yi] =
+        VL_XCAT(_vl_dot_fma_, SFX)(dimension, X + dimension * xi, Y + dimension * yi) ;
+    }
+  }
+}
+
+/* VL_DISABLE_AVX */
+#endif
+#undef VL_MATHOP_FMA_INSTANTIATING
+#endif
@@ -0,0 +1,50 @@
+/** @file mathop_fma.h
+ ** @brief mathop for AVX with FMA
+ **/
+
+/*
+Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+/* ---------------------------------------------------------------- */
+#ifndef VL_MATHOP_FMA_H_INSTANTIATING
+
+#ifndef VL_MATHOP_FMA_H
+#define VL_MATHOP_FMA_H
+
+#undef FLT
+#define FLT VL_TYPE_DOUBLE
+#define VL_MATHOP_FMA_H_INSTANTIATING
+#include "mathop_fma.h"
+
+#undef FLT
+#define FLT VL_TYPE_FLOAT
+#define VL_MATHOP_FMA_H_INSTANTIATING
+#include "mathop_fma.h"
+
+/* VL_MATHOP_FMA_H */
+#endif
+
+/* ---------------------------------------------------------------- */
+/* VL_MATHOP_FMA_H_INSTANTIATING */
+#else
+
+#ifndef VL_DISABLE_AVX
+#include "generic.h"
+#include "float.th"
+
+VL_EXPORT void
+VL_XCAT(_vl_dot_block_fma_, SFX)
+(T * dots, vl_size dimension,
+ T const * X, vl_size numDataX,
+ T const * Y, vl_size numDataY);
+
+/* ! VL_DISABLE_AVX */
+#endif
+
+#undef VL_MATHOP_FMA_H_INSTANTIATING
+#endif
@@ -38,6 +38,8 @@ Running the MSER filter usually involves the following steps:
 
 - Initialize the MSER filter by ::vl_mser_new(). The
   filter can be reused for images of the same size.
+- Optionally select bright regions on a dark background by
+  ::vl_mser_set_bright_on_dark().
 - Compute the MSERs by ::vl_mser_process().
 - Optionally fit ellipsoids to the MSERs by  ::vl_mser_ell_fit().
 - Retrieve the results by ::vl_mser_get_regions() (and optionally ::vl_mser_get_ell()).
@@ -193,19 +195,34 @@ standard index order and ranges.
 @section mser-algo Algorithm
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 
-The algorithm is quite efficient. While some details may be
-tricky, the overall idea is easy to grasp.
-
-- Pixels are sorted by increasing intensity.
-- Pixels are added to a forest by increasing intensity. The forest has the
-  following properties:
-  - All the descendent of a certain pixels are subset of an extremal region.
-  - All the extremal regions are the descendants of some pixels.
-- Extremal regions are extracted from the region tree and the extremal regions tree is
-  calculated.
+The algorithm is the linear time flood fill of
+@cite{nister08linear}. While some details may be tricky, the overall
+idea is easy to grasp.
+
+- The image is flooded starting from an arbitrary pixel. Pixels on
+  the boundary of the flooded area are kept in a priority queue with
+  a bucket for each intensity level and the connected components
+  being grown are kept on a stack, sorted by level.
+- Each time the flood rises to a new level, the components on the
+  stack below that level are emitted as extremal regions and merged
+  as needed. This computes the extremal region tree directly, with
+  children emitted before their parents.
 - Stable regions are marked.
 - Duplicates and other bad regions are removed.
 
+Besides the extremal regions, the algorithm requires only a flag and a
+slot in the boundary queue per pixel. Images of type ::vl_mser_pix are
+processed by ::vl_mser_process() and 16 bit images by
+::vl_mser_process_ui16(). The filter extracts dark regions on a bright
+background; use ::vl_mser_set_bright_on_dark() to extract bright
+regions instead, and ::vl_mser_process_pair() to compute both
+polarities of an image concurrently with two filters.
+
+Ellipsoids are fitted by flooding the image a second time,
+accumulating the moments of the components on the stack. Hence the
+image passed to ::vl_mser_process() must not be modified or released
+before ::vl_mser_ell_fit() is called.
+
 @remark The extremal region tree which is calculated is a subset
 of the actual extremal region tree. In particular, it does not
 contain redundant entries extremal regions that coincide as
@@ -222,86 +239,389 @@ calculating the stability tests.
 #include<string.h>
 #include<assert.h>
 
+
+/** @internal @brief MSER: component on the flood stack */
+typedef struct _VlMserComp
+{
+  int      level ;  /**< level of the component                      */
+  int      pivot ;  /**< a pixel of the component with that level    */
+  vl_uint  area ;   /**< area of the component                       */
+  int      child ;  /**< emitted regions waiting for their parent    */
+} VlMserComp ;
+
 /** -------------------------------------------------------------------
- ** @brief Advance N-dimensional subscript
+ ** @internal
+ ** @brief Get the level of a pixel
  **
- ** The function increments by one the subscript @a subs indexing an
- ** array the @a ndims dimensions @a dims.
- **
- ** @param ndims number of dimensions.
- ** @param dims dimensions.
- ** @param subs subscript to advance.
+ ** @param f MSER filter.
+ ** @param idx pixel index.
+ ** @return level of the pixel @a idx of the last processed image.
  **/
 
-VL_INLINE void
-adv(int ndims, int const *dims, int *subs)
+VL_INLINE int
+_vl_mser_get_level (VlMserFilt const *f, int idx)
 {
-  int d = 0 ;
-  while(d < ndims) {
-    if( ++subs[d]  < dims[d] ) return ;
-    subs[d++] = 0 ;
+  int v ;
+  if (f-> im_type == VL_TYPE_UINT8) {
+    v = ((vl_uint8 const*) f-> im) [idx] ;
+    return f-> bright_on_dark ? 255 - v : v ;
   }
+  v = ((vl_uint16 const*) f-> im) [idx] ;
+  return f-> bright_on_dark ? 65535 - v : v ;
 }
 
 /** -------------------------------------------------------------------
- ** @brief Climb the region forest to reach aa root
+ ** @internal
+ ** @brief Index of the lowest set bit
  **
- ** The function climbs the regions forest @a r starting from the node
- ** @a idx to the corresponding root.
+ ** @param x non-null word.
+ ** @return index of the lowest bit of @a x set to one.
+ **/
+
+VL_INLINE int
+_vl_mser_lowest_bit (vl_uint32 x)
+{
+  static int const table [32] = {
+     0,  1, 28,  2, 29, 14, 24,  3, 30, 22, 20, 15, 25, 17,  4,  8,
+    31, 27, 13, 23, 21, 19, 16,  7, 26, 12, 18,  6, 11,  5, 10,  9 } ;
+  return table [((x & (~x + 1)) * 0x077CB531U) >> 27] ;
+}
+
+/** -------------------------------------------------------------------
+ ** @internal
+ ** @brief Find the lowest non-empty level of the boundary queue
  **
- ** To speed-up the operation, the function uses the
- ** VlMserReg::shortcut field to quickly jump to the root. After the
- ** root is reached, all the used shortcut are updated.
+ ** @param bits non-empty level flags.
+ ** @param sbits non-empty word flags.
+ ** @param nlevels number of levels.
+ ** @param level level to start from.
+ ** @return the lowest non-empty level not smaller than @a level, or
+ ** @a nlevels if there is none.
  **
- ** @param r regions' forest.
- ** @param idx stating node.
- ** @return index of the reached root.
+ ** The bit @c l of @a bits is set if the bucket @c l is not empty
+ ** and the bit @c w of @a sbits is set if the word @c w of @a bits
+ ** is not null.
  **/
 
-VL_INLINE vl_uint
-climb (VlMserReg* r, vl_uint idx)
+VL_INLINE int
+_vl_mser_next_level (vl_uint32 const *bits, vl_uint32 const *sbits,
+                     int nlevels, int level)
 {
+  int nwords = nlevels / 32 ;
+  int w = level >> 5 ;
+  int sw ;
+  vl_uint32 m = bits [w] & (0xffffffffU << (level & 31)) ;
+
+  if (m) return (w << 5) + _vl_mser_lowest_bit (m) ;
+
+  /* look for the next non-null word */
+  if (++ w >= nwords) return nlevels ;
+  sw = w >> 5 ;
+  m  = sbits [sw] & (0xffffffffU << (w & 31)) ;
+  while (! m) {
+    if (++ sw >= (nwords + 31) / 32) return nlevels ;
+    m = sbits [sw] ;
+  }
+  w = (sw << 5) + _vl_mser_lowest_bit (m) ;
+  return (w << 5) + _vl_mser_lowest_bit (bits [w]) ;
+}
 
-  vl_uint prev_idx = idx ;
-  vl_uint next_idx ;
-  vl_uint root_idx ;
+/** -------------------------------------------------------------------
+ ** @internal
+ ** @brief Flood the image
+ **
+ ** @param f MSER filter.
+ ** @param erp extremal regions (in/out).
+ ** @param ell ellipsoids (output) or @c NULL.
+ ** @return number of extremal regions.
+ **
+ ** The function floods the last image set in @a f by increasing
+ ** level @cite{nister08linear}, emitting the extremal regions in
+ ** order, children before parents.
+ **
+ ** If @a ell is @c NULL, the function allocates (by @c malloc) and
+ ** fills a new array of extremal regions, returned in @a erp.
+ **
+ ** Otherwise, the function reads the extremal regions from @a erp,
+ ** which must have been computed by a previous flood of the same
+ ** image, and writes the ellipsoid of each region with a non-null
+ ** VlMserExtrReg::max_stable number into the corresponding slot of
+ ** @a ell.
+ **
+ ** The function uses only @c malloc and the buffers of @a f, so
+ ** that different filters can be flooded in parallel.
+ **/
 
-  /* move towards root to find it */
-  while (1) {
+static int
+_vl_mser_flood (VlMserFilt const *f, VlMserExtrReg **erp, float *ell)
+{
+  /* shortcuts */
+  int            nel       = f-> nel ;
+  int            ndims     = f-> ndims ;
+  int            nnbrs     = f-> nnbrs ;
+  int            dof       = f-> dof ;
+  int const     *dims      = f-> dims ;
+  int const     *strides   = f-> strides ;
+  int const     *nbr_offs  = f-> nbr_offs ;
+  int const     *nbr_dsubs = f-> nbr_dsubs ;
+  int           *subs      = f-> subs ;
+  int            nlevels   = (f-> im_type == VL_TYPE_UINT8) ? 256 : 65536 ;
+  int            nwords    = nlevels / 32 ;
+
+  VlMserExtrReg *er        = *erp ;
+  int            ner       = 0 ;
+  int            rer       = 0 ;
+
+  vl_uint8      *visited   = calloc (nel, sizeof(vl_uint8)) ;
+  vl_uint32     *boundary  = malloc (sizeof(vl_uint32) * nel) ;
+  vl_uint32     *base      = calloc (nlevels, sizeof(vl_uint32)) ;
+  vl_uint32     *top       = malloc (sizeof(vl_uint32) * nlevels) ;
+  vl_uint32     *bits      = calloc (nwords + (nwords + 31) / 32, sizeof(vl_uint32)) ;
+  vl_uint32     *sbits     = bits + nwords ;
+  VlMserComp    *comps     = malloc (sizeof(VlMserComp) * (nlevels + 1)) ;
+  double        *mom       = 0 ;
+  int           *mi        = 0 ;
+  int           *mj        = 0 ;
+
+  int ncomps, idx, level, edge, i, j, k, d ;
 
-    /* next jump to the root */
-    next_idx = r [idx] .shortcut ;
+  /* -----------------------------------------------------------------
+   *                                        Allocate the buckets
+   * -------------------------------------------------------------- */
 
-    /* recycle shortcut to remember how we came here */
-    r [idx] .shortcut = prev_idx ;
+  /* a level bucket never holds more pixels than there are pixels with
+     that level as each pixel enters the boundary at most once at a
+     time */
+  for (idx = 0 ; idx < nel ; ++idx) {
+    ++ base [_vl_mser_get_level (f, idx)] ;
+  }
+  for (k = 0, i = 0 ; k < nlevels ; ++k) {
+    vl_uint32 n = base [k] ;
+    base [k] = top [k] = i ;
+    i += n ;
+  }
 
-    /* stop if the root is found */
-    if( next_idx == idx ) break ;
+  if (ell) {
+    /* moments of the components on the stack */
+    mom = malloc (sizeof(double) * dof * (nlevels + 1)) ;
 
-    /* next guy */
-    prev_idx = idx ;
-    idx      = next_idx ;
+    /* map the dof d to a second order moment E[x_i x_j] */
+    mi = malloc (sizeof(int) * 2 * dof) ;
+    mj = mi + dof ;
+    for (d = ndims ; d < dof ; ++d) {
+      i = d - ndims ;
+      j = 0 ;
+      while (i > j) {
+        i -= j + 1 ;
+        j ++ ;
+      }
+      mi [d] = i ;
+      mj [d] = j ;
+    }
+  } else {
+    rer = nel / 8 + 16 ;
+    er  = malloc (sizeof(VlMserExtrReg) * rer) ;
   }
 
-  root_idx = idx ;
+  /* -----------------------------------------------------------------
+   *                                                             Flood
+   * -------------------------------------------------------------- */
+
+  /*
+     In the following:
+
+     idx    : index of the current pixel
+     level  : level of the current pixel
+     edge   : next neighbor of the current pixel to examine
+     comps  : stack of components, the top one contains idx
+
+     VISITED is zero for pixels not reached yet and one plus the next
+     neighbor to examine for the others. The bottom of the stack is a
+     sentinel component with level higher than any pixel.
+  */
+
+  comps [0] .level = nlevels ;
+  comps [0] .pivot = 0 ;
+  comps [0] .area  = 0 ;
+  comps [0] .child = -1 ;
+
+  /* start from the first pixel */
+  idx   = 0 ;
+  level = _vl_mser_get_level (f, idx) ;
+  edge  = 0 ;
+  visited [idx] = 1 ;
+
+  comps [1] .level = level ;
+  comps [1] .pivot = idx ;
+  comps [1] .area  = 0 ;
+  comps [1] .child = -1 ;
+  if (mom) memset (mom + dof, 0, sizeof(double) * dof) ;
+  ncomps = 2 ;
 
-  /* move backward to update shortcuts */
   while (1) {
 
-    /* get previously visited one */
-    prev_idx = r [idx] .shortcut ;
+  explore :
 
-    /* update shortcut to point to the new root */
-    r [idx] .shortcut = root_idx ;
+    /* convert the index IDX into the subscript SUBS */
+    {
+      int temp = idx ;
+      for (k = ndims - 1 ; k >= 0 ; --k) {
+        subs [k] = temp / strides [k] ;
+        temp     = temp % strides [k] ;
+      }
+    }
 
-    /* stop if the first visited node is reached */
-    if( prev_idx == idx ) break ;
+    /* examine the neighbors of the current pixel */
+    for ( ; edge < nnbrs ; ++ edge) {
+      int const *dsubs = nbr_dsubs + edge * ndims ;
+      int n_idx, n_level ;
+      vl_bool good = 1 ;
 
-    /* next guy */
-    idx = prev_idx ;
-  }
+      for (k = 0 ; k < ndims ; ++k) {
+        int temp  = dsubs [k] + subs [k] ;
+        good     &= (0 <= temp) && (temp < dims [k]) ;
+      }
+      if (! good) continue ;
+
+      n_idx = idx + nbr_offs [edge] ;
+      if (visited [n_idx]) continue ;
+      visited [n_idx] = 1 ;
+      n_level = _vl_mser_get_level (f, n_idx) ;
+
+      if (n_level >= level) {
+        /* add the neighbor to the boundary */
+        boundary [top [n_level] ++] = n_idx ;
+        bits  [n_level >> 5]  |= 1U << (n_level & 31) ;
+        sbits [n_level >> 10] |= 1U << ((n_level >> 5) & 31) ;
+        continue ;
+      }
+
+      /*
+        The neighbor is lower: put the current pixel back into the
+        boundary, remembering where to resume from (or restarting
+        from the first neighbor if the index does not fit), and flood
+        from the neighbor.
+      */
+      visited [idx] = (vl_uint8) ((edge + 2 < 256) ? edge + 2 : 1) ;
+      boundary [top [level] ++] = idx ;
+      bits  [level >> 5]  |= 1U << (level & 31) ;
+      sbits [level >> 10] |= 1U << ((level >> 5) & 31) ;
+
+      idx   = n_idx ;
+      level = n_level ;
+      edge  = 0 ;
+
+      comps [ncomps] .level = level ;
+      comps [ncomps] .pivot = idx ;
+      comps [ncomps] .area  = 0 ;
+      comps [ncomps] .child = -1 ;
+      if (mom) memset (mom + dof * ncomps, 0, sizeof(double) * dof) ;
+      ++ ncomps ;
+      goto explore ;
+    }
+
+    /* all neighbors examined: add the pixel to the top component */
+    comps [ncomps - 1] .area ++ ;
+    if (mom) {
+      double *pt = mom + dof * (ncomps - 1) ;
+      for (d = 0 ; d < ndims ; ++d) pt [d] += subs [d] ;
+      for (     ; d < dof   ; ++d) pt [d] += (double) subs [mi [d]] * subs [mj [d]] ;
+    }
+
+    /* pop the next boundary pixel */
+    {
+      int n_level = _vl_mser_next_level (bits, sbits, nlevels, level) ;
+
+      if (n_level < nlevels) {
+        idx = boundary [-- top [n_level]] ;
+        if (top [n_level] == base [n_level]) {
+          bits [n_level >> 5] &= ~ (1U << (n_level & 31)) ;
+          if (bits [n_level >> 5] == 0) {
+            sbits [n_level >> 10] &= ~ (1U << ((n_level >> 5) & 31)) ;
+          }
+        }
+      }
+
+      /*
+        If the flood rises, the components below the new level are
+        complete: emit them as extremal regions, merging them into the
+        component below until the new level is reached. When the
+        queue is empty, the new level is above all the components and
+        this emits the remaining ones, ending with the root.
+      */
+      while (n_level > comps [ncomps - 1] .level) {
+        VlMserComp *c = comps + ncomps - 1 ;
 
-  return root_idx ;
+        if (! mom) {
+          if (ner == rer) {
+            rer *= 2 ;
+            er   = realloc (er, sizeof(VlMserExtrReg) * rer) ;
+          }
+          er [ner] .index      = c-> pivot ;
+          er [ner] .parent     = ner ;
+          er [ner] .value      = c-> level ;
+          er [ner] .area       = c-> area ;
+          er [ner] .shortcut   = -1 ;
+          er [ner] .variation  = 0 ;
+          er [ner] .max_stable = 0 ;
+
+          /* link the regions waiting for a parent to this region */
+          for (i = c-> child ; i >= 0 ; i = j) {
+            j = er [i] .shortcut ;
+            er [i] .parent = ner ;
+          }
+          c-> child = ner ;
+        }
+        else if (er [ner] .max_stable) {
+          /* compute central moments */
+          float  *pt   = ell + dof * (er [ner] .max_stable - 1) ;
+          double *cpt  = mom + dof * (ncomps - 1) ;
+          double  area = c-> area ;
+          for (d = 0 ; d < ndims ; ++d) {
+            pt [d] = (float) (cpt [d] / area) ;
+          }
+          for (     ; d < dof ; ++d) {
+            pt [d] = (float) (cpt [d] / area -
+                              (cpt [mi [d]] / area) * (cpt [mj [d]] / area)) ;
+          }
+        }
+        ++ ner ;
+
+        if (n_level < c[-1] .level) {
+          /* the component rises to the new level */
+          c-> level = n_level ;
+          c-> pivot = idx ;
+          break ;
+        }
+
+        /* merge the component into the one below */
+        c[-1] .area += c-> area ;
+        if (mom) {
+          for (d = 0 ; d < dof ; ++d) mom [dof * (ncomps - 2) + d] += mom [dof * (ncomps - 1) + d] ;
+        } else {
+          er [c-> child] .shortcut = c[-1] .child ;
+          c[-1] .child = c-> child ;
+        }
+        -- ncomps ;
+      }
+
+      if (n_level == nlevels) break ;
+      level = n_level ;
+      edge  = visited [idx] - 1 ;
+    }
+  } /* next pixel */
+
+  if (! mom) *erp = er ;
+
+  free (visited) ;
+  free (boundary) ;
+  free (base) ;
+  free (top) ;
+  free (bits) ;
+  free (comps) ;
+  if (mom) free (mom) ;
+  if (mi)  free (mi) ;
+  return ner ;
 }
 
 /** -------------------------------------------------------------------
@@ -319,7 +639,7 @@ VlMserFilt*
 vl_mser_new (int ndims, int const* dims)
 {
   VlMserFilt* f ;
-  int *strides, k ;
+  int *strides, *dsubs, k, i ;
 
   f = vl_calloc (sizeof(VlMserFilt), 1) ;
 
@@ -331,6 +651,7 @@ vl_mser_new (int ndims, int const* dims)
 
   /* shortcuts */
   strides = f-> strides ;
+  dsubs   = f-> dsubs ;
 
   /* copy dims to f->dims */
   for(k = 0 ; k < ndims ; ++k) {
@@ -349,10 +670,38 @@ vl_mser_new (int ndims, int const* dims)
   /* dof of ellipsoids */
   f-> dof = ndims * (ndims + 1) / 2 + ndims ;
 
-  /* more buffers */
-  f-> perm   = vl_malloc (sizeof(vl_uint)   * f-> nel) ;
-  f-> joins  = vl_malloc (sizeof(vl_uint)   * f-> nel) ;
-  f-> r      = vl_malloc (sizeof(VlMserReg) * f-> nel) ;
+  /* neighbors: all displacements in {-1,0,1}^ndims but zero */
+  f-> nnbrs = 1 ;
+  for(k = 0 ; k < ndims ; ++k) {
+    f-> nnbrs *= 3 ;
+    dsubs [k] = -1 ;
+  }
+  f-> nnbrs -= 1 ;
+  f-> nbr_offs  = vl_malloc (sizeof(int) * f-> nnbrs) ;
+  f-> nbr_dsubs = vl_malloc (sizeof(int) * f-> nnbrs * ndims) ;
+
+  i = 0 ;
+  while (1) {
+    int     offset = 0 ;
+    vl_bool null   = 1 ;
+    for(k = 0 ; k < ndims ; ++k) {
+      offset += dsubs [k] * strides [k] ;
+      null   &= (dsubs [k] == 0) ;
+    }
+    if (! null) {
+      f-> nbr_offs [i] = offset ;
+      memcpy (f-> nbr_dsubs + i * ndims, dsubs, sizeof(int) * ndims) ;
+      ++ i ;
+    }
+
+    /* move to next displacement */
+    k = 0 ;
+    while(++ dsubs [k] > 1) {
+      dsubs [k++] = -1 ;
+      if(k == ndims) goto done_all_neighbors ;
+    }
+  }
+ done_all_neighbors : ;
 
   f-> er     = 0 ;
   f-> rer    = 0 ;
@@ -362,11 +711,12 @@ vl_mser_new (int ndims, int const* dims)
   f-> rell   = 0 ;
 
   /* other parameters */
-  f-> delta         = 5 ;
-  f-> max_area      = 0.75 ;
-  f-> min_area      = 3.0 / f-> nel ;
-  f-> max_variation = 0.25 ;
-  f-> min_diversity = 0.2 ;
+  f-> delta          = 5 ;
+  f-> max_area       = 0.75 ;
+  f-> min_area       = 3.0 / f-> nel ;
+  f-> max_variation  = 0.25 ;
+  f-> min_diversity  = 0.2 ;
+  f-> bright_on_dark = 0 ;
 
   return f ;
 }
@@ -383,13 +733,11 @@ void
 vl_mser_delete (VlMserFilt* f)
 {
   if(f) {
-    if(f-> acc   )  vl_free( f-> acc    ) ;
     if(f-> ell   )  vl_free( f-> ell    ) ;
-
     if(f-> er    )  vl_free( f-> er     ) ;
-    if(f-> r     )  vl_free( f-> r      ) ;
-    if(f-> joins )  vl_free( f-> joins  ) ;
-    if(f-> perm  )  vl_free( f-> perm   ) ;
+
+    if(f-> nbr_dsubs) vl_free( f-> nbr_dsubs) ;
+    if(f-> nbr_offs ) vl_free( f-> nbr_offs ) ;
 
     if(f-> strides) vl_free( f-> strides) ;
     if(f-> dsubs  ) vl_free( f-> dsubs  ) ;
@@ -401,256 +749,34 @@ vl_mser_delete (VlMserFilt* f)
   }
 }
 
-
 /** -------------------------------------------------------------------
- ** @brief Process image
- **
- ** The functions calculates the Maximally Stable Extremal Regions
- ** (MSERs) of image @a im using the MSER filter @a f.
- **
- ** The filter @a f must have been initialized to be compatible with
- ** the dimensions of @a im.
+ ** @internal
+ ** @brief Select the maximally stable extremal regions
  **
  ** @param f MSER filter.
- ** @param im image data.
+ ** @param ers extremal regions computed by ::_vl_mser_flood.
+ ** @param ner number of extremal regions.
+ **
+ ** The function moves the extremal regions @a ers into the filter
+ ** (releasing @a ers) and selects the MSERs.
  **/
-VL_EXPORT
-void
-vl_mser_process (VlMserFilt* f, vl_mser_pix const* im)
+
+static void
+_vl_mser_select (VlMserFilt* f, VlMserExtrReg *ers, int ner)
 {
   /* shortcuts */
   vl_uint        nel     = f-> nel  ;
-  vl_uint       *perm    = f-> perm ;
-  vl_uint       *joins   = f-> joins ;
-  int            ndims   = f-> ndims ;
-  int           *dims    = f-> dims ;
-  int           *subs    = f-> subs ;
-  int           *dsubs   = f-> dsubs ;
-  int           *strides = f-> strides ;
-  VlMserReg     *r       = f-> r ;
   VlMserExtrReg *er      = f-> er ;
   vl_uint       *mer     = f-> mer ;
   int            delta   = f-> delta ;
 
-  int njoins = 0 ;
-  int ner    = 0 ;
   int nmer   = 0 ;
   int nbig   = 0 ;
   int nsmall = 0 ;
   int nbad   = 0 ;
   int ndup   = 0 ;
 
-  int i, j, k ;
-
-  /* delete any previosuly computed ellipsoid */
-  f-> nell = 0 ;
-
-  /* -----------------------------------------------------------------
-   *                                          Sort pixels by intensity
-   * -------------------------------------------------------------- */
-
-  {
-    vl_uint buckets [ VL_MSER_PIX_MAXVAL ] ;
-
-    /* clear buckets */
-    memset (buckets, 0, sizeof(vl_uint) * VL_MSER_PIX_MAXVAL ) ;
-
-    /* compute bucket size (how many pixels for each intensity
-       value) */
-    for(i = 0 ; i < (int) nel ; ++i) {
-      vl_mser_pix v = im [i] ;
-      ++ buckets [v] ;
-    }
-
-    /* cumulatively add bucket sizes */
-    for(i = 1 ; i < VL_MSER_PIX_MAXVAL ; ++i) {
-      buckets [i] += buckets [i-1] ;
-    }
-
-    /* empty buckets computing pixel ordering */
-    for(i = nel ; i >= 1 ; ) {
-      vl_mser_pix v = im [ --i ] ;
-      vl_uint j = -- buckets [v] ;
-      perm [j] = i ;
-    }
-  }
-
-  /* initialize the forest with all void nodes */
-  for(i = 0 ; i < (int) nel ; ++i) {
-    r [i] .parent = VL_MSER_VOID_NODE ;
-  }
-
-  /* -----------------------------------------------------------------
-   *                        Compute regions and count extremal regions
-   * -------------------------------------------------------------- */
-  /*
-     In the following:
-
-     idx    : index of the current pixel
-     val    : intensity of the current pixel
-     r_idx  : index of the root of the current pixel
-     n_idx  : index of the neighbors of the current pixel
-     nr_idx : index of the root of the neighbor of the current pixel
-
-  */
-
-  /* process each pixel by increasing intensity */
-  for(i = 0 ; i < (int) nel ; ++i) {
-
-    /* pop next node xi */
-    vl_uint     idx = perm [i] ;
-    vl_mser_pix val = im [idx] ;
-    vl_uint     r_idx ;
-
-    /* add the pixel to the forest as a root for now */
-    r [idx] .parent   = idx ;
-    r [idx] .shortcut = idx ;
-    r [idx] .area     = 1 ;
-    r [idx] .height   = 1 ;
-
-    r_idx = idx ;
-
-    /* convert the index IDX into the subscript SUBS; also initialize
-       DSUBS to (-1,-1,...,-1) */
-    {
-      vl_uint temp = idx ;
-      for(k = ndims - 1 ; k >= 0 ; --k) {
-        dsubs [k] = -1 ;
-        subs  [k] = temp / strides [k] ;
-        temp      = temp % strides [k] ;
-      }
-    }
-
-    /* examine the neighbors of the current pixel */
-    while (1) {
-      vl_uint n_idx = 0 ;
-      vl_bool good = 1 ;
-
-      /*
-         Compute the neighbor subscript as NSUBS+SUB, the
-         corresponding neighbor index NINDEX and check that the
-         neighbor is within the image domain.
-      */
-      for(k = 0 ; k < ndims && good ; ++k) {
-        int temp  = dsubs [k] + subs [k] ;
-        good     &= (0 <= temp) && (temp < dims [k]) ;
-        n_idx    += temp * strides [k] ;
-      }
-
-      /*
-         The neighbor should be processed if the following conditions
-         are met:
-
-         1. The neighbor is within image boundaries.
-
-         2. The neighbor is indeed different from the current node
-            (the opposite happens when DSUB=(0,0,...,0)).
-
-         3. The neighbor is already in the forest, meaning that it has
-            already been processed.
-      */
-      if (good &&
-          n_idx != idx &&
-          r [n_idx] .parent != VL_MSER_VOID_NODE ) {
-
-        vl_mser_pix nr_val = 0 ;
-        vl_uint     nr_idx = 0 ;
-        int         hgt   = r [ r_idx] .height ;
-        int         n_hgt = r [nr_idx] .height ;
-
-        /*
-          Now we join the two subtrees rooted at
-
-           R_IDX = ROOT(  IDX)
-          NR_IDX = ROOT(N_IDX).
-
-          Note that R_IDX = ROOT(IDX) might change as we process more
-          neighbors, so we need keep updating it.
-        */
-
-         r_idx = climb(r,   idx) ;
-        nr_idx = climb(r, n_idx) ;
-
-        /*
-          At this point we have three possibilities:
-
-          (A) ROOT(IDX) == ROOT(NR_IDX). In this case the two trees
-              have already been joined and we do not do anything.
-
-          (B) I(ROOT(IDX)) == I(ROOT(NR_IDX)). In this case the pixel
-              IDX is extending an extremal region with the same
-              intensity value. Since ROOT(NR_IDX) will NOT be an
-              extremal region of the full image, ROOT(IDX) can be
-              safely added as children of ROOT(NR_IDX) if this
-              reduces the height according to the union rank
-              heuristic.
-
-          (C) I(ROOT(IDX)) > I(ROOT(NR_IDX)). In this case the pixel
-              IDX is starting a new extremal region. Thus ROOT(NR_IDX)
-              WILL be an extremal region of the final image and the
-              only possibility is to add ROOT(NR_IDX) as children of
-              ROOT(IDX), which becomes parent.
-        */
-
-        if( r_idx != nr_idx ) { /* skip if (A) */
-
-          nr_val = im [nr_idx] ;
-
-          if( nr_val == val && hgt < n_hgt ) {
-
-            /* ROOT(IDX) becomes the child */
-            r [r_idx]  .parent   = nr_idx ;
-            r [r_idx]  .shortcut = nr_idx ;
-            r [nr_idx] .area    += r [r_idx] .area ;
-            r [nr_idx] .height   = VL_MAX(n_hgt, hgt+1) ;
-
-            joins [njoins++] = r_idx ;
-
-          } else {
-
-            /* cases ROOT(IDX) becomes the parent */
-            r [nr_idx] .parent   = r_idx ;
-            r [nr_idx] .shortcut = r_idx ;
-            r [r_idx]  .area    += r [nr_idx] .area ;
-            r [r_idx]  .height   = VL_MAX(hgt, n_hgt + 1) ;
-
-            joins [njoins++] = nr_idx ;
-
-            /* count if extremal */
-            if (nr_val != val) ++ ner ;
-
-          } /* check b vs c */
-        } /* check a vs b or c */
-      } /* neighbor done */
-
-      /* move to next neighbor */
-      k = 0 ;
-      while(++ dsubs [k] > 1) {
-        dsubs [k++] = -1 ;
-        if(k == ndims) goto done_all_neighbors ;
-      }
-    } /* next neighbor */
-  done_all_neighbors : ;
-  } /* next pixel */
-
-  /* the last root is extremal too */
-  ++ ner ;
-
-  /* save back */
-  f-> njoins = njoins ;
-
-  f-> stats. num_extremal = ner ;
-
-  /* -----------------------------------------------------------------
-   *                                          Extract extremal regions
-   * -------------------------------------------------------------- */
-
-  /*
-     Extremal regions are extracted and stored into the array ER.  The
-     structure R is also updated so that .SHORTCUT indexes the
-     corresponding extremal region if any (otherwise it is set to
-     VOID).
-  */
+  int i, j ;
 
   /* make room */
   if (f-> rer < ner) {
@@ -659,72 +785,24 @@ vl_mser_process (VlMserFilt* f, vl_mser_pix const* im)
     f->rer = ner ;
   } ;
 
-  /* save back */
-  f-> nmer = ner ;
-
-  /* count again */
-  ner = 0 ;
-
-  /* scan all regions Xi */
-  for(i = 0 ; i < (int) nel ; ++i) {
-
-    /* pop next node xi */
-    vl_uint     idx = perm [i] ;
+  memcpy (er, ers, sizeof(VlMserExtrReg) * ner) ;
+  free (ers) ;
 
-    vl_mser_pix val   = im [idx] ;
-    vl_uint     p_idx = r  [idx] .parent ;
-    vl_mser_pix p_val = im [p_idx] ;
-
-    /* is extremal ? */
-    vl_bool is_extr = (p_val > val) || idx == p_idx ;
-
-    if( is_extr ) {
-
-      /* if so, add it */
-      er [ner] .index      = idx ;
-      er [ner] .parent     = ner ;
-      er [ner] .value      = im [idx] ;
-      er [ner] .area       = r  [idx] .area ;
-
-      /* link this region to this extremal region */
-      r [idx] .shortcut = ner ;
-
-      /* increase count */
-      ++ ner ;
-    } else {
-      /* link this region to void */
-      r [idx] .shortcut =   VL_MSER_VOID_NODE ;
-    }
-  }
-
-  /* -----------------------------------------------------------------
-   *                                   Link extremal regions in a tree
-   * -------------------------------------------------------------- */
-
-  for(i = 0 ; i < ner ; ++i) {
-
-    vl_uint idx = er [i] .index ;
-
-    do {
-      idx = r[idx] .parent ;
-    } while (r[idx] .shortcut == VL_MSER_VOID_NODE) ;
-
-    er[i] .parent   = r[idx] .shortcut ;
-    er[i] .shortcut = i ;
-  }
+  f-> ner = ner ;
+  f-> stats. num_extremal = ner ;
 
   /* -----------------------------------------------------------------
    *                            Compute variability of +DELTA branches
    * -------------------------------------------------------------- */
   /* For each extremal region Xi of value VAL we look for the biggest
    * parent that has value not greater than VAL+DELTA. This is dubbed
-   * `top parent'. */
+   * `top parent'. Since the value increases at each step, this takes
+   * at most DELTA steps. */
 
   for(i = 0 ; i < ner ; ++i) {
 
-    /* Xj is the current region the region and Xj are the parents */
     int     top_val = er [i] .value + delta ;
-    int     top     = er [i] .shortcut ;
+    int     top     = i ;
 
     /* examine all parents */
     while (1) {
@@ -748,18 +826,6 @@ vl_mser_process (VlMserFilt* f, vl_mser_pix const* im)
       er [i] .variation  = (float) (area_top - area) / area ;
       er [i] .max_stable = 1 ;
     }
-
-    /* Optimization: since extremal regions are processed by
-     * increasing intensity, all next extremal regions being processed
-     * have value at least equal to the one of Xi. If any of them has
-     * parent the parent of Xi (this comprises the parent itself), we
-     * can safely skip most intermediate node along the branch and
-     * skip directly to the top to start our search. */
-    {
-      int parent = er [i] .parent ;
-      int curr   = er [parent] .shortcut ;
-      er [parent] .shortcut =  VL_MAX (top, curr) ;
-    }
   }
 
   /* -----------------------------------------------------------------
@@ -768,12 +834,12 @@ vl_mser_process (VlMserFilt* f, vl_mser_pix const* im)
 
   nmer = ner ;
   for(i = 0 ; i < ner ; ++i) {
-    vl_uint    parent = er [i     ] .parent ;
-    vl_mser_pix   val = er [i     ] .value ;
-    float     var = er [i     ] .variation ;
-    vl_mser_pix p_val = er [parent] .value ;
-    float   p_var = er [parent] .variation ;
-    vl_uint     loser ;
+    vl_uint   parent = er [i     ] .parent ;
+    int          val = er [i     ] .value ;
+    float        var = er [i     ] .variation ;
+    int        p_val = er [parent] .value ;
+    float      p_var = er [parent] .variation ;
+    vl_uint    loser ;
 
     /*
        Notice that R_parent = R_{l+1} only if p_val = val + 1. If not,
@@ -797,14 +863,15 @@ vl_mser_process (VlMserFilt* f, vl_mser_pix const* im)
    *                                                 Further filtering
    * -------------------------------------------------------------- */
   /* It is critical for correct duplicate detection to remove regions
-   * from the bottom (smallest one first).                          */
+   * from the bottom (smallest one first). Since the regions are
+   * stored children first, this amounts to scanning them backward. */
   {
     float max_area = (float) f-> max_area * nel ;
     float min_area = (float) f-> min_area * nel ;
     float max_var  = (float) f-> max_variation ;
     float min_div  = (float) f-> min_diversity ;
 
-    /* scan all extremal regions (intensity value order) */
+    /* scan all extremal regions (parents first) */
     for(i = ner-1 ; i >= 0L  ; --i) {
 
       /* process only maximally stable extremal regions */
@@ -867,17 +934,176 @@ vl_mser_process (VlMserFilt* f, vl_mser_pix const* im)
   /* save back */
   f-> nmer = nmer ;
 
+  /* number the MSERs so that vl_mser_ell_fit can find them */
   j = 0 ;
   for (i = 0 ; i < ner ; ++i) {
-    if (er [i] .max_stable) mer [j++] = er [i] .index ;
+    if (er [i] .max_stable) {
+      mer [j++] = er [i] .index ;
+      er [i] .max_stable = j ;
+    }
   }
 }
 
+/** -------------------------------------------------------------------
+ ** @internal @brief Data of the loop flooding several filters
+ **/
+
+typedef struct _VlMserFloodLoop
+{
+  VlMserFilt ** filters ; /**< MSER filters. */
+  VlMserExtrReg ** ers ;  /**< extremal regions of each filter (out). */
+  int * ners ;            /**< number of extremal regions of each filter (out). */
+} VlMserFloodLoop ;
+
+/** -------------------------------------------------------------------
+ ** @internal
+ ** @brief Flood a range of filters
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first filter.
+ ** @param end last filter plus one.
+ **/
+
+static void
+_vl_mser_flood_range (void * loop_, vl_uindex task VL_UNUSED,
+                      vl_uindex begin, vl_uindex end)
+{
+  VlMserFloodLoop * loop = loop_ ;
+  vl_uindex k ;
+  for (k = begin ; k < end ; ++k) {
+    loop->ers [k]  = 0 ;
+    loop->ners [k] = _vl_mser_flood (loop->filters [k], loop->ers + k, NULL) ;
+  }
+}
+
+/** -------------------------------------------------------------------
+ ** @internal
+ ** @brief Process an image with several filters
+ **
+ ** @param filters MSER filters.
+ ** @param n number of filters.
+ ** @param im image data.
+ ** @param type image data type (::VL_TYPE_UINT8 or ::VL_TYPE_UINT16).
+ **
+ ** The filters are run in parallel, one per thread.
+ **/
+
+static void
+_vl_mser_process_many (VlMserFilt **filters, int n,
+                       void const *im, vl_type type)
+{
+  VlMserExtrReg *ers [2] ;
+  int ners [2] ;
+  int k ;
+  VlMserFloodLoop loop ;
+
+  assert (n <= 2) ;
+
+  for (k = 0 ; k < n ; ++k) {
+    /* delete any previosuly computed ellipsoid */
+    filters [k]-> nell    = 0 ;
+    filters [k]-> im      = im ;
+    filters [k]-> im_type = type ;
+  }
+
+  loop.filters = filters ;
+  loop.ers = ers ;
+  loop.ners = ners ;
+  vl_parallel_for (n, VL_MIN((vl_size) n, vl_get_max_threads()),
+                   _vl_mser_flood_range, &loop) ;
+
+  for (k = 0 ; k < n ; ++k) {
+    _vl_mser_select (filters [k], ers [k], ners [k]) ;
+  }
+}
+
+/** -------------------------------------------------------------------
+ ** @brief Process image
+ **
+ ** The functions calculates the Maximally Stable Extremal Regions
+ ** (MSERs) of image @a im using the MSER filter @a f.
+ **
+ ** The filter @a f must have been initialized to be compatible with
+ ** the dimensions of @a im. The image must not be modified or
+ ** released before calling ::vl_mser_ell_fit().
+ **
+ ** @param f MSER filter.
+ ** @param im image data.
+ **/
+VL_EXPORT
+void
+vl_mser_process (VlMserFilt* f, vl_mser_pix const* im)
+{
+  _vl_mser_process_many (&f, 1, im, VL_TYPE_UINT8) ;
+}
+
+/** -------------------------------------------------------------------
+ ** @brief Process 16 bit image
+ **
+ ** The function is the same as ::vl_mser_process(), except that the
+ ** image @a im has 16 bit pixels. Note that the parameter @c delta
+ ** is expressed in the same units as the pixel values.
+ **
+ ** @param f MSER filter.
+ ** @param im image data.
+ **/
+VL_EXPORT
+void
+vl_mser_process_ui16 (VlMserFilt* f, vl_uint16 const* im)
+{
+  _vl_mser_process_many (&f, 1, im, VL_TYPE_UINT16) ;
+}
+
+/** -------------------------------------------------------------------
+ ** @brief Process image with two filters
+ **
+ ** The function is equivalent to calling ::vl_mser_process() on
+ ** @a f and @a g, but the two filters run concurrently on separate
+ ** threads. Typically @a g is set to extract bright regions by
+ ** ::vl_mser_set_bright_on_dark(), so that both polarities of the
+ ** image are computed at once.
+ **
+ ** @param f MSER filter.
+ ** @param g another MSER filter.
+ ** @param im image data.
+ **/
+VL_EXPORT
+void
+vl_mser_process_pair (VlMserFilt* f, VlMserFilt* g, vl_mser_pix const* im)
+{
+  VlMserFilt* filters [2] ;
+  filters [0] = f ;
+  filters [1] = g ;
+  _vl_mser_process_many (filters, 2, im, VL_TYPE_UINT8) ;
+}
+
+/** -------------------------------------------------------------------
+ ** @brief Process 16 bit image with two filters
+ **
+ ** @param f MSER filter.
+ ** @param g another MSER filter.
+ ** @param im image data.
+ **
+ ** @sa ::vl_mser_process_pair(), ::vl_mser_process_ui16().
+ **/
+VL_EXPORT
+void
+vl_mser_process_pair_ui16 (VlMserFilt* f, VlMserFilt* g, vl_uint16 const* im)
+{
+  VlMserFilt* filters [2] ;
+  filters [0] = f ;
+  filters [1] = g ;
+  _vl_mser_process_many (filters, 2, im, VL_TYPE_UINT16) ;
+}
+
 /** -------------------------------------------------------------------
  ** @brief Fit ellipsoids
  **
  ** @param f MSER filter.
  **
+ ** The function floods again the image passed to the last call of
+ ** ::vl_mser_process() to integrate the moments of the MSERs.
+ **
  ** @sa @ref mser-ell
  **/
 
@@ -885,21 +1111,7 @@ VL_EXPORT
 void
 vl_mser_ell_fit (VlMserFilt* f)
 {
-  /* shortcuts */
-  int                nel = f-> nel ;
-  int                dof = f-> dof ;
-  int              *dims = f-> dims ;
-  int              ndims = f-> ndims ;
-  int              *subs = f-> subs ;
-  int             njoins = f-> njoins ;
-  vl_uint         *joins = f-> joins ;
-  VlMserReg           *r = f-> r ;
-  vl_uint           *mer = f-> mer ;
-  int               nmer = f-> nmer ;
-  vl_mser_acc       *acc = f-> acc ;
-  vl_mser_acc       *ell = f-> ell ;
-
-  int d, index, i, j ;
+  VlMserExtrReg *er = f-> er ;
 
   /* already fit ? */
   if (f->nell == f->nmer) return ;
@@ -911,91 +1123,8 @@ vl_mser_ell_fit (VlMserFilt* f)
     f->rell = f-> nmer ;
   }
 
-  if (f->acc == 0) {
-    f->acc = vl_malloc (sizeof(float) * f->nel) ;
-  }
-
-  acc = f-> acc ;
-  ell = f-> ell ;
-
-  /* -----------------------------------------------------------------
-   *                                                 Integrate moments
-   * -------------------------------------------------------------- */
-
-  /* for each dof */
-  for(d = 0 ; d < f->dof ; ++d) {
-
-    /* start from the upper-left pixel (0,0,...,0) */
-    memset (subs, 0, sizeof(int) * ndims) ;
-
-    /* step 1: fill acc pretending that each region has only one pixel */
-    if(d < ndims) {
-      /* 1-order ................................................... */
-
-      for(index = 0 ; index < nel ; ++ index) {
-        acc [index] = subs [d] ;
-        adv(ndims, dims, subs) ;
-      }
-    }
-    else {
-      /* 2-order ................................................... */
-
-      /* map the dof d to a second order moment E[x_i x_j] */
-      i = d - ndims ;
-      j = 0 ;
-      while(i > j) {
-        i -= j + 1 ;
-        j ++ ;
-      }
-      /* initialize acc with  x_i * x_j */
-      for(index = 0 ; index < nel ; ++ index){
-        acc [index] = subs [i] * subs [j] ;
-        adv(ndims, dims, subs) ;
-      }
-    }
-
-    /* step 2: integrate */
-    for(i = 0 ; i < njoins ; ++i) {
-      vl_uint index  = joins [i] ;
-      vl_uint parent = r [index] .parent ;
-      acc [parent] += acc [index] ;
-    }
-
-    /* step 3: save back to ellpises */
-    for(i = 0 ; i < nmer ; ++i) {
-      vl_uint idx = mer [i] ;
-      ell [d + dof*i] = acc [idx] ;
-    }
-
-  }  /* next dof */
-
-  /* -----------------------------------------------------------------
-   *                                           Compute central moments
-   * -------------------------------------------------------------- */
-
-  for(index = 0 ; index < nmer ; ++index) {
-    float  *pt  = ell + index * dof ;
-    vl_uint    idx  = mer [index] ;
-    float  area = r [idx] .area ;
-
-    for(d = 0 ; d < dof ; ++d) {
-
-      pt [d] /= area ;
-
-      if(d >= ndims) {
-        /* remove squared mean from moment to get variance */
-        i = d - ndims ;
-        j = 0 ;
-        while(i > j) {
-          i -= j + 1 ;
-          j ++ ;
-        }
-        pt [d] -= pt [i] * pt [j] ;
-      }
-
-    }
-  }
+  _vl_mser_flood (f, &er, f->ell) ;
 
   /* save back */
-  f-> nell = nmer ;
+  f-> nell = f-> nmer ;
 }
@@ -60,10 +60,23 @@ VL_EXPORT void             vl_mser_delete  (VlMserFilt *f) ;
 /** @} */
 
 /** @name Processing
+ **
+ ** The filter does not copy the image: ::vl_mser_ell_fit() floods
+ ** again the image passed to the last processing call, which must
+ ** therefore be neither modified nor released until the ellipsoids
+ ** are fitted.
  ** @{
  **/
 VL_EXPORT void             vl_mser_process (VlMserFilt *f,
                                             vl_mser_pix const *im) ;
+VL_EXPORT void             vl_mser_process_ui16 (VlMserFilt *f,
+                                                 vl_uint16 const *im) ;
+VL_EXPORT void             vl_mser_process_pair (VlMserFilt *f,
+                                                 VlMserFilt *g,
+                                                 vl_mser_pix const *im) ;
+VL_EXPORT void             vl_mser_process_pair_ui16 (VlMserFilt *f,
+                                                      VlMserFilt *g,
+                                                      vl_uint16 const *im) ;
 VL_EXPORT void             vl_mser_ell_fit (VlMserFilt *f) ;
 /** @} */
 
@@ -81,87 +94,36 @@ VL_INLINE VlMserStats const*  vl_mser_get_stats     (VlMserFilt const *f) ;
 /** @name Retrieving parameters
  ** @{
  **/
-VL_INLINE vl_mser_pix  vl_mser_get_delta          (VlMserFilt const *f) ;
+VL_INLINE int          vl_mser_get_delta          (VlMserFilt const *f) ;
 VL_INLINE double       vl_mser_get_min_area       (VlMserFilt const *f) ;
 VL_INLINE double       vl_mser_get_max_area       (VlMserFilt const *f) ;
 VL_INLINE double       vl_mser_get_max_variation  (VlMserFilt const *f) ;
 VL_INLINE double       vl_mser_get_min_diversity  (VlMserFilt const *f) ;
+VL_INLINE vl_bool      vl_mser_get_bright_on_dark (VlMserFilt const *f) ;
 /** @} */
 
 /** @name Setting parameters
  ** @{
  **/
-VL_INLINE void  vl_mser_set_delta           (VlMserFilt *f, vl_mser_pix x) ;
+VL_INLINE void  vl_mser_set_delta           (VlMserFilt *f, int         x) ;
 VL_INLINE void  vl_mser_set_min_area        (VlMserFilt *f, double      x) ;
 VL_INLINE void  vl_mser_set_max_area        (VlMserFilt *f, double      x) ;
 VL_INLINE void  vl_mser_set_max_variation   (VlMserFilt *f, double      x) ;
 VL_INLINE void  vl_mser_set_min_diversity   (VlMserFilt *f, double      x) ;
+VL_INLINE void  vl_mser_set_bright_on_dark  (VlMserFilt *f, vl_bool     x) ;
 /** @} */
 
 /* ====================================================================
  *                                                   INLINE DEFINITIONS
  * ================================================================== */
 
-/** @internal
- ** @brief MSER accumulator data type
- **
- ** This is a large integer type. It should be large enough to contain
- ** a number equal to the area (volume) of the image by the image
- ** width by the image height (for instance, if the image is a square
- ** of side 256, the maximum value is 256 x 256 x 256).
- **/
-typedef float vl_mser_acc ;
-
-/** @internal @brief Basic region flag: null region */
-#ifdef VL_COMPILER_MSC
-#define VL_MSER_VOID_NODE ((1ui64<<32) - 1)
-#else
-#define VL_MSER_VOID_NODE ((1ULL<<32) - 1)
-#endif
-
-/* ----------------------------------------------------------------- */
-/** @internal
- ** @brief MSER: basic region (declaration)
- **
- ** Extremal regions and maximally stable extremal regions are
- ** instances of image regions.
- **
- ** There is an image region for each pixel of the image. Each region
- ** is represented by an instance of this structure.  Regions are
- ** stored into an array in pixel order.
- **
- ** Regions are arranged into a forest. VlMserReg::parent points to
- ** the parent node, or to the node itself if the node is a root.
- ** VlMserReg::parent is the index of the node in the node array
- ** (which therefore is also the index of the corresponding
- ** pixel). VlMserReg::height is the distance of the fartest leaf. If
- ** the node itself is a leaf, then VlMserReg::height is zero.
- **
- ** VlMserReg::area is the area of the image region corresponding to
- ** this node.
- **
- ** VlMserReg::region is the extremal region identifier. Not all
- ** regions are extremal regions however; if the region is NOT
- ** extremal, this field is set to ....
- **/
-struct _VlMserReg
-{
-  vl_uint parent ;   /**< points to the parent region.            */
-  vl_uint shortcut ; /**< points to a region closer to a root.    */
-  vl_uint height ;   /**< region height in the forest.            */
-  vl_uint area ;     /**< area of the region.                     */
-} ;
-
-/** @internal @brief MSER: basic region */
-typedef struct _VlMserReg VlMserReg ;
-
 /* ----------------------------------------------------------------- */
 /** @internal
  ** @brief MSER: extremal region (declaration)
  **
- ** Extremal regions (ER) are extracted from the region forest. Each
- ** region is represented by an instance of this structure. The
- ** structures are stored into an array, in arbitrary order.
+ ** Extremal regions (ER) are emitted by the flood fill. Each region
+ ** is represented by an instance of this structure. The structures
+ ** are stored into an array, children before their parents.
  **
  ** ER are arranged into a tree. @a parent points to the parent ER, or
  ** to itself if the ER is the root.
@@ -179,14 +141,15 @@ typedef struct _VlMserReg VlMserReg ;
  ** (area_top-area)/area.
  **
  ** VlMserExtrReg::max_stable is a flag signaling whether this extremal
- ** region is also maximally stable.
+ ** region is also maximally stable. Once the MSERs are selected, it
+ ** is the index of the MSER plus one.
  **/
 struct _VlMserExtrReg
 {
   int          parent ;     /**< index of the parent region                   */
   int          index ;      /**< index of pivot pixel                         */
-  vl_mser_pix  value ;      /**< value of pivot pixel                         */
-  vl_uint      shortcut ;   /**< shortcut used when building a tree           */
+  int          value ;      /**< value of pivot pixel                         */
+  int          shortcut ;   /**< next sibling used when building the tree     */
   vl_uint      area ;       /**< area of the region                           */
   float        variation ;  /**< rel. area variation                          */
   vl_uint      max_stable ; /**< max stable number (=0 if not maxstable)      */
@@ -212,15 +175,19 @@ struct _VlMserFilt
   int               *subs ;    /**< N-dimensional subscript                 */
   int               *dsubs ;   /**< another subscript                       */
   int               *strides ; /**< strides to move in image data           */
+  void const        *im ;      /**< last processed image (not owned)        */
+  vl_type            im_type ; /**< data type of the last processed image   */
   /*@}*/
 
-  vl_uint           *perm ;    /**< pixel ordering                          */
-  vl_uint           *joins ;   /**< sequence of join ops                    */
-  int                njoins ;  /**< number of join ops                      */
+  /** @name Neighborhood */
+  /*@{*/
+  int                nnbrs ;     /**< number of neighbors of a pixel        */
+  int               *nbr_offs ;  /**< neighbor offsets in image data        */
+  int               *nbr_dsubs ; /**< neighbor subscript displacements      */
+  /*@}*/
 
   /** @name Regions */
   /*@{*/
-  VlMserReg         *r ;       /**< basic regions                           */
   VlMserExtrReg     *er ;      /**< extremal tree                           */
   vl_uint           *mer ;     /**< maximally stable extremal regions       */
   int                ner ;     /**< number of extremal regions              */
@@ -231,7 +198,6 @@ struct _VlMserFilt
 
   /** @name Ellipsoids fitting */
   /*@{*/
-  float             *acc ;     /**< moment accumulator.                    */
   float             *ell ;     /**< ellipsoids list.                       */
   int                rell ;    /**< size of ell buffer                     */
   int                nell ;    /**< number of ellipsoids extracted         */
@@ -247,6 +213,7 @@ struct _VlMserFilt
   double    min_area ;         /**< badness test parameter                 */
   double    max_variation ;    /**< badness test parameter                 */
   double    min_diversity ;    /**< minimum diversity                      */
+  vl_bool   bright_on_dark ;   /**< extract bright regions instead         */
   /*@}*/
 
   VlMserStats stats ;          /** run statistic                           */
@@ -256,8 +223,12 @@ struct _VlMserFilt
 /** @brief Get delta
  ** @param f MSER filter.
  ** @return value of @c delta.
+ **
+ ** @remark @c delta is an @c int rather than a ::vl_mser_pix so
+ ** that it can exceed 255 with 16 bit images
+ ** (::vl_mser_process_ui16()).
  **/
-VL_INLINE vl_mser_pix
+VL_INLINE int
 vl_mser_get_delta (VlMserFilt const *f)
 {
   return f-> delta ;
@@ -266,9 +237,12 @@ vl_mser_get_delta (VlMserFilt const *f)
 /** @brief Set delta
  ** @param f MSER filter.
  ** @param x value of @c delta.
+ **
+ ** @c delta is expressed in the units of the pixel values. It is
+ ** an @c int rather than a ::vl_mser_pix (see ::vl_mser_get_delta()).
  **/
 VL_INLINE void
-vl_mser_set_delta (VlMserFilt *f, vl_mser_pix x)
+vl_mser_set_delta (VlMserFilt *f, int x)
 {
   f-> delta = x ;
 }
@@ -294,6 +268,32 @@ vl_mser_set_min_diversity (VlMserFilt *f, double x)
   f-> min_diversity = x ;
 }
 
+/* ----------------------------------------------------------------- */
+/** @brief Get polarity
+ ** @param f MSER filter.
+ ** @return ::VL_TRUE if the filter extracts bright regions.
+ **/
+VL_INLINE vl_bool
+vl_mser_get_bright_on_dark (VlMserFilt const *f)
+{
+  return f-> bright_on_dark ;
+}
+
+/** @brief Set polarity
+ ** @param f MSER filter.
+ ** @param x ::VL_TRUE to extract bright regions.
+ **
+ ** By default the filter extracts dark regions on a bright
+ ** background (MSER+). Setting this flag extracts bright regions on
+ ** a dark background (MSER-) instead, as if the image was inverted,
+ ** without copying the image.
+ **/
+VL_INLINE void
+vl_mser_set_bright_on_dark (VlMserFilt *f, vl_bool x)
+{
+  f-> bright_on_dark = x ;
+}
+
 /* ----------------------------------------------------------------- */
 /** @brief Get statistics
  ** @param f MSER filter.
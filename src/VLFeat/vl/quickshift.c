@@ -57,12 +57,19 @@ building the forest. In principle, it can be infinity (so that a tree
 is returned), but in practice it is much faster to consider only
 relatively small distances (the maximum distance can be set to a small
 multiple of the kernel size).
+- <b>Density approximation.</b> By default the density is summed over
+a square window of side @f$ 2\lceil 3\sigma \rceil + 1 @f$. Setting
+::VlQSDensityTruncated (::vl_quickshift_set_density_approximation)
+drops the pixels farther than @f$ 3\sigma @f$ in the joint spatial and
+color space, which is considerably faster on images with texture or
+edges.
 
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 @section quickshift-usage Usage
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 
-- Create a new quick shift object (::vl_quickshift_new). The object
+- Create a new quick shift object (::vl_quickshift_new for @c double
+  images or ::vl_quickshift_new_f for @c float images). The object
   can be reused for multiple images of the same size.
 - Configure quick shift by setting the kernel size
   (::vl_quickshift_set_kernel_size) and the maximum gap
@@ -120,120 +127,63 @@ pixel <em>parent(x, y)</em> that achieves the minimum distance in
 \right).
 @f]
 
+Both the density and the tree are computed independently for each
+pixel. The image is divided into square tiles, which are processed in
+parallel. Within a tile, the window offsets are visited in the outer
+loop and the pixels of a tile column in the inner one, so that the
+distances are computed by contiguous (vectorizable) loops, while
+each pixel still visits its window in the same order. Hence the
+result does not depend on the number of threads. When linking, only
+the offsets within distance @f$ \tau @f$ are visited, as the spatial
+part alone already excludes the others. For @c float images all
+computations, except the medoid shift moments, are carried out in
+single precision.
+
 **/
 
+#ifndef VL_QUICKSHIFT_INSTANTIATING
+
 #include "quickshift.h"
 #include "mathop.h"
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
 
-/** -----------------------------------------------------------------
- ** @internal
- ** @brief Computes the accumulated channel L2 distance between
- **        i,j + the distance between i,j
- **
- ** @param I    input image buffer
- ** @param N1   size of the first dimension of the image
- ** @param N2   size of the second dimension of the image
- ** @param K    number of channels
- ** @param i1   first dimension index of the first pixel to compare
- ** @param i2   second dimension of the first pixel
- ** @param j1   index of the second pixel to compare
- ** @param j2   second dimension of the second pixel
- **
- ** Takes the L2 distance between the values in I at pixel i and j,
- ** accumulating along K channels and adding in the distance
- ** between i,j in the image.
- **
- ** @return the distance as described above
- **/
+/** @internal @brief Side of the tiles processed in parallel */
+#define VL_QS_TILE_SIZE 64
 
-VL_INLINE
-vl_qs_type
-vl_quickshift_distance(vl_qs_type const * I,
-         int N1, int N2, int K,
-         int i1, int i2,
-         int j1, int j2)
-{
-  vl_qs_type dist = 0 ;
-  int d1 = j1 - i1 ;
-  int d2 = j2 - i2 ;
-  int k ;
-  dist += d1*d1 + d2*d2 ;
-  /* For k = 0...K-1, d+= L2 distance between I(i1,i2,k) and
-   * I(j1,j2,k) */
-  for (k = 0 ; k < K ; ++k) {
-    vl_qs_type d =
-      I [i1 + N1 * i2 + (N1*N2) * k] -
-      I [j1 + N1 * j2 + (N1*N2) * k] ;
-    dist += d*d ;
-  }
-  return dist ;
-}
-
-/** -----------------------------------------------------------------
- ** @internal
- ** @brief Computes the accumulated channel inner product between i,j + the
- **        distance between i,j
+/** @internal @brief Number of samples of the truncated kernel
  **
- ** @param I    input image buffer
- ** @param N1   size of the first dimension of the image
- ** @param N2   size of the second dimension of the image
- ** @param K    number of channels
- ** @param i1   first dimension index of the first pixel to compare
- ** @param i2   second dimension of the first pixel
- ** @param j1   index of the second pixel to compare
- ** @param j2   second dimension of the second pixel
- **
- ** Takes the channel-wise inner product between the values in I at
- ** pixel i and j, accumulating along K channels and adding in the
- ** inner product between i,j in the image.
- **
- ** @return the inner product as described above
+ ** ::VlQSDensityTruncated interpolates the kernel
+ ** @f$ \exp(-D/2\sigma^2) @f$, @f$ 0 \leq D \leq 9\sigma^2 @f$,
+ ** linearly from this many intervals. The interpolation error is
+ ** below @f$ 3 \times 10^{-6} @f$.
  **/
+#define VL_QS_EXP_TABLE_SIZE 1024
 
-VL_INLINE
-vl_qs_type
-vl_quickshift_inner(vl_qs_type const * I,
-      int N1, int N2, int K,
-      int i1, int i2,
-      int j1, int j2)
-{
-  vl_qs_type ker = 0 ;
-  int k ;
-  ker += i1*j1 + i2*j2 ;
-  for (k = 0 ; k < K ; ++k) {
-    ker +=
-      I [i1 + N1 * i2 + (N1*N2) * k] *
-      I [j1 + N1 * j2 + (N1*N2) * k] ;
-  }
-  return ker ;
-}
+VL_INLINE float _vl_quickshift_exp_f (float x) { return expf (x) ; }
+VL_INLINE double _vl_quickshift_exp_d (double x) { return exp (x) ; }
 
 /** -----------------------------------------------------------------
+ ** @internal
  ** @brief Create a quick shift object
  ** @param image the image.
+ ** @param dataType type of the image data.
  ** @param height the height (number of rows) of the image.
  ** @param width the width (number of columns) of the image.
  ** @param channels the number of channels of the image.
  ** @return new quick shift object.
- **
- ** The @c image is an array of ::vl_qs_type values with three
- ** dimensions (respectively @c widht, @c height, and @c
- ** channels). Typically, a color (e.g, RGB) image has three
- ** channels. The linear index of a pixel is computed with:
- ** @c channels * @c width* @c height + @c row + @c height * @c col.
  **/
 
-VL_EXPORT
-VlQS *
-vl_quickshift_new(vl_qs_type const * image, int height, int width,
-                       int channels)
+static VlQS *
+_vl_quickshift_new (void const * image, vl_type dataType,
+                    int height, int width, int channels)
 {
   VlQS * q = vl_malloc(sizeof(VlQS));
 
-  q->image    = (vl_qs_type *)image;
+  q->image    = image;
+  q->dataType = dataType;
   q->height   = height;
   q->width    = width;
   q->channels = channels;
@@ -241,6 +191,7 @@ vl_quickshift_new(vl_qs_type const * image, int height, int width,
   q->medoid   = VL_FALSE;
   q->tau      = VL_MAX(height,width)/50;
   q->sigma    = VL_MAX(2, q->tau/3);
+  q->densityApproximation = VlQSDensityExact ;
 
   q->dists    = vl_calloc(height*width, sizeof(vl_qs_type));
   q->parents  = vl_calloc(height*width, sizeof(int));
@@ -249,203 +200,598 @@ vl_quickshift_new(vl_qs_type const * image, int height, int width,
   return q;
 }
 
+/** @internal @brief Data of the loops processing the tiles */
+typedef struct _VlQSLoop
+{
+  VlQS * q ;                /**< quick shift object. */
+  void const * image ;      /**< input image buffer. */
+  vl_qs_type * M ;          /**< medoid shift moments (or NULL). */
+  vl_qs_type * n ;          /**< medoid shift squared norms (or NULL). */
+  void const * expTable ;   /**< samples of the truncated kernel. */
+  int numTiles1 ;           /**< number of tiles along the first dimension. */
+  int * errors ;            /**< one error code for each task (out). */
+} VlQSLoop ;
+
+/* VL_QUICKSHIFT_INSTANTIATING */
+#endif
+
+/* ---------------------------------------------------------------- */
+#ifdef VL_QUICKSHIFT_INSTANTIATING
+
 /** -----------------------------------------------------------------
- ** @brief Create a quick shift objet
- ** @param q quick shift object.
+ ** @internal
+ ** @brief Computes the distances between two segments of columns
+ **
+ ** @param D      distances (output).
+ ** @param Ii     first channel of the first pixel of the first segment.
+ ** @param Ij     first channel of the first pixel of the second segment.
+ ** @param stride distance between the channels.
+ ** @param K      number of channels.
+ ** @param d1     first dimension offset between the segments.
+ ** @param d2     second dimension offset between the segments.
+ ** @param num    length of the segments.
+ **
+ ** The segments are contiguous in memory, so that the loops over them
+ ** vectorize. The distances are accumulated in the same order as
+ ** pixel by pixel: first the spatial part, then the channels.
  **/
 
-VL_EXPORT
-void vl_quickshift_process(VlQS * q)
+VL_INLINE void
+VL_XCAT(_vl_quickshift_distances_, SFX)
+(TYPE * D, TYPE const * Ii, TYPE const * Ij, vl_size stride, int K,
+ int d1, int d2, int num)
 {
-  vl_qs_type const *I = q->image;
-  int        *parents = q->parents;
-  vl_qs_type *E = q->density;
-  vl_qs_type *dists = q->dists;
-  vl_qs_type *M = 0, *n = 0 ;
-  vl_qs_type sigma = q->sigma ;
-  vl_qs_type tau = q->tau;
-  vl_qs_type tau2 = tau*tau;
+  TYPE D0 = (TYPE) (d1*d1 + d2*d2) ;
+  int i, k ;
+  for (i = 0 ; i < num ; ++i) {
+    D [i] = D0 ;
+  }
+  for (k = 0 ; k < K ; ++k) {
+    TYPE const * a = Ii + stride * k ;
+    TYPE const * b = Ij + stride * k ;
+    for (i = 0 ; i < num ; ++i) {
+      TYPE d = a [i] - b [i] ;
+      D [i] += d*d ;
+    }
+  }
+}
 
-  int K = q->channels, d;
-  int N1 = q->height, N2 = q->width;
-  int i1,i2, j1,j2, R, tR;
+/** -----------------------------------------------------------------
+ ** @internal
+ ** @brief Computes the density of the pixels of a tile
+ **
+ ** @param q      quick shift object.
+ ** @param I      input image buffer.
+ ** @param M      medoid shift moments (or NULL).
+ ** @param n      medoid shift squared norms (or NULL).
+ ** @param expTable samples of the truncated kernel (see
+ **               ::VL_QS_EXP_TABLE_SIZE).
+ ** @param i1begin,i1end first dimension range of the tile.
+ ** @param i2begin,i2end second dimension range of the tile.
+ **
+ ** The function loops over the window offsets and, for each offset,
+ ** over a column of the tile. Each pixel still accumulates the kernel
+ ** over its window in the same order as a pixel-by-pixel scan, so
+ ** that the result does not depend on the tiling.
+ **
+ ** The function returns ::VL_ERR_ALLOC if its row buffer could not
+ ** be allocated. It does not set the last error, as it runs in a
+ ** worker thread.
+ **/
 
-  d = 2 + K ; /* Total dimensions include spatial component (x,y) */
+static int
+VL_XCAT(_vl_quickshift_density_, SFX)
+(VlQS * q, TYPE const * I, vl_qs_type * M, vl_qs_type * n,
+ TYPE const * expTable,
+ int i1begin, int i1end, int i2begin, int i2end)
+{
+  int K = q->channels ;
+  int N1 = q->height, N2 = q->width ;
+  vl_size stride = (vl_size) N1 * N2 ;
+  TYPE sigma = (TYPE) q->sigma ;
+  TYPE sigma2 = 2*sigma*sigma ;
+  TYPE maxDist2 = (3*sigma) * (3*sigma) ;
+  TYPE expScale = VL_QS_EXP_TABLE_SIZE / maxDist2 ;
+  vl_bool truncated = (q->densityApproximation == VlQSDensityTruncated) ;
+  int R = (int) ceil (3 * sigma) ;
+  int L = i1end - i1begin ;
+  TYPE * E = malloc (sizeof(TYPE) * 2 * L) ;
+  TYPE * D = E + L ;
+  int i, i1, i2, j2, d1, d2, k ;
+
+  if (E == NULL) return VL_ERR_ALLOC ;
+
+  for (i2 = i2begin ; i2 < i2end ; ++ i2) {
+
+    for (i = 0 ; i < L ; ++i) E [i] = 0 ;
+
+    /* If we are doing medoid shift, initialize n to the inner
+     * product of the image with itself */
+    if (n) {
+      for (i1 = i1begin ; i1 < i1end ; ++ i1) {
+        TYPE const * Ii = I + i1 + N1 * i2 ;
+        vl_qs_type ker = 0 ;
+        ker += i1*i1 + i2*i2 ;
+        for (k = 0 ; k < K ; ++k) {
+          ker += Ii [stride * k] * Ii [stride * k] ;
+        }
+        n [i1 + N1 * i2] = ker ;
+      }
+    }
 
-  if (q->medoid) { /* n and M are only used in mediod shift */
-    M = (vl_qs_type *) vl_calloc(N1*N2*d, sizeof(vl_qs_type)) ;
-    n = (vl_qs_type *) vl_calloc(N1*N2,   sizeof(vl_qs_type)) ;
-  }
+    /* For each pixel in the window compute the distance between it and the
+     * source pixel */
+    for (j2 = VL_MAX(i2 - R, 0) ; j2 <= VL_MIN(i2 + R, N2-1) ; ++ j2) {
+      d2 = j2 - i2 ;
+      for (d1 = -R ; d1 <= R ; ++ d1) {
+        /* the pixels of the column whose neighbour is in the image */
+        int a = VL_MAX(i1begin, - d1) ;
+        int b = VL_MIN(i1end, N1 - d1) ;
+        if (a >= b) continue ;
+        if (truncated && d1*d1 + d2*d2 > maxDist2) continue ;
 
-  R = (int) ceil (3 * sigma) ;
-  tR = (int) ceil (tau) ;
+        VL_XCAT(_vl_quickshift_distances_, SFX)
+        (D, I + a + N1 * i2, I + a + d1 + N1 * j2, stride, K, d1, d2, b - a) ;
 
-  /* -----------------------------------------------------------------
-   *                                                                 n
-   * -------------------------------------------------------------- */
+        for (i1 = a ; i1 < b ; ++ i1) {
+          TYPE Dij = D [i1 - a] ;
+          TYPE Eij ;
+
+          /* Make distance a similarity */
+          if (truncated) {
+            /* interpolate the kernel from the table; the distances
+             * beyond the truncation radius map to the zero entries
+             * at the end (this is faster than branching) */
+            TYPE u = Dij * expScale ;
+            TYPE r ;
+            int iu ;
+            u = (u <= VL_QS_EXP_TABLE_SIZE) ? u : VL_QS_EXP_TABLE_SIZE + 1 ;
+            iu = (int) u ;
+            r = u - iu ;
+            Eij = expTable [iu] + r * (expTable [iu+1] - expTable [iu]) ;
+          } else {
+            Eij = VL_XCAT(_vl_quickshift_exp_, SFX) (- Dij / sigma2) ;
+          }
+
+          E [i1 - i1begin] += Eij ;
+
+          if (M) {
+            /* Accumulate votes for the median */
+            int j1 = i1 + d1 ;
+            M [i1 + N1*i2 + stride * 0] -= j1 * (vl_qs_type) Eij ;
+            M [i1 + N1*i2 + stride * 1] -= j2 * (vl_qs_type) Eij ;
+            for (k = 0 ; k < K ; ++k) {
+              M [i1 + N1*i2 + stride * (k+2)] -=
+                I [j1 + N1*j2 + stride * k] * (vl_qs_type) Eij ;
+            }
+          }
+        } /* i1 */
+      } /* d1 */
+    } /* j2 */
+
+    for (i1 = i1begin ; i1 < i1end ; ++ i1) {
+      q->density [i1 + N1 * i2] = E [i1 - i1begin] ;
+    }
+  } /* i2 */
 
-  /* If we are doing medoid shift, initialize n to the inner product of the
-   * image with itself
-   */
-  if (n) {
-    for (i2 = 0 ; i2 < N2 ; ++ i2) {
-      for (i1 = 0 ; i1 < N1 ; ++ i1) {
-        n [i1 + N1 * i2] = vl_quickshift_inner(I,N1,N2,K,
-                                               i1,i2,
-                                               i1,i2) ;
+  free (E) ;
+  return VL_ERR_OK ;
+}
+
+/** -----------------------------------------------------------------
+ ** @internal
+ ** @brief Links the pixels of a tile by quick shift
+ **
+ ** @param q      quick shift object.
+ ** @param I      input image buffer.
+ ** @param i1begin,i1end first dimension range of the tile.
+ ** @param i2begin,i2end second dimension range of the tile.
+ **
+ ** Each pixel is assigned to the closest pixel which has an increase
+ ** in the density. If there is no such pixel within distance @c tau,
+ ** the pixel is a root and its distance is set to infinity. As for
+ ** the density, the candidates of each pixel are visited in the
+ ** order of a pixel-by-pixel scan of its window, so that ties are
+ ** broken in the same way.
+ **
+ ** As ::_vl_quickshift_density_f, the function returns ::VL_ERR_ALLOC
+ ** if its row buffer could not be allocated.
+ **/
+
+static int
+VL_XCAT(_vl_quickshift_link_, SFX)
+(VlQS * q, TYPE const * I,
+ int i1begin, int i1end, int i2begin, int i2end)
+{
+  int K = q->channels ;
+  int N1 = q->height, N2 = q->width ;
+  vl_size stride = (vl_size) N1 * N2 ;
+  vl_qs_type const * E = q->density ;
+  TYPE tau = (TYPE) q->tau ;
+  TYPE tau2 = tau*tau ;
+  int tR = (int) ceil (tau) ;
+  int L = i1end - i1begin ;
+  TYPE * D = malloc (sizeof(TYPE) * 2 * L) ;
+  TYPE * best = D + L ;
+  int * parents = q->parents ;
+  int i1, i2, j2, d1, d2 ;
+
+  if (D == NULL) return VL_ERR_ALLOC ;
+
+  for (i2 = i2begin ; i2 < i2end ; ++i2) {
+
+    for (i1 = i1begin ; i1 < i1end ; ++i1) {
+      best [i1 - i1begin] = (TYPE) VL_QS_INF ;
+      parents [i1 + N1 * i2] = i1 + N1 * i2 ;
+    }
+
+    for (j2 = VL_MAX(i2 - tR, 0) ; j2 <= VL_MIN(i2 + tR, N2-1) ; ++ j2) {
+      d2 = j2 - i2 ;
+      for (d1 = - tR ; d1 <= tR ; ++ d1) {
+        int a = VL_MAX(i1begin, - d1) ;
+        int b = VL_MIN(i1end, N1 - d1) ;
+        if (a >= b) continue ;
+
+        /* the distance is not smaller than its spatial part, so only
+           the disc of radius tau can contain a parent */
+        if (d1*d1 + d2*d2 > tau2) continue ;
+
+        VL_XCAT(_vl_quickshift_distances_, SFX)
+        (D, I + a + N1 * i2, I + a + d1 + N1 * j2, stride, K, d1, d2, b - a) ;
+
+        for (i1 = a ; i1 < b ; ++ i1) {
+          /* select instead of branching, as the density comparison
+             is hard to predict; this also lets the loop vectorize */
+          TYPE Dij = D [i1 - a] ;
+          TYPE d_best = best [i1 - i1begin] ;
+          int better =
+            (E [i1 + d1 + N1 * j2] > E [i1 + N1 * i2]) &
+            (Dij <= tau2) & (Dij < d_best) ;
+          best [i1 - i1begin] = better ? Dij : d_best ;
+          parents [i1 + N1 * i2] = better ? i1 + d1 + N1 * j2 : parents [i1 + N1 * i2] ;
+        }
       }
     }
+
+    /* dists_i is the minimal distance, inf implies no Ej > Ei within
+     * distance tau from the point */
+    for (i1 = i1begin ; i1 < i1end ; ++i1) {
+      q->dists [i1 + N1 * i2] = sqrt(best [i1 - i1begin]) ;
+    }
   }
 
-  /* -----------------------------------------------------------------
-   *                                                 E = - [oN'*F]', M
-   * -------------------------------------------------------------- */
+  free (D) ;
+  return VL_ERR_OK ;
+}
 
-  /*
-     D_ij = d(x_i,x_j)
-     E_ij = exp(- .5 * D_ij / sigma^2) ;
-     F_ij = - E_ij
-     E_i  = sum_j E_ij
-     M_di = sum_j X_j F_ij
+/** -----------------------------------------------------------------
+ ** @internal
+ ** @brief Links the pixels of a tile by medoid shift
+ **
+ ** @param q      quick shift object.
+ ** @param I      input image buffer.
+ ** @param M      medoid shift moments.
+ ** @param n      medoid shift squared norms.
+ ** @param i1begin,i1end first dimension range of the tile.
+ ** @param i2begin,i2end second dimension range of the tile.
+ **/
 
-     E is the parzen window estimate of the density
-     0 = dissimilar to everything, windowsize = identical
+static void
+VL_XCAT(_vl_quickshift_medoid_, SFX)
+(VlQS * q, TYPE const * I, vl_qs_type const * M, vl_qs_type const * n,
+ int i1begin, int i1end, int i2begin, int i2end)
+{
+  int K = q->channels ;
+  int N1 = q->height, N2 = q->width ;
+  vl_size stride = (vl_size) N1 * N2 ;
+  vl_qs_type const * E = q->density ;
+  int R = (int) ceil (3 * (TYPE) q->sigma) ;
+  int i1, i2, j1, j2, k ;
+
+  /*
+     Qij = - nj Ei - 2 sum_k Gjk Mik
+     n is I.^2
   */
 
-  for (i2 = 0 ; i2 < N2 ; ++ i2) {
-    for (i1 = 0 ; i1 < N1 ; ++ i1) {
+  for (i2 = i2begin ; i2 < i2end ; ++i2) {
+    for (i1 = i1begin ; i1 < i1end ; ++i1) {
+
+      vl_qs_type sc_best = 0  ;
+      /* j1/j2 best are the best indicies for each i */
+      int j1_best = i1 ;
+      int j2_best = i2 ;
 
       int j1min = VL_MAX(i1 - R, 0   ) ;
       int j1max = VL_MIN(i1 + R, N1-1) ;
       int j2min = VL_MAX(i2 - R, 0   ) ;
       int j2max = VL_MIN(i2 + R, N2-1) ;
 
-      /* For each pixel in the window compute the distance between it and the
-       * source pixel */
       for (j2 = j2min ; j2 <= j2max ; ++ j2) {
         for (j1 = j1min ; j1 <= j1max ; ++ j1) {
-          vl_qs_type Dij = vl_quickshift_distance(I,N1,N2,K, i1,i2, j1,j2) ;
-          /* Make distance a similarity */
-          vl_qs_type Fij = - exp(- Dij / (2*sigma*sigma)) ;
 
-          /* E is E_i above */
-          E [i1 + N1 * i2] -= Fij ;
+          vl_qs_type Qij = - n [j1 + j2 * N1] * E [i1 + i2 * N1] ;
 
-          if (M) {
-            /* Accumulate votes for the median */
-            int k ;
-            M [i1 + N1*i2 + (N1*N2) * 0] += j1 * Fij ;
-            M [i1 + N1*i2 + (N1*N2) * 1] += j2 * Fij ;
-            for (k = 0 ; k < K ; ++k) {
-              M [i1 + N1*i2 + (N1*N2) * (k+2)] +=
-                I [j1 + N1*j2 + (N1*N2) * k] * Fij ;
-            }
+          Qij -= 2 * j1 * M [i1 + i2 * N1 + stride * 0] ;
+          Qij -= 2 * j2 * M [i1 + i2 * N1 + stride * 1] ;
+          for (k = 0 ; k < K ; ++k) {
+            Qij -= 2 *
+              I [j1 + j2 * N1 + stride * k] *
+              M [i1 + i2 * N1 + stride * (k + 2)] ;
           }
 
-        } /* j1 */
-      } /* j2 */
+          if (Qij > sc_best) {
+            sc_best = Qij ;
+            j1_best = j1 ;
+            j2_best = j2 ;
+          }
+        }
+      }
+
+      /* parents_i is the linear index of j which is the best pair
+       * dists_i is the score of the best match
+       */
+      q->parents [i1 + N1 * i2] = j1_best + N1 * j2_best ;
+      q->dists [i1 + N1 * i2] = sc_best ;
+    }
+  }
+}
 
-    }  /* i1 */
-  } /* i2 */
+/** -----------------------------------------------------------------
+ ** @internal
+ ** @brief Compute the density of a range of tiles
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first tile.
+ ** @param end last tile plus one.
+ **/
 
-  /* -----------------------------------------------------------------
-   *                                               Find best neighbors
-   * -------------------------------------------------------------- */
+static void
+VL_XCAT(_vl_quickshift_density_range_, SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlQSLoop * loop = loop_ ;
+  VlQS * q = loop->q ;
+  int N1 = q->height, N2 = q->width ;
+  int t ;
+  for (t = (int)begin ; t < (int)end ; ++t) {
+    int i1 = (t % loop->numTiles1) * VL_QS_TILE_SIZE ;
+    int i2 = (t / loop->numTiles1) * VL_QS_TILE_SIZE ;
+    if (VL_XCAT(_vl_quickshift_density_, SFX)
+        (q, loop->image, loop->M, loop->n, loop->expTable,
+         i1, VL_MIN(i1 + VL_QS_TILE_SIZE, N1),
+         i2, VL_MIN(i2 + VL_QS_TILE_SIZE, N2))) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+      return ;
+    }
+  }
+}
 
-  if (q->medoid) {
+/** -----------------------------------------------------------------
+ ** @internal
+ ** @brief Find the best neighbors of the pixels of a range of tiles
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first tile.
+ ** @param end last tile plus one.
+ **/
 
-    /*
-       Qij = - nj Ei - 2 sum_k Gjk Mik
-       n is I.^2
-    */
+static void
+VL_XCAT(_vl_quickshift_link_range_, SFX)
+(void * loop_, vl_uindex task, vl_uindex begin, vl_uindex end)
+{
+  VlQSLoop * loop = loop_ ;
+  VlQS * q = loop->q ;
+  int N1 = q->height, N2 = q->width ;
+  int t ;
+  for (t = (int)begin ; t < (int)end ; ++t) {
+    int i1 = (t % loop->numTiles1) * VL_QS_TILE_SIZE ;
+    int i2 = (t / loop->numTiles1) * VL_QS_TILE_SIZE ;
+    int i1end = VL_MIN(i1 + VL_QS_TILE_SIZE, N1) ;
+    int i2end = VL_MIN(i2 + VL_QS_TILE_SIZE, N2) ;
+    if (q->medoid) {
+      VL_XCAT(_vl_quickshift_medoid_, SFX)
+        (q, loop->image, loop->M, loop->n, i1, i1end, i2, i2end) ;
+    } else if (VL_XCAT(_vl_quickshift_link_, SFX)
+               (q, loop->image, i1, i1end, i2, i2end)) {
+      loop->errors[task] = VL_ERR_ALLOC ;
+      return ;
+    }
+  }
+}
 
-    /* medoid shift */
-    for (i2 = 0 ; i2 < N2 ; ++i2) {
-      for (i1 = 0 ; i1 < N1 ; ++i1) {
+/** -----------------------------------------------------------------
+ ** @internal
+ ** @brief Process an image
+ ** @param q quick shift object.
+ **
+ ** @return error code.
+ **
+ ** The two passes are run in parallel over tiles of
+ ** ::VL_QS_TILE_SIZE x ::VL_QS_TILE_SIZE pixels.
+ **/
 
-        vl_qs_type sc_best = 0  ;
-        /* j1/j2 best are the best indicies for each i */
-        vl_qs_type j1_best = i1 ;
-        vl_qs_type j2_best = i2 ;
+static int
+VL_XCAT(_vl_quickshift_process_, SFX) (VlQS * q)
+{
+  TYPE const * I = (TYPE const *) q->image ;
+  int K = q->channels ;
+  int N1 = q->height, N2 = q->width ;
+  int numTiles1 = (N1 + VL_QS_TILE_SIZE - 1) / VL_QS_TILE_SIZE ;
+  int numTiles2 = (N2 + VL_QS_TILE_SIZE - 1) / VL_QS_TILE_SIZE ;
+  int numTiles = numTiles1 * numTiles2 ;
+  vl_qs_type *M = 0, *n = 0 ;
+  TYPE expTable [VL_QS_EXP_TABLE_SIZE + 3] ;
+  /* the cost of a tile varies with the image content, so each tile
+     is a task and the tasks are balanced among the threads */
+  vl_size numTasks = (vl_size) VL_MAX(numTiles, 1) ;
+  VlQSLoop loop ;
+  int err = VL_ERR_OK ;
+  int t ;
+
+  for (t = 0 ; t <= VL_QS_EXP_TABLE_SIZE ; ++t) {
+    expTable [t] = (TYPE) exp (- 4.5 * t / VL_QS_EXP_TABLE_SIZE) ;
+  }
+  expTable [VL_QS_EXP_TABLE_SIZE + 1] = 0 ;
+  expTable [VL_QS_EXP_TABLE_SIZE + 2] = 0 ;
+
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.errors = vl_calloc(numTasks, sizeof(int)) ;
+  if (loop.errors == NULL) {
+    err = VL_ERR_ALLOC ;
+    goto done ;
+  }
 
-        int j1min = VL_MAX(i1 - R, 0   ) ;
-        int j1max = VL_MIN(i1 + R, N1-1) ;
-        int j2min = VL_MAX(i2 - R, 0   ) ;
-        int j2max = VL_MIN(i2 + R, N2-1) ;
+  if (q->medoid) { /* n and M are only used in mediod shift */
+    M = (vl_qs_type *) vl_calloc(N1*N2*(2 + K), sizeof(vl_qs_type)) ;
+    n = (vl_qs_type *) vl_calloc(N1*N2,         sizeof(vl_qs_type)) ;
+    if (M == NULL || n == NULL) {
+      err = VL_ERR_ALLOC ;
+      goto done ;
+    }
+  }
 
-        for (j2 = j2min ; j2 <= j2max ; ++ j2) {
-          for (j1 = j1min ; j1 <= j1max ; ++ j1) {
+  loop.q = q ;
+  loop.image = I ;
+  loop.M = M ;
+  loop.n = n ;
+  loop.expTable = expTable ;
+  loop.numTiles1 = numTiles1 ;
 
-            vl_qs_type Qij = - n [j1 + j2 * N1] * E [i1 + i2 * N1] ;
-            int k ;
+  /* -----------------------------------------------------------------
+   *                                                 E = - [oN'*F]', M
+   * -------------------------------------------------------------- */
 
-            Qij -= 2 * j1 * M [i1 + i2 * N1 + (N1*N2) * 0] ;
-            Qij -= 2 * j2 * M [i1 + i2 * N1 + (N1*N2) * 1] ;
-            for (k = 0 ; k < K ; ++k) {
-              Qij -= 2 *
-                I [j1 + j2 * N1 + (N1*N2) * k] *
-                M [i1 + i2 * N1 + (N1*N2) * (k + 2)] ;
-            }
+  /*
+     D_ij = d(x_i,x_j)
+     E_ij = exp(- .5 * D_ij / sigma^2) ;
+     F_ij = - E_ij
+     E_i  = sum_j E_ij
+     M_di = sum_j X_j F_ij
 
-            if (Qij > sc_best) {
-              sc_best = Qij ;
-              j1_best = j1 ;
-              j2_best = j2 ;
-            }
-          }
-        }
+     E is the parzen window estimate of the density
+     0 = dissimilar to everything, windowsize = identical
+  */
 
-        /* parents_i is the linear index of j which is the best pair
-         * dists_i is the score of the best match
-         */
-        parents [i1 + N1 * i2] = j1_best + N1 * j2_best ;
-        dists[i1 + N1 * i2] = sc_best ;
-      }
-    }
+  vl_parallel_for (numTiles, numTasks,
+                   VL_XCAT(_vl_quickshift_density_range_, SFX), &loop) ;
+  for (t = 0 ; t < (signed)numTasks ; ++t) {
+    if (loop.errors[t]) err = loop.errors[t] ;
+  }
+  if (err) goto done ;
 
-  } else {
-
-    /* Quickshift assigns each i to the closest j which has an increase in the
-     * density (E). If there is no j s.t. Ej > Ei, then dists_i == inf (a root
-     * node in one of the trees of merges).
-     */
-    for (i2 = 0 ; i2 < N2 ; ++i2) {
-      for (i1 = 0 ; i1 < N1 ; ++i1) {
-
-        vl_qs_type E0 = E [i1 + N1 * i2] ;
-        vl_qs_type d_best = VL_QS_INF ;
-        vl_qs_type j1_best = i1   ;
-        vl_qs_type j2_best = i2   ;
-
-        int j1min = VL_MAX(i1 - tR, 0   ) ;
-        int j1max = VL_MIN(i1 + tR, N1-1) ;
-        int j2min = VL_MAX(i2 - tR, 0   ) ;
-        int j2max = VL_MIN(i2 + tR, N2-1) ;
-
-        for (j2 = j2min ; j2 <= j2max ; ++ j2) {
-          for (j1 = j1min ; j1 <= j1max ; ++ j1) {
-            if (E [j1 + N1 * j2] > E0) {
-              vl_qs_type Dij = vl_quickshift_distance(I,N1,N2,K, i1,i2, j1,j2) ;
-              if (Dij <= tau2 && Dij < d_best) {
-                d_best = Dij ;
-                j1_best = j1 ;
-                j2_best = j2 ;
-              }
-            }
-          }
-        }
+  /* -----------------------------------------------------------------
+   *                                               Find best neighbors
+   * -------------------------------------------------------------- */
 
-        /* parents is the index of the best pair */
-        /* dists_i is the minimal distance, inf implies no Ej > Ei within
-         * distance tau from the point */
-        parents [i1 + N1 * i2] = j1_best + N1 * j2_best ;
-        dists[i1 + N1 * i2] = sqrt(d_best) ;
-      }
-    }
+  vl_parallel_for (numTiles, numTasks,
+                   VL_XCAT(_vl_quickshift_link_range_, SFX), &loop) ;
+  for (t = 0 ; t < (signed)numTasks ; ++t) {
+    if (loop.errors[t]) err = loop.errors[t] ;
   }
 
+done:
+  if (loop.errors) vl_free(loop.errors) ;
   if (M) vl_free(M) ;
   if (n) vl_free(n) ;
+  return err ;
+}
+
+/* VL_QUICKSHIFT_INSTANTIATING */
+#else
+
+#ifndef __DOXYGEN__
+#define FLT VL_TYPE_FLOAT
+#define TYPE float
+#define SFX f
+#define VL_QUICKSHIFT_INSTANTIATING
+#include "quickshift.c"
+
+#define FLT VL_TYPE_DOUBLE
+#define TYPE double
+#define SFX d
+#define VL_QUICKSHIFT_INSTANTIATING
+#include "quickshift.c"
+#endif
+
+/* VL_QUICKSHIFT_INSTANTIATING */
+#endif
+
+/* ---------------------------------------------------------------- */
+#ifndef VL_QUICKSHIFT_INSTANTIATING
+
+/** -----------------------------------------------------------------
+ ** @brief Create a quick shift object
+ ** @param image the image.
+ ** @param height the height (number of rows) of the image.
+ ** @param width the width (number of columns) of the image.
+ ** @param channels the number of channels of the image.
+ ** @return new quick shift object.
+ **
+ ** The @c image is an array of ::vl_qs_type values with three
+ ** dimensions (respectively @c widht, @c height, and @c
+ ** channels). Typically, a color (e.g, RGB) image has three
+ ** channels. The linear index of a pixel is computed with:
+ ** @c channels * @c width* @c height + @c row + @c height * @c col.
+ **/
+
+VL_EXPORT
+VlQS *
+vl_quickshift_new(vl_qs_type const * image, int height, int width,
+                       int channels)
+{
+  return _vl_quickshift_new (image, VL_TYPE_DOUBLE, height, width, channels) ;
+}
+
+/** -----------------------------------------------------------------
+ ** @brief Create a quick shift object for a @c float image
+ ** @param image the image.
+ ** @param height the height (number of rows) of the image.
+ ** @param width the width (number of columns) of the image.
+ ** @param channels the number of channels of the image.
+ ** @return new quick shift object.
+ **
+ ** The function is the same as ::vl_quickshift_new, except that the
+ ** image is an array of @c float values and that the density and the
+ ** distances are computed in single precision. The results are still
+ ** returned as ::vl_qs_type arrays.
+ **/
+
+VL_EXPORT
+VlQS *
+vl_quickshift_new_f(float const * image, int height, int width,
+                    int channels)
+{
+  return _vl_quickshift_new (image, VL_TYPE_FLOAT, height, width, channels) ;
+}
+
+/** -----------------------------------------------------------------
+ ** @brief Process an image
+ ** @param q quick shift object.
+ ** @return error code.
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory. In this case the content of the parents,
+ ** distances and density buffers is undefined.
+ **/
+
+VL_EXPORT
+int vl_quickshift_process(VlQS * q)
+{
+  int error ;
+  switch (q->dataType) {
+    case VL_TYPE_FLOAT:
+      error = _vl_quickshift_process_f (q) ;
+      break ;
+    case VL_TYPE_DOUBLE:
+      error = _vl_quickshift_process_d (q) ;
+      break ;
+    default:
+      abort() ;
+  }
+  if (error) {
+    return vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the quick shift buffers.") ;
+  }
+  return VL_ERR_OK ;
 }
 
 /** -----------------------------------------------------------------
@@ -463,3 +809,11 @@ void vl_quickshift_delete(VlQS * q)
     vl_free(q);
   }
 }
+
+/* VL_QUICKSHIFT_INSTANTIATING */
+#endif
+
+#undef SFX
+#undef TYPE
+#undef FLT
+#undef VL_QUICKSHIFT_INSTANTIATING
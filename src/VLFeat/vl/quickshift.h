@@ -24,15 +24,30 @@ typedef double vl_qs_type ;
 /** @brief quick shift infinity constant */
 #define VL_QS_INF VL_INFINITY_D /* Change to _F for float math */
 
+/** @brief Parzen density approximation */
+typedef enum _VlQSDensityApproximation
+{
+  VlQSDensityExact,     /**< Gaussian kernel on a square window of side 6 sigma */
+  VlQSDensityTruncated  /**< Gaussian kernel truncated at 3 sigma in the joint space */
+} VlQSDensityApproximation ;
+
 /** ------------------------------------------------------------------
  ** @brief quick shift results
  **
  ** This implements quick shift mode seeking.
+ **
+ ** @remark VlQS::image is a <code>void const *</code> (it used to be
+ ** a <code>vl_qs_type const *</code>) since the image can be either
+ ** @c double (::vl_quickshift_new) or @c float
+ ** (::vl_quickshift_new_f), as recorded by VlQS::dataType. Code that
+ ** reads the field directly must cast it according to
+ ** VlQS::dataType.
  **/
 
 typedef struct _VlQS
 {
-  vl_qs_type *image ;   /**< height x width x channels feature image */
+  void const *image ;   /**< height x width x channels feature image */
+  vl_type dataType ;    /**< type of the image data (float or double) */
   int height;           /**< height of the image */
   int width;            /**< width of the image */
   int channels;         /**< number of channels in the image */
@@ -40,6 +55,7 @@ typedef struct _VlQS
   vl_bool medoid;
   vl_qs_type sigma;
   vl_qs_type tau;
+  VlQSDensityApproximation densityApproximation ;
 
   int *parents ;
   vl_qs_type *dists ;
@@ -53,6 +69,10 @@ VL_EXPORT
 VlQS*  vl_quickshift_new (vl_qs_type const * im, int height, int width,
                           int channels);
 
+VL_EXPORT
+VlQS*  vl_quickshift_new_f (float const * im, int height, int width,
+                            int channels);
+
 VL_EXPORT
 void   vl_quickshift_delete (VlQS *q) ;
 /** @} */
@@ -62,7 +82,7 @@ void   vl_quickshift_delete (VlQS *q) ;
  **/
 
 VL_EXPORT
-void   vl_quickshift_process (VlQS *q) ;
+int    vl_quickshift_process (VlQS *q) ;
 
 /** @} */
 
@@ -72,6 +92,8 @@ void   vl_quickshift_process (VlQS *q) ;
 VL_INLINE vl_qs_type    vl_quickshift_get_max_dist      (VlQS const *q) ;
 VL_INLINE vl_qs_type    vl_quickshift_get_kernel_size    (VlQS const *q) ;
 VL_INLINE vl_bool       vl_quickshift_get_medoid   (VlQS const *q) ;
+VL_INLINE VlQSDensityApproximation
+vl_quickshift_get_density_approximation (VlQS const *q) ;
 
 VL_INLINE int *        vl_quickshift_get_parents  (VlQS const *q) ;
 VL_INLINE vl_qs_type * vl_quickshift_get_dists    (VlQS const *q) ;
@@ -84,6 +106,8 @@ VL_INLINE vl_qs_type * vl_quickshift_get_density  (VlQS const *q) ;
 VL_INLINE void vl_quickshift_set_max_dist    (VlQS *f, vl_qs_type tau) ;
 VL_INLINE void vl_quickshift_set_kernel_size  (VlQS *f, vl_qs_type sigma) ;
 VL_INLINE void vl_quickshift_set_medoid (VlQS *f, vl_bool medoid) ;
+VL_INLINE void vl_quickshift_set_density_approximation
+(VlQS *f, VlQSDensityApproximation approximation) ;
 /** @} */
 
 /* -------------------------------------------------------------------
@@ -128,6 +152,18 @@ vl_quickshift_get_medoid (VlQS const *q)
   return q->medoid ;
 }
 
+/** ------------------------------------------------------------------
+ ** @brief Get the density approximation.
+ ** @param q quick Shift object.
+ ** @return the approximation used to estimate the density.
+ **/
+
+VL_INLINE VlQSDensityApproximation
+vl_quickshift_get_density_approximation (VlQS const *q)
+{
+  return q->densityApproximation ;
+}
+
 /** ------------------------------------------------------------------
  ** @brief Get parents.
  ** @param q quick shift object.
@@ -207,5 +243,21 @@ vl_quickshift_set_medoid (VlQS *q, vl_bool medoid)
   q -> medoid = medoid ;
 }
 
+/** ------------------------------------------------------------------
+ ** @brief Set the density approximation
+ ** @param q quick shift object.
+ ** @param approximation ::VlQSDensityExact (default) sums the kernel
+ **        over a square window of side @f$ 2 \lceil 3\sigma \rceil + 1 @f$;
+ **        ::VlQSDensityTruncated drops the terms farther than
+ **        @f$ 3\sigma @f$ in the joint space, which is faster.
+ **/
+
+VL_INLINE void
+vl_quickshift_set_density_approximation (VlQS *q,
+                                         VlQSDensityApproximation approximation)
+{
+  q -> densityApproximation = approximation ;
+}
+
 
 #endif
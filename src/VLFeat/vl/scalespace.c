@@ -287,10 +287,21 @@ represented properly.
  ** image.
  **/
 
+/** @internal @brief Gaussian filter cached by a scale space */
+typedef struct _VlScaleSpaceFilter
+{
+  double sigma ; /**< Standard deviation (in pixels) */
+  vl_size size ; /**< Number of samples */
+  float *values ; /**< Samples */
+} VlScaleSpaceFilter ;
+
 struct _VlScaleSpace
 {
   VlScaleSpaceGeometry geom ; /**< Geometry of the scale space */
   float **octaves ; /**< Data */
+  float *buffer ; /**< Smoothing buffer (as large as a first octave level) */
+  VlScaleSpaceFilter *filters ; /**< Cached Gaussian filters */
+  vl_size numFilters ; /**< Number of cached filters */
 } ;
 
 /* ---------------------------------------------------------------- */
@@ -578,6 +589,13 @@ vl_scalespace_new_with_geometry (VlScaleSpaceGeometry geom)
     self->octaves[o - self->geom.firstOctave] = vl_malloc(octaveSize * sizeof(float)) ;
     if (self->octaves[o - self->geom.firstOctave] == NULL) goto err_alloc_octaves;
   }
+  {
+    /* the first octave has the largest levels */
+    VlScaleSpaceOctaveGeometry ogeom =
+      vl_scalespace_get_octave_geometry(self, self->geom.firstOctave) ;
+    self->buffer = vl_malloc(ogeom.width * ogeom.height * sizeof(float)) ;
+    if (self->buffer == NULL) goto err_alloc_octaves ;
+  }
   return self ;
 
 err_alloc_octaves:
@@ -586,6 +604,7 @@ err_alloc_octaves:
       vl_free(self->octaves[o - self->geom.firstOctave]) ;
     }
   }
+  vl_free(self->octaves) ;
 err_alloc_octave_list:
   vl_free(self) ;
 err_alloc_self:
@@ -650,12 +669,113 @@ vl_scalespace_delete (VlScaleSpace * self)
       }
       vl_free(self->octaves) ;
     }
+    if (self->filters) {
+      vl_index i ;
+      for (i = 0 ; i < (signed)self->numFilters ; ++i) {
+        vl_free(self->filters[i].values) ;
+      }
+      vl_free(self->filters) ;
+    }
+    if (self->buffer) vl_free(self->buffer) ;
     vl_free(self) ;
   }
 }
 
 /* ---------------------------------------------------------------- */
 
+/** @internal @brief Get a cached Gaussian filter
+ ** @param self object instance.
+ ** @param sigma standard deviation of the filter (in pixels).
+ ** @return the filter, or @c NULL if it could not be allocated.
+ **
+ ** The filter is the same used by ::vl_imsmooth_f. Filters are
+ ** computed the first time they are requested and kept until the
+ ** object is deleted. Since the relative smoothing between levels
+ ** is the same in all octaves, only a handful of filters are ever
+ ** created.
+ **/
+
+static VlScaleSpaceFilter const *
+_vl_scalespace_get_filter (VlScaleSpace *self, double sigma)
+{
+  VlScaleSpaceFilter *filters ;
+  VlScaleSpaceFilter *filter ;
+  float *values ;
+  vl_index i, width ;
+  float mass = 1.0f ;
+
+  for (i = 0 ; i < (signed)self->numFilters ; ++i) {
+    if (self->filters[i].sigma == sigma) return self->filters + i ;
+  }
+
+  width = (vl_index) vl_ceil_d(sigma * 3.0) ;
+  values = vl_malloc((2 * width + 1) * sizeof(float)) ;
+  if (values == NULL) return NULL ;
+  filters = vl_realloc(self->filters,
+                       (self->numFilters + 1) * sizeof(VlScaleSpaceFilter)) ;
+  if (filters == NULL) {
+    vl_free(values) ;
+    return NULL ;
+  }
+  self->filters = filters ;
+  filter = self->filters + self->numFilters ++ ;
+
+  filter->sigma = sigma ;
+  filter->size = 2 * width + 1 ;
+  filter->values = values ;
+  filter->values[width] = 1.0f ;
+  for (i = 1 ; i <= width ; ++i) {
+    double x = (double)i / sigma ;
+    double g = exp(-0.5 * x * x) ;
+    mass += g + g ;
+    filter->values[width-i] = g ;
+    filter->values[width+i] = g ;
+  }
+  for (i = 0 ; i < (signed)filter->size ; ++i) {filter->values[i] /= mass ;}
+  return filter ;
+}
+
+/** @internal @brief Smooth a level
+ ** @param self object instance.
+ ** @param level output level.
+ ** @param previous input level (may be the same as @a level).
+ ** @param width level width.
+ ** @param height level height.
+ ** @param sigma smoothing (in pixels).
+ **
+ ** @return error code.
+ **
+ ** The function is equivalent to ::vl_imsmooth_f, but it uses the
+ ** filters and the buffer cached in @a self instead of allocating
+ ** them at each call. It returns ::VL_ERR_ALLOC if a new filter
+ ** could not be allocated.
+ **/
+
+static int
+_vl_scalespace_smooth (VlScaleSpace *self,
+                       float *level, float const *previous,
+                       vl_size width, vl_size height, double sigma)
+{
+  VlScaleSpaceFilter const *filter = _vl_scalespace_get_filter(self, sigma) ;
+  vl_index filterWidth ;
+
+  if (filter == NULL) return VL_ERR_ALLOC ;
+  filterWidth = ((signed)filter->size - 1) / 2 ;
+
+  vl_imconvcol_vf (self->buffer, height,
+                   previous, width, height, width,
+                   filter->values, -filterWidth, filterWidth,
+                   1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+
+  vl_imconvcol_vf (level, width,
+                   self->buffer, height, width, height,
+                   filter->values, -filterWidth, filterWidth,
+                   1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+  return VL_ERR_OK ;
+}
+
+/* ---------------------------------------------------------------- */
+
 /** @internal @brief Fill octave starting from the first level
  ** @param self object instance.
  ** @param o octave to process.
@@ -663,12 +783,15 @@ vl_scalespace_delete (VlScaleSpace * self)
  ** The function takes the first sublevel of octave @a o (the one at
  ** sublevel `octaveFirstLevel` and iteratively
  ** smoothes it to obtain the other octave levels.
+ **
+ ** @return error code.
  **/
 
-void
+static int
 _vl_scalespace_fill_octave (VlScaleSpace *self, vl_index o)
 {
   vl_index s ;
+  int err ;
   VlScaleSpaceOctaveGeometry ogeom = vl_scalespace_get_octave_geometry(self, o) ;
 
   for(s = self->geom.octaveFirstSubdivision + 1 ;
@@ -679,10 +802,12 @@ _vl_scalespace_fill_octave (VlScaleSpace *self, vl_index o)
 
     float* level = vl_scalespace_get_level (self, o, s) ;
     float* previous = vl_scalespace_get_level (self, o, s-1) ;
-    vl_imsmooth_f (level, ogeom.width,
-                   previous, ogeom.width, ogeom.height, ogeom.width,
-                   deltaSigma / ogeom.step, deltaSigma / ogeom.step) ;
+    err = _vl_scalespace_smooth (self, level, previous,
+                                 ogeom.width, ogeom.height,
+                                 deltaSigma / ogeom.step) ;
+    if (err) return err ;
   }
+  return VL_ERR_OK ;
 }
 
 /** ------------------------------------------------------------------
@@ -694,9 +819,11 @@ _vl_scalespace_fill_octave (VlScaleSpace *self, vl_index o)
  ** The function initializes the first level of octave @a o from
  ** image @a image. The dimensions of the image are the ones set
  ** during the creation of the ::VlScaleSpace object instance.
+ **
+ ** @return error code.
  **/
 
-static void
+static int
 _vl_scalespace_start_octave_from_image (VlScaleSpace *self,
                                         float const *image,
                                         vl_index o)
@@ -738,10 +865,11 @@ _vl_scalespace_start_octave_from_image (VlScaleSpace *self,
     VlScaleSpaceOctaveGeometry ogeom = vl_scalespace_get_octave_geometry(self, o) ;
     double deltaSigma = sqrt (sigma*sigma - imageSigma*imageSigma) ;
     level = vl_scalespace_get_level (self, o, self->geom.octaveFirstSubdivision) ;
-    vl_imsmooth_f (level, ogeom.width,
-                   level, ogeom.width, ogeom.height, ogeom.width,
-                   deltaSigma / ogeom.step, deltaSigma / ogeom.step) ;
+    return _vl_scalespace_smooth (self, level, level,
+                                  ogeom.width, ogeom.height,
+                                  deltaSigma / ogeom.step) ;
   }
+  return VL_ERR_OK ;
 }
 
 /** @internal @brief Initialize the first level of an octave from the previous octave
@@ -750,9 +878,11 @@ _vl_scalespace_start_octave_from_image (VlScaleSpace *self,
  **
  ** The function initializes the first level of octave @a o from the
  ** content of octave <code>o - 1</code>.
+ **
+ ** @return error code.
  **/
 
-static void
+static int
 _vl_scalespace_start_octave_from_previous_octave (VlScaleSpace *self, vl_index o)
 {
   double sigma, prevSigma ;
@@ -793,11 +923,11 @@ _vl_scalespace_start_octave_from_previous_octave (VlScaleSpace *self, vl_index o
     double deltaSigma = sqrt (sigma*sigma - prevSigma*prevSigma) ;
     level = vl_scalespace_get_level (self, o, self->geom.octaveFirstSubdivision) ;
 
-    /* todo: this may fail due to an out-of-memory condition */
-    vl_imsmooth_f (level, ogeom.width,
-                   level, ogeom.width, ogeom.height, ogeom.width,
-                   deltaSigma / ogeom.step, deltaSigma / ogeom.step) ;
+    return _vl_scalespace_smooth (self, level, level,
+                                  ogeom.width, ogeom.height,
+                                  deltaSigma / ogeom.step) ;
   }
+  return VL_ERR_OK ;
 }
 
 /** @brief Initialise Scale space with new image
@@ -806,16 +936,31 @@ _vl_scalespace_start_octave_from_previous_octave (VlScaleSpace *self, vl_index o
  **
  ** Compute the data of all the defined octaves and scales of the scale
  ** space @a self.
+ **
+ ** Each level is obtained by smoothing the previous one by the
+ ** difference of their scales. The octave data, the smoothing buffer
+ ** and the Gaussian filters are allocated once and reused, so
+ ** calling this function repeatedly on images of the same size does
+ ** not allocate any memory.
+ **
+ ** @return error code: ::VL_ERR_ALLOC if a Gaussian filter could
+ ** not be allocated, ::VL_ERR_OK otherwise.
  **/
 
-void
+int
 vl_scalespace_put_image (VlScaleSpace *self, float const *image)
 {
   vl_index o ;
-  _vl_scalespace_start_octave_from_image(self, image, self->geom.firstOctave) ;
-  _vl_scalespace_fill_octave(self, self->geom.firstOctave) ;
+  int err ;
+  err = _vl_scalespace_start_octave_from_image(self, image, self->geom.firstOctave) ;
+  if (err) return err ;
+  err = _vl_scalespace_fill_octave(self, self->geom.firstOctave) ;
+  if (err) return err ;
   for (o = self->geom.firstOctave + 1 ; o <= self->geom.lastOctave ; ++o) {
-    _vl_scalespace_start_octave_from_previous_octave(self, o) ;
-    _vl_scalespace_fill_octave(self, o) ;
+    err = _vl_scalespace_start_octave_from_previous_octave(self, o) ;
+    if (err) return err ;
+    err = _vl_scalespace_fill_octave(self, o) ;
+    if (err) return err ;
   }
+  return VL_ERR_OK ;
 }
@@ -77,7 +77,7 @@ VL_EXPORT void vl_scalespace_delete (VlScaleSpace *self) ;
 /** @name Process data
  ** @{
  **/
-VL_EXPORT void
+VL_EXPORT int
 vl_scalespace_put_image (VlScaleSpace *self, float const* image);
 /** @} */
 
@@ -259,6 +259,11 @@ To use a <b>SIFT filter</b> object:
       - Use ::vl_sift_calc_keypoint_descriptor() to get the keypoint descriptor.
 - Delete the SIFT filter by ::vl_sift_delete().
 
+Alternatively, ::vl_sift_extract_all() runs the loop above on a whole
+image and returns all the frames and descriptors at once. The
+keypoints of each octave are processed in parallel (see @ref threads)
+and the function returns the same features as the loop.
+
 To compute SIFT descriptors of custom keypoints, use
 ::vl_sift_calc_raw_descriptor().
 
@@ -675,6 +680,11 @@ double expn_tab [EXPN_SZ+1] ; /**< ::fast_expn table      @internal */
 #define NBO 8
 #define NBP 4
 
+/** @internal @brief Minimum number of columns processed by a thread */
+#define VL_SIFT_MIN_BLOCK_WIDTH 32
+/** @internal @brief Minimum image size for parallel processing */
+#define VL_SIFT_MIN_PARALLEL_PIXELS (64*64)
+
 #define log2(x) (log(x)/VL_LOG_OF_2)
 
 /** ------------------------------------------------------------------
@@ -757,6 +767,99 @@ copy_and_upsample_rows
   }
 }
 
+/** @internal @brief Data of the loop convolving blocks of columns */
+typedef struct _VlSiftConvColLoop
+{
+  VlSiftFilt const * self ; /**< SIFT filter. */
+  vl_sift_pix * dst ;       /**< output image buffer. */
+  vl_size dstStride ;       /**< output image stride. */
+  vl_sift_pix const * src ; /**< input image buffer. */
+  vl_size srcWidth ;        /**< input image width. */
+  vl_size srcHeight ;       /**< input image height. */
+  vl_size srcStride ;       /**< input image stride. */
+  vl_size blockWidth ;      /**< number of columns of a block. */
+} VlSiftConvColLoop ;
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Convolve a range of blocks of columns
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first block.
+ ** @param end last block plus one.
+ **/
+
+static void
+_vl_sift_convcol_range (void * loop_, vl_uindex task VL_UNUSED,
+                        vl_uindex begin, vl_uindex end)
+{
+  VlSiftConvColLoop * loop = loop_ ;
+  VlSiftFilt const * self = loop->self ;
+  vl_uindex b ;
+  for (b = begin ; b < end ; ++b) {
+    vl_size x0 = b * loop->blockWidth ;
+    vl_size x1 = VL_MIN(x0 + loop->blockWidth, loop->srcWidth) ;
+    if (x0 >= x1) continue ;
+    vl_imconvcol_vf (loop->dst + x0 * loop->dstStride, loop->dstStride,
+                     loop->src + x0, x1 - x0, loop->srcHeight, loop->srcStride,
+                     self->gaussFilter,
+                     - self->gaussFilterWidth, self->gaussFilterWidth,
+                     1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+  }
+}
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Convolve the columns of an image by the Gaussian filter
+ ** @param self       SIFT filter.
+ ** @param dst        output image buffer.
+ ** @param dst_stride output image stride.
+ ** @param src        input image buffer.
+ ** @param src_width  input image width.
+ ** @param src_height input image height.
+ ** @param src_stride input image stride.
+ **
+ ** The function is equivalent to calling ::vl_imconvcol_vf with the
+ ** filter cached in @a self and transposing the result. The columns
+ ** are split in blocks processed in parallel. Blocks start at multiples of four columns so that each
+ ** column is computed by exactly the same code (SIMD or not) as in a
+ ** single call, which makes the output independent of the number of
+ ** threads.
+ **/
+
+static void
+_vl_sift_convcol (VlSiftFilt const * self,
+                  vl_sift_pix * dst,
+                  vl_size dst_stride,
+                  vl_sift_pix const * src,
+                  vl_size src_width,
+                  vl_size src_height,
+                  vl_size src_stride)
+{
+  vl_size numBlocks = VL_MIN(vl_get_max_threads(),
+                             src_width / VL_SIFT_MIN_BLOCK_WIDTH) ;
+  if (numBlocks > 1 &&
+      src_width * src_height >= VL_SIFT_MIN_PARALLEL_PIXELS) {
+    VlSiftConvColLoop loop ;
+    loop.self = self ;
+    loop.dst = dst ;
+    loop.dstStride = dst_stride ;
+    loop.src = src ;
+    loop.srcWidth = src_width ;
+    loop.srcHeight = src_height ;
+    loop.srcStride = src_stride ;
+    loop.blockWidth = (src_width + numBlocks - 1) / numBlocks ;
+    loop.blockWidth = (loop.blockWidth + 3) & ~ (vl_size)3 ;
+    vl_parallel_for (numBlocks, numBlocks, _vl_sift_convcol_range, &loop) ;
+    return ;
+  }
+  vl_imconvcol_vf (dst, dst_stride,
+                   src, src_width, src_height, src_stride,
+                   self->gaussFilter,
+                   - self->gaussFilterWidth, self->gaussFilterWidth,
+                   1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+}
+
 /** ------------------------------------------------------------------
  ** @internal
  ** @brief Smooth an image
@@ -802,17 +905,11 @@ _vl_sift_smooth (VlSiftFilt * self,
     return ;
   }
 
-  vl_imconvcol_vf (tempImage, height,
-                   inputImage, width, height, width,
-                   self->gaussFilter,
-                   - self->gaussFilterWidth, self->gaussFilterWidth,
-                   1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+  _vl_sift_convcol (self, tempImage, height,
+                    inputImage, width, height, width) ;
 
-  vl_imconvcol_vf (outputImage, width,
-                   tempImage, height, width, height,
-                   self->gaussFilter,
-                   - self->gaussFilterWidth, self->gaussFilterWidth,
-                   1, VL_PAD_BY_CONTINUITY | VL_TRANSPOSE) ;
+  _vl_sift_convcol (self, outputImage, width,
+                    tempImage, height, width, height) ;
 }
 
 /** ------------------------------------------------------------------
@@ -1139,20 +1236,24 @@ vl_sift_process_next_octave (VlSiftFilt *f)
 }
 
 /** ------------------------------------------------------------------
- ** @brief Detect keypoints
- **
- ** The function detect keypoints in the current octave filling the
- ** internal keypoint buffer. Keypoints can be retrieved by
- ** ::vl_sift_get_keypoints().
+ ** @internal
+ ** @brief Refine the location of a keypoint
  **
  ** @param f SIFT filter.
+ ** @param k keypoint.
+ **
+ ** The function refines the integer location (@c ix, @c iy, @c is)
+ ** of the DoG extremum @a k by fitting a quadratic and fills in the
+ ** remaining fields of @a k. It does not modify the filter and can be
+ ** called concurrently on different keypoints.
+ **
+ ** @return @c true if the keypoint passes the peak and edge tests.
  **/
 
-VL_EXPORT
-void
-vl_sift_detect (VlSiftFilt * f)
+static vl_bool
+_vl_sift_refine_keypoint (VlSiftFilt const * f, VlSiftKeypoint * k)
 {
-  vl_sift_pix* dog   = f-> dog ;
+  vl_sift_pix const * dog = f-> dog ;
   int          s_min = f-> s_min ;
   int          s_max = f-> s_max ;
   int          w     = f-> octave_width ;
@@ -1166,35 +1267,199 @@ vl_sift_detect (VlSiftFilt * f)
 
   double       xper  = pow (2.0, f->o_cur) ;
 
-  int x, y, s, i, ii, jj ;
-  vl_sift_pix *pt, v ;
-  VlSiftKeypoint *k ;
+  int x = k-> ix ;
+  int y = k-> iy ;
+  int s = k-> is ;
 
-  /* clear current list */
-  f-> nkeys = 0 ;
+  double Dx=0,Dy=0,Ds=0,Dxx=0,Dyy=0,Dss=0,Dxy=0,Dxs=0,Dys=0 ;
+  double A [3*3], b [3] ;
 
-  /* compute difference of gaussian (DoG) */
-  pt = f-> dog ;
-  for (s = s_min ; s <= s_max - 1 ; ++s) {
-    vl_sift_pix* src_a = vl_sift_get_octave (f, s    ) ;
-    vl_sift_pix* src_b = vl_sift_get_octave (f, s + 1) ;
-    vl_sift_pix* end_a = src_a + w * h ;
-    while (src_a != end_a) {
-      *pt++ = *src_b++ - *src_a++ ;
+  int dx = 0 ;
+  int dy = 0 ;
+
+  int iter, i, j, ii, jj ;
+  vl_sift_pix const * pt = dog ;
+
+  for (iter = 0 ; iter < 5 ; ++iter) {
+
+    x += dx ;
+    y += dy ;
+
+    pt = dog
+      + xo * x
+      + yo * y
+      + so * (s - s_min) ;
+
+    /** @brief Index GSS @internal */
+#define at(dx,dy,ds) (*( pt + (dx)*xo + (dy)*yo + (ds)*so))
+
+    /** @brief Index matrix A @internal */
+#define Aat(i,j)     (A[(i)+(j)*3])
+
+    /* compute the gradient */
+    Dx = 0.5 * (at(+1,0,0) - at(-1,0,0)) ;
+    Dy = 0.5 * (at(0,+1,0) - at(0,-1,0));
+    Ds = 0.5 * (at(0,0,+1) - at(0,0,-1)) ;
+
+    /* compute the Hessian */
+    Dxx = (at(+1,0,0) + at(-1,0,0) - 2.0 * at(0,0,0)) ;
+    Dyy = (at(0,+1,0) + at(0,-1,0) - 2.0 * at(0,0,0)) ;
+    Dss = (at(0,0,+1) + at(0,0,-1) - 2.0 * at(0,0,0)) ;
+
+    Dxy = 0.25 * ( at(+1,+1,0) + at(-1,-1,0) - at(-1,+1,0) - at(+1,-1,0) ) ;
+    Dxs = 0.25 * ( at(+1,0,+1) + at(-1,0,-1) - at(-1,0,+1) - at(+1,0,-1) ) ;
+    Dys = 0.25 * ( at(0,+1,+1) + at(0,-1,-1) - at(0,-1,+1) - at(0,+1,-1) ) ;
+
+    /* solve linear system ....................................... */
+    Aat(0,0) = Dxx ;
+    Aat(1,1) = Dyy ;
+    Aat(2,2) = Dss ;
+    Aat(0,1) = Aat(1,0) = Dxy ;
+    Aat(0,2) = Aat(2,0) = Dxs ;
+    Aat(1,2) = Aat(2,1) = Dys ;
+
+    b[0] = - Dx ;
+    b[1] = - Dy ;
+    b[2] = - Ds ;
+
+    /* Gauss elimination */
+    for(j = 0 ; j < 3 ; ++j) {
+      double maxa    = 0 ;
+      double maxabsa = 0 ;
+      int    maxi    = -1 ;
+      double tmp ;
+
+      /* look for the maximally stable pivot */
+      for (i = j ; i < 3 ; ++i) {
+        double a    = Aat (i,j) ;
+        double absa = vl_abs_d (a) ;
+        if (absa > maxabsa) {
+          maxa    = a ;
+          maxabsa = absa ;
+          maxi    = i ;
+        }
+      }
+
+      /* if singular give up */
+      if (maxabsa < 1e-10f) {
+        b[0] = 0 ;
+        b[1] = 0 ;
+        b[2] = 0 ;
+        break ;
+      }
+
+      i = maxi ;
+
+      /* swap j-th row with i-th row and normalize j-th row */
+      for(jj = j ; jj < 3 ; ++jj) {
+        tmp = Aat(i,jj) ; Aat(i,jj) = Aat(j,jj) ; Aat(j,jj) = tmp ;
+        Aat(j,jj) /= maxa ;
+      }
+      tmp = b[j] ; b[j] = b[i] ; b[i] = tmp ;
+      b[j] /= maxa ;
+
+      /* elimination */
+      for (ii = j+1 ; ii < 3 ; ++ii) {
+        double x = Aat(ii,j) ;
+        for (jj = j ; jj < 3 ; ++jj) {
+          Aat(ii,jj) -= x * Aat(j,jj) ;
+        }
+        b[ii] -= x * b[j] ;
+      }
+    }
+
+    /* backward substitution */
+    for (i = 2 ; i > 0 ; --i) {
+      double x = b[i] ;
+      for (ii = i-1 ; ii >= 0 ; --ii) {
+        b[ii] -= x * Aat(ii,i) ;
+      }
     }
+
+    /* .......................................................... */
+    /* If the translation of the keypoint is big, move the keypoint
+     * and re-iterate the computation. Otherwise we are all set.
+     */
+
+    dx= ((b[0] >  0.6 && x < w - 2) ?  1 : 0)
+      + ((b[0] < -0.6 && x > 1    ) ? -1 : 0) ;
+
+    dy= ((b[1] >  0.6 && y < h - 2) ?  1 : 0)
+      + ((b[1] < -0.6 && y > 1    ) ? -1 : 0) ;
+
+    if (dx == 0 && dy == 0) break ;
   }
 
-  /* -----------------------------------------------------------------
-   *                                          Find local maxima of DoG
-   * -------------------------------------------------------------- */
+  /* check threshold and other conditions */
+  {
+    double val   = at(0,0,0)
+      + 0.5 * (Dx * b[0] + Dy * b[1] + Ds * b[2]) ;
+    double score = (Dxx+Dyy)*(Dxx+Dyy) / (Dxx*Dyy - Dxy*Dxy) ;
+    double xn = x + b[0] ;
+    double yn = y + b[1] ;
+    double sn = s + b[2] ;
+
+    vl_bool good =
+      vl_abs_d (val)  > tp                  &&
+      score           < (te+1)*(te+1)/te    &&
+      score           >= 0                  &&
+      vl_abs_d (b[0]) <  1.5                &&
+      vl_abs_d (b[1]) <  1.5                &&
+      vl_abs_d (b[2]) <  1.5                &&
+      xn              >= 0                  &&
+      xn              <= w - 1              &&
+      yn              >= 0                  &&
+      yn              <= h - 1              &&
+      sn              >= s_min              &&
+      sn              <= s_max ;
+
+    if (good) {
+      k-> o     = f->o_cur ;
+      k-> ix    = x ;
+      k-> iy    = y ;
+      k-> is    = s ;
+      k-> s     = sn ;
+      k-> x     = xn * xper ;
+      k-> y     = yn * xper ;
+      k-> sigma = f->sigma0 * pow (2.0, sn/f->S) * xper ;
+    }
+    return good ;
+  } /* done checking */
+}
+
+/** @internal @brief Data of the keypoint detection loops */
+typedef struct _VlSiftDetectLoop
+{
+  VlSiftFilt * f ;       /**< SIFT filter. */
+  vl_uint8 * mask ;      /**< extrema (or refined keypoints) mask. */
+  vl_size * rowOffsets ; /**< number of extrema in each row, then cumulative count. */
+} VlSiftDetectLoop ;
 
-  /* start from dog [1,1,s_min+1] */
-  pt  = dog + xo + yo + so ;
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Compute a range of the difference of Gaussians
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first pixel.
+ ** @param end last pixel plus one.
+ **
+ ** The octave levels are stored contiguously, so the DoG is a single
+ ** subtraction.
+ **/
 
-  for(s = s_min + 1 ; s <= s_max - 2 ; ++s) {
-    for(y = 1 ; y < h - 1 ; ++y) {
-      for(x = 1 ; x < w - 1 ; ++x) {
-        v = *pt ;
+static void
+_vl_sift_dog_range (void * loop_, vl_uindex task VL_UNUSED,
+                    vl_uindex begin, vl_uindex end)
+{
+  VlSiftDetectLoop * loop = loop_ ;
+  VlSiftFilt * f = loop->f ;
+  vl_sift_pix const * octave = vl_sift_get_octave (f, f->s_min) ;
+  vl_size so = (vl_size) f->octave_width * f->octave_height ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    f->dog [i] = octave [i + so] - octave [i] ;
+  }
+}
 
 #define CHECK_NEIGHBORS(CMP,SGN)                    \
         ( v CMP ## = SGN 0.8 * tp &&                \
@@ -1228,305 +1493,313 @@ vl_sift_detect (VlSiftFilt * f)
           v CMP *(pt - yo + xo - so) &&             \
           v CMP *(pt - yo - xo - so) )
 
-        if (CHECK_NEIGHBORS(>,+) ||
-            CHECK_NEIGHBORS(<,-) ) {
-
-          /* make room for more keypoints */
-          if (f->nkeys >= f->keys_res) {
-            f->keys_res += 500 ;
-            if (f->keys) {
-              f->keys = vl_realloc (f->keys,
-                                    f->keys_res *
-                                    sizeof(VlSiftKeypoint)) ;
-            } else {
-              f->keys = vl_malloc (f->keys_res *
-                                   sizeof(VlSiftKeypoint)) ;
-            }
-          }
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Find the local extrema of the DoG for a range of rows
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row.
+ ** @param end last row plus one.
+ **
+ ** Each row of each interior DoG level is scanned independently.
+ ** The extrema are marked in the mask and their number is stored
+ ** in the next entry of @c rowOffsets.
+ **/
 
-          k = f->keys + (f->nkeys ++) ;
+static void
+_vl_sift_find_extrema_range (void * loop_, vl_uindex task VL_UNUSED,
+                             vl_uindex begin, vl_uindex end)
+{
+  VlSiftDetectLoop * loop = loop_ ;
+  VlSiftFilt * f = loop->f ;
+  int          w     = f-> octave_width ;
+  int          h     = f-> octave_height ;
+  double       tp    = f-> peak_thresh ;
 
-          k-> ix = x ;
-          k-> iy = y ;
-          k-> is = s ;
-        }
-        pt += 1 ;
-      }
-      pt += 2 ;
+  int const    xo    = 1 ;      /* x-stride */
+  int const    yo    = w ;      /* y-stride */
+  int const    so    = w * h ;  /* s-stride */
+
+  vl_uindex r ;
+
+  for (r = begin ; r < end ; ++r) {
+    /* row r is row 1 + r % (h-2) of level s_min + 1 + r / (h-2) */
+    vl_sift_pix const * pt = f->dog + xo
+      + yo * (1 + r % (h - 2))
+      + so * (1 + r / (h - 2)) ;
+    vl_uint8 * m = loop->mask + r * w ;
+    vl_size n = 0 ;
+    int x ;
+    for (x = 1 ; x < w - 1 ; ++x) {
+      vl_sift_pix v = *pt ;
+      m [x] = (CHECK_NEIGHBORS(>,+) || CHECK_NEIGHBORS(<,-)) ;
+      n += m [x] ;
+      pt += 1 ;
     }
-    pt += 2 * yo ;
+    loop->rowOffsets [r + 1] = n ;
   }
+}
 
-  /* -----------------------------------------------------------------
-   *                                               Refine local maxima
-   * -------------------------------------------------------------- */
-
-  /* this pointer is used to write the keypoints back */
-  k = f->keys ;
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Write the keypoints of a range of rows
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row.
+ ** @param end last row plus one.
+ **/
 
-  for (i = 0 ; i < f->nkeys ; ++i) {
+static void
+_vl_sift_write_keypoints_range (void * loop_, vl_uindex task VL_UNUSED,
+                                vl_uindex begin, vl_uindex end)
+{
+  VlSiftDetectLoop * loop = loop_ ;
+  VlSiftFilt * f = loop->f ;
+  int w = f-> octave_width ;
+  int h = f-> octave_height ;
+  vl_uindex r ;
+
+  for (r = begin ; r < end ; ++r) {
+    vl_uint8 const * m = loop->mask + r * w ;
+    VlSiftKeypoint * kr = f->keys + loop->rowOffsets [r] ;
+    int x ;
+    for (x = 1 ; x < w - 1 ; ++x) {
+      if (m [x]) {
+        kr-> ix = x ;
+        kr-> iy = 1 + (int)(r % (h - 2)) ;
+        kr-> is = f->s_min + 1 + (int)(r / (h - 2)) ;
+        ++ kr ;
+      }
+    }
+  }
+}
 
-    int x = f-> keys [i] .ix ;
-    int y = f-> keys [i] .iy ;
-    int s = f-> keys [i]. is ;
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Refine a range of keypoints
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first keypoint.
+ ** @param end last keypoint plus one.
+ **
+ ** The mask has at least one entry per keypoint and is reused to
+ ** record which keypoints pass the tests.
+ **/
 
-    double Dx=0,Dy=0,Ds=0,Dxx=0,Dyy=0,Dss=0,Dxy=0,Dxs=0,Dys=0 ;
-    double A [3*3], b [3] ;
+static void
+_vl_sift_refine_keypoints_range (void * loop_, vl_uindex task VL_UNUSED,
+                                 vl_uindex begin, vl_uindex end)
+{
+  VlSiftDetectLoop * loop = loop_ ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    loop->mask [i] = (vl_uint8) _vl_sift_refine_keypoint (loop->f, loop->f->keys + i) ;
+  }
+}
 
-    int dx = 0 ;
-    int dy = 0 ;
+/** ------------------------------------------------------------------
+ ** @brief Detect keypoints
+ **
+ ** The function detect keypoints in the current octave filling the
+ ** internal keypoint buffer. Keypoints can be retrieved by
+ ** ::vl_sift_get_keypoints().
+ **
+ ** The DoG, the search for local extrema and their refinement are
+ ** computed in parallel (see @ref threads). The keypoints are
+ ** still returned in the same order as the serial code (by scale,
+ ** row and column).
+ **
+ ** @param f SIFT filter.
+ ** @return error code. The function returns ::VL_ERR_ALLOC (and
+ ** sets the last error) if its working memory could not be
+ ** allocated, in which case no keypoint is returned.
+ **/
 
-    int iter, i, j ;
+VL_EXPORT
+int
+vl_sift_detect (VlSiftFilt * f)
+{
+  int          s_min = f-> s_min ;
+  int          s_max = f-> s_max ;
+  int          w     = f-> octave_width ;
+  int          h     = f-> octave_height ;
 
-    for (iter = 0 ; iter < 5 ; ++iter) {
+  /* small octaves are processed by the calling thread only */
+  vl_size      maxNumTasks = (w * h >= VL_SIFT_MIN_PARALLEL_PIXELS) ?
+                             vl_get_max_threads() : 1 ;
 
-      x += dx ;
-      y += dy ;
+  vl_index i, r, numRows, numPixels ;
+  vl_uint8 * mask = NULL ;
+  vl_size * rowOffsets = NULL ;
+  VlSiftKeypoint *k ;
+  VlSiftDetectLoop loop ;
 
-      pt = dog
-        + xo * x
-        + yo * y
-        + so * (s - s_min) ;
+  /* clear current list */
+  f-> nkeys = 0 ;
+  loop.f = f ;
 
-      /** @brief Index GSS @internal */
-#define at(dx,dy,ds) (*( pt + (dx)*xo + (dy)*yo + (ds)*so))
+  /* compute difference of gaussian (DoG) */
+  numPixels = (vl_index) w * h * (s_max - s_min) ;
+  vl_parallel_for (numPixels, VL_MIN(maxNumTasks, (vl_size)numPixels),
+                   _vl_sift_dog_range, &loop) ;
 
-      /** @brief Index matrix A @internal */
-#define Aat(i,j)     (A[(i)+(j)*3])
+  /* -----------------------------------------------------------------
+   *                                          Find local maxima of DoG
+   * -------------------------------------------------------------- */
 
-      /* compute the gradient */
-      Dx = 0.5 * (at(+1,0,0) - at(-1,0,0)) ;
-      Dy = 0.5 * (at(0,+1,0) - at(0,-1,0));
-      Ds = 0.5 * (at(0,0,+1) - at(0,0,-1)) ;
-
-      /* compute the Hessian */
-      Dxx = (at(+1,0,0) + at(-1,0,0) - 2.0 * at(0,0,0)) ;
-      Dyy = (at(0,+1,0) + at(0,-1,0) - 2.0 * at(0,0,0)) ;
-      Dss = (at(0,0,+1) + at(0,0,-1) - 2.0 * at(0,0,0)) ;
-
-      Dxy = 0.25 * ( at(+1,+1,0) + at(-1,-1,0) - at(-1,+1,0) - at(+1,-1,0) ) ;
-      Dxs = 0.25 * ( at(+1,0,+1) + at(-1,0,-1) - at(-1,0,+1) - at(+1,0,-1) ) ;
-      Dys = 0.25 * ( at(0,+1,+1) + at(0,-1,-1) - at(0,-1,+1) - at(0,+1,-1) ) ;
-
-      /* solve linear system ....................................... */
-      Aat(0,0) = Dxx ;
-      Aat(1,1) = Dyy ;
-      Aat(2,2) = Dss ;
-      Aat(0,1) = Aat(1,0) = Dxy ;
-      Aat(0,2) = Aat(2,0) = Dxs ;
-      Aat(1,2) = Aat(2,1) = Dys ;
-
-      b[0] = - Dx ;
-      b[1] = - Dy ;
-      b[2] = - Ds ;
-
-      /* Gauss elimination */
-      for(j = 0 ; j < 3 ; ++j) {
-        double maxa    = 0 ;
-        double maxabsa = 0 ;
-        int    maxi    = -1 ;
-        double tmp ;
-
-        /* look for the maximally stable pivot */
-        for (i = j ; i < 3 ; ++i) {
-          double a    = Aat (i,j) ;
-          double absa = vl_abs_d (a) ;
-          if (absa > maxabsa) {
-            maxa    = a ;
-            maxabsa = absa ;
-            maxi    = i ;
-          }
-        }
+  /* The extrema are marked in a mask and counted, then written to
+   * the keypoint buffer at the offset given by the cumulative count
+   * of the preceding rows. */
 
-        /* if singular give up */
-        if (maxabsa < 1e-10f) {
-          b[0] = 0 ;
-          b[1] = 0 ;
-          b[2] = 0 ;
-          break ;
-        }
+  numRows = (vl_index) VL_MAX(s_max - s_min - 2, 0) * VL_MAX(h - 2, 0) ;
+  if (numRows == 0 || w < 3) return VL_ERR_OK ;
 
-        i = maxi ;
+  mask = vl_malloc (sizeof(vl_uint8) * numRows * w) ;
+  rowOffsets = vl_malloc (sizeof(vl_size) * (numRows + 1)) ;
+  if (mask == NULL || rowOffsets == NULL) goto alloc_error ;
 
-        /* swap j-th row with i-th row and normalize j-th row */
-        for(jj = j ; jj < 3 ; ++jj) {
-          tmp = Aat(i,jj) ; Aat(i,jj) = Aat(j,jj) ; Aat(j,jj) = tmp ;
-          Aat(j,jj) /= maxa ;
-        }
-        tmp = b[j] ; b[j] = b[i] ; b[i] = tmp ;
-        b[j] /= maxa ;
-
-        /* elimination */
-        for (ii = j+1 ; ii < 3 ; ++ii) {
-          double x = Aat(ii,j) ;
-          for (jj = j ; jj < 3 ; ++jj) {
-            Aat(ii,jj) -= x * Aat(j,jj) ;
-          }
-          b[ii] -= x * b[j] ;
-        }
-      }
+  loop.mask = mask ;
+  loop.rowOffsets = rowOffsets ;
+  vl_parallel_for (numRows, VL_MIN(maxNumTasks, (vl_size)numRows),
+                   _vl_sift_find_extrema_range, &loop) ;
 
-      /* backward substitution */
-      for (i = 2 ; i > 0 ; --i) {
-        double x = b[i] ;
-        for (ii = i-1 ; ii >= 0 ; --ii) {
-          b[ii] -= x * Aat(ii,i) ;
-        }
-      }
+  rowOffsets [0] = 0 ;
+  for (r = 0 ; r < numRows ; ++r) {
+    rowOffsets [r + 1] += rowOffsets [r] ;
+  }
+  f->nkeys = (int) rowOffsets [numRows] ;
+
+  /* make room for the keypoints */
+  if (f->nkeys > f->keys_res) {
+    int keys_res = (f->nkeys + 499) / 500 * 500 ;
+    VlSiftKeypoint * keys = vl_realloc (f->keys,
+                                        keys_res *
+                                        sizeof(VlSiftKeypoint)) ;
+    if (keys == NULL) goto alloc_error ;
+    f->keys = keys ;
+    f->keys_res = keys_res ;
+  }
 
-      /* .......................................................... */
-      /* If the translation of the keypoint is big, move the keypoint
-       * and re-iterate the computation. Otherwise we are all set.
-       */
+  vl_parallel_for (numRows, VL_MIN(maxNumTasks, (vl_size)numRows),
+                   _vl_sift_write_keypoints_range, &loop) ;
 
-      dx= ((b[0] >  0.6 && x < w - 2) ?  1 : 0)
-        + ((b[0] < -0.6 && x > 1    ) ? -1 : 0) ;
+  /* -----------------------------------------------------------------
+   *                                               Refine local maxima
+   * -------------------------------------------------------------- */
 
-      dy= ((b[1] >  0.6 && y < h - 2) ?  1 : 0)
-        + ((b[1] < -0.6 && y > 1    ) ? -1 : 0) ;
+  /* the cost of refining a keypoint varies, so use small tasks */
+  vl_parallel_for (f->nkeys, (maxNumTasks > 1) ? (f->nkeys + 63) / 64 : 1,
+                   _vl_sift_refine_keypoints_range, &loop) ;
 
-      if (dx == 0 && dy == 0) break ;
+  /* this pointer is used to write the keypoints back */
+  k = f->keys ;
+  for (i = 0 ; i < f->nkeys ; ++i) {
+    if (mask [i]) {
+      *k++ = f->keys [i] ;
     }
+  }
 
-    /* check threshold and other conditions */
-    {
-      double val   = at(0,0,0)
-        + 0.5 * (Dx * b[0] + Dy * b[1] + Ds * b[2]) ;
-      double score = (Dxx+Dyy)*(Dxx+Dyy) / (Dxx*Dyy - Dxy*Dxy) ;
-      double xn = x + b[0] ;
-      double yn = y + b[1] ;
-      double sn = s + b[2] ;
-
-      vl_bool good =
-        vl_abs_d (val)  > tp                  &&
-        score           < (te+1)*(te+1)/te    &&
-        score           >= 0                  &&
-        vl_abs_d (b[0]) <  1.5                &&
-        vl_abs_d (b[1]) <  1.5                &&
-        vl_abs_d (b[2]) <  1.5                &&
-        xn              >= 0                  &&
-        xn              <= w - 1              &&
-        yn              >= 0                  &&
-        yn              <= h - 1              &&
-        sn              >= s_min              &&
-        sn              <= s_max ;
-
-      if (good) {
-        k-> o     = f->o_cur ;
-        k-> ix    = x ;
-        k-> iy    = y ;
-        k-> is    = s ;
-        k-> s     = sn ;
-        k-> x     = xn * xper ;
-        k-> y     = yn * xper ;
-        k-> sigma = f->sigma0 * pow (2.0, sn/f->S) * xper ;
-        ++ k ;
-      }
-
-    } /* done checking */
-  } /* next keypoint to refine */
+  vl_free (rowOffsets) ;
+  vl_free (mask) ;
 
   /* update keypoint count */
   f-> nkeys = (int)(k - f->keys) ;
+  return VL_ERR_OK ;
+
+alloc_error:
+  if (rowOffsets) vl_free (rowOffsets) ;
+  if (mask) vl_free (mask) ;
+  f-> nkeys = 0 ;
+  return vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the SIFT keypoints.") ;
 }
 
 
 /** ------------------------------------------------------------------
  ** @internal
- ** @brief Update gradients to current GSS octave
- **
- ** @param f SIFT filter.
- **
- ** The function makes sure that the gradient buffer is up-to-date
- ** with the current GSS data.
- **
- ** @remark The minimum octave size is 2x2xS.
+ ** @brief Compute the gradient for a range of rows of the octave
+ ** @param f_ SIFT filter.
+ ** @param task task index.
+ ** @param begin first row.
+ ** @param end last row plus one.
  **/
 
 static void
-update_gradient (VlSiftFilt *f)
+_vl_sift_update_gradient_range (void * f_, vl_uindex task VL_UNUSED,
+                                vl_uindex begin, vl_uindex end)
 {
+  VlSiftFilt * f  = f_ ;
   int       s_min = f->s_min ;
-  int       s_max = f->s_max ;
   int       w     = vl_sift_get_octave_width  (f) ;
   int       h     = vl_sift_get_octave_height (f) ;
   int const xo    = 1 ;
   int const yo    = w ;
   int const so    = h * w ;
-  int y, s ;
-
-  if (f->grad_o == f->o_cur) return ;
-
-  for (s  = s_min + 1 ;
-       s <= s_max - 2 ; ++ s) {
-
-    vl_sift_pix *src, *end, *grad, gx, gy ;
+  vl_uindex r ;
+
+  for (r = begin ; r < end ; ++r) {
+    int s = s_min + 1 + (int)(r / h) ;
+    int y = (int)(r % h) ;
+
+    /* vertical differences are central except on the first and last
+       rows, where they are one-sided */
+    vl_sift_pix const *src  = vl_sift_get_octave (f,s) + yo * y ;
+    vl_sift_pix const *up   = (y > 0)     ? src - yo : src ;
+    vl_sift_pix const *down = (y < h - 1) ? src + yo : src ;
+    double const       dys  = (y > 0 && y < h - 1) ? 0.5 : 1.0 ;
+    vl_sift_pix       *grad = f->grad + 2 * so * (s - s_min -1) + 2 * yo * y ;
+    vl_sift_pix        gx, gy ;
+    int x ;
 
 #define SAVE_BACK                                                       \
     *grad++ = vl_fast_sqrt_f (gx*gx + gy*gy) ;                          \
     *grad++ = vl_mod_2pi_f   (vl_fast_atan2_f (gy, gx) + 2*VL_PI) ;     \
-    ++src ;                                                             \
 
-    src  = vl_sift_get_octave (f,s) ;
-    grad = f->grad + 2 * so * (s - s_min -1) ;
-
-    /* first pixel of the first row */
+    /* first pixel of the row */
     gx = src[+xo] - src[0] ;
-    gy = src[+yo] - src[0] ;
+    gy = dys * (down[0] - up[0]) ;
     SAVE_BACK ;
 
-    /* middle pixels of the  first row */
-    end = (src - 1) + w - 1 ;
-    while (src < end) {
-      gx = 0.5 * (src[+xo] - src[-xo]) ;
-      gy =        src[+yo] - src[0] ;
+    /* middle pixels of the row */
+    for (x = 1 ; x < w - 1 ; ++x) {
+      gx = 0.5 * (src[x+xo] - src[x-xo]) ;
+      gy = dys * (down[x] - up[x]) ;
       SAVE_BACK ;
     }
 
-    /* last pixel of the first row */
-    gx = src[0]   - src[-xo] ;
-    gy = src[+yo] - src[0] ;
+    /* last pixel of the row */
+    gx = src[w-1] - src[w-1-xo] ;
+    gy = dys * (down[w-1] - up[w-1]) ;
     SAVE_BACK ;
+  }
+}
 
-    for (y = 1 ; y < h -1 ; ++y) {
-
-      /* first pixel of the middle rows */
-      gx =        src[+xo] - src[0] ;
-      gy = 0.5 * (src[+yo] - src[-yo]) ;
-      SAVE_BACK ;
-
-      /* middle pixels of the middle rows */
-      end = (src - 1) + w - 1 ;
-      while (src < end) {
-        gx = 0.5 * (src[+xo] - src[-xo]) ;
-        gy = 0.5 * (src[+yo] - src[-yo]) ;
-        SAVE_BACK ;
-      }
-
-      /* last pixel of the middle row */
-      gx =        src[0]   - src[-xo] ;
-      gy = 0.5 * (src[+yo] - src[-yo]) ;
-      SAVE_BACK ;
-    }
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Update gradients to current GSS octave
+ **
+ ** @param f SIFT filter.
+ **
+ ** The function makes sure that the gradient buffer is up-to-date
+ ** with the current GSS data. The rows of the octave levels are
+ ** processed independently (and in parallel for large octaves).
+ **
+ ** @remark The minimum octave size is 2x2xS.
+ **/
 
-    /* first pixel of the last row */
-    gx = src[+xo] - src[0] ;
-    gy = src[  0] - src[-yo] ;
-    SAVE_BACK ;
+static void
+update_gradient (VlSiftFilt *f)
+{
+  int       w     = vl_sift_get_octave_width  (f) ;
+  int       h     = vl_sift_get_octave_height (f) ;
+  vl_size   numRows ;
 
-    /* middle pixels of the last row */
-    end = (src - 1) + w - 1 ;
-    while (src < end) {
-      gx = 0.5 * (src[+xo] - src[-xo]) ;
-      gy =        src[0]   - src[-yo] ;
-      SAVE_BACK ;
-    }
+  if (f->grad_o == f->o_cur) return ;
 
-    /* last pixel of the last row */
-    gx = src[0]   - src[-xo] ;
-    gy = src[0]   - src[-yo] ;
-    SAVE_BACK ;
-  }
+  numRows = (vl_size) VL_MAX(f->s_max - f->s_min - 2, 0) * h ;
+  vl_parallel_for (numRows,
+                   (w * h >= VL_SIFT_MIN_PARALLEL_PIXELS) ?
+                   VL_MIN(vl_get_max_threads(), numRows) : 1,
+                   _vl_sift_update_gradient_range, f) ;
   f->grad_o = f->o_cur ;
 }
 
@@ -2195,3 +2468,191 @@ vl_sift_keypoint_init (VlSiftFilt const *f,
 
   k->sigma = sigma ;
 }
+
+/** @internal @brief Data of the loop describing the keypoints of an octave */
+typedef struct _VlSiftExtractLoop
+{
+  VlSiftFilt * f ;               /**< SIFT filter. */
+  VlSiftKeypoint const * keys ;  /**< keypoints. */
+  double * angles ;              /**< up to four orientations for each keypoint (out). */
+  int * numAngles ;              /**< number of orientations of each keypoint (out). */
+  vl_sift_pix * descrs ;         /**< descriptor for each orientation (out, or NULL). */
+} VlSiftExtractLoop ;
+
+/** ------------------------------------------------------------------
+ ** @internal
+ ** @brief Compute orientations and descriptors for a range of keypoints
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first keypoint.
+ ** @param end last keypoint plus one.
+ **
+ ** The gradient of the octave must be up to date.
+ **/
+
+static void
+_vl_sift_extract_range (void * loop_, vl_uindex task VL_UNUSED,
+                        vl_uindex begin, vl_uindex end)
+{
+  VlSiftExtractLoop * loop = loop_ ;
+  vl_size const descrSize = NBO*NBP*NBP ;
+  vl_uindex i ;
+  for (i = begin ; i < end ; ++i) {
+    int q ;
+    loop->numAngles [i] = vl_sift_calc_keypoint_orientations
+      (loop->f, loop->angles + 4 * i, loop->keys + i) ;
+    if (loop->descrs) {
+      for (q = 0 ; q < loop->numAngles [i] ; ++q) {
+        vl_sift_calc_keypoint_descriptor
+          (loop->f, loop->descrs + descrSize * (4 * i + q), loop->keys + i,
+           loop->angles [4 * i + q]) ;
+      }
+    }
+  }
+}
+
+/** ------------------------------------------------------------------
+ ** @brief Extract all SIFT features from an image
+ **
+ ** @param f      SIFT filter.
+ ** @param im     image data.
+ ** @param frames frames (output).
+ ** @param descrs descriptors (output, optional).
+ **
+ ** The function runs the complete SIFT pipeline on the image @a im:
+ ** it processes all the octaves of the scale space, detects the
+ ** keypoints and computes their orientations and descriptors. It is
+ ** equivalent to the loop described in @ref sift-usage, but the
+ ** keypoints of an octave are processed in parallel (see @ref
+ ** threads).
+ **
+ ** The function returns a newly allocated array of frames in @a
+ ** *frames, four doubles per feature (x, y, scale and orientation),
+ ** and, if @a descrs is not @c NULL, a newly allocated array of
+ ** descriptors in @a *descrs, 128 values per feature. The buffers
+ ** must be released by ::vl_free. The features are returned in
+ ** the same order as the serial loop (by octave, keypoint and
+ ** orientation).
+ **
+ ** If memory cannot be allocated, the function releases the partial
+ ** results, sets @a *frames (and @a *descrs) to @c NULL, sets the
+ ** last error to ::VL_ERR_ALLOC and returns zero.
+ **
+ ** @return number of features extracted.
+ **/
+
+VL_EXPORT
+vl_size
+vl_sift_extract_all (VlSiftFilt *f,
+                     vl_sift_pix const *im,
+                     double **frames,
+                     vl_sift_pix **descrs)
+{
+  vl_size const descrSize = NBO*NBP*NBP ;
+  vl_size numFeatures = 0 ;
+  vl_size numAllocated = 0 ;
+  double * angles = NULL ;
+  int * numAngles = NULL ;
+  vl_sift_pix * keyDescrs = NULL ;
+  VlSiftExtractLoop loop ;
+  int err ;
+
+  *frames = NULL ;
+  if (descrs) *descrs = NULL ;
+
+  err = vl_sift_process_first_octave (f, im) ;
+  while (err != VL_ERR_EOF) {
+    VlSiftKeypoint const * keys ;
+    vl_index numKeys, i ;
+
+    if (vl_sift_detect (f)) goto alloc_error ;
+    keys = vl_sift_get_keypoints (f) ;
+    numKeys = vl_sift_get_nkeypoints (f) ;
+
+    if (numKeys == 0) {
+      err = vl_sift_process_next_octave (f) ;
+      continue ;
+    }
+
+    /* compute the gradient now, so that the keypoints can then be
+       processed concurrently without modifying the filter */
+    update_gradient (f) ;
+
+    angles = vl_malloc (sizeof(double) * 4 * numKeys) ;
+    numAngles = vl_malloc (sizeof(int) * numKeys) ;
+    if (descrs) {
+      keyDescrs = vl_malloc (sizeof(vl_sift_pix) * descrSize * 4 * numKeys) ;
+    }
+    if (angles == NULL || numAngles == NULL || (descrs && keyDescrs == NULL)) {
+      goto alloc_error ;
+    }
+
+    /* the keypoints have different sizes, so use small tasks */
+    loop.f = f ;
+    loop.keys = keys ;
+    loop.angles = angles ;
+    loop.numAngles = numAngles ;
+    loop.descrs = keyDescrs ;
+    vl_parallel_for (numKeys, (numKeys + 15) / 16, _vl_sift_extract_range, &loop) ;
+
+    /* append the features of this octave */
+    {
+      vl_size n = numFeatures ;
+      for (i = 0 ; i < numKeys ; ++i) n += numAngles [i] ;
+      if (n > numAllocated) {
+        double * newFrames ;
+        vl_sift_pix * newDescrs ;
+        numAllocated = VL_MAX(2 * numAllocated, n) ;
+        newFrames = vl_realloc (*frames, sizeof(double) * 4 * numAllocated) ;
+        if (newFrames == NULL) goto alloc_error ;
+        *frames = newFrames ;
+        if (descrs) {
+          newDescrs = vl_realloc (*descrs, sizeof(vl_sift_pix) * descrSize * numAllocated) ;
+          if (newDescrs == NULL) goto alloc_error ;
+          *descrs = newDescrs ;
+        }
+      }
+    }
+
+    for (i = 0 ; i < numKeys ; ++i) {
+      int q ;
+      for (q = 0 ; q < numAngles [i] ; ++q) {
+        double * frame = *frames + 4 * numFeatures ;
+        frame [0] = keys [i].x ;
+        frame [1] = keys [i].y ;
+        frame [2] = keys [i].sigma ;
+        frame [3] = angles [4 * i + q] ;
+        if (descrs) {
+          memcpy (*descrs + descrSize * numFeatures,
+                  keyDescrs + descrSize * (4 * i + q),
+                  sizeof(vl_sift_pix) * descrSize) ;
+        }
+        ++ numFeatures ;
+      }
+    }
+
+    vl_free (angles) ;
+    vl_free (numAngles) ;
+    if (keyDescrs) vl_free (keyDescrs) ;
+    angles = NULL ;
+    numAngles = NULL ;
+    keyDescrs = NULL ;
+
+    err = vl_sift_process_next_octave (f) ;
+  }
+
+  return numFeatures ;
+
+alloc_error:
+  if (angles) vl_free (angles) ;
+  if (numAngles) vl_free (numAngles) ;
+  if (keyDescrs) vl_free (keyDescrs) ;
+  if (*frames) vl_free (*frames) ;
+  *frames = NULL ;
+  if (descrs) {
+    if (*descrs) vl_free (*descrs) ;
+    *descrs = NULL ;
+  }
+  vl_set_last_error (VL_ERR_ALLOC, "Could not allocate the SIFT features.") ;
+  return 0 ;
+}
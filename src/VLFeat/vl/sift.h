@@ -111,7 +111,7 @@ VL_EXPORT
 int   vl_sift_process_next_octave        (VlSiftFilt *f) ;
 
 VL_EXPORT
-void  vl_sift_detect                     (VlSiftFilt *f) ;
+int   vl_sift_detect                     (VlSiftFilt *f) ;
 
 VL_EXPORT
 int   vl_sift_calc_keypoint_orientations (VlSiftFilt *f,
@@ -137,6 +137,12 @@ void  vl_sift_keypoint_init              (VlSiftFilt const *f,
                                           double x,
                                           double y,
                                           double sigma) ;
+
+VL_EXPORT
+vl_size vl_sift_extract_all              (VlSiftFilt *f,
+                                          vl_sift_pix const *im,
+                                          double **frames,
+                                          vl_sift_pix **descrs) ;
 /** @} */
 
 /** @name Retrieve data and parameters
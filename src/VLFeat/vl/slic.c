@@ -130,6 +130,12 @@ pixel-to-center comparisons at each round of minimization, which
 threfore cost @f$ O(n) @f$, where @f$ n @f$ is the number of
 superpixels.
 
+The assignment step is computed in parallel over image rows (and
+using SIMD instructions to compare four pixels at a time) and the
+re-estimation step in parallel over the centers. Since each center
+collects its pixels from the neighbour tiles in lexicographical order,
+the result does not depend on the number of threads.
+
 After k-means has converged, SLIC eliminates any connected region whose
 area is less than @c minRegionSize pixels. This is done by greedily
 merging regions to neighbour ones: the pixels @f$ p @f$ are scanned in
@@ -143,10 +149,299 @@ except for the very first pixel).
 */
 
 #include "slic.h"
+#include "slic_sse2.h"
 #include "mathop.h"
 #include <math.h>
 #include <string.h>
 
+/** @internal
+ ** @brief Assign a run of pixels to the closest candidate region
+ ** @param segmentation segmentation of the first pixel of the run.
+ ** @param distances distance to the closest region (output).
+ ** @param image first channel of the first pixel of the run.
+ ** @param channelStride distance between image channels.
+ ** @param numChannels number of image channels.
+ ** @param numPixels length of the run.
+ ** @param x coordinate of the first pixel of the run.
+ ** @param y coordinate of the pixels of the run.
+ ** @param centers region centers.
+ ** @param regions candidate regions.
+ ** @param numRegions number of candidate regions.
+ ** @param factor weight of the spatial term.
+ **
+ ** The segmentation is left unchanged if no region is closer than
+ ** infinity.
+ **/
+
+static void
+_vl_slic_assign_pixels (vl_uint32 * segmentation,
+                        float * distances,
+                        float const * image,
+                        vl_size channelStride,
+                        vl_size numChannels,
+                        vl_size numPixels,
+                        vl_index x, vl_index y,
+                        float const * centers,
+                        vl_uint32 const * regions,
+                        vl_size numRegions,
+                        float factor)
+{
+  vl_uindex i, r, k ;
+  for (i = 0 ; i < numPixels ; ++i, ++x) {
+    float minDistance = VL_INFINITY_F ;
+    for (r = 0 ; r < numRegions ; ++r) {
+      float const * center = centers + (2 + numChannels) * regions[r] ;
+      float centerx = center[0] ;
+      float centery = center[1] ;
+      float spatial = (x - centerx) * (x - centerx) + (y - centery) * (y - centery) ;
+      float appearance = 0 ;
+      float distance ;
+      for (k = 0 ; k < numChannels ; ++k) {
+        float centerz = center[k + 2] ;
+        float z = image[k * channelStride + i] ;
+        appearance += (z - centerz) * (z - centerz) ;
+      }
+      distance = appearance + factor * spatial ;
+      if (minDistance > distance) {
+        minDistance = distance ;
+        segmentation[i] = regions[r] ;
+      }
+    }
+    distances[i] = minDistance ;
+  }
+}
+
+/** @internal
+ ** @brief Assign a row of pixels to the closest regions
+ ** @param segmentation segmentation (output).
+ ** @param distances distance of each pixel to its region (output).
+ ** @param image image.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param numChannels number of image channels.
+ ** @param regionSize nominal size of the regions.
+ ** @param numRegionsX number of regions along the X direction.
+ ** @param numRegionsY number of regions along the Y direction.
+ ** @param centers region centers.
+ ** @param factor weight of the spatial term.
+ ** @param y row.
+ **
+ ** Each pixel is compared to the (up to) four regions originated
+ ** from the neighbour tiles. Consecutive pixels share the same
+ ** candidates in runs of about @a regionSize pixels, which are
+ ** processed four pixels at a time if SSE2 is available.
+ **/
+
+static void
+_vl_slic_assign_row (vl_uint32 * segmentation,
+                     float * distances,
+                     float const * image,
+                     vl_size width,
+                     vl_size height,
+                     vl_size numChannels,
+                     vl_size regionSize,
+                     vl_size numRegionsX,
+                     vl_size numRegionsY,
+                     float const * centers,
+                     float factor,
+                     vl_index y)
+{
+  vl_index v = floor((double)y / regionSize - 0.5) ;
+  vl_index x = 0 ;
+  vl_index offset = y * width ;
+
+  while (x < (signed)width) {
+    vl_index u = floor((double)x / regionSize - 0.5) ;
+    vl_index up, vp, end ;
+    vl_uint32 regions [4] ;
+    vl_size numRegions = 0 ;
+    vl_size numDone = 0 ;
+
+    for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
+      for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
+        regions[numRegions++] = (vl_uint32) (up + vp * numRegionsX) ;
+      }
+    }
+
+    /* find the end of the run of pixels with the same candidates */
+    for (end = x + 1 ;
+         end < (signed)width && (vl_index) floor((double)end / regionSize - 0.5) == u ;
+         ++end) ;
+
+#ifndef VL_DISABLE_SSE2
+    if (vl_cpu_has_sse2() && vl_get_simd_enabled()) {
+      numDone = _vl_slic_assign_sse2
+      (segmentation + offset + x, distances + offset + x, image + offset + x,
+       width * height, numChannels, end - x, x, y,
+       centers, regions, numRegions, factor) ;
+    }
+#endif
+    _vl_slic_assign_pixels
+    (segmentation + offset + x + numDone, distances + offset + x + numDone,
+     image + offset + x + numDone,
+     width * height, numChannels, end - x - numDone, x + numDone, y,
+     centers, regions, numRegions, factor) ;
+    x = end ;
+  }
+}
+
+/** @internal
+ ** @brief Re-estimate a region center
+ ** @param center region center (output).
+ ** @param segmentation segmentation.
+ ** @param image image.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param numChannels number of image channels.
+ ** @param regionSize nominal size of the regions.
+ ** @param numRegionsX number of regions along the X direction.
+ ** @param region region index.
+ **
+ ** The center is set to the average of the feature vectors of the
+ ** pixels assigned to the region. These can only be in the window of
+ ** the tiles neighbouring the region tile, which is scanned in
+ ** lexicographical order. Hence the sums are the same as if the whole
+ ** image was scanned, and different regions can be re-estimated in
+ ** parallel.
+ **/
+
+static void
+_vl_slic_update_center (float * center,
+                        vl_uint32 const * segmentation,
+                        float const * image,
+                        vl_size width,
+                        vl_size height,
+                        vl_size numChannels,
+                        vl_size regionSize,
+                        vl_size numRegionsX,
+                        vl_index region)
+{
+  vl_index u = region % numRegionsX ;
+  vl_index v = region / numRegionsX ;
+  vl_index xmin = VL_MAX(0, (vl_index) floor(regionSize * (u - 0.5)) - 1) ;
+  vl_index xmax = VL_MIN((signed)width, (vl_index) ceil(regionSize * (u + 1.5)) + 1) ;
+  vl_index ymin = VL_MAX(0, (vl_index) floor(regionSize * (v - 0.5)) - 1) ;
+  vl_index ymax = VL_MIN((signed)height, (vl_index) ceil(regionSize * (v + 1.5)) + 1) ;
+  vl_index x, y, k ;
+  vl_uint32 masses = 0 ;
+  float mass ;
+
+  memset(center, 0, sizeof(float) * (2 + numChannels)) ;
+
+  for (y = ymin ; y < ymax ; ++y) {
+    for (x = xmin ; x < xmax ; ++x) {
+      vl_index pixel = x + y * width ;
+      if (segmentation[pixel] != (vl_uint32)region) continue ;
+      masses ++ ;
+      center[0] += x ;
+      center[1] += y ;
+      for (k = 0 ; k < (signed)numChannels ; ++k) {
+        center[k + 2] += image[pixel + k * width * height] ;
+      }
+    }
+  }
+
+  mass = VL_MAX(masses, 1e-8) ;
+  for (k = 0 ; k < (signed)(2 + numChannels) ; ++k) {
+    center[k] /= mass ;
+  }
+}
+
+#define atimage(x,y,k) image[(x)+(y)*width+(k)*width*height]
+#define atEdgeMap(x,y) edgeMap[(x)+(y)*width]
+
+/** @internal @brief Data of the SLIC parallel loops */
+typedef struct _VlSlicLoop
+{
+  vl_uint32 * segmentation ;  /**< segmentation (in and out). */
+  float * distances ;         /**< distance of each pixel to its region (out). */
+  float * edgeMap ;           /**< edge map (out). */
+  float * centers ;           /**< region centers (in and out). */
+  float const * image ;       /**< image. */
+  vl_size width ;             /**< image width. */
+  vl_size height ;            /**< image height. */
+  vl_size numChannels ;       /**< number of image channels. */
+  vl_size regionSize ;        /**< nominal size of the regions. */
+  vl_size numRegionsX ;       /**< number of regions along the X direction. */
+  vl_size numRegionsY ;       /**< number of regions along the Y direction. */
+  float factor ;              /**< weight of the spatial term. */
+} VlSlicLoop ;
+
+/** @internal
+ ** @brief Compute the edge map for a range of inner rows
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row minus one.
+ ** @param end last row.
+ **/
+
+static void
+_vl_slic_edge_map_range (void * loop_, vl_uindex task VL_UNUSED,
+                         vl_uindex begin, vl_uindex end)
+{
+  VlSlicLoop * loop = loop_ ;
+  vl_size const width = loop->width ;
+  vl_size const height = loop->height ;
+  float const * image = loop->image ;
+  float * edgeMap = loop->edgeMap ;
+  vl_index x, y, k ;
+  for (y = (vl_index)begin + 1 ; y < (vl_index)end + 1 ; ++y) {
+    for (k = 0 ; k < (signed)loop->numChannels ; ++k) {
+      for (x = 1 ; x < (signed)width-1 ; ++x) {
+        float a = atimage(x-1,y,k) ;
+        float b = atimage(x+1,y,k) ;
+        float c = atimage(x,y+1,k) ;
+        float d = atimage(x,y-1,k) ;
+        atEdgeMap(x,y) += (a - b)  * (a - b) + (c - d) * (c - d) ;
+      }
+    }
+  }
+}
+
+/** @internal
+ ** @brief Assign a range of rows to the closest regions
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first row.
+ ** @param end last row plus one.
+ **/
+
+static void
+_vl_slic_assign_range (void * loop_, vl_uindex task VL_UNUSED,
+                       vl_uindex begin, vl_uindex end)
+{
+  VlSlicLoop * loop = loop_ ;
+  vl_uindex y ;
+  for (y = begin ; y < end ; ++y) {
+    _vl_slic_assign_row (loop->segmentation, loop->distances, loop->image,
+                         loop->width, loop->height, loop->numChannels,
+                         loop->regionSize, loop->numRegionsX, loop->numRegionsY,
+                         loop->centers, loop->factor, (vl_index)y) ;
+  }
+}
+
+/** @internal
+ ** @brief Re-estimate a range of region centers
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first region.
+ ** @param end last region plus one.
+ **/
+
+static void
+_vl_slic_update_centers_range (void * loop_, vl_uindex task VL_UNUSED,
+                               vl_uindex begin, vl_uindex end)
+{
+  VlSlicLoop * loop = loop_ ;
+  vl_uindex region ;
+  for (region = begin ; region < end ; ++region) {
+    _vl_slic_update_center (loop->centers + (2 + loop->numChannels) * region,
+                            loop->segmentation, loop->image,
+                            loop->width, loop->height, loop->numChannels,
+                            loop->regionSize, loop->numRegionsX, (vl_index)region) ;
+  }
+}
+
 /** @brief SLIC superpixel segmentation
  ** @param segmentation segmentation.
  ** @param image image to segment.
@@ -176,7 +471,7 @@ vl_slic_segment (vl_uint32 * segmentation,
                  float regularization,
                  vl_size minRegionSize)
 {
-  vl_index i, x, y, u, v, k, region ;
+  vl_index i, x, y, u, v, k ;
   vl_uindex iter ;
   vl_size const numRegionsX = (vl_size) ceil((double) width / regionSize) ;
   vl_size const numRegionsY = (vl_size) ceil((double) height / regionSize) ;
@@ -184,10 +479,11 @@ vl_slic_segment (vl_uint32 * segmentation,
   vl_size const numPixels = width * height ;
   float * centers ;
   float * edgeMap ;
+  float * distances ;
   float previousEnergy = VL_INFINITY_F ;
   float startingEnergy ;
-  vl_uint32 * masses ;
   vl_size const maxNumIterations = 100 ;
+  VlSlicLoop loop ;
 
   assert(segmentation) ;
   assert(image) ;
@@ -197,26 +493,26 @@ vl_slic_segment (vl_uint32 * segmentation,
   assert(regionSize >= 1) ;
   assert(regularization >= 0) ;
 
-#define atimage(x,y,k) image[(x)+(y)*width+(k)*width*height]
-#define atEdgeMap(x,y) edgeMap[(x)+(y)*width]
-
   edgeMap = vl_calloc(numPixels, sizeof(float)) ;
-  masses = vl_malloc(sizeof(vl_uint32) * numPixels) ;
+  distances = vl_malloc(sizeof(float) * numPixels) ;
   centers = vl_malloc(sizeof(float) * (2 + numChannels) * numRegions) ;
 
+  loop.segmentation = segmentation ;
+  loop.distances = distances ;
+  loop.edgeMap = edgeMap ;
+  loop.centers = centers ;
+  loop.image = image ;
+  loop.width = width ;
+  loop.height = height ;
+  loop.numChannels = numChannels ;
+  loop.regionSize = regionSize ;
+  loop.numRegionsX = numRegionsX ;
+  loop.numRegionsY = numRegionsY ;
+
   /* compute edge map (gradient strength) */
-  for (k = 0 ; k < (signed)numChannels ; ++k) {
-    for (y = 1 ; y < (signed)height-1 ; ++y) {
-      for (x = 1 ; x < (signed)width-1 ; ++x) {
-        float a = atimage(x-1,y,k) ;
-        float b = atimage(x+1,y,k) ;
-        float c = atimage(x,y+1,k) ;
-        float d = atimage(x,y-1,k) ;
-        atEdgeMap(x,y) += (a - b)  * (a - b) + (c - d) * (c - d) ;
-      }
-    }
+  if (height > 2) {
+    vl_parallel_for (height - 2, 0, _vl_slic_edge_map_range, &loop) ;
   }
-
   /* initialize K-means centers */
   i = 0 ;
   for (v = 0 ; v < (signed)numRegionsY ; ++v) {
@@ -260,35 +556,12 @@ vl_slic_segment (vl_uint32 * segmentation,
     float energy = 0 ;
 
     /* assign pixels to centers */
-    for (y = 0 ; y < (signed)height ; ++y) {
-      for (x = 0 ; x < (signed)width ; ++x) {
-        vl_index u = floor((double)x / regionSize - 0.5) ;
-        vl_index v = floor((double)y / regionSize - 0.5) ;
-        vl_index up, vp ;
-        float minDistance = VL_INFINITY_F ;
-
-        for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
-          for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
-            vl_index region = up  + vp * numRegionsX ;
-            float centerx = centers[(2 + numChannels) * region + 0]  ;
-            float centery = centers[(2 + numChannels) * region + 1] ;
-            float spatial = (x - centerx) * (x - centerx) + (y - centery) * (y - centery) ;
-            float appearance = 0 ;
-            float distance ;
-            for (k = 0 ; k < (signed)numChannels ; ++k) {
-              float centerz = centers[(2 + numChannels) * region + k + 2]  ;
-              float z = atimage(x,y,k) ;
-              appearance += (z - centerz) * (z - centerz) ;
-            }
-            distance = appearance + factor * spatial ;
-            if (minDistance > distance) {
-              minDistance = distance ;
-              segmentation[x + y * width] = (vl_uint32)region ;
-            }
-          }
-        }
-        energy += minDistance ;
-      }
+    loop.factor = factor ;
+    vl_parallel_for (height, 0, _vl_slic_assign_range, &loop) ;
+
+    /* sum the energy in pixel order */
+    for (i = 0 ; i < (signed)numPixels ; ++i) {
+      energy += distances[i] ;
     }
 
     /*
@@ -306,33 +579,10 @@ vl_slic_segment (vl_uint32 * segmentation,
     previousEnergy = energy ;
 
     /* recompute centers */
-    memset(masses, 0, sizeof(vl_uint32) * width * height) ;
-    memset(centers, 0, sizeof(float) * (2 + numChannels) * numRegions) ;
-
-    for (y = 0 ; y < (signed)height ; ++y) {
-      for (x = 0 ; x < (signed)width ; ++x) {
-        vl_index pixel = x + y * width ;
-        vl_index region = segmentation[pixel] ;
-        masses[region] ++ ;
-        centers[region * (2 + numChannels) + 0] += x ;
-        centers[region * (2 + numChannels) + 1] += y ;
-        for (k = 0 ; k < (signed)numChannels ; ++k) {
-          centers[region * (2 + numChannels) + k + 2] += atimage(x,y,k) ;
-        }
-      }
-    }
-
-    for (region = 0 ; region < (signed)numRegions ; ++region) {
-      float mass = VL_MAX(masses[region], 1e-8) ;
-      for (i = (2 + numChannels) * region ;
-           i < (signed)(2 + numChannels) * (region + 1) ;
-           ++i) {
-        centers[i] /= mass ;
-      }
-    }
+    vl_parallel_for (numRegions, 0, _vl_slic_update_centers_range, &loop) ;
   }
 
-  vl_free(masses) ;
+  vl_free(distances) ;
   vl_free(centers) ;
   vl_free(edgeMap) ;
 
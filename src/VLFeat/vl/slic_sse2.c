@@ -0,0 +1,97 @@
+/** @file slic_sse2.c
+ ** @brief SLIC superpixels - SSE2 - Definition
+ **/
+
+/*
+ Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+ All rights reserved.
+
+ This file is part of the VLFeat library and is made available under
+ the terms of the BSD license (see the COPYING file).
+*/
+
+#if ! defined(VL_DISABLE_SSE2) & ! defined(__SSE2__)
+#error "Compiling with SSE2 enabled, but no __SSE2__ defined"
+#endif
+
+#if ! defined(VL_DISABLE_SSE2)
+
+#include <emmintrin.h>
+
+#include "slic.h"
+#include "mathop.h"
+#include "slic_sse2.h"
+
+/* ---------------------------------------------------------------- */
+/*
+ * Same computation as _vl_slic_assign_pixels in slic.c, processing
+ * four pixels of a row at a time. The pixels must share the same
+ * candidate regions. Each lane performs the same floating point
+ * operations in the same order as the scalar code, so the results
+ * are identical. The function processes the largest multiple of four
+ * pixels not greater than numPixels and returns their number; the
+ * caller completes the run.
+ */
+
+vl_size
+_vl_slic_assign_sse2 (vl_uint32 * segmentation,
+                      float * distances,
+                      float const * image,
+                      vl_size channelStride,
+                      vl_size numChannels,
+                      vl_size numPixels,
+                      vl_index x, vl_index y,
+                      float const * centers,
+                      vl_uint32 const * regions,
+                      vl_size numRegions,
+                      float factor)
+{
+  vl_size const centerSize = 2 + numChannels ;
+  __m128 const zero = _mm_setzero_ps() ;
+  __m128 const infinity = _mm_set1_ps(VL_INFINITY_F) ;
+  __m128 const factor_ = _mm_set1_ps(factor) ;
+  __m128 const y_ = _mm_set1_ps((float)y) ;
+  vl_uindex i, r, k ;
+
+  for (i = 0 ; i + 4 <= numPixels ; i += 4) {
+    __m128 x_ = _mm_cvtepi32_ps(_mm_setr_epi32((int)(x + i),
+                                               (int)(x + i + 1),
+                                               (int)(x + i + 2),
+                                               (int)(x + i + 3))) ;
+    __m128 minDistance = infinity ;
+    __m128i label = _mm_loadu_si128((__m128i const*)(segmentation + i)) ;
+
+    for (r = 0 ; r < numRegions ; ++r) {
+      float const * center = centers + centerSize * regions[r] ;
+      __m128 dx = _mm_sub_ps(x_, _mm_set1_ps(center[0])) ;
+      __m128 dy = _mm_sub_ps(y_, _mm_set1_ps(center[1])) ;
+      __m128 spatial = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)) ;
+      __m128 appearance = zero ;
+      __m128 distance ;
+      __m128 mask ;
+      __m128i maski ;
+
+      for (k = 0 ; k < numChannels ; ++k) {
+        __m128 z = _mm_loadu_ps(image + k * channelStride + i) ;
+        __m128 d = _mm_sub_ps(z, _mm_set1_ps(center[2 + k])) ;
+        appearance = _mm_add_ps(appearance, _mm_mul_ps(d, d)) ;
+      }
+      distance = _mm_add_ps(appearance, _mm_mul_ps(factor_, spatial)) ;
+
+      /* keep the first region attaining the minimum */
+      mask = _mm_cmpgt_ps(minDistance, distance) ;
+      maski = _mm_castps_si128(mask) ;
+      minDistance = _mm_or_ps(_mm_and_ps(mask, distance),
+                              _mm_andnot_ps(mask, minDistance)) ;
+      label = _mm_or_si128(_mm_and_si128(maski, _mm_set1_epi32((int)regions[r])),
+                           _mm_andnot_si128(maski, label)) ;
+    }
+
+    _mm_storeu_si128((__m128i*)(segmentation + i), label) ;
+    _mm_storeu_ps(distances + i, minDistance) ;
+  }
+  return i ;
+}
+
+/* ! VL_DISABLE_SSE2 */
+#endif
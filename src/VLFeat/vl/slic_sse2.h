@@ -0,0 +1,36 @@
+/** @file slic_sse2.h
+ ** @brief SLIC superpixels - SSE2
+ **/
+
+/*
+ Copyright (C) 2007-12 Andrea Vedaldi and Brian Fulkerson.
+ All rights reserved.
+
+ This file is part of the VLFeat library and is made available under
+ the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_SLIC_SSE2_H
+#define VL_SLIC_SSE2_H
+
+#include "generic.h"
+
+#ifndef VL_DISABLE_SSE2
+
+VL_EXPORT
+vl_size _vl_slic_assign_sse2 (vl_uint32 * segmentation,
+                              float * distances,
+                              float const * image,
+                              vl_size channelStride,
+                              vl_size numChannels,
+                              vl_size numPixels,
+                              vl_index x, vl_index y,
+                              float const * centers,
+                              vl_uint32 const * regions,
+                              vl_size numRegions,
+                              float factor) ;
+
+#endif
+
+/* VL_SLIC_SSE2_H */
+#endif
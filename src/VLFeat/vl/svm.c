@@ -203,6 +203,31 @@ with linear SVMs (see @ref svm-feature-maps to go beyond linear):
 
 Using these solvers is exemplified in @ref svm-starting.
 
+<!-- ------------------------------------------------------------- -->
+@section svm-parallel Parallel training
+<!-- ------------------------------------------------------------- -->
+
+Both solvers can process the data in *mini-batches*
+(::vl_svm_set_batch_size). The inner products and dual updates of the
+samples in a mini-batch are computed in parallel with the model at the
+beginning of the mini-batch, and the model updates are then summed in
+a fixed order. Therefore the result does not depend on the number of
+threads (::vl_set_num_threads). A mini-batch size of 1 (the default)
+corresponds to the standard sequential solvers.
+
+In SDCA, the dual coordinates of a mini-batch of $b$ samples are
+updated jointly, which is done safely by scaling the curvature
+$\|\bx_q\|^2$ of each coordinate by $b$. In SGD, the gradients of a
+mini-batch are evaluated at the same model, but the learning rates
+follow the usual sequential schedule. Larger mini-batches expose more
+parallelism, but may require more iterations to converge; sizes of a
+few hundred samples are a good compromise for large datasets.
+
+When many SVMs are learned on the same data, as for one-vs-rest
+multi-class classification, it is often better to train them
+concurrently with ::vl_svm_train_many. The SVMs can share the same
+::VlSvmDataset, whose functions are safe to call from several threads.
+
 <!-- ------------------------------------------------------------- -->
 @section svm-bias Adding a bias
 <!-- ------------------------------------------------------------- -->
@@ -890,8 +915,13 @@ or the memory is limited.
 
 #include "svm.h"
 #include "mathop.h"
+#include "random.h"
+#include <stdlib.h>
 #include <string.h>
 
+/** @internal @brief Maximum number of partial sums of a mini-batch update */
+#define VL_SVM_MAX_NUM_CHUNKS 16
+
 struct VlSvm_ {
   VlSvmSolverType solver ;      /**< SVM solver type. */
 
@@ -923,6 +953,8 @@ struct VlSvm_ {
   vl_size iteration ;           /**< Current iterations number. */
   vl_size maxNumIterations ;    /**< Maximum number of iterations. */
   double epsilon ;              /**< Stopping threshold. */
+  vl_size batchSize ;           /**< Mini-batch size. */
+  VlRand * rand ;               /**< Random generator (NULL for the global one). */
 
   /* Book keeping */
   VlSvmStatistics statistics ;  /**< Statistcs. */
@@ -1051,6 +1083,8 @@ vl_svm_new_with_abstract_data (VlSvmSolverType solver,
   self->iteration = 0 ;
   self->maxNumIterations = VL_MAX((double)numData, vl_ceil_f(10.0 / lambda)) ;
   self->epsilon = 1e-2 ;
+  self->batchSize = 1 ;
+  self->rand = NULL ;
 
   /* SGD */
   self->biasLearningRate = 0.01 ;
@@ -1104,6 +1138,10 @@ vl_svm_delete (VlSvm * self)
     vl_free (self->alpha) ;
     self->alpha = 0 ;
   }
+  if (self->scores) {
+    vl_free (self->scores) ;
+    self->scores = 0 ;
+  }
   if (self->ownDataset) {
     vl_svmdataset_delete(self->ownDataset) ;
     self->ownDataset = 0 ;
@@ -1237,6 +1275,34 @@ vl_size vl_svm_get_max_num_iterations (VlSvm const *self)
   return self->maxNumIterations ;
 }
 
+/** @brief Set the mini-batch size.
+ ** @param self object.
+ ** @param b mini-batch size (@c >= 1).
+ **
+ ** The solvers process the data in mini-batches of @a b samples,
+ ** computing the updates of a mini-batch in parallel (@ref
+ ** svm-parallel). The default value of 1 corresponds to the standard
+ ** sequential solvers.
+ **/
+
+void vl_svm_set_batch_size (VlSvm *self, vl_size b)
+{
+  assert(self) ;
+  assert(b > 0) ;
+  self->batchSize = b ;
+}
+
+/** @brief Get the mini-batch size.
+ ** @param self object.
+ ** @return mini-batch size.
+ **/
+
+vl_size vl_svm_get_batch_size (VlSvm const *self)
+{
+  assert(self) ;
+  return self->batchSize ;
+}
+
 /** @brief Set the diagnostic frequency.
  ** @param self object.
  ** @param f diagnostic frequency (@c >= 1).
@@ -1864,13 +1930,35 @@ vl_svm_logistic_dca_update (double alpha, double inner, double norm2, double lab
 
 /* ---------------------------------------------------------------- */
 
+/** @internal @brief Compute the scores of a range of data
+ ** @param self_ object.
+ ** @param task task index.
+ ** @param begin first datum.
+ ** @param end last datum plus one.
+ **/
+
+static void
+_vl_svm_scores_range (void * self_, vl_uindex task VL_UNUSED,
+                      vl_uindex begin, vl_uindex end)
+{
+  VlSvm * self = self_ ;
+  vl_uindex k ;
+  for (k = begin ; k < end ; ++k) {
+    double p = (self->weights) ? self->weights[k] : 1.0 ;
+    if (p <= 0) continue ;
+    self->scores[k] = self->innerProductFn(self->data, k, self->model)
+      + self->bias * self->biasMultiplier ;
+  }
+}
+
 /** @internal @brief Update SVM statistics
  ** @param self object.
  **/
 
 void _vl_svm_update_statistics (VlSvm *self)
 {
-  vl_size i, k ;
+  vl_size i ;
+  vl_index k ;
   double inner, p ;
 
   memset(&self->statistics, 0, sizeof(VlSvmStatistics)) ;
@@ -1881,12 +1969,13 @@ void _vl_svm_update_statistics (VlSvm *self)
   }
   self->statistics.regularizer *= self->lambda * 0.5 ;
 
-  for (k = 0; k < self->numData ; k++) {
+  /* the scores are computed in parallel, the losses summed in order */
+  vl_parallel_for (self->numData, 0, _vl_svm_scores_range, self) ;
+
+  for (k = 0; k < (signed)self->numData ; k++) {
     p = (self->weights) ? self->weights[k] : 1.0 ;
     if (p <= 0) continue ;
-    inner = self->innerProductFn(self->data, k, self->model) ;
-    inner += self->bias * self->biasMultiplier ;
-    self->scores[k] = inner ;
+    inner = self->scores[k] ;
     self->statistics.loss += p * self->lossFn(inner, self->labels[k]) ;
     if (self->solver == VlSvmSolverSdca) {
 
@@ -1924,38 +2013,322 @@ void _vl_svm_evaluate (VlSvm *self)
   }
 }
 
+/* ---------------------------------------------------------------- */
+/*                                                      Mini-batches */
+/* ---------------------------------------------------------------- */
+
+/** @internal @brief Get the end of a mini-batch
+ ** @param self object.
+ ** @param t first iteration of the mini-batch.
+ ** @return iteration following the mini-batch.
+ **
+ ** A mini-batch does not extend beyond the end of an epoch, the next
+ ** diagnostic round, or the maximum number of iterations.
+ **/
+
+static vl_uindex
+_vl_svm_get_batch_end (VlSvm const *self, vl_uindex t)
+{
+  vl_uindex tEnd = t + self->batchSize ;
+  tEnd = VL_MIN(tEnd, (t / self->numData + 1) * self->numData) ;
+  tEnd = VL_MIN(tEnd, (t / self->diagnosticFrequency + 1) * self->diagnosticFrequency) ;
+  if (t < self->maxNumIterations) {
+    tEnd = VL_MIN(tEnd, self->maxNumIterations) ;
+  }
+  return tEnd ;
+}
+
+/** @internal @brief Data of the mini-batch parallel loops */
+typedef struct _VlSvmBatchLoop
+{
+  VlSvm * self ;                /**< SVM. */
+  vl_index const * batch ;      /**< indexes of the samples in the mini-batch. */
+  vl_size numSamples ;          /**< number of samples in the mini-batch. */
+  double * values ;             /**< inner products (SGD) or dual updates (SDCA) (out). */
+  double const * norm2 ;        /**< scaled squared norms of the data (SDCA). */
+  double const * multipliers ;  /**< update multipliers. */
+  double * buffers ;            /**< partial sums of the chunks. */
+  vl_size numChunks ;           /**< number of chunks. */
+} VlSvmBatchLoop ;
+
+/** @internal @brief Accumulate a range of chunks of a mini-batch
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first chunk.
+ ** @param end last chunk plus one.
+ **/
+
+static void
+_vl_svm_accumulate_chunks_range (void * loop_, vl_uindex task VL_UNUSED,
+                                 vl_uindex begin, vl_uindex end)
+{
+  VlSvmBatchLoop * loop = loop_ ;
+  VlSvm * self = loop->self ;
+  vl_uindex c, j ;
+  for (c = begin ; c < end ; ++c) {
+    double * buffer = loop->buffers + c * self->dimension ;
+    memset(buffer, 0, sizeof(double) * self->dimension) ;
+    for (j = (c * loop->numSamples) / loop->numChunks ;
+         j < ((c + 1) * loop->numSamples) / loop->numChunks ; ++j) {
+      if (loop->multipliers[j] != 0) {
+        self->accumulateFn(self->data, loop->batch[j], buffer, loop->multipliers[j]) ;
+      }
+    }
+  }
+}
+
+/** @internal @brief Add the chunks of a mini-batch to a range of model components
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first component.
+ ** @param end last component plus one.
+ **/
+
+static void
+_vl_svm_sum_chunks_range (void * loop_, vl_uindex task VL_UNUSED,
+                          vl_uindex begin, vl_uindex end)
+{
+  VlSvmBatchLoop * loop = loop_ ;
+  VlSvm * self = loop->self ;
+  vl_uindex k, c ;
+  for (k = begin ; k < end ; ++k) {
+    for (c = 0 ; c < loop->numChunks ; ++c) {
+      self->model[k] += loop->buffers[c * self->dimension + k] ;
+    }
+  }
+}
+
+/** @internal @brief Accumulate the updates of a mini-batch
+ ** @param self object.
+ ** @param buffers space for the partial sums.
+ ** @param batch indexes of the samples in the mini-batch.
+ ** @param multipliers update multipliers.
+ ** @param numSamples number of samples in the mini-batch.
+ **
+ ** The mini-batch is split into a fixed number of chunks, which are
+ ** accumulated in parallel in @a buffers and then added to the model
+ ** in order. Hence the result does not depend on the number of
+ ** threads. A single sample is accumulated directly to the model.
+ **/
+
+static void
+_vl_svm_accumulate_batch (VlSvm *self,
+                          double * buffers,
+                          vl_index const * batch,
+                          double const * multipliers,
+                          vl_size numSamples)
+{
+  vl_size numChunks = VL_MIN(numSamples, VL_SVM_MAX_NUM_CHUNKS) ;
+  VlSvmBatchLoop loop ;
+
+  if (numChunks == 1) {
+    if (multipliers[0] != 0) {
+      self->accumulateFn(self->data, batch[0], self->model, multipliers[0]) ;
+    }
+    return ;
+  }
+
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.self = self ;
+  loop.batch = batch ;
+  loop.numSamples = numSamples ;
+  loop.multipliers = multipliers ;
+  loop.buffers = buffers ;
+  loop.numChunks = numChunks ;
+  vl_parallel_for (numChunks, 0, _vl_svm_accumulate_chunks_range, &loop) ;
+  vl_parallel_for (self->dimension, 0, _vl_svm_sum_chunks_range, &loop) ;
+}
+
+/* ---------------------------------------------------------------- */
+/*                                                        Workspace */
+/* ---------------------------------------------------------------- */
+
+/** @internal @brief Working memory of a solver
+ **
+ ** The memory is allocated by ::_vl_svm_workspace_init before
+ ** training, in the calling thread, so that ::vl_svm_train_many does
+ ** not call ::vl_malloc from its worker threads.
+ **/
+
+typedef struct _VlSvmWorkspace
+{
+  vl_index * permutation ; /**< order in which the data is visited. */
+  double * dataBuffer ;    /**< norms (SDCA) or current and previous scores (SGD). */
+  double * batchBuffer ;   /**< updates of a mini-batch. */
+  double * buffers ;       /**< partial sums of a mini-batch (or NULL). */
+} VlSvmWorkspace ;
+
+/** @internal @brief Release the working memory of a solver
+ ** @param ws workspace.
+ **/
+
+static void
+_vl_svm_workspace_free (VlSvmWorkspace * ws)
+{
+  if (ws->permutation) vl_free (ws->permutation) ;
+  if (ws->dataBuffer) vl_free (ws->dataBuffer) ;
+  if (ws->batchBuffer) vl_free (ws->batchBuffer) ;
+  if (ws->buffers) vl_free (ws->buffers) ;
+  memset(ws, 0, sizeof(VlSvmWorkspace)) ;
+}
+
+/** @internal @brief Allocate the working memory of a solver
+ ** @param self object.
+ ** @param ws workspace.
+ ** @return error code.
+ **
+ ** The function sets the last error and returns ::VL_ERR_ALLOC if
+ ** it runs out of memory.
+ **/
+
+static int
+_vl_svm_workspace_init (VlSvm const * self, VlSvmWorkspace * ws)
+{
+  memset(ws, 0, sizeof(VlSvmWorkspace)) ;
+  if (self->solver == VlSvmSolverNone) return VL_ERR_OK ;
+
+  ws->permutation = vl_calloc(self->numData, sizeof(vl_index)) ;
+  ws->dataBuffer = vl_calloc((self->solver == VlSvmSolverSgd ? 2 : 1) * self->numData,
+                             sizeof(double)) ;
+  ws->batchBuffer = vl_calloc(2 * self->batchSize, sizeof(double)) ;
+  if (self->batchSize > 1) {
+    ws->buffers = vl_malloc(sizeof(double) * self->dimension *
+                            VL_MIN(self->batchSize, VL_SVM_MAX_NUM_CHUNKS)) ;
+  }
+  if (ws->permutation == NULL || ws->dataBuffer == NULL || ws->batchBuffer == NULL ||
+      (self->batchSize > 1 && ws->buffers == NULL)) {
+    _vl_svm_workspace_free (ws) ;
+    return vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the SVM solver buffers.") ;
+  }
+  return VL_ERR_OK ;
+}
+
 /* ---------------------------------------------------------------- */
 /*                         Stochastic Dual Coordinate Ascent Solver */
 /* ---------------------------------------------------------------- */
 
-void _vl_svm_sdca_train (VlSvm *self)
+/** @internal @brief Data of the SDCA loop computing the data norms */
+typedef struct _VlSdcaNormLoop
 {
-  double * norm2 ;
-  vl_index * permutation ;
-  vl_uindex i, t  ;
-  double inner, delta, multiplier, p ;
+  VlSvm * self ;   /**< SVM. */
+  double * norm2 ; /**< scaled squared norms of the data (out). */
+  int * errors ;   /**< one error code for each task (out). */
+} VlSdcaNormLoop ;
+
+/** @internal @brief Compute the squared norms of a range of data
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first datum.
+ ** @param end last datum plus one.
+ **
+ ** The data are expanded in a buffer allocated with @c malloc.
+ **/
 
-  double startTime = vl_get_cpu_time () ;
-  VlRand * rand = vl_get_rand() ;
-
-  norm2 = (double*) vl_calloc(self->numData, sizeof(double));
-  permutation = vl_calloc(self->numData, sizeof(vl_index)) ;
-
-  {
-    double * buffer = vl_calloc(self->dimension, sizeof(double)) ;
-    for (i = 0 ; i < (unsigned)self->numData; i++) {
-      double n2 ;
-      permutation [i] = i ;
-      memset(buffer, 0, self->dimension * sizeof(double)) ;
-      self->accumulateFn (self->data, i, buffer, 1) ;
-      n2 = self->innerProductFn (self->data, i, buffer) ;
-      n2 += self->biasMultiplier * self->biasMultiplier ;
-      norm2[i] = n2 / (self->lambda * self->numData) ;
+static void
+_vl_svm_sdca_norms_range (void * loop_, vl_uindex task,
+                          vl_uindex begin, vl_uindex end)
+{
+  VlSdcaNormLoop * loop = loop_ ;
+  VlSvm * self = loop->self ;
+  double * buffer = malloc(sizeof(double) * self->dimension) ;
+  vl_uindex q ;
+  if (buffer == NULL) {
+    loop->errors[task] = VL_ERR_ALLOC ;
+    return ;
+  }
+  for (q = begin ; q < end ; ++q) {
+    double n2 ;
+    memset(buffer, 0, self->dimension * sizeof(double)) ;
+    self->accumulateFn (self->data, q, buffer, 1) ;
+    n2 = self->innerProductFn (self->data, q, buffer) ;
+    n2 += self->biasMultiplier * self->biasMultiplier ;
+    loop->norm2[q] = n2 / (self->lambda * self->numData) ;
+  }
+  free(buffer) ;
+}
+
+/** @internal @brief Compute the dual updates of a range of a mini-batch
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first sample.
+ ** @param end last sample plus one.
+ **
+ ** Since the updates are applied together, the curvature of each
+ ** coordinate is scaled by the mini-batch size.
+ **/
+
+static void
+_vl_svm_sdca_updates_range (void * loop_, vl_uindex task VL_UNUSED,
+                            vl_uindex begin, vl_uindex end)
+{
+  VlSvmBatchLoop * loop = loop_ ;
+  VlSvm * self = loop->self ;
+  vl_uindex q ;
+  for (q = begin ; q < end ; ++q) {
+    vl_index k = loop->batch[q] ;
+    double p = (self->weights) ? self->weights[k] : 1.0 ;
+    double inner ;
+    if (p > 0) {
+      inner = self->innerProductFn(self->data, k, self->model) ;
+      inner += self->bias * self->biasMultiplier ;
+      loop->values[q] = p * self->dcaUpdateFn(self->alpha[k] / p, inner,
+                                              loop->numSamples * p * loop->norm2[k],
+                                              self->labels[k]) ;
+    } else {
+      loop->values[q] = 0 ;
     }
-    vl_free(buffer) ;
   }
+}
 
-  for (t = 0 ; 1 ; ++t) {
+/** @internal @brief Run the SDCA solver
+ ** @param self object.
+ ** @param ws workspace (see ::_vl_svm_workspace_init).
+ ** @return error code.
+ **
+ ** The function only allocates memory with @c malloc and does not
+ ** set the last error, so that it can run in a worker thread. It
+ ** returns ::VL_ERR_ALLOC if it runs out of memory.
+ **/
+
+static int
+_vl_svm_sdca_train (VlSvm *self, VlSvmWorkspace * ws)
+{
+  double * norm2 = ws->dataBuffer ;
+  double * deltas = ws->batchBuffer ;
+  double * multipliers = deltas + self->batchSize ;
+  double * buffers = ws->buffers ;
+  vl_index * permutation = ws->permutation ;
+  vl_index const * batch ;
+  vl_uindex i, j, t, tEnd ;
+  vl_size numSamples ;
+  vl_size numTasks = VL_MIN(vl_get_max_threads(), VL_MAX(self->numData, 1)) ;
+  VlSdcaNormLoop normLoop ;
+  VlSvmBatchLoop loop ;
+
+  double startTime = vl_get_cpu_time () ;
+  VlRand * rand = self->rand ? self->rand : vl_get_rand() ;
+
+  for (i = 0 ; i < (unsigned)self->numData; i++) {
+    permutation [i] = i ;
+  }
+
+  normLoop.self = self ;
+  normLoop.norm2 = norm2 ;
+  normLoop.errors = calloc(numTasks, sizeof(int)) ;
+  if (normLoop.errors == NULL) return VL_ERR_ALLOC ;
+  vl_parallel_for (self->numData, numTasks, _vl_svm_sdca_norms_range, &normLoop) ;
+  for (i = 0 ; i < numTasks ; ++i) {
+    if (normLoop.errors[i]) break ;
+  }
+  free(normLoop.errors) ;
+  if (i < numTasks) return VL_ERR_ALLOC ;
+
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.self = self ;
+  loop.values = deltas ;
+  loop.norm2 = norm2 ;
+
+  for (t = 0 ; 1 ; t = tEnd) {
 
     if (t % self->numData == 0) {
       /* once a new epoch is reached (all data have been visited),
@@ -1963,37 +2336,44 @@ void _vl_svm_sdca_train (VlSvm *self)
       vl_rand_permute_indexes(rand, permutation, self->numData) ;
     }
 
-    /* pick a sample and compute update */
-    i = permutation[t % self->numData] ;
-    p = (self->weights) ? self->weights[i] : 1.0 ;
-    if (p > 0) {
-      inner = self->innerProductFn(self->data, i, self->model) ;
-      inner += self->bias * self->biasMultiplier ;
-      delta = p * self->dcaUpdateFn(self->alpha[i] / p, inner, p * norm2[i], self->labels[i]) ;
-    } else {
-      delta = 0 ;
-    }
+    /* pick a mini-batch of samples */
+    tEnd = _vl_svm_get_batch_end (self, t) ;
+    numSamples = tEnd - t ;
+    batch = permutation + t % self->numData ;
+
+    /*
+     Compute the updates of the mini-batch in parallel. Since they are
+     applied together, the curvature of each coordinate is scaled by
+     the mini-batch size, which guarantees that the dual objective
+     does not decrease. For one sample this is the standard update.
+     */
+    loop.batch = batch ;
+    loop.numSamples = numSamples ;
+    vl_parallel_for (numSamples, 0, _vl_svm_sdca_updates_range, &loop) ;
 
     /* apply update */
-    if (delta != 0) {
-      self->alpha[i] += delta ;
-      multiplier = delta / (self->numData * self->lambda) ;
-      self->accumulateFn(self->data,i,self->model,multiplier) ;
-      self->bias += self->biasMultiplier * multiplier;
+    for (j = 0 ; j < numSamples ; ++j) {
+      multipliers[j] = 0 ;
+      if (deltas[j] != 0) {
+        self->alpha[batch[j]] += deltas[j] ;
+        multipliers[j] = deltas[j] / (self->numData * self->lambda) ;
+        self->bias += self->biasMultiplier * multipliers[j] ;
+      }
     }
+    _vl_svm_accumulate_batch (self, buffers, batch, multipliers, numSamples) ;
 
     /* call diagnostic occasionally */
-    if ((t + 1) % self->diagnosticFrequency == 0 || t + 1 == self->maxNumIterations) {
+    if (tEnd % self->diagnosticFrequency == 0 || tEnd == self->maxNumIterations) {
       _vl_svm_update_statistics (self) ;
       self->statistics.elapsedTime = vl_get_cpu_time() - startTime ;
-      self->statistics.iteration = t ;
-      self->statistics.epoch = t / self->numData ;
+      self->statistics.iteration = tEnd - 1 ;
+      self->statistics.epoch = (tEnd - 1) / self->numData ;
 
       self->statistics.status = VlSvmStatusTraining ;
       if (self->statistics.dualityGap < self->epsilon) {
         self->statistics.status = VlSvmStatusConverged ;
       }
-      else if (t + 1 == self->maxNumIterations) {
+      else if (tEnd == self->maxNumIterations) {
         self->statistics.status = VlSvmStatusMaxNumIterationsReached ;
       }
 
@@ -2005,40 +2385,73 @@ void _vl_svm_sdca_train (VlSvm *self)
         break ;
       }
     }
-  } /* next iteration */
+  } /* next mini-batch */
 
-  vl_free (norm2) ;
-  vl_free (permutation) ;
+  return VL_ERR_OK ;
 }
 
 /* ---------------------------------------------------------------- */
 /*                               Stochastic Gradient Descent Solver */
 /* ---------------------------------------------------------------- */
 
-void _vl_svm_sgd_train (VlSvm *self)
+/** @internal @brief Compute the inner products of a range of a mini-batch
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first sample.
+ ** @param end last sample plus one.
+ **/
+
+static void
+_vl_svm_sgd_inners_range (void * loop_, vl_uindex task VL_UNUSED,
+                          vl_uindex begin, vl_uindex end)
 {
-  vl_index * permutation ;
-  double * scores ;
-  double * previousScores ;
-  vl_uindex i, t, k ;
-  double inner, gradient, rate, biasRate, p ;
+  VlSvmBatchLoop * loop = loop_ ;
+  VlSvm * self = loop->self ;
+  vl_uindex q ;
+  for (q = begin ; q < end ; ++q) {
+    loop->values[q] = self->innerProductFn(self->data, loop->batch[q], self->model) ;
+  }
+}
+
+/** @internal @brief Run the SGD solver
+ ** @param self object.
+ ** @param ws workspace (see ::_vl_svm_workspace_init).
+ **
+ ** The function does not allocate memory, so that it can run in a
+ ** worker thread.
+ **/
+
+static void
+_vl_svm_sgd_train (VlSvm *self, VlSvmWorkspace * ws)
+{
+  vl_index * permutation = ws->permutation ;
+  vl_index const * batch ;
+  double * scores = ws->dataBuffer ;
+  double * previousScores = scores + self->numData ;
+  double * inners = ws->batchBuffer ;
+  double * multipliers = inners + self->batchSize ;
+  double * buffers = ws->buffers ;
+  vl_uindex i, j, t, tEnd, k ;
+  vl_size numSamples ;
+  VlSvmBatchLoop loop ;
+  double inner, gradient, rate, biasRate, p, batchFactor, batchBias ;
   double factor = 1.0 ;
   double biasFactor = 1.0 ; /* to allow slower bias learning rate */
   vl_index t0 = VL_MAX(2, vl_ceil_d(1.0 / self->lambda)) ;
   //t0=2 ;
 
   double startTime = vl_get_cpu_time () ;
-  VlRand * rand = vl_get_rand() ;
-
-  permutation = vl_calloc(self->numData, sizeof(vl_index)) ;
-  scores = vl_calloc(self->numData * 2, sizeof(double)) ;
-  previousScores = scores + self->numData ;
+  VlRand * rand = self->rand ? self->rand : vl_get_rand() ;
 
   for (i = 0 ; i < (unsigned)self->numData; i++) {
     permutation [i] = i ;
     previousScores [i] = - VL_INFINITY_D ;
   }
 
+  memset(&loop, 0, sizeof(loop)) ;
+  loop.self = self ;
+  loop.values = inners ;
+
   /*
    We store the w vector as the product fw (factor * model).
    We also use a different factor for the bias: biasFactor * biasMultiplier
@@ -2059,9 +2472,14 @@ void _vl_svm_sgd_train (VlSvm *self)
    * Realization of the scaling factor. Before the statistics function
      is called, or training finishes, the factor (and biasFactor)
      are explicitly applied to the model and the bias.
+
+   * Mini-batches. The inner products of a mini-batch are computed in
+     parallel with the model at the beginning of the mini-batch. Then
+     the steps are taken in sequence, with the usual learning rates,
+     and the model updates accumulated at the end of the mini-batch.
   */
 
-  for (t = 0 ; 1 ; ++t) {
+  for (t = 0 ; 1 ; t = tEnd) {
 
     if (t % self->numData == 0) {
       /* once a new epoch is reached (all data have been visited),
@@ -2069,37 +2487,45 @@ void _vl_svm_sgd_train (VlSvm *self)
       vl_rand_permute_indexes(rand, permutation, self->numData) ;
     }
 
-    /* pick a sample and compute update */
-    i = permutation[t % self->numData] ;
-    p = (self->weights) ? self->weights[i] : 1.0 ;
-    p = VL_MAX(0.0, p) ; /* we assume non-negative weights, so this is just for robustness */
-    inner = factor * self->innerProductFn(self->data, i, self->model) ;
-    inner += biasFactor * (self->biasMultiplier * self->bias) ;
-    gradient = p * self->lossDerivativeFn(inner, self->labels[i]) ;
-    previousScores[i] = scores[i] ;
-    scores[i] = inner ;
-
-    /* apply update */
-    rate = 1.0 /  (self->lambda * (t + t0)) ;
-    biasRate = rate * self->biasLearningRate ;
-    factor *= (1.0 - self->lambda * rate) ;
-    biasFactor *= (1.0 - self->lambda * biasRate) ;
-
-    /* debug: realize the scaling factor all the times */
-    /*
-    for (k = 0 ; k < self->dimension ; ++k) self->model[k] *= factor ;
-    self->bias *= biasFactor;
-    factor = 1.0 ;
-    biasFactor = 1.0 ;
-    */
-
-    if (gradient != 0) {
-      self->accumulateFn(self->data, i, self->model, - gradient * rate / factor) ;
-      self->bias += self->biasMultiplier * (- gradient * biasRate / biasFactor) ;
+    /* pick a mini-batch of samples */
+    tEnd = _vl_svm_get_batch_end (self, t) ;
+    numSamples = tEnd - t ;
+    batch = permutation + t % self->numData ;
+
+    loop.batch = batch ;
+    loop.numSamples = numSamples ;
+    vl_parallel_for (numSamples, 0, _vl_svm_sgd_inners_range, &loop) ;
+
+    batchFactor = factor ;
+    batchBias = biasFactor * (self->biasMultiplier * self->bias) ;
+
+    for (j = 0 ; j < numSamples ; ++j) {
+      /* compute update */
+      i = batch[j] ;
+      p = (self->weights) ? self->weights[i] : 1.0 ;
+      p = VL_MAX(0.0, p) ; /* we assume non-negative weights, so this is just for robustness */
+      inner = batchFactor * inners[j] ;
+      inner += batchBias ;
+      gradient = p * self->lossDerivativeFn(inner, self->labels[i]) ;
+      previousScores[i] = scores[i] ;
+      scores[i] = inner ;
+
+      /* apply update */
+      rate = 1.0 /  (self->lambda * (t + j + t0)) ;
+      biasRate = rate * self->biasLearningRate ;
+      factor *= (1.0 - self->lambda * rate) ;
+      biasFactor *= (1.0 - self->lambda * biasRate) ;
+
+      multipliers[j] = 0 ;
+      if (gradient != 0) {
+        multipliers[j] = - gradient * rate / factor ;
+        self->bias += self->biasMultiplier * (- gradient * biasRate / biasFactor) ;
+      }
     }
+    _vl_svm_accumulate_batch (self, buffers, batch, multipliers, numSamples) ;
 
     /* call diagnostic occasionally */
-    if ((t + 1) % self->diagnosticFrequency == 0 || t + 1 == self->maxNumIterations) {
+    if (tEnd % self->diagnosticFrequency == 0 || tEnd == self->maxNumIterations) {
 
       /* realize factor before computing statistics or completing training */
       for (k = 0 ; k < self->dimension ; ++k) self->model[k] *= factor ;
@@ -2116,14 +2542,14 @@ void _vl_svm_sgd_train (VlSvm *self)
       self->statistics.scoresVariation = sqrt(self->statistics.scoresVariation) / self->numData ;
 
       self->statistics.elapsedTime = vl_get_cpu_time() - startTime ;
-      self->statistics.iteration = t ;
-      self->statistics.epoch = t / self->numData ;
+      self->statistics.iteration = tEnd - 1 ;
+      self->statistics.epoch = (tEnd - 1) / self->numData ;
 
       self->statistics.status = VlSvmStatusTraining ;
       if (self->statistics.scoresVariation < self->epsilon) {
         self->statistics.status = VlSvmStatusConverged ;
       }
-      else if (t + 1 == self->maxNumIterations) {
+      else if (tEnd == self->maxNumIterations) {
         self->statistics.status = VlSvmStatusMaxNumIterationsReached ;
       }
 
@@ -2135,33 +2561,29 @@ void _vl_svm_sgd_train (VlSvm *self)
         break ;
       }
     }
-  } /* next iteration */
-
-  vl_free (scores) ;
-  vl_free (permutation) ;
+  } /* next mini-batch */
 }
 
 /* ---------------------------------------------------------------- */
 /*                                                       Dispatcher */
 /* ---------------------------------------------------------------- */
 
-/** @brief Run the SVM solver
+/** @internal @brief Run the SVM solver with preallocated memory
  ** @param self object.
+ ** @param ws workspace (see ::_vl_svm_workspace_init).
+ ** @return error code.
  **
- ** The data on which the SVM operates is passed upon the cration of
- ** the ::VlSvm object. This function runs a solver to learn a
- ** corresponding model. See @ref svm-starting.
+ ** As the solvers, the function does not set the last error.
  **/
 
-void vl_svm_train (VlSvm * self)
+static int
+_vl_svm_train (VlSvm * self, VlSvmWorkspace * ws)
 {
-  assert (self) ;
   switch (self->solver) {
     case VlSvmSolverSdca:
-      _vl_svm_sdca_train(self) ;
-      break ;
+      return _vl_svm_sdca_train(self, ws) ;
     case VlSvmSolverSgd:
-      _vl_svm_sgd_train(self) ;
+      _vl_svm_sgd_train(self, ws) ;
       break ;
     case VlSvmSolverNone:
       _vl_svm_evaluate(self) ;
@@ -2169,4 +2591,136 @@ void vl_svm_train (VlSvm * self)
     default:
       assert(0) ;
   }
+  return VL_ERR_OK ;
+}
+
+/** @brief Run the SVM solver
+ ** @param self object.
+ ** @return error code.
+ **
+ ** The data on which the SVM operates is passed upon the cration of
+ ** the ::VlSvm object. This function runs a solver to learn a
+ ** corresponding model. See @ref svm-starting.
+ **
+ ** The function returns ::VL_ERR_ALLOC (and sets the last error) if
+ ** it runs out of memory, and ::VL_ERR_OK otherwise.
+ **/
+
+int vl_svm_train (VlSvm * self)
+{
+  VlSvmWorkspace ws ;
+  int error ;
+  assert (self) ;
+  if (_vl_svm_workspace_init (self, &ws)) {
+    return VL_ERR_ALLOC ;
+  }
+  error = _vl_svm_train (self, &ws) ;
+  _vl_svm_workspace_free (&ws) ;
+  if (error) {
+    return vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the SVM solver buffers.") ;
+  }
+  return VL_ERR_OK ;
+}
+
+/** @internal @brief Data of the loop training several SVMs */
+typedef struct _VlSvmManyLoop
+{
+  VlSvm ** svms ;               /**< SVMs. */
+  VlRand * rands ;              /**< random generator of each SVM. */
+  VlSvmWorkspace * workspaces ; /**< workspace of each SVM. */
+  int * errors ;                /**< error code of each SVM (out). */
+} VlSvmManyLoop ;
+
+/** @internal @brief Train a range of SVMs
+ ** @param loop_ loop data.
+ ** @param task task index.
+ ** @param begin first SVM.
+ ** @param end last SVM plus one.
+ **/
+
+static void
+_vl_svm_train_range (void * loop_, vl_uindex task VL_UNUSED,
+                     vl_uindex begin, vl_uindex end)
+{
+  VlSvmManyLoop * loop = loop_ ;
+  vl_uindex s ;
+  for (s = begin ; s < end ; ++s) {
+    VlSvm * svm = loop->svms[s] ;
+    VlRand * rand = svm->rand ;
+    svm->rand = &loop->rands[s] ;
+    loop->errors[s] = _vl_svm_train (svm, &loop->workspaces[s]) ;
+    svm->rand = rand ;
+  }
+}
+
+/** @brief Run several SVM solvers in parallel
+ ** @param svms array of objects.
+ ** @param numSvms number of objects.
+ **
+ ** The function trains the @a numSvms SVMs concurrently, one per
+ ** thread, as ::vl_svm_train would do sequentially. This is useful to
+ ** learn, for example, one-vs-rest classifiers on the same dataset,
+ ** which can be shared by the objects. Each solver is given its own
+ ** random generator, seeded from the default one
+ ** (::vl_get_rand), so that the result does not depend on the
+ ** number of threads.
+ **
+ ** The working memory of all the solvers is allocated with
+ ** ::vl_malloc before the threads are started, and the solvers
+ ** themselves only use @c malloc, so that the function can be used
+ ** from MATLAB. The diagnostic functions are called from the worker
+ ** threads: they must be reentrant and, in MATLAB, must not allocate
+ ** memory with ::vl_malloc nor print with ::VL_PRINTF.
+ **
+ ** @return error code. If the function runs out of memory, it sets
+ ** the last error and returns ::VL_ERR_ALLOC; some of the SVMs may
+ ** have been trained.
+ **/
+
+int vl_svm_train_many (VlSvm ** svms, vl_size numSvms)
+{
+  VlRand * rands = vl_malloc(sizeof(VlRand) * numSvms) ;
+  VlSvmWorkspace * workspaces = vl_calloc(numSvms, sizeof(VlSvmWorkspace)) ;
+  int * errors = vl_calloc(numSvms, sizeof(int)) ;
+  vl_bool failed = VL_FALSE ;
+  VlSvmManyLoop loop ;
+  vl_index s ;
+
+  if (rands == NULL || workspaces == NULL || errors == NULL) {
+    failed = VL_TRUE ;
+    goto done ;
+  }
+
+  for (s = 0 ; s < (signed)numSvms ; ++s) {
+    vl_rand_init (&rands[s]) ;
+    vl_rand_seed (&rands[s], vl_rand_uint32(vl_get_rand())) ;
+    if (_vl_svm_workspace_init (svms[s], &workspaces[s])) {
+      failed = VL_TRUE ;
+      goto done ;
+    }
+  }
+
+  /* one task per SVM, as the solvers take different times */
+  loop.svms = svms ;
+  loop.rands = rands ;
+  loop.workspaces = workspaces ;
+  loop.errors = errors ;
+  vl_parallel_for (numSvms, numSvms, _vl_svm_train_range, &loop) ;
+  for (s = 0 ; s < (signed)numSvms ; ++s) {
+    if (errors[s]) failed = VL_TRUE ;
+  }
+
+done:
+  if (workspaces) {
+    for (s = 0 ; s < (signed)numSvms ; ++s) {
+      _vl_svm_workspace_free (&workspaces[s]) ;
+    }
+    vl_free (workspaces) ;
+  }
+  if (errors) vl_free (errors) ;
+  if (rands) vl_free (rands) ;
+  if (failed) {
+    return vl_set_last_error(VL_ERR_ALLOC, "Could not allocate the SVM solver buffers.") ;
+  }
+  return VL_ERR_OK ;
 }
@@ -121,6 +121,7 @@ VL_EXPORT vl_size vl_svm_get_num_data (VlSvm *self) ;
 VL_EXPORT double vl_svm_get_epsilon (VlSvm const *self) ;
 VL_EXPORT double vl_svm_get_bias_learning_rate (VlSvm const *self) ;
 VL_EXPORT vl_size vl_svm_get_max_num_iterations (VlSvm const *self) ;
+VL_EXPORT vl_size vl_svm_get_batch_size (VlSvm const *self) ;
 VL_EXPORT vl_size vl_svm_get_diagnostic_frequency (VlSvm const *self) ;
 VL_EXPORT VlSvmSolverType vl_svm_get_solver (VlSvm const *self) ;
 VL_EXPORT double vl_svm_get_bias_multiplier (VlSvm const *self) ;
@@ -135,6 +136,7 @@ VL_EXPORT double const * vl_svm_get_weights (VlSvm const *self) ;
 VL_EXPORT void vl_svm_set_epsilon (VlSvm *self, double epsilon) ;
 VL_EXPORT void vl_svm_set_bias_learning_rate (VlSvm *self, double rate) ;
 VL_EXPORT void vl_svm_set_max_num_iterations (VlSvm *self, vl_size maxNumIterations) ;
+VL_EXPORT void vl_svm_set_batch_size (VlSvm *self, vl_size b) ;
 VL_EXPORT void vl_svm_set_diagnostic_frequency (VlSvm *self, vl_size f) ;
 VL_EXPORT void vl_svm_set_bias_multiplier (VlSvm *self, double b) ;
 VL_EXPORT void vl_svm_set_model (VlSvm *self, double const *model) ;
@@ -153,7 +155,8 @@ VL_EXPORT void vl_svm_set_loss (VlSvm *self, VlSvmLossType loss) ;
 
 /** @name Process data
  ** @{ */
-VL_EXPORT void vl_svm_train (VlSvm * self) ;
+VL_EXPORT int vl_svm_train (VlSvm * self) ;
+VL_EXPORT int vl_svm_train_many (VlSvm ** svms, vl_size numSvms) ;
 /** @} */
 
 /** @name Loss functions
@@ -55,6 +55,13 @@ Presently, ::VlSvmDataset supports:
 - The on-the-fly application of the homogeneous kernel map to implement
   additive non-linear kernels (see @ref homkermap).
 
+The inner product and accumulate functions can be called concurrently
+from several threads, as required by the parallel solvers (@ref
+svm-parallel). For dense data, the inner product can use SSE2
+instructions (::vl_svmdataset_set_use_simd). This is off by default,
+as the vectorized sums are evaluated in a different order and
+therefore the learned models may differ in the last bits.
+
 For example, to learn a linear SVM on SINGLE data:
 
 @code
@@ -98,17 +105,25 @@ int main()
 /* ---------------------------------------------------------------- */
 
 #include "svmdataset.h"
+#include "svmdataset_sse2.h"
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+/** @internal @brief Size of the kernel map buffer
+ **
+ ** Kernel maps with more components are evaluated in blocks.
+ **/
+#define VL_SVMDATASET_HOM_BUFFER_SIZE 64
+
 struct VlSvmDataset_ {
   vl_type dataType ;                /**< Data type. */
   void * data ;                     /**< Pointer to data. */
   vl_size numData ;                 /**< Number of wrapped data. */
   vl_size dimension ;               /**< Data point dimension. */
   VlHomogeneousKernelMap * hom ;    /**< Homogeneous kernel map (optional). */
-  void * homBuffer ;                /**< Homogeneous kernel map buffer. */
   vl_size homDimension ;            /**< Homogeneous kernel map dimension. */
+  vl_bool useSimd ;                 /**< Use the SIMD inner product. */
 } ;
 
 /* templetized parts of the implementation */
@@ -149,7 +164,8 @@ vl_svmdataset_new (vl_type dataType, void *data, vl_size dimension, vl_size numD
   self->dimension = dimension ;
   self->numData = numData ;
   self->hom = NULL ;
-  self->homBuffer = NULL ;
+  self->homDimension = 0 ;
+  self->useSimd = VL_FALSE ;
   return self ;
 }
 
@@ -163,10 +179,6 @@ vl_svmdataset_new (vl_type dataType, void *data, vl_size dimension, vl_size numD
 
 void vl_svmdataset_delete (VlSvmDataset *self)
 {
-  if (self->homBuffer) {
-    vl_free(self->homBuffer) ;
-    self->homBuffer = 0 ;
-  }
   vl_free (self) ;
 }
 
@@ -241,16 +253,45 @@ vl_svmdataset_set_homogeneous_kernel_map (VlSvmDataset * self,
   assert(self) ;
   self->hom = hom ;
   self->homDimension = 0 ;
-  if (self->homBuffer) {
-    vl_free (self->homBuffer) ;
-    self->homBuffer = 0 ;
-  }
   if (self->hom) {
     self->homDimension = vl_homogeneouskernelmap_get_dimension(self->hom) ;
-    self->homBuffer = vl_calloc(self->homDimension, vl_get_type_size(self->dataType)) ;
   }
 }
 
+/** @brief Set whether the inner product uses SIMD instructions
+ ** @param self object.
+ ** @param x @c true to use SIMD instructions.
+ **
+ ** If @a x is @c true and SIMD instructions are enabled
+ ** (::vl_get_simd_enabled) and supported by the CPU when the inner
+ ** product function is queried
+ ** (::vl_svmdataset_get_inner_product_function), the inner product of
+ ** dense data is vectorized. This is faster, but the products are
+ ** summed in a different order than by the default scalar code, so
+ ** the learned models are not bit-for-bit identical. The option has
+ ** no effect if a kernel map is used. By default, it is @c false.
+ **/
+
+void
+vl_svmdataset_set_use_simd (VlSvmDataset * self, vl_bool x)
+{
+  assert(self) ;
+  self->useSimd = x ;
+}
+
+/** @brief Get whether the inner product uses SIMD instructions
+ ** @param self object.
+ ** @return @c true if the inner product may use SIMD instructions.
+ ** @sa ::vl_svmdataset_set_use_simd
+ **/
+
+vl_bool
+vl_svmdataset_get_use_simd (VlSvmDataset const * self)
+{
+  assert(self) ;
+  return self->useSimd ;
+}
+
 /** @brief Get the accumulate function
  ** @param self object.
  ** @return a pointer to the accumulate function to use with this data.
@@ -291,6 +332,18 @@ VlSvmInnerProductFunction
 vl_svmdataset_get_inner_product_function (VlSvmDataset const *self)
 {
   if (self->hom == NULL) {
+#ifndef VL_DISABLE_SSE2
+    if (self->useSimd && vl_cpu_has_sse2() && vl_get_simd_enabled()) {
+      switch (self->dataType) {
+        case VL_TYPE_FLOAT:
+          return (VlSvmInnerProductFunction) _vl_svmdataset_inner_product_simd_f ;
+        case VL_TYPE_DOUBLE:
+          return (VlSvmInnerProductFunction) _vl_svmdataset_inner_product_simd_d ;
+        default:
+          assert(0) ;
+      }
+    }
+#endif
     switch (self->dataType) {
       case VL_TYPE_FLOAT:
         return (VlSvmInnerProductFunction) _vl_svmdataset_inner_product_f ;
@@ -340,6 +393,17 @@ VL_XCAT(_vl_svmdataset_inner_product_,SFX) (VlSvmDataset const *self,
   return product ;
 }
 
+#ifndef VL_DISABLE_SSE2
+double
+VL_XCAT(_vl_svmdataset_inner_product_simd_,SFX) (VlSvmDataset const *self,
+                                                 vl_uindex element,
+                                                 double const *model)
+{
+  return VL_XCAT(_vl_svmdataset_inner_product_sse2_,SFX)
+    (self->dimension, ((T*)self->data) + self->dimension * element, model) ;
+}
+#endif
+
 void
 VL_XCAT(vl_svmdataset_accumulate_,SFX)(VlSvmDataset const *self,
                                        vl_uindex element,
@@ -354,6 +418,11 @@ VL_XCAT(vl_svmdataset_accumulate_,SFX)(VlSvmDataset const *self,
   }
 }
 
+/* The kernel map of a data component is evaluated in a buffer on the
+   stack, a block of components at a time if it does not fit, so that
+   the functions can be called concurrently and do not allocate
+   memory. */
+
 double
 VL_XCAT(_vl_svmdataset_inner_product_hom_,SFX) (VlSvmDataset const *self,
                                                 vl_uindex element,
@@ -362,17 +431,25 @@ VL_XCAT(_vl_svmdataset_inner_product_hom_,SFX) (VlSvmDataset const *self,
   double product = 0 ;
   T* data = ((T*)self->data) + self->dimension * element ;
   T* end = data + self->dimension ;
-  T* bufEnd = ((T*)self->homBuffer)+ self->homDimension ;
+  T buffer [VL_SVMDATASET_HOM_BUFFER_SIZE] ;
   while (data != end) {
     /* TODO: zeros in data could be optimized by skipping over them */
-    T* buf = self->homBuffer ;
-    VL_XCAT(vl_homogeneouskernelmap_evaluate_,SFX)(self->hom,
-                                                   self->homBuffer,
-                                                   1,
-                                                   (*data++)) ;
-    while (buf != bufEnd) {
-      product += (*buf++) * (*model++) ;
+    vl_uindex first ;
+    for (first = 0 ; first < self->homDimension ; first += VL_SVMDATASET_HOM_BUFFER_SIZE) {
+      vl_size count = VL_MIN(self->homDimension - first, VL_SVMDATASET_HOM_BUFFER_SIZE) ;
+      T* buf = buffer ;
+      T* bufEnd = buffer + count ;
+      VL_XCAT(_vl_homogeneouskernelmap_evaluate_range_,SFX)(self->hom,
+                                                            buffer,
+                                                            1,
+                                                            *data,
+                                                            first,
+                                                            count) ;
+      while (buf != bufEnd) {
+        product += (*buf++) * (*model++) ;
+      }
     }
+    data++ ;
   }
   return product ;
 }
@@ -385,18 +462,26 @@ VL_XCAT(vl_svmdataset_accumulate_hom_,SFX)(VlSvmDataset const *self,
 {
   T* data = ((T*)self->data) + self->dimension * element ;
   T* end = data + self->dimension ;
-  T* bufEnd = ((T*)self->homBuffer)+ self->homDimension ;
+  T buffer [VL_SVMDATASET_HOM_BUFFER_SIZE] ;
   while (data != end) {
     /* TODO: zeros in data could be optimized by skipping over them */
-    T* buf = self->homBuffer ;
-    VL_XCAT(vl_homogeneouskernelmap_evaluate_,SFX)(self->hom,
-                                                   self->homBuffer,
-                                                   1,
-                                                   (*data++)) ;
-    while (buf != bufEnd) {
-      *model += (*buf++) * multiplier ;
-      model++ ;
+    vl_uindex first ;
+    for (first = 0 ; first < self->homDimension ; first += VL_SVMDATASET_HOM_BUFFER_SIZE) {
+      vl_size count = VL_MIN(self->homDimension - first, VL_SVMDATASET_HOM_BUFFER_SIZE) ;
+      T* buf = buffer ;
+      T* bufEnd = buffer + count ;
+      VL_XCAT(_vl_homogeneouskernelmap_evaluate_range_,SFX)(self->hom,
+                                                            buffer,
+                                                            1,
+                                                            *data,
+                                                            first,
+                                                            count) ;
+      while (buf != bufEnd) {
+        *model += (*buf++) * multiplier ;
+        model++ ;
+      }
     }
+    data++ ;
   }
 }
 
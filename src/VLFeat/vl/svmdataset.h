@@ -61,6 +61,7 @@ VL_EXPORT void vl_svmdataset_delete (VlSvmDataset * dataset) ;
  **/
 VL_EXPORT void vl_svmdataset_set_homogeneous_kernel_map (VlSvmDataset * self,
                                                          VlHomogeneousKernelMap * hom) ;
+VL_EXPORT void vl_svmdataset_set_use_simd (VlSvmDataset * self, vl_bool x) ;
 /** @} */
 
 /** @name Get data and parameters
@@ -74,6 +75,7 @@ VL_EXPORT vl_size vl_svmdataset_get_mapDim (VlSvmDataset const *self) ;
 VL_EXPORT VlSvmAccumulateFunction vl_svmdataset_get_accumulate_function (VlSvmDataset const *self) ;
 VL_EXPORT VlSvmInnerProductFunction vl_svmdataset_get_inner_product_function (VlSvmDataset const * self) ;
 VL_EXPORT VlHomogeneousKernelMap * vl_svmdataset_get_homogeneous_kernel_map (VlSvmDataset const * self) ;
+VL_EXPORT vl_bool vl_svmdataset_get_use_simd (VlSvmDataset const * self) ;
 /** @} */
 
 /* VL_SVMDATASET_H */
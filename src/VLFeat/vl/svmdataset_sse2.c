@@ -0,0 +1,103 @@
+/** @file svmdataset_sse2.c
+ ** @brief SVM Dataset - SSE2 - Definition
+ **/
+
+/*
+Copyright (C) 2012 Daniele Perrone.
+Copyright (C) 2013 Andrea Vedaldi.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#if ! defined(VL_DISABLE_SSE2) & ! defined(__SSE2__)
+#error "Compiling with SSE2 enabled, but no __SSE2__ defined"
+#endif
+
+#if ! defined(VL_DISABLE_SSE2)
+
+#include <emmintrin.h>
+
+#include "svmdataset_sse2.h"
+
+/* ---------------------------------------------------------------- */
+/*
+ * Inner product of a data vector and the (double) model. The data is
+ * converted to double and the products are summed in four pairs of
+ * partial sums, which breaks the dependency chain of the scalar
+ * loop. The summation order differs from the scalar code, so the
+ * results may differ in the last bits.
+ */
+
+static double
+_vl_svmdataset_sum_sse2 (__m128d a, __m128d b, __m128d c, __m128d d)
+{
+  double acc [2] ;
+  __m128d x = _mm_add_pd(_mm_add_pd(a, b), _mm_add_pd(c, d)) ;
+  _mm_storeu_pd(acc, x) ;
+  return acc[0] + acc[1] ;
+}
+
+VL_EXPORT double
+_vl_svmdataset_inner_product_sse2_f (vl_size dimension,
+                                     float const * data,
+                                     double const * model)
+{
+  __m128d acc0 = _mm_setzero_pd() ;
+  __m128d acc1 = _mm_setzero_pd() ;
+  __m128d acc2 = _mm_setzero_pd() ;
+  __m128d acc3 = _mm_setzero_pd() ;
+  vl_uindex i ;
+  double product ;
+
+  for (i = 0 ; i + 8 <= dimension ; i += 8) {
+    __m128 x0 = _mm_loadu_ps(data + i) ;
+    __m128 x1 = _mm_loadu_ps(data + i + 4) ;
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_cvtps_pd(x0),
+                                       _mm_loadu_pd(model + i))) ;
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x0, x0)),
+                                       _mm_loadu_pd(model + i + 2))) ;
+    acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_cvtps_pd(x1),
+                                       _mm_loadu_pd(model + i + 4))) ;
+    acc3 = _mm_add_pd(acc3, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x1, x1)),
+                                       _mm_loadu_pd(model + i + 6))) ;
+  }
+  product = _vl_svmdataset_sum_sse2(acc0, acc1, acc2, acc3) ;
+  for ( ; i < dimension ; ++i) {
+    product += data[i] * model[i] ;
+  }
+  return product ;
+}
+
+VL_EXPORT double
+_vl_svmdataset_inner_product_sse2_d (vl_size dimension,
+                                     double const * data,
+                                     double const * model)
+{
+  __m128d acc0 = _mm_setzero_pd() ;
+  __m128d acc1 = _mm_setzero_pd() ;
+  __m128d acc2 = _mm_setzero_pd() ;
+  __m128d acc3 = _mm_setzero_pd() ;
+  vl_uindex i ;
+  double product ;
+
+  for (i = 0 ; i + 8 <= dimension ; i += 8) {
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(data + i),
+                                       _mm_loadu_pd(model + i))) ;
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(data + i + 2),
+                                       _mm_loadu_pd(model + i + 2))) ;
+    acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_loadu_pd(data + i + 4),
+                                       _mm_loadu_pd(model + i + 4))) ;
+    acc3 = _mm_add_pd(acc3, _mm_mul_pd(_mm_loadu_pd(data + i + 6),
+                                       _mm_loadu_pd(model + i + 6))) ;
+  }
+  product = _vl_svmdataset_sum_sse2(acc0, acc1, acc2, acc3) ;
+  for ( ; i < dimension ; ++i) {
+    product += data[i] * model[i] ;
+  }
+  return product ;
+}
+
+/* ! VL_DISABLE_SSE2 */
+#endif
@@ -0,0 +1,34 @@
+/** @file svmdataset_sse2.h
+ ** @brief SVM Dataset - SSE2
+ **/
+
+/*
+Copyright (C) 2012 Daniele Perrone.
+Copyright (C) 2013 Andrea Vedaldi.
+All rights reserved.
+
+This file is part of the VLFeat library and is made available under
+the terms of the BSD license (see the COPYING file).
+*/
+
+#ifndef VL_SVMDATASET_SSE2_H
+#define VL_SVMDATASET_SSE2_H
+
+#include "generic.h"
+
+#ifndef VL_DISABLE_SSE2
+
+VL_EXPORT double
+_vl_svmdataset_inner_product_sse2_f (vl_size dimension,
+                                     float const * data,
+                                     double const * model) ;
+
+VL_EXPORT double
+_vl_svmdataset_inner_product_sse2_d (vl_size dimension,
+                                     double const * data,
+                                     double const * model) ;
+
+#endif
+
+/* VL_SVMDATASET_SSE2_H */
+#endif
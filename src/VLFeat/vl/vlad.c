@@ -85,10 +85,38 @@ vl_vlad_encode (enc, VL_F_TYPE,
                 0) ;
 @endcode
 
+For the l2 distance, ::vl_kmeans_quantize finds the nearest centers
+with ::vl_eval_l2_nearest_neighbors_f, which is efficient even for
+large vocabularies. The same function can be called directly, with a
+number of neighbors larger than one, to compute soft assignments.
+
 Various @ref vlad-normalization normalizations can be applied to the
 VLAD vectors. These are controlled by the parameter @a flag of
 ::vl_vlad_encode.
 
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+@section vlad-streaming Incremental encoding
+<!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
+
+A ::VlVladEncoder object computes the VLAD encoding incrementally, as
+the features become available, without storing all of them. Features
+are added by ::vl_vlad_encoder_push, either with their assignments or,
+passing @c NULL, assigning each of them to the nearest mean. The
+encoding is obtained by ::vl_vlad_encoder_finalize and is the same as
+the one computed by ::vl_vlad_encode on all the features.
+
+@code
+VlVladEncoder * encoder = vl_vlad_encoder_new
+  (VL_TYPE_FLOAT, vl_kmeans_get_centers(kmeans), dimension, numCenters, 0) ;
+
+vl_vlad_encoder_begin (encoder) ;
+while (... more features ...) {
+  vl_vlad_encoder_push (encoder, features, numFeatures, NULL) ;
+}
+vl_vlad_encoder_finalize (encoder, enc) ;
+vl_vlad_encoder_delete (encoder) ;
+@endcode
+
 <!-- ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~  -->
 @page vlad-fundamentals VLAD fundamentals
 @tableofcontents
@@ -153,32 +181,140 @@ normalization strategies. These are optionally applied in this order:
 #include <stdlib.h>
 #include <string.h>
 
-#if defined(_OPENMP)
-#include <omp.h>
+#ifndef VL_VLAD_INSTANTIATING
+
+/** @internal @brief Number of data points assigned at once */
+#define VL_VLAD_BLOCK_SIZE 256
+
+struct _VlVladEncoder
+{
+  vl_type dataType ;          /**< Data type. */
+  vl_size dimension ;         /**< Data dimensionality. */
+  vl_size numClusters ;       /**< Number of clusters. */
+  int flags ;                 /**< Encoding options. */
+
+  void * means ;              /**< Cluster means. */
+  void * enc ;                /**< Accumulated data. */
+  double * masses ;           /**< Accumulated cluster masses. */
+  vl_uint32 * indexes ;       /**< Nearest means of a block of data. */
+} ;
+
+/** @internal @brief Data processed by the parallel loops */
+typedef struct _VlVladBlock
+{
+  VlVladEncoder const * self ; /**< Encoder. */
+  void const * data ;         /**< Data. */
+  vl_size numData ;           /**< Number of data. */
+  void const * assignments ;  /**< Data to cluster assignments. */
+  void * enc ;                /**< Encoding being finalized. */
+} VlVladBlock ;
+
+/* VL_VLAD_INSTANTIATING */
 #endif
 
 /* ================================================================ */
 #ifdef VL_VLAD_INSTANTIATING
 
+/*
+ Without assignments, each vector is assigned to the nearest mean,
+ using the (SIMD) l2 distance. The nearest means of a block of
+ vectors are found in parallel, then each cluster accumulates its
+ vectors.
+ */
+
 static void
-VL_XCAT(_vl_vlad_encode_, SFX)
-(TYPE * enc,
- TYPE const * means, vl_size dimension, vl_size numClusters,
- TYPE const * data, vl_size numData,
- TYPE const * assignments,
- int flags)
+VL_XCAT(_vl_vlad_encoder_assign_nearest_, SFX)
+(void * block_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
 {
-  vl_uindex dim ;
-  vl_index i_cl, i_d ;
+  VlVladBlock const * block = block_ ;
+  VlVladEncoder const * self = block->self ;
+  TYPE const * data = block->data ;
+  TYPE const * means = self->means ;
+  vl_size dimension = self->dimension ;
+  vl_size numClusters = self->numClusters ;
+  vl_uindex i_d ;
+
+#if (FLT == VL_TYPE_FLOAT)
+  VlFloatVectorComparisonFunction distFn = vl_get_vector_comparison_function_f(VlDistanceL2) ;
+#else
+  VlDoubleVectorComparisonFunction distFn = vl_get_vector_comparison_function_d(VlDistanceL2) ;
+#endif
 
-  memset(enc, 0, sizeof(TYPE) * dimension * numClusters) ;
+  for (i_d = begin ; i_d < end ; ++i_d) {
+    TYPE bestDistance = (TYPE) VL_INFINITY_D ;
+    vl_uindex k ;
+    self->indexes[i_d] = 0 ;
+    for (k = 0 ; k < numClusters ; ++k) {
+      TYPE distance = distFn (dimension, data + i_d * dimension, means + k * dimension) ;
+      if (distance < bestDistance) {
+        bestDistance = distance ;
+        self->indexes[i_d] = (vl_uint32)k ;
+      }
+    }
+  }
+}
 
-#if defined(_OPENMP)
-#pragma omp parallel for default(shared) private(i_cl,i_d,dim) num_threads(vl_get_max_threads())
-#endif
-  for (i_cl = 0; i_cl < (signed)numClusters; i_cl++) {
+static void
+VL_XCAT(_vl_vlad_encoder_accumulate_nearest_, SFX)
+(void * block_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlVladBlock const * block = block_ ;
+  VlVladEncoder const * self = block->self ;
+  TYPE const * data = block->data ;
+  TYPE * enc = self->enc ;
+  vl_size dimension = self->dimension ;
+  vl_uindex i_cl, i_d, dim ;
+
+  for (i_cl = begin ; i_cl < end ; ++i_cl) {
+    for (i_d = 0 ; i_d < block->numData ; ++i_d) {
+      if (self->indexes[i_d] == (vl_uint32)i_cl) {
+        self->masses[i_cl] += 1 ;
+        for (dim = 0 ; dim < dimension ; ++dim) {
+          enc[i_cl * dimension + dim] += data[i_d * dimension + dim] ;
+        }
+      }
+    }
+  }
+}
+
+static void
+VL_XCAT(_vl_vlad_encoder_push_nearest_, SFX)
+(VlVladEncoder * self, TYPE const * data, vl_size numData)
+{
+  vl_uindex begin ;
+
+  for (begin = 0 ; begin < numData ; begin += VL_VLAD_BLOCK_SIZE) {
+    VlVladBlock block ;
+    block.self = self ;
+    block.data = data + begin * self->dimension ;
+    block.numData = VL_MIN(numData - begin, VL_VLAD_BLOCK_SIZE) ;
+    block.assignments = NULL ;
+
+    vl_parallel_for (block.numData, 0,
+                     VL_XCAT(_vl_vlad_encoder_assign_nearest_, SFX),
+                     &block) ;
+    vl_parallel_for (self->numClusters, 0,
+                     VL_XCAT(_vl_vlad_encoder_accumulate_nearest_, SFX),
+                     &block) ;
+  }
+}
+
+static void
+VL_XCAT(_vl_vlad_encoder_accumulate_, SFX)
+(void * block_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlVladBlock const * block = block_ ;
+  VlVladEncoder const * self = block->self ;
+  TYPE const * data = block->data ;
+  TYPE const * assignments = block->assignments ;
+  TYPE * enc = self->enc ;
+  vl_size dimension = self->dimension ;
+  vl_size numClusters = self->numClusters ;
+  vl_uindex i_cl, i_d, dim ;
+
+  for (i_cl = begin ; i_cl < end ; i_cl++) {
     double clusterMass = 0 ;
-    for (i_d = 0; i_d < (signed)numData; i_d++) {
+    for (i_d = 0; i_d < block->numData; i_d++) {
       if (assignments[i_d*numClusters + i_cl] > 0) {
         double q = assignments[i_d*numClusters+i_cl] ;
         clusterMass +=  q ;
@@ -187,6 +323,46 @@ VL_XCAT(_vl_vlad_encode_, SFX)
         }
       }
     }
+    self->masses[i_cl] += clusterMass ;
+  }
+}
+
+static void
+VL_XCAT(_vl_vlad_encoder_push_, SFX)
+(VlVladEncoder * self,
+ TYPE const * data, vl_size numData,
+ TYPE const * assignments)
+{
+  VlVladBlock block ;
+
+  if (assignments == NULL) {
+    VL_XCAT(_vl_vlad_encoder_push_nearest_, SFX)(self, data, numData) ;
+    return ;
+  }
+
+  block.self = self ;
+  block.data = data ;
+  block.numData = numData ;
+  block.assignments = assignments ;
+  vl_parallel_for (self->numClusters, 0,
+                   VL_XCAT(_vl_vlad_encoder_accumulate_, SFX),
+                   &block) ;
+}
+
+static void
+VL_XCAT(_vl_vlad_encoder_normalize_, SFX)
+(void * block_, vl_uindex task VL_UNUSED, vl_uindex begin, vl_uindex end)
+{
+  VlVladBlock const * block = block_ ;
+  VlVladEncoder const * self = block->self ;
+  TYPE const * means = self->means ;
+  TYPE * enc = block->enc ;
+  vl_size dimension = self->dimension ;
+  int flags = self->flags ;
+  vl_uindex i_cl, dim ;
+
+  for (i_cl = begin ; i_cl < end ; i_cl++) {
+    double clusterMass = self->masses[i_cl] ;
 
     if (clusterMass > 0) {
       if (flags & VL_VLAD_FLAG_NORMALIZE_MASS) {
@@ -226,6 +402,25 @@ VL_XCAT(_vl_vlad_encode_, SFX)
       }
     }
   }
+}
+
+static void
+VL_XCAT(_vl_vlad_encoder_finalize_, SFX)
+(VlVladEncoder const * self, TYPE * enc)
+{
+  vl_size dimension = self->dimension ;
+  vl_size numClusters = self->numClusters ;
+  int flags = self->flags ;
+  vl_uindex dim ;
+  VlVladBlock block ;
+
+  memcpy(enc, self->enc, sizeof(TYPE) * dimension * numClusters) ;
+
+  block.self = self ;
+  block.enc = enc ;
+  vl_parallel_for (numClusters, 0,
+                   VL_XCAT(_vl_vlad_encoder_normalize_, SFX),
+                   &block) ;
 
   if (! (flags & VL_VLAD_FLAG_UNNORMALIZED)) {
     TYPE n = 0 ;
@@ -241,7 +436,7 @@ VL_XCAT(_vl_vlad_encode_, SFX)
   }
 }
 
-/* VL_FISHER_INSTANTIATING */
+/* VL_VLAD_INSTANTIATING */
 #else
 
 #ifndef __DOXYGEN__
@@ -264,6 +459,131 @@ VL_XCAT(_vl_vlad_encode_, SFX)
 /* ================================================================ */
 #ifndef VL_VLAD_INSTANTIATING
 
+/** @brief Create a new VLAD encoder
+ ** @param dataType the type of the data (::VL_TYPE_DOUBLE or ::VL_TYPE_FLOAT).
+ ** @param means cluster means.
+ ** @param dimension dimensionality of the data.
+ ** @param numClusters number of clusters.
+ ** @param flags options.
+ ** @return new encoder.
+ **
+ ** @a means and @a flags have the same format as in
+ ** ::vl_vlad_encode. The means are copied in the object, which
+ ** can encode several sets of vectors in turn (@ref vlad-streaming).
+ **
+ ** @sa ::vl_vlad_encoder_delete
+ **/
+
+VlVladEncoder *
+vl_vlad_encoder_new (vl_type dataType,
+                     void const * means, vl_size dimension, vl_size numClusters,
+                     int flags)
+{
+  VlVladEncoder * self = vl_calloc(1, sizeof(VlVladEncoder)) ;
+  vl_size size = vl_get_type_size(dataType) ;
+
+  assert(dataType == VL_TYPE_FLOAT || dataType == VL_TYPE_DOUBLE) ;
+
+  self->dataType = dataType ;
+  self->dimension = dimension ;
+  self->numClusters = numClusters ;
+  self->flags = flags ;
+
+  self->means = vl_malloc(size * dimension * numClusters) ;
+  self->enc = vl_malloc(size * dimension * numClusters) ;
+  self->masses = vl_malloc(sizeof(double) * numClusters) ;
+  self->indexes = vl_malloc(sizeof(vl_uint32) * VL_VLAD_BLOCK_SIZE) ;
+  memcpy(self->means, means, size * dimension * numClusters) ;
+
+  vl_vlad_encoder_begin (self) ;
+  return self ;
+}
+
+/** @brief Delete a VLAD encoder
+ ** @param self object.
+ ** @sa ::vl_vlad_encoder_new
+ **/
+
+void
+vl_vlad_encoder_delete (VlVladEncoder * self)
+{
+  vl_free(self->means) ;
+  vl_free(self->enc) ;
+  vl_free(self->masses) ;
+  vl_free(self->indexes) ;
+  vl_free(self) ;
+}
+
+/** @brief Start encoding a new set of vectors
+ ** @param self object.
+ **
+ ** The function clears the data accumulated by
+ ** ::vl_vlad_encoder_push.
+ **/
+
+void
+vl_vlad_encoder_begin (VlVladEncoder * self)
+{
+  memset(self->enc, 0, vl_get_type_size(self->dataType) *
+         self->dimension * self->numClusters) ;
+  memset(self->masses, 0, sizeof(double) * self->numClusters) ;
+}
+
+/** @brief Add vectors to the encoding
+ ** @param self object.
+ ** @param data the data vectors to encode.
+ ** @param numData number of vectors.
+ ** @param assignments data to cluster soft assignments (or @c NULL).
+ **
+ ** @a data and @a assignments have the same format as in
+ ** ::vl_vlad_encode. If @a assignments is @c NULL, each vector is
+ ** assigned to the nearest mean in l2 distance.
+ **/
+
+void
+vl_vlad_encoder_push (VlVladEncoder * self,
+                      void const * data, vl_size numData,
+                      void const * assignments)
+{
+  switch (self->dataType) {
+    case VL_TYPE_FLOAT:
+      _vl_vlad_encoder_push_f (self, (float const *) data, numData,
+                               (float const *) assignments) ;
+      break ;
+    case VL_TYPE_DOUBLE:
+      _vl_vlad_encoder_push_d (self, (double const *) data, numData,
+                               (double const *) assignments) ;
+      break ;
+    default:
+      abort() ;
+  }
+}
+
+/** @brief Compute the VLAD encoding of the vectors added so far
+ ** @param self object.
+ ** @param enc output VLAD encoding (out).
+ **
+ ** The result is the same as the one of ::vl_vlad_encode applied to
+ ** all the vectors added since the last call to
+ ** ::vl_vlad_encoder_begin. The accumulated data is not modified, so
+ ** that more vectors can be added afterwards.
+ **/
+
+void
+vl_vlad_encoder_finalize (VlVladEncoder const * self, void * enc)
+{
+  switch (self->dataType) {
+    case VL_TYPE_FLOAT:
+      _vl_vlad_encoder_finalize_f (self, (float *) enc) ;
+      break ;
+    case VL_TYPE_DOUBLE:
+      _vl_vlad_encoder_finalize_d (self, (double *) enc) ;
+      break ;
+    default:
+      abort() ;
+  }
+}
+
 /** @brief VLAD encoding of a set of vectors.
  ** @param enc output VLAD encoding (out).
  ** @param dataType the type of the input data (::VL_TYPE_DOUBLE or ::VL_TYPE_FLOAT).
@@ -286,6 +606,9 @@ VL_XCAT(_vl_vlad_encode_, SFX)
  ** ::VL_VLAD_FLAG_NORMALIZE_COMPONENTS, ::VL_VLAD_FLAG_SQUARE_ROOT,
  ** ::VL_VLAD_FLAG_UNNORMALIZED, and ::VL_VLAD_FLAG_NORMALIZE_MASS.
  **
+ ** To encode several images with the same means, or vectors that
+ ** become available incrementally, use a ::VlVladEncoder instead.
+ **
  ** @sa @ref vlad
  **/
 
@@ -296,22 +619,11 @@ vl_vlad_encode (void * enc, vl_type dataType,
                 void const * assignments,
                 int flags)
 {
-  switch(dataType) {
-    case VL_TYPE_FLOAT:
-      _vl_vlad_encode_f ((float *) enc,
-                         (float const *) means, dimension, numClusters,
-                         (float const *) data,  numData,
-                         (float const *) assignments, flags) ;
-      break;
-    case VL_TYPE_DOUBLE:
-      _vl_vlad_encode_d ((double *) enc,
-                         (double const *) means, dimension, numClusters,
-                         (double const *) data, numData,
-                         (double const *) assignments, flags) ;
-      break;
-    default:
-      abort();
-  }
+  VlVladEncoder * encoder = vl_vlad_encoder_new
+  (dataType, means, dimension, numClusters, flags) ;
+  vl_vlad_encoder_push (encoder, data, numData, assignments) ;
+  vl_vlad_encoder_finalize (encoder, enc) ;
+  vl_vlad_encoder_delete (encoder) ;
 }
 
 /* ! VL_VLAD_INSTANTIATING */
@@ -49,5 +49,28 @@ VL_EXPORT void vl_vlad_encode
    void const * assignments,
    int flags) ;
 
+#ifndef __DOXYGEN__
+struct _VlVladEncoder ;
+typedef struct _VlVladEncoder VlVladEncoder ;
+#else
+/** @brief VLAD encoder */
+typedef OPAQUE VlVladEncoder ;
+#endif
+
+/** @name Incremental encoding
+ ** @{ */
+VL_EXPORT VlVladEncoder * vl_vlad_encoder_new
+  (vl_type dataType,
+   void const * means, vl_size dimension, vl_size numClusters,
+   int flags) ;
+VL_EXPORT void vl_vlad_encoder_delete (VlVladEncoder * self) ;
+VL_EXPORT void vl_vlad_encoder_begin (VlVladEncoder * self) ;
+VL_EXPORT void vl_vlad_encoder_push
+  (VlVladEncoder * self,
+   void const * data, vl_size numData,
+   void const * assignments) ;
+VL_EXPORT void vl_vlad_encoder_finalize (VlVladEncoder const * self, void * enc) ;
+/** @} */
+
 /* VL_VLAD_H */
 #endif
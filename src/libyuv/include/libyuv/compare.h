@@ -22,6 +22,18 @@ extern "C" {
 LIBYUV_API
 uint32 HashDjb2(const uint8* src, uint64 count, uint32 seed);
 
+// Compute a hash for each tile of a plane, for finding the regions of a frame
+// that changed. Tiles are tile_size square and stored in rows from the top
+// left; tiles on the right and bottom edges may be smaller. width is in bytes.
+// dst_hashes needs ((width + tile_size - 1) / tile_size) *
+// ((height + tile_size - 1) / tile_size) entries. Each hash is the HashDjb2,
+// with a seed of 5381, of the rows of the tile in order.
+// tile_size is at most 4096.
+LIBYUV_API
+int ComputeTileHashes(const uint8* src, int stride,
+                      int width, int height, int tile_size,
+                      uint32* dst_hashes);
+
 // Scan an opaque argb image and return fourcc based on alpha offset.
 // Returns FOURCC_ARGB, FOURCC_BGRA, or 0 if unknown.
 LIBYUV_API
@@ -37,6 +49,14 @@ uint64 ComputeSumSquareErrorPlane(const uint8* src_a, int stride_a,
                                   const uint8* src_b, int stride_b,
                                   int width, int height);
 
+// Sum of absolute differences of each tile of 2 planes. Tiles are laid out
+// as for ComputeTileHashes. A tile with a sum of 0 is unchanged.
+LIBYUV_API
+int ComputeTileSAD(const uint8* src_a, int stride_a,
+                   const uint8* src_b, int stride_b,
+                   int width, int height, int tile_size,
+                   uint32* dst_sad);
+
 static const int kMaxPsnr = 128;
 
 LIBYUV_API
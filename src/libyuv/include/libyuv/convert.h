@@ -16,6 +16,7 @@
 #include "libyuv/convert_from.h"
 #include "libyuv/planar_functions.h"
 #include "libyuv/rotate.h"
+#include "libyuv/scale.h"  // For enum FilterMode.
 
 #ifdef __cplusplus
 namespace libyuv {
@@ -198,6 +199,18 @@ int MJPGToI420(const uint8* sample, size_t sample_size,
                int src_width, int src_height,
                int dst_width, int dst_height);
 
+// Decode MJPG to I420 of a different size. libjpeg DCT scaling decodes at
+// the smallest of 1/1, 1/2, 1/4 or 1/8 of src_width/height that is at least
+// dst_width/height, and only the remaining ratio goes through I420Scale.
+LIBYUV_API
+int MJPGToI420Scaled(const uint8* sample, size_t sample_size,
+                     uint8* dst_y, int dst_stride_y,
+                     uint8* dst_u, int dst_stride_u,
+                     uint8* dst_v, int dst_stride_v,
+                     int src_width, int src_height,
+                     int dst_width, int dst_height,
+                     enum FilterMode filtering);
+
 // Query size of MJPG in pixels.
 LIBYUV_API
 int MJPGSize(const uint8* sample, size_t sample_size,
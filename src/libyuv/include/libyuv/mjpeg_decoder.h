@@ -34,6 +34,9 @@ LIBYUV_BOOL ValidateJpeg(const uint8* sample, size_t sample_size);
 
 static const uint32 kUnknownDataSize = 0xFFFFFFFF;
 
+// Maximum number of bands DecodeBandsToCallback() splits a frame into.
+static const int kMaxRestartBands = 16;
+
 enum JpegSubsamplingType {
   kJpegYuv420,
   kJpegYuv422,
@@ -94,6 +97,23 @@ class LIBYUV_API MJpegDecoder {
   // Returns height of the last loaded frame in pixels.
   int GetHeight();
 
+  // Selects libjpeg's DCT domain downscaling of the last loaded frame by
+  // 1 / scale_denom. scale_denom must be 1, 2, 4 or 8. LoadFrame() resets it
+  // to 1. All component geometry getters below and the Decode functions
+  // refer to the scaled image once this is set.
+  // Returns LIBYUV_FALSE if scale_denom is not supported.
+  LIBYUV_BOOL SetScaleDenom(int scale_denom);
+
+  // Returns width of the last loaded frame after DCT scaling.
+  int GetScaledWidth();
+
+  // Returns height of the last loaded frame after DCT scaling.
+  int GetScaledHeight();
+
+  // Returns the number of MCUs between restart markers, or 0 if the last
+  // loaded frame has no restart markers.
+  int GetRestartInterval();
+
   // Returns format of the last loaded frame. The return value is one of the
   // kColorSpace* constants.
   int GetColorSpace();
@@ -148,6 +168,25 @@ class LIBYUV_API MJpegDecoder {
   LIBYUV_BOOL DecodeToCallback(CallbackFunction fn, void* opaque,
                         int dst_width, int dst_height);
 
+  // Splits the last loaded frame into at most max_bands horizontal bands at
+  // restart markers that fall on iMCU row boundaries, so that each band can
+  // be entropy decoded independently. Call after SetScaleDenom().
+  // Returns the number of bands, which is 1 if the frame has no usable
+  // restart markers or is not a single scan baseline frame.
+  int SplitRestartBands(int max_bands);
+
+  // First scaled image row of the n-th band from SplitRestartBands().
+  // Always even so chroma of 4:2:0 output starts on a whole row.
+  int GetBandStartRow(int band);
+
+  // Decodes the entire image like DecodeToCallback(), one band at a time
+  // from SplitRestartBands(), and passes each band's data to the callback
+  // with opaques[band]. When libyuv is built with OpenMP the bands are
+  // decoded concurrently, so the callback must only touch the rows of its
+  // band. dst_width and dst_height must match the scaled image size.
+  LIBYUV_BOOL DecodeBandsToCallback(CallbackFunction fn, void* const* opaques,
+                                    int dst_width, int dst_height);
+
   // The helper function which recognizes the jpeg sub-sampling type.
   static JpegSubsamplingType JpegSubsamplingTypeHelper(
      int* subsample_x, int* subsample_y, int number_of_components);
@@ -155,6 +194,10 @@ class LIBYUV_API MJpegDecoder {
  private:
   void AllocOutputBuffers(int num_outbufs);
   void DestroyOutputBuffers();
+  void AllocScanlineBuffers();
+
+  // Builds a standalone frame for the n-th band in band_buf.
+  int BuildBandFrame(int band, uint8* band_buf);
 
   LIBYUV_BOOL StartDecode();
   LIBYUV_BOOL FinishDecode();
@@ -184,6 +227,17 @@ class LIBYUV_API MJpegDecoder {
   // output buffers. Large enough for just one iMCU row.
   uint8** databuf_;
   int* databuf_strides_;
+
+  // DCT scaling denominator set by SetScaleDenom().
+  int scale_denom_;
+
+  // Restart band layout from SplitRestartBands(). Offsets are into buf_.
+  int num_bands_;
+  int band_start_rows_[kMaxRestartBands];  // In unscaled image rows.
+  int band_begin_[kMaxRestartBands];  // Entropy data after the RST marker.
+  int band_end_[kMaxRestartBands];  // Next RST marker or EOI.
+  int header_size_;  // Bytes up to the end of the SOS header.
+  int sof_offset_;  // Offset of the SOFn marker.
 };
 
 }  // namespace libyuv
@@ -372,6 +372,22 @@ int ARGBBlur(const uint8* src_argb, int src_stride_argb,
              int32* dst_cumsum, int dst_stride32_cumsum,
              int width, int height, int radius);
 
+// Blur ARGB image with a (radius * 2 + 1) square box filter, applied passes
+// times. 1 pass is a box blur and 3 passes approximate a Gaussian.
+// Unlike ARGBBlur no CumulativeSum table is needed; a few rows of 16 bit
+// sums are allocated internally.
+// radius is clamped to 127. passes is 1 to 3.
+LIBYUV_API
+int ARGBBoxBlur(const uint8* src_argb, int src_stride_argb,
+                uint8* dst_argb, int dst_stride_argb,
+                int width, int height, int radius, int passes);
+
+// Blur a plane, such as Y, the same way as ARGBBoxBlur.
+LIBYUV_API
+int BlurPlane(const uint8* src_y, int src_stride_y,
+              uint8* dst_y, int dst_stride_y,
+              int width, int height, int radius, int passes);
+
 // Multiply ARGB image by ARGB value.
 LIBYUV_API
 int ARGBShade(const uint8* src_argb, int src_stride_argb,
@@ -258,6 +258,17 @@ extern "C" {
 #define HAS_MIRRORROW_SSE2
 #endif
 
+// The following are available on GCC and clang x86 platforms:
+#if !defined(LIBYUV_DISABLE_X86) && \
+    (defined(__x86_64__) || defined(__i386__)) && !defined(_MSC_VER)
+#define HAS_BOXSUMADDROW_SSE2
+#define HAS_BOXSUMTOAVERAGEROW_SSE2
+#if defined(CLANG_HAS_AVX2) || defined(GCC_HAS_AVX2)
+#define HAS_BOXSUMADDROW_AVX2
+#define HAS_BOXSUMTOAVERAGEROW_AVX2
+#endif
+#endif
+
 // The following are available on Neon platforms:
 #if !defined(LIBYUV_DISABLE_NEON) && \
     (defined(__aarch64__) || defined(__ARM_NEON__) || defined(LIBYUV_NEON))
@@ -1743,6 +1754,25 @@ void CumulativeSumToAverageRow_C(const int32* topleft, const int32* botleft,
 void ComputeCumulativeSumRow_C(const uint8* row, int32* cumsum,
                                const int32* previous_cumsum, int width);
 
+// Used for box blur. Sums are 16 bit and allowed to wrap, so only differences
+// of sums of up to 257 values are meaningful.
+void ComputeBoxSumRow_C(const uint8* src, uint16* sum, int bpp, int width);
+void BoxSumAddRow_C(const uint8* src, uint16* sum, int width);
+void BoxSumAddRow_SSE2(const uint8* src, uint16* sum, int width);
+void BoxSumAddRow_AVX2(const uint8* src, uint16* sum, int width);
+void BoxSumAddRow_Any_SSE2(const uint8* src, uint16* sum, int width);
+void BoxSumAddRow_Any_AVX2(const uint8* src, uint16* sum, int width);
+void BoxSumToAverageRow_C(const uint16* sum_hi, const uint16* sum_lo,
+                          int count, uint8* dst, int width);
+void BoxSumToAverageRow_SSE2(const uint16* sum_hi, const uint16* sum_lo,
+                             int count, uint8* dst, int width);
+void BoxSumToAverageRow_AVX2(const uint16* sum_hi, const uint16* sum_lo,
+                             int count, uint8* dst, int width);
+void BoxSumToAverageRow_Any_SSE2(const uint16* sum_hi, const uint16* sum_lo,
+                                 int count, uint8* dst, int width);
+void BoxSumToAverageRow_Any_AVX2(const uint16* sum_hi, const uint16* sum_lo,
+                                 int count, uint8* dst, int width);
+
 LIBYUV_API
 void ARGBAffineRow_C(const uint8* src_argb, int src_argb_stride,
                      uint8* dst_argb, const float* uv_dudv, int width);
@@ -23,7 +23,9 @@ typedef enum FilterMode {
   kFilterNone = 0,  // Point sample; Fastest.
   kFilterLinear = 1,  // Filter horizontally only.
   kFilterBilinear = 2,  // Faster than box, but lower quality scaling down.
-  kFilterBox = 3  // Highest quality.
+  kFilterBox = 3,  // Highest quality box filter.
+  kFilterBicubic = 4,  // Bicubic (Catmull-Rom) polyphase filter.
+  kFilterLanczos = 5  // Lanczos3 polyphase filter. Sharpest; slowest.
 } FilterModeEnum;
 
 // Scale a YUV plane.
@@ -49,6 +51,8 @@ void ScalePlane_16(const uint16* src, int src_stride,
 // quality image, at the expense of speed.
 // If filtering is kFilterBox, averaging is used to produce ever better
 // quality image, at further expense of speed.
+// If filtering is kFilterBicubic or kFilterLanczos, a separable polyphase
+// filter with 14 bit coefficients is used, for the sharpest results.
 // Returns 0 if successful.
 
 LIBYUV_API
@@ -12,6 +12,7 @@
 #define INCLUDE_LIBYUV_SCALE_ROW_H_
 
 #include "libyuv/basic_types.h"
+#include "libyuv/row.h"  // For GCC_HAS_AVX2 and CLANG_HAS_AVX2.
 #include "libyuv/scale.h"
 
 #ifdef __cplusplus
@@ -48,6 +49,17 @@ extern "C" {
 #define HAS_SCALEROWDOWN4_SSE2
 #endif
 
+// The following are available for GCC x64:
+#if !defined(LIBYUV_DISABLE_X86) && !defined(__native_client__) && \
+    defined(__x86_64__)
+#define HAS_SCALEPOLYPHASECOLS_SSSE3
+#define HAS_SCALEPOLYPHASEROWS_SSE2
+#if defined(CLANG_HAS_AVX2) || defined(GCC_HAS_AVX2)
+#define HAS_SCALEPOLYPHASECOLS_AVX2
+#define HAS_SCALEPOLYPHASEROWS_AVX2
+#endif
+#endif
+
 // The following are available on VS2012:
 #if !defined(LIBYUV_DISABLE_X86) && defined(VISUALC_HAS_AVX2)
 #define HAS_SCALEADDROW_AVX2
@@ -123,6 +135,17 @@ void ScaleSlope(int src_width, int src_height,
                 enum FilterMode filtering,
                 int* x, int* y, int* dx, int* dy);
 
+// Number of taps of a polyphase filter for scaling src_size pixels to
+// dst_size, rounded up to a multiple of align and at most src_size.
+int ScalePolyphaseFilterLength(int src_size, int dst_size,
+                               enum FilterMode filtering, int align);
+
+// Compute the first source pixel and 14 bit coefficients of each destination
+// pixel. Negative src_size mirrors.
+void ScalePolyphaseFilter(int src_size, int dst_size,
+                          enum FilterMode filtering, int filter_length,
+                          int* filter_offsets, int16* filter_coeffs);
+
 void ScaleRowDown2_C(const uint8* src_ptr, ptrdiff_t src_stride,
                      uint8* dst, int dst_width);
 void ScaleRowDown2_16_C(const uint16* src_ptr, ptrdiff_t src_stride,
@@ -187,6 +210,18 @@ void ScaleRowDown38_2_Box_16_C(const uint16* src_ptr, ptrdiff_t src_stride,
                                uint16* dst_ptr, int dst_width);
 void ScaleAddRow_C(const uint8* src_ptr, uint16* dst_ptr, int src_width);
 void ScaleAddRow_16_C(const uint16* src_ptr, uint32* dst_ptr, int src_width);
+void ScalePolyphaseCols_C(int16* dst_ptr, const uint8* src_ptr,
+                          int dst_width, const int* filter_offsets,
+                          const int16* filter_coeffs, int filter_length);
+void ScalePolyphaseCols_16_C(uint16* dst_ptr, const uint16* src_ptr,
+                             int dst_width, const int* filter_offsets,
+                             const int16* filter_coeffs, int filter_length);
+void ScalePolyphaseRows_C(const int16* src_ptr, ptrdiff_t src_stride,
+                          uint8* dst_ptr, const int16* filter_coeffs,
+                          int filter_length, int dst_width);
+void ScalePolyphaseRows_16_C(const uint16* src_ptr, ptrdiff_t src_stride,
+                             uint16* dst_ptr, const int16* filter_coeffs,
+                             int filter_length, int dst_width);
 void ScaleARGBRowDown2_C(const uint8* src_argb,
                          ptrdiff_t src_stride,
                          uint8* dst_argb, int dst_width);
@@ -299,6 +334,56 @@ void ScaleFilterCols_SSSE3(uint8* dst_ptr, const uint8* src_ptr,
 void ScaleColsUp2_SSE2(uint8* dst_ptr, const uint8* src_ptr,
                        int dst_width, int x, int dx);
 
+void ScalePolyphaseCols_SSSE3(int16* dst_ptr, const uint8* src_ptr,
+                              int dst_width, const int* filter_offsets,
+                              const int16* filter_coeffs, int filter_length);
+void ScalePolyphaseCols_16_SSSE3(uint16* dst_ptr, const uint16* src_ptr,
+                                 int dst_width, const int* filter_offsets,
+                                 const int16* filter_coeffs,
+                                 int filter_length);
+void ScalePolyphaseCols_AVX2(int16* dst_ptr, const uint8* src_ptr,
+                             int dst_width, const int* filter_offsets,
+                             const int16* filter_coeffs, int filter_length);
+void ScalePolyphaseCols_16_AVX2(uint16* dst_ptr, const uint16* src_ptr,
+                                int dst_width, const int* filter_offsets,
+                                const int16* filter_coeffs,
+                                int filter_length);
+void ScalePolyphaseCols_Any_AVX2(int16* dst_ptr, const uint8* src_ptr,
+                                 int dst_width, const int* filter_offsets,
+                                 const int16* filter_coeffs,
+                                 int filter_length);
+void ScalePolyphaseCols_16_Any_AVX2(uint16* dst_ptr, const uint16* src_ptr,
+                                    int dst_width, const int* filter_offsets,
+                                    const int16* filter_coeffs,
+                                    int filter_length);
+void ScalePolyphaseRows_SSE2(const int16* src_ptr, ptrdiff_t src_stride,
+                             uint8* dst_ptr, const int16* filter_coeffs,
+                             int filter_length, int dst_width);
+void ScalePolyphaseRows_16_SSE2(const uint16* src_ptr, ptrdiff_t src_stride,
+                                uint16* dst_ptr, const int16* filter_coeffs,
+                                int filter_length, int dst_width);
+void ScalePolyphaseRows_AVX2(const int16* src_ptr, ptrdiff_t src_stride,
+                             uint8* dst_ptr, const int16* filter_coeffs,
+                             int filter_length, int dst_width);
+void ScalePolyphaseRows_16_AVX2(const uint16* src_ptr, ptrdiff_t src_stride,
+                                uint16* dst_ptr, const int16* filter_coeffs,
+                                int filter_length, int dst_width);
+void ScalePolyphaseRows_Any_SSE2(const int16* src_ptr, ptrdiff_t src_stride,
+                                 uint8* dst_ptr, const int16* filter_coeffs,
+                                 int filter_length, int dst_width);
+void ScalePolyphaseRows_16_Any_SSE2(const uint16* src_ptr,
+                                    ptrdiff_t src_stride,
+                                    uint16* dst_ptr,
+                                    const int16* filter_coeffs,
+                                    int filter_length, int dst_width);
+void ScalePolyphaseRows_Any_AVX2(const int16* src_ptr, ptrdiff_t src_stride,
+                                 uint8* dst_ptr, const int16* filter_coeffs,
+                                 int filter_length, int dst_width);
+void ScalePolyphaseRows_16_Any_AVX2(const uint16* src_ptr,
+                                    ptrdiff_t src_stride,
+                                    uint16* dst_ptr,
+                                    const int16* filter_coeffs,
+                                    int filter_length, int dst_width);
 
 // ARGB Column functions
 void ScaleARGBCols_SSE2(uint8* dst_argb, const uint8* src_argb,
@@ -11,6 +11,6 @@
 #ifndef INCLUDE_LIBYUV_VERSION_H_  // NOLINT
 #define INCLUDE_LIBYUV_VERSION_H_
 
-#define LIBYUV_VERSION 1433
+#define LIBYUV_VERSION 1438
 
 #endif  // INCLUDE_LIBYUV_VERSION_H_  NOLINT
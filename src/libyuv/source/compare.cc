@@ -37,7 +37,8 @@ uint32 HashDjb2_C(const uint8* src, int count, uint32 seed);
 #define HAS_HASHDJB2_SSE41
 uint32 HashDjb2_SSE41(const uint8* src, int count, uint32 seed);
 
-#ifdef VISUALC_HAS_AVX2
+#if defined(VISUALC_HAS_AVX2) || defined(CLANG_HAS_AVX2) || \
+    defined(GCC_HAS_AVX2)
 #define HAS_HASHDJB2_AVX2
 uint32 HashDjb2_AVX2(const uint8* src, int count, uint32 seed);
 #endif
@@ -79,6 +80,79 @@ uint32 HashDjb2(const uint8* src, uint64 count, uint32 seed) {
   return seed;
 }
 
+// Tiles are limited so a sum of absolute differences fits in a uint32.
+static const int kMaxTileSize = 4096;
+static const int kMinThreadedTileSize = 256 * 256;
+
+// Hashes a row of a tile, continuing from seed. The SIMD kernel is used for
+// the multiple of 16 bytes.
+static uint32 HashDjb2Row(uint32 (*HashDjb2_SIMD)(const uint8* src, int count,
+                                                  uint32 seed),
+                          const uint8* src, int count, uint32 seed) {
+  int aligned_count = count & ~15;
+  if (aligned_count) {
+    seed = HashDjb2_SIMD(src, aligned_count, seed);
+  }
+  if (count & 15) {
+    seed = HashDjb2_C(src + aligned_count, count & 15, seed);
+  }
+  return seed;
+}
+
+// Compute a hash for each tile of a plane.
+LIBYUV_API
+int ComputeTileHashes(const uint8* src, int stride,
+                      int width, int height, int tile_size,
+                      uint32* dst_hashes) {
+  int tiles_x;
+  int tiles_y;
+  int ty;
+  uint32 (*HashDjb2_SIMD)(const uint8* src, int count, uint32 seed) =
+      HashDjb2_C;
+  if (!src || !dst_hashes || width <= 0 || height <= 0 ||
+      tile_size <= 0 || tile_size > kMaxTileSize) {
+    return -1;
+  }
+#if defined(HAS_HASHDJB2_SSE41)
+  if (TestCpuFlag(kCpuHasSSE41)) {
+    HashDjb2_SIMD = HashDjb2_SSE41;
+  }
+#endif
+#if defined(HAS_HASHDJB2_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2)) {
+    HashDjb2_SIMD = HashDjb2_AVX2;
+  }
+#endif
+  tiles_x = (width + tile_size - 1) / tile_size;
+  tiles_y = (height + tile_size - 1) / tile_size;
+
+  // Each row of tiles is hashed a row of pixels at a time, so the source is
+  // read in order.
+#ifdef _OPENMP
+#pragma omp parallel for if (width * height >= kMinThreadedTileSize)
+#endif
+  for (ty = 0; ty < tiles_y; ++ty) {
+    uint32* hashes = dst_hashes + ty * tiles_x;
+    int y = ty * tile_size;
+    int tile_height = height - y < tile_size ? height - y : tile_size;
+    int tx;
+    int j;
+    for (tx = 0; tx < tiles_x; ++tx) {
+      hashes[tx] = 5381;
+    }
+    for (j = 0; j < tile_height; ++j) {
+      const uint8* row = src + (y + j) * stride;
+      for (tx = 0; tx < tiles_x; ++tx) {
+        int x = tx * tile_size;
+        int tile_width = width - x < tile_size ? width - x : tile_size;
+        hashes[tx] = HashDjb2Row(HashDjb2_SIMD, row + x, tile_width,
+                                 hashes[tx]);
+      }
+    }
+  }
+  return 0;
+}
+
 static uint32 ARGBDetectRow_C(const uint8* argb, int width) {
   int x;
   for (x = 0; x < width - 1; x += 2) {
@@ -215,6 +289,84 @@ uint64 ComputeSumSquareErrorPlane(const uint8* src_a, int stride_a,
   return sse;
 }
 
+uint32 SumAbsoluteDifference_C(const uint8* src_a, const uint8* src_b,
+                               int count);
+#if !defined(LIBYUV_DISABLE_X86) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_SUMABSOLUTEDIFFERENCE_SSE2
+uint32 SumAbsoluteDifference_SSE2(const uint8* src_a, const uint8* src_b,
+                                  int count);
+#if defined(CLANG_HAS_AVX2) || defined(GCC_HAS_AVX2)
+#define HAS_SUMABSOLUTEDIFFERENCE_AVX2
+uint32 SumAbsoluteDifference_AVX2(const uint8* src_a, const uint8* src_b,
+                                  int count);
+#endif
+#endif
+
+// Sum of absolute differences of each tile of 2 planes.
+LIBYUV_API
+int ComputeTileSAD(const uint8* src_a, int stride_a,
+                   const uint8* src_b, int stride_b,
+                   int width, int height, int tile_size,
+                   uint32* dst_sad) {
+  int tiles_x;
+  int tiles_y;
+  int ty;
+  int mask = 0;
+  uint32 (*SumAbsoluteDifference)(const uint8* src_a, const uint8* src_b,
+                                  int count) = SumAbsoluteDifference_C;
+  if (!src_a || !src_b || !dst_sad || width <= 0 || height <= 0 ||
+      tile_size <= 0 || tile_size > kMaxTileSize) {
+    return -1;
+  }
+#if defined(HAS_SUMABSOLUTEDIFFERENCE_SSE2)
+  if (TestCpuFlag(kCpuHasSSE2)) {
+    SumAbsoluteDifference = SumAbsoluteDifference_SSE2;
+    mask = 15;
+  }
+#endif
+#if defined(HAS_SUMABSOLUTEDIFFERENCE_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2)) {
+    SumAbsoluteDifference = SumAbsoluteDifference_AVX2;
+    mask = 31;
+  }
+#endif
+  tiles_x = (width + tile_size - 1) / tile_size;
+  tiles_y = (height + tile_size - 1) / tile_size;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (width * height >= kMinThreadedTileSize)
+#endif
+  for (ty = 0; ty < tiles_y; ++ty) {
+    uint32* sad = dst_sad + ty * tiles_x;
+    int y = ty * tile_size;
+    int tile_height = height - y < tile_size ? height - y : tile_size;
+    int tx;
+    int j;
+    for (tx = 0; tx < tiles_x; ++tx) {
+      sad[tx] = 0u;
+    }
+    for (j = 0; j < tile_height; ++j) {
+      const uint8* row_a = src_a + (y + j) * stride_a;
+      const uint8* row_b = src_b + (y + j) * stride_b;
+      for (tx = 0; tx < tiles_x; ++tx) {
+        int x = tx * tile_size;
+        int tile_width = width - x < tile_size ? width - x : tile_size;
+        int aligned_width = tile_width & ~mask;
+        if (aligned_width) {
+          sad[tx] += SumAbsoluteDifference(row_a + x, row_b + x,
+                                           aligned_width);
+        }
+        if (tile_width > aligned_width) {
+          sad[tx] += SumAbsoluteDifference_C(row_a + x + aligned_width,
+                                             row_b + x + aligned_width,
+                                             tile_width - aligned_width);
+        }
+      }
+    }
+  }
+  return 0;
+}
+
 LIBYUV_API
 double SumSquareErrorToPsnr(uint64 sse, uint64 count) {
   double psnr;
@@ -25,6 +25,17 @@ uint32 SumSquareError_C(const uint8* src_a, const uint8* src_b, int count) {
   return sse;
 }
 
+uint32 SumAbsoluteDifference_C(const uint8* src_a, const uint8* src_b,
+                               int count) {
+  uint32 sad = 0u;
+  int i;
+  for (i = 0; i < count; ++i) {
+    int diff = src_a[i] - src_b[i];
+    sad += (uint32)(diff < 0 ? -diff : diff);
+  }
+  return sad;
+}
+
 // hash seed of 5381 recommended.
 // Internal C version of HashDjb2 with int sized count for efficiency.
 uint32 HashDjb2_C(const uint8* src, int count, uint32 seed) {
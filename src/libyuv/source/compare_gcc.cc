@@ -145,6 +145,191 @@ uint32 HashDjb2_SSE41(const uint8* src, int count, uint32 seed) {
 }
 #endif  // defined(__x86_64__) || (defined(__i386__) && !defined(__pic__)))
 
+#if !defined(LIBYUV_DISABLE_X86) && \
+    (defined(__x86_64__) || (defined(__i386__) && !defined(__pic__))) && \
+    (defined(CLANG_HAS_AVX2) || defined(GCC_HAS_AVX2))
+#define HAS_HASHDJB2_AVX2
+static uvec32 kHash32x33 = { 0x1137c401, 0, 0, 0 };  // 33 ^ 32
+static ulvec32 kHashMul32_0 = {
+  0x655ec7e1,  // 33 ^ 31
+  0xccc4cfc1,  // 33 ^ 30
+  0x99995ba1,  // 33 ^ 29
+  0xd61beb81,  // 33 ^ 28
+  0x829bff61,  // 33 ^ 27
+  0x13791741,  // 33 ^ 26
+  0x2f22b321,  // 33 ^ 25
+  0xac185301,  // 33 ^ 24
+};
+static ulvec32 kHashMul32_1 = {
+  0xcee976e1,  // 33 ^ 23
+  0xc8359ec1,  // 33 ^ 22
+  0x72ac4aa1,  // 33 ^ 21
+  0x510cfa81,  // 33 ^ 20
+  0xcc272e61,  // 33 ^ 19
+  0xb0da6641,  // 33 ^ 18
+  0xee162221,  // 33 ^ 17
+  0x92d9e201,  // 33 ^ 16
+};
+static ulvec32 kHashMul32_2 = {
+  0x0c3525e1,  // 33 ^ 15
+  0xa3476dc1,  // 33 ^ 14
+  0x3b4039a1,  // 33 ^ 13
+  0x4f5f0981,  // 33 ^ 12
+  0x30f35d61,  // 33 ^ 11
+  0x855cb541,  // 33 ^ 10
+  0x040a9121,  // 33 ^ 9
+  0x747c7101,  // 33 ^ 8
+};
+static ulvec32 kHashMul32_3 = {
+  0xec41d4e1,  // 33 ^ 7
+  0x4cfa3cc1,  // 33 ^ 6
+  0x025528a1,  // 33 ^ 5
+  0x00121881,  // 33 ^ 4
+  0x00008c61,  // 33 ^ 3
+  0x00000441,  // 33 ^ 2
+  0x00000021,  // 33 ^ 1
+  0x00000001,  // 33 ^ 0
+};
+static uvec32 kHash16x33_AVX2 = { 0x92d9e201, 0, 0, 0 };  // 33 ^ 16
+
+// Hashes 32 bytes per loop, with 16 bytes at the end if count is an odd
+// multiple of 16. Only the first lane of xmm0 holds the hash; the others are
+// cleared by the next multiply.
+uint32 HashDjb2_AVX2(const uint8* src, int count, uint32 seed) {
+  uint32 hash;
+  asm volatile (  // NOLINT
+    "vmovd     %2,%%xmm0                       \n"
+    "sub       $0x20,%1                        \n"
+    "jl        49f                             \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "vpmovzxbd " MEMACCESS(0) ",%%ymm1         \n"
+    "vpmovzxbd " MEMACCESS2(0x8,0) ",%%ymm2    \n"
+    "vpmovzxbd " MEMACCESS2(0x10,0) ",%%ymm3   \n"
+    "vpmovzxbd " MEMACCESS2(0x18,0) ",%%ymm4   \n"
+    "lea       " MEMLEA(0x20,0) ",%0           \n"
+    "vpmulld   %4,%%xmm0,%%xmm0                \n"
+    "vpmulld   %5,%%ymm1,%%ymm1                \n"
+    "vpmulld   %6,%%ymm2,%%ymm2                \n"
+    "vpmulld   %7,%%ymm3,%%ymm3                \n"
+    "vpmulld   %8,%%ymm4,%%ymm4                \n"
+    "vpaddd    %%ymm2,%%ymm1,%%ymm1            \n"
+    "vpaddd    %%ymm4,%%ymm3,%%ymm3            \n"
+    "vpaddd    %%ymm3,%%ymm1,%%ymm1            \n"
+    "vextracti128 $0x1,%%ymm1,%%xmm2           \n"
+    "vpaddd    %%xmm2,%%xmm1,%%xmm1            \n"
+    "vpshufd   $0xe,%%xmm1,%%xmm2              \n"
+    "vpaddd    %%xmm2,%%xmm1,%%xmm1            \n"
+    "vpshufd   $0x1,%%xmm1,%%xmm2              \n"
+    "vpaddd    %%xmm2,%%xmm1,%%xmm1            \n"
+    "vpaddd    %%xmm1,%%xmm0,%%xmm0            \n"
+    "sub       $0x20,%1                        \n"
+    "jge       1b                              \n"
+
+  "49:                                         \n"
+    "add       $0x20,%1                        \n"
+    "jle       99f                             \n"
+    "vpmovzxbd " MEMACCESS(0) ",%%ymm3         \n"
+    "vpmovzxbd " MEMACCESS2(0x8,0) ",%%ymm4    \n"
+    "vpmulld   %9,%%xmm0,%%xmm0                \n"
+    "vpmulld   %7,%%ymm3,%%ymm3                \n"
+    "vpmulld   %8,%%ymm4,%%ymm4                \n"
+    "vpaddd    %%ymm4,%%ymm3,%%ymm1            \n"
+    "vextracti128 $0x1,%%ymm1,%%xmm2           \n"
+    "vpaddd    %%xmm2,%%xmm1,%%xmm1            \n"
+    "vpshufd   $0xe,%%xmm1,%%xmm2              \n"
+    "vpaddd    %%xmm2,%%xmm1,%%xmm1            \n"
+    "vpshufd   $0x1,%%xmm1,%%xmm2              \n"
+    "vpaddd    %%xmm2,%%xmm1,%%xmm1            \n"
+    "vpaddd    %%xmm1,%%xmm0,%%xmm0            \n"
+
+  "99:                                         \n"
+    "vmovd     %%xmm0,%3                       \n"
+    "vzeroupper                                \n"
+  : "+r"(src),            // %0
+    "+r"(count),          // %1
+    "+rm"(seed),          // %2
+    "=g"(hash)            // %3
+  : "m"(kHash32x33),      // %4
+    "m"(kHashMul32_0),    // %5
+    "m"(kHashMul32_1),    // %6
+    "m"(kHashMul32_2),    // %7
+    "m"(kHashMul32_3),    // %8
+    "m"(kHash16x33_AVX2)  // %9
+  : "memory", "cc"
+    , "xmm0", "xmm1", "xmm2", "xmm3", "xmm4"
+  );  // NOLINT
+  return hash;
+}
+#endif  // HAS_HASHDJB2_AVX2
+
+#if !defined(LIBYUV_DISABLE_X86) && (defined(__x86_64__) || defined(__i386__))
+// Sums absolute differences of 16 bytes at a time with psadbw.
+uint32 SumAbsoluteDifference_SSE2(const uint8* src_a, const uint8* src_b,
+                                  int count) {
+  uint32 sad;
+  asm volatile (  // NOLINT
+    "pxor      %%xmm0,%%xmm0                   \n"
+    LABELALIGN
+  "1:                                          \n"
+    "movdqu    " MEMACCESS(0) ",%%xmm1         \n"
+    "lea       " MEMLEA(0x10, 0) ",%0          \n"
+    "movdqu    " MEMACCESS(1) ",%%xmm2         \n"
+    "lea       " MEMLEA(0x10, 1) ",%1          \n"
+    "psadbw    %%xmm2,%%xmm1                   \n"
+    "paddd     %%xmm1,%%xmm0                   \n"
+    "sub       $0x10,%2                        \n"
+    "jg        1b                              \n"
+
+    "pshufd    $0xee,%%xmm0,%%xmm1             \n"
+    "paddd     %%xmm1,%%xmm0                   \n"
+    "movd      %%xmm0,%3                       \n"
+
+  : "+r"(src_a),      // %0
+    "+r"(src_b),      // %1
+    "+r"(count),      // %2
+    "=g"(sad)         // %3
+  :: "memory", "cc", "xmm0", "xmm1", "xmm2"
+  );  // NOLINT
+  return sad;
+}
+
+#if defined(CLANG_HAS_AVX2) || defined(GCC_HAS_AVX2)
+// Sums absolute differences of 32 bytes at a time with vpsadbw.
+uint32 SumAbsoluteDifference_AVX2(const uint8* src_a, const uint8* src_b,
+                                  int count) {
+  uint32 sad;
+  asm volatile (  // NOLINT
+    "vpxor     %%ymm0,%%ymm0,%%ymm0            \n"
+    LABELALIGN
+  "1:                                          \n"
+    "vmovdqu   " MEMACCESS(0) ",%%ymm1         \n"
+    "lea       " MEMLEA(0x20, 0) ",%0          \n"
+    "vpsadbw   " MEMACCESS(1) ",%%ymm1,%%ymm1  \n"
+    "lea       " MEMLEA(0x20, 1) ",%1          \n"
+    "vpaddd    %%ymm1,%%ymm0,%%ymm0            \n"
+    "sub       $0x20,%2                        \n"
+    "jg        1b                              \n"
+
+    "vextracti128 $0x1,%%ymm0,%%xmm1           \n"
+    "vpaddd    %%xmm1,%%xmm0,%%xmm0            \n"
+    "vpshufd   $0xee,%%xmm0,%%xmm1             \n"
+    "vpaddd    %%xmm1,%%xmm0,%%xmm0            \n"
+    "vmovd     %%xmm0,%3                       \n"
+    "vzeroupper                                \n"
+
+  : "+r"(src_a),      // %0
+    "+r"(src_b),      // %1
+    "+r"(count),      // %2
+    "=g"(sad)         // %3
+  :: "memory", "cc", "xmm0", "xmm1"
+  );  // NOLINT
+  return sad;
+}
+#endif  // defined(CLANG_HAS_AVX2) || defined(GCC_HAS_AVX2)
+#endif  // defined(__x86_64__) || defined(__i386__)
+
 #ifdef __cplusplus
 }  // extern "C"
 }  // namespace libyuv
@@ -13,6 +13,12 @@
 #ifdef HAVE_JPEG
 #include "libyuv/mjpeg_decoder.h"
 #endif
+#include "libyuv/row.h"
+#include "libyuv/scale.h"  // For I420Scale()
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifdef __cplusplus
 namespace libyuv {
@@ -119,6 +125,41 @@ static void JpegI400ToI420(void* opaque,
   dest->h -= rows;
 }
 
+// Number of restart bands to decode concurrently.
+static int GetMaxRestartBands() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// Decodes to I420, in concurrent bands when the frame has restart markers
+// and is not cropped.
+static LIBYUV_BOOL JpegDecodeI420Bands(MJpegDecoder* mjpeg_decoder,
+                                       MJpegDecoder::CallbackFunction fn,
+                                       const I420Buffers* bufs) {
+  I420Buffers band_bufs[kMaxRestartBands];
+  void* opaques[kMaxRestartBands];
+  int num_bands = 1;
+  if (bufs->w == mjpeg_decoder->GetScaledWidth() &&
+      bufs->h == mjpeg_decoder->GetScaledHeight()) {
+    num_bands = mjpeg_decoder->SplitRestartBands(GetMaxRestartBands());
+  }
+  for (int band = 0; band < num_bands; ++band) {
+    int start = mjpeg_decoder->GetBandStartRow(band);
+    int end = band + 1 < num_bands ?
+        mjpeg_decoder->GetBandStartRow(band + 1) : bufs->h;
+    band_bufs[band] = *bufs;
+    band_bufs[band].y += start * bufs->y_stride;
+    band_bufs[band].u += (start >> 1) * bufs->u_stride;
+    band_bufs[band].v += (start >> 1) * bufs->v_stride;
+    band_bufs[band].h = end - start;
+    opaques[band] = &band_bufs[band];
+  }
+  return mjpeg_decoder->DecodeBandsToCallback(fn, opaques, bufs->w, bufs->h);
+}
+
 // Query size of MJPG in pixels.
 LIBYUV_API
 int MJPGSize(const uint8* sample, size_t sample_size,
@@ -169,7 +210,7 @@ int MJPGToI420(const uint8* sample,
         mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
         mjpeg_decoder.GetVertSampFactor(2) == 1 &&
         mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegCopyI420, &bufs, dw, dh);
+      ret = JpegDecodeI420Bands(&mjpeg_decoder, &JpegCopyI420, &bufs);
     // YUV422
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceYCbCr &&
@@ -180,7 +221,7 @@ int MJPGToI420(const uint8* sample,
                mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
                mjpeg_decoder.GetVertSampFactor(2) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI422ToI420, &bufs, dw, dh);
+      ret = JpegDecodeI420Bands(&mjpeg_decoder, &JpegI422ToI420, &bufs);
     // YUV444
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceYCbCr &&
@@ -191,7 +232,7 @@ int MJPGToI420(const uint8* sample,
                mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
                mjpeg_decoder.GetVertSampFactor(2) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI444ToI420, &bufs, dw, dh);
+      ret = JpegDecodeI420Bands(&mjpeg_decoder, &JpegI444ToI420, &bufs);
     // YUV411
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceYCbCr &&
@@ -202,14 +243,14 @@ int MJPGToI420(const uint8* sample,
                mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
                mjpeg_decoder.GetVertSampFactor(2) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI411ToI420, &bufs, dw, dh);
+      ret = JpegDecodeI420Bands(&mjpeg_decoder, &JpegI411ToI420, &bufs);
     // YUV400
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceGrayscale &&
                mjpeg_decoder.GetNumComponents() == 1 &&
                mjpeg_decoder.GetVertSampFactor(0) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(0) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI400ToI420, &bufs, dw, dh);
+      ret = JpegDecodeI420Bands(&mjpeg_decoder, &JpegI400ToI420, &bufs);
     } else {
       // TODO(fbarchard): Implement conversion for any other colorspace/sample
       // factors that occur in practice. 411 is supported by libjpeg
@@ -221,6 +262,120 @@ int MJPGToI420(const uint8* sample,
   return ret ? 0 : 1;
 }
 
+// Returns the I420 conversion for the decoded, possibly DCT scaled, layout.
+static MJpegDecoder::CallbackFunction GetJpegI420Callback(
+    MJpegDecoder* mjpeg_decoder) {
+  if (mjpeg_decoder->GetColorSpace() == MJpegDecoder::kColorSpaceGrayscale &&
+      mjpeg_decoder->GetNumComponents() == 1 &&
+      mjpeg_decoder->GetHorizSubSampFactor(0) == 1 &&
+      mjpeg_decoder->GetVertSubSampFactor(0) == 1) {
+    return &JpegI400ToI420;
+  }
+  if (mjpeg_decoder->GetColorSpace() != MJpegDecoder::kColorSpaceYCbCr ||
+      mjpeg_decoder->GetNumComponents() != 3 ||
+      mjpeg_decoder->GetHorizSubSampFactor(0) != 1 ||
+      mjpeg_decoder->GetVertSubSampFactor(0) != 1 ||
+      mjpeg_decoder->GetHorizSubSampFactor(1) !=
+          mjpeg_decoder->GetHorizSubSampFactor(2) ||
+      mjpeg_decoder->GetVertSubSampFactor(1) !=
+          mjpeg_decoder->GetVertSubSampFactor(2)) {
+    return NULL;
+  }
+  int hs = mjpeg_decoder->GetHorizSubSampFactor(1);
+  int vs = mjpeg_decoder->GetVertSubSampFactor(1);
+  if (hs == 2 && vs == 2) {
+    return &JpegCopyI420;
+  } else if (hs == 2 && vs == 1) {
+    return &JpegI422ToI420;
+  } else if (hs == 1 && vs == 1) {
+    return &JpegI444ToI420;
+  } else if (hs == 4 && vs == 1) {
+    return &JpegI411ToI420;
+  }
+  return NULL;
+}
+
+// MJPG (Motion JPeg) to I420 at a different size. The frame is decoded at
+// the smallest libjpeg DCT scale (1/1, 1/2, 1/4 or 1/8) that is at least
+// dw x dh, which skips most of the IDCT work, then scaled to dw x dh.
+LIBYUV_API
+int MJPGToI420Scaled(const uint8* sample,
+                     size_t sample_size,
+                     uint8* y, int y_stride,
+                     uint8* u, int u_stride,
+                     uint8* v, int v_stride,
+                     int w, int h,
+                     int dw, int dh,
+                     enum FilterMode filtering) {
+  if (sample_size == kUnknownDataSize) {
+    // ERROR: MJPEG frame size unknown
+    return -1;
+  }
+  if (dw <= 0 || dh <= 0) {
+    return -1;
+  }
+
+  MJpegDecoder mjpeg_decoder;
+  LIBYUV_BOOL ret = mjpeg_decoder.LoadFrame(sample, sample_size);
+  if (ret && (mjpeg_decoder.GetWidth() != w ||
+              mjpeg_decoder.GetHeight() != h)) {
+    // ERROR: MJPEG frame has unexpected dimensions
+    mjpeg_decoder.UnloadFrame();
+    return 1;  // runtime failure
+  }
+  if (!ret) {
+    mjpeg_decoder.UnloadFrame();
+    return 1;
+  }
+  // The I420 conversions expect an even number of rows per iMCU row, which
+  // rules out 1/8 for frames without vertical chroma subsampling.
+  int scale_denom = 8;
+  for (; scale_denom > 1; scale_denom >>= 1) {
+    if (mjpeg_decoder.SetScaleDenom(scale_denom) &&
+        mjpeg_decoder.GetScaledWidth() >= dw &&
+        mjpeg_decoder.GetScaledHeight() >= dh &&
+        (mjpeg_decoder.GetImageScanlinesPerImcuRow() & 1) == 0) {
+      break;
+    }
+  }
+  if (scale_denom == 1) {
+    mjpeg_decoder.SetScaleDenom(1);
+  }
+  MJpegDecoder::CallbackFunction fn = GetJpegI420Callback(&mjpeg_decoder);
+  if (!fn) {
+    // ERROR: Unable to convert MJPEG frame because format is not supported
+    mjpeg_decoder.UnloadFrame();
+    return 1;
+  }
+  int sw = mjpeg_decoder.GetScaledWidth();
+  int sh = mjpeg_decoder.GetScaledHeight();
+  if (sw == dw && sh == dh) {
+    I420Buffers bufs = { y, y_stride, u, u_stride, v, v_stride, dw, dh };
+    ret = JpegDecodeI420Bands(&mjpeg_decoder, fn, &bufs);
+    mjpeg_decoder.UnloadFrame();
+    return ret ? 0 : 1;
+  }
+
+  int halfwidth = (sw + 1) >> 1;
+  int halfheight = (sh + 1) >> 1;
+  align_buffer_64(scaled, sw * sh + halfwidth * halfheight * 2);
+  uint8* scaled_y = scaled;
+  uint8* scaled_u = scaled_y + sw * sh;
+  uint8* scaled_v = scaled_u + halfwidth * halfheight;
+  I420Buffers bufs = { scaled_y, sw, scaled_u, halfwidth,
+                       scaled_v, halfwidth, sw, sh };
+  ret = JpegDecodeI420Bands(&mjpeg_decoder, fn, &bufs);
+  if (ret) {
+    ret = I420Scale(scaled_y, sw, scaled_u, halfwidth, scaled_v, halfwidth,
+                    sw, sh,
+                    y, y_stride, u, u_stride, v, v_stride,
+                    dw, dh, filtering) == 0;
+  }
+  free_aligned_buffer_64(scaled);
+  mjpeg_decoder.UnloadFrame();
+  return ret ? 0 : 1;
+}
+
 #ifdef HAVE_JPEG
 struct ARGBBuffers {
   uint8* argb;
@@ -297,6 +452,30 @@ static void JpegI400ToARGB(void* opaque,
   dest->h -= rows;
 }
 
+// Decodes to ARGB, in concurrent bands when the frame has restart markers
+// and is not cropped.
+static LIBYUV_BOOL JpegDecodeARGBBands(MJpegDecoder* mjpeg_decoder,
+                                       MJpegDecoder::CallbackFunction fn,
+                                       const ARGBBuffers* bufs) {
+  ARGBBuffers band_bufs[kMaxRestartBands];
+  void* opaques[kMaxRestartBands];
+  int num_bands = 1;
+  if (bufs->w == mjpeg_decoder->GetScaledWidth() &&
+      bufs->h == mjpeg_decoder->GetScaledHeight()) {
+    num_bands = mjpeg_decoder->SplitRestartBands(GetMaxRestartBands());
+  }
+  for (int band = 0; band < num_bands; ++band) {
+    int start = mjpeg_decoder->GetBandStartRow(band);
+    int end = band + 1 < num_bands ?
+        mjpeg_decoder->GetBandStartRow(band + 1) : bufs->h;
+    band_bufs[band] = *bufs;
+    band_bufs[band].argb += start * bufs->argb_stride;
+    band_bufs[band].h = end - start;
+    opaques[band] = &band_bufs[band];
+  }
+  return mjpeg_decoder->DecodeBandsToCallback(fn, opaques, bufs->w, bufs->h);
+}
+
 // MJPG (Motion JPeg) to ARGB
 // TODO(fbarchard): review w and h requirement. dw and dh may be enough.
 LIBYUV_API
@@ -331,7 +510,7 @@ int MJPGToARGB(const uint8* sample,
         mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
         mjpeg_decoder.GetVertSampFactor(2) == 1 &&
         mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI420ToARGB, &bufs, dw, dh);
+      ret = JpegDecodeARGBBands(&mjpeg_decoder, &JpegI420ToARGB, &bufs);
     // YUV422
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceYCbCr &&
@@ -342,7 +521,7 @@ int MJPGToARGB(const uint8* sample,
                mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
                mjpeg_decoder.GetVertSampFactor(2) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI422ToARGB, &bufs, dw, dh);
+      ret = JpegDecodeARGBBands(&mjpeg_decoder, &JpegI422ToARGB, &bufs);
     // YUV444
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceYCbCr &&
@@ -353,7 +532,7 @@ int MJPGToARGB(const uint8* sample,
                mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
                mjpeg_decoder.GetVertSampFactor(2) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI444ToARGB, &bufs, dw, dh);
+      ret = JpegDecodeARGBBands(&mjpeg_decoder, &JpegI444ToARGB, &bufs);
     // YUV411
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceYCbCr &&
@@ -364,14 +543,14 @@ int MJPGToARGB(const uint8* sample,
                mjpeg_decoder.GetHorizSampFactor(1) == 1 &&
                mjpeg_decoder.GetVertSampFactor(2) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(2) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI411ToARGB, &bufs, dw, dh);
+      ret = JpegDecodeARGBBands(&mjpeg_decoder, &JpegI411ToARGB, &bufs);
     // YUV400
     } else if (mjpeg_decoder.GetColorSpace() ==
                    MJpegDecoder::kColorSpaceGrayscale &&
                mjpeg_decoder.GetNumComponents() == 1 &&
                mjpeg_decoder.GetVertSampFactor(0) == 1 &&
                mjpeg_decoder.GetHorizSampFactor(0) == 1) {
-      ret = mjpeg_decoder.DecodeToCallback(&JpegI400ToARGB, &bufs, dw, dh);
+      ret = JpegDecodeARGBBands(&mjpeg_decoder, &JpegI400ToARGB, &bufs);
     } else {
       // TODO(fbarchard): Implement conversion for any other colorspace/sample
       // factors that occur in practice. 411 is supported by libjpeg
@@ -12,6 +12,7 @@
 
 #ifdef HAVE_JPEG
 #include <assert.h>
+#include <string.h>  // For memchr and memcpy.
 
 #if !defined(__pnacl__) && !defined(__CLR_VER) && \
     !defined(COVERAGE_ENABLED) && !defined(TARGET_IPHONE_SIMULATOR)
@@ -70,7 +71,11 @@ MJpegDecoder::MJpegDecoder()
       scanlines_(NULL),
       scanlines_sizes_(NULL),
       databuf_(NULL),
-      databuf_strides_(NULL) {
+      databuf_strides_(NULL),
+      scale_denom_(1),
+      num_bands_(1),
+      header_size_(0),
+      sof_offset_(0) {
   decompress_struct_ = new jpeg_decompress_struct;
   source_mgr_ = new jpeg_source_mgr;
 #ifdef HAVE_SETJMP
@@ -89,6 +94,7 @@ MJpegDecoder::MJpegDecoder()
   decompress_struct_->src = source_mgr_;
   buf_vec_.buffers = &buf_;
   buf_vec_.len = 1;
+  band_start_rows_[0] = 0;
 }
 
 MJpegDecoder::~MJpegDecoder() {
@@ -121,12 +127,22 @@ LIBYUV_BOOL MJpegDecoder::LoadFrame(const uint8* src, size_t src_len) {
     // ERROR: Bad MJPEG header
     return LIBYUV_FALSE;
   }
+  scale_denom_ = 1;
+  num_bands_ = 1;
+  band_start_rows_[0] = 0;
   AllocOutputBuffers(GetNumComponents());
+  AllocScanlineBuffers();
+  return LIBYUV_TRUE;
+}
+
+void MJpegDecoder::AllocScanlineBuffers() {
   for (int i = 0; i < num_outbufs_; ++i) {
     int scanlines_size = GetComponentScanlinesPerImcuRow(i);
-    if (scanlines_sizes_[i] != scanlines_size) {
+    // DCT scaling changes the number of scanlines with the same stride.
+    LIBYUV_BOOL resize = scanlines_sizes_[i] != scanlines_size;
+    if (resize) {
       if (scanlines_[i]) {
-        delete scanlines_[i];
+        delete [] scanlines_[i];
       }
       scanlines_[i] = new uint8* [scanlines_size];
       scanlines_sizes_[i] = scanlines_size;
@@ -140,9 +156,9 @@ LIBYUV_BOOL MJpegDecoder::LoadFrame(const uint8* src, size_t src_len) {
     // next scanline.
     int databuf_stride = GetComponentStride(i);
     int databuf_size = scanlines_size * databuf_stride;
-    if (databuf_strides_[i] != databuf_stride) {
+    if (databuf_strides_[i] != databuf_stride || resize) {
       if (databuf_[i]) {
-        delete databuf_[i];
+        delete [] databuf_[i];
       }
       databuf_[i] = new uint8[databuf_size];
       databuf_strides_[i] = databuf_stride;
@@ -152,6 +168,31 @@ LIBYUV_BOOL MJpegDecoder::LoadFrame(const uint8* src, size_t src_len) {
       has_scanline_padding_ = LIBYUV_TRUE;
     }
   }
+}
+
+LIBYUV_BOOL MJpegDecoder::SetScaleDenom(int scale_denom) {
+  if (scale_denom != 1 && scale_denom != 2 &&
+      scale_denom != 4 && scale_denom != 8) {
+    // ERROR: libjpeg only scales by 1/1, 1/2, 1/4 and 1/8
+    return LIBYUV_FALSE;
+  }
+#ifdef HAVE_SETJMP
+  if (setjmp(error_mgr_->setjmp_buffer)) {
+    // We called jpeg_calc_output_dimensions, it experienced an error, and we
+    // called longjmp() and rewound the stack to here. Return error.
+    return LIBYUV_FALSE;
+  }
+#endif
+  decompress_struct_->raw_data_out = TRUE;
+  decompress_struct_->scale_num = 1;
+  decompress_struct_->scale_denom = scale_denom;
+  // Fills in the per component DCT scaled sizes. libjpeg may decode chroma
+  // at a larger DCT size than luma, so the scaled subsampling can differ
+  // from the one in the frame header.
+  jpeg_calc_output_dimensions(decompress_struct_);
+  scale_denom_ = scale_denom;
+  num_bands_ = 1;
+  AllocScanlineBuffers();
   return LIBYUV_TRUE;
 }
 
@@ -163,6 +204,24 @@ static int DivideAndRoundDown(int numerator, int denominator) {
   return numerator / denominator;
 }
 
+// Width and height of a DCT block of a component after DCT scaling.
+// libjpeg 7 and later may scale the two directions differently.
+static int GetDCTHorizScaledSize(const jpeg_component_info* comp) {
+#if JPEG_LIB_VERSION >= 70
+  return comp->DCT_h_scaled_size;
+#else
+  return comp->DCT_scaled_size;
+#endif
+}
+
+static int GetDCTVertScaledSize(const jpeg_component_info* comp) {
+#if JPEG_LIB_VERSION >= 70
+  return comp->DCT_v_scaled_size;
+#else
+  return comp->DCT_scaled_size;
+#endif
+}
+
 // Returns width of the last loaded frame.
 int MJpegDecoder::GetWidth() {
   return decompress_struct_->image_width;
@@ -173,6 +232,18 @@ int MJpegDecoder::GetHeight() {
   return decompress_struct_->image_height;
 }
 
+int MJpegDecoder::GetScaledWidth() {
+  return DivideAndRoundUp(GetWidth(), scale_denom_);
+}
+
+int MJpegDecoder::GetScaledHeight() {
+  return DivideAndRoundUp(GetHeight(), scale_denom_);
+}
+
+int MJpegDecoder::GetRestartInterval() {
+  return decompress_struct_->restart_interval;
+}
+
 // Returns format of the last loaded frame. The return value is one of the
 // kColorSpace* constants.
 int MJpegDecoder::GetColorSpace() {
@@ -193,18 +264,21 @@ int MJpegDecoder::GetVertSampFactor(int component) {
   return decompress_struct_->comp_info[component].v_samp_factor;
 }
 
+// Subsampling of the decoded component relative to the scaled image.
 int MJpegDecoder::GetHorizSubSampFactor(int component) {
-  return decompress_struct_->max_h_samp_factor /
-      GetHorizSampFactor(component);
+  return decompress_struct_->max_h_samp_factor * (DCTSIZE / scale_denom_) /
+      (GetHorizSampFactor(component) *
+       GetDCTHorizScaledSize(&decompress_struct_->comp_info[component]));
 }
 
 int MJpegDecoder::GetVertSubSampFactor(int component) {
-  return decompress_struct_->max_v_samp_factor /
-      GetVertSampFactor(component);
+  return decompress_struct_->max_v_samp_factor * (DCTSIZE / scale_denom_) /
+      (GetVertSampFactor(component) *
+       GetDCTVertScaledSize(&decompress_struct_->comp_info[component]));
 }
 
 int MJpegDecoder::GetImageScanlinesPerImcuRow() {
-  return decompress_struct_->max_v_samp_factor * DCTSIZE;
+  return decompress_struct_->max_v_samp_factor * (DCTSIZE / scale_denom_);
 }
 
 int MJpegDecoder::GetComponentScanlinesPerImcuRow(int component) {
@@ -214,12 +288,12 @@ int MJpegDecoder::GetComponentScanlinesPerImcuRow(int component) {
 
 int MJpegDecoder::GetComponentWidth(int component) {
   int hs = GetHorizSubSampFactor(component);
-  return DivideAndRoundUp(GetWidth(), hs);
+  return DivideAndRoundUp(GetScaledWidth(), hs);
 }
 
 int MJpegDecoder::GetComponentHeight(int component) {
   int vs = GetVertSubSampFactor(component);
-  return DivideAndRoundUp(GetHeight(), vs);
+  return DivideAndRoundUp(GetScaledHeight(), vs);
 }
 
 // Get width in bytes padded out to a multiple of DCTSIZE
@@ -246,8 +320,8 @@ LIBYUV_BOOL MJpegDecoder::UnloadFrame() {
 // TODO(fbarchard): Allow rectangle to be specified: x, y, width, height.
 LIBYUV_BOOL MJpegDecoder::DecodeToBuffers(
     uint8** planes, int dst_width, int dst_height) {
-  if (dst_width != GetWidth() ||
-      dst_height > GetHeight()) {
+  if (dst_width != GetScaledWidth() ||
+      dst_height > GetScaledHeight()) {
     // ERROR: Bad dimensions
     return LIBYUV_FALSE;
   }
@@ -267,7 +341,7 @@ LIBYUV_BOOL MJpegDecoder::DecodeToBuffers(
   // Compute amount of lines to skip to implement vertical crop.
   // TODO(fbarchard): Ensure skip is a multiple of maximum component
   // subsample. ie 2
-  int skip = (GetHeight() - dst_height) / 2;
+  int skip = (GetScaledHeight() - dst_height) / 2;
   if (skip > 0) {
     // There is no API to skip lines in the output data, so we read them
     // into the temp buffer.
@@ -338,8 +412,8 @@ LIBYUV_BOOL MJpegDecoder::DecodeToBuffers(
 
 LIBYUV_BOOL MJpegDecoder::DecodeToCallback(CallbackFunction fn, void* opaque,
     int dst_width, int dst_height) {
-  if (dst_width != GetWidth() ||
-      dst_height > GetHeight()) {
+  if (dst_width != GetScaledWidth() ||
+      dst_height > GetScaledHeight()) {
     // ERROR: Bad dimensions
     return LIBYUV_FALSE;
   }
@@ -357,7 +431,7 @@ LIBYUV_BOOL MJpegDecoder::DecodeToCallback(CallbackFunction fn, void* opaque,
   SetScanlinePointers(databuf_);
   int lines_left = dst_height;
   // TODO(fbarchard): Compute amount of lines to skip to implement vertical crop
-  int skip = (GetHeight() - dst_height) / 2;
+  int skip = (GetScaledHeight() - dst_height) / 2;
   if (skip > 0) {
     while (skip >= GetImageScanlinesPerImcuRow()) {
       if (!DecodeImcuRow()) {
@@ -412,6 +486,200 @@ LIBYUV_BOOL MJpegDecoder::DecodeToCallback(CallbackFunction fn, void* opaque,
   return FinishDecode();
 }
 
+// JPEG markers used to locate restart intervals.
+static const uint8 kMarkerSOF0 = 0xc0;  // Baseline DCT.
+static const uint8 kMarkerSOF1 = 0xc1;  // Extended sequential DCT.
+static const uint8 kMarkerDHT = 0xc4;
+static const uint8 kMarkerJPG = 0xc8;
+static const uint8 kMarkerSOF15 = 0xcf;
+static const uint8 kMarkerDAC = 0xcc;
+static const uint8 kMarkerRST0 = 0xd0;
+static const uint8 kMarkerRST7 = 0xd7;
+static const uint8 kMarkerSOI = 0xd8;
+static const uint8 kMarkerEOI = 0xd9;
+static const uint8 kMarkerSOS = 0xda;
+
+// Returns the offset of the next marker in the entropy coded data starting
+// at src, skipping stuffed zero bytes and fill bytes, or -1 if none is found.
+static int FindEntropyMarker(const uint8* src, int pos, int len) {
+  while (pos < len - 1) {
+    const uint8* it = static_cast<const uint8*>(
+        memchr(src + pos, 0xff, len - 1 - pos));
+    if (it == NULL) {
+      break;
+    }
+    pos = static_cast<int>(it - src);
+    if (src[pos + 1] != 0x00 && src[pos + 1] != 0xff) {
+      return pos;
+    }
+    ++pos;
+  }
+  return -1;
+}
+
+int MJpegDecoder::SplitRestartBands(int max_bands) {
+  num_bands_ = 1;
+  if (max_bands > kMaxRestartBands) {
+    max_bands = kMaxRestartBands;
+  }
+  int restart_interval = GetRestartInterval();
+  if (max_bands <= 1 || restart_interval <= 0 ||
+      decompress_struct_->progressive_mode) {
+    return num_bands_;
+  }
+  // Walk the marker segments up to the first scan.
+  const uint8* src = buf_.data;
+  const int len = buf_.len;
+  int pos = 2;  // After SOI.
+  sof_offset_ = 0;
+  header_size_ = 0;
+  while (pos + 4 <= len) {
+    if (src[pos] != 0xff) {
+      return num_bands_;
+    }
+    uint8 marker = src[pos + 1];
+    if (marker == 0xff) {  // Fill byte.
+      ++pos;
+      continue;
+    }
+    if (marker == kMarkerSOI || (marker >= kMarkerRST0 &&
+                                 marker <= kMarkerRST7)) {
+      pos += 2;
+      continue;
+    }
+    int segment_size = (src[pos + 2] << 8) | src[pos + 3];
+    if (marker == kMarkerSOF0 || marker == kMarkerSOF1) {
+      sof_offset_ = pos;
+    } else if (marker > kMarkerSOF1 && marker <= kMarkerSOF15 &&
+               marker != kMarkerDHT && marker != kMarkerJPG &&
+               marker != kMarkerDAC) {
+      // Progressive, lossless and arithmetic frames are not split.
+      return num_bands_;
+    }
+    if (marker == kMarkerSOS) {
+      // Only a single interleaved scan holding all components can be split.
+      if (pos + 4 >= len || src[pos + 4] != GetNumComponents()) {
+        return num_bands_;
+      }
+      header_size_ = pos + 2 + segment_size;
+      break;
+    }
+    pos += 2 + segment_size;
+  }
+  if (sof_offset_ == 0 || header_size_ == 0 || header_size_ >= len) {
+    return num_bands_;
+  }
+
+  // Band boundaries must fall on restart markers that start an iMCU row, and
+  // on an even scaled row so 4:2:0 chroma of each band starts on a whole row.
+  const int imcu_rows = GetImageScanlinesPerImcuRow() * scale_denom_;
+  const int mcus_per_row = DivideAndRoundUp(
+      GetWidth(), decompress_struct_->max_h_samp_factor * DCTSIZE);
+  const int total_rows = DivideAndRoundUp(GetHeight(), imcu_rows);
+  band_start_rows_[0] = 0;
+  band_begin_[0] = header_size_;
+  int num_bands = 1;
+  int num_restarts = 0;
+  pos = header_size_;
+  for (;;) {
+    pos = FindEntropyMarker(src, pos, len);
+    if (pos < 0) {
+      return num_bands_;
+    }
+    uint8 marker = src[pos + 1];
+    if (marker < kMarkerRST0 || marker > kMarkerRST7) {
+      if (marker != kMarkerEOI) {
+        // More scans follow.
+        return num_bands_;
+      }
+      break;
+    }
+    ++num_restarts;
+    int mcus = num_restarts * restart_interval;
+    int row = mcus / mcus_per_row;
+    if (num_bands < max_bands && mcus % mcus_per_row == 0 &&
+        row < total_rows &&
+        row * imcu_rows > band_start_rows_[num_bands - 1] &&
+        row >= total_rows * num_bands / max_bands &&
+        ((row * imcu_rows / scale_denom_) & 1) == 0) {
+      band_end_[num_bands - 1] = pos;
+      band_start_rows_[num_bands] = row * imcu_rows;
+      band_begin_[num_bands] = pos + 2;
+      ++num_bands;
+    }
+    pos += 2;
+  }
+  band_end_[num_bands - 1] = pos;
+  num_bands_ = num_bands;
+  return num_bands_;
+}
+
+int MJpegDecoder::GetBandStartRow(int band) {
+  return band_start_rows_[band] / scale_denom_;
+}
+
+// Copies the headers of the loaded frame with the frame height set to the
+// band height, then the band's entropy coded data with its restart markers
+// renumbered from RST0, then EOI.
+int MJpegDecoder::BuildBandFrame(int band, uint8* band_buf) {
+  int band_rows = (band + 1 < num_bands_ ? band_start_rows_[band + 1] :
+                   GetHeight()) - band_start_rows_[band];
+  int entropy_size = band_end_[band] - band_begin_[band];
+  memcpy(band_buf, buf_.data, header_size_);
+  band_buf[sof_offset_ + 5] = static_cast<uint8>(band_rows >> 8);
+  band_buf[sof_offset_ + 6] = static_cast<uint8>(band_rows);
+  uint8* entropy = band_buf + header_size_;
+  memcpy(entropy, buf_.data + band_begin_[band], entropy_size);
+  int restart = 0;
+  int pos = 0;
+  while ((pos = FindEntropyMarker(entropy, pos, entropy_size)) >= 0) {
+    entropy[pos + 1] = static_cast<uint8>(kMarkerRST0 + (restart & 7));
+    ++restart;
+    pos += 2;
+  }
+  entropy[entropy_size] = 0xff;
+  entropy[entropy_size + 1] = kMarkerEOI;
+  return header_size_ + entropy_size + 2;
+}
+
+LIBYUV_BOOL MJpegDecoder::DecodeBandsToCallback(CallbackFunction fn,
+                                                void* const* opaques,
+                                                int dst_width,
+                                                int dst_height) {
+  if (num_bands_ <= 1) {
+    return DecodeToCallback(fn, opaques[0], dst_width, dst_height);
+  }
+  if (dst_width != GetScaledWidth() ||
+      dst_height != GetScaledHeight()) {
+    // ERROR: Bad dimensions. Bands do not support cropping.
+    return LIBYUV_FALSE;
+  }
+  int failed = 0;
+  const int num_bands = num_bands_;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+:failed)
+#endif
+  for (int band = 0; band < num_bands; ++band) {
+    uint8* band_buf = new uint8[header_size_ + band_end_[band] -
+                                band_begin_[band] + 2];
+    int band_size = BuildBandFrame(band, band_buf);
+    MJpegDecoder band_decoder;
+    LIBYUV_BOOL ret = band_decoder.LoadFrame(band_buf, band_size) &&
+        band_decoder.SetScaleDenom(scale_denom_);
+    if (ret) {
+      ret = band_decoder.DecodeToCallback(fn, opaques[band],
+                                          band_decoder.GetScaledWidth(),
+                                          band_decoder.GetScaledHeight());
+    }
+    if (!ret) {
+      ++failed;
+    }
+    delete [] band_buf;
+  }
+  FinishDecode();
+  return failed == 0 ? LIBYUV_TRUE : LIBYUV_FALSE;
+}
+
 void init_source(j_decompress_ptr cinfo) {
   fill_input_buffer(cinfo);
 }
@@ -11,6 +11,9 @@
 #include "libyuv/planar_functions.h"
 
 #include <string.h>  // for memset()
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "libyuv/cpu_id.h"
 #ifdef HAVE_JPEG
@@ -1782,6 +1785,266 @@ int ARGBBlur(const uint8* src_argb, int src_stride_argb,
   return 0;
 }
 
+static const int kMaxBoxBlurRadius = 127;  // Window of 255 rows or columns.
+static const int kMaxBoxBlurPasses = 3;
+static const int kMinThreadedBoxBlurSize = 256 * 256;
+// Each band warms up its sums on rows above it, so bands should not be short.
+static const int kMinBoxBlurBandRows = 32;
+
+// One vertical pass of a box blur. Rows enter the window at hi and leave it
+// at lo. sum_hi and sum_lo total every row that has entered or left, so their
+// difference is the sum of the window.
+typedef struct {
+  uint16* sum_hi;
+  uint16* sum_lo;
+  uint8* ring;  // Rows [lo, hi) of the input to this pass.
+  int lo;
+  int hi;
+} BoxBlurPass;
+
+typedef struct {
+  const uint8* src;
+  int src_stride;
+  int width;
+  int height;
+  int bpp;
+  int radius;
+  int passes;
+  int ring_rows;
+  uint16* row_sum;  // Running sums of a row for the horizontal passes.
+  BoxBlurPass pass[kMaxBoxBlurPasses];
+  void (*BoxSumAddRow)(const uint8* src, uint16* sum, int width);
+  void (*BoxSumToAverageRow)(const uint16* sum_hi, const uint16* sum_lo,
+                             int count, uint8* dst, int width);
+} BoxBlurContext;
+
+// Averages the pixels of a row within radius of x, clipped to the row.
+static void BoxBlurPixel(const BoxBlurContext* ctx, int x, uint8* dst) {
+  int lo = x - ctx->radius;
+  int hi = x + ctx->radius + 1;
+  if (lo < 0) {
+    lo = 0;
+  }
+  if (hi > ctx->width) {
+    hi = ctx->width;
+  }
+  BoxSumToAverageRow_C(ctx->row_sum + hi * ctx->bpp,
+                       ctx->row_sum + lo * ctx->bpp,
+                       hi - lo, dst + x * ctx->bpp, ctx->bpp);
+}
+
+// Blurs a row horizontally, once per pass. src and dst may be the same.
+static void BoxBlurRowHorizontal(const BoxBlurContext* ctx,
+                                 const uint8* src, uint8* dst) {
+  const int bpp = ctx->bpp;
+  const int width = ctx->width;
+  const int radius = ctx->radius;
+  int mid_begin = radius < width ? radius : width;
+  int mid_end = width - radius;
+  int p;
+  if (mid_end < mid_begin) {
+    mid_end = mid_begin;
+  }
+  for (p = 0; p < ctx->passes; ++p) {
+    int x;
+    ComputeBoxSumRow_C(p == 0 ? src : dst, ctx->row_sum, bpp, width);
+    // Left clipped.
+    for (x = 0; x < mid_begin; ++x) {
+      BoxBlurPixel(ctx, x, dst);
+    }
+    // Middle unclipped.
+    if (mid_end > mid_begin) {
+      ctx->BoxSumToAverageRow(ctx->row_sum + (mid_begin + radius + 1) * bpp,
+                              ctx->row_sum + (mid_begin - radius) * bpp,
+                              radius * 2 + 1, dst + mid_begin * bpp,
+                              (mid_end - mid_begin) * bpp);
+    }
+    // Right clipped.
+    for (x = mid_end; x < width; ++x) {
+      BoxBlurPixel(ctx, x, dst);
+    }
+  }
+}
+
+// Writes row y of vertical pass p. Rows of a pass are requested in order, and
+// each pass requests rows from the pass before it as they enter its window.
+// The first pass reads horizontally blurred rows of the source.
+static void BoxBlurRowVertical(BoxBlurContext* ctx, int p, int y,
+                               uint8* dst) {
+  BoxBlurPass* pass = &ctx->pass[p];
+  const int row_size = ctx->width * ctx->bpp;
+  int lo = y - ctx->radius;
+  int hi = y + ctx->radius + 1;
+  if (lo < 0) {
+    lo = 0;
+  }
+  if (hi > ctx->height) {
+    hi = ctx->height;
+  }
+  if (pass->hi < 0) {  // First row of this pass.
+    pass->lo = lo;
+    pass->hi = lo;
+    memset(pass->sum_hi, 0, row_size * sizeof(pass->sum_hi[0]));
+    memset(pass->sum_lo, 0, row_size * sizeof(pass->sum_lo[0]));
+  }
+  while (pass->lo < lo) {
+    ctx->BoxSumAddRow(pass->ring + (pass->lo % ctx->ring_rows) * row_size,
+                      pass->sum_lo, row_size);
+    ++pass->lo;
+  }
+  while (pass->hi < hi) {
+    uint8* row = pass->ring + (pass->hi % ctx->ring_rows) * row_size;
+    if (p == 0) {
+      BoxBlurRowHorizontal(ctx, ctx->src + pass->hi * ctx->src_stride, row);
+    } else {
+      BoxBlurRowVertical(ctx, p - 1, pass->hi, row);
+    }
+    ctx->BoxSumAddRow(row, pass->sum_hi, row_size);
+    ++pass->hi;
+  }
+  if (hi - lo > 1) {
+    ctx->BoxSumToAverageRow(pass->sum_hi, pass->sum_lo, hi - lo, dst,
+                            row_size);
+  } else {
+    BoxSumToAverageRow_C(pass->sum_hi, pass->sum_lo, 1, dst, row_size);
+  }
+}
+
+// Blurs rows [y0, y1) with scratch of its own, so bands can run concurrently.
+static void BoxBlurBand(const BoxBlurContext* proto,
+                        uint8* dst, int dst_stride, int y0, int y1) {
+  BoxBlurContext ctx = *proto;
+  const int row_size = ctx.width * ctx.bpp;
+  const int sum_size = row_size * 2 * (int)sizeof(uint16);
+  const int pass_size = sum_size + ctx.ring_rows * row_size;
+  const int row_sum_size = (ctx.width + 1) * ctx.bpp * (int)sizeof(uint16);
+  align_buffer_64(scratch, row_sum_size + pass_size * ctx.passes);
+  int p;
+  int y;
+  ctx.row_sum = (uint16*)(scratch);
+  for (p = 0; p < ctx.passes; ++p) {
+    uint8* pass_scratch = scratch + row_sum_size + pass_size * p;
+    ctx.pass[p].sum_hi = (uint16*)(pass_scratch);
+    ctx.pass[p].sum_lo = ctx.pass[p].sum_hi + row_size;
+    ctx.pass[p].ring = pass_scratch + sum_size;
+    ctx.pass[p].lo = -1;
+    ctx.pass[p].hi = -1;
+  }
+  for (y = y0; y < y1; ++y) {
+    BoxBlurRowVertical(&ctx, ctx.passes - 1, y, dst + y * dst_stride);
+  }
+  free_aligned_buffer_64(scratch);
+}
+
+// Separable box blur that keeps 16 bit running sums instead of a table.
+// Each pass blurs horizontally and then vertically. Horizontal passes are done
+// on each source row as it is read. Each vertical pass keeps a ring of
+// radius * 2 + 1 rows. Large images are split into bands of rows that are
+// blurred concurrently.
+static void BoxBlur(const uint8* src, int src_stride,
+                    uint8* dst, int dst_stride,
+                    int width, int height, int bpp, int radius, int passes) {
+  BoxBlurContext ctx;
+  int num_bands = 1;
+  int band;
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.src = src;
+  ctx.src_stride = src_stride;
+  ctx.width = width;
+  ctx.height = height;
+  ctx.bpp = bpp;
+  ctx.radius = radius;
+  ctx.passes = passes;
+  ctx.ring_rows = radius * 2 + 1;
+  ctx.BoxSumAddRow = BoxSumAddRow_C;
+  ctx.BoxSumToAverageRow = BoxSumToAverageRow_C;
+#if defined(HAS_BOXSUMADDROW_SSE2)
+  if (TestCpuFlag(kCpuHasSSE2)) {
+    ctx.BoxSumAddRow = BoxSumAddRow_Any_SSE2;
+  }
+#endif
+#if defined(HAS_BOXSUMADDROW_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2)) {
+    ctx.BoxSumAddRow = BoxSumAddRow_Any_AVX2;
+  }
+#endif
+#if defined(HAS_BOXSUMTOAVERAGEROW_SSE2)
+  if (TestCpuFlag(kCpuHasSSE2)) {
+    ctx.BoxSumToAverageRow = BoxSumToAverageRow_Any_SSE2;
+  }
+#endif
+#if defined(HAS_BOXSUMTOAVERAGEROW_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2)) {
+    ctx.BoxSumToAverageRow = BoxSumToAverageRow_Any_AVX2;
+  }
+#endif
+
+  // Rows of the source are read after the rows above them are written, so a
+  // single band may blur in place. Bands would read each other's output.
+#ifdef _OPENMP
+  if (src != dst && width * height >= kMinThreadedBoxBlurSize) {
+    num_bands = omp_get_max_threads();
+  }
+#endif
+  if (num_bands > height / kMinBoxBlurBandRows) {
+    num_bands = height / kMinBoxBlurBandRows;
+  }
+  if (num_bands < 1) {
+    num_bands = 1;
+  }
+#ifdef _OPENMP
+#pragma omp parallel for if (num_bands > 1)
+#endif
+  for (band = 0; band < num_bands; ++band) {
+    BoxBlurBand(&ctx, dst, dst_stride,
+                height * band / num_bands, height * (band + 1) / num_bands);
+  }
+}
+
+// Blur ARGB image with a box filter applied 1 to 3 times.
+LIBYUV_API
+int ARGBBoxBlur(const uint8* src_argb, int src_stride_argb,
+                uint8* dst_argb, int dst_stride_argb,
+                int width, int height, int radius, int passes) {
+  if (!src_argb || !dst_argb || width <= 0 || height == 0 ||
+      radius <= 0 || passes < 1 || passes > kMaxBoxBlurPasses) {
+    return -1;
+  }
+  if (height < 0) {
+    height = -height;
+    src_argb = src_argb + (height - 1) * src_stride_argb;
+    src_stride_argb = -src_stride_argb;
+  }
+  if (radius > kMaxBoxBlurRadius) {
+    radius = kMaxBoxBlurRadius;
+  }
+  BoxBlur(src_argb, src_stride_argb, dst_argb, dst_stride_argb,
+          width, height, 4, radius, passes);
+  return 0;
+}
+
+// Blur a plane with a box filter applied 1 to 3 times.
+LIBYUV_API
+int BlurPlane(const uint8* src_y, int src_stride_y,
+              uint8* dst_y, int dst_stride_y,
+              int width, int height, int radius, int passes) {
+  if (!src_y || !dst_y || width <= 0 || height == 0 ||
+      radius <= 0 || passes < 1 || passes > kMaxBoxBlurPasses) {
+    return -1;
+  }
+  if (height < 0) {
+    height = -height;
+    src_y = src_y + (height - 1) * src_stride_y;
+    src_stride_y = -src_stride_y;
+  }
+  if (radius > kMaxBoxBlurRadius) {
+    radius = kMaxBoxBlurRadius;
+  }
+  BoxBlur(src_y, src_stride_y, dst_y, dst_stride_y,
+          width, height, 1, radius, passes);
+  return 0;
+}
+
 // Multiply ARGB image by a specified ARGB value.
 LIBYUV_API
 int ARGBShade(const uint8* src_argb, int src_stride_argb,
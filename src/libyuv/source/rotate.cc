@@ -766,6 +766,131 @@ static void TransposeUVWx8_SSE2(const uint8* src, int src_stride,
 #endif
 #endif
 
+#if !defined(LIBYUV_DISABLE_X86) && !defined(__native_client__) && \
+    defined(__x86_64__) && (defined(GCC_HAS_AVX2) || defined(CLANG_HAS_AVX2))
+// Transposes 16x16 blocks. Rows 0-7 are loaded into the low lanes and rows
+// 8-15 into the high lanes, so the same 3 rounds of unpacks as the SSSE3
+// version leave each destination row split across the 2 lanes.
+#define HAS_TRANSPOSE_WX16_AVX2
+static void TransposeWx16_AVX2(const uint8* src, int src_stride,
+                               uint8* dst, int dst_stride, int width) {
+  intptr_t row0;
+  intptr_t row8;
+  asm volatile (
+  ".p2align  2                                 \n"
+"1:                                            \n"
+  "mov        %0,%3                            \n"
+  "lea        (%0,%5,8),%4                     \n"
+  "vmovdqu    (%3),%%xmm0                      \n"
+  "vinserti128 $0x1,(%4),%%ymm0,%%ymm0         \n"
+  "add        %5,%3                            \n"
+  "add        %5,%4                            \n"
+  "vmovdqu    (%3),%%xmm1                      \n"
+  "vinserti128 $0x1,(%4),%%ymm1,%%ymm1         \n"
+  "add        %5,%3                            \n"
+  "add        %5,%4                            \n"
+  "vmovdqu    (%3),%%xmm2                      \n"
+  "vinserti128 $0x1,(%4),%%ymm2,%%ymm2         \n"
+  "add        %5,%3                            \n"
+  "add        %5,%4                            \n"
+  "vmovdqu    (%3),%%xmm3                      \n"
+  "vinserti128 $0x1,(%4),%%ymm3,%%ymm3         \n"
+  "add        %5,%3                            \n"
+  "add        %5,%4                            \n"
+  "vmovdqu    (%3),%%xmm4                      \n"
+  "vinserti128 $0x1,(%4),%%ymm4,%%ymm4         \n"
+  "add        %5,%3                            \n"
+  "add        %5,%4                            \n"
+  "vmovdqu    (%3),%%xmm5                      \n"
+  "vinserti128 $0x1,(%4),%%ymm5,%%ymm5         \n"
+  "add        %5,%3                            \n"
+  "add        %5,%4                            \n"
+  "vmovdqu    (%3),%%xmm6                      \n"
+  "vinserti128 $0x1,(%4),%%ymm6,%%ymm6         \n"
+  "add        %5,%3                            \n"
+  "add        %5,%4                            \n"
+  "vmovdqu    (%3),%%xmm7                      \n"
+  "vinserti128 $0x1,(%4),%%ymm7,%%ymm7         \n"
+  "lea        0x10(%0),%0                      \n"
+  // First round of bit swap: bytes.
+  "vpunpcklbw %%ymm1,%%ymm0,%%ymm8             \n"
+  "vpunpckhbw %%ymm1,%%ymm0,%%ymm9             \n"
+  "vpunpcklbw %%ymm3,%%ymm2,%%ymm10            \n"
+  "vpunpckhbw %%ymm3,%%ymm2,%%ymm11            \n"
+  "vpunpcklbw %%ymm5,%%ymm4,%%ymm12            \n"
+  "vpunpckhbw %%ymm5,%%ymm4,%%ymm13            \n"
+  "vpunpcklbw %%ymm7,%%ymm6,%%ymm14            \n"
+  "vpunpckhbw %%ymm7,%%ymm6,%%ymm15            \n"
+  // Second round of bit swap: words.
+  "vpunpcklwd %%ymm10,%%ymm8,%%ymm0            \n"
+  "vpunpckhwd %%ymm10,%%ymm8,%%ymm1            \n"
+  "vpunpcklwd %%ymm11,%%ymm9,%%ymm2            \n"
+  "vpunpckhwd %%ymm11,%%ymm9,%%ymm3            \n"
+  "vpunpcklwd %%ymm14,%%ymm12,%%ymm4           \n"
+  "vpunpckhwd %%ymm14,%%ymm12,%%ymm5           \n"
+  "vpunpcklwd %%ymm15,%%ymm13,%%ymm6           \n"
+  "vpunpckhwd %%ymm15,%%ymm13,%%ymm7           \n"
+  // Third round of bit swap: dwords.
+  "vpunpckldq %%ymm4,%%ymm0,%%ymm8             \n"
+  "vpunpckhdq %%ymm4,%%ymm0,%%ymm9             \n"
+  "vpunpckldq %%ymm5,%%ymm1,%%ymm10            \n"
+  "vpunpckhdq %%ymm5,%%ymm1,%%ymm11            \n"
+  "vpunpckldq %%ymm6,%%ymm2,%%ymm12            \n"
+  "vpunpckhdq %%ymm6,%%ymm2,%%ymm13            \n"
+  "vpunpckldq %%ymm7,%%ymm3,%%ymm14            \n"
+  "vpunpckhdq %%ymm7,%%ymm3,%%ymm15            \n"
+  // Join the lanes: each register now holds 2 rows of the destination.
+  "mov        %1,%3                            \n"
+  "vpermq     $0xd8,%%ymm8,%%ymm8              \n"
+  "vmovdqu    %%xmm8,(%3)                      \n"
+  "vextracti128 $0x1,%%ymm8,(%3,%6)            \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "vpermq     $0xd8,%%ymm9,%%ymm9              \n"
+  "vmovdqu    %%xmm9,(%3)                      \n"
+  "vextracti128 $0x1,%%ymm9,(%3,%6)            \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "vpermq     $0xd8,%%ymm10,%%ymm10            \n"
+  "vmovdqu    %%xmm10,(%3)                     \n"
+  "vextracti128 $0x1,%%ymm10,(%3,%6)           \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "vpermq     $0xd8,%%ymm11,%%ymm11            \n"
+  "vmovdqu    %%xmm11,(%3)                     \n"
+  "vextracti128 $0x1,%%ymm11,(%3,%6)           \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "vpermq     $0xd8,%%ymm12,%%ymm12            \n"
+  "vmovdqu    %%xmm12,(%3)                     \n"
+  "vextracti128 $0x1,%%ymm12,(%3,%6)           \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "vpermq     $0xd8,%%ymm13,%%ymm13            \n"
+  "vmovdqu    %%xmm13,(%3)                     \n"
+  "vextracti128 $0x1,%%ymm13,(%3,%6)           \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "vpermq     $0xd8,%%ymm14,%%ymm14            \n"
+  "vmovdqu    %%xmm14,(%3)                     \n"
+  "vextracti128 $0x1,%%ymm14,(%3,%6)           \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "vpermq     $0xd8,%%ymm15,%%ymm15            \n"
+  "vmovdqu    %%xmm15,(%3)                     \n"
+  "vextracti128 $0x1,%%ymm15,(%3,%6)           \n"
+  "lea        (%3,%6,2),%3                     \n"
+  "mov        %3,%1                            \n"
+  "sub        $0x10,%2                         \n"
+  "jg         1b                               \n"
+  "vzeroupper                                  \n"
+  : "+r"(src),    // %0
+    "+r"(dst),    // %1
+    "+r"(width),  // %2
+    "=&r"(row0),  // %3
+    "=&r"(row8)   // %4
+  : "r"((intptr_t)(src_stride)),  // %5
+    "r"((intptr_t)(dst_stride))   // %6
+  : "memory", "cc",
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+    "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13",  "xmm14",  "xmm15"
+);
+}
+#endif  // HAS_TRANSPOSE_WX16_AVX2
+
 static void TransposeWx8_C(const uint8* src, int src_stride,
                            uint8* dst, int dst_stride,
                            int width) {
@@ -796,27 +921,61 @@ static void TransposeWxH_C(const uint8* src, int src_stride,
   }
 }
 
+typedef void (*TransposeWxNFunc)(const uint8* src, int src_stride,
+                                 uint8* dst, int dst_stride, int width);
+
+// Transposes a strip of 'rows' rows. The kernel handles the columns that are
+// a multiple of (mask + 1) and C handles the rest.
+static void TransposeStrip(TransposeWxNFunc TransposeWxN, int mask, int rows,
+                           const uint8* src, int src_stride,
+                           uint8* dst, int dst_stride, int width) {
+  int aligned_width = width & ~mask;
+  if (aligned_width > 0) {
+    TransposeWxN(src, src_stride, dst, dst_stride, aligned_width);
+  }
+  if (width > aligned_width) {
+    TransposeWxH_C(src + aligned_width, src_stride,
+                   dst + aligned_width * dst_stride, dst_stride,
+                   width - aligned_width, rows);
+  }
+}
+
+// Planes are transposed in square tiles so the rows read and the rows written
+// by a tile both stay in cache. Rows of tiles are shared between threads.
+static const int kTransposeTileSize = 64;
+static const int kMinThreadedTransposeSize = 256 * 256;
+
 LIBYUV_API
 void TransposePlane(const uint8* src, int src_stride,
                     uint8* dst, int dst_stride,
                     int width, int height) {
-  int i = height;
-  void (*TransposeWx8)(const uint8* src, int src_stride,
-                       uint8* dst, int dst_stride,
-                       int width) = TransposeWx8_C;
+  int tile_rows = (height + kTransposeTileSize - 1) / kTransposeTileSize;
+  int ty;
+  TransposeWxNFunc TransposeWx8 = TransposeWx8_C;
+  TransposeWxNFunc TransposeWx16 = NULL;
+  int mask8 = 0;
+  int mask16 = 0;
 #if defined(HAS_TRANSPOSE_WX8_NEON)
   if (TestCpuFlag(kCpuHasNEON)) {
     TransposeWx8 = TransposeWx8_NEON;
   }
 #endif
 #if defined(HAS_TRANSPOSE_WX8_SSSE3)
-  if (TestCpuFlag(kCpuHasSSSE3) && IS_ALIGNED(width, 8)) {
+  if (TestCpuFlag(kCpuHasSSSE3)) {
     TransposeWx8 = TransposeWx8_SSSE3;
+    mask8 = 7;
   }
 #endif
 #if defined(HAS_TRANSPOSE_WX8_FAST_SSSE3)
-  if (TestCpuFlag(kCpuHasSSSE3) && IS_ALIGNED(width, 16)) {
+  if (TestCpuFlag(kCpuHasSSSE3)) {
     TransposeWx8 = TransposeWx8_FAST_SSSE3;
+    mask8 = 15;
+  }
+#endif
+#if defined(HAS_TRANSPOSE_WX16_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2)) {
+    TransposeWx16 = TransposeWx16_AVX2;
+    mask16 = 15;
   }
 #endif
 #if defined(HAS_TRANSPOSE_WX8_MIPS_DSPR2)
@@ -830,15 +989,44 @@ void TransposePlane(const uint8* src, int src_stride,
   }
 #endif
 
-  // Work across the source in 8x8 tiles
-  while (i >= 8) {
-    TransposeWx8(src, src_stride, dst, dst_stride, width);
-    src += 8 * src_stride;    // Go down 8 rows.
-    dst += 8;                 // Move over 8 columns.
-    i -= 8;
+#ifdef _OPENMP
+#pragma omp parallel for if (width * height >= kMinThreadedTransposeSize)
+#endif
+  for (ty = 0; ty < tile_rows; ++ty) {
+    int y = ty * kTransposeTileSize;
+    int tile_height = height - y;
+    int x;
+    if (tile_height > kTransposeTileSize) {
+      tile_height = kTransposeTileSize;
+    }
+    for (x = 0; x < width; x += kTransposeTileSize) {
+      const uint8* tile_src = src + y * src_stride + x;
+      uint8* tile_dst = dst + x * dst_stride + y;
+      int tile_width = width - x;
+      int i = tile_height;
+      if (tile_width > kTransposeTileSize) {
+        tile_width = kTransposeTileSize;
+      }
+      if (TransposeWx16) {
+        while (i >= 16) {
+          TransposeStrip(TransposeWx16, mask16, 16, tile_src, src_stride,
+                         tile_dst, dst_stride, tile_width);
+          tile_src += 16 * src_stride;  // Go down 16 rows.
+          tile_dst += 16;               // Move over 16 columns.
+          i -= 16;
+        }
+      }
+      while (i >= 8) {
+        TransposeStrip(TransposeWx8, mask8, 8, tile_src, src_stride,
+                       tile_dst, dst_stride, tile_width);
+        tile_src += 8 * src_stride;    // Go down 8 rows.
+        tile_dst += 8;                 // Move over 8 columns.
+        i -= 8;
+      }
+      TransposeWxH_C(tile_src, src_stride, tile_dst, dst_stride,
+                     tile_width, i);
+    }
   }
-
-  TransposeWxH_C(src, src_stride, dst, dst_stride, width, i);
 }
 
 LIBYUV_API
@@ -869,12 +1057,7 @@ LIBYUV_API
 void RotatePlane180(const uint8* src, int src_stride,
                     uint8* dst, int dst_stride,
                     int width, int height) {
-  // Swap first and last row and mirror the content. Uses a temporary row.
-  align_buffer_64(row, width);
-  const uint8* src_bot = src + src_stride * (height - 1);
-  uint8* dst_bot = dst + dst_stride * (height - 1);
   int half_height = (height + 1) >> 1;
-  int y;
   void (*MirrorRow)(const uint8* src, uint8* dst, int width) = MirrorRow_C;
   void (*CopyRow)(const uint8* src, uint8* dst, int width) = CopyRow_C;
 #if defined(HAS_MIRRORROW_NEON)
@@ -943,17 +1126,30 @@ void RotatePlane180(const uint8* src, int src_stride,
   }
 #endif
 
-  // Odd height will harmlessly mirror the middle row twice.
-  for (y = 0; y < half_height; ++y) {
-    MirrorRow(src, row, width);  // Mirror first row into a buffer
-    src += src_stride;
-    MirrorRow(src_bot, dst, width);  // Mirror last row into first row
-    dst += dst_stride;
-    CopyRow(row, dst_bot, width);  // Copy first mirrored row into last
-    src_bot -= src_stride;
-    dst_bot -= dst_stride;
+  // Swap first and last row and mirror the content. Each pair of rows is
+  // independent, so pairs are shared between threads, each with its own
+  // temporary row.
+#ifdef _OPENMP
+#pragma omp parallel if (width * height >= kMinThreadedTransposeSize)
+#endif
+  {
+    align_buffer_64(row, width);
+    int y;
+    // Odd height will harmlessly mirror the middle row twice.
+#ifdef _OPENMP
+#pragma omp for
+#endif
+    for (y = 0; y < half_height; ++y) {
+      const uint8* src_top = src + src_stride * y;
+      const uint8* src_bot = src + src_stride * (height - 1 - y);
+      uint8* dst_top = dst + dst_stride * y;
+      uint8* dst_bot = dst + dst_stride * (height - 1 - y);
+      MirrorRow(src_top, row, width);  // Mirror first row into a buffer
+      MirrorRow(src_bot, dst_top, width);  // Mirror last row into first row
+      CopyRow(row, dst_bot, width);  // Copy first mirrored row into last
+    }
+    free_aligned_buffer_64(row);
   }
-  free_aligned_buffer_64(row);
 }
 
 static void TransposeUVWx8_C(const uint8* src, int src_stride,
@@ -998,12 +1194,16 @@ static void TransposeUVWxH_C(const uint8* src, int src_stride,
   }
 }
 
+// The interleaved UV plane of NV12 is split into its 2 planes while it is
+// transposed, so a rotation of the UV plane takes a single pass.
 LIBYUV_API
 void TransposeUV(const uint8* src, int src_stride,
                  uint8* dst_a, int dst_stride_a,
                  uint8* dst_b, int dst_stride_b,
                  int width, int height) {
-  int i = height;
+  int tile_rows = (height + kTransposeTileSize - 1) / kTransposeTileSize;
+  int ty;
+  int mask = 0;
   void (*TransposeUVWx8)(const uint8* src, int src_stride,
                          uint8* dst_a, int dst_stride_a,
                          uint8* dst_b, int dst_stride_b,
@@ -1014,8 +1214,9 @@ void TransposeUV(const uint8* src, int src_stride,
   }
 #endif
 #if defined(HAS_TRANSPOSE_UVWX8_SSE2)
-  if (TestCpuFlag(kCpuHasSSE2) && IS_ALIGNED(width, 8)) {
+  if (TestCpuFlag(kCpuHasSSE2)) {
     TransposeUVWx8 = TransposeUVWx8_SSE2;
+    mask = 7;
   }
 #endif
 #if defined(HAS_TRANSPOSE_UVWx8_MIPS_DSPR2)
@@ -1025,22 +1226,56 @@ void TransposeUV(const uint8* src, int src_stride,
   }
 #endif
 
-  // Work through the source in 8x8 tiles.
-  while (i >= 8) {
-    TransposeUVWx8(src, src_stride,
-                   dst_a, dst_stride_a,
-                   dst_b, dst_stride_b,
-                   width);
-    src += 8 * src_stride;    // Go down 8 rows.
-    dst_a += 8;               // Move over 8 columns.
-    dst_b += 8;               // Move over 8 columns.
-    i -= 8;
-  }
+#ifdef _OPENMP
+#pragma omp parallel for if (width * height >= kMinThreadedTransposeSize)
+#endif
+  for (ty = 0; ty < tile_rows; ++ty) {
+    int y = ty * kTransposeTileSize;
+    int tile_height = height - y;
+    int x;
+    if (tile_height > kTransposeTileSize) {
+      tile_height = kTransposeTileSize;
+    }
+    for (x = 0; x < width; x += kTransposeTileSize) {
+      const uint8* tile_src = src + y * src_stride + x * 2;
+      uint8* tile_dst_a = dst_a + x * dst_stride_a + y;
+      uint8* tile_dst_b = dst_b + x * dst_stride_b + y;
+      int tile_width = width - x;
+      int aligned_width;
+      int i = tile_height;
+      if (tile_width > kTransposeTileSize) {
+        tile_width = kTransposeTileSize;
+      }
+      aligned_width = tile_width & ~mask;
+
+      // Work through the tile in 8x8 blocks.
+      while (i >= 8) {
+        if (aligned_width > 0) {
+          TransposeUVWx8(tile_src, src_stride,
+                         tile_dst_a, dst_stride_a,
+                         tile_dst_b, dst_stride_b,
+                         aligned_width);
+        }
+        if (tile_width > aligned_width) {
+          TransposeUVWxH_C(tile_src + aligned_width * 2, src_stride,
+                           tile_dst_a + aligned_width * dst_stride_a,
+                           dst_stride_a,
+                           tile_dst_b + aligned_width * dst_stride_b,
+                           dst_stride_b,
+                           tile_width - aligned_width, 8);
+        }
+        tile_src += 8 * src_stride;    // Go down 8 rows.
+        tile_dst_a += 8;               // Move over 8 columns.
+        tile_dst_b += 8;               // Move over 8 columns.
+        i -= 8;
+      }
 
-  TransposeUVWxH_C(src, src_stride,
-                   dst_a, dst_stride_a,
-                   dst_b, dst_stride_b,
-                   width, i);
+      TransposeUVWxH_C(tile_src, src_stride,
+                       tile_dst_a, dst_stride_a,
+                       tile_dst_b, dst_stride_b,
+                       tile_width, i);
+    }
+  }
 }
 
 LIBYUV_API
@@ -42,28 +42,185 @@ void ScaleARGBRowDownEven_C(const uint8* src_ptr, int,
                             int src_stepx,
                             uint8* dst_ptr, int dst_width);
 
+#if !defined(LIBYUV_DISABLE_X86) && !defined(__native_client__) && \
+    defined(__x86_64__) && (defined(GCC_HAS_AVX2) || defined(CLANG_HAS_AVX2))
+// Transposes 8x8 blocks of ARGB pixels. After the dword and qword unpacks each
+// register holds half a column in each lane, which vperm2i128 joins.
+#define HAS_TRANSPOSEARGBWX8_AVX2
+static void TransposeARGBWx8_AVX2(const uint8* src, int src_stride,
+                                  uint8* dst, int dst_stride, int width) {
+  intptr_t row;
+  asm volatile (
+  ".p2align  2                                 \n"
+"1:                                            \n"
+  "mov        %0,%3                            \n"
+  "vmovdqu    (%3),%%ymm0                      \n"
+  "vmovdqu    (%3,%4),%%ymm1                   \n"
+  "lea        (%3,%4,2),%3                     \n"
+  "vmovdqu    (%3),%%ymm2                      \n"
+  "vmovdqu    (%3,%4),%%ymm3                   \n"
+  "lea        (%3,%4,2),%3                     \n"
+  "vmovdqu    (%3),%%ymm4                      \n"
+  "vmovdqu    (%3,%4),%%ymm5                   \n"
+  "lea        (%3,%4,2),%3                     \n"
+  "vmovdqu    (%3),%%ymm6                      \n"
+  "vmovdqu    (%3,%4),%%ymm7                   \n"
+  "lea        0x20(%0),%0                      \n"
+  // First round of swap: dwords.
+  "vpunpckldq %%ymm1,%%ymm0,%%ymm8             \n"
+  "vpunpckhdq %%ymm1,%%ymm0,%%ymm9             \n"
+  "vpunpckldq %%ymm3,%%ymm2,%%ymm10            \n"
+  "vpunpckhdq %%ymm3,%%ymm2,%%ymm11            \n"
+  "vpunpckldq %%ymm5,%%ymm4,%%ymm12            \n"
+  "vpunpckhdq %%ymm5,%%ymm4,%%ymm13            \n"
+  "vpunpckldq %%ymm7,%%ymm6,%%ymm14            \n"
+  "vpunpckhdq %%ymm7,%%ymm6,%%ymm15            \n"
+  // Second round of swap: qwords.
+  "vpunpcklqdq %%ymm10,%%ymm8,%%ymm0           \n"
+  "vpunpckhqdq %%ymm10,%%ymm8,%%ymm1           \n"
+  "vpunpcklqdq %%ymm11,%%ymm9,%%ymm2           \n"
+  "vpunpckhqdq %%ymm11,%%ymm9,%%ymm3           \n"
+  "vpunpcklqdq %%ymm14,%%ymm12,%%ymm4          \n"
+  "vpunpckhqdq %%ymm14,%%ymm12,%%ymm5          \n"
+  "vpunpcklqdq %%ymm15,%%ymm13,%%ymm6          \n"
+  "vpunpckhqdq %%ymm15,%%ymm13,%%ymm7          \n"
+  // Third round of swap: lanes. Columns 0-3 come from the low lanes.
+  "vperm2i128 $0x20,%%ymm4,%%ymm0,%%ymm8       \n"
+  "vperm2i128 $0x31,%%ymm4,%%ymm0,%%ymm12      \n"
+  "vperm2i128 $0x20,%%ymm5,%%ymm1,%%ymm9       \n"
+  "vperm2i128 $0x31,%%ymm5,%%ymm1,%%ymm13      \n"
+  "vperm2i128 $0x20,%%ymm6,%%ymm2,%%ymm10      \n"
+  "vperm2i128 $0x31,%%ymm6,%%ymm2,%%ymm14      \n"
+  "vperm2i128 $0x20,%%ymm7,%%ymm3,%%ymm11      \n"
+  "vperm2i128 $0x31,%%ymm7,%%ymm3,%%ymm15      \n"
+  "mov        %1,%3                            \n"
+  "vmovdqu    %%ymm8,(%3)                      \n"
+  "vmovdqu    %%ymm9,(%3,%5)                   \n"
+  "lea        (%3,%5,2),%3                     \n"
+  "vmovdqu    %%ymm10,(%3)                     \n"
+  "vmovdqu    %%ymm11,(%3,%5)                  \n"
+  "lea        (%3,%5,2),%3                     \n"
+  "vmovdqu    %%ymm12,(%3)                     \n"
+  "vmovdqu    %%ymm13,(%3,%5)                  \n"
+  "lea        (%3,%5,2),%3                     \n"
+  "vmovdqu    %%ymm14,(%3)                     \n"
+  "vmovdqu    %%ymm15,(%3,%5)                  \n"
+  "lea        (%3,%5,2),%3                     \n"
+  "mov        %3,%1                            \n"
+  "sub        $0x8,%2                          \n"
+  "jg         1b                               \n"
+  "vzeroupper                                  \n"
+  : "+r"(src),    // %0
+    "+r"(dst),    // %1
+    "+r"(width),  // %2
+    "=&r"(row)    // %3
+  : "r"((intptr_t)(src_stride)),  // %4
+    "r"((intptr_t)(dst_stride))   // %5
+  : "memory", "cc",
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+    "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13",  "xmm14",  "xmm15"
+);
+}
+#endif  // HAS_TRANSPOSEARGBWX8_AVX2
+
+typedef void (*ScaleARGBRowDownEvenFunc)(const uint8* src_ptr, int src_stride,
+                                         int src_step,
+                                         uint8* dst_ptr, int dst_width);
+
+// Transposes a block by copying each column of the source to a row of the
+// destination.
+static void ARGBTransposeWxH(ScaleARGBRowDownEvenFunc ScaleARGBRowDownEven,
+                             const uint8* src, int src_stride,
+                             uint8* dst, int dst_stride,
+                             int width, int height) {
+  int src_pixel_step = src_stride >> 2;
+  int i;
+  for (i = 0; i < width; ++i) {  // column of source to row of dest.
+    ScaleARGBRowDownEven(src, 0, src_pixel_step, dst, height);
+    dst += dst_stride;
+    src += 4;
+  }
+}
+
+// Images are transposed in square tiles so the rows read and the rows written
+// by a tile both stay in cache. A 32x32 ARGB tile is 4 KB each way. Rows of
+// tiles are shared between threads.
+static const int kARGBTransposeTileSize = 32;
+static const int kMinThreadedARGBTransposeSize = 256 * 256;
+
 static void ARGBTranspose(const uint8* src, int src_stride,
                           uint8* dst, int dst_stride,
                           int width, int height) {
-  int i;
-  int src_pixel_step = src_stride >> 2;
-  void (*ScaleARGBRowDownEven)(const uint8* src_ptr, int src_stride,
-      int src_step, uint8* dst_ptr, int dst_width) = ScaleARGBRowDownEven_C;
+  int tile_rows = (height + kARGBTransposeTileSize - 1) /
+      kARGBTransposeTileSize;
+  int ty;
+  int mask8 = 0;
+  void (*TransposeARGBWx8)(const uint8* src, int src_stride,
+                           uint8* dst, int dst_stride, int width) = NULL;
+  ScaleARGBRowDownEvenFunc ScaleARGBRowDownEven = ScaleARGBRowDownEven_C;
+  ScaleARGBRowDownEvenFunc ScaleARGBRowDownEven4 = ScaleARGBRowDownEven_C;
 #if defined(HAS_SCALEARGBROWDOWNEVEN_SSE2)
-  if (TestCpuFlag(kCpuHasSSE2) && IS_ALIGNED(height, 4)) {  // Width of dest.
-    ScaleARGBRowDownEven = ScaleARGBRowDownEven_SSE2;
+  if (TestCpuFlag(kCpuHasSSE2)) {
+    ScaleARGBRowDownEven4 = ScaleARGBRowDownEven_SSE2;
   }
 #endif
 #if defined(HAS_SCALEARGBROWDOWNEVEN_NEON)
-  if (TestCpuFlag(kCpuHasNEON) && IS_ALIGNED(height, 4)) {  // Width of dest.
-    ScaleARGBRowDownEven = ScaleARGBRowDownEven_NEON;
+  if (TestCpuFlag(kCpuHasNEON)) {
+    ScaleARGBRowDownEven4 = ScaleARGBRowDownEven_NEON;
+  }
+#endif
+#if defined(HAS_TRANSPOSEARGBWX8_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2)) {
+    TransposeARGBWx8 = TransposeARGBWx8_AVX2;
+    mask8 = 7;
   }
 #endif
 
-  for (i = 0; i < width; ++i) {  // column of source to row of dest.
-    ScaleARGBRowDownEven(src, 0, src_pixel_step, dst, height);
-    dst += dst_stride;
-    src += 4;
+#ifdef _OPENMP
+#pragma omp parallel for if (width * height >= kMinThreadedARGBTransposeSize)
+#endif
+  for (ty = 0; ty < tile_rows; ++ty) {
+    int y = ty * kARGBTransposeTileSize;
+    int tile_height = height - y;
+    int x;
+    if (tile_height > kARGBTransposeTileSize) {
+      tile_height = kARGBTransposeTileSize;
+    }
+    for (x = 0; x < width; x += kARGBTransposeTileSize) {
+      const uint8* tile_src = src + y * src_stride + x * 4;
+      uint8* tile_dst = dst + x * dst_stride + y * 4;
+      int tile_width = width - x;
+      int aligned_width;
+      int i = tile_height;
+      if (tile_width > kARGBTransposeTileSize) {
+        tile_width = kARGBTransposeTileSize;
+      }
+      aligned_width = tile_width & ~mask8;
+      if (TransposeARGBWx8) {
+        while (i >= 8) {
+          if (aligned_width > 0) {
+            TransposeARGBWx8(tile_src, src_stride, tile_dst, dst_stride,
+                             aligned_width);
+          }
+          // The gather kernels write 4 pixels at a time, so 8 rows suit them.
+          if (tile_width > aligned_width) {
+            ARGBTransposeWxH(ScaleARGBRowDownEven4,
+                             tile_src + aligned_width * 4, src_stride,
+                             tile_dst + aligned_width * dst_stride,
+                             dst_stride, tile_width - aligned_width, 8);
+          }
+          tile_src += 8 * src_stride;    // Go down 8 rows.
+          tile_dst += 8 * 4;             // Move over 8 columns.
+          i -= 8;
+        }
+      }
+      if (i > 0) {
+        ARGBTransposeWxH(IS_ALIGNED(i, 4) ? ScaleARGBRowDownEven4 :
+                         ScaleARGBRowDownEven,
+                         tile_src, src_stride, tile_dst, dst_stride,
+                         tile_width, i);
+      }
+    }
   }
 }
 
@@ -92,12 +249,7 @@ void ARGBRotate270(const uint8* src, int src_stride,
 void ARGBRotate180(const uint8* src, int src_stride,
                    uint8* dst, int dst_stride,
                    int width, int height) {
-  // Swap first and last row and mirror the content. Uses a temporary row.
-  align_buffer_64(row, width * 4);
-  const uint8* src_bot = src + src_stride * (height - 1);
-  uint8* dst_bot = dst + dst_stride * (height - 1);
   int half_height = (height + 1) >> 1;
-  int y;
   void (*ARGBMirrorRow)(const uint8* src, uint8* dst, int width) =
       ARGBMirrorRow_C;
   void (*CopyRow)(const uint8* src, uint8* dst, int width) = CopyRow_C;
@@ -151,17 +303,29 @@ void ARGBRotate180(const uint8* src, int src_stride,
   }
 #endif
 
-  // Odd height will harmlessly mirror the middle row twice.
-  for (y = 0; y < half_height; ++y) {
-    ARGBMirrorRow(src, row, width);  // Mirror first row into a buffer
-    ARGBMirrorRow(src_bot, dst, width);  // Mirror last row into first row
-    CopyRow(row, dst_bot, width * 4);  // Copy first mirrored row into last
-    src += src_stride;
-    dst += dst_stride;
-    src_bot -= src_stride;
-    dst_bot -= dst_stride;
+  // Swap first and last row and mirror the content. Pairs of rows are shared
+  // between threads, each with its own temporary row.
+#ifdef _OPENMP
+#pragma omp parallel if (width * height >= kMinThreadedARGBTransposeSize)
+#endif
+  {
+    align_buffer_64(row, width * 4);
+    int y;
+    // Odd height will harmlessly mirror the middle row twice.
+#ifdef _OPENMP
+#pragma omp for
+#endif
+    for (y = 0; y < half_height; ++y) {
+      const uint8* src_top = src + src_stride * y;
+      const uint8* src_bot = src + src_stride * (height - 1 - y);
+      uint8* dst_top = dst + dst_stride * y;
+      uint8* dst_bot = dst + dst_stride * (height - 1 - y);
+      ARGBMirrorRow(src_top, row, width);  // Mirror first row into a buffer
+      ARGBMirrorRow(src_bot, dst_top, width);  // Mirror last row into first
+      CopyRow(row, dst_bot, width * 4);  // Copy first mirrored row into last
+    }
+    free_aligned_buffer_64(row);
   }
-  free_aligned_buffer_64(row);
 }
 
 LIBYUV_API
@@ -688,6 +688,43 @@ NANY(InterpolateRow_Any_MIPS_DSPR2, InterpolateRow_MIPS_DSPR2, InterpolateRow_C,
 #endif
 #undef NANY
 
+#define BOXANY(NAMEANY, ADD_SIMD, ADD_C, MASK)                                 \
+    void NAMEANY(const uint8* src, uint16* sum, int width) {                   \
+      int n = width & ~MASK;                                                   \
+      if (n > 0) {                                                             \
+        ADD_SIMD(src, sum, n);                                                 \
+      }                                                                        \
+      ADD_C(src + n, sum + n, width & MASK);                                   \
+    }
+
+#ifdef HAS_BOXSUMADDROW_SSE2
+BOXANY(BoxSumAddRow_Any_SSE2, BoxSumAddRow_SSE2, BoxSumAddRow_C, 15)
+#endif
+#ifdef HAS_BOXSUMADDROW_AVX2
+BOXANY(BoxSumAddRow_Any_AVX2, BoxSumAddRow_AVX2, BoxSumAddRow_C, 31)
+#endif
+#undef BOXANY
+
+#define BOXAVGANY(NAMEANY, AVG_SIMD, AVG_C, MASK)                              \
+    void NAMEANY(const uint16* sum_hi, const uint16* sum_lo,                   \
+                 int count, uint8* dst, int width) {                           \
+      int n = width & ~MASK;                                                   \
+      if (n > 0) {                                                             \
+        AVG_SIMD(sum_hi, sum_lo, count, dst, n);                               \
+      }                                                                        \
+      AVG_C(sum_hi + n, sum_lo + n, count, dst + n, width & MASK);             \
+    }
+
+#ifdef HAS_BOXSUMTOAVERAGEROW_SSE2
+BOXAVGANY(BoxSumToAverageRow_Any_SSE2, BoxSumToAverageRow_SSE2,
+          BoxSumToAverageRow_C, 15)
+#endif
+#ifdef HAS_BOXSUMTOAVERAGEROW_AVX2
+BOXAVGANY(BoxSumToAverageRow_Any_AVX2, BoxSumToAverageRow_AVX2,
+          BoxSumToAverageRow_C, 31)
+#endif
+#undef BOXAVGANY
+
 #define MANY(NAMEANY, MIRROR_SIMD, MIRROR_C, BPP, MASK)                        \
     void NAMEANY(const uint8* src_y, uint8* dst_y, int width) {                \
       int n = width & ~MASK;                                                   \
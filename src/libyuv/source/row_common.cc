@@ -1993,6 +1993,38 @@ void CumulativeSumToAverageRow_C(const int32* tl, const int32* bl,
   }
 }
 
+// Creates a running sum of each channel along the row. sum holds width + 1
+// pixels, starting with 0, so the sum of pixels [a, b) is sum[b] - sum[a].
+void ComputeBoxSumRow_C(const uint8* src, uint16* sum, int bpp, int width) {
+  int i;
+  for (i = 0; i < bpp; ++i) {
+    sum[i] = 0;
+  }
+  for (i = 0; i < width * bpp; ++i) {
+    sum[i + bpp] = (uint16)(sum[i] + src[i]);
+  }
+}
+
+void BoxSumAddRow_C(const uint8* src, uint16* sum, int width) {
+  int i;
+  for (i = 0; i < width; ++i) {
+    sum[i] = (uint16)(sum[i] + src[i]);
+  }
+}
+
+// Averages count values from the difference of 2 running sums. The reciprocal
+// is 16 bit fixed point, which keeps the result within 1 of the exact average
+// for up to 255 values.
+void BoxSumToAverageRow_C(const uint16* sum_hi, const uint16* sum_lo,
+                          int count, uint8* dst, int width) {
+  uint32 recip = (65536u + count / 2) / count;
+  int i;
+  for (i = 0; i < width; ++i) {
+    uint32 sum = (uint16)(sum_hi[i] - sum_lo[i]);
+    dst[i] = (uint8)((sum * recip + 32768u) >> 16);
+  }
+}
+
 // Copy pixels from rotated source to destination row with a slope.
 LIBYUV_API
 void ARGBAffineRow_C(const uint8* src_argb, int src_argb_stride,
@@ -4629,6 +4629,155 @@ void CumulativeSumToAverageRow_SSE2(const int32* topleft, const int32* botleft,
 }
 #endif  // HAS_CUMULATIVESUMTOAVERAGEROW_SSE2
 
+#ifdef HAS_BOXSUMADDROW_SSE2
+// Adds 16 bytes to 16 shorts at a time. The sums wrap rather than saturate.
+void BoxSumAddRow_SSE2(const uint8* src, uint16* sum, int width) {
+  asm volatile (
+    "pxor      %%xmm5,%%xmm5                   \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "movdqu    " MEMACCESS(0) ",%%xmm3         \n"
+    "lea       " MEMLEA(0x10,0) ",%0           \n"
+    "movdqu    " MEMACCESS(1) ",%%xmm0         \n"
+    "movdqu    " MEMACCESS2(0x10,1) ",%%xmm1   \n"
+    "movdqa    %%xmm3,%%xmm2                   \n"
+    "punpcklbw %%xmm5,%%xmm2                   \n"
+    "punpckhbw %%xmm5,%%xmm3                   \n"
+    "paddw     %%xmm2,%%xmm0                   \n"
+    "paddw     %%xmm3,%%xmm1                   \n"
+    "movdqu    %%xmm0," MEMACCESS(1) "         \n"
+    "movdqu    %%xmm1," MEMACCESS2(0x10,1) "   \n"
+    "lea       " MEMLEA(0x20,1) ",%1           \n"
+    "sub       $0x10,%2                        \n"
+    "jg        1b                              \n"
+  : "+r"(src),    // %0
+    "+r"(sum),    // %1
+    "+r"(width)   // %2
+  :
+  : "memory", "cc"
+    , "xmm0", "xmm1", "xmm2", "xmm3", "xmm5"
+  );
+}
+#endif  // HAS_BOXSUMADDROW_SSE2
+
+#ifdef HAS_BOXSUMADDROW_AVX2
+// Adds 32 bytes to 32 shorts at a time. The sums wrap rather than saturate.
+void BoxSumAddRow_AVX2(const uint8* src, uint16* sum, int width) {
+  asm volatile (
+    LABELALIGN
+  "1:                                          \n"
+    "vpmovzxbw " MEMACCESS(0) ",%%ymm0         \n"
+    "vpmovzxbw " MEMACCESS2(0x10,0) ",%%ymm1   \n"
+    "lea       " MEMLEA(0x20,0) ",%0           \n"
+    "vpaddw    " MEMACCESS(1) ",%%ymm0,%%ymm0  \n"
+    "vpaddw    " MEMACCESS2(0x20,1) ",%%ymm1,%%ymm1 \n"
+    "vmovdqu   %%ymm0," MEMACCESS(1) "         \n"
+    "vmovdqu   %%ymm1," MEMACCESS2(0x20,1) "   \n"
+    "lea       " MEMLEA(0x40,1) ",%1           \n"
+    "sub       $0x20,%2                        \n"
+    "jg        1b                              \n"
+    "vzeroupper                                \n"
+  : "+r"(src),    // %0
+    "+r"(sum),    // %1
+    "+r"(width)   // %2
+  :
+  : "memory", "cc"
+    , "xmm0", "xmm1"
+  );
+}
+#endif  // HAS_BOXSUMADDROW_AVX2
+
+#ifdef HAS_BOXSUMTOAVERAGEROW_SSE2
+// Averages 16 values at a time. count must be at least 2 so the reciprocal
+// fits in 16 bits. pmullw provides the rounding bit that pmulhuw drops.
+void BoxSumToAverageRow_SSE2(const uint16* sum_hi, const uint16* sum_lo,
+                             int count, uint8* dst, int width) {
+  uint32 recip = (65536u + count / 2) / count;
+  asm volatile (
+    "movd      %4,%%xmm5                       \n"
+    "pshuflw   $0x0,%%xmm5,%%xmm5              \n"
+    "pshufd    $0x0,%%xmm5,%%xmm5              \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "movdqu    " MEMACCESS(0) ",%%xmm0         \n"
+    "movdqu    " MEMACCESS2(0x10,0) ",%%xmm1   \n"
+    "lea       " MEMLEA(0x20,0) ",%0           \n"
+    "movdqu    " MEMACCESS(1) ",%%xmm2         \n"
+    "movdqu    " MEMACCESS2(0x10,1) ",%%xmm3   \n"
+    "lea       " MEMLEA(0x20,1) ",%1           \n"
+    "psubw     %%xmm2,%%xmm0                   \n"
+    "psubw     %%xmm3,%%xmm1                   \n"
+    "movdqa    %%xmm0,%%xmm2                   \n"
+    "movdqa    %%xmm1,%%xmm3                   \n"
+    "pmulhuw   %%xmm5,%%xmm0                   \n"
+    "pmulhuw   %%xmm5,%%xmm1                   \n"
+    "pmullw    %%xmm5,%%xmm2                   \n"
+    "pmullw    %%xmm5,%%xmm3                   \n"
+    "psrlw     $0xf,%%xmm2                     \n"
+    "psrlw     $0xf,%%xmm3                     \n"
+    "paddw     %%xmm2,%%xmm0                   \n"
+    "paddw     %%xmm3,%%xmm1                   \n"
+    "packuswb  %%xmm1,%%xmm0                   \n"
+    "movdqu    %%xmm0," MEMACCESS(2) "         \n"
+    "lea       " MEMLEA(0x10,2) ",%2           \n"
+    "sub       $0x10,%3                        \n"
+    "jg        1b                              \n"
+  : "+r"(sum_hi),  // %0
+    "+r"(sum_lo),  // %1
+    "+r"(dst),     // %2
+    "+r"(width)    // %3
+  : "r"(recip)     // %4
+  : "memory", "cc"
+    , "xmm0", "xmm1", "xmm2", "xmm3", "xmm5"
+  );
+}
+#endif  // HAS_BOXSUMTOAVERAGEROW_SSE2
+
+#ifdef HAS_BOXSUMTOAVERAGEROW_AVX2
+// Averages 32 values at a time. count must be at least 2.
+void BoxSumToAverageRow_AVX2(const uint16* sum_hi, const uint16* sum_lo,
+                             int count, uint8* dst, int width) {
+  uint32 recip = (65536u + count / 2) / count;
+  asm volatile (
+    "vmovd     %4,%%xmm5                       \n"
+    "vpbroadcastw %%xmm5,%%ymm5                \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "vmovdqu   " MEMACCESS(0) ",%%ymm0         \n"
+    "vmovdqu   " MEMACCESS2(0x20,0) ",%%ymm1   \n"
+    "lea       " MEMLEA(0x40,0) ",%0           \n"
+    "vpsubw    " MEMACCESS(1) ",%%ymm0,%%ymm0  \n"
+    "vpsubw    " MEMACCESS2(0x20,1) ",%%ymm1,%%ymm1 \n"
+    "lea       " MEMLEA(0x40,1) ",%1           \n"
+    "vpmullw   %%ymm5,%%ymm0,%%ymm2            \n"
+    "vpmullw   %%ymm5,%%ymm1,%%ymm3            \n"
+    "vpmulhuw  %%ymm5,%%ymm0,%%ymm0            \n"
+    "vpmulhuw  %%ymm5,%%ymm1,%%ymm1            \n"
+    "vpsrlw    $0xf,%%ymm2,%%ymm2              \n"
+    "vpsrlw    $0xf,%%ymm3,%%ymm3              \n"
+    "vpaddw    %%ymm2,%%ymm0,%%ymm0            \n"
+    "vpaddw    %%ymm3,%%ymm1,%%ymm1            \n"
+    "vpackuswb %%ymm1,%%ymm0,%%ymm0            \n"
+    "vpermq    $0xd8,%%ymm0,%%ymm0             \n"
+    "vmovdqu   %%ymm0," MEMACCESS(2) "         \n"
+    "lea       " MEMLEA(0x20,2) ",%2           \n"
+    "sub       $0x20,%3                        \n"
+    "jg        1b                              \n"
+    "vzeroupper                                \n"
+  : "+r"(sum_hi),  // %0
+    "+r"(sum_lo),  // %1
+    "+r"(dst),     // %2
+    "+r"(width)    // %3
+  : "r"(recip)     // %4
+  : "memory", "cc"
+    , "xmm0", "xmm1", "xmm2", "xmm3", "xmm5"
+  );
+}
+#endif  // HAS_BOXSUMTOAVERAGEROW_AVX2
+
 #ifdef HAS_ARGBAFFINEROW_SSE2
 // Copy ARGB pixels from source image with slope to a row of destination.
 LIBYUV_API
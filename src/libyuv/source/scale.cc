@@ -1390,6 +1390,177 @@ static void ScalePlaneSimple_16(int src_width, int src_height,
   }
 }
 
+// Scale with a separable polyphase filter. Each source row is filtered
+// horizontally once into a ring of rows, and the ring is filtered vertically
+// to make each destination row. Rows are stored twice in the ring so the
+// rows of a filter are always consecutive.
+static void ScalePlanePolyphase(int src_width, int src_height,
+                                int dst_width, int dst_height,
+                                int src_stride, int dst_stride,
+                                const uint8* src_ptr, uint8* dst_ptr,
+                                enum FilterMode filtering) {
+  int j;
+  int next_row = 0;
+  // Columns are filtered 8 taps at a time and rows 2 at a time.
+  const int filter_width = ScalePolyphaseFilterLength(src_width, dst_width,
+                                                      filtering, 8);
+  const int filter_height = ScalePolyphaseFilterLength(src_height, dst_height,
+                                                       filtering, 2);
+  const int kRowSize = (dst_width + 15) & ~15;
+  align_buffer_64(offsets, (dst_width + dst_height) * 4);
+  align_buffer_64(coeffs, (dst_width * filter_width +
+                           dst_height * filter_height) * 2);
+  align_buffer_64(rows, kRowSize * filter_height * 2 * 2);
+  int* offsets_x = (int*)(offsets);
+  int* offsets_y = offsets_x + dst_width;
+  int16* coeffs_x = (int16*)(coeffs);
+  int16* coeffs_y = coeffs_x + dst_width * filter_width;
+  int16* ring = (int16*)(rows);
+  void (*ScalePolyphaseCols)(int16* dst_ptr, const uint8* src_ptr,
+      int dst_width, const int* filter_offsets, const int16* filter_coeffs,
+      int filter_length) = ScalePolyphaseCols_C;
+  void (*ScalePolyphaseRows)(const int16* src_ptr, ptrdiff_t src_stride,
+      uint8* dst_ptr, const int16* filter_coeffs, int filter_length,
+      int dst_width) = ScalePolyphaseRows_C;
+  ScalePolyphaseFilter(src_width, dst_width, filtering, filter_width,
+                       offsets_x, coeffs_x);
+  ScalePolyphaseFilter(src_height, dst_height, filtering, filter_height,
+                       offsets_y, coeffs_y);
+#if defined(HAS_SCALEPOLYPHASECOLS_SSSE3)
+  if (TestCpuFlag(kCpuHasSSSE3) && IS_ALIGNED(filter_width, 8)) {
+    ScalePolyphaseCols = ScalePolyphaseCols_SSSE3;
+  }
+#endif
+#if defined(HAS_SCALEPOLYPHASECOLS_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2) && IS_ALIGNED(filter_width, 8)) {
+    ScalePolyphaseCols = ScalePolyphaseCols_Any_AVX2;
+    if (IS_ALIGNED(dst_width, 2)) {
+      ScalePolyphaseCols = ScalePolyphaseCols_AVX2;
+    }
+  }
+#endif
+#if defined(HAS_SCALEPOLYPHASEROWS_SSE2)
+  if (TestCpuFlag(kCpuHasSSE2) && IS_ALIGNED(filter_height, 2)) {
+    ScalePolyphaseRows = ScalePolyphaseRows_Any_SSE2;
+    if (IS_ALIGNED(dst_width, 8)) {
+      ScalePolyphaseRows = ScalePolyphaseRows_SSE2;
+    }
+  }
+#endif
+#if defined(HAS_SCALEPOLYPHASEROWS_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2) && IS_ALIGNED(filter_height, 2)) {
+    ScalePolyphaseRows = ScalePolyphaseRows_Any_AVX2;
+    if (IS_ALIGNED(dst_width, 16)) {
+      ScalePolyphaseRows = ScalePolyphaseRows_AVX2;
+    }
+  }
+#endif
+
+  for (j = 0; j < dst_height; ++j) {
+    int y = offsets_y[j];
+    if (next_row < y) {
+      next_row = y;
+    }
+    while (next_row < y + filter_height) {
+      int16* row = ring + (next_row % filter_height) * kRowSize;
+      ScalePolyphaseCols(row, src_ptr + next_row * src_stride, dst_width,
+                         offsets_x, coeffs_x, filter_width);
+      memcpy(row + filter_height * kRowSize, row, dst_width * 2);
+      ++next_row;
+    }
+    ScalePolyphaseRows(ring + (y % filter_height) * kRowSize, kRowSize,
+                       dst_ptr, coeffs_y + j * filter_height, filter_height,
+                       dst_width);
+    dst_ptr += dst_stride;
+  }
+  free_aligned_buffer_64(offsets);
+  free_aligned_buffer_64(coeffs);
+  free_aligned_buffer_64(rows);
+}
+
+static void ScalePlanePolyphase_16(int src_width, int src_height,
+                                   int dst_width, int dst_height,
+                                   int src_stride, int dst_stride,
+                                   const uint16* src_ptr, uint16* dst_ptr,
+                                   enum FilterMode filtering) {
+  int j;
+  int next_row = 0;
+  const int filter_width = ScalePolyphaseFilterLength(src_width, dst_width,
+                                                      filtering, 8);
+  const int filter_height = ScalePolyphaseFilterLength(src_height, dst_height,
+                                                       filtering, 2);
+  const int kRowSize = (dst_width + 15) & ~15;
+  align_buffer_64(offsets, (dst_width + dst_height) * 4);
+  align_buffer_64(coeffs, (dst_width * filter_width +
+                           dst_height * filter_height) * 2);
+  align_buffer_64(rows, kRowSize * filter_height * 2 * 2);
+  int* offsets_x = (int*)(offsets);
+  int* offsets_y = offsets_x + dst_width;
+  int16* coeffs_x = (int16*)(coeffs);
+  int16* coeffs_y = coeffs_x + dst_width * filter_width;
+  uint16* ring = (uint16*)(rows);
+  void (*ScalePolyphaseCols)(uint16* dst_ptr, const uint16* src_ptr,
+      int dst_width, const int* filter_offsets, const int16* filter_coeffs,
+      int filter_length) = ScalePolyphaseCols_16_C;
+  void (*ScalePolyphaseRows)(const uint16* src_ptr, ptrdiff_t src_stride,
+      uint16* dst_ptr, const int16* filter_coeffs, int filter_length,
+      int dst_width) = ScalePolyphaseRows_16_C;
+  ScalePolyphaseFilter(src_width, dst_width, filtering, filter_width,
+                       offsets_x, coeffs_x);
+  ScalePolyphaseFilter(src_height, dst_height, filtering, filter_height,
+                       offsets_y, coeffs_y);
+#if defined(HAS_SCALEPOLYPHASECOLS_SSSE3)
+  if (TestCpuFlag(kCpuHasSSSE3) && IS_ALIGNED(filter_width, 8)) {
+    ScalePolyphaseCols = ScalePolyphaseCols_16_SSSE3;
+  }
+#endif
+#if defined(HAS_SCALEPOLYPHASECOLS_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2) && IS_ALIGNED(filter_width, 8)) {
+    ScalePolyphaseCols = ScalePolyphaseCols_16_Any_AVX2;
+    if (IS_ALIGNED(dst_width, 2)) {
+      ScalePolyphaseCols = ScalePolyphaseCols_16_AVX2;
+    }
+  }
+#endif
+#if defined(HAS_SCALEPOLYPHASEROWS_SSE2)
+  if (TestCpuFlag(kCpuHasSSE2) && IS_ALIGNED(filter_height, 2)) {
+    ScalePolyphaseRows = ScalePolyphaseRows_16_Any_SSE2;
+    if (IS_ALIGNED(dst_width, 8)) {
+      ScalePolyphaseRows = ScalePolyphaseRows_16_SSE2;
+    }
+  }
+#endif
+#if defined(HAS_SCALEPOLYPHASEROWS_AVX2)
+  if (TestCpuFlag(kCpuHasAVX2) && IS_ALIGNED(filter_height, 2)) {
+    ScalePolyphaseRows = ScalePolyphaseRows_16_Any_AVX2;
+    if (IS_ALIGNED(dst_width, 16)) {
+      ScalePolyphaseRows = ScalePolyphaseRows_16_AVX2;
+    }
+  }
+#endif
+
+  for (j = 0; j < dst_height; ++j) {
+    int y = offsets_y[j];
+    if (next_row < y) {
+      next_row = y;
+    }
+    while (next_row < y + filter_height) {
+      uint16* row = ring + (next_row % filter_height) * kRowSize;
+      ScalePolyphaseCols(row, src_ptr + next_row * src_stride, dst_width,
+                         offsets_x, coeffs_x, filter_width);
+      memcpy(row + filter_height * kRowSize, row, dst_width * 2);
+      ++next_row;
+    }
+    ScalePolyphaseRows(ring + (y % filter_height) * kRowSize, kRowSize,
+                       dst_ptr, coeffs_y + j * filter_height, filter_height,
+                       dst_width);
+    dst_ptr += dst_stride;
+  }
+  free_aligned_buffer_64(offsets);
+  free_aligned_buffer_64(coeffs);
+  free_aligned_buffer_64(rows);
+}
+
 // Scale a plane.
 // This function dispatches to a specialized scaler based on scale factor.
 
@@ -1417,6 +1588,11 @@ void ScalePlane(const uint8* src, int src_stride,
     CopyPlane(src, src_stride, dst, dst_stride, dst_width, dst_height);
     return;
   }
+  if (filtering == kFilterBicubic || filtering == kFilterLanczos) {
+    ScalePlanePolyphase(src_width, src_height, dst_width, dst_height,
+                        src_stride, dst_stride, src, dst, filtering);
+    return;
+  }
   if (dst_width == src_width && filtering != kFilterBox) {
     int dy = FixedDiv(src_height, dst_height);
     // Arbitrary scale vertically, but unscaled horizontally.
@@ -1500,6 +1676,11 @@ void ScalePlane_16(const uint16* src, int src_stride,
     CopyPlane_16(src, src_stride, dst, dst_stride, dst_width, dst_height);
     return;
   }
+  if (filtering == kFilterBicubic || filtering == kFilterLanczos) {
+    ScalePlanePolyphase_16(src_width, src_height, dst_width, dst_height,
+                           src_stride, dst_stride, src, dst, filtering);
+    return;
+  }
   if (dst_width == src_width) {
     int dy = FixedDiv(src_height, dst_height);
     // Arbitrary scale vertically, but unscaled vertically.
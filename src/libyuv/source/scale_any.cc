@@ -189,6 +189,56 @@ SAANY(ScaleAddRow_Any_NEON, ScaleAddRow_NEON, ScaleAddRow_C, 15)
 #endif
 #undef SAANY
 
+// Polyphase filter columns.
+#define PCANY(NAMEANY, COLS_SIMD, COLS_C, DTYPE, STYPE, MASK)                 \
+    void NAMEANY(DTYPE* dst_ptr, const STYPE* src_ptr, int dst_width,          \
+                 const int* filter_offsets, const int16* filter_coeffs,        \
+                 int filter_length) {                                          \
+      int n = dst_width & ~MASK;                                               \
+      if (n > 0) {                                                             \
+        COLS_SIMD(dst_ptr, src_ptr, n, filter_offsets, filter_coeffs,          \
+                  filter_length);                                              \
+      }                                                                        \
+      COLS_C(dst_ptr + n, src_ptr, dst_width & MASK, filter_offsets + n,       \
+             filter_coeffs + n * filter_length, filter_length);                \
+    }
+
+#ifdef HAS_SCALEPOLYPHASECOLS_AVX2
+PCANY(ScalePolyphaseCols_Any_AVX2, ScalePolyphaseCols_AVX2,
+      ScalePolyphaseCols_C, int16, uint8, 1)
+PCANY(ScalePolyphaseCols_16_Any_AVX2, ScalePolyphaseCols_16_AVX2,
+      ScalePolyphaseCols_16_C, uint16, uint16, 1)
+#endif
+#undef PCANY
+
+// Polyphase filter rows.
+#define PRANY(NAMEANY, ROWS_SIMD, ROWS_C, STYPE, DTYPE, MASK)                  \
+    void NAMEANY(const STYPE* src_ptr, ptrdiff_t src_stride,                   \
+                 DTYPE* dst_ptr, const int16* filter_coeffs,                   \
+                 int filter_length, int dst_width) {                           \
+      int n = dst_width & ~MASK;                                               \
+      if (n > 0) {                                                             \
+        ROWS_SIMD(src_ptr, src_stride, dst_ptr, filter_coeffs,                 \
+                  filter_length, n);                                           \
+      }                                                                        \
+      ROWS_C(src_ptr + n, src_stride, dst_ptr + n, filter_coeffs,              \
+             filter_length, dst_width & MASK);                                 \
+    }
+
+#ifdef HAS_SCALEPOLYPHASEROWS_SSE2
+PRANY(ScalePolyphaseRows_Any_SSE2, ScalePolyphaseRows_SSE2,
+      ScalePolyphaseRows_C, int16, uint8, 7)
+PRANY(ScalePolyphaseRows_16_Any_SSE2, ScalePolyphaseRows_16_SSE2,
+      ScalePolyphaseRows_16_C, uint16, uint16, 7)
+#endif
+#ifdef HAS_SCALEPOLYPHASEROWS_AVX2
+PRANY(ScalePolyphaseRows_Any_AVX2, ScalePolyphaseRows_AVX2,
+      ScalePolyphaseRows_C, int16, uint8, 15)
+PRANY(ScalePolyphaseRows_16_Any_AVX2, ScalePolyphaseRows_16_AVX2,
+      ScalePolyphaseRows_16_C, uint16, uint16, 15)
+#endif
+#undef PRANY
+
 #ifdef __cplusplus
 }  // extern "C"
 }  // namespace libyuv
@@ -713,6 +713,10 @@ static void ScaleARGB(const uint8* src, int src_stride,
   int dx = 0;
   int dy = 0;
   // ARGB does not support box filter yet, but allow the user to pass it.
+  // Polyphase filters are planar only, so ARGB uses box instead.
+  if (filtering == kFilterBicubic || filtering == kFilterLanczos) {
+    filtering = kFilterBox;
+  }
   // Simplify filtering when possible.
   filtering = ScaleFilterReduce(src_width, src_height,
                                 dst_width, dst_height,
@@ -11,6 +11,7 @@
 #include "libyuv/scale.h"
 
 #include <assert.h>
+#include <math.h>
 #include <string.h>
 
 #include "libyuv/cpu_id.h"
@@ -649,6 +650,80 @@ void ScaleAddRow_16_C(const uint16* src_ptr, uint32* dst_ptr, int src_width) {
   }
 }
 
+// Polyphase filters have 14 bit coefficients that sum to 16384.
+// 8 bit columns are filtered to 16 bits with 6 bits of fraction, which leaves
+// room for the overshoot of the negative lobes.
+void ScalePolyphaseCols_C(int16* dst_ptr, const uint8* src_ptr,
+                          int dst_width, const int* filter_offsets,
+                          const int16* filter_coeffs, int filter_length) {
+  int x;
+  for (x = 0; x < dst_width; ++x) {
+    const uint8* src = src_ptr + filter_offsets[x];
+    int sum = 0;
+    int i;
+    for (i = 0; i < filter_length; ++i) {
+      sum += src[i] * filter_coeffs[i];
+    }
+    sum = (sum + 128) >> 8;
+    dst_ptr[x] = sum < -32768 ? -32768 : (sum > 32767 ? 32767 : sum);
+    filter_coeffs += filter_length;
+  }
+}
+
+// 16 bit columns are filtered back to 16 bits, clamped to 0 to 65535.
+// Pixels are biased by -32768 so they can be multiplied as signed values.
+void ScalePolyphaseCols_16_C(uint16* dst_ptr, const uint16* src_ptr,
+                             int dst_width, const int* filter_offsets,
+                             const int16* filter_coeffs, int filter_length) {
+  int x;
+  for (x = 0; x < dst_width; ++x) {
+    const uint16* src = src_ptr + filter_offsets[x];
+    int sum = 1 << 29;
+    int i;
+    for (i = 0; i < filter_length; ++i) {
+      sum += (src[i] - 32768) * filter_coeffs[i];
+    }
+    sum = (sum + 8192) >> 14;
+    dst_ptr[x] = sum < 0 ? 0 : (sum > 65535 ? 65535 : sum);
+    filter_coeffs += filter_length;
+  }
+}
+
+// Filter filter_length rows of columns to a row of pixels.
+void ScalePolyphaseRows_C(const int16* src_ptr, ptrdiff_t src_stride,
+                          uint8* dst_ptr, const int16* filter_coeffs,
+                          int filter_length, int dst_width) {
+  int x;
+  for (x = 0; x < dst_width; ++x) {
+    const int16* src = src_ptr + x;
+    int sum = 0;
+    int i;
+    for (i = 0; i < filter_length; ++i) {
+      sum += src[0] * filter_coeffs[i];
+      src += src_stride;
+    }
+    sum = (sum + (1 << 19)) >> 20;
+    dst_ptr[x] = sum < 0 ? 0 : (sum > 255 ? 255 : sum);
+  }
+}
+
+void ScalePolyphaseRows_16_C(const uint16* src_ptr, ptrdiff_t src_stride,
+                             uint16* dst_ptr, const int16* filter_coeffs,
+                             int filter_length, int dst_width) {
+  int x;
+  for (x = 0; x < dst_width; ++x) {
+    const uint16* src = src_ptr + x;
+    int sum = 1 << 29;
+    int i;
+    for (i = 0; i < filter_length; ++i) {
+      sum += (src[0] - 32768) * filter_coeffs[i];
+      src += src_stride;
+    }
+    sum = (sum + 8192) >> 14;
+    dst_ptr[x] = sum < 0 ? 0 : (sum > 65535 ? 65535 : sum);
+  }
+}
+
 void ScaleARGBRowDown2_C(const uint8* src_argb,
                          ptrdiff_t src_stride,
                          uint8* dst_argb, int dst_width) {
@@ -1131,6 +1206,121 @@ void ScaleSlope(int src_width, int src_height,
 }
 #undef CENTERSTART
 
+// Radius of the polyphase filter kernel in source pixels, when upsampling.
+static double PolyphaseRadius(enum FilterMode filtering) {
+  return filtering == kFilterBicubic ? 2.0 : 3.0;
+}
+
+// Bicubic is Catmull-Rom (a = -0.5). Lanczos uses 3 lobes.
+static double PolyphaseKernel(double x, enum FilterMode filtering) {
+  const double kPi = 3.14159265358979323846;
+  x = fabs(x);
+  if (filtering == kFilterBicubic) {
+    if (x < 1.0) {
+      return (1.5 * x - 2.5) * x * x + 1.0;
+    }
+    if (x < 2.0) {
+      return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    }
+    return 0.0;
+  }
+  if (x < 1e-8) {
+    return 1.0;
+  }
+  if (x < 3.0) {
+    double px = kPi * x;
+    return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+  }
+  return 0.0;
+}
+
+// When downsampling the kernel is stretched to cover the source pixels.
+static double PolyphaseSupport(int src_size, int dst_size,
+                               enum FilterMode filtering) {
+  double scale = (double)src_size / dst_size;
+  return PolyphaseRadius(filtering) * (scale > 1.0 ? scale : 1.0);
+}
+
+int ScalePolyphaseFilterLength(int src_size, int dst_size,
+                               enum FilterMode filtering, int align) {
+  int filter_length;
+  src_size = Abs(src_size);
+  filter_length = (int)(ceil(2.0 * PolyphaseSupport(src_size, dst_size,
+                                                    filtering)));
+  filter_length = (filter_length + align - 1) / align * align;
+  return filter_length < src_size ? filter_length : src_size;
+}
+
+void ScalePolyphaseFilter(int src_size, int dst_size,
+                          enum FilterMode filtering, int filter_length,
+                          int* filter_offsets, int16* filter_coeffs) {
+  const int kOne = 1 << 14;
+  double scale;
+  double support;
+  double fscale;
+  int taps;
+  int i;
+  int mirror = src_size < 0;
+  align_buffer_64(weights_mem, filter_length * sizeof(double));
+  double* weights = (double*)(weights_mem);
+  src_size = Abs(src_size);
+  scale = (double)src_size / dst_size;
+  support = PolyphaseSupport(src_size, dst_size, filtering);
+  fscale = scale > 1.0 ? scale : 1.0;
+  taps = (int)(ceil(2.0 * support));
+  for (i = 0; i < dst_size; ++i) {
+    double center = (i + 0.5) * scale - 0.5;
+    int left = (int)(floor(center - support)) + 1;
+    int start = left;
+    double sum = 0.0;
+    int fixed_sum = 0;
+    int largest = 0;
+    int16* coeffs = filter_coeffs + i * filter_length;
+    int j;
+    if (start > src_size - filter_length) {
+      start = src_size - filter_length;
+    }
+    if (start < 0) {
+      start = 0;
+    }
+    memset(weights, 0, filter_length * sizeof(double));
+    // Taps off the edges are folded onto the edge pixels.
+    for (j = 0; j < taps; ++j) {
+      int x = left + j;
+      double w = PolyphaseKernel((x - center) / fscale, filtering);
+      if (x < 0) {
+        x = 0;
+      }
+      if (x > src_size - 1) {
+        x = src_size - 1;
+      }
+      weights[x - start] += w;
+      sum += w;
+    }
+    for (j = 0; j < filter_length; ++j) {
+      int c = (int)(floor(weights[j] / sum * kOne + 0.5));
+      coeffs[j] = (int16)(c);
+      fixed_sum += c;
+      if (c > coeffs[largest]) {
+        largest = j;
+      }
+    }
+    // Rounding error goes on the largest tap so the filter sums to 1.
+    coeffs[largest] = (int16)(coeffs[largest] + kOne - fixed_sum);
+    if (mirror) {
+      int k;
+      for (k = 0; k < filter_length / 2; ++k) {
+        int16 c = coeffs[k];
+        coeffs[k] = coeffs[filter_length - 1 - k];
+        coeffs[filter_length - 1 - k] = c;
+      }
+      start = src_size - filter_length - start;
+    }
+    filter_offsets[i] = start;
+  }
+  free_aligned_buffer_64(weights_mem);
+}
+
 #ifdef __cplusplus
 }  // extern "C"
 }  // namespace libyuv
@@ -9,6 +9,7 @@
  */
 
 #include "libyuv/row.h"
+#include "libyuv/scale_row.h"
 
 #ifdef __cplusplus
 namespace libyuv {
@@ -1048,6 +1049,539 @@ void ScaleARGBFilterCols_SSSE3(uint8* dst_argb, const uint8* src_argb,
   );
 }
 
+#ifdef HAS_SCALEPOLYPHASECOLS_SSSE3
+// Each destination pixel is a dot product of filter_length source pixels,
+// 8 at a time, with its coefficients. filter_length is a multiple of 8.
+void ScalePolyphaseCols_SSSE3(int16* dst_ptr, const uint8* src_ptr,
+                              int dst_width, const int* filter_offsets,
+                              const int16* filter_coeffs, int filter_length) {
+  intptr_t src;
+  intptr_t count;
+  asm volatile (
+    "pxor      %%xmm5,%%xmm5                   \n"
+    "mov       $0x80,%k4                       \n"
+    "movd      %k4,%%xmm4                      \n"
+    "pshufd    $0x0,%%xmm4,%%xmm4              \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "movslq    (%1),%4                         \n"
+    "add       %6,%4                           \n"
+    "mov       %7,%5                           \n"
+    "pxor      %%xmm0,%%xmm0                   \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "movq      (%4),%%xmm1                     \n"
+    "movdqu    (%2),%%xmm2                     \n"
+    "punpcklbw %%xmm5,%%xmm1                   \n"
+    "pmaddwd   %%xmm2,%%xmm1                   \n"
+    "paddd     %%xmm1,%%xmm0                   \n"
+    "lea       0x8(%4),%4                      \n"
+    "lea       0x10(%2),%2                     \n"
+    "sub       $0x8,%5                         \n"
+    "jg        2b                              \n"
+
+    "phaddd    %%xmm0,%%xmm0                   \n"
+    "phaddd    %%xmm0,%%xmm0                   \n"
+    "paddd     %%xmm4,%%xmm0                   \n"
+    "psrad     $0x8,%%xmm0                     \n"
+    "packssdw  %%xmm0,%%xmm0                   \n"
+    "movd      %%xmm0,%k4                      \n"
+    "mov       %w4,(%0)                        \n"
+    "lea       0x2(%0),%0                      \n"
+    "lea       0x4(%1),%1                      \n"
+    "sub       $0x1,%3                         \n"
+    "jg        1b                              \n"
+  : "+r"(dst_ptr),         // %0
+    "+r"(filter_offsets),  // %1
+    "+r"(filter_coeffs),   // %2
+    "+r"(dst_width),       // %3
+    "=&r"(src),            // %4
+    "=&r"(count)           // %5
+  : "r"(src_ptr),          // %6
+    "r"((intptr_t)(filter_length))  // %7
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm4", "xmm5"
+  );
+}
+
+// 16 bit pixels are biased by -32768 to multiply as signed.
+void ScalePolyphaseCols_16_SSSE3(uint16* dst_ptr, const uint16* src_ptr,
+                                 int dst_width, const int* filter_offsets,
+                                 const int16* filter_coeffs,
+                                 int filter_length) {
+  intptr_t src;
+  intptr_t count;
+  asm volatile (
+    "mov       $0x80008000,%k4                 \n"
+    "movd      %k4,%%xmm5                      \n"
+    "pshufd    $0x0,%%xmm5,%%xmm5              \n"
+    "mov       $0x20002000,%k4                 \n"
+    "movd      %k4,%%xmm4                      \n"
+    "pshufd    $0x0,%%xmm4,%%xmm4              \n"
+    "mov       $0x8000,%k4                     \n"
+    "movd      %k4,%%xmm3                      \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "movslq    (%1),%4                         \n"
+    "lea       (%6,%4,2),%4                    \n"
+    "mov       %7,%5                           \n"
+    "pxor      %%xmm0,%%xmm0                   \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "movdqu    (%4),%%xmm1                     \n"
+    "movdqu    (%2),%%xmm2                     \n"
+    "pxor      %%xmm5,%%xmm1                   \n"
+    "pmaddwd   %%xmm2,%%xmm1                   \n"
+    "paddd     %%xmm1,%%xmm0                   \n"
+    "lea       0x10(%4),%4                     \n"
+    "lea       0x10(%2),%2                     \n"
+    "sub       $0x8,%5                         \n"
+    "jg        2b                              \n"
+
+    "phaddd    %%xmm0,%%xmm0                   \n"
+    "phaddd    %%xmm0,%%xmm0                   \n"
+    "paddd     %%xmm4,%%xmm0                   \n"
+    "psrad     $0xe,%%xmm0                     \n"
+    "psubd     %%xmm3,%%xmm0                   \n"
+    "packssdw  %%xmm0,%%xmm0                   \n"
+    "pxor      %%xmm5,%%xmm0                   \n"
+    "movd      %%xmm0,%k4                      \n"
+    "mov       %w4,(%0)                        \n"
+    "lea       0x2(%0),%0                      \n"
+    "lea       0x4(%1),%1                      \n"
+    "sub       $0x1,%3                         \n"
+    "jg        1b                              \n"
+  : "+r"(dst_ptr),         // %0
+    "+r"(filter_offsets),  // %1
+    "+r"(filter_coeffs),   // %2
+    "+r"(dst_width),       // %3
+    "=&r"(src),            // %4
+    "=&r"(count)           // %5
+  : "r"(src_ptr),          // %6
+    "r"((intptr_t)(filter_length))  // %7
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5"
+  );
+}
+#endif  // HAS_SCALEPOLYPHASECOLS_SSSE3
+
+#ifdef HAS_SCALEPOLYPHASEROWS_SSE2
+// Columns of filter_length rows are multiplied a pair of rows at a time.
+// filter_length is even.
+void ScalePolyphaseRows_SSE2(const int16* src_ptr, ptrdiff_t src_stride,
+                             uint8* dst_ptr, const int16* filter_coeffs,
+                             int filter_length, int dst_width) {
+  intptr_t src;
+  intptr_t coeffs;
+  intptr_t count;
+  asm volatile (
+    "mov       $0x80000,%k3                    \n"
+    "movd      %k3,%%xmm7                      \n"
+    "pshufd    $0x0,%%xmm7,%%xmm7              \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "mov       %0,%3                           \n"
+    "mov       %7,%4                           \n"
+    "mov       %8,%5                           \n"
+    "pxor      %%xmm0,%%xmm0                   \n"
+    "pxor      %%xmm1,%%xmm1                   \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "movdqu    (%3),%%xmm2                     \n"
+    "movdqu    (%3,%6,2),%%xmm3                \n"
+    "movdqa    %%xmm2,%%xmm4                   \n"
+    "punpcklwd %%xmm3,%%xmm2                   \n"
+    "punpckhwd %%xmm3,%%xmm4                   \n"
+    "movd      (%4),%%xmm5                     \n"
+    "pshufd    $0x0,%%xmm5,%%xmm5              \n"
+    "pmaddwd   %%xmm5,%%xmm2                   \n"
+    "pmaddwd   %%xmm5,%%xmm4                   \n"
+    "paddd     %%xmm2,%%xmm0                   \n"
+    "paddd     %%xmm4,%%xmm1                   \n"
+    "lea       (%3,%6,4),%3                    \n"
+    "lea       0x4(%4),%4                      \n"
+    "sub       $0x2,%5                         \n"
+    "jg        2b                              \n"
+
+    "paddd     %%xmm7,%%xmm0                   \n"
+    "paddd     %%xmm7,%%xmm1                   \n"
+    "psrad     $0x14,%%xmm0                    \n"
+    "psrad     $0x14,%%xmm1                    \n"
+    "packssdw  %%xmm1,%%xmm0                   \n"
+    "packuswb  %%xmm0,%%xmm0                   \n"
+    "movq      %%xmm0,(%1)                     \n"
+    "lea       0x10(%0),%0                     \n"
+    "lea       0x8(%1),%1                      \n"
+    "sub       $0x8,%2                         \n"
+    "jg        1b                              \n"
+  : "+r"(src_ptr),         // %0
+    "+r"(dst_ptr),         // %1
+    "+r"(dst_width),       // %2
+    "=&r"(src),            // %3
+    "=&r"(coeffs),         // %4
+    "=&r"(count)           // %5
+  : "r"((intptr_t)(src_stride)),     // %6
+    "r"(filter_coeffs),              // %7
+    "r"((intptr_t)(filter_length))   // %8
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm7"
+  );
+}
+
+void ScalePolyphaseRows_16_SSE2(const uint16* src_ptr, ptrdiff_t src_stride,
+                                uint16* dst_ptr, const int16* filter_coeffs,
+                                int filter_length, int dst_width) {
+  intptr_t src;
+  intptr_t coeffs;
+  intptr_t count;
+  asm volatile (
+    "mov       $0x80008000,%k3                 \n"
+    "movd      %k3,%%xmm6                      \n"
+    "pshufd    $0x0,%%xmm6,%%xmm6              \n"
+    "mov       $0x20002000,%k3                 \n"
+    "movd      %k3,%%xmm7                      \n"
+    "pshufd    $0x0,%%xmm7,%%xmm7              \n"
+    "mov       $0x8000,%k3                     \n"
+    "movd      %k3,%%xmm8                      \n"
+    "pshufd    $0x0,%%xmm8,%%xmm8              \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "mov       %0,%3                           \n"
+    "mov       %7,%4                           \n"
+    "mov       %8,%5                           \n"
+    "pxor      %%xmm0,%%xmm0                   \n"
+    "pxor      %%xmm1,%%xmm1                   \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "movdqu    (%3),%%xmm2                     \n"
+    "movdqu    (%3,%6,2),%%xmm3                \n"
+    "pxor      %%xmm6,%%xmm2                   \n"
+    "pxor      %%xmm6,%%xmm3                   \n"
+    "movdqa    %%xmm2,%%xmm4                   \n"
+    "punpcklwd %%xmm3,%%xmm2                   \n"
+    "punpckhwd %%xmm3,%%xmm4                   \n"
+    "movd      (%4),%%xmm5                     \n"
+    "pshufd    $0x0,%%xmm5,%%xmm5              \n"
+    "pmaddwd   %%xmm5,%%xmm2                   \n"
+    "pmaddwd   %%xmm5,%%xmm4                   \n"
+    "paddd     %%xmm2,%%xmm0                   \n"
+    "paddd     %%xmm4,%%xmm1                   \n"
+    "lea       (%3,%6,4),%3                    \n"
+    "lea       0x4(%4),%4                      \n"
+    "sub       $0x2,%5                         \n"
+    "jg        2b                              \n"
+
+    "paddd     %%xmm7,%%xmm0                   \n"
+    "paddd     %%xmm7,%%xmm1                   \n"
+    "psrad     $0xe,%%xmm0                     \n"
+    "psrad     $0xe,%%xmm1                     \n"
+    "psubd     %%xmm8,%%xmm0                   \n"
+    "psubd     %%xmm8,%%xmm1                   \n"
+    "packssdw  %%xmm1,%%xmm0                   \n"
+    "pxor      %%xmm6,%%xmm0                   \n"
+    "movdqu    %%xmm0,(%1)                     \n"
+    "lea       0x10(%0),%0                     \n"
+    "lea       0x10(%1),%1                     \n"
+    "sub       $0x8,%2                         \n"
+    "jg        1b                              \n"
+  : "+r"(src_ptr),         // %0
+    "+r"(dst_ptr),         // %1
+    "+r"(dst_width),       // %2
+    "=&r"(src),            // %3
+    "=&r"(coeffs),         // %4
+    "=&r"(count)           // %5
+  : "r"((intptr_t)(src_stride)),     // %6
+    "r"(filter_coeffs),              // %7
+    "r"((intptr_t)(filter_length))   // %8
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+    "xmm7", "xmm8"
+  );
+}
+#endif  // HAS_SCALEPOLYPHASEROWS_SSE2
+
+#ifdef HAS_SCALEPOLYPHASECOLS_AVX2
+// 2 destination pixels at a time, one in each lane.
+void ScalePolyphaseCols_AVX2(int16* dst_ptr, const uint8* src_ptr,
+                             int dst_width, const int* filter_offsets,
+                             const int16* filter_coeffs, int filter_length) {
+  intptr_t src0;
+  intptr_t src1;
+  intptr_t coeffs1;
+  intptr_t count;
+  asm volatile (
+    "vpxor      %%ymm5,%%ymm5,%%ymm5           \n"
+    "mov        $0x80,%k4                      \n"
+    "vmovd      %k4,%%xmm4                     \n"
+    "vpbroadcastd %%xmm4,%%ymm4                \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "movslq     (%1),%4                        \n"
+    "movslq     0x4(%1),%5                     \n"
+    "add        %8,%4                          \n"
+    "add        %8,%5                          \n"
+    "lea        (%2,%9,2),%6                   \n"
+    "mov        %9,%7                          \n"
+    "vpxor      %%ymm0,%%ymm0,%%ymm0           \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "vmovq      (%4),%%xmm1                    \n"
+    "vmovq      (%5),%%xmm2                    \n"
+    "vinserti128 $0x1,%%xmm2,%%ymm1,%%ymm1     \n"
+    "vpunpcklbw %%ymm5,%%ymm1,%%ymm1           \n"
+    "vmovdqu    (%2),%%xmm2                    \n"
+    "vinserti128 $0x1,(%6),%%ymm2,%%ymm2       \n"
+    "vpmaddwd   %%ymm2,%%ymm1,%%ymm1           \n"
+    "vpaddd     %%ymm1,%%ymm0,%%ymm0           \n"
+    "lea        0x8(%4),%4                     \n"
+    "lea        0x8(%5),%5                     \n"
+    "lea        0x10(%2),%2                    \n"
+    "lea        0x10(%6),%6                    \n"
+    "sub        $0x8,%7                        \n"
+    "jg         2b                             \n"
+
+    "mov        %6,%2                          \n"
+    "vphaddd    %%ymm0,%%ymm0,%%ymm0           \n"
+    "vphaddd    %%ymm0,%%ymm0,%%ymm0           \n"
+    "vpaddd     %%ymm4,%%ymm0,%%ymm0           \n"
+    "vpsrad     $0x8,%%ymm0,%%ymm0             \n"
+    "vextracti128 $0x1,%%ymm0,%%xmm1           \n"
+    "vpunpckldq %%xmm1,%%xmm0,%%xmm0           \n"
+    "vpackssdw  %%xmm0,%%xmm0,%%xmm0           \n"
+    "vmovd      %%xmm0,(%0)                    \n"
+    "lea        0x4(%0),%0                     \n"
+    "lea        0x8(%1),%1                     \n"
+    "sub        $0x2,%3                        \n"
+    "jg         1b                             \n"
+    "vzeroupper                                \n"
+  : "+r"(dst_ptr),         // %0
+    "+r"(filter_offsets),  // %1
+    "+r"(filter_coeffs),   // %2
+    "+r"(dst_width),       // %3
+    "=&r"(src0),           // %4
+    "=&r"(src1),           // %5
+    "=&r"(coeffs1),        // %6
+    "=&r"(count)           // %7
+  : "r"(src_ptr),          // %8
+    "r"((intptr_t)(filter_length))  // %9
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm4", "xmm5"
+  );
+}
+
+void ScalePolyphaseCols_16_AVX2(uint16* dst_ptr, const uint16* src_ptr,
+                                int dst_width, const int* filter_offsets,
+                                const int16* filter_coeffs,
+                                int filter_length) {
+  intptr_t src0;
+  intptr_t src1;
+  intptr_t coeffs1;
+  intptr_t count;
+  asm volatile (
+    "mov        $0x80008000,%k4                \n"
+    "vmovd      %k4,%%xmm5                     \n"
+    "vpbroadcastd %%xmm5,%%ymm5                \n"
+    "mov        $0x20002000,%k4                \n"
+    "vmovd      %k4,%%xmm4                     \n"
+    "vpbroadcastd %%xmm4,%%ymm4                \n"
+    "mov        $0x8000,%k4                    \n"
+    "vmovd      %k4,%%xmm3                     \n"
+    "vpbroadcastd %%xmm3,%%ymm3                \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "movslq     (%1),%4                        \n"
+    "movslq     0x4(%1),%5                     \n"
+    "lea        (%8,%4,2),%4                   \n"
+    "lea        (%8,%5,2),%5                   \n"
+    "lea        (%2,%9,2),%6                   \n"
+    "mov        %9,%7                          \n"
+    "vpxor      %%ymm0,%%ymm0,%%ymm0           \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "vmovdqu    (%4),%%xmm1                    \n"
+    "vinserti128 $0x1,(%5),%%ymm1,%%ymm1       \n"
+    "vpxor      %%ymm5,%%ymm1,%%ymm1           \n"
+    "vmovdqu    (%2),%%xmm2                    \n"
+    "vinserti128 $0x1,(%6),%%ymm2,%%ymm2       \n"
+    "vpmaddwd   %%ymm2,%%ymm1,%%ymm1           \n"
+    "vpaddd     %%ymm1,%%ymm0,%%ymm0           \n"
+    "lea        0x10(%4),%4                    \n"
+    "lea        0x10(%5),%5                    \n"
+    "lea        0x10(%2),%2                    \n"
+    "lea        0x10(%6),%6                    \n"
+    "sub        $0x8,%7                        \n"
+    "jg         2b                             \n"
+
+    "mov        %6,%2                          \n"
+    "vphaddd    %%ymm0,%%ymm0,%%ymm0           \n"
+    "vphaddd    %%ymm0,%%ymm0,%%ymm0           \n"
+    "vpaddd     %%ymm4,%%ymm0,%%ymm0           \n"
+    "vpsrad     $0xe,%%ymm0,%%ymm0             \n"
+    "vpsubd     %%ymm3,%%ymm0,%%ymm0           \n"
+    "vextracti128 $0x1,%%ymm0,%%xmm1           \n"
+    "vpunpckldq %%xmm1,%%xmm0,%%xmm0           \n"
+    "vpackssdw  %%xmm0,%%xmm0,%%xmm0           \n"
+    "vpxor      %%xmm5,%%xmm0,%%xmm0           \n"
+    "vmovd      %%xmm0,(%0)                    \n"
+    "lea        0x4(%0),%0                     \n"
+    "lea        0x8(%1),%1                     \n"
+    "sub        $0x2,%3                        \n"
+    "jg         1b                             \n"
+    "vzeroupper                                \n"
+  : "+r"(dst_ptr),         // %0
+    "+r"(filter_offsets),  // %1
+    "+r"(filter_coeffs),   // %2
+    "+r"(dst_width),       // %3
+    "=&r"(src0),           // %4
+    "=&r"(src1),           // %5
+    "=&r"(coeffs1),        // %6
+    "=&r"(count)           // %7
+  : "r"(src_ptr),          // %8
+    "r"((intptr_t)(filter_length))  // %9
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5"
+  );
+}
+#endif  // HAS_SCALEPOLYPHASECOLS_AVX2
+
+#ifdef HAS_SCALEPOLYPHASEROWS_AVX2
+void ScalePolyphaseRows_AVX2(const int16* src_ptr, ptrdiff_t src_stride,
+                             uint8* dst_ptr, const int16* filter_coeffs,
+                             int filter_length, int dst_width) {
+  intptr_t src;
+  intptr_t coeffs;
+  intptr_t count;
+  asm volatile (
+    "mov        $0x80000,%k3                   \n"
+    "vmovd      %k3,%%xmm7                     \n"
+    "vpbroadcastd %%xmm7,%%ymm7                \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "mov        %0,%3                          \n"
+    "mov        %7,%4                          \n"
+    "mov        %8,%5                          \n"
+    "vpxor      %%ymm0,%%ymm0,%%ymm0           \n"
+    "vpxor      %%ymm1,%%ymm1,%%ymm1           \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "vmovdqu    (%3),%%ymm2                    \n"
+    "vmovdqu    (%3,%6,2),%%ymm3               \n"
+    "vpunpckhwd %%ymm3,%%ymm2,%%ymm4           \n"
+    "vpunpcklwd %%ymm3,%%ymm2,%%ymm2           \n"
+    "vpbroadcastd (%4),%%ymm5                  \n"
+    "vpmaddwd   %%ymm5,%%ymm2,%%ymm2           \n"
+    "vpmaddwd   %%ymm5,%%ymm4,%%ymm4           \n"
+    "vpaddd     %%ymm2,%%ymm0,%%ymm0           \n"
+    "vpaddd     %%ymm4,%%ymm1,%%ymm1           \n"
+    "lea        (%3,%6,4),%3                   \n"
+    "lea        0x4(%4),%4                     \n"
+    "sub        $0x2,%5                        \n"
+    "jg         2b                             \n"
+
+    "vpaddd     %%ymm7,%%ymm0,%%ymm0           \n"
+    "vpaddd     %%ymm7,%%ymm1,%%ymm1           \n"
+    "vpsrad     $0x14,%%ymm0,%%ymm0            \n"
+    "vpsrad     $0x14,%%ymm1,%%ymm1            \n"
+    "vpackssdw  %%ymm1,%%ymm0,%%ymm0           \n"
+    "vpackuswb  %%ymm0,%%ymm0,%%ymm0           \n"
+    "vpermq     $0xd8,%%ymm0,%%ymm0            \n"
+    "vmovdqu    %%xmm0,(%1)                    \n"
+    "lea        0x20(%0),%0                    \n"
+    "lea        0x10(%1),%1                    \n"
+    "sub        $0x10,%2                       \n"
+    "jg         1b                             \n"
+    "vzeroupper                                \n"
+  : "+r"(src_ptr),         // %0
+    "+r"(dst_ptr),         // %1
+    "+r"(dst_width),       // %2
+    "=&r"(src),            // %3
+    "=&r"(coeffs),         // %4
+    "=&r"(count)           // %5
+  : "r"((intptr_t)(src_stride)),     // %6
+    "r"(filter_coeffs),              // %7
+    "r"((intptr_t)(filter_length))   // %8
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm7"
+  );
+}
+
+void ScalePolyphaseRows_16_AVX2(const uint16* src_ptr, ptrdiff_t src_stride,
+                                uint16* dst_ptr, const int16* filter_coeffs,
+                                int filter_length, int dst_width) {
+  intptr_t src;
+  intptr_t coeffs;
+  intptr_t count;
+  asm volatile (
+    "mov        $0x80008000,%k3                \n"
+    "vmovd      %k3,%%xmm6                     \n"
+    "vpbroadcastd %%xmm6,%%ymm6                \n"
+    "mov        $0x20002000,%k3                \n"
+    "vmovd      %k3,%%xmm7                     \n"
+    "vpbroadcastd %%xmm7,%%ymm7                \n"
+    "mov        $0x8000,%k3                    \n"
+    "vmovd      %k3,%%xmm8                     \n"
+    "vpbroadcastd %%xmm8,%%ymm8                \n"
+
+    LABELALIGN
+  "1:                                          \n"
+    "mov        %0,%3                          \n"
+    "mov        %7,%4                          \n"
+    "mov        %8,%5                          \n"
+    "vpxor      %%ymm0,%%ymm0,%%ymm0           \n"
+    "vpxor      %%ymm1,%%ymm1,%%ymm1           \n"
+
+    LABELALIGN
+  "2:                                          \n"
+    "vpxor      (%3),%%ymm6,%%ymm2             \n"
+    "vpxor      (%3,%6,2),%%ymm6,%%ymm3        \n"
+    "vpunpckhwd %%ymm3,%%ymm2,%%ymm4           \n"
+    "vpunpcklwd %%ymm3,%%ymm2,%%ymm2           \n"
+    "vpbroadcastd (%4),%%ymm5                  \n"
+    "vpmaddwd   %%ymm5,%%ymm2,%%ymm2           \n"
+    "vpmaddwd   %%ymm5,%%ymm4,%%ymm4           \n"
+    "vpaddd     %%ymm2,%%ymm0,%%ymm0           \n"
+    "vpaddd     %%ymm4,%%ymm1,%%ymm1           \n"
+    "lea        (%3,%6,4),%3                   \n"
+    "lea        0x4(%4),%4                     \n"
+    "sub        $0x2,%5                        \n"
+    "jg         2b                             \n"
+
+    "vpaddd     %%ymm7,%%ymm0,%%ymm0           \n"
+    "vpaddd     %%ymm7,%%ymm1,%%ymm1           \n"
+    "vpsrad     $0xe,%%ymm0,%%ymm0             \n"
+    "vpsrad     $0xe,%%ymm1,%%ymm1             \n"
+    "vpsubd     %%ymm8,%%ymm0,%%ymm0           \n"
+    "vpsubd     %%ymm8,%%ymm1,%%ymm1           \n"
+    "vpackssdw  %%ymm1,%%ymm0,%%ymm0           \n"
+    "vpxor      %%ymm6,%%ymm0,%%ymm0           \n"
+    "vmovdqu    %%ymm0,(%1)                    \n"
+    "lea        0x20(%0),%0                    \n"
+    "lea        0x20(%1),%1                    \n"
+    "sub        $0x10,%2                       \n"
+    "jg         1b                             \n"
+    "vzeroupper                                \n"
+  : "+r"(src_ptr),         // %0
+    "+r"(dst_ptr),         // %1
+    "+r"(dst_width),       // %2
+    "=&r"(src),            // %3
+    "=&r"(coeffs),         // %4
+    "=&r"(count)           // %5
+  : "r"((intptr_t)(src_stride)),     // %6
+    "r"(filter_coeffs),              // %7
+    "r"((intptr_t)(filter_length))   // %8
+  : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+    "xmm7", "xmm8"
+  );
+}
+#endif  // HAS_SCALEPOLYPHASEROWS_AVX2
+
 // Divide num by div and return as 16.16 fixed point result.
 int FixedDiv_X86(int num, int div) {
   asm volatile (
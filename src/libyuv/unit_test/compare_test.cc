@@ -275,6 +275,131 @@ TEST_F(libyuvTest, SumSquareError) {
   free_aligned_buffer_64(src_b);
 }
 
+TEST_F(libyuvTest, TileHashes) {
+  const int kWidth = benchmark_width_ + 3;
+  const int kHeight = benchmark_height_ + 5;
+  const int kStride = kWidth + 16;
+  const int kTileSize = 32;
+  const int kTilesX = (kWidth + kTileSize - 1) / kTileSize;
+  const int kTilesY = (kHeight + kTileSize - 1) / kTileSize;
+  align_buffer_64(src_a, kStride * kHeight);
+  align_buffer_64(tile, kTileSize * kTileSize);
+  align_buffer_64(hashes, kTilesX * kTilesY * 4);
+  uint32* dst_hashes = reinterpret_cast<uint32*>(hashes);
+  for (int i = 0; i < kStride * kHeight; ++i) {
+    src_a[i] = (random() & 0xff);
+  }
+
+  for (int i = 0; i < benchmark_iterations_; ++i) {
+    EXPECT_EQ(0, ComputeTileHashes(src_a, kStride, kWidth, kHeight, kTileSize,
+                                   dst_hashes));
+  }
+  // Each hash matches the hash of the tile packed into a buffer.
+  for (int ty = 0; ty < kTilesY; ++ty) {
+    for (int tx = 0; tx < kTilesX; ++tx) {
+      int tile_width = kWidth - tx * kTileSize;
+      int tile_height = kHeight - ty * kTileSize;
+      if (tile_width > kTileSize) {
+        tile_width = kTileSize;
+      }
+      if (tile_height > kTileSize) {
+        tile_height = kTileSize;
+      }
+      for (int y = 0; y < tile_height; ++y) {
+        memcpy(tile + y * tile_width,
+               src_a + (ty * kTileSize + y) * kStride + tx * kTileSize,
+               tile_width);
+      }
+      EXPECT_EQ(ReferenceHashDjb2(tile, tile_width * tile_height, 5381),
+                dst_hashes[ty * kTilesX + tx]);
+    }
+  }
+
+  // Changing a pixel changes only the hash of its tile.
+  align_buffer_64(hashes2, kTilesX * kTilesY * 4);
+  uint32* dst_hashes2 = reinterpret_cast<uint32*>(hashes2);
+  const int kChangeX = kWidth - 1;
+  const int kChangeY = kHeight / 2;
+  ++src_a[kChangeY * kStride + kChangeX];
+  MaskCpuFlags(disable_cpu_flags_);
+  EXPECT_EQ(0, ComputeTileHashes(src_a, kStride, kWidth, kHeight, kTileSize,
+                                 dst_hashes2));
+  MaskCpuFlags(-1);
+  for (int i = 0; i < kTilesX * kTilesY; ++i) {
+    if (i == (kChangeY / kTileSize) * kTilesX + kChangeX / kTileSize) {
+      EXPECT_NE(dst_hashes[i], dst_hashes2[i]);
+    } else {
+      EXPECT_EQ(dst_hashes[i], dst_hashes2[i]);
+    }
+  }
+  EXPECT_EQ(-1, ComputeTileHashes(src_a, kStride, kWidth, kHeight, 0,
+                                  dst_hashes));
+
+  free_aligned_buffer_64(src_a);
+  free_aligned_buffer_64(tile);
+  free_aligned_buffer_64(hashes);
+  free_aligned_buffer_64(hashes2);
+}
+
+TEST_F(libyuvTest, TileSAD) {
+  const int kWidth = benchmark_width_ + 7;
+  const int kHeight = benchmark_height_ + 3;
+  const int kTileSize = 16 * 3;
+  const int kTilesX = (kWidth + kTileSize - 1) / kTileSize;
+  const int kTilesY = (kHeight + kTileSize - 1) / kTileSize;
+  align_buffer_64(src_a, kWidth * kHeight);
+  align_buffer_64(src_b, kWidth * kHeight);
+  align_buffer_64(sad_c, kTilesX * kTilesY * 4);
+  align_buffer_64(sad_opt, kTilesX * kTilesY * 4);
+  uint32* dst_sad_c = reinterpret_cast<uint32*>(sad_c);
+  uint32* dst_sad_opt = reinterpret_cast<uint32*>(sad_opt);
+
+  memset(src_a, 190, kWidth * kHeight);
+  memset(src_b, 193, kWidth * kHeight);
+  EXPECT_EQ(0, ComputeTileSAD(src_a, kWidth, src_b, kWidth, kWidth, kHeight,
+                              kTileSize, dst_sad_opt));
+  EXPECT_EQ(3u * kTileSize * kTileSize, dst_sad_opt[0]);
+
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    src_a[i] = (random() & 0xff);
+    src_b[i] = (random() & 0xff);
+  }
+  MaskCpuFlags(disable_cpu_flags_);
+  EXPECT_EQ(0, ComputeTileSAD(src_a, kWidth, src_b, kWidth, kWidth, kHeight,
+                              kTileSize, dst_sad_c));
+  MaskCpuFlags(-1);
+  for (int i = 0; i < benchmark_iterations_; ++i) {
+    EXPECT_EQ(0, ComputeTileSAD(src_a, kWidth, src_b, kWidth, kWidth, kHeight,
+                                kTileSize, dst_sad_opt));
+  }
+  for (int ty = 0; ty < kTilesY; ++ty) {
+    for (int tx = 0; tx < kTilesX; ++tx) {
+      uint32 sad = 0u;
+      for (int y = ty * kTileSize; y < (ty + 1) * kTileSize && y < kHeight;
+           ++y) {
+        for (int x = tx * kTileSize; x < (tx + 1) * kTileSize && x < kWidth;
+             ++x) {
+          sad += abs(src_a[y * kWidth + x] - src_b[y * kWidth + x]);
+        }
+      }
+      EXPECT_EQ(sad, dst_sad_c[ty * kTilesX + tx]);
+      EXPECT_EQ(sad, dst_sad_opt[ty * kTilesX + tx]);
+    }
+  }
+
+  // Identical planes have no differences.
+  EXPECT_EQ(0, ComputeTileSAD(src_a, kWidth, src_a, kWidth, kWidth, kHeight,
+                              kTileSize, dst_sad_opt));
+  for (int i = 0; i < kTilesX * kTilesY; ++i) {
+    EXPECT_EQ(0u, dst_sad_opt[i]);
+  }
+
+  free_aligned_buffer_64(src_a);
+  free_aligned_buffer_64(src_b);
+  free_aligned_buffer_64(sad_c);
+  free_aligned_buffer_64(sad_opt);
+}
+
 TEST_F(libyuvTest, BenchmarkPsnr_Opt) {
   align_buffer_64(src_a, benchmark_width_ * benchmark_height_);
   align_buffer_64(src_b, benchmark_width_ * benchmark_height_);
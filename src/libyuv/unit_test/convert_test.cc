@@ -8,9 +8,16 @@
  *  be found in the AUTHORS file in the root of the source tree.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+#ifdef HAVE_JPEG
+extern "C" {
+#include <jpeglib.h>
+}
+#endif
+
 #include "libyuv/compare.h"
 #include "libyuv/convert.h"
 #include "libyuv/convert_argb.h"
@@ -23,6 +30,7 @@
 #include "libyuv/planar_functions.h"
 #include "libyuv/rotate.h"
 #include "libyuv/row.h"
+#include "libyuv/scale.h"
 #include "libyuv/video_common.h"
 #include "../unit_test/unit_test.h"
 
@@ -1253,6 +1261,205 @@ TEST_F(libyuvTest, MJPGToARGB) {
   free_aligned_buffer_page_end(orig_pixels);
 }
 
+// Encodes a smooth 4:2:0 test frame with a restart marker after every
+// restart_rows MCU rows. Returns the size of the jpeg, which the caller
+// frees with free().
+static unsigned long EncodeTestJpeg(int width, int height, int restart_rows,
+                                    uint8** jpeg) {
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  unsigned long jpeg_size = 0;
+  *jpeg = NULL;
+  jpeg_mem_dest(&cinfo, jpeg, &jpeg_size);
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_YCbCr;
+  jpeg_set_defaults(&cinfo);
+  cinfo.restart_in_rows = restart_rows;
+  jpeg_start_compress(&cinfo, TRUE);
+  align_buffer_64(row, width * 3);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    int y = cinfo.next_scanline;
+    for (int x = 0; x < width; ++x) {
+      row[x * 3 + 0] = static_cast<uint8>((x + y) * 255 / (width + height));
+      row[x * 3 + 1] = static_cast<uint8>(64 + x * 128 / width);
+      row[x * 3 + 2] = static_cast<uint8>(64 + y * 128 / height);
+    }
+    JSAMPROW rows[1] = { row };
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+  free_aligned_buffer_64(row);
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return jpeg_size;
+}
+
+struct TestI420Band {
+  uint8* y;
+  uint8* u;
+  uint8* v;
+  int w;
+};
+
+static void TestCopyI420Band(void* opaque,
+                             const uint8* const* data,
+                             const int* strides,
+                             int rows) {
+  TestI420Band* dest = reinterpret_cast<TestI420Band*>(opaque);
+  int halfwidth = (dest->w + 1) >> 1;
+  I420Copy(data[0], strides[0], data[1], strides[1], data[2], strides[2],
+           dest->y, dest->w, dest->u, halfwidth, dest->v, halfwidth,
+           dest->w, rows);
+  dest->y += rows * dest->w;
+  dest->u += ((rows + 1) >> 1) * halfwidth;
+  dest->v += ((rows + 1) >> 1) * halfwidth;
+}
+
+TEST_F(libyuvTest, MJPGRestartBands) {
+  const int kWidth = 640;
+  const int kHeight = 480;
+  const int kHalfWidth = kWidth / 2;
+  const int kSizeUV = kHalfWidth * kHeight / 2;
+  uint8* jpeg = NULL;
+  unsigned long jpeg_size = EncodeTestJpeg(kWidth, kHeight, 1, &jpeg);
+  align_buffer_64(dst_y_c, kWidth * kHeight);
+  align_buffer_64(dst_u_c, kSizeUV);
+  align_buffer_64(dst_v_c, kSizeUV);
+  align_buffer_64(dst_y_opt, kWidth * kHeight);
+  align_buffer_64(dst_u_opt, kSizeUV);
+  align_buffer_64(dst_v_opt, kSizeUV);
+  memset(dst_y_opt, 1, kWidth * kHeight);
+  memset(dst_u_opt, 2, kSizeUV);
+  memset(dst_v_opt, 3, kSizeUV);
+
+  MJpegDecoder mjpeg_decoder;
+  EXPECT_TRUE(mjpeg_decoder.LoadFrame(jpeg, jpeg_size));
+  EXPECT_EQ(kWidth / 16, mjpeg_decoder.GetRestartInterval());
+  uint8* planes[3] = { dst_y_c, dst_u_c, dst_v_c };
+  EXPECT_TRUE(mjpeg_decoder.DecodeToBuffers(planes, kWidth, kHeight));
+
+  for (int times = 0; times < benchmark_iterations_; ++times) {
+    EXPECT_TRUE(mjpeg_decoder.LoadFrame(jpeg, jpeg_size));
+    EXPECT_EQ(4, mjpeg_decoder.SplitRestartBands(4));
+    TestI420Band bands[4];
+    void* opaques[4];
+    for (int band = 0; band < 4; ++band) {
+      int start = mjpeg_decoder.GetBandStartRow(band);
+      EXPECT_EQ(0, start & 15);
+      TestI420Band dest = { dst_y_opt + start * kWidth,
+                            dst_u_opt + start / 2 * kHalfWidth,
+                            dst_v_opt + start / 2 * kHalfWidth,
+                            kWidth };
+      bands[band] = dest;
+      opaques[band] = &bands[band];
+    }
+    EXPECT_TRUE(mjpeg_decoder.DecodeBandsToCallback(&TestCopyI420Band,
+                                                    opaques,
+                                                    kWidth, kHeight));
+  }
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    EXPECT_EQ(dst_y_c[i], dst_y_opt[i]);
+  }
+  for (int i = 0; i < kSizeUV; ++i) {
+    EXPECT_EQ(dst_u_c[i], dst_u_opt[i]);
+    EXPECT_EQ(dst_v_c[i], dst_v_opt[i]);
+  }
+
+  // A frame without restart markers is decoded as a single band.
+  free(jpeg);
+  jpeg_size = EncodeTestJpeg(kWidth, kHeight, 0, &jpeg);
+  EXPECT_TRUE(mjpeg_decoder.LoadFrame(jpeg, jpeg_size));
+  EXPECT_EQ(0, mjpeg_decoder.GetRestartInterval());
+  EXPECT_EQ(1, mjpeg_decoder.SplitRestartBands(4));
+  mjpeg_decoder.UnloadFrame();
+
+  free(jpeg);
+  free_aligned_buffer_64(dst_y_c);
+  free_aligned_buffer_64(dst_u_c);
+  free_aligned_buffer_64(dst_v_c);
+  free_aligned_buffer_64(dst_y_opt);
+  free_aligned_buffer_64(dst_u_opt);
+  free_aligned_buffer_64(dst_v_opt);
+}
+
+static void TestMJPGToI420Scaled(int dst_width, int dst_height,
+                                 int benchmark_iterations) {
+  const int kWidth = 640;
+  const int kHeight = 480;
+  const int kSizeUV = (kWidth / 2) * (kHeight / 2);
+  const int kDstHalfWidth = (dst_width + 1) / 2;
+  const int kDstSizeUV = kDstHalfWidth * ((dst_height + 1) / 2);
+  uint8* jpeg = NULL;
+  unsigned long jpeg_size = EncodeTestJpeg(kWidth, kHeight, 1, &jpeg);
+  align_buffer_64(full_y, kWidth * kHeight);
+  align_buffer_64(full_u, kSizeUV);
+  align_buffer_64(full_v, kSizeUV);
+  align_buffer_64(dst_y_c, dst_width * dst_height);
+  align_buffer_64(dst_u_c, kDstSizeUV);
+  align_buffer_64(dst_v_c, kDstSizeUV);
+  align_buffer_64(dst_y_opt, dst_width * dst_height);
+  align_buffer_64(dst_u_opt, kDstSizeUV);
+  align_buffer_64(dst_v_opt, kDstSizeUV);
+
+  // Reference is a full size decode followed by a box filter.
+  EXPECT_EQ(0, MJPGToI420(jpeg, jpeg_size,
+                          full_y, kWidth,
+                          full_u, kWidth / 2,
+                          full_v, kWidth / 2,
+                          kWidth, kHeight, kWidth, kHeight));
+  EXPECT_EQ(0, I420Scale(full_y, kWidth, full_u, kWidth / 2,
+                         full_v, kWidth / 2, kWidth, kHeight,
+                         dst_y_c, dst_width, dst_u_c, kDstHalfWidth,
+                         dst_v_c, kDstHalfWidth, dst_width, dst_height,
+                         kFilterBox));
+  for (int times = 0; times < benchmark_iterations; ++times) {
+    EXPECT_EQ(0, MJPGToI420Scaled(jpeg, jpeg_size,
+                                  dst_y_opt, dst_width,
+                                  dst_u_opt, kDstHalfWidth,
+                                  dst_v_opt, kDstHalfWidth,
+                                  kWidth, kHeight, dst_width, dst_height,
+                                  kFilterBox));
+  }
+  int max_diff = 0;
+  for (int i = 0; i < dst_width * dst_height; ++i) {
+    int abs_diff = Abs(dst_y_c[i] - dst_y_opt[i]);
+    max_diff = abs_diff > max_diff ? abs_diff : max_diff;
+  }
+  for (int i = 0; i < kDstSizeUV; ++i) {
+    int abs_diff = Abs(dst_u_c[i] - dst_u_opt[i]);
+    max_diff = abs_diff > max_diff ? abs_diff : max_diff;
+    abs_diff = Abs(dst_v_c[i] - dst_v_opt[i]);
+    max_diff = abs_diff > max_diff ? abs_diff : max_diff;
+  }
+  EXPECT_LE(max_diff, 4);
+
+  free(jpeg);
+  free_aligned_buffer_64(full_y);
+  free_aligned_buffer_64(full_u);
+  free_aligned_buffer_64(full_v);
+  free_aligned_buffer_64(dst_y_c);
+  free_aligned_buffer_64(dst_u_c);
+  free_aligned_buffer_64(dst_v_c);
+  free_aligned_buffer_64(dst_y_opt);
+  free_aligned_buffer_64(dst_u_opt);
+  free_aligned_buffer_64(dst_v_opt);
+}
+
+TEST_F(libyuvTest, MJPGToI420Scaled_Half) {
+  TestMJPGToI420Scaled(320, 240, benchmark_iterations_);
+}
+
+TEST_F(libyuvTest, MJPGToI420Scaled_Eighth) {
+  TestMJPGToI420Scaled(80, 60, benchmark_iterations_);
+}
+
+TEST_F(libyuvTest, MJPGToI420Scaled_Odd) {
+  TestMJPGToI420Scaled(150, 101, benchmark_iterations_);
+}
+
 #endif  // HAVE_JPEG
 
 TEST_F(libyuvTest, CropNV12) {
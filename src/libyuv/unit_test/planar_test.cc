@@ -1873,6 +1873,144 @@ TEST_F(libyuvTest, ARGBBlurSmall_Opt) {
   EXPECT_LE(max_diff, 1);
 }
 
+static int TestBoxBlur(int width, int height, int benchmark_iterations,
+                       int disable_cpu_flags, int invert, int off,
+                       int radius, int passes, const int kBpp) {
+  if (width < 1) {
+    width = 1;
+  }
+  const int kStride = width * kBpp;
+  align_buffer_64(src_a, kStride * height + off);
+  align_buffer_64(dst_c, kStride * height);
+  align_buffer_64(dst_opt, kStride * height);
+  srandom(time(NULL));
+  for (int i = 0; i < kStride * height; ++i) {
+    src_a[i + off] = (random() & 0xff);
+  }
+  memset(dst_c, 0, kStride * height);
+  memset(dst_opt, 0, kStride * height);
+
+  MaskCpuFlags(disable_cpu_flags);
+  if (kBpp == 4) {
+    ARGBBoxBlur(src_a + off, kStride, dst_c, kStride,
+                width, invert * height, radius, passes);
+  } else {
+    BlurPlane(src_a + off, kStride, dst_c, kStride,
+              width, invert * height, radius, passes);
+  }
+  MaskCpuFlags(-1);
+  for (int i = 0; i < benchmark_iterations; ++i) {
+    if (kBpp == 4) {
+      ARGBBoxBlur(src_a + off, kStride, dst_opt, kStride,
+                  width, invert * height, radius, passes);
+    } else {
+      BlurPlane(src_a + off, kStride, dst_opt, kStride,
+                width, invert * height, radius, passes);
+    }
+  }
+  int max_diff = 0;
+  for (int i = 0; i < kStride * height; ++i) {
+    int abs_diff =
+        abs(static_cast<int>(dst_c[i]) -
+            static_cast<int>(dst_opt[i]));
+    if (abs_diff > max_diff) {
+      max_diff = abs_diff;
+    }
+  }
+  free_aligned_buffer_64(src_a);
+  free_aligned_buffer_64(dst_c);
+  free_aligned_buffer_64(dst_opt);
+  return max_diff;
+}
+
+TEST_F(libyuvTest, ARGBBoxBlur_Any) {
+  int max_diff = TestBoxBlur(benchmark_width_ - 1, benchmark_height_,
+                             benchmark_iterations_, disable_cpu_flags_,
+                             +1, 0, kBlurSize, 1, 4);
+  EXPECT_EQ(0, max_diff);
+}
+
+TEST_F(libyuvTest, ARGBBoxBlur_Unaligned) {
+  int max_diff = TestBoxBlur(benchmark_width_, benchmark_height_,
+                             benchmark_iterations_, disable_cpu_flags_,
+                             +1, 1, kBlurSmallSize, 1, 4);
+  EXPECT_EQ(0, max_diff);
+}
+
+TEST_F(libyuvTest, ARGBBoxBlur_Invert) {
+  int max_diff = TestBoxBlur(benchmark_width_, benchmark_height_,
+                             benchmark_iterations_, disable_cpu_flags_,
+                             -1, 0, kBlurSmallSize, 1, 4);
+  EXPECT_EQ(0, max_diff);
+}
+
+TEST_F(libyuvTest, ARGBBoxBlur3_Opt) {
+  int max_diff = TestBoxBlur(benchmark_width_, benchmark_height_,
+                             benchmark_iterations_, disable_cpu_flags_,
+                             +1, 0, kBlurSmallSize, 3, 4);
+  EXPECT_EQ(0, max_diff);
+}
+
+TEST_F(libyuvTest, BlurPlane_Any) {
+  int max_diff = TestBoxBlur(benchmark_width_ - 1, benchmark_height_,
+                             benchmark_iterations_, disable_cpu_flags_,
+                             +1, 0, kBlurSmallSize, 1, 1);
+  EXPECT_EQ(0, max_diff);
+}
+
+TEST_F(libyuvTest, BlurPlane3_Opt) {
+  int max_diff = TestBoxBlur(benchmark_width_, benchmark_height_,
+                             benchmark_iterations_, disable_cpu_flags_,
+                             +1, 0, kBlurSize, 3, 1);
+  EXPECT_EQ(0, max_diff);
+}
+
+// A single pass should match the clipped box average computed directly.
+TEST_F(libyuvTest, BlurPlane_Reference) {
+  const int kWidth = 97;
+  const int kHeight = 301;
+  const int kRadius = 6;
+  align_buffer_64(src, kWidth * kHeight);
+  align_buffer_64(dst, kWidth * kHeight);
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    src[i] = (random() & 0xff);
+  }
+  EXPECT_EQ(0, BlurPlane(src, kWidth, dst, kWidth,
+                         kWidth, kHeight, kRadius, 1));
+
+  int max_diff = 0;
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      int sum = 0;
+      int count = 0;
+      for (int j = y - kRadius; j <= y + kRadius; ++j) {
+        for (int i = x - kRadius; i <= x + kRadius; ++i) {
+          if (j >= 0 && j < kHeight && i >= 0 && i < kWidth) {
+            sum += src[j * kWidth + i];
+            ++count;
+          }
+        }
+      }
+      int expected = (sum + count / 2) / count;
+      int abs_diff = abs(expected - static_cast<int>(dst[y * kWidth + x]));
+      if (abs_diff > max_diff) {
+        max_diff = abs_diff;
+      }
+    }
+  }
+  // Rows are rounded after the horizontal pass.
+  EXPECT_LE(max_diff, 1);
+
+  // In place should give the same result.
+  EXPECT_EQ(0, BlurPlane(src, kWidth, src, kWidth,
+                         kWidth, kHeight, kRadius, 1));
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    EXPECT_EQ(dst[i], src[i]);
+  }
+  free_aligned_buffer_64(src);
+  free_aligned_buffer_64(dst);
+}
+
 TEST_F(libyuvTest, TestARGBPolynomial) {
   SIMD_ALIGNED(uint8 orig_pixels[1280][4]);
   SIMD_ALIGNED(uint8 dst_pixels_opt[1280][4]);
@@ -198,4 +198,86 @@ TEST_F(libyuvTest, RotatePlane270_Odd) {
                   kRotate270, benchmark_iterations_, disable_cpu_flags_);
 }
 
+// Compares a rotation with each pixel moved to where it should land. The
+// tiled transposes are shared by the C and optimized paths, so this is what
+// checks the tile edges.
+static void TestRotateReference(int width, int height,
+                                libyuv::RotationMode mode, const int kBpp) {
+  const int src_stride = width * kBpp;
+  const int dst_width = (mode == kRotate180) ? width : height;
+  const int dst_stride = dst_width * kBpp;
+  const int size = width * height * kBpp;
+  align_buffer_64(src, size);
+  align_buffer_64(dst, size);
+  for (int i = 0; i < size; ++i) {
+    src[i] = random() & 0xff;
+  }
+  memset(dst, 1, size);
+
+  if (kBpp == 1) {
+    RotatePlane(src, src_stride, dst, dst_stride, width, height, mode);
+  } else {
+    ARGBRotate(src, src_stride, dst, dst_stride, width, height, mode);
+  }
+
+  int max_diff = 0;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      int dst_x = x;
+      int dst_y = y;
+      if (mode == kRotate90) {
+        dst_x = height - 1 - y;
+        dst_y = x;
+      } else if (mode == kRotate270) {
+        dst_x = y;
+        dst_y = width - 1 - x;
+      } else if (mode == kRotate180) {
+        dst_x = width - 1 - x;
+        dst_y = height - 1 - y;
+      }
+      for (int b = 0; b < kBpp; ++b) {
+        int abs_diff = abs(src[y * src_stride + x * kBpp + b] -
+                           dst[dst_y * dst_stride + dst_x * kBpp + b]);
+        if (abs_diff > max_diff) {
+          max_diff = abs_diff;
+        }
+      }
+    }
+  }
+  EXPECT_EQ(0, max_diff);
+
+  free_aligned_buffer_64(dst);
+  free_aligned_buffer_64(src);
+}
+
+TEST_F(libyuvTest, RotatePlane90_Reference) {
+  TestRotateReference(1280, 720, kRotate90, 1);
+  TestRotateReference(77, 93, kRotate90, 1);
+}
+
+TEST_F(libyuvTest, RotatePlane270_Reference) {
+  TestRotateReference(1280, 720, kRotate270, 1);
+  TestRotateReference(77, 93, kRotate270, 1);
+}
+
+TEST_F(libyuvTest, RotatePlane180_Reference) {
+  TestRotateReference(1280, 720, kRotate180, 1);
+  TestRotateReference(77, 93, kRotate180, 1);
+}
+
+TEST_F(libyuvTest, ARGBRotate90_Reference) {
+  TestRotateReference(1280, 720, kRotate90, 4);
+  TestRotateReference(77, 93, kRotate90, 4);
+}
+
+TEST_F(libyuvTest, ARGBRotate270_Reference) {
+  TestRotateReference(1280, 720, kRotate270, 4);
+  TestRotateReference(77, 93, kRotate270, 4);
+}
+
+TEST_F(libyuvTest, ARGBRotate180_Reference) {
+  TestRotateReference(1280, 720, kRotate180, 4);
+  TestRotateReference(77, 93, kRotate180, 4);
+}
+
 }  // namespace libyuv
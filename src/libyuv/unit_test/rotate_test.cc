@@ -264,8 +264,47 @@ TEST_F(libyuvTest, NV12Rotate270_Inverted) {
                  kRotate270, benchmark_iterations_, disable_cpu_flags_);
 }
 
+TEST_F(libyuvTest, NV12Rotate90_Reference) {
+  const int kWidth = 642;
+  const int kHeight = 362;
+  const int kHalfWidth = (kWidth + 1) / 2;
+  const int kHalfHeight = (kHeight + 1) / 2;
+  align_buffer_64(src_y, kWidth * kHeight);
+  align_buffer_64(src_uv, kHalfWidth * 2 * kHalfHeight);
+  align_buffer_64(dst_y, kWidth * kHeight);
+  align_buffer_64(dst_u, kHalfWidth * kHalfHeight);
+  align_buffer_64(dst_v, kHalfWidth * kHalfHeight);
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    src_y[i] = random() & 0xff;
+  }
+  for (int i = 0; i < kHalfWidth * 2 * kHalfHeight; ++i) {
+    src_uv[i] = random() & 0xff;
+  }
 
+  NV12ToI420Rotate(src_y, kWidth, src_uv, kHalfWidth * 2,
+                   dst_y, kHeight, dst_u, kHalfHeight, dst_v, kHalfHeight,
+                   kWidth, kHeight, kRotate90);
+
+  // The UV plane is split and rotated in one pass. Pixel (x, y) lands at
+  // (height - 1 - y, x).
+  for (int y = 0; y < kHalfHeight; ++y) {
+    for (int x = 0; x < kHalfWidth; ++x) {
+      int dst_offset = x * kHalfHeight + (kHalfHeight - 1 - y);
+      EXPECT_EQ(src_uv[y * kHalfWidth * 2 + x * 2 + 0], dst_u[dst_offset]);
+      EXPECT_EQ(src_uv[y * kHalfWidth * 2 + x * 2 + 1], dst_v[dst_offset]);
+    }
+  }
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      EXPECT_EQ(src_y[y * kWidth + x], dst_y[x * kHeight + (kHeight - 1 - y)]);
+    }
+  }
 
-
+  free_aligned_buffer_64(src_y);
+  free_aligned_buffer_64(src_uv);
+  free_aligned_buffer_64(dst_y);
+  free_aligned_buffer_64(dst_u);
+  free_aligned_buffer_64(dst_v);
+}
 
 }  // namespace libyuv
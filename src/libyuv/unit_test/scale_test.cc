@@ -304,7 +304,9 @@ static int TestFilter_16(int src_width, int src_height,
     TEST_FACTOR1(name, None, nom, denom, 0)                                    \
     TEST_FACTOR1(name, Linear, nom, denom, 3)                                  \
     TEST_FACTOR1(name, Bilinear, nom, denom, 3)                                \
-    TEST_FACTOR1(name, Box, nom, denom, 3)
+    TEST_FACTOR1(name, Box, nom, denom, 3)                                     \
+    TEST_FACTOR1(name, Bicubic, nom, denom, 0)                                 \
+    TEST_FACTOR1(name, Lanczos, nom, denom, 0)
 
 TEST_FACTOR(2, 1, 2)
 TEST_FACTOR(4, 1, 4)
@@ -347,12 +349,14 @@ TEST_FACTOR(3, 1, 3)
       EXPECT_LE(diff, max_diff);                                               \
     }
 
-// Test scale to a specified size with all 4 filters.
+// Test scale to a specified size with all 6 filters.
 #define TEST_SCALETO(name, width, height)                                      \
     TEST_SCALETO1(name, width, height, None, 0)                                \
     TEST_SCALETO1(name, width, height, Linear, 3)                              \
     TEST_SCALETO1(name, width, height, Bilinear, 3)                            \
-    TEST_SCALETO1(name, width, height, Box, 3)
+    TEST_SCALETO1(name, width, height, Box, 3)                                 \
+    TEST_SCALETO1(name, width, height, Bicubic, 0)                             \
+    TEST_SCALETO1(name, width, height, Lanczos, 0)
 
 TEST_SCALETO(Scale, 1, 1)
 TEST_SCALETO(Scale, 320, 240)
@@ -363,4 +367,103 @@ TEST_SCALETO(Scale, 1280, 720)
 #undef TEST_SCALETO1
 #undef TEST_SCALETO
 
+// Test 16 bit polyphase scaling with C vs Opt and return maximum pixel
+// difference.
+static int TestPolyphase_16(int src_width, int src_height,
+                            int dst_width, int dst_height,
+                            FilterMode f, int benchmark_iterations,
+                            int disable_cpu_flags) {
+  const int src_size = Abs(src_width) * Abs(src_height);
+  const int dst_size = dst_width * dst_height;
+  align_buffer_page_end(src, src_size * 2)
+  align_buffer_page_end(dst_c, dst_size * 2)
+  align_buffer_page_end(dst_opt, dst_size * 2)
+  uint16* p_src = reinterpret_cast<uint16*>(src);
+  uint16* p_dst_c = reinterpret_cast<uint16*>(dst_c);
+  uint16* p_dst_opt = reinterpret_cast<uint16*>(dst_opt);
+  MemRandomize(src, src_size * 2);
+
+  MaskCpuFlags(disable_cpu_flags);
+  ScalePlane_16(p_src, Abs(src_width), src_width, src_height,
+                p_dst_c, dst_width, dst_width, dst_height, f);
+  MaskCpuFlags(-1);
+  for (int i = 0; i < benchmark_iterations; ++i) {
+    ScalePlane_16(p_src, Abs(src_width), src_width, src_height,
+                  p_dst_opt, dst_width, dst_width, dst_height, f);
+  }
+  int max_diff = 0;
+  for (int i = 0; i < dst_size; ++i) {
+    int abs_diff = Abs(p_dst_c[i] - p_dst_opt[i]);
+    if (abs_diff > max_diff) {
+      max_diff = abs_diff;
+    }
+  }
+  free_aligned_buffer_page_end(src)
+  free_aligned_buffer_page_end(dst_c)
+  free_aligned_buffer_page_end(dst_opt)
+  return max_diff;
+}
+
+TEST_F(libyuvTest, ScalePlaneDownBy3_Lanczos_16) {
+  int diff = TestPolyphase_16(benchmark_width_, benchmark_height_,
+                              benchmark_width_ / 3, benchmark_height_ / 3,
+                              kFilterLanczos, benchmark_iterations_,
+                              disable_cpu_flags_);
+  EXPECT_EQ(0, diff);
+}
+
+TEST_F(libyuvTest, ScalePlaneUp_Bicubic_16) {
+  int diff = TestPolyphase_16(benchmark_width_, benchmark_height_,
+                              benchmark_width_ * 2 - 1,
+                              benchmark_height_ * 2 + 1,
+                              kFilterBicubic, benchmark_iterations_,
+                              disable_cpu_flags_);
+  EXPECT_EQ(0, diff);
+}
+
+TEST_F(libyuvTest, ScalePlaneMirror_Lanczos_16) {
+  int diff = TestPolyphase_16(-benchmark_width_, benchmark_height_,
+                              benchmark_width_ * 2 / 5 + 3,
+                              benchmark_height_ + 1,
+                              kFilterLanczos, benchmark_iterations_,
+                              disable_cpu_flags_);
+  EXPECT_EQ(0, diff);
+}
+
+// A flat plane stays flat through the polyphase filters.
+TEST_F(libyuvTest, ScalePlanePolyphase_Constant) {
+  const int kSrcWidth = 67;
+  const int kSrcHeight = 35;
+  const int kDstWidths[] = { 1, 17, 67, 200 };
+  const int kDstHeights[] = { 3, 11, 35, 80 };
+  align_buffer_page_end(src, kSrcWidth * kSrcHeight * 2)
+  align_buffer_page_end(dst, 200 * 80 * 2)
+  uint16* p_src = reinterpret_cast<uint16*>(src);
+  uint16* p_dst = reinterpret_cast<uint16*>(dst);
+  for (int f = kFilterBicubic; f <= kFilterLanczos; ++f) {
+    for (int i = 0; i < 4; ++i) {
+      const int dst_width = kDstWidths[i];
+      const int dst_height = kDstHeights[3 - i];
+      memset(src, 77, kSrcWidth * kSrcHeight);
+      ScalePlane(src, kSrcWidth, kSrcWidth, kSrcHeight,
+                 dst, dst_width, dst_width, dst_height,
+                 static_cast<FilterMode>(f));
+      for (int j = 0; j < dst_width * dst_height; ++j) {
+        EXPECT_EQ(77, dst[j]);
+      }
+      for (int j = 0; j < kSrcWidth * kSrcHeight; ++j) {
+        p_src[j] = 65000;
+      }
+      ScalePlane_16(p_src, kSrcWidth, kSrcWidth, kSrcHeight,
+                    p_dst, dst_width, dst_width, dst_height,
+                    static_cast<FilterMode>(f));
+      for (int j = 0; j < dst_width * dst_height; ++j) {
+        EXPECT_EQ(65000, p_dst[j]);
+      }
+    }
+  }
+  free_aligned_buffer_page_end(src)
+  free_aligned_buffer_page_end(dst)
+}
+
 }  // namespace libyuv
@@ -0,0 +1,591 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+
+#ifndef VIGRA_BLOCKWISE_CONVOLUTION_HXX
+#define VIGRA_BLOCKWISE_CONVOLUTION_HXX
+
+#include "multi_array.hxx"
+#include "multi_convolution.hxx"
+#include "threadpool.hxx"
+#include "array_vector.hxx"
+#include "tinyvector.hxx"
+
+namespace vigra {
+
+namespace blockwise {
+
+/** \addtogroup ParallelProcessing
+*/
+//@{
+
+    /** \brief Options for the blockwise (and parallel) filters in 
+               namespace <tt>vigra::blockwise</tt>.
+
+        Besides the number of threads (see \ref ParallelOptions), the 
+        options specify the shape of the blocks the array is divided into.
+        Each block is enlarged by a halo of the kernels' radius, filtered
+        independently, and the block's interior is written to the
+        destination. Small blocks reduce the memory per thread, large
+        blocks reduce the redundant computations in the halo. 
+
+        Default: 256 pixels per axis for 1D and 2D arrays, 64 pixels per 
+        axis otherwise.
+
+        <b>\#include</b> \<vigra/blockwise_convolution.hxx\><br>
+        Namespace: vigra::blockwise
+    */
+template <unsigned int N>
+class BlockwiseOptions
+: public ParallelOptions
+{
+  public:
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    BlockwiseOptions()
+    : ParallelOptions(),
+      block_shape(N <= 2 ? 256 : 64)
+    {}
+
+        /** Set the block shape.
+        */
+    BlockwiseOptions & blockShape(Shape const & shape)
+    {
+        for(unsigned int k=0; k<N; ++k)
+            vigra_precondition(shape[k] > 0,
+                "BlockwiseOptions::blockShape(): block shape must be positive.");
+        block_shape = shape;
+        return *this;
+    }
+
+        /** Set the block shape to <tt>size</tt> pixels along every axis.
+        */
+    BlockwiseOptions & blockShape(MultiArrayIndex size)
+    {
+        return blockShape(Shape(size));
+    }
+
+    Shape const & getBlockShape() const
+    {
+        return block_shape;
+    }
+
+        /** Set the number of threads (see \ref ParallelOptions::numThreads()).
+        */
+    BlockwiseOptions & numThreads(const int n)
+    {
+        ParallelOptions::numThreads(n);
+        return *this;
+    }
+
+  private:
+    Shape block_shape;
+};
+
+//@}
+
+namespace detail {
+
+    // enlarge the halo such that a block covers the support of 'kernel'
+template <class Kernel>
+inline void
+updateBlockwiseHalo(Kernel const & kernel, MultiArrayIndex & before, MultiArrayIndex & after)
+{
+    vigra_precondition(kernel.borderTreatment() != BORDER_TREATMENT_AVOID &&
+                       kernel.borderTreatment() != BORDER_TREATMENT_WRAP,
+        "blockwise convolution: BORDER_TREATMENT_AVOID and BORDER_TREATMENT_WRAP are not supported.");
+    before = std::max<MultiArrayIndex>(before, kernel.right());
+    after  = std::max<MultiArrayIndex>(after, -kernel.left());
+}
+
+    // filter a single block with halo and copy its interior to the destination
+template <unsigned int N, class T1, class S1, class T2, class S2, class BufferType, class FUNCTOR>
+class BlockwiseTask
+{
+  public:
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    BlockwiseTask(MultiArrayView<N, T1, S1> const & source,
+                  MultiArrayView<N, T2, S2> const & dest,
+                  Shape const & blockShape, Shape const & haloBefore, Shape const & haloAfter,
+                  ArrayVector<MultiArray<N, BufferType> > & buffers,
+                  FUNCTOR & f)
+    : source_(source), dest_(dest),
+      blockShape_(blockShape), haloBefore_(haloBefore), haloAfter_(haloAfter),
+      buffers_(buffers), f_(f)
+    {}
+
+    void operator()(int threadId, Shape const & blockStart) const
+    {
+        Shape blockStop   = min(blockStart + blockShape_, source_.shape()),
+              regionStart = max(blockStart - haloBefore_, Shape()),
+              regionStop  = min(blockStop + haloAfter_, source_.shape());
+
+        // each thread filters into its own buffer, which is allocated once
+        MultiArray<N, BufferType> & buffer = buffers_[threadId];
+        if(buffer.size() == 0)
+            buffer.reshape(min(blockShape_ + haloBefore_ + haloAfter_, source_.shape()));
+        MultiArrayView<N, BufferType> region = buffer.subarray(Shape(), regionStop - regionStart);
+
+        f_(threadId, source_.subarray(regionStart, regionStop), region);
+
+        MultiArrayView<N, T2, StridedArrayTag> destBlock = dest_.subarray(blockStart, blockStop);
+        copyMultiArray(srcMultiArrayRange(region.subarray(blockStart - regionStart, blockStop - regionStart)),
+                       destMultiArray(destBlock));
+    }
+
+  private:
+    MultiArrayView<N, T1, S1> source_;
+    MultiArrayView<N, T2, S2> dest_;
+    Shape blockShape_, haloBefore_, haloAfter_;
+    ArrayVector<MultiArray<N, BufferType> > & buffers_;
+    FUNCTOR & f_;
+};
+
+    // Divide 'source' into blocks, call f(threadId, sourceRegion, bufferRegion) 
+    // for each block enlarged by the halo, and copy the block's interior 
+    // from the buffer to 'dest'.
+template <class BufferType, unsigned int N, class T1, class S1, class T2, class S2, class FUNCTOR>
+void
+blockwiseCaller(MultiArrayView<N, T1, S1> const & source,
+                MultiArrayView<N, T2, S2> dest,
+                typename MultiArrayShape<N>::type const & haloBefore,
+                typename MultiArrayShape<N>::type const & haloAfter,
+                BlockwiseOptions<N> const & options,
+                FUNCTOR & f)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    Shape shape(source.shape()),
+          blockShape(options.getBlockShape()),
+          blockCount;
+    for(unsigned int k=0; k<N; ++k)
+    {
+        if(shape[k] <= 0)
+            return;
+        // A block must be at least as large as the kernel. Then, convolveLine() 
+        // takes the same border branches in the interior of each block as for
+        // the entire array, and the result is identical.
+        blockShape[k] = std::min(shape[k], std::max(blockShape[k], haloBefore[k] + haloAfter[k] + 1));
+        blockCount[k] = (shape[k] + blockShape[k] - 1) / blockShape[k];
+    }
+
+    ArrayVector<Shape> blocks;
+    blocks.reserve(prod(blockCount));
+    for(Shape p; p[N-1] < blockCount[N-1]; )
+    {
+        blocks.push_back(p*blockShape);
+        for(unsigned int k=0; k<N; ++k)
+        {
+            if(++p[k] < blockCount[k] || k == N-1)
+                break;
+            p[k] = 0;
+        }
+    }
+
+    ThreadPool pool(options);
+    ArrayVector<MultiArray<N, BufferType> > buffers(std::max<std::size_t>(pool.numThreads(), 1));
+    BlockwiseTask<N, T1, S1, T2, S2, BufferType, FUNCTOR>
+        task(source, dest, blockShape, haloBefore, haloAfter, buffers, f);
+
+    parallel_foreach(pool, blocks.begin(), blocks.end(), task, blocks.size());
+}
+
+template <class KernelIterator, class TmpType>
+class BlockwiseSeparableConvolution
+{
+  public:
+    BlockwiseSeparableConvolution(KernelIterator kernels, int numThreads)
+    : kernels_(kernels),
+      lines_(std::max(numThreads, 1))
+    {}
+
+    template <unsigned int N, class T1, class S1>
+    void operator()(int threadId,
+                    MultiArrayView<N, T1, S1> const & source,
+                    MultiArrayView<N, TmpType> dest)
+    {
+        vigra::detail::internalSeparableConvolveMultiArrayTmp(
+            source.traverser_begin(), source.shape(), 
+            typename AccessorTraits<T1>::default_const_accessor(),
+            dest.traverser_begin(), typename AccessorTraits<TmpType>::default_accessor(),
+            kernels_, lines_[threadId]);
+    }
+
+  private:
+    KernelIterator kernels_;
+    ArrayVector<ArrayVector<TmpType> > lines_;
+};
+
+template <unsigned int N>
+class BlockwiseGaussianGradient
+{
+  public:
+    BlockwiseGaussianGradient(ConvolutionOptions<N> const & opt)
+    : opt_(opt)
+    {}
+
+    template <class T1, class S1, class T2>
+    void operator()(int,
+                    MultiArrayView<N, T1, S1> const & source,
+                    MultiArrayView<N, T2> dest)
+    {
+        vigra::gaussianGradientMultiArray(srcMultiArrayRange(source), destMultiArray(dest), opt_);
+    }
+
+  private:
+    ConvolutionOptions<N> opt_;
+};
+
+} // namespace detail
+
+/** \addtogroup ParallelProcessing
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*       blockwise::separableConvolveMultiArray         */
+/*                                                      */
+/********************************************************/
+
+/** \brief Blockwise and parallel separable convolution of a multi-dimensional array.
+
+    This function computes the same result as \ref vigra::separableConvolveMultiArray(),
+    but divides the array into blocks (see \ref BlockwiseOptions) that are 
+    processed in parallel by a \ref ThreadPool. Each block is enlarged by a halo
+    that is automatically determined from the kernel sizes (i.e. 
+    <tt>kernel.right()</tt> pixels before and <tt>-kernel.left()</tt> pixels
+    after the block along each axis), filtered with the same algorithm as 
+    the serial function, and only the block's interior is written to the 
+    destination. Therefore, the result is identical to the serial one, 
+    independently of the block shape and the number of threads. Each thread 
+    reuses its block buffer and line buffer for all blocks it processes.
+
+    Since <tt>source</tt> is read while <tt>dest</tt> is written, the
+    function cannot work in-place. Kernels with 
+    <tt>BORDER_TREATMENT_AVOID</tt> and <tt>BORDER_TREATMENT_WRAP</tt> are
+    not supported, because they depend on pixels outside the halo.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra { namespace blockwise {
+        // apply each kernel from the sequence 'kernels' in turn
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class KernelIterator>
+        void
+        separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    KernelIterator kernels,
+                                    BlockwiseOptions<N> const & options = BlockwiseOptions<N>());
+
+        // apply the same kernel to all dimensions
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class T>
+        void
+        separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    Kernel1D<T> const & kernel,
+                                    BlockwiseOptions<N> const & options = BlockwiseOptions<N>());
+    }}
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_convolution.hxx\><br/>
+    Namespace: vigra::blockwise
+
+    \code
+    Shape3 shape(2048, 2048, 2048);
+    MultiArray<3, float> source(shape);
+    MultiArray<3, float> dest(shape);
+    ...
+    Kernel1D<float> gauss;
+    gauss.initGaussian(2.0);
+
+    // smooth with 8 threads and blocks of 128^3 pixels
+    blockwise::separableConvolveMultiArray(source, dest, gauss, 
+                  blockwise::BlockwiseOptions<3>().blockShape(128).numThreads(8));
+    \endcode
+
+    \see vigra::separableConvolveMultiArray()
+*/
+doxygen_overloaded_function(template <...> void separableConvolveMultiArray)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class KernelIterator>
+void
+separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            KernelIterator kernels,
+                            BlockwiseOptions<N> const & options = BlockwiseOptions<N>())
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename NumericTraits<T2>::RealPromote TmpType;
+
+    vigra_precondition(source.shape() == dest.shape(),
+        "blockwise::separableConvolveMultiArray(): shape mismatch between input and output.");
+
+    Shape haloBefore, haloAfter;
+    KernelIterator kit = kernels;
+    for(unsigned int k=0; k<N; ++k, ++kit)
+        detail::updateBlockwiseHalo(*kit, haloBefore[k], haloAfter[k]);
+
+    detail::BlockwiseSeparableConvolution<KernelIterator, TmpType> 
+        f(kernels, options.getNumThreads());
+    detail::blockwiseCaller<TmpType>(source, dest, haloBefore, haloAfter, options, f);
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class T>
+inline void
+separableConvolveMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            Kernel1D<T> const & kernel,
+                            BlockwiseOptions<N> const & options = BlockwiseOptions<N>())
+{
+    ArrayVector<Kernel1D<T> > kernels(N, kernel);
+
+    blockwise::separableConvolveMultiArray(source, dest, kernels.begin(), options);
+}
+
+/********************************************************/
+/*                                                      */
+/*         blockwise::gaussianSmoothMultiArray          */
+/*                                                      */
+/********************************************************/
+
+/** \brief Blockwise and parallel isotropic Gaussian smoothing of a multi-dimensional array.
+
+    This function computes the same result as \ref vigra::gaussianSmoothMultiArray()
+    by a call to \ref blockwise::separableConvolveMultiArray() with the appropriate 
+    kernels. The halo is determined automatically from the filter window size.
+    A subregion (i.e. <tt>ConvolutionOptions::subarray()</tt>) is not supported.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra { namespace blockwise {
+        // pass filter scale explicitly
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        gaussianSmoothMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                 MultiArrayView<N, T2, S2> dest,
+                                 double sigma,
+                                 ConvolutionOptions<N> opt = ConvolutionOptions<N>(),
+                                 BlockwiseOptions<N> const & options = BlockwiseOptions<N>());
+
+        // pass filer scale(s) in the option object
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        gaussianSmoothMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                 MultiArrayView<N, T2, S2> dest,
+                                 ConvolutionOptions<N> opt,
+                                 BlockwiseOptions<N> const & options = BlockwiseOptions<N>());
+    }}
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_convolution.hxx\><br/>
+    Namespace: vigra::blockwise
+
+    \code
+    Shape3 shape(width, height, depth);
+    MultiArray<3, unsigned char> source(shape);
+    MultiArray<3, float>         dest(shape);
+    ...
+    // Gaussian smoothing at scale 'sigma' with the default number of threads
+    blockwise::gaussianSmoothMultiArray(source, dest, sigma);
+    \endcode
+
+    \see vigra::gaussianSmoothMultiArray()
+*/
+doxygen_overloaded_function(template <...> void gaussianSmoothMultiArray)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+gaussianSmoothMultiArray(MultiArrayView<N, T1, S1> const & source,
+                         MultiArrayView<N, T2, S2> dest,
+                         ConvolutionOptions<N> opt,
+                         BlockwiseOptions<N> const & options = BlockwiseOptions<N>())
+{
+    static const char * function_name = "blockwise::gaussianSmoothMultiArray";
+
+    vigra_precondition(opt.to_point == typename MultiArrayShape<N>::type(),
+        "blockwise::gaussianSmoothMultiArray(): subarray is not supported.");
+
+    typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
+    ArrayVector<Kernel1D<double> > kernels(N);
+
+    for (unsigned int dim = 0; dim < N; ++dim, ++params)
+        kernels[dim].initGaussian(params.sigma_scaled(function_name), 1.0, opt.window_ratio);
+
+    blockwise::separableConvolveMultiArray(source, dest, kernels.begin(), options);
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+gaussianSmoothMultiArray(MultiArrayView<N, T1, S1> const & source,
+                         MultiArrayView<N, T2, S2> dest,
+                         double sigma,
+                         ConvolutionOptions<N> opt = ConvolutionOptions<N>(),
+                         BlockwiseOptions<N> const & options = BlockwiseOptions<N>())
+{
+    blockwise::gaussianSmoothMultiArray(source, dest, opt.stdDev(sigma), options);
+}
+
+/********************************************************/
+/*                                                      */
+/*        blockwise::gaussianGradientMultiArray         */
+/*                                                      */
+/********************************************************/
+
+/** \brief Blockwise and parallel Gaussian gradient of a multi-dimensional array.
+
+    This function computes the same result as \ref vigra::gaussianGradientMultiArray().
+    Each block is enlarged by a halo that covers the Gaussian and the 
+    derivative-of-Gaussian kernels and passed to the serial function. 
+    A subregion (i.e. <tt>ConvolutionOptions::subarray()</tt>) is not supported.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra { namespace blockwise {
+        // pass filter scale explicitly
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        gaussianGradientMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                   MultiArrayView<N, TinyVector<T2, N>, S2> dest,
+                                   double sigma,
+                                   ConvolutionOptions<N> opt = ConvolutionOptions<N>(),
+                                   BlockwiseOptions<N> const & options = BlockwiseOptions<N>());
+
+        // pass filter scale(s) in option object
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        gaussianGradientMultiArray(MultiArrayView<N, T1, S1> const & source,
+                                   MultiArrayView<N, TinyVector<T2, N>, S2> dest,
+                                   ConvolutionOptions<N> opt,
+                                   BlockwiseOptions<N> const & options = BlockwiseOptions<N>());
+    }}
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_convolution.hxx\><br/>
+    Namespace: vigra::blockwise
+
+    \code
+    Shape3 shape(width, height, depth);
+    MultiArray<3, float> source(shape);
+    MultiArray<3, TinyVector<float, 3> > dest(shape);
+    ...
+    blockwise::gaussianGradientMultiArray(source, dest, sigma, ConvolutionOptions<3>(),
+                                          blockwise::BlockwiseOptions<3>().numThreads(4));
+    \endcode
+
+    \see vigra::gaussianGradientMultiArray()
+*/
+doxygen_overloaded_function(template <...> void gaussianGradientMultiArray)
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+void
+gaussianGradientMultiArray(MultiArrayView<N, T1, S1> const & source,
+                           MultiArrayView<N, T2, S2> dest,
+                           ConvolutionOptions<N> opt,
+                           BlockwiseOptions<N> const & options = BlockwiseOptions<N>())
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef typename NumericTraits<typename T2::value_type>::RealPromote KernelType;
+
+    static const char * function_name = "blockwise::gaussianGradientMultiArray";
+
+    vigra_precondition(source.shape() == dest.shape(),
+        "blockwise::gaussianGradientMultiArray(): shape mismatch between input and output.");
+    vigra_precondition(opt.to_point == Shape(),
+        "blockwise::gaussianGradientMultiArray(): subarray is not supported.");
+    vigra_precondition((int)N == (int)T2::static_size,
+        "blockwise::gaussianGradientMultiArray(): Wrong number of channels in output array.");
+
+    // the halo must cover the kernels of vigra::gaussianGradientMultiArray()
+    typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
+    Shape haloBefore, haloAfter;
+    for (unsigned int dim = 0; dim < N; ++dim, ++params)
+    {
+        double sigma = params.sigma_scaled(function_name);
+        Kernel1D<KernelType> smoothing, derivative;
+        smoothing.initGaussian(sigma, 1.0, opt.window_ratio);
+        derivative.initGaussianDerivative(sigma, 1, 1.0, opt.window_ratio);
+        detail::updateBlockwiseHalo(smoothing, haloBefore[dim], haloAfter[dim]);
+        detail::updateBlockwiseHalo(derivative, haloBefore[dim], haloAfter[dim]);
+    }
+
+    detail::BlockwiseGaussianGradient<N> f(opt);
+    detail::blockwiseCaller<T2>(source, dest, haloBefore, haloAfter, options, f);
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+gaussianGradientMultiArray(MultiArrayView<N, T1, S1> const & source,
+                           MultiArrayView<N, T2, S2> dest,
+                           double sigma,
+                           ConvolutionOptions<N> opt = ConvolutionOptions<N>(),
+                           BlockwiseOptions<N> const & options = BlockwiseOptions<N>())
+{
+    blockwise::gaussianGradientMultiArray(source, dest, opt.stdDev(sigma), options);
+}
+
+//@}
+
+} // namespace blockwise
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_CONVOLUTION_HXX
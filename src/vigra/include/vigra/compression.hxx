@@ -0,0 +1,100 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+
+#ifndef VIGRA_COMPRESSION_HXX
+#define VIGRA_COMPRESSION_HXX
+
+#include <cstddef>
+#include "config.hxx"
+#include "array_vector.hxx"
+
+namespace vigra {
+
+    /** \brief Methods for in-memory compression of data buffers.
+
+        The values of the zlib methods are the corresponding zlib compression
+        levels. The zlib methods are only available when vigraimpex was
+        built with zlib support (see \ref compressionAvailable()).
+
+        <b>\#include</b> \<vigra/compression.hxx\><br>
+        Namespace: vigra
+    */
+enum CompressionMethod 
+{
+    DEFAULT_COMPRESSION = -1, ///< <tt>ZLIB_FAST</tt> if available, <tt>NO_COMPRESSION</tt> otherwise
+    NO_COMPRESSION      =  0, ///< copy the data unchanged
+    ZLIB_FAST           =  1, ///< zlib at level 1
+    ZLIB                =  6, ///< zlib at its default level 6
+    ZLIB_BEST           =  9  ///< zlib at level 9
+};
+
+    /** \brief Check if the given compression method is supported by
+        this build of vigraimpex.
+
+        <b>\#include</b> \<vigra/compression.hxx\><br>
+        Namespace: vigra
+    */
+VIGRA_EXPORT bool compressionAvailable(CompressionMethod method);
+
+    /** \brief Compress <tt>size</tt> bytes starting at <tt>source</tt>
+        into the buffer <tt>dest</tt>, which is resized to the compressed
+        size.
+
+        Throws <tt>PreconditionViolation</tt> if the method is not available.
+
+        <b>\#include</b> \<vigra/compression.hxx\><br>
+        Namespace: vigra
+    */
+VIGRA_EXPORT void compress(char const * source, std::size_t size,
+                           ArrayVector<char> & dest, CompressionMethod method);
+
+    /** \brief Uncompress the buffer <tt>source</tt> of <tt>srcSize</tt> bytes,
+        which was created by \ref compress() with the same method, into 
+        <tt>dest</tt>.
+
+        <tt>destSize</tt> must be the size of the original data. Throws
+        <tt>PostconditionViolation</tt> if the data are corrupt.
+
+        <b>\#include</b> \<vigra/compression.hxx\><br>
+        Namespace: vigra
+    */
+VIGRA_EXPORT void uncompress(char const * source, std::size_t srcSize, 
+                             char * dest, std::size_t destSize, CompressionMethod method);
+
+} // namespace vigra
+
+#endif // VIGRA_COMPRESSION_HXX
@@ -0,0 +1,647 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+
+#ifndef VIGRA_MULTI_ARRAY_CHUNKED_HXX
+#define VIGRA_MULTI_ARRAY_CHUNKED_HXX
+
+#include <list>
+#include "config.hxx"
+#include "error.hxx"
+#include "multi_array.hxx"
+#include "multi_iterator.hxx"
+#include "array_vector.hxx"
+#include "compression.hxx"
+
+#ifdef VIGRA_HAS_STD_THREADS
+# include <mutex>
+#endif
+
+namespace vigra {
+
+namespace detail {
+
+#ifdef VIGRA_HAS_STD_THREADS
+typedef std::mutex                  ChunkedArrayMutex;
+typedef std::lock_guard<std::mutex> ChunkedArrayLock;
+#else
+struct ChunkedArrayMutex {};
+struct ChunkedArrayLock
+{
+    explicit ChunkedArrayLock(ChunkedArrayMutex &) {}
+};
+#endif
+
+    // about 256k elements per chunk, e.g. 512^2 or 64^3
+template <unsigned int N>
+typename MultiArrayShape<N>::type
+defaultChunkShape()
+{
+    return typename MultiArrayShape<N>::type(MultiArrayIndex(1) << (18 / N));
+}
+
+} // namespace detail
+
+/** \addtogroup ChunkedArrayClasses Chunked arrays
+
+    Store huge arrays in fixed-size chunks, of which only the recently used
+    ones are kept in memory.
+*/
+//@{
+
+    /** \brief Options for \ref ChunkedArray and its subclasses.
+
+        <b>\#include</b> \<vigra/multi_array_chunked.hxx\><br>
+        Namespace: vigra
+    */
+class ChunkedArrayOptions
+{
+  public:
+    ChunkedArrayOptions()
+    : fill_value(0.0),
+      cache_max(-1),
+      compression_method(DEFAULT_COMPRESSION),
+      read_ahead(0)
+    {}
+
+        /** Value of the elements that have never been written.
+            Default: 0
+        */
+    ChunkedArrayOptions & fillValue(double v)
+    {
+        fill_value = v;
+        return *this;
+    }
+
+        /** Memory budget of the chunk cache in bytes. When the budget is 
+            exceeded, the least recently used chunks are evicted (i.e. 
+            compressed or written to the file). The chunk that was just 
+            loaded stays in the cache until the next chunk is loaded, even 
+            if it alone exceeds the budget, but \ref ChunkedArray::setCacheMax() 
+            evicts all the excess chunks, so a budget of 0 empties the cache.
+
+            Default: -1 (enough memory for the largest slab of chunks 
+            perpendicular to one of the axes)
+        */
+    ChunkedArrayOptions & cacheMax(std::ptrdiff_t bytes)
+    {
+        cache_max = bytes;
+        return *this;
+    }
+
+        /** Compression of chunks that are evicted from the cache (\ref ChunkedArrayCompressed)
+            or of the dataset in the file (\ref ChunkedArrayHDF5, zlib methods only).
+
+            Default: <tt>DEFAULT_COMPRESSION</tt>
+        */
+    ChunkedArrayOptions & compression(CompressionMethod method)
+    {
+        compression_method = method;
+        return *this;
+    }
+
+        /** Number of additional chunks along the first axis that are read 
+            together with a missing chunk (\ref ChunkedArrayHDF5 only).
+
+            Default: 0
+        */
+    ChunkedArrayOptions & readAhead(int chunks)
+    {
+        vigra_precondition(chunks >= 0,
+            "ChunkedArrayOptions::readAhead(): number of chunks must not be negative.");
+        read_ahead = chunks;
+        return *this;
+    }
+
+    double fill_value;
+    std::ptrdiff_t cache_max;
+    CompressionMethod compression_method;
+    int read_ahead;
+};
+
+/********************************************************/
+/*                                                      */
+/*                     ChunkedArray                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Abstract base class for arrays that are stored in chunks.
+
+        A ChunkedArray divides its elements into chunks of fixed shape 
+        (except at the upper borders of the array). Chunks are created lazily
+        when they are first accessed and are kept in an LRU cache of
+        uncompressed chunks. When the memory budget of the cache 
+        (see \ref ChunkedArrayOptions::cacheMax()) is exceeded, the least recently 
+        used chunks are handed to the storage backend of the subclass, which 
+        compresses them in memory (\ref ChunkedArrayCompressed) or 
+        writes them to a file (\ref ChunkedArrayHDF5). Thus, the array
+        can be much larger than the available memory.
+
+        Data are exchanged with ordinary \ref MultiArrayView "MultiArrayViews"
+        by means of \ref checkoutSubarray() and \ref commitSubarray(). This allows 
+        existing algorithms to process the array block by block:
+
+        \code
+        ChunkedArrayCompressed<3, float> data(Shape3(10000, 10000, 1000));
+        ...
+        // smooth the array block by block
+        Shape3 halo(6), block(256);
+        MultiArray<3, float> in, out;
+        for(MultiCoordinateIterator<3> i((data.shape() + block - Shape3(1)) / block), 
+                                       end = i.getEndIterator(); i != end; ++i)
+        {
+            Shape3 start = *i * block, 
+                   stop  = min(start + block, data.shape()),
+                   outer_start = max(start - halo, Shape3(0)), 
+                   outer_stop  = min(stop + halo, data.shape());
+            in.reshape(outer_stop - outer_start);
+            out.reshape(in.shape());
+            data.checkoutSubarray(outer_start, in);
+            gaussianSmoothMultiArray(in, out, 2.0);
+            data.commitSubarray(start, out.subarray(start - outer_start, stop - outer_start));
+        }
+        \endcode
+
+        All member functions are thread-safe when the compiler supports C++11 threads 
+        (i.e. <tt>VIGRA_HAS_STD_THREADS</tt> is defined). Element access via \ref getItem() 
+        and \ref setItem() is convenient, but slow, so bulk access should
+        use \ref checkoutSubarray() and \ref commitSubarray().
+
+        Subclasses implement the storage backend by overriding \ref loadChunk()
+        and \ref storeChunk().
+
+        <b>\#include</b> \<vigra/multi_array_chunked.hxx\><br>
+        Namespace: vigra
+    */
+template <unsigned int N, class T>
+class ChunkedArray
+{
+  public:
+    typedef T                                   value_type;
+    typedef typename MultiArrayShape<N>::type   shape_type;
+    typedef MultiArrayView<N, T>                view_type;
+
+        /** Create an array of the given shape with the given chunk shape. 
+            If <tt>chunk_shape</tt> is zero, a default of about 256k 
+            elements per chunk is used.
+        */
+    ChunkedArray(shape_type const & shape, 
+                 shape_type const & chunk_shape,
+                 ChunkedArrayOptions const & options)
+    : fill_value_(T(options.fill_value)),
+      shape_(shape),
+      chunk_shape_(chunk_shape == shape_type() 
+                       ? detail::defaultChunkShape<N>()
+                       : chunk_shape),
+      cache_max_(0),
+      cache_bytes_(0),
+      cache_misses_(0)
+    {
+        for(unsigned int k=0; k<N; ++k)
+        {
+            vigra_precondition(shape_[k] > 0 && chunk_shape_[k] > 0,
+                "ChunkedArray(): shape and chunk shape must be positive.");
+            chunk_array_shape_[k] = (shape_[k] + chunk_shape_[k] - 1) / chunk_shape_[k];
+        }
+        chunk_strides_ = detail::defaultStride<N>(chunk_array_shape_);
+        chunks_.resize(prod(chunk_array_shape_));
+        setCacheMax(options.cache_max);
+    }
+
+    virtual ~ChunkedArray()
+    {}
+
+        /** Shape of the array.
+        */
+    shape_type const & shape() const
+    {
+        return shape_;
+    }
+
+        /** Number of elements in the array.
+        */
+    MultiArrayIndex size() const
+    {
+        return prod(shape_);
+    }
+
+        /** Shape of a chunk (chunks at the upper borders may be smaller).
+        */
+    shape_type const & chunkShape() const
+    {
+        return chunk_shape_;
+    }
+
+        /** Number of chunks along each axis.
+        */
+    shape_type const & chunkArrayShape() const
+    {
+        return chunk_array_shape_;
+    }
+
+        /** First element of the chunk with the given chunk index.
+        */
+    shape_type chunkStart(shape_type const & chunkIndex) const
+    {
+        return chunkIndex * chunk_shape_;
+    }
+
+        /** End of the chunk with the given chunk index (exclusive).
+        */
+    shape_type chunkStop(shape_type const & chunkIndex) const
+    {
+        return min(chunkStart(chunkIndex) + chunk_shape_, shape_);
+    }
+
+        /** Memory budget of the chunk cache in bytes.
+        */
+    std::size_t cacheMax() const
+    {
+        return cache_max_;
+    }
+
+        /** Change the memory budget of the chunk cache (see
+            \ref ChunkedArrayOptions::cacheMax()). Excess chunks are
+            evicted immediately.
+        */
+    void setCacheMax(std::ptrdiff_t bytes)
+    {
+        detail::ChunkedArrayLock lock(mutex_);
+        if(bytes < 0)
+        {
+            // enough memory for the largest slab of chunks
+            MultiArrayIndex slab = 1;
+            for(unsigned int k=0; k<N; ++k)
+                slab = std::max(slab, prod(chunk_array_shape_) / chunk_array_shape_[k]);
+            bytes = slab * prod(chunk_shape_) * sizeof(T);
+        }
+        cache_max_ = (std::size_t)bytes;
+        evict(-1);
+    }
+
+        /** Number of chunks in the cache.
+        */
+    std::size_t cacheSize() const
+    {
+        detail::ChunkedArrayLock lock(mutex_);
+        return cache_.size();
+    }
+
+        /** Memory occupied by the chunks in the cache in bytes.
+        */
+    std::size_t cacheBytes() const
+    {
+        detail::ChunkedArrayLock lock(mutex_);
+        return cache_bytes_;
+    }
+
+        /** Number of times a chunk had to be loaded into the cache.
+        */
+    std::size_t cacheMisses() const
+    {
+        detail::ChunkedArrayLock lock(mutex_);
+        return cache_misses_;
+    }
+
+        /** Read the element at the given point.
+        */
+    value_type getItem(shape_type const & point) const
+    {
+        checkSubarrayBounds(point, point + shape_type(1), "ChunkedArray::getItem()");
+        shape_type chunkIndex = point / chunk_shape_;
+        detail::ChunkedArrayLock lock(mutex_);
+        return getChunk(chunkIndex, false)[point - chunkStart(chunkIndex)];
+    }
+
+        /** Write the element at the given point.
+        */
+    void setItem(shape_type const & point, value_type const & v)
+    {
+        checkSubarrayBounds(point, point + shape_type(1), "ChunkedArray::setItem()");
+        shape_type chunkIndex = point / chunk_shape_;
+        detail::ChunkedArrayLock lock(mutex_);
+        getChunk(chunkIndex, true)[point - chunkStart(chunkIndex)] = v;
+    }
+
+        /** Copy the elements in the block starting at <tt>start</tt> with the
+            shape of <tt>subarray</tt> into <tt>subarray</tt>.
+        */
+    template <class U, class Stride>
+    void checkoutSubarray(shape_type const & start, MultiArrayView<N, U, Stride> subarray) const
+    {
+        shape_type stop = start + subarray.shape();
+        checkSubarrayBounds(start, stop, "ChunkedArray::checkoutSubarray()");
+
+        shape_type chunk_begin = start / chunk_shape_,
+                   chunk_end   = (stop + chunk_shape_ - shape_type(1)) / chunk_shape_;
+        MultiCoordinateIterator<N> i(chunk_end - chunk_begin),
+                                   end = i.getEndIterator();
+        for(; i != end; ++i)
+        {
+            shape_type chunkIndex  = chunk_begin + *i,
+                       chunk_start = chunkStart(chunkIndex),
+                       from        = max(start, chunk_start),
+                       to          = min(stop, chunkStop(chunkIndex));
+            detail::ChunkedArrayLock lock(mutex_);
+            subarray.subarray(from - start, to - start) = 
+                getChunk(chunkIndex, false).subarray(from - chunk_start, to - chunk_start);
+        }
+    }
+
+        /** Copy the elements of <tt>subarray</tt> into the block starting 
+            at <tt>start</tt>.
+        */
+    template <class U, class Stride>
+    void commitSubarray(shape_type const & start, MultiArrayView<N, U, Stride> const & subarray)
+    {
+        shape_type stop = start + subarray.shape();
+        checkSubarrayBounds(start, stop, "ChunkedArray::commitSubarray()");
+
+        shape_type chunk_begin = start / chunk_shape_,
+                   chunk_end   = (stop + chunk_shape_ - shape_type(1)) / chunk_shape_;
+        MultiCoordinateIterator<N> i(chunk_end - chunk_begin),
+                                   end = i.getEndIterator();
+        for(; i != end; ++i)
+        {
+            shape_type chunkIndex  = chunk_begin + *i,
+                       chunk_start = chunkStart(chunkIndex),
+                       from        = max(start, chunk_start),
+                       to          = min(stop, chunkStop(chunkIndex));
+            detail::ChunkedArrayLock lock(mutex_);
+            getChunk(chunkIndex, true).subarray(from - chunk_start, to - chunk_start) = 
+                subarray.subarray(from - start, to - start);
+        }
+    }
+
+        /** Return a copy of the block <tt>[start, stop)</tt> as an ordinary \ref MultiArray.
+        */
+    MultiArray<N, T> subarray(shape_type const & start, shape_type const & stop) const
+    {
+        MultiArray<N, T> res(stop - start);
+        checkoutSubarray(start, res);
+        return res;
+    }
+
+        /** Pass all modified chunks in the cache to the storage backend.
+            The chunks remain in the cache.
+        */
+    virtual void flush()
+    {
+        detail::ChunkedArrayLock lock(mutex_);
+        for(typename std::list<std::size_t>::iterator i = cache_.begin(); i != cache_.end(); ++i)
+        {
+            Chunk & chunk = chunks_[*i];
+            if(chunk.dirty)
+            {
+                storeChunk(*i, chunkIndexOf(*i), view_type(chunkShapeAt(*i), chunk.data.data()));
+                chunk.dirty = false;
+            }
+        }
+    }
+
+  protected:
+
+        /** Fill <tt>chunk</tt> with the stored data of the chunk at 
+            <tt>chunkIndex</tt>, or with the fill value if it was never stored.
+            <tt>index</tt> is the scan-order index of the chunk.
+        */
+    virtual void loadChunk(std::size_t index, shape_type const & chunkIndex, view_type chunk) = 0;
+
+        /** Store the modified data of a chunk that is about to be evicted 
+            from the cache, or flushed.
+        */
+    virtual void storeChunk(std::size_t index, shape_type const & chunkIndex, view_type const & chunk) = 0;
+
+    std::size_t numChunks() const
+    {
+        return chunks_.size();
+    }
+
+        // does the cache hold the chunk with scan-order index 'index'?
+        // (must be called with mutex_ locked, i.e. from loadChunk() or storeChunk())
+    bool isCached(std::size_t index) const
+    {
+        return chunks_[index].data.size() > 0;
+    }
+
+    value_type fill_value_;
+    mutable detail::ChunkedArrayMutex mutex_;
+
+  private:
+    struct Chunk
+    {
+        Chunk()
+        : dirty(false)
+        {}
+
+        ArrayVector<T> data;      // empty when the chunk is not in the cache
+        bool dirty;               // modified since it was loaded
+        typename std::list<std::size_t>::iterator lru;
+    };
+
+    void checkSubarrayBounds(shape_type const & start, shape_type const & stop, 
+                             const char * message) const
+    {
+        for(unsigned int k=0; k<N; ++k)
+            vigra_precondition(0 <= start[k] && start[k] <= stop[k] && stop[k] <= shape_[k],
+                std::string(message) + ": subarray out of bounds.");
+    }
+
+    shape_type chunkIndexOf(std::size_t index) const
+    {
+        shape_type res;
+        for(unsigned int k=0; k<N; ++k)
+        {
+            res[k] = index % chunk_array_shape_[k];
+            index /= chunk_array_shape_[k];
+        }
+        return res;
+    }
+
+    shape_type chunkShapeAt(std::size_t index) const
+    {
+        shape_type i = chunkIndexOf(index);
+        return chunkStop(i) - chunkStart(i);
+    }
+
+        // return the chunk, after loading it into the cache if necessary
+        // (the cache is logically const, mutex_ must be locked)
+    view_type getChunk(shape_type const & chunkIndex, bool write) const
+    {
+        ChunkedArray * self = const_cast<ChunkedArray *>(this);
+        std::size_t index = dot(chunkIndex, chunk_strides_);
+        Chunk & chunk = self->chunks_[index];
+        shape_type shape = chunkStop(chunkIndex) - chunkStart(chunkIndex);
+
+        if(chunk.data.size() == 0)
+        {
+            chunk.data.resize(prod(shape));
+            try
+            {
+                self->loadChunk(index, chunkIndex, view_type(shape, chunk.data.data()));
+            }
+            catch(...)
+            {
+                ArrayVector<T>().swap(chunk.data);
+                throw;
+            }
+            self->cache_.push_front(index);
+            chunk.lru = self->cache_.begin();
+            self->cache_bytes_ += chunk.data.size() * sizeof(T);
+            ++self->cache_misses_;
+            self->evict(index);
+        }
+        else
+        {
+            self->cache_.splice(self->cache_.begin(), self->cache_, chunk.lru);
+        }
+        chunk.dirty = chunk.dirty || write;
+        return view_type(shape, chunk.data.data());
+    }
+
+        // remove least recently used chunks except 'keep' until the 
+        // cache fits into its budget (mutex_ must be locked)
+    void evict(std::ptrdiff_t keep)
+    {
+        while(cache_bytes_ > cache_max_ && cache_.size() > 0 && 
+              (std::ptrdiff_t)cache_.back() != keep)
+        {
+            std::size_t index = cache_.back();
+            Chunk & chunk = chunks_[index];
+            if(chunk.dirty)
+                storeChunk(index, chunkIndexOf(index), view_type(chunkShapeAt(index), chunk.data.data()));
+            cache_.pop_back();
+            cache_bytes_ -= chunk.data.size() * sizeof(T);
+            ArrayVector<T>().swap(chunk.data);
+            chunk.dirty = false;
+        }
+    }
+
+    shape_type shape_, chunk_shape_, chunk_array_shape_, chunk_strides_;
+    ArrayVector<Chunk> chunks_;
+    std::list<std::size_t> cache_;   // most recently used chunk first
+    std::size_t cache_max_, cache_bytes_, cache_misses_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                ChunkedArrayCompressed                */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Chunked array that compresses cold chunks in memory.
+
+        Chunks that are evicted from the cache are compressed with the method 
+        given in \ref ChunkedArrayOptions::compression() and uncompressed 
+        when they are needed again. Chunks that have never been written
+        occupy no memory at all. With <tt>NO_COMPRESSION</tt>, evicted chunks 
+        are stored as plain copies.
+
+        <b>Usage:</b>
+
+        \code
+        // a 40 GB volume, of which at most 1 GB is kept uncompressed
+        ChunkedArrayCompressed<3, float> data(Shape3(4096, 4096, 640), Shape3(64),
+                    ChunkedArrayOptions().cacheMax(1 << 30).compression(ZLIB_FAST));
+        \endcode
+
+        <b>\#include</b> \<vigra/multi_array_chunked.hxx\><br>
+        Namespace: vigra
+    */
+template <unsigned int N, class T>
+class ChunkedArrayCompressed
+: public ChunkedArray<N, T>
+{
+  public:
+    typedef ChunkedArray<N, T>              base_type;
+    typedef typename base_type::shape_type  shape_type;
+    typedef typename base_type::view_type   view_type;
+
+    explicit ChunkedArrayCompressed(shape_type const & shape,
+                                    shape_type const & chunk_shape = shape_type(),
+                                    ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : base_type(shape, chunk_shape, options),
+      compression_method_(options.compression_method),
+      compressed_(this->numChunks())
+    {
+        vigra_precondition(compressionAvailable(compression_method_),
+            "ChunkedArrayCompressed(): compression method is not available.");
+    }
+
+        /** Memory occupied by the compressed chunks in bytes.
+        */
+    std::size_t compressedBytes() const
+    {
+        detail::ChunkedArrayLock lock(this->mutex_);
+        std::size_t res = 0;
+        for(std::size_t k=0; k<compressed_.size(); ++k)
+            res += compressed_[k].size();
+        return res;
+    }
+
+  protected:
+    virtual void loadChunk(std::size_t index, shape_type const &, view_type chunk)
+    {
+        ArrayVector<char> & buffer = compressed_[index];
+        if(buffer.size() == 0)
+        {
+            chunk.init(this->fill_value_);
+        }
+        else
+        {
+            // keep the compressed copy, so that unmodified chunks
+            // need not be compressed again upon eviction
+            uncompress(buffer.data(), buffer.size(), (char *)chunk.data(), 
+                       chunk.size()*sizeof(T), compression_method_);
+        }
+    }
+
+    virtual void storeChunk(std::size_t index, shape_type const &, view_type const & chunk)
+    {
+        compress((char const *)chunk.data(), chunk.size()*sizeof(T), 
+                 compressed_[index], compression_method_);
+    }
+
+  private:
+    CompressionMethod compression_method_;
+    ArrayVector<ArrayVector<char> > compressed_;
+};
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_ARRAY_CHUNKED_HXX
@@ -0,0 +1,262 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+
+#ifndef VIGRA_MULTI_ARRAY_CHUNKED_HDF5_HXX
+#define VIGRA_MULTI_ARRAY_CHUNKED_HDF5_HXX
+
+#include <string>
+#include "multi_array_chunked.hxx"
+#include "hdf5impex.hxx"
+
+namespace vigra {
+
+/** \addtogroup ChunkedArrayClasses
+*/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*                   ChunkedArrayHDF5                   */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Chunked array backed by a dataset in an HDF5 file.
+
+        Chunks are read from the dataset when they are first accessed and 
+        written back when they are evicted from the cache (only if they 
+        were modified), when \ref flush() is called, and in the destructor. 
+        The dataset's chunking is made to coincide with the array's chunks, 
+        so that each chunk maps onto one HDF5 chunk.
+
+        If \ref ChunkedArrayOptions::readAhead() is positive, a missing chunk 
+        is read together with up to this many following chunks along the 
+        first axis in a single HDF5 call. The additional chunks are kept in 
+        a read-ahead buffer (outside the cache budget) and enter the cache
+        without further file access when they are requested, which speeds 
+        up scan-order traversals of the array.
+
+        The <tt>HDF5File</tt> must remain open for the lifetime of the array.
+        The destructor ignores errors during writing, so call \ref flush() 
+        explicitly to detect them.
+
+        <b>Usage:</b>
+
+        \code
+        HDF5File file("volume.h5", HDF5File::Open);
+
+        // create a new dataset
+        ChunkedArrayHDF5<3, float> data(file, "data", Shape3(10000, 10000, 5000), Shape3(64),
+                                        ChunkedArrayOptions().cacheMax(std::ptrdiff_t(4) << 30).readAhead(4));
+        ...
+        data.flush();
+
+        // open an existing dataset
+        ChunkedArrayHDF5<3, float> existing(file, "other");
+        \endcode
+
+        <b>\#include</b> \<vigra/multi_array_chunked_hdf5.hxx\><br>
+        Namespace: vigra
+    */
+template <unsigned int N, class T>
+class ChunkedArrayHDF5
+: public ChunkedArray<N, T>
+{
+  public:
+    typedef ChunkedArray<N, T>              base_type;
+    typedef typename base_type::shape_type  shape_type;
+    typedef typename base_type::view_type   view_type;
+
+        /** Open the existing dataset <tt>dataset</tt> in <tt>file</tt>.
+            The chunk shape is taken from the dataset, or the default chunk
+            shape is used if the dataset is not chunked.
+        */
+    ChunkedArrayHDF5(HDF5File & file, std::string const & dataset,
+                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : base_type(datasetShape(file, dataset), datasetChunkShape(file, dataset), options),
+      file_(file),
+      dataset_(absolutePath(file, dataset)),
+      read_ahead_(options.read_ahead)
+    {}
+
+        /** Create the dataset <tt>dataset</tt> in <tt>file</tt> with the given
+            shape and chunk shape (an existing dataset of the same name is replaced).
+            The dataset is compressed if <tt>options.compression()</tt> is a zlib 
+            method.
+        */
+    ChunkedArrayHDF5(HDF5File & file, std::string const & dataset,
+                     shape_type const & shape, shape_type const & chunk_shape = shape_type(),
+                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : base_type(shape, chunk_shape, options),
+      file_(file),
+      dataset_(absolutePath(file, dataset)),
+      read_ahead_(options.read_ahead)
+    {
+        int compression = options.compression_method > 0 
+                              ? (int)options.compression_method
+                              : 0;
+        file_.createDataset<N, T>(dataset_, shape, this->fill_value_, 
+                                  min(this->chunkShape(), shape), compression);
+    }
+
+    ~ChunkedArrayHDF5()
+    {
+        try
+        {
+            flush();
+        }
+        catch(...)
+        {}
+    }
+
+        /** Write all modified chunks to the file and flush the file.
+        */
+    virtual void flush()
+    {
+        base_type::flush();
+        file_.flushToDisk();
+    }
+
+        /** Absolute name of the dataset.
+        */
+    std::string const & datasetName() const
+    {
+        return dataset_;
+    }
+
+  protected:
+    virtual void loadChunk(std::size_t index, shape_type const & chunkIndex, view_type chunk)
+    {
+        shape_type start = this->chunkStart(chunkIndex),
+                   stop  = start + chunk.shape();
+        if(read_ahead_ == 0)
+        {
+            file_.readBlock(dataset_, start, chunk.shape(), chunk);
+            return;
+        }
+
+        if(!readAheadContains(start, stop))
+        {
+            // read up to read_ahead_ following chunks along axis 0, stopping
+            // at the first one that is already cached (scan-order indices of
+            // neighbors along axis 0 differ by one)
+            shape_type last(chunkIndex);
+            for(int k=0; k<read_ahead_ && last[0] + 1 < this->chunkArrayShape()[0]; ++k)
+            {
+                if(this->isCached(index + k + 1))
+                    break;
+                ++last[0];
+            }
+            shape_type read_stop = this->chunkStop(last);
+            read_ahead_buffer_.reshape(read_stop - start);
+            file_.readBlock(dataset_, start, read_stop - start, read_ahead_buffer_);
+            read_ahead_start_ = start;
+        }
+        chunk = read_ahead_buffer_.subarray(start - read_ahead_start_, stop - read_ahead_start_);
+    }
+
+    virtual void storeChunk(std::size_t, shape_type const & chunkIndex, view_type const & chunk)
+    {
+        shape_type start = this->chunkStart(chunkIndex),
+                   stop  = start + chunk.shape();
+        file_.writeBlock(dataset_, start, chunk);
+
+        // keep the read-ahead buffer consistent with the file
+        if(readAheadContains(start, stop))
+            read_ahead_buffer_.subarray(start - read_ahead_start_, stop - read_ahead_start_) = chunk;
+    }
+
+  private:
+    bool readAheadContains(shape_type const & start, shape_type const & stop) const
+    {
+        if(read_ahead_buffer_.size() == 0)
+            return false;
+        for(unsigned int k=0; k<N; ++k)
+            if(start[k] < read_ahead_start_[k] || 
+               stop[k] > read_ahead_start_[k] + read_ahead_buffer_.shape(k))
+                return false;
+        return true;
+    }
+
+    static std::string absolutePath(HDF5File & file, std::string const & dataset)
+    {
+        if(dataset.size() > 0 && dataset[0] == '/')
+            return dataset;
+        std::string group = file.pwd();
+        return group == "/"
+                   ? group + dataset
+                   : group + "/" + dataset;
+    }
+
+    static shape_type datasetShape(HDF5File & file, std::string const & dataset)
+    {
+        ArrayVector<hsize_t> shape = file.getDatasetShape(dataset);
+        vigra_precondition(shape.size() == N,
+            "ChunkedArrayHDF5(): dataset has the wrong number of dimensions.");
+        return shape_type(shape.begin());
+    }
+
+    static shape_type datasetChunkShape(HDF5File & file, std::string const & dataset)
+    {
+        HDF5Handle datasetHandle = file.getDatasetHandle(dataset);
+        HDF5Handle plist(H5Dget_create_plist(datasetHandle), &H5Pclose,
+                         "ChunkedArrayHDF5(): unable to get dataset properties.");
+        shape_type res;
+        if(H5Pget_layout(plist) == H5D_CHUNKED)
+        {
+            hsize_t chunks[N];
+            if(H5Pget_chunk(plist, N, chunks) == (int)N)
+            {
+                // invert the dimensions to VIGRA order
+                for(unsigned int k=0; k<N; ++k)
+                    res[k] = chunks[N-1-k];
+            }
+        }
+        return res;
+    }
+
+    HDF5File & file_;
+    std::string dataset_;
+    int read_ahead_;
+    MultiArray<N, T> read_ahead_buffer_;
+    shape_type read_ahead_start_;
+};
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_ARRAY_CHUNKED_HDF5_HXX
@@ -502,15 +502,17 @@ template <class SrcIterator, class SrcShape, class SrcAccessor,
 void
 internalSeparableConvolveMultiArrayTmp(
                       SrcIterator si, SrcShape const & shape, SrcAccessor src,
-                      DestIterator di, DestAccessor dest, KernelIterator kit)
+                      DestIterator di, DestAccessor dest, KernelIterator kit,
+                      ArrayVector<typename NumericTraits<typename DestAccessor::value_type>::RealPromote> & tmp)
 {
     enum { N = 1 + SrcIterator::level };
 
     typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
     typedef typename AccessorTraits<TmpType>::default_accessor TmpAcessor;
 
-    // temporary array to hold the current line to enable in-place operation
-    ArrayVector<TmpType> tmp( shape[0] );
+    // 'tmp' holds the current line to enable in-place operation,
+    // it is passed in by the caller so that it can be reused across calls
+    tmp.resize( shape[0] );
 
     typedef MultiArrayNavigator<SrcIterator, N> SNavigator;
     typedef MultiArrayNavigator<DestIterator, N> DNavigator;
@@ -553,6 +555,21 @@ internalSeparableConvolveMultiArrayTmp(
     }
 }
 
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class KernelIterator>
+inline void
+internalSeparableConvolveMultiArrayTmp(
+                      SrcIterator si, SrcShape const & shape, SrcAccessor src,
+                      DestIterator di, DestAccessor dest, KernelIterator kit)
+{
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+
+    // temporary array to hold the current line to enable in-place operation
+    ArrayVector<TmpType> tmp( shape[0] );
+
+    internalSeparableConvolveMultiArrayTmp(si, shape, src, di, dest, kit, tmp);
+}
+
 /********************************************************/
 /*                                                      */
 /*         internalSeparableConvolveSubarray            */
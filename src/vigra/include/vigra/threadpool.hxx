@@ -0,0 +1,501 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+
+#ifndef VIGRA_THREADPOOL_HXX
+#define VIGRA_THREADPOOL_HXX
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include "config.hxx"
+#include "error.hxx"
+
+#ifdef VIGRA_HAS_STD_THREADS
+# include <condition_variable>
+# include <functional>
+# include <future>
+# include <memory>
+# include <mutex>
+# include <queue>
+# include <thread>
+# include <vector>
+#endif
+
+namespace vigra {
+
+/** \addtogroup ParallelProcessing Functions and classes for parallel processing.
+*/
+
+//@{
+
+    /** \brief Option base class for parallel algorithms.
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+    */
+class ParallelOptions
+{
+  public:
+
+        /** Constants for special settings.
+        */
+    enum {
+        Auto       = -1, ///< Determine number of threads automatically (from <tt>std::thread::hardware_concurrency()</tt>)
+        Nice       = -2, ///< Use half as many threads as <tt>Auto</tt> would.
+        NoThreads  =  0  ///< Switch off multi-threading (i.e. execute tasks sequentially)
+    };
+
+    ParallelOptions()
+    :   numThreads_(actualNumThreads(Auto))
+    {}
+
+        /** \brief Get desired number of threads.
+
+            <b>Note:</b> This function may return 0, which means that multi-threading
+            shall be switched off entirely. If an algorithm receives this value,
+            it should revert to a sequential implementation. In contrast, if
+            <tt>getNumThreads() == 1</tt>, the parallel algorithm version shall be
+            executed with a single thread.
+        */
+    int getNumThreads() const
+    {
+        return numThreads_;
+    }
+
+        /** \brief Get desired number of threads.
+
+            In contrast to <tt>getNumThreads()</tt>, this will always return a value <tt>>=1</tt>.
+        */
+    int getActualNumThreads() const
+    {
+        return std::max(1, numThreads_);
+    }
+
+        /** \brief Set the number of threads or one of the constants <tt>Auto</tt>,
+                   <tt>Nice</tt> and <tt>NoThreads</tt>.
+
+            Default: <tt>ParallelOptions::Auto</tt> (use system default)
+
+            This setting is ignored if the preprocessor flag <tt>VIGRA_HAS_STD_THREADS</tt>
+            is not defined (i.e. when the compiler does not support C++11 threads).
+            Then, the number of threads is always 0 and all tasks are executed
+            sequentially.
+        */
+    ParallelOptions & numThreads(const int n)
+    {
+        numThreads_ = actualNumThreads(n);
+        return *this;
+    }
+
+  private:
+        // helper function to compute the actual number of threads
+    static int actualNumThreads(const int userNThreads)
+    {
+#ifdef VIGRA_HAS_STD_THREADS
+        return userNThreads >= 0
+                   ? userNThreads
+                   : userNThreads == Nice
+                           ? (int)std::thread::hardware_concurrency() / 2
+                           : (int)std::thread::hardware_concurrency();
+#else
+        return 0;
+#endif
+    }
+
+    int numThreads_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                      ThreadPool                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Thread pool class to manage a set of parallel workers.
+
+        The pool starts its worker threads in the constructor and joins
+        them in the destructor, so that the cost of thread creation is paid
+        only once for an arbitrary number of tasks. Tasks are functors 
+        that are called with the index of the executing thread (in the range 
+        <tt>[0, numThreads())</tt>). Algorithms can use this index to
+        select per-thread scratch memory without further synchronization.
+
+        If the pool has no threads (i.e. <tt>numThreads() == 0</tt>),
+        <tt>enqueue()</tt> executes each task immediately in the calling
+        thread, passing thread index 0.
+
+        <b>Usage:</b>
+
+        \code
+        ThreadPool pool(ParallelOptions().numThreads(4));
+        std::vector<std::future<void> > results;
+        for(int k=0; k<100; ++k)
+            results.push_back(pool.enqueue([k](int threadId) { process(k); }));
+        for(int k=0; k<100; ++k)
+            results[k].get(); // re-throws exceptions raised by the task
+        \endcode
+
+        <b>\#include</b> \<vigra/threadpool.hxx\><br>
+        Namespace: vigra
+    */
+#ifdef VIGRA_HAS_STD_THREADS
+
+class ThreadPool
+{
+  public:
+
+        /** Create a thread pool from ParallelOptions. The constructor just launches
+            the desired number of workers. If the number of threads is zero,
+            no workers are started, and all tasks will be executed synchronously
+            in the present thread.
+         */
+    explicit ThreadPool(const ParallelOptions & options)
+    :   stop_(false),
+        busy_(0)
+    {
+        init(options.getNumThreads());
+    }
+
+        /** Create a thread pool with n threads. The constructor just launches
+            the desired number of workers. If \arg n is <tt>ParallelOptions::Auto</tt>,
+            the number of threads is determined by <tt>std::thread::hardware_concurrency()</tt>.
+            <tt>ParallelOptions::Nice</tt> will create half as many threads.
+            If <tt>n = 0</tt>, no workers are started, and all tasks will be executed
+            synchronously in the present thread.
+         */
+    explicit ThreadPool(const int n)
+    :   stop_(false),
+        busy_(0)
+    {
+        init(ParallelOptions().numThreads(n).getNumThreads());
+    }
+
+        /** The destructor joins all threads. Tasks that are still in the queue
+            are executed before the threads terminate.
+         */
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            stop_ = true;
+        }
+        worker_condition_.notify_all();
+        for(std::size_t k=0; k<workers_.size(); ++k)
+            workers_[k].join();
+    }
+
+        /** Enqueue a task that will be executed by the thread pool.
+            The task result can be obtained using the get() function of the returned future.
+            If the task throws an exception, it will be raised on the call to get().
+         */
+    template<class F>
+    auto enqueue(F && f) -> std::future<decltype(f(0))>
+    {
+        typedef decltype(f(0)) result_type;
+        typedef std::packaged_task<result_type(int)> PackageType;
+
+        auto task = std::make_shared<PackageType>(std::forward<F>(f));
+        auto res = task->get_future();
+
+        if(workers_.size() > 0)
+        {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex_);
+
+                // don't allow enqueueing after stopping the pool
+                vigra_precondition(!stop_, "ThreadPool::enqueue(): enqueue on stopped ThreadPool.");
+
+                tasks_.emplace(
+                    [task](int tid)
+                    {
+                        (*task)(tid);
+                    }
+                );
+            }
+            worker_condition_.notify_one();
+        }
+        else
+        {
+            (*task)(0);
+        }
+        return res;
+    }
+
+        /** Block until all tasks are finished.
+         */
+    void waitFinished()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        finish_condition_.wait(lock, [this]{ return tasks_.empty() && busy_ == 0; });
+    }
+
+        /** Return the number of worker threads.
+         */
+    std::size_t numThreads() const
+    {
+        return workers_.size();
+    }
+
+  private:
+
+        // helper function to init the thread pool
+    void init(const int nThreads)
+    {
+        for(int ti = 0; ti < nThreads; ++ti)
+        {
+            workers_.emplace_back(
+                [ti, this]
+                {
+                    for(;;)
+                    {
+                        std::function<void(int)> task;
+                        {
+                            std::unique_lock<std::mutex> lock(this->queue_mutex_);
+
+                            // will wait if : stop == false AND queue is empty
+                            // if stop == true AND queue is empty thread function will return later
+                            this->worker_condition_.wait(lock,
+                                [this]{ return this->stop_ || !this->tasks_.empty(); });
+
+                            if(this->tasks_.empty())
+                                return;
+
+                            ++this->busy_;
+                            task = std::move(this->tasks_.front());
+                            this->tasks_.pop();
+                        }
+
+                        // exceptions are stored in the task's future
+                        task(ti);
+
+                        {
+                            std::unique_lock<std::mutex> lock(this->queue_mutex_);
+                            --this->busy_;
+                        }
+                        this->finish_condition_.notify_all();
+                    }
+                }
+            );
+        }
+    }
+
+        // need to keep track of threads so we can join them
+    std::vector<std::thread> workers_;
+
+        // the task queue
+    std::queue<std::function<void(int)> > tasks_;
+
+        // synchronization
+    std::mutex queue_mutex_;
+    std::condition_variable worker_condition_;
+    std::condition_variable finish_condition_;
+    bool stop_;
+    int busy_;
+};
+
+#else // VIGRA_HAS_STD_THREADS
+
+    // Fallback without C++11 threads: all tasks are executed
+    // synchronously in the calling thread.
+class ThreadPool
+{
+  public:
+    explicit ThreadPool(const ParallelOptions &)
+    {}
+
+    explicit ThreadPool(const int)
+    {}
+
+    template<class F>
+    void enqueue(F const & f)
+    {
+        f(0);
+    }
+
+    void waitFinished()
+    {}
+
+    std::size_t numThreads() const
+    {
+        return 0;
+    }
+};
+
+#endif // VIGRA_HAS_STD_THREADS
+
+/********************************************************/
+/*                                                      */
+/*                   parallel_foreach                   */
+/*                                                      */
+/********************************************************/
+
+/** \brief Apply a functor to all items in a range in parallel.
+
+    The range <tt>[begin, end)</tt> is split into contiguous chunks which
+    are distributed over the threads of the given \ref ThreadPool (or of 
+    a temporary pool with <tt>nThreads</tt> threads). The functor is called as
+    <tt>f(threadId, *iter)</tt>, where <tt>threadId</tt> is the index of the
+    executing thread, so that <tt>f</tt> can maintain thread-local scratch
+    data without locking. The function returns when all items have been 
+    processed. Exceptions thrown by <tt>f</tt> are re-thrown in the calling
+    thread.
+
+    If the number of items in the range is known, it can be passed as 
+    <tt>nItems</tt> to avoid an additional pass over the range. If the pool has
+    no threads, the items are processed sequentially in the calling thread with
+    <tt>threadId == 0</tt>.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        template <class ITER, class F>
+        void parallel_foreach(ThreadPool & pool,
+                              ITER begin, ITER end, F && f,
+                              std::size_t nItems = 0);
+
+        template <class ITER, class F>
+        void parallel_foreach(int nThreads,
+                              ITER begin, ITER end, F && f,
+                              std::size_t nItems = 0);
+    }
+    \endcode
+
+    <b>Usage:</b>
+
+    \code
+    std::vector<int> v(100);
+    std::vector<double> threadSums(4, 0.0);
+    parallel_foreach(4, v.begin(), v.end(),
+        [&threadSums](int threadId, int item)
+        {
+            threadSums[threadId] += item;
+        });
+    \endcode
+
+    <b>\#include</b> \<vigra/threadpool.hxx\><br>
+    Namespace: vigra
+*/
+doxygen_overloaded_function(template <...> void parallel_foreach)
+
+#ifdef VIGRA_HAS_STD_THREADS
+
+template<class ITER, class F>
+void
+parallel_foreach(ThreadPool & pool,
+                 ITER begin, ITER end, F && f,
+                 std::size_t nItems = 0)
+{
+    std::size_t workload = nItems > 0
+                               ? nItems
+                               : (std::size_t)std::distance(begin, end);
+
+    if(pool.numThreads() == 0)
+    {
+        for(; workload > 0; --workload, ++begin)
+            f(0, *begin);
+        return;
+    }
+
+    // use several chunks per thread to balance the load
+    std::size_t chunkSize = std::max<std::size_t>(workload / (4*pool.numThreads()), 1);
+
+    std::vector<std::future<void> > futures;
+    for(; workload > 0; )
+    {
+        std::size_t const lc = std::min(workload, chunkSize);
+        workload -= lc;
+        futures.push_back(pool.enqueue(
+            [&f, begin, lc](int threadId)
+            {
+                ITER iter = begin;
+                for(std::size_t k=0; k<lc; ++k, ++iter)
+                    f(threadId, *iter);
+            }
+        ));
+        std::advance(begin, lc);
+    }
+    // wait for all tasks before re-throwing the first exception, since
+    // the tasks refer to 'f'
+    for(std::size_t k=0; k<futures.size(); ++k)
+        futures[k].wait();
+    for(std::size_t k=0; k<futures.size(); ++k)
+        futures[k].get();
+}
+
+template<class ITER, class F>
+inline void
+parallel_foreach(int nThreads,
+                 ITER begin, ITER end, F && f,
+                 std::size_t nItems = 0)
+{
+    ThreadPool pool(nThreads);
+    parallel_foreach(pool, begin, end, std::forward<F>(f), nItems);
+}
+
+#else // VIGRA_HAS_STD_THREADS
+
+template<class ITER, class F>
+void
+parallel_foreach(ThreadPool &,
+                 ITER begin, ITER end, F const & f,
+                 std::size_t nItems = 0)
+{
+    std::size_t workload = nItems > 0
+                               ? nItems
+                               : (std::size_t)std::distance(begin, end);
+    for(; workload > 0; --workload, ++begin)
+        f(0, *begin);
+}
+
+template<class ITER, class F>
+inline void
+parallel_foreach(int nThreads,
+                 ITER begin, ITER end, F const & f,
+                 std::size_t nItems = 0)
+{
+    ThreadPool pool(nThreads);
+    parallel_foreach(pool, begin, end, f, nItems);
+}
+
+#endif // VIGRA_HAS_STD_THREADS
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_THREADPOOL_HXX
@@ -0,0 +1,130 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+
+#include <cstring>
+#include "vigra/compression.hxx"
+#include "vigra/error.hxx"
+
+#ifdef HasZLIB
+#include <zlib.h>
+#endif
+
+namespace vigra {
+
+namespace {
+
+CompressionMethod resolveCompressionMethod(CompressionMethod method)
+{
+    if(method == DEFAULT_COMPRESSION)
+    {
+#ifdef HasZLIB
+        return ZLIB_FAST;
+#else
+        return NO_COMPRESSION;
+#endif
+    }
+    return method;
+}
+
+} // anonymous namespace
+
+bool compressionAvailable(CompressionMethod method)
+{
+    switch(resolveCompressionMethod(method))
+    {
+      case NO_COMPRESSION:
+        return true;
+      case ZLIB_FAST:
+      case ZLIB:
+      case ZLIB_BEST:
+#ifdef HasZLIB
+        return true;
+#else
+        return false;
+#endif
+      default:
+        return false;
+    }
+}
+
+void compress(char const * source, std::size_t size,
+              ArrayVector<char> & dest, CompressionMethod method)
+{
+    method = resolveCompressionMethod(method);
+    vigra_precondition(compressionAvailable(method),
+        "compress(): unknown compression method or vigraimpex was built without zlib.");
+
+    if(method == NO_COMPRESSION)
+    {
+        ArrayVector<char>(source, source + size).swap(dest);
+        return;
+    }
+
+#ifdef HasZLIB
+    uLongf destSize = ::compressBound(size);
+    ArrayVector<char> buffer(destSize);
+    int res = ::compress2((Bytef *)buffer.data(), &destSize, (Bytef const *)source, size, (int)method);
+    vigra_postcondition(res == Z_OK, "compress(): zlib compression failed.");
+
+    // copy into a buffer of the exact size, since resize() would
+    // keep the capacity of the worst-case bound
+    ArrayVector<char>(buffer.begin(), buffer.begin() + destSize).swap(dest);
+#endif
+}
+
+void uncompress(char const * source, std::size_t srcSize, 
+                char * dest, std::size_t destSize, CompressionMethod method)
+{
+    method = resolveCompressionMethod(method);
+    vigra_precondition(compressionAvailable(method),
+        "uncompress(): unknown compression method or vigraimpex was built without zlib.");
+
+    if(method == NO_COMPRESSION)
+    {
+        vigra_postcondition(srcSize == destSize, "uncompress(): data size mismatch.");
+        std::memcpy(dest, source, srcSize);
+        return;
+    }
+
+#ifdef HasZLIB
+    uLongf size = destSize;
+    int res = ::uncompress((Bytef *)dest, &size, (Bytef const *)source, srcSize);
+    vigra_postcondition(res == Z_OK && size == destSize, "uncompress(): zlib decompression failed.");
+#endif
+}
+
+} // namespace vigra
@@ -0,0 +1,206 @@
+/************************************************************************/
+/*                                                                      */
+/*                 Copyright 2014 by Ullrich Koethe                     */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#include <iostream>
+#include <vector>
+
+#include "vigra/unittest.hxx"
+#include "vigra/multi_array.hxx"
+#include "vigra/multi_convolution.hxx"
+#include "vigra/blockwise_convolution.hxx"
+#include "vigra/threadpool.hxx"
+#include "vigra/random.hxx"
+
+using namespace vigra;
+
+struct ThreadPoolTest
+{
+    struct Count
+    {
+        std::vector<int> * count;
+
+        void operator()(int, int item) const
+        {
+            ++(*count)[item];
+        }
+    };
+
+    void testParallelForeach()
+    {
+        std::vector<int> items(1000), count(1000, 0);
+        for(int k=0; k<1000; ++k)
+            items[k] = k;
+
+        Count f = { &count };
+        parallel_foreach(4, items.begin(), items.end(), f);
+        for(int k=0; k<1000; ++k)
+            shouldEqual(count[k], 1);
+
+        // serial execution
+        parallel_foreach(ParallelOptions::NoThreads, items.begin(), items.end(), f, items.size());
+        for(int k=0; k<1000; ++k)
+            shouldEqual(count[k], 2);
+
+        ThreadPool pool(ParallelOptions().numThreads(3));
+        parallel_foreach(pool, items.begin(), items.end(), f);
+        pool.waitFinished();
+        for(int k=0; k<1000; ++k)
+            shouldEqual(count[k], 3);
+    }
+};
+
+struct BlockwiseConvolutionTest
+{
+    typedef MultiArrayShape<3>::type Shape;
+
+    MultiArray<3, float> data;
+
+    BlockwiseConvolutionTest()
+    : data(Shape(53, 47, 29))
+    {
+        RandomMT19937 random(42);
+        for(MultiArrayIndex k=0; k<data.size(); ++k)
+            data[k] = random.uniform(0.0, 255.0);
+    }
+
+    void testSeparableConvolution()
+    {
+        BorderTreatmentMode modes[] = { BORDER_TREATMENT_REFLECT, BORDER_TREATMENT_REPEAT,
+                                        BORDER_TREATMENT_CLIP, BORDER_TREATMENT_ZEROPAD };
+        for(int m=0; m<4; ++m)
+        {
+            ArrayVector<Kernel1D<double> > kernels(3);
+            kernels[0].initGaussian(2.0);
+            kernels[1].initGaussianDerivative(1.5, 1);
+            kernels[2].initGaussian(1.0);
+            for(int k=0; k<3; ++k)
+                kernels[k].setBorderTreatment(modes[m]);
+
+            MultiArray<3, float> serial(data.shape()), blocked(data.shape());
+            separableConvolveMultiArray(data, serial, kernels.begin());
+
+            // the result must not depend on block shape and number of threads
+            blockwise::separableConvolveMultiArray(data, blocked, kernels.begin(),
+                                 blockwise::BlockwiseOptions<3>().blockShape(Shape(16, 11, 7)).numThreads(4));
+            should(serial == blocked);
+
+            blocked.init(0.0f);
+            blockwise::separableConvolveMultiArray(data, blocked, kernels.begin(),
+                                 blockwise::BlockwiseOptions<3>().blockShape(1).numThreads(2));
+            should(serial == blocked);
+
+            blocked.init(0.0f);
+            blockwise::separableConvolveMultiArray(data, blocked, kernels.begin(),
+                                 blockwise::BlockwiseOptions<3>().blockShape(20).numThreads(ParallelOptions::NoThreads));
+            should(serial == blocked);
+        }
+    }
+
+    void testGaussianSmoothing()
+    {
+        MultiArray<3, float> serial(data.shape()), blocked(data.shape());
+        gaussianSmoothMultiArray(data, serial, 2.5);
+        blockwise::gaussianSmoothMultiArray(data, blocked, 2.5, ConvolutionOptions<3>(),
+                                            blockwise::BlockwiseOptions<3>().blockShape(Shape(32, 16, 8)));
+        should(serial == blocked);
+
+        // rounding to the destination type must happen after all passes
+        MultiArray<3, UInt8> serial8(data.shape()), blocked8(data.shape());
+        ConvolutionOptions<3> opt = ConvolutionOptions<3>().stepSize(Shape(1, 1, 3)).filterWindowSize(2.0);
+        gaussianSmoothMultiArray(data, serial8, 1.5, opt);
+        blockwise::gaussianSmoothMultiArray(data, blocked8, 1.5, opt,
+                                            blockwise::BlockwiseOptions<3>().blockShape(10).numThreads(3));
+        should(serial8 == blocked8);
+    }
+
+    void testGaussianGradient()
+    {
+        MultiArray<3, TinyVector<float, 3> > serial(data.shape()), blocked(data.shape());
+        gaussianGradientMultiArray(srcMultiArrayRange(data), destMultiArray(serial), 1.5);
+        blockwise::gaussianGradientMultiArray(data, blocked, 1.5, ConvolutionOptions<3>(),
+                                              blockwise::BlockwiseOptions<3>().blockShape(Shape(20, 10, 15)).numThreads(4));
+        should(serial == blocked);
+    }
+
+    void testPreconditions()
+    {
+        Kernel1D<double> kernel;
+        kernel.initGaussian(1.0);
+        kernel.setBorderTreatment(BORDER_TREATMENT_WRAP);
+
+        MultiArray<3, float> res(data.shape());
+        try
+        {
+            blockwise::separableConvolveMultiArray(data, res, kernel);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+
+        MultiArray<3, float> wrongShape(Shape(10, 10, 10));
+        try
+        {
+            blockwise::gaussianSmoothMultiArray(data, wrongShape, 1.0);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+};
+
+struct BlockwiseTestSuite
+: public vigra::test_suite
+{
+    BlockwiseTestSuite()
+    : vigra::test_suite("BlockwiseTestSuite")
+    {
+        add( testCase( &ThreadPoolTest::testParallelForeach));
+        add( testCase( &BlockwiseConvolutionTest::testSeparableConvolution));
+        add( testCase( &BlockwiseConvolutionTest::testGaussianSmoothing));
+        add( testCase( &BlockwiseConvolutionTest::testGaussianGradient));
+        add( testCase( &BlockwiseConvolutionTest::testPreconditions));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    BlockwiseTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,318 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2014 by Ullrich Koethe                                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+
+#include <iostream>
+#include <cstdio>
+
+#include "vigra/unittest.hxx"
+#include "vigra/multi_array.hxx"
+#include "vigra/multi_array_chunked.hxx"
+#ifdef HasHDF5
+#include "vigra/multi_array_chunked_hdf5.hxx"
+#endif
+
+using namespace vigra;
+
+template <class ChunkedArrayType, class Array>
+void shouldEqualChunked(ChunkedArrayType const & chunked, Array const & ref)
+{
+    shouldEqual(chunked.shape(), ref.shape());
+    MultiArray<3, int> res(chunked.subarray(Shape3(), chunked.shape()));
+    should(res == ref);
+}
+
+struct ChunkedArrayTest
+{
+    typedef ChunkedArrayCompressed<3, int> Array;
+
+    MultiArray<3, int> ref;
+
+    ChunkedArrayTest()
+    : ref(Shape3(25, 20, 15))
+    {
+        linearSequence(ref.begin(), ref.end());
+    }
+
+    void testChunkShapes()
+    {
+        Array data(ref.shape(), Shape3(8));
+
+        shouldEqual(data.size(), ref.size());
+        shouldEqual(data.chunkShape(), Shape3(8));
+        shouldEqual(data.chunkArrayShape(), Shape3(4, 3, 2));
+        shouldEqual(data.chunkStart(Shape3(3, 2, 1)), Shape3(24, 16, 8));
+        shouldEqual(data.chunkStop(Shape3(3, 2, 1)), Shape3(25, 20, 15));
+
+        // the default cache holds the largest slab of chunks
+        shouldEqual(data.cacheMax(), 4*3*8*8*8*sizeof(int));
+
+        Array defaultChunks(Shape3(100, 100, 100));
+        shouldEqual(defaultChunks.chunkShape(), Shape3(64));
+    }
+
+    void testFillValue()
+    {
+        Array data(ref.shape(), Shape3(8), ChunkedArrayOptions().fillValue(42));
+
+        shouldEqual(data.getItem(Shape3(24, 19, 14)), 42);
+        MultiArray<3, int> block(data.subarray(Shape3(5), Shape3(13))),
+                           expected(block.shape(), 42);
+        should(block == expected);
+        shouldEqual(data.compressedBytes(), 0u);
+    }
+
+    void testItems()
+    {
+        Array data(ref.shape(), Shape3(8));
+
+        data.setItem(Shape3(1, 2, 3), 5);
+        data.setItem(Shape3(24, 19, 14), 7);
+        shouldEqual(data.getItem(Shape3(1, 2, 3)), 5);
+        shouldEqual(data.getItem(Shape3(24, 19, 14)), 7);
+        shouldEqual(data.getItem(Shape3(9, 9, 9)), 0);
+    }
+
+    void testCheckoutCommit()
+    {
+        Array data(ref.shape(), Shape3(8));
+
+        // commit in blocks that are not aligned with the chunks
+        for(int z=0; z<15; z+=7)
+            for(int x=0; x<25; x+=11)
+            {
+                Shape3 start(x, 0, z),
+                       stop(std::min(x+11, 25), 20, std::min(z+7, 15));
+                data.commitSubarray(start, ref.subarray(start, stop));
+            }
+        shouldEqualChunked(data, ref);
+
+        // checkout into a strided view
+        MultiArray<3, int> transposed(Shape3(9, 6, 10));
+        data.checkoutSubarray(Shape3(3, 4, 2), transposed.transpose());
+        should(transposed.transpose() == ref.subarray(Shape3(3, 4, 2), Shape3(13, 10, 11)));
+    }
+
+    void testCache(CompressionMethod method)
+    {
+        int chunkBytes = 8*8*8*sizeof(int);
+        Array data(ref.shape(), Shape3(8), 
+                   ChunkedArrayOptions().cacheMax(3*chunkBytes).compression(method));
+        data.commitSubarray(Shape3(), ref);
+
+        // the budget is in bytes, so the cache holds more of the small border chunks
+        should(data.cacheSize() >= 3u && data.cacheSize() < 24u);
+        should(data.cacheBytes() <= 3u*chunkBytes);
+        shouldEqual(data.cacheMisses(), 24u);
+        should(data.compressedBytes() > 0);
+
+        // reading a cached chunk is not a miss
+        std::size_t misses = data.cacheMisses();
+        shouldEqual(data.getItem(Shape3(24, 19, 14)), ref(24, 19, 14));
+        shouldEqual(data.cacheMisses(), misses);
+
+        // a chunk that was evicted must be restored
+        shouldEqual(data.getItem(Shape3(0, 0, 0)), ref(0, 0, 0));
+        shouldEqual(data.cacheMisses(), misses+1);
+        shouldEqualChunked(data, ref);
+
+        // reducing the budget evicts chunks, but at least one remains
+        data.setCacheMax(0);
+        shouldEqual(data.cacheSize(), 0u);
+        data.setItem(Shape3(10, 10, 10), -1);
+        shouldEqual(data.cacheSize(), 1u);
+        shouldEqual(data.getItem(Shape3(10, 10, 10)), -1);
+        shouldEqual(data.getItem(Shape3(0, 0, 0)), ref(0, 0, 0));
+        shouldEqual(data.getItem(Shape3(10, 10, 10)), -1);
+
+        // flushing stores modified chunks, but keeps them in the cache
+        data.flush();
+        shouldEqual(data.cacheSize(), 1u);
+    }
+
+    void testNoCompression()
+    {
+        testCache(NO_COMPRESSION);
+    }
+
+    void testZlibCompression()
+    {
+        if(!compressionAvailable(ZLIB))
+        {
+            std::cerr << "ChunkedArrayTest: zlib not available, skipping test.\n";
+            return;
+        }
+        testCache(ZLIB);
+
+        // regular data compress well
+        Array data(ref.shape(), Shape3(8),
+                   ChunkedArrayOptions().cacheMax(0).compression(ZLIB_FAST));
+        data.commitSubarray(Shape3(), ref);
+        should(data.compressedBytes() < ref.size()*sizeof(int) / 2);
+        shouldEqualChunked(data, ref);
+    }
+
+    void testPreconditions()
+    {
+        Array data(ref.shape(), Shape3(8));
+        try
+        {
+            data.getItem(Shape3(25, 0, 0));
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+        try
+        {
+            data.commitSubarray(Shape3(20, 0, 0), ref);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+};
+
+#ifdef HasHDF5
+
+struct ChunkedArrayHDF5Test
+{
+    typedef ChunkedArrayHDF5<3, int> Array;
+
+    MultiArray<3, int> ref;
+    std::string file_name;
+
+    ChunkedArrayHDF5Test()
+    : ref(Shape3(25, 20, 15)),
+      file_name("test_chunked.h5")
+    {
+        linearSequence(ref.begin(), ref.end());
+    }
+
+    ~ChunkedArrayHDF5Test()
+    {
+        std::remove(file_name.c_str());
+    }
+
+    void testCreateAndOpen()
+    {
+        {
+            HDF5File file(file_name, HDF5File::New);
+            file.cd_mk("group");
+            Array data(file, "data", ref.shape(), Shape3(8),
+                       ChunkedArrayOptions().cacheMax(0).fillValue(3).compression(ZLIB_FAST));
+            shouldEqual(data.datasetName(), "/group/data");
+            shouldEqual(data.getItem(Shape3(24, 19, 14)), 3);
+
+            data.commitSubarray(Shape3(), ref);
+            shouldEqualChunked(data, ref);
+            data.setItem(Shape3(1, 2, 3), -1);
+        }
+        ref(1, 2, 3) = -1;
+
+        // the destructor has written all chunks
+        HDF5File file(file_name, HDF5File::Open);
+        MultiArray<3, int> stored;
+        file.readAndResize("/group/data", stored);
+        should(stored == ref);
+
+        Array data(file, "/group/data");
+        shouldEqual(data.shape(), ref.shape());
+        shouldEqual(data.chunkShape(), Shape3(8));
+        shouldEqualChunked(data, ref);
+    }
+
+    void testReadAhead()
+    {
+        HDF5File file(file_name, HDF5File::New);
+        file.write("data", ref);
+
+        Array data(file, "data", ChunkedArrayOptions().cacheMax(0).readAhead(2));
+
+        // the contiguous dataset gets the default chunk shape, which
+        // exceeds the array shape
+        shouldEqual(data.chunkArrayShape(), Shape3(1));
+
+        Array chunked(file, "chunked", ref.shape(), Shape3(4, 5, 5),
+                      ChunkedArrayOptions().cacheMax(0).readAhead(2));
+        chunked.commitSubarray(Shape3(), ref);
+        shouldEqualChunked(chunked, ref);
+
+        // chunks modified after the read-ahead must be returned as written
+        for(int x=0; x<25; ++x)
+            chunked.setItem(Shape3(x, 7, 7), -x);
+        for(int x=0; x<25; ++x)
+            ref(x, 7, 7) = -x;
+        shouldEqualChunked(chunked, ref);
+
+        chunked.flush();
+        Array reopened(file, "chunked", ChunkedArrayOptions().readAhead(3));
+        shouldEqual(reopened.chunkShape(), Shape3(4, 5, 5));
+        shouldEqualChunked(reopened, ref);
+    }
+};
+
+#endif // HasHDF5
+
+struct ChunkedArrayTestSuite
+: public vigra::test_suite
+{
+    ChunkedArrayTestSuite()
+    : vigra::test_suite("ChunkedArrayTestSuite")
+    {
+        add( testCase( &ChunkedArrayTest::testChunkShapes));
+        add( testCase( &ChunkedArrayTest::testFillValue));
+        add( testCase( &ChunkedArrayTest::testItems));
+        add( testCase( &ChunkedArrayTest::testCheckoutCommit));
+        add( testCase( &ChunkedArrayTest::testNoCompression));
+        add( testCase( &ChunkedArrayTest::testZlibCompression));
+        add( testCase( &ChunkedArrayTest::testPreconditions));
+#ifdef HasHDF5
+        add( testCase( &ChunkedArrayHDF5Test::testCreateAndOpen));
+        add( testCase( &ChunkedArrayHDF5Test::testReadAhead));
+#endif
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ChunkedArrayTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}